@@ -1,7 +1,7 @@
 #!/usr/bin/env bash
 # run-benchmarks.sh
 #
-# Runs Go and Rust benchmarks across the Strand Protocol monorepo and
+# Runs Go, Rust and C (StrandRoute) benchmarks across the Strand Protocol monorepo and
 # outputs a summary.
 #
 # Usage: ./scripts/run-benchmarks.sh
@@ -59,6 +59,21 @@ else
     echo -e "${YELLOW}StrandStream benchmarks failed or criterion not installed.${NC}"
 fi
 
+# ------------------------------------------------------------------
+# C benchmarks (StrandRoute)
+# ------------------------------------------------------------------
+log_header "C Benchmarks: StrandRoute (strandroute_bench)"
+
+echo -e "${YELLOW}Building and running strandroute_bench (Release)...${NC}"
+if cmake -S "$REPO_ROOT/strandroute" -B /tmp/strand_strandroute_bench_build \
+        -DCMAKE_BUILD_TYPE=Release >/dev/null &&
+   cmake --build /tmp/strand_strandroute_bench_build --target strandroute_bench -j >/dev/null &&
+   /tmp/strand_strandroute_bench_build/strandroute_bench --out /tmp/strand_strandroute_bench.json; then
+    echo -e "${GREEN}StrandRoute benchmarks complete.${NC}"
+else
+    echo -e "${YELLOW}StrandRoute benchmarks failed.${NC}"
+fi
+
 # ------------------------------------------------------------------
 # Summary
 # ------------------------------------------------------------------
@@ -68,6 +83,7 @@ echo ""
 echo "Go benchmark results:          /tmp/strand_go_bench.txt"
 echo "StrandTrust benchmark results:  /tmp/strand_strandtrust_bench.txt"
 echo "StrandStream benchmark results: /tmp/strand_strandstream_bench.txt"
+echo "StrandRoute benchmark results:  /tmp/strand_strandroute_bench.json"
 echo ""
 
 # Extract key stats from Go benchmarks if available.
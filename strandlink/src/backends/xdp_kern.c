@@ -8,7 +8,8 @@
 //
 // Packet flow:
 //   NIC RX → XDP hook → strandlink_xdp_prog()
-//               ├── StrandLink frame? → bpf_redirect_map → AF_XDP socket
+//               ├── StrandLink frame, routable here? → rewrite → XDP_TX / bpf_redirect
+//               ├── StrandLink frame, otherwise?     → bpf_redirect_map → AF_XDP socket
 //               └── Other frame?   → XDP_PASS (hand to kernel stack)
 //
 // The AF_XDP socket lives in the strandlink userspace backend (xdp.zig).
@@ -24,11 +25,39 @@
 //   3. Fall through to XDP_PASS for any non-matching frame so normal
 //      traffic (SSH, etc.) continues to work.
 //
+// In-kernel forwarding (IPv4 underlay only):
+//   The maps node_fwd_map and hot_sad_map are kept in line with
+//   strandroute's exact node_id table and hot-SAD set by
+//   strandroute/src/xdp_steer.c, whose header documents the key and value
+//   formats.  A frame with a non-zero dst_node_id is looked up in
+//   node_fwd_map; a frame without one is classified by the model_arch,
+//   capability and context_window fields of its SAD option in the
+//   hot_sad_map LPM trie, and the node found there is looked up in
+//   node_fwd_map.  On a hit the program writes the next hop into
+//   dst_node_id, patches the frame CRC-32C for that change, re-addresses
+//   the outer Ethernet/IPv4/UDP headers to the next hop and sends the
+//   frame out again: XDP_TX on the ingress device, bpf_redirect otherwise.
+//   Each in-kernel hop decrements the outer IPv4 TTL; a frame whose TTL
+//   is exhausted goes to the kernel stack (XDP_PASS), which drops it.
+//   Anything else goes to the AF_XDP socket as before.
+//
+// Flow affinity:
+//   An AF_XDP socket only receives frames from the RX queue it is bound
+//   to, so the program cannot move a flow to another queue; NIC RSS over
+//   the outer UDP 4-tuple keeps a flow on one queue.  Frames handed to
+//   the socket carry a struct strandlink_xdp_meta in the XDP metadata
+//   area with the hash of the inner flow (src_node_id, stream_id), so the
+//   userspace backend can spread them over workers without parsing.
+//
 // Build (requires Linux kernel headers + libbpf):
-//   clang -O2 -target bpf -D__TARGET_ARCH_x86 \
-//         -I/usr/include/x86_64-linux-gnu \
+//   clang -O2 -target bpf -D__TARGET_ARCH_x86
+//         -I/usr/include/x86_64-linux-gnu
 //         -c xdp_kern.c -o xdp_kern.o
 //
+// `make strandlink-xdp` at the top level runs that build and
+// `make test-strandlink-xdp` (root) loads the object through the verifier
+// with bpftool; CI runs both.
+//
 // The resulting xdp_kern.o is loaded by the Zig AF_XDP backend at runtime.
 
 #include <linux/bpf.h>
@@ -51,6 +80,86 @@
 /// 64 queues is generous for real-world NICs; increase if needed.
 #define XSKMAP_MAX_ENTRIES 64
 
+/// Sizes of the forwarding maps: node_id_forward and a quarter of
+/// sad_ternary_match in the P4 programs (strandroute/node_table.h, offload.h).
+#define NODE_FWD_MAX_ENTRIES 65536
+#define HOT_SAD_MAX_ENTRIES  1024
+
+/// Overlay header (overlay.zig) and StrandLink frame layout (header.zig).
+#define OVERLAY_MAGIC        0x504C
+#define OVERLAY_HDR_LEN      8
+#define SL_HDR_LEN           64
+#define SL_CRC_LEN           4
+#define SL_OFF_FRAME_LEN     4
+#define SL_OFF_SRC_NODE      16
+#define SL_OFF_STREAM_ID     8
+#define SL_OFF_DST_NODE      32
+#define SL_OFF_OPTIONS_LEN   54
+#define SL_NODE_ID_LEN       16
+#define SL_MAX_XDP_FRAME     0x3FFF // single-buffer XDP frames fit a page
+
+/// TLV option carrying the SAD (options.zig semantic_addr).
+#define SL_OPT_SEMANTIC_ADDR 0x07
+#define SL_MAX_OPTIONS       8      // options walked before giving up
+#define SL_MAX_OPTIONS_LEN   256
+
+/// SAD wire format (strandroute/src/sad.c): 4-byte header, then fields of
+/// type(1) length(2, big-endian) value.
+#define SAD_HDR_LEN          4
+#define SAD_FIELD_HDR_LEN    3
+#define SAD_MAX_FIELDS       16
+#define SAD_FIELD_MODEL_ARCH     0x01
+#define SAD_FIELD_CAPABILITY     0x02
+#define SAD_FIELD_CONTEXT_WINDOW 0x03
+#define SAD_KEY_FIELDS           ((1u << SAD_FIELD_MODEL_ARCH) | \
+                                  (1u << SAD_FIELD_CAPABILITY) | \
+                                  (1u << SAD_FIELD_CONTEXT_WINDOW))
+
+/// CRC-32C (Castagnoli), reflected polynomial, as crc.zig.
+#define CRC32C_POLY 0x82F63B78u
+
+/// xdp_stats_map indices.  Must match XDP_STEER_STAT_* in
+/// strandroute/xdp_steer.h.
+enum {
+    STAT_XSK_DROP = 0,      // AF_XDP redirect failed
+    STAT_XSK,               // handed to the AF_XDP socket
+    STAT_EXACT,             // forwarded by node_fwd_map
+    STAT_SAD,               // forwarded by hot_sad_map
+    STAT_TTL,               // outer TTL exhausted, passed to the stack
+    STAT_MAX,
+};
+
+// ---------------------------------------------------------------------------
+// Map formats — must match strandroute/include/strandroute/xdp_steer.h
+// ---------------------------------------------------------------------------
+
+struct node_fwd_key {
+    __u8 node_id[SL_NODE_ID_LEN];
+};
+
+struct node_fwd_val {
+    __u8  next_hop[SL_NODE_ID_LEN];    // written to dst_node_id
+    __u32 ifindex;                     // egress; ingress ifindex → XDP_TX
+    __be32 saddr;                      // outer IPv4 addresses
+    __be32 daddr;
+    __u8  smac[ETH_ALEN];
+    __u8  dmac[ETH_ALEN];
+};
+
+struct hot_sad_key {
+    __u32 prefixlen;                   // 96 for exact entries
+    __u8  data[12];                    // model_arch, capability, context_window (BE)
+};
+
+struct hot_sad_val {
+    __u8 node_id[SL_NODE_ID_LEN];
+};
+
+/// Prepended to frames handed to the AF_XDP socket.
+struct strandlink_xdp_meta {
+    __u32 flow_hash;                   // inner (src_node_id, stream_id)
+};
+
 // ---------------------------------------------------------------------------
 // BPF maps
 // ---------------------------------------------------------------------------
@@ -67,27 +176,268 @@ struct {
     __uint(max_entries, XSKMAP_MAX_ENTRIES);
 } xsks_map SEC(".maps");
 
-/// Per-CPU statistics counter for dropped frames (congestion / map full).
+/// Per-CPU statistics counters, indexed by STAT_*.  Key 0 counts dropped
+/// frames (congestion / map full), as before.
 struct {
     __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
     __uint(key_size, sizeof(__u32));
     __uint(value_size, sizeof(__u64));
-    __uint(max_entries, 1);
+    __uint(max_entries, STAT_MAX);
 } xdp_stats_map SEC(".maps");
 
+/// Exact dst_node_id → next hop and underlay (strandroute node table).
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __type(key, struct node_fwd_key);
+    __type(value, struct node_fwd_val);
+    __uint(max_entries, NODE_FWD_MAX_ENTRIES);
+} node_fwd_map SEC(".maps");
+
+/// Hot SAD key → resolved node_id (strandroute offload set).  Longest
+/// prefix wins, as the highest-priority TCAM entry does.
+struct {
+    __uint(type, BPF_MAP_TYPE_LPM_TRIE);
+    __type(key, struct hot_sad_key);
+    __type(value, struct hot_sad_val);
+    __uint(max_entries, HOT_SAD_MAX_ENTRIES);
+    __uint(map_flags, BPF_F_NO_PREALLOC);
+} hot_sad_map SEC(".maps");
+
+/// x^(8 * 2^j) mod P (reflected) for j = 0..15; see crc_patch().
+static const __u32 crc_x8n[16] = {
+    0x00800000, 0x00008000, 0x82f63b78, 0x6ea2d55c,
+    0x18b8ea18, 0x510ac59a, 0xb82be955, 0xb8fdb1e7,
+    0x88e56f72, 0x74c360a4, 0xe4172b16, 0x0d65762a,
+    0x35d73a62, 0x28461564, 0xbf455269, 0xe2ea32dc,
+};
+
 // ---------------------------------------------------------------------------
 // Helpers
 // ---------------------------------------------------------------------------
 
-/// Increment the per-CPU drop counter (key 0).
-static __always_inline void count_drop(void)
+/// Increment the per-CPU counter @key.
+static __always_inline void count_stat(__u32 key)
 {
-    __u32 key = 0;
     __u64 *val = bpf_map_lookup_elem(&xdp_stats_map, &key);
     if (val)
         __sync_fetch_and_add(val, 1);
 }
 
+/// Increment the per-CPU drop counter (key 0).
+static __always_inline void count_drop(void)
+{
+    count_stat(STAT_XSK_DROP);
+}
+
+static __always_inline __u32 load_be32(const __u8 *p)
+{
+    return ((__u32)p[0] << 24) | ((__u32)p[1] << 16) |
+           ((__u32)p[2] << 8)  | (__u32)p[3];
+}
+
+static __always_inline void store_be32(__u8 *p, __u32 v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+/// a * b mod P, reflected bit order.  Branch-free: BPF has no
+/// conditional move, so every select would be a jump for the verifier to
+/// follow.
+static __always_inline __u32 crc_mulmod(__u32 a, __u32 b)
+{
+    __u32 p = 0;
+    for (int i = 0; i < 32; i++) {
+        p ^= b & -((a >> (31 - i)) & 1);
+        b = (b >> 1) ^ (CRC32C_POLY & -(b & 1));
+    }
+    return p;
+}
+
+/// CRC-32C of the frame after dst_node_id changed from @old_id to @new_id,
+/// @tail_len bytes before the CRC field.  CRC-32C is linear, so the change
+/// is the raw CRC of the flipped bits shifted over the tail as zeros; the
+/// payload is never read.  Same computation as xdp_steer_crc_patch().
+static __always_inline __u32 crc_patch(__u32 crc, const __u8 *old_id,
+                                       const __u8 *new_id, __u32 tail_len)
+{
+    __u32 d = 0;
+    for (int i = 0; i < SL_NODE_ID_LEN; i++) {
+        d ^= (__u8)(old_id[i] ^ new_id[i]);
+        for (int b = 0; b < 8; b++)
+            d = (d >> 1) ^ (CRC32C_POLY & -(d & 1));
+    }
+    if (d == 0)
+        return crc;
+
+    __u32 x = 0x80000000u;                      // x^0
+    for (int j = 0; j < 16; j++)
+        if (tail_len & (1u << j))
+            x = crc_mulmod(crc_x8n[j], x);
+    return crc ^ crc_mulmod(x, d);
+}
+
+/// Hash of the inner flow, for the AF_XDP metadata.
+static __always_inline __u32 flow_hash(const __u8 *sl)
+{
+    __u32 h = 2166136261u;                      // FNV-1a
+    for (int i = 0; i < SL_NODE_ID_LEN; i++)
+        h = (h ^ sl[SL_OFF_SRC_NODE + i]) * 16777619u;
+    for (int i = 0; i < 4; i++)
+        h = (h ^ sl[SL_OFF_STREAM_ID + i]) * 16777619u;
+    return h;
+}
+
+/// Classify the frame by its SAD option: fill @key with the hot_sad_map
+/// key.  Returns 0, or -1 if the frame carries no SAD or it cannot be
+/// walked within the verifier's bounds.
+static __always_inline int sad_classify(const __u8 *sl, void *data_end,
+                                        struct hot_sad_key *key)
+{
+    const __u8 *opt = sl + SL_HDR_LEN;
+    const __u8 *olen_p = sl + SL_OFF_OPTIONS_LEN;
+    if ((void *)(olen_p + 2) > data_end)
+        return -1;
+    __u32 olen = ((__u32)olen_p[0] << 8) | olen_p[1];
+    if (olen > SL_MAX_OPTIONS_LEN)
+        return -1;
+
+    // Find the semantic address option
+    __u32 off = 0, sad_off = 0, sad_len = 0;
+    for (int i = 0; i < SL_MAX_OPTIONS; i++) {
+        if (off + 2 > olen)
+            return -1;
+        const __u8 *t = opt + (off & 0x1FF);
+        if ((void *)(t + 2) > data_end)
+            return -1;
+        if (t[0] == SL_OPT_SEMANTIC_ADDR) {
+            sad_off = off + 2;
+            sad_len = t[1];
+            break;
+        }
+        off += 2 + t[1];
+    }
+    if (sad_len < SAD_HDR_LEN || sad_off + sad_len > olen)
+        return -1;
+
+    // The first field of each type decides, read as 0 if shorter than 4
+    // bytes, as sad_view_get_uint32() reads it when the offload key is
+    // built; later duplicates are ignored.
+    __u32 model_arch = 0, capability = 0, context_window = 0;
+    __u32 seen = 0, f = SAD_HDR_LEN;
+    for (int i = 0; i < SAD_MAX_FIELDS; i++) {
+        if (f + SAD_FIELD_HDR_LEN > sad_len)
+            break;
+        const __u8 *p = opt + ((sad_off + f) & 0x1FF);
+        if ((void *)(p + SAD_FIELD_HDR_LEN) > data_end)
+            return -1;
+        __u32 flen = ((__u32)p[1] << 8) | p[2];
+        if (f + SAD_FIELD_HDR_LEN + flen > sad_len)
+            return -1;
+        __u32 type = p[0];
+        if (type >= SAD_FIELD_MODEL_ARCH && type <= SAD_FIELD_CONTEXT_WINDOW &&
+            !(seen & (1u << type))) {
+            seen |= 1u << type;
+            __u32 v = 0;
+            if (flen >= 4) {
+                if ((void *)(p + SAD_FIELD_HDR_LEN + 4) > data_end)
+                    return -1;
+                v = load_be32(p + SAD_FIELD_HDR_LEN);
+            }
+            if (type == SAD_FIELD_MODEL_ARCH)
+                model_arch = v;
+            else if (type == SAD_FIELD_CAPABILITY)
+                capability = v;
+            else
+                context_window = v;
+        }
+        f += SAD_FIELD_HDR_LEN + flen;
+    }
+    // Fields past the walk could hold a first occurrence we missed
+    if (f + SAD_FIELD_HDR_LEN <= sad_len && seen != SAD_KEY_FIELDS)
+        return -1;
+
+    key->prefixlen = 96;
+    store_be32(&key->data[0], model_arch);
+    store_be32(&key->data[4], capability);
+    store_be32(&key->data[8], context_window);
+    return 0;
+}
+
+/// Recompute the 20-byte IPv4 header checksum.
+static __always_inline void ipv4_csum(struct iphdr *ip)
+{
+    __u32 sum = 0;
+    __u16 *w = (__u16 *)ip;
+    ip->check = 0;
+    for (int i = 0; i < (int)(sizeof(*ip) / 2); i++)
+        sum += w[i];
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    ip->check = (__u16)~sum;
+}
+
+/// Forward the frame at @sl to @hop: rewrite dst_node_id, patch the CRC
+/// and re-address the outer headers.  The outer TTL drops by one per
+/// in-kernel hop, so a cycle in the maps cannot loop a frame forever.
+/// Returns the XDP action, or -1 to leave the frame to userspace.
+static __always_inline int fwd_frame(struct xdp_md *ctx, struct ethhdr *eth,
+                                     struct iphdr *ip, struct udphdr *udp,
+                                     __u8 *sl, void *data_end,
+                                     const struct node_fwd_val *hop)
+{
+    if (ip->ttl <= 1) {
+        count_stat(STAT_TTL);
+        return XDP_PASS;
+    }
+
+    __u32 frame_len = load_be32(sl + SL_OFF_FRAME_LEN);
+    if (frame_len < SL_HDR_LEN + SL_CRC_LEN || frame_len > SL_MAX_XDP_FRAME)
+        return -1;
+    __u8 *crc_p = sl + ((frame_len - SL_CRC_LEN) & SL_MAX_XDP_FRAME);
+    if ((void *)(crc_p + SL_CRC_LEN) > data_end)
+        return -1;
+
+    // The CRC trailer is little-endian (frame.zig)
+    __u8 *dst = sl + SL_OFF_DST_NODE;
+    __u32 crc = (__u32)crc_p[0] | ((__u32)crc_p[1] << 8) |
+                ((__u32)crc_p[2] << 16) | ((__u32)crc_p[3] << 24);
+    crc = crc_patch(crc, dst, hop->next_hop,
+                    frame_len - SL_CRC_LEN - SL_OFF_DST_NODE - SL_NODE_ID_LEN);
+    crc_p[0] = crc;
+    crc_p[1] = crc >> 8;
+    crc_p[2] = crc >> 16;
+    crc_p[3] = crc >> 24;
+    __builtin_memcpy(dst, hop->next_hop, SL_NODE_ID_LEN);
+
+    __builtin_memcpy(eth->h_source, hop->smac, ETH_ALEN);
+    __builtin_memcpy(eth->h_dest, hop->dmac, ETH_ALEN);
+    ip->saddr = hop->saddr;
+    ip->daddr = hop->daddr;
+    ip->ttl--;
+    ipv4_csum(ip);
+    udp->check = 0;                             // optional over IPv4
+
+    if (hop->ifindex == ctx->ingress_ifindex)
+        return XDP_TX;
+    return bpf_redirect(hop->ifindex, 0);
+}
+
+/// Prepend the AF_XDP metadata.  Best effort: drivers without metadata
+/// support simply hand the frame over without it.
+static __always_inline void set_meta(struct xdp_md *ctx, __u32 hash)
+{
+    if (bpf_xdp_adjust_meta(ctx, -(int)sizeof(struct strandlink_xdp_meta)))
+        return;
+    void *data = (void *)(long)ctx->data;
+    struct strandlink_xdp_meta *meta = (void *)(long)ctx->data_meta;
+    if ((void *)(meta + 1) > data)
+        return;
+    meta->flow_hash = hash;
+}
+
 // ---------------------------------------------------------------------------
 // Main XDP program
 // ---------------------------------------------------------------------------
@@ -127,12 +477,15 @@ int strandlink_xdp_prog(struct xdp_md *ctx)
     // -----------------------------------------------------------------------
     __u8 ip_proto;
     void *l4_start;
+    struct iphdr *ip4 = NULL;   // set when the outer header can be rewritten
 
     if (inner_proto == ETH_P_IP) {
         // IPv4
         struct iphdr *ip = l3_start;
         if ((void *)(ip + 1) > data_end)
             return XDP_PASS;
+        if (ip->ihl == 5 && eth_proto == ETH_P_IP)
+            ip4 = ip;
         // IHL is in 32-bit words; multiply by 4 to get bytes.
         __u32 ip_hdr_len = (ip->ihl & 0x0F) * 4;
         if (ip_hdr_len < sizeof(struct iphdr))
@@ -169,7 +522,50 @@ int strandlink_xdp_prog(struct xdp_md *ctx)
         return XDP_PASS;
 
     // -----------------------------------------------------------------------
-    // StrandLink overlay detected — redirect to AF_XDP socket
+    // StrandLink overlay detected — forward in the kernel if the node
+    // table or the hot-SAD set already routes the frame
+    // -----------------------------------------------------------------------
+    __u8 *oh = (__u8 *)(udp + 1);
+    __u8 *sl = oh + OVERLAY_HDR_LEN;
+    if ((void *)(sl + SL_HDR_LEN) > data_end)
+        goto to_user;
+    if (((oh[0] << 8) | oh[1]) != OVERLAY_MAGIC)
+        goto to_user;
+
+    if (ip4) {
+        struct node_fwd_key nkey;
+        __builtin_memcpy(nkey.node_id, sl + SL_OFF_DST_NODE, SL_NODE_ID_LEN);
+
+        __u8 any = 0;
+        for (int i = 0; i < SL_NODE_ID_LEN; i++)
+            any |= nkey.node_id[i];
+        int resolved = any != 0;
+        if (!resolved) {
+            // Not resolved yet: classify by the SAD
+            struct hot_sad_key skey;
+            struct hot_sad_val *node;
+            if (sad_classify(sl, data_end, &skey) == 0 &&
+                (node = bpf_map_lookup_elem(&hot_sad_map, &skey)) != NULL)
+                __builtin_memcpy(nkey.node_id, node->node_id, SL_NODE_ID_LEN);
+            else
+                goto to_user;
+        }
+
+        struct node_fwd_val *hop = bpf_map_lookup_elem(&node_fwd_map, &nkey);
+        if (hop) {
+            int act = fwd_frame(ctx, eth, ip4, udp, sl, data_end, hop);
+            if (act == XDP_PASS)
+                return act;
+            if (act >= 0) {
+                count_stat(resolved ? STAT_EXACT : STAT_SAD);
+                return act;
+            }
+        }
+    }
+
+to_user:;
+    // -----------------------------------------------------------------------
+    // Otherwise — redirect to AF_XDP socket
     //
     // bpf_redirect_map() atomically looks up ctx->rx_queue_index in xsks_map
     // and steers the frame to the matching AF_XDP socket.  If no socket is
@@ -177,12 +573,20 @@ int strandlink_xdp_prog(struct xdp_md *ctx)
     // XDP_PASS is used so that the frame reaches the normal kernel UDP stack
     // instead of being silently dropped.
     // -----------------------------------------------------------------------
-    int ret = bpf_redirect_map(&xsks_map, ctx->rx_queue_index, XDP_PASS);
+    __u32 hash = 0;
+    if ((void *)(sl + SL_HDR_LEN) <= data_end)
+        hash = flow_hash(sl);
+    __u32 rxq = ctx->rx_queue_index;
+    set_meta(ctx, hash);        // invalidates every packet pointer above
+
+    int ret = bpf_redirect_map(&xsks_map, rxq, XDP_PASS);
 
     if (ret == XDP_DROP) {
         // Map lookup succeeded but the socket's fill ring was full —
         // the frame was dropped.  Count it for diagnostics.
         count_drop();
+    } else if (ret == XDP_REDIRECT) {
+        count_stat(STAT_XSK);
     }
 
     return ret;
@@ -0,0 +1,967 @@
+/*
+ * strandroute_bench.c - Microbenchmarks and scaling runs, JSON output
+ *
+ * Every table, query and frame is generated from a fixed seed, so two
+ * runs on the same machine measure the same work and their JSON can be
+ * diffed (scripts/run-benchmarks.sh keeps one per run).  Time-based
+ * benchmarks calibrate an iteration count to --min-ms, then report the
+ * median and best of --repeat runs.
+ *
+ *   strandroute_bench [--quick | --smoke] [--filter SUBSTR] [--threads N]
+ *                     [--min-ms MS] [--repeat N] [--seed S] [--out FILE]
+ *                     [--replicas N]
+ *
+ * --replicas runs the lookup scaling table with NUMA replicas
+ * (routing_table_set_replicas; -1 = one per node).
+ *
+ * Build with -DCMAKE_BUILD_TYPE=Release for numbers worth comparing; the
+ * build type is recorded in the output.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "strandroute/forwarding.h"
+#include "strandroute/multipath.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/sad.h"
+#include "strandroute/sad_match.h"
+#include "strandroute/types.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef STRANDROUTE_VERSION
+#define STRANDROUTE_VERSION "unknown"
+#endif
+#ifndef STRANDROUTE_BUILD_TYPE
+#define STRANDROUTE_BUILD_TYPE "unknown"
+#endif
+
+/* --------------------------------------------------------------------------
+ * Options
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    const char *filter;
+    const char *out_path;
+    uint64_t    seed;
+    uint32_t    min_ms;         /* per timed run */
+    uint32_t    repeat;
+    int         max_threads;
+    int         replicas;       /* lookup scaling table, 0 = off */
+    bool        quick;          /* skip the 100k table, shorter runs */
+    bool        smoke;          /* everything once, smallest sizes */
+} bench_opts_t;
+
+static bench_opts_t g_opt = {
+    .filter = NULL, .out_path = NULL, .seed = 1,
+    .min_ms = 200, .repeat = 5, .max_threads = 0,
+};
+
+static FILE *g_out;
+static int   g_results;
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--quick | --smoke] [--filter SUBSTR] [--threads N]\n"
+            "          [--min-ms MS] [--repeat N] [--seed S] [--out FILE]\n"
+            "          [--replicas N]\n",
+            argv0);
+}
+
+static int parse_args(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--quick")) {
+            g_opt.quick = true;
+        } else if (!strcmp(a, "--smoke")) {
+            g_opt.smoke = true;
+        } else if (!strcmp(a, "--filter") && v) {
+            g_opt.filter = v; i++;
+        } else if (!strcmp(a, "--out") && v) {
+            g_opt.out_path = v; i++;
+        } else if (!strcmp(a, "--seed") && v) {
+            g_opt.seed = strtoull(v, NULL, 0); i++;
+        } else if (!strcmp(a, "--min-ms") && v) {
+            g_opt.min_ms = (uint32_t)strtoul(v, NULL, 0); i++;
+        } else if (!strcmp(a, "--repeat") && v) {
+            g_opt.repeat = (uint32_t)strtoul(v, NULL, 0); i++;
+        } else if (!strcmp(a, "--threads") && v) {
+            g_opt.max_threads = atoi(v); i++;
+        } else if (!strcmp(a, "--replicas") && v) {
+            g_opt.replicas = atoi(v); i++;
+        } else {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (g_opt.quick) {
+        g_opt.min_ms = 50;
+        g_opt.repeat = 3;
+    }
+    if (g_opt.smoke) {
+        g_opt.min_ms = 1;
+        g_opt.repeat = 1;
+    }
+    if (g_opt.repeat == 0) g_opt.repeat = 1;
+    if (g_opt.max_threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        g_opt.max_threads = n > 0 ? (int)n : 1;
+    }
+    if (g_opt.smoke && g_opt.max_threads > 2)
+        g_opt.max_threads = 2;
+    return 0;
+}
+
+static bool selected(const char *name)
+{
+    return !g_opt.filter || strstr(name, g_opt.filter) != NULL;
+}
+
+/* --------------------------------------------------------------------------
+ * Clock and deterministic generator
+ * -------------------------------------------------------------------------- */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t rng_next(uint64_t *s)
+{
+    /* splitmix64 */
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static uint32_t rng_below(uint64_t *s, uint32_t n)
+{
+    return (uint32_t)(rng_next(s) % n);
+}
+
+/* Keeps results alive without a store the compiler can drop */
+static volatile uint64_t g_sink;
+
+/* --------------------------------------------------------------------------
+ * JSON output
+ * -------------------------------------------------------------------------- */
+
+static void json_begin_result(const char *name)
+{
+    fprintf(g_out, "%s\n    {\"name\": \"%s\"", g_results++ ? "," : "", name);
+}
+
+static void json_u64(const char *key, uint64_t v)
+{
+    fprintf(g_out, ", \"%s\": %llu", key, (unsigned long long)v);
+}
+
+static void json_f64(const char *key, double v)
+{
+    fprintf(g_out, ", \"%s\": %.4f", key, v);
+}
+
+static void json_str(const char *key, const char *v)
+{
+    fprintf(g_out, ", \"%s\": \"%s\"", key, v);
+}
+
+static void json_end_result(void)
+{
+    fputs("}", g_out);
+    fflush(g_out);
+}
+
+/* --------------------------------------------------------------------------
+ * Timed loops
+ *
+ * A benchmark body runs @iters operations and returns.  It is calibrated
+ * until one run takes at least --min-ms, then run --repeat times.
+ * -------------------------------------------------------------------------- */
+
+typedef void (*bench_body_fn)(void *ctx, uint64_t iters);
+
+typedef struct {
+    uint64_t iters;
+    double   median_ns;         /* per operation */
+    double   best_ns;
+} bench_timing_t;
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static bench_timing_t bench_time(bench_body_fn fn, void *ctx)
+{
+    bench_timing_t t = { 1, 0, 0 };
+    uint64_t target = (uint64_t)g_opt.min_ms * 1000000ull;
+
+    for (;;) {
+        uint64_t t0 = now_ns();
+        fn(ctx, t.iters);
+        uint64_t dt = now_ns() - t0;
+        if (dt >= target || g_opt.smoke)
+            break;
+        /* Aim 20% past the target, at most 100x per step */
+        uint64_t next = dt ? (uint64_t)((double)t.iters * 1.2 * (double)target / (double)dt)
+                           : t.iters * 100;
+        if (next > t.iters * 100) next = t.iters * 100;
+        t.iters = next > t.iters ? next : t.iters + 1;
+    }
+
+    double runs[64];
+    uint32_t n = g_opt.repeat < 64 ? g_opt.repeat : 64;
+    for (uint32_t r = 0; r < n; r++) {
+        uint64_t t0 = now_ns();
+        fn(ctx, t.iters);
+        runs[r] = (double)(now_ns() - t0) / (double)t.iters;
+    }
+    qsort(runs, n, sizeof(runs[0]), cmp_double);
+    t.median_ns = runs[n / 2];
+    t.best_ns   = runs[0];
+    return t;
+}
+
+static void json_timing(const bench_timing_t *t)
+{
+    json_u64("iterations", t->iters);
+    json_f64("ns_per_op", t->median_ns);
+    json_f64("best_ns_per_op", t->best_ns);
+    json_f64("ops_per_sec", t->median_ns > 0 ? 1e9 / t->median_ns : 0);
+}
+
+/* --------------------------------------------------------------------------
+ * Synthetic data
+ * -------------------------------------------------------------------------- */
+
+static const uint16_t k_regions[] = { 840, 276, 250, 392, 826, 124, 36, 76 };
+#define NUM_REGIONS (sizeof(k_regions) / sizeof(k_regions[0]))
+
+/* A route entry drawn from a spread of architectures, capabilities,
+ * context windows, trust levels and regions */
+static route_entry_t gen_entry(uint64_t *s, uint32_t i)
+{
+    route_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.node_id[0] = 0xB0;
+    e.node_id[1] = (uint8_t)(i >> 16);
+    e.node_id[2] = (uint8_t)(i >> 8);
+    e.node_id[3] = (uint8_t)i;
+    e.latency_us  = 1000 + rng_below(s, 50000);
+    e.cost_milli  = 10 + rng_below(s, 2000);
+    e.trust_level = (uint8_t)rng_below(s, 5);
+    e.region_code = k_regions[rng_below(s, NUM_REGIONS)];
+    e.load_factor = (float)rng_below(s, 100) / 100.0f;
+
+    sad_init(&e.capabilities);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_MODEL_ARCH,
+                   MODEL_ARCH_TRANSFORMER + rng_below(s, 6));
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CAPABILITY,
+                   CAP_TEXT_GEN | (uint32_t)(rng_next(s) & 0xFE));
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CONTEXT_WINDOW,
+                   4096u << rng_below(s, 7));   /* 4k .. 256k */
+    return e;
+}
+
+static route_entry_t *gen_table(uint32_t n, uint64_t seed)
+{
+    route_entry_t *t = malloc((size_t)n * sizeof(*t));
+    if (!t) return NULL;
+    uint64_t s = seed;
+    for (uint32_t i = 0; i < n; i++)
+        t[i] = gen_entry(&s, i);
+    return t;
+}
+
+static routing_table_t *gen_routing_table(const route_entry_t *rows, uint32_t n)
+{
+    routing_table_t *rt = routing_table_create(n);
+    if (!rt) return NULL;
+    routing_table_txn_t *txn = routing_table_txn_begin(rt);
+    if (!txn) {
+        routing_table_destroy(rt);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < n; i++)
+        routing_table_txn_insert(txn, &rows[i]);
+    routing_table_txn_commit(txn);
+    return rt;
+}
+
+/* Query selectivity classes over gen_entry() tables */
+typedef enum { SEL_BROAD, SEL_MEDIUM, SEL_NARROW, SEL_COUNT } selectivity_t;
+
+static const char *const k_sel_name[SEL_COUNT] = { "broad", "medium", "narrow" };
+
+static void gen_query(sad_t *q, selectivity_t sel)
+{
+    sad_init(q);
+    switch (sel) {
+    case SEL_BROAD:         /* every row */
+        sad_add_uint32(q, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN);
+        break;
+    case SEL_MEDIUM:        /* one architecture, one extra capability */
+        sad_add_uint32(q, SAD_FIELD_MODEL_ARCH, MODEL_ARCH_TRANSFORMER);
+        sad_add_uint32(q, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN | CAP_CODE_GEN);
+        sad_add_uint32(q, SAD_FIELD_MAX_LATENCY_MS, 40);
+        break;
+    case SEL_NARROW:        /* long context, high trust, excluded regions */
+        sad_add_uint32(q, SAD_FIELD_MODEL_ARCH, MODEL_ARCH_MOE);
+        sad_add_uint32(q, SAD_FIELD_CAPABILITY,
+                       CAP_TEXT_GEN | CAP_REASONING | CAP_TOOL_USE);
+        sad_add_uint32(q, SAD_FIELD_CONTEXT_WINDOW, 131072);
+        sad_add_uint8(q, SAD_FIELD_TRUST_LEVEL, TRUST_SAFETY_EVAL);
+        sad_add_regions(q, SAD_FIELD_REGION_EXCLUDE, k_regions + 4, 4);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Fraction of @rows the query does not disqualify */
+static double match_fraction(const sad_t *q, const route_entry_t *rows, uint32_t n)
+{
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n; i++)
+        m += sad_match_score(q, &rows[i], NULL) >= 0.0f;
+    return n ? (double)m / n : 0;
+}
+
+/* A descriptor as an endpoint might send it: several fields set */
+static void gen_descriptor(sad_t *q)
+{
+    const uint16_t prefer[] = { 840, 826 };
+    const uint16_t exclude[] = { 250 };
+    sad_init(q);
+    sad_add_uint32(q, SAD_FIELD_MODEL_ARCH, MODEL_ARCH_TRANSFORMER);
+    sad_add_uint32(q, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN | CAP_CODE_GEN);
+    sad_add_uint32(q, SAD_FIELD_CONTEXT_WINDOW, 32768);
+    sad_add_uint32(q, SAD_FIELD_MAX_LATENCY_MS, 25);
+    sad_add_uint32(q, SAD_FIELD_MAX_COST_MILLI, 500);
+    sad_add_uint8(q, SAD_FIELD_TRUST_LEVEL, TRUST_IDENTITY);
+    sad_add_regions(q, SAD_FIELD_REGION_PREFER, prefer, 2);
+    sad_add_regions(q, SAD_FIELD_REGION_EXCLUDE, exclude, 1);
+}
+
+/* --------------------------------------------------------------------------
+ * SAD encode / decode / validate
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    sad_t   sad;
+    uint8_t buf[SAD_MAX_SIZE];
+    int     len;
+} sad_ctx_t;
+
+static void body_sad_encode(void *ctx, uint64_t iters)
+{
+    sad_ctx_t *c = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++)
+        acc += (uint64_t)sad_encode(&c->sad, c->buf, sizeof(c->buf));
+    g_sink += acc;
+}
+
+static void body_sad_decode(void *ctx, uint64_t iters)
+{
+    sad_ctx_t *c = ctx;
+    sad_t out;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++)
+        acc += (uint64_t)sad_decode(c->buf, (size_t)c->len, &out) + out.num_fields;
+    g_sink += acc;
+}
+
+static void body_sad_validate(void *ctx, uint64_t iters)
+{
+    sad_ctx_t *c = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++)
+        acc += (uint64_t)sad_validate(c->buf, (size_t)c->len);
+    g_sink += acc;
+}
+
+/* What a receiver that used to run sad_validate then sad_decode pays now */
+static void body_sad_decode_validated(void *ctx, uint64_t iters)
+{
+    sad_ctx_t *c = ctx;
+    sad_t out;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++)
+        acc += (uint64_t)sad_decode_validated(c->buf, (size_t)c->len, &out, NULL) +
+               out.num_fields;
+    g_sink += acc;
+}
+
+static void bench_sad_codec(void)
+{
+    static const struct {
+        const char   *name;
+        bench_body_fn fn;
+    } k[] = {
+        { "sad_encode",           body_sad_encode },
+        { "sad_decode",           body_sad_decode },
+        { "sad_validate",         body_sad_validate },
+        { "sad_decode_validated", body_sad_decode_validated },
+    };
+
+    sad_ctx_t c;
+    gen_descriptor(&c.sad);
+    c.len = sad_encode(&c.sad, c.buf, sizeof(c.buf));
+    if (c.len <= 0) return;
+
+    for (size_t i = 0; i < sizeof(k) / sizeof(k[0]); i++) {
+        if (!selected(k[i].name)) continue;
+        bench_timing_t t = bench_time(k[i].fn, &c);
+        json_begin_result(k[i].name);
+        json_u64("fields", c.sad.num_fields);
+        json_u64("bytes", (uint64_t)c.len);
+        json_timing(&t);
+        json_f64("mb_per_sec", t.median_ns > 0 ? c.len * 1e3 / t.median_ns : 0);
+        json_end_result();
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * sad_find_best over flat tables
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    const route_entry_t *rows;
+    uint32_t             n;
+    sad_t                query;
+    scoring_weights_t    weights;
+} find_ctx_t;
+
+static void body_find_best(void *ctx, uint64_t iters)
+{
+    find_ctx_t *c = ctx;
+    resolve_result_t res[4];
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++)
+        acc += (uint64_t)sad_find_best(&c->query, c->rows, (int)c->n,
+                                       &c->weights, 4, res);
+    g_sink += acc;
+}
+
+static void bench_find_best(void)
+{
+    static const uint32_t sizes[] = { 1000, 10000, 100000 };
+    size_t num_sizes = g_opt.smoke ? 1 : g_opt.quick ? 2 : 3;
+
+    for (size_t si = 0; si < num_sizes; si++) {
+        char name[64];
+        bool any = false;
+        for (int sel = 0; sel < SEL_COUNT; sel++) {
+            snprintf(name, sizeof(name), "sad_find_best/%u/%s",
+                     sizes[si], k_sel_name[sel]);
+            any |= selected(name);
+        }
+        if (!any) continue;
+
+        find_ctx_t c;
+        route_entry_t *rows = gen_table(sizes[si], g_opt.seed);
+        if (!rows) continue;
+        c.rows    = rows;
+        c.n       = sizes[si];
+        c.weights = scoring_weights_default();
+
+        for (int sel = 0; sel < SEL_COUNT; sel++) {
+            snprintf(name, sizeof(name), "sad_find_best/%u/%s",
+                     sizes[si], k_sel_name[sel]);
+            if (!selected(name)) continue;
+            gen_query(&c.query, (selectivity_t)sel);
+            bench_timing_t t = bench_time(body_find_best, &c);
+            json_begin_result(name);
+            json_u64("entries", c.n);
+            json_str("selectivity", k_sel_name[sel]);
+            json_f64("match_fraction", match_fraction(&c.query, rows, c.n));
+            json_u64("top_k", 4);
+            json_timing(&t);
+            json_f64("ns_per_entry", t.median_ns / c.n);
+            json_end_result();
+        }
+        free(rows);
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * routing_table_lookup read scaling under a metrics writer
+ * -------------------------------------------------------------------------- */
+
+#define SCALE_ENTRIES   10000
+#define WRITER_PAUSE_NS 100000          /* writer: one update per 100 us */
+
+typedef struct {
+    routing_table_t *rt;
+    sad_t            queries[SEL_COUNT];
+    _Atomic int      phase;             /* 0 warm-up, 1 measure, 2 stop */
+    _Atomic uint64_t lookups;
+    _Atomic uint64_t updates;
+    uint64_t         seed;
+} scale_ctx_t;
+
+static void *scale_reader(void *arg)
+{
+    scale_ctx_t *c = arg;
+    resolve_result_t res[4];
+    uint64_t n = 0, acc = 0;
+    int q = 0;
+    while (atomic_load_explicit(&c->phase, memory_order_relaxed) < 2) {
+        acc += (uint64_t)routing_table_lookup(c->rt, &c->queries[q], res, 4);
+        q = (q + 1) % SEL_COUNT;
+        if (atomic_load_explicit(&c->phase, memory_order_relaxed) == 1)
+            n++;
+    }
+    atomic_fetch_add(&c->lookups, n);
+    g_sink += acc;
+    return NULL;
+}
+
+static void *scale_writer(void *arg)
+{
+    scale_ctx_t *c = arg;
+    uint64_t s = c->seed ^ 0x5EED;
+    uint64_t n = 0;
+    const struct timespec pause = { 0, WRITER_PAUSE_NS };
+    while (atomic_load_explicit(&c->phase, memory_order_relaxed) < 2) {
+        uint8_t id[16] = { 0xB0 };
+        uint32_t i = rng_below(&s, SCALE_ENTRIES);
+        id[1] = (uint8_t)(i >> 16);
+        id[2] = (uint8_t)(i >> 8);
+        id[3] = (uint8_t)i;
+        routing_table_update_metrics(c->rt, id, 1000 + rng_below(&s, 50000),
+                                     (float)rng_below(&s, 100) / 100.0f);
+        if (atomic_load_explicit(&c->phase, memory_order_relaxed) == 1)
+            n++;
+        nanosleep(&pause, NULL);
+    }
+    atomic_fetch_add(&c->updates, n);
+    return NULL;
+}
+
+static void bench_lookup_scaling(void)
+{
+    if (!selected("routing_table_lookup/threads")) return;
+
+    uint32_t entries = g_opt.smoke ? 1000 : SCALE_ENTRIES;
+    route_entry_t *rows = gen_table(entries, g_opt.seed);
+    if (!rows) return;
+    scale_ctx_t *c = calloc(1, sizeof(*c));
+    if (!c) { free(rows); return; }
+    c->rt   = gen_routing_table(rows, entries);
+    c->seed = g_opt.seed;
+    free(rows);
+    if (!c->rt) { free(c); return; }
+    for (int q = 0; q < SEL_COUNT; q++)
+        gen_query(&c->queries[q], (selectivity_t)q);
+    int replicas = 1;
+    if (g_opt.replicas)
+        replicas = routing_table_set_replicas(c->rt, g_opt.replicas);
+
+    uint64_t measure_ns = (uint64_t)g_opt.min_ms * 1000000ull * 2;
+    pthread_t *tids = malloc((size_t)g_opt.max_threads * sizeof(*tids));
+    if (!tids) goto out;
+
+    /* 1, 2, 4, ... and finally --threads itself */
+    for (int threads = 1;; threads = threads * 2 < g_opt.max_threads
+                                     ? threads * 2 : g_opt.max_threads) {
+        atomic_store(&c->phase, 0);
+        atomic_store(&c->lookups, 0);
+        atomic_store(&c->updates, 0);
+
+        pthread_t writer;
+        int started = 0;
+        if (pthread_create(&writer, NULL, scale_writer, c) != 0)
+            break;
+        for (; started < threads; started++) {
+            if (pthread_create(&tids[started], NULL, scale_reader, c) != 0)
+                break;
+        }
+
+        /* Warm up (caches, epoch registration), then measure */
+        const struct timespec warm = { 0, 20000000 };
+        nanosleep(&warm, NULL);
+        uint64_t t0 = now_ns();
+        atomic_store(&c->phase, 1);
+        struct timespec run = { (time_t)(measure_ns / 1000000000ull),
+                                (long)(measure_ns % 1000000000ull) };
+        nanosleep(&run, NULL);
+        uint64_t dt = now_ns() - t0;
+        atomic_store(&c->phase, 2);
+        for (int i = 0; i < started; i++)
+            pthread_join(tids[i], NULL);
+        pthread_join(writer, NULL);
+
+        double secs = (double)dt / 1e9;
+        double total = (double)atomic_load(&c->lookups) / secs;
+        char name[64];
+        snprintf(name, sizeof(name), "routing_table_lookup/threads/%d", started);
+        json_begin_result(name);
+        json_u64("entries", entries);
+        json_u64("threads", (uint64_t)started);
+        json_u64("replicas", replicas > 0 ? (uint64_t)replicas : 0);
+        json_str("queries", "broad,medium,narrow");
+        json_f64("lookups_per_sec", total);
+        json_f64("lookups_per_sec_per_thread", started ? total / started : 0);
+        json_f64("writer_updates_per_sec", (double)atomic_load(&c->updates) / secs);
+        json_end_result();
+
+        if (started < threads || threads == g_opt.max_threads)
+            break;
+    }
+    free(tids);
+out:
+    routing_table_destroy(c->rt);
+    free(c);
+}
+
+/* --------------------------------------------------------------------------
+ * Maglev
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    maglev_t m;
+    uint8_t  ids[64][STRANDLINK_NODE_ID_LEN];
+    uint32_t weights[64];               /* 2..101, toggled in the low bit */
+    int      backends;
+    uint32_t flip;
+    uint8_t  keys[256][24];
+} maglev_ctx_t;
+
+/* One weight change, then a full rebuild (populate skips clean tables) */
+static void body_maglev_populate(void *ctx, uint64_t iters)
+{
+    maglev_ctx_t *c = ctx;
+    for (uint64_t i = 0; i < iters; i++) {
+        int b = (int)(c->flip++ % (uint32_t)c->backends);
+        c->weights[b] ^= 1;
+        maglev_add_backend(&c->m, c->ids[b], c->weights[b]);
+        maglev_populate(&c->m);
+    }
+}
+
+static void body_maglev_lookup(void *ctx, uint64_t iters)
+{
+    maglev_ctx_t *c = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++)
+        acc += (uint64_t)maglev_lookup(&c->m, c->keys[i & 255], sizeof(c->keys[0]));
+    g_sink += acc;
+}
+
+static void bench_maglev(void)
+{
+    static const int counts[] = { 8, 64 };
+    maglev_ctx_t *c = malloc(sizeof(*c));
+    if (!c) return;
+
+    for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+        char pop[64], look[64];
+        snprintf(pop, sizeof(pop), "maglev_populate/%d", counts[k]);
+        snprintf(look, sizeof(look), "maglev_lookup/%d", counts[k]);
+        if (!selected(pop) && !selected(look)) continue;
+
+        if (maglev_init(&c->m, 0) != 0) break;
+        uint64_t s = g_opt.seed;
+        c->backends = counts[k];
+        c->flip     = 0;
+        for (int b = 0; b < c->backends; b++) {
+            memset(c->ids[b], 0, STRANDLINK_NODE_ID_LEN);
+            c->ids[b][0] = 0xC0;
+            c->ids[b][1] = (uint8_t)b;
+            c->weights[b] = 2 + rng_below(&s, 100);
+            maglev_add_backend(&c->m, c->ids[b], c->weights[b]);
+        }
+        for (int i = 0; i < 256; i++)
+            for (size_t j = 0; j < sizeof(c->keys[0]); j++)
+                c->keys[i][j] = (uint8_t)rng_next(&s);
+        maglev_populate(&c->m);
+
+        if (selected(pop)) {
+            bench_timing_t t = bench_time(body_maglev_populate, c);
+            json_begin_result(pop);
+            json_u64("backends", (uint64_t)c->backends);
+            json_u64("table_size", maglev_get_table_size(&c->m));
+            json_timing(&t);
+            json_end_result();
+        }
+        if (selected(look)) {
+            bench_timing_t t = bench_time(body_maglev_lookup, c);
+            json_begin_result(look);
+            json_u64("backends", (uint64_t)c->backends);
+            json_u64("table_size", maglev_get_table_size(&c->m));
+            json_timing(&t);
+            json_end_result();
+        }
+        maglev_destroy(&c->m);
+    }
+    free(c);
+}
+
+/* --------------------------------------------------------------------------
+ * Forwarding: synthetic frames through forwarding_engine_process_frame
+ * -------------------------------------------------------------------------- */
+
+#define FWD_FRAMES 256
+
+typedef struct {
+    forwarding_engine_t        eng;
+    strandlink_frame_t        *frames;          /* FWD_FRAMES */
+    strandlink_frame_header_t  templates[FWD_FRAMES];
+    uint64_t                   sent;
+} fwd_ctx_t;
+
+static int fwd_send_count(strandlink_port_t port, const strandlink_frame_t *frame,
+                          void *ctx)
+{
+    (void)port;
+    (void)frame;
+    ((fwd_ctx_t *)ctx)->sent++;
+    return 0;
+}
+
+/*
+ * Frames carrying @flows distinct descriptors (all of them resolvable),
+ * from as many sources and streams.  The header is restored from its
+ * template before each send, since forwarding rewrites it.
+ */
+static void gen_frames(fwd_ctx_t *c, int flows, uint64_t seed)
+{
+    uint64_t s = seed;
+    for (int i = 0; i < FWD_FRAMES; i++) {
+        int flow = i % flows;
+        strandlink_frame_t *f = &c->frames[i];
+        sad_t q;
+        sad_init(&q);
+        sad_add_uint32(&q, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN);
+        sad_add_uint32(&q, SAD_FIELD_MODEL_ARCH,
+                       MODEL_ARCH_TRANSFORMER + (uint32_t)flow % 6);
+        sad_add_uint32(&q, SAD_FIELD_MAX_LATENCY_MS, 20 + (uint32_t)flow / 6);
+
+        memset(&f->header, 0, sizeof(f->header));
+        f->header.version    = 1;
+        f->header.frame_type = STRANDLINK_FRAME_DATA;
+        f->header.ttl        = 16;
+        f->header.src_node_id[0] = 0xA0;
+        f->header.src_node_id[1] = (uint8_t)flow;
+        f->header.stream_id[0]   = (uint8_t)flow;
+        f->header.dst_node_id[0] = 0xAA;    /* not us, no exact entry */
+        f->header.sequence = (uint32_t)rng_next(&s);
+        int n = sad_encode(&q, f->payload, SAD_MAX_SIZE);
+        f->header.options_offset = 0;
+        f->header.options_length = (uint16_t)(n > 0 ? n : 0);
+        f->header.payload_length = (uint16_t)(n > 0 ? n : 0);
+        c->templates[i] = f->header;
+    }
+}
+
+static void body_forward(void *ctx, uint64_t iters)
+{
+    fwd_ctx_t *c = ctx;
+    for (uint64_t i = 0; i < iters; i++) {
+        uint32_t k = (uint32_t)(i % FWD_FRAMES);
+        c->frames[k].header = c->templates[k];
+        forwarding_engine_process_frame(&c->eng, &c->frames[k], 0);
+    }
+}
+
+static void bench_forwarding(void)
+{
+    static const struct {
+        const char *name;
+        int         flows;
+        bool        cache;
+    } k[] = {
+        { "forwarding/process_frame/flows_16/cache",      16,  true  },
+        { "forwarding/process_frame/flows_256/cache",     256, true  },
+        { "forwarding/process_frame/flows_16/no_cache",   16,  false },
+    };
+
+    uint32_t entries = g_opt.smoke ? 1000 : SCALE_ENTRIES;
+    route_entry_t *rows = gen_table(entries, g_opt.seed);
+    if (!rows) return;
+    routing_table_t *rt = gen_routing_table(rows, entries);
+    free(rows);
+    fwd_ctx_t *c = calloc(1, sizeof(*c));
+    if (c) c->frames = malloc(FWD_FRAMES * sizeof(strandlink_frame_t));
+    if (!rt || !c || !c->frames) goto out;
+
+    uint8_t self[STRANDLINK_NODE_ID_LEN] = { 0x55 };
+    for (size_t i = 0; i < sizeof(k) / sizeof(k[0]); i++) {
+        if (!selected(k[i].name)) continue;
+        forwarding_engine_init(&c->eng, self, rt, fwd_send_count, c);
+        if (!k[i].cache)
+            forwarding_engine_set_cache(&c->eng, NULL);
+        gen_frames(c, k[i].flows, g_opt.seed);
+        c->sent = 0;
+
+        bench_timing_t t = bench_time(body_forward, c);
+        forwarding_stats_t st;
+        forwarding_engine_stats(&c->eng, &st);
+        json_begin_result(k[i].name);
+        json_u64("entries", entries);
+        json_u64("flows", (uint64_t)k[i].flows);
+        json_str("resolve_cache", k[i].cache ? "on" : "off");
+        json_timing(&t);
+        json_f64("mpps", t.median_ns > 0 ? 1e3 / t.median_ns : 0);
+        json_f64("forwarded_fraction",
+                 st.frames_forwarded + st.frames_dropped
+                     ? (double)st.frames_forwarded /
+                       (double)(st.frames_forwarded + st.frames_dropped)
+                     : 0);
+        json_end_result();
+        forwarding_engine_destroy(&c->eng);
+    }
+out:
+    if (c) free(c->frames);
+    free(c);
+    routing_table_destroy(rt);
+}
+
+/* --------------------------------------------------------------------------
+ * Checkpoints: save and warm-restart load
+ * -------------------------------------------------------------------------- */
+
+#define CKPT_BENCH_PATH "strandroute_bench_checkpoint.bin"
+
+typedef struct {
+    routing_table_t *rt;
+    uint32_t         entries;
+} ckpt_ctx_t;
+
+static void body_ckpt_save(void *ctx, uint64_t iters)
+{
+    ckpt_ctx_t *c = ctx;
+    for (uint64_t i = 0; i < iters; i++)
+        g_sink += (uint64_t)routing_table_checkpoint_save(c->rt, CKPT_BENCH_PATH, now_ns());
+}
+
+/* Into a fresh table each time, as at startup */
+static void body_ckpt_load(void *ctx, uint64_t iters)
+{
+    (void)ctx;
+    for (uint64_t i = 0; i < iters; i++) {
+        routing_table_t *rt = routing_table_create(0);
+        g_sink += (uint64_t)routing_table_checkpoint_load(rt, CKPT_BENCH_PATH, now_ns());
+        routing_table_destroy(rt);
+    }
+}
+
+static void bench_checkpoint(void)
+{
+    static const uint32_t sizes[] = { 10000, 100000 };
+    size_t num_sizes = g_opt.smoke ? 1 : g_opt.quick ? 1 : 2;
+
+    for (size_t si = 0; si < num_sizes; si++) {
+        char save[64], load[64];
+        uint32_t n = g_opt.smoke ? 1000 : sizes[si];
+        snprintf(save, sizeof(save), "routing_table_checkpoint_save/%u", n);
+        snprintf(load, sizeof(load), "routing_table_checkpoint_load/%u", n);
+        if (!selected(save) && !selected(load)) continue;
+
+        route_entry_t *rows = gen_table(n, g_opt.seed);
+        if (!rows) continue;
+        uint64_t t = now_ns();
+        for (uint32_t i = 0; i < n; i++) {
+            rows[i].last_updated = t;
+            rows[i].ttl_ns       = 3600ull * 1000000000ull;
+        }
+        ckpt_ctx_t c = { gen_routing_table(rows, n), n };
+        free(rows);
+        if (!c.rt) continue;
+        if (routing_table_checkpoint_save(c.rt, CKPT_BENCH_PATH, now_ns()) != (int)n) {
+            routing_table_destroy(c.rt);
+            continue;
+        }
+
+        FILE *f = fopen(CKPT_BENCH_PATH, "rb");
+        long bytes = 0;
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            bytes = ftell(f);
+            fclose(f);
+        }
+        const struct {
+            const char   *name;
+            bench_body_fn fn;
+        } k[] = { { save, body_ckpt_save }, { load, body_ckpt_load } };
+        for (size_t j = 0; j < 2; j++) {
+            if (!selected(k[j].name)) continue;
+            bench_timing_t tm = bench_time(k[j].fn, &c);
+            json_begin_result(k[j].name);
+            json_u64("entries", n);
+            json_u64("file_bytes", (uint64_t)bytes);
+            json_timing(&tm);
+            json_f64("ms_per_op", tm.median_ns / 1e6);
+            json_end_result();
+        }
+        remove(CKPT_BENCH_PATH);
+        routing_table_destroy(c.rt);
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Main
+ * -------------------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+    if (parse_args(argc, argv) != 0)
+        return 2;
+
+    g_out = stdout;
+    if (g_opt.out_path) {
+        g_out = fopen(g_opt.out_path, "w");
+        if (!g_out) {
+            perror(g_opt.out_path);
+            return 1;
+        }
+    }
+
+    time_t wall = time(NULL);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&wall));
+
+    fprintf(g_out, "{\n  \"schema\": 1,\n");
+    fprintf(g_out, "  \"version\": \"%s\",\n", STRANDROUTE_VERSION);
+    fprintf(g_out, "  \"build_type\": \"%s\",\n", STRANDROUTE_BUILD_TYPE);
+    fprintf(g_out, "  \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(g_out, "  \"date\": \"%s\",\n", date);
+    fprintf(g_out, "  \"cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(g_out, "  \"sad_kernel\": \"%s\",\n", sad_kernel_name(sad_kernel_active()));
+    fprintf(g_out, "  \"config\": {\"seed\": %llu, \"min_ms\": %u, \"repeat\": %u, "
+                   "\"max_threads\": %d, \"mode\": \"%s\"},\n",
+            (unsigned long long)g_opt.seed, g_opt.min_ms, g_opt.repeat,
+            g_opt.max_threads,
+            g_opt.smoke ? "smoke" : g_opt.quick ? "quick" : "full");
+    fprintf(g_out, "  \"results\": [");
+
+    bench_sad_codec();
+    bench_find_best();
+    bench_lookup_scaling();
+    bench_maglev();
+    bench_forwarding();
+    bench_checkpoint();
+
+    fprintf(g_out, "\n  ]\n}\n");
+    if (g_out != stdout)
+        fclose(g_out);
+    return 0;
+}
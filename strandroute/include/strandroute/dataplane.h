@@ -0,0 +1,136 @@
+/*
+ * dataplane.h - Multi-queue forwarding runtime
+ *
+ * A pool of worker threads, each owning one RX ring and one TX ring of
+ * StrandLink frames.  Ingress hashes every frame's flow (src_node_id +
+ * stream_id) to a queue RSS-style, so a flow is always handled by the
+ * same worker, in order.  Workers drain their RX ring in bursts through
+ * forwarding_engine_process_burst and write forwarded frames to their TX
+ * ring; the egress side drains the TX rings.  Idle workers spin briefly,
+ * then yield, then sleep with growing intervals.
+ *
+ * RX ring slots hold a strandlink_frame_t image truncated to slot_size:
+ * the 64-byte header followed by payload_length payload bytes.  TX ring
+ * slots hold a dataplane_tx_meta_t naming the egress port the engine
+ * chose, then the frame image.  Every ring is single-producer /
+ * single-consumer: one thread submits to the RX rings and one thread
+ * drains each TX ring.
+ */
+
+#ifndef STRANDROUTE_DATAPLANE_H
+#define STRANDROUTE_DATAPLANE_H
+
+#include "strandroute/types.h"
+#include "strandroute/forwarding.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DATAPLANE_MAX_WORKERS  64
+
+typedef struct {
+    int      num_workers;       /* 0 = 1 */
+    uint32_t rx_ring_slots;     /* power of 2, 0 = 256 */
+    uint32_t tx_ring_slots;     /* power of 2, 0 = 256 */
+    uint32_t slot_size;         /* 0 = sizeof(strandlink_frame_t) */
+    int      burst;             /* frames per poll, 0 = FWD_BURST_MAX */
+
+    bool     pin_cpus;          /* pin worker i to CPU cpu_base + i */
+    int      cpu_base;
+
+    /* Idle backoff: busy polls, then sched_yield()s, then sleeps doubling
+     * from 1 us up to max_sleep_us */
+    uint32_t idle_spins;        /* 0 = 1024 */
+    uint32_t idle_yields;       /* 0 = 64 */
+    uint32_t max_sleep_us;      /* 0 = 1000 */
+
+    /* Frames addressed to this node; NULL drops them */
+    strandlink_recv_fn local_fn;
+    void              *local_ctx;
+} dataplane_config_t;
+
+typedef struct {
+    uint64_t rx_frames;         /* taken off RX rings */
+    uint64_t rx_dropped;        /* RX ring full, or frame too big for a slot */
+    uint64_t tx_frames;         /* committed to TX rings */
+    uint64_t tx_ring_full;      /* forwarded but the TX ring was full */
+    uint64_t local_frames;
+    uint64_t idle_sleeps;
+} dataplane_stats_t;
+
+/* Start of every TX ring slot; the frame image follows at
+ * DATAPLANE_TX_META_SIZE */
+typedef struct {
+    strandlink_port_t port;     /* egress port */
+    uint16_t          reserved[3];
+} dataplane_tx_meta_t;
+
+#define DATAPLANE_TX_META_SIZE  ((uint32_t)sizeof(dataplane_tx_meta_t))
+
+/* Opaque handle */
+typedef struct dataplane dataplane_t;
+
+/**
+ * Create a runtime around @eng (not started).  Installs the engine's
+ * burst send callback, which writes to the calling worker's TX ring.
+ * NULL config selects the defaults.  Returns NULL on invalid
+ * configuration or allocation failure.
+ */
+dataplane_t *dataplane_create(forwarding_engine_t *eng,
+                              const dataplane_config_t *config);
+
+/**
+ * Stop the workers if running and free everything.
+ */
+void dataplane_destroy(dataplane_t *dp);
+
+/**
+ * Start the worker threads.  CPU pinning is best effort.
+ *
+ * @return 0 on success, -1 if already running or a thread failed to start.
+ */
+int dataplane_start(dataplane_t *dp);
+
+/**
+ * Signal the workers to stop and wait for them.  Frames still queued stay
+ * in the rings.
+ */
+void dataplane_stop(dataplane_t *dp);
+
+int dataplane_num_workers(const dataplane_t *dp);
+
+/**
+ * Queue that @frame's flow maps to.
+ */
+int dataplane_queue_for(const dataplane_t *dp, const strandlink_frame_t *frame);
+
+/**
+ * Copy @frame into the RX ring of its flow's queue.  Single producer.
+ *
+ * @return 0 on success, -1 if the ring is full or the frame does not fit
+ *         a slot (counted in rx_dropped).
+ */
+int dataplane_submit(dataplane_t *dp, const strandlink_frame_t *frame);
+
+/**
+ * Rings of worker @worker, for integrators that feed or drain them
+ * directly.  TX slots are slot_size + DATAPLANE_TX_META_SIZE bytes.
+ * NULL if out of range.
+ */
+strandlink_ring_buffer_t *dataplane_rx_ring(dataplane_t *dp, int worker);
+strandlink_ring_buffer_t *dataplane_tx_ring(dataplane_t *dp, int worker);
+
+/**
+ * Sum the workers' counters.  Safe while running.
+ */
+void dataplane_stats(const dataplane_t *dp, dataplane_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_DATAPLANE_H */
@@ -0,0 +1,68 @@
+/*
+ * epoch.h - Epoch-based memory reclamation
+ *
+ * Readers bracket access to shared objects with epoch_enter/epoch_exit,
+ * which only touch a cache-line-private per-thread slot.  Writers unlink
+ * an object, hand it to epoch_retire, and move on; it is freed once every
+ * thread that could still hold a reference has passed through a
+ * quiescent point.  No shared counter is written on the read path and
+ * writers never wait for readers.
+ */
+
+#ifndef STRANDROUTE_EPOCH_H
+#define STRANDROUTE_EPOCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque handle */
+typedef struct epoch_domain epoch_domain_t;
+
+/**
+ * Create a reclamation domain.  Returns NULL on allocation failure.
+ */
+epoch_domain_t *epoch_domain_create(void);
+
+/**
+ * Destroy the domain, freeing every object still awaiting reclamation.
+ * The caller must ensure no thread is inside a read section.
+ */
+void epoch_domain_destroy(epoch_domain_t *d);
+
+/**
+ * Enter a read section.  Sections nest; objects reachable when the
+ * outermost one was entered stay valid until the matching exit.
+ * The calling thread is registered with the domain on first use.
+ *
+ * @return 0 on success, -1 if the thread could not be registered.
+ */
+int epoch_enter(epoch_domain_t *d);
+
+/**
+ * Leave a read section.
+ */
+void epoch_exit(epoch_domain_t *d);
+
+/**
+ * Defer free_fn(ptr) until no reader can still reference @ptr.  The
+ * object must already be unreachable for new readers.  Never blocks on
+ * readers; opportunistically reclaims older objects.
+ */
+void epoch_retire(epoch_domain_t *d, void *ptr, void (*free_fn)(void *));
+
+/**
+ * Free whatever retired objects are safe to free now.
+ *
+ * @return Number of objects still pending.
+ */
+uint32_t epoch_reclaim(epoch_domain_t *d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_EPOCH_H */
@@ -0,0 +1,279 @@
+/*
+ * forwarding.h - Software dataplane forwarding engine
+ *
+ * Receive a StrandLink frame -> extract SAD from options -> resolve via
+ * routing table -> select next hop -> rewrite dst_node_id -> forward via
+ * send callback.  With a node table attached, a frame whose dst_node_id
+ * has an exact entry skips resolution and goes straight to that entry's
+ * port (see node_table.h).
+ *
+ * forwarding_engine_process_frame may be called from any number of
+ * threads at once.  Each calling thread gets its own resolve cache (see
+ * resolve_cache.h) and statistics block on first use, so repeated
+ * descriptors skip the table scan and counting touches no shared cache
+ * line.  Statistics are summed across threads when read.
+ */
+
+#ifndef STRANDROUTE_FORWARDING_H
+#define STRANDROUTE_FORWARDING_H
+
+#include "strandroute/types.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/resolve_cache.h"
+#include "strandroute/node_table.h"
+#include "strandroute/offload.h"
+#include "strandroute/hop_load.h"
+
+#include <stdatomic.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FWD_MAX_NEXT_HOPS 8
+
+/* Frames handled per snapshot pin by forwarding_engine_process_burst */
+#define FWD_BURST_MAX     64
+
+/*
+ * Batched transmit: hand @count frames to @port at once.  Returns how many
+ * were accepted, taken from the front of @frames (the rest count as
+ * dropped), or a negative value if none were.
+ */
+typedef int (*forwarding_send_burst_fn)(strandlink_port_t port,
+                                        strandlink_frame_t *const *frames,
+                                        int count,
+                                        void *ctx);
+
+/* --------------------------------------------------------------------------
+ * Statistics
+ * -------------------------------------------------------------------------- */
+
+typedef enum {
+    FWD_DROP_TTL = 0,       /* TTL expired */
+    FWD_DROP_NO_SAD,        /* no SAD in the options, or malformed */
+    FWD_DROP_NO_MATCH,      /* resolve found no candidate */
+    FWD_DROP_SEND,          /* transmit callback refused the frame */
+    FWD_DROP_REASONS
+} forwarding_drop_reason_t;
+
+/* Counter slots: one per drop reason, then forwarded / resolved / local /
+ * exact */
+#define FWD_STAT_COUNTERS  (FWD_DROP_REASONS + 4)
+
+/*
+ * Log-linear histogram in the style of HdrHistogram: values below
+ * 2^FWD_HIST_SUB_BITS get a bucket each, every power of two above that is
+ * split into 2^FWD_HIST_SUB_BITS equal buckets (relative error under
+ * 1 / 2^FWD_HIST_SUB_BITS over the whole uint64 range).
+ */
+#define FWD_HIST_SUB_BITS  3
+#define FWD_HIST_BUCKETS   ((64 - FWD_HIST_SUB_BITS + 1) << FWD_HIST_SUB_BITS)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[FWD_HIST_BUCKETS];
+} forwarding_histogram_t;
+
+/* Point-in-time totals over every thread, see forwarding_engine_stats() */
+typedef struct {
+    uint64_t frames_forwarded;
+    uint64_t frames_dropped;          /* sum of drops[] */
+    uint64_t frames_resolved;
+    uint64_t resolve_failures;        /* == drops[FWD_DROP_NO_MATCH] */
+    uint64_t frames_local;            /* addressed to this node */
+    uint64_t frames_exact;            /* dst_node_id hit the node table */
+    uint64_t drops[FWD_DROP_REASONS];
+
+    forwarding_histogram_t resolve_ns;  /* per resolve, including cache hits */
+    forwarding_histogram_t candidates;  /* rows scored per resolve, 0 on a hit */
+    forwarding_histogram_t top_k;       /* hits returned per resolve */
+
+    resolve_cache_stats_t  cache;
+} forwarding_stats_t;
+
+/* --------------------------------------------------------------------------
+ * Next-hop selection among the top-K hits
+ * -------------------------------------------------------------------------- */
+
+typedef enum {
+    FWD_SELECT_WEIGHTED_RANDOM = 0,   /* per frame, weighted by match score */
+    FWD_SELECT_MAGLEV,                /* per flow (src_node_id + stream_id)
+                                         through a Maglev table, weighted by
+                                         match score and load_factor */
+    FWD_SELECT_P2C,                   /* per frame, the less loaded of two
+                                         random hits (see
+                                         forwarding_engine_set_hop_load) */
+} forwarding_select_t;
+
+/* Per-thread state, internal to forwarding.c */
+struct fwd_thread;
+
+typedef struct {
+    uint8_t          self_id[STRANDLINK_NODE_ID_LEN];
+    routing_table_t *routing_table;   /* owned externally */
+    strandlink_send_fn  send_fn;
+    void            *send_ctx;
+    forwarding_send_burst_fn send_burst_fn;   /* optional, burst path */
+    void            *send_burst_ctx;
+    int              max_multipath;   /* top-K results to consider */
+    forwarding_select_t select_mode;
+    node_table_t    *node_table;      /* optional, owned externally */
+    offload_t       *offload;         /* optional, owned externally */
+    hop_load_t      *hop_load;        /* optional, owned externally */
+
+    /* Resolve caching */
+    bool                    cache_enabled;
+    resolve_cache_config_t  cache_config;
+    bool                    thread_key_valid;
+    pthread_key_t           thread_key;
+    _Atomic(struct fwd_thread *) threads;   /* registry, lock-free push */
+
+    /* Counters of threads that could not get a per-thread block */
+    _Atomic uint64_t shared_counters[FWD_STAT_COUNTERS];
+} forwarding_engine_t;
+
+/**
+ * Initialize a forwarding engine.  Resolve caching starts enabled with
+ * the default resolve_cache_config_t (exact invalidation).
+ */
+void forwarding_engine_init(forwarding_engine_t *eng,
+                            const uint8_t self_id[STRANDLINK_NODE_ID_LEN],
+                            routing_table_t *rt,
+                            strandlink_send_fn send_fn,
+                            void *send_ctx);
+
+/**
+ * Release the engine's per-thread state.  No thread may be processing
+ * frames.
+ */
+void forwarding_engine_destroy(forwarding_engine_t *eng);
+
+/**
+ * Set the batched transmit callback used by forwarding_engine_process_burst.
+ * Without one, bursts fall back to calling send_fn once per frame.
+ */
+void forwarding_engine_set_burst_send(forwarding_engine_t *eng,
+                                      forwarding_send_burst_fn fn,
+                                      void *ctx);
+
+/**
+ * Choose how the next hop is picked among the resolved candidates.
+ * FWD_SELECT_MAGLEV keeps every frame of a flow on the same hop for as
+ * long as the candidate set and its weights are unchanged, and moves few
+ * flows when they do change.  Must be called before any frame is
+ * processed.
+ */
+void forwarding_engine_set_select(forwarding_engine_t *eng,
+                                  forwarding_select_t mode);
+
+/**
+ * Attach an exact node_id table (NULL detaches).  Frames whose
+ * dst_node_id has an entry are rewritten to the entry's next hop and sent
+ * to its port without SAD resolution; frames without a SAD are forwarded
+ * this way too instead of being dropped.  The table may be edited while
+ * traffic flows.  Must be called before any frame is processed.
+ */
+void forwarding_engine_set_node_table(forwarding_engine_t *eng,
+                                      node_table_t *nt);
+
+/**
+ * Attach a hardware offload manager (NULL detaches).  Every resolved
+ * frame's SAD is offered to offload_record(), which samples it.  Must be
+ * called before any frame is processed.
+ */
+void forwarding_engine_set_offload(forwarding_engine_t *eng, offload_t *o);
+
+/**
+ * Attach a per-next-hop load tracker (NULL detaches).  Every frame sent
+ * is counted out to its new dst_node_id with hop_load_sent(); the caller
+ * counts it back in with hop_load_done() when the response or send
+ * completion arrives.
+ *
+ * FWD_SELECT_P2C uses the tracker to choose among the resolved hits:
+ * it draws two at random and takes the one with the lower expected cost,
+ * (latency + 1) * (outstanding + 1) / (match score * (1 - load_factor)),
+ * where latency is the tracker's average once sampled and the row's
+ * latency_us before, and load_factor is the row's live metric.  Nothing
+ * is published: the choice follows every completion.  Must be called
+ * before any frame is processed.
+ */
+void forwarding_engine_set_hop_load(forwarding_engine_t *eng, hop_load_t *hl);
+
+/**
+ * Configure resolve caching; NULL disables it.  Must be called before
+ * any frame is processed.
+ */
+void forwarding_engine_set_cache(forwarding_engine_t *eng,
+                                 const resolve_cache_config_t *config);
+
+/**
+ * Forward one frame.
+ *
+ * @return 0 on success (or if the frame is for this node), -1 if dropped.
+ */
+int forwarding_engine_process_frame(forwarding_engine_t *eng,
+                                    strandlink_frame_t *frame,
+                                    strandlink_port_t ingress_port);
+
+/**
+ * Forward @count frames as a burst.  Each frame gets the same treatment
+ * as from forwarding_engine_process_frame, but per FWD_BURST_MAX frames
+ * the snapshot is pinned once, frames with byte-identical SADs are
+ * resolved once, and transmission goes through the burst send callback
+ * in one call per egress port.  Frames are rewritten in place; frames addressed to
+ * this node are left untouched and not sent.
+ *
+ * @return Number of frames forwarded, or -1 on invalid arguments.
+ */
+int forwarding_engine_process_burst(forwarding_engine_t *eng,
+                                    strandlink_frame_t **frames,
+                                    int count);
+
+/* --------------------------------------------------------------------------
+ * Statistics
+ * -------------------------------------------------------------------------- */
+
+uint64_t forwarding_engine_frames_forwarded(const forwarding_engine_t *eng);
+uint64_t forwarding_engine_frames_dropped(const forwarding_engine_t *eng);
+
+/**
+ * Sum every thread's counters and histograms into @out.  Reads only
+ * relaxed atomics: never blocks or slows the data path, and may be called
+ * while traffic is flowing (totals are then approximate by the frames in
+ * flight).  forwarding_stats_t is several KB; avoid it on small stacks.
+ */
+void forwarding_engine_stats(const forwarding_engine_t *eng,
+                             forwarding_stats_t *out);
+
+/**
+ * Upper bound of the bucket holding quantile @q (0.0 - 1.0) of @h, or 0
+ * if the histogram is empty.
+ */
+uint64_t forwarding_histogram_quantile(const forwarding_histogram_t *h,
+                                       double q);
+
+/**
+ * Render @stats in the Prometheus text exposition format.
+ *
+ * @return Bytes written (excluding the terminating NUL), or -1 if @buf is
+ *         too small.
+ */
+int forwarding_stats_export(const forwarding_stats_t *stats,
+                            char *buf, size_t buf_len);
+
+/**
+ * Resolve cache counters summed over every thread that has processed
+ * frames.  Safe to call while traffic is flowing.
+ */
+void forwarding_engine_cache_stats(const forwarding_engine_t *eng,
+                                   resolve_cache_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_FORWARDING_H */
@@ -0,0 +1,282 @@
+/*
+ * gossip.h - HyParView membership and capability advertisement
+ *
+ * One gossip_state_t per node.  The caller owns the transport: outgoing
+ * messages are handed to the send callback, incoming ones are passed to
+ * gossip_handle_message(), and gossip_tick() drives shuffles, advertise
+ * rounds, peer liveness and routing-table expiry from the caller's clock.
+ *
+ * Capabilities spread as versioned per-origin route entries: each
+ * advertise round sends every active peer only what changed since it was
+ * last sent, many entries per signed message, and every few rounds one
+ * peer gets a digest (version vector) so it can answer with whatever it
+ * missed.  What is learned goes into the routing table given to
+ * gossip_create(), a whole message per transaction.
+ *
+ * Not thread-safe: one thread drives a state.
+ */
+
+#ifndef STRANDROUTE_GOSSIP_H
+#define STRANDROUTE_GOSSIP_H
+
+#include "strandroute/types.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/routing_shards.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* --------------------------------------------------------------------------
+ * Wire format
+ * -------------------------------------------------------------------------- */
+
+typedef enum {
+    GOSSIP_MSG_JOIN          = 0x01,
+    GOSSIP_MSG_FORWARD_JOIN  = 0x02,
+    GOSSIP_MSG_DISCONNECT    = 0x03,
+    GOSSIP_MSG_SHUFFLE       = 0x04,
+    GOSSIP_MSG_SHUFFLE_REPLY = 0x05,
+    GOSSIP_MSG_ADVERTISE     = 0x06,  /* capability advertisement */
+} gossip_msg_type_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  msg_type;
+    uint8_t  ttl;
+    uint8_t  sender_id[STRANDLINK_NODE_ID_LEN];
+    uint8_t  origin_id[STRANDLINK_NODE_ID_LEN];  /* original initiator */
+    uint16_t payload_len;
+    /* Ed25519 signature over all preceding fields (msg_type..payload_len).
+     * Populated when gossip_set_auth_fn() has been called.
+     * Zero-filled when no signing callback is configured. */
+    uint8_t  signature[64];
+    /* payload follows */
+} gossip_msg_header_t;
+
+/*
+ * Advertise payload (network byte order)
+ *
+ *   u8 kind, u8 flags, u16 count, then
+ *   DELTA:  count entries
+ *   DIGEST: lo_id[16] (exclusive, zero = from the start),
+ *           hi_id[16] (inclusive), count x (origin_id[16], u32 version)
+ *
+ * Entry: origin_id[16], u32 version, u32 latency_us, u32 cost_milli,
+ *        u32 ttl_ms, u16 region_code, u8 trust_level, u16 sad_len,
+ *        sad (sad_encode() form).
+ *
+ * A digest lists every origin the sender knows in (lo_id, hi_id], in
+ * node ID order; large vectors are split over several ranges.  The
+ * signature of an Advertise covers the header prefix followed by the
+ * payload.
+ */
+enum {
+    GOSSIP_ADV_DELTA  = 1,
+    GOSSIP_ADV_DIGEST = 2,
+};
+
+#define GOSSIP_ADV_HDR_LEN     4
+#define GOSSIP_ADV_ENTRY_FIXED (STRANDLINK_NODE_ID_LEN + 4 * 4 + 2 + 1 + 2)
+
+/* --------------------------------------------------------------------------
+ * Lifecycle and callbacks
+ * -------------------------------------------------------------------------- */
+
+/* Opaque handle */
+typedef struct gossip_state gossip_state_t;
+
+/**
+ * Create the state of node @self_id.  What is learned goes into @rt
+ * (owned by the caller, may be NULL).  Returns NULL on allocation failure.
+ */
+gossip_state_t *gossip_create(const uint8_t self_id[STRANDLINK_NODE_ID_LEN],
+                              routing_table_t *rt);
+
+/**
+ * Free the state and everything it holds.
+ */
+void gossip_destroy(gossip_state_t *gs);
+
+/**
+ * Callback that sends @msg_len bytes to @dst_node_id; returns < 0 on
+ * failure.  @msg is only valid during the call.
+ */
+void gossip_set_send_fn(gossip_state_t *gs,
+                        int (*fn)(const uint8_t *dst_node_id, const void *msg,
+                                  size_t msg_len, void *ctx),
+                        void *ctx);
+
+/**
+ * Vectored send callback, taking precedence over the one of
+ * gossip_set_send_fn(): a message goes out as its header and its payload
+ * (@iovcnt 1 or 2), straight from the transmit buffers, which are reused
+ * every round.  NULL goes back to contiguous sends.
+ */
+void gossip_set_sendv_fn(gossip_state_t *gs,
+                         int (*fn)(const uint8_t *dst_node_id,
+                                   const struct iovec *iov, int iovcnt,
+                                   void *ctx),
+                         void *ctx);
+
+/**
+ * Install StrandTrust authentication callbacks (spec NR-G-005).
+ * sign_fn signs outgoing messages, verify_fn checks incoming ones and
+ * returns 0 if the signature is good.  Pass NULL for all to disable.
+ */
+void gossip_set_auth_fn(gossip_state_t *gs,
+                        int (*sign_fn)(const void *msg, size_t msg_len,
+                                       uint8_t sig[64], void *ctx),
+                        int (*verify_fn)(const void *msg, size_t msg_len,
+                                         const uint8_t sig[64], void *ctx),
+                        void *ctx);
+
+/* One signature for a batch verify callback: @sig over @msg_len bytes */
+typedef struct {
+    const void    *msg;
+    size_t         msg_len;
+    const uint8_t *sig;
+} gossip_sig_item_t;
+
+/* Checks @count signatures at once; returns 0 only if every one is good */
+typedef int (*gossip_verify_batch_fn)(const gossip_sig_item_t *items,
+                                      int count, void *ctx);
+
+/**
+ * Batch verify callback, sharing the context of gossip_set_auth_fn();
+ * used for inbound messages instead of verify_fn when set.  A batch that
+ * fails is bisected to find the bad signatures.  NULL goes back to
+ * single checks.
+ */
+void gossip_set_verify_batch_fn(gossip_state_t *gs, gossip_verify_batch_fn fn);
+
+/* Partition key (the tenant, under RT_SHARD_BY_TENANT) of a learned
+ * entry; RT_SHARD_KEY_ANY to not store it here */
+typedef uint32_t (*gossip_shard_key_fn)(const route_entry_t *entry, void *ctx);
+
+/**
+ * Learn entries into sharded tables instead of the routing table: each
+ * delta is staged per shard and published shard by shard, and
+ * gossip_tick() expires every shard.  @key_fn gives each entry its key
+ * from its origin and capabilities; entries it maps to RT_SHARD_KEY_ANY
+ * are still passed on to peers but not stored.  With a NULL @key_fn
+ * every entry is stored under RT_SHARD_KEY_ANY, which suits arch and
+ * region sharding; under RT_SHARD_BY_TENANT those inserts fail.  A NULL
+ * @rs goes back to the table.
+ */
+void gossip_set_routing_shards(gossip_state_t *gs, routing_shards_t *rs,
+                               gossip_shard_key_fn key_fn, void *ctx);
+
+/* --------------------------------------------------------------------------
+ * Membership
+ * -------------------------------------------------------------------------- */
+
+int gossip_handle_join(gossip_state_t *gs,
+                       const uint8_t new_node[STRANDLINK_NODE_ID_LEN],
+                       uint16_t port);
+
+int gossip_handle_forward_join(gossip_state_t *gs,
+                               const uint8_t sender[STRANDLINK_NODE_ID_LEN],
+                               const uint8_t origin[STRANDLINK_NODE_ID_LEN],
+                               uint8_t ttl);
+
+int gossip_handle_disconnect(gossip_state_t *gs,
+                             const uint8_t peer_id[STRANDLINK_NODE_ID_LEN]);
+
+int gossip_do_shuffle(gossip_state_t *gs);
+
+int gossip_handle_shuffle(gossip_state_t *gs,
+                          const uint8_t sender[STRANDLINK_NODE_ID_LEN],
+                          const uint8_t *payload, uint16_t payload_len);
+
+/**
+ * Number of peers in the active view.
+ */
+int gossip_active_count(const gossip_state_t *gs);
+
+/* --------------------------------------------------------------------------
+ * Capability advertisement
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Set what this node advertises about itself: @entry's capabilities and
+ * metrics under our own node ID.  Each call is a new version.
+ *
+ * @return 0 on success, -1 if the SAD does not encode.
+ */
+int gossip_set_local_entry(gossip_state_t *gs, const route_entry_t *entry,
+                           uint64_t now_ms);
+
+/**
+ * One advertise round (gossip_tick() runs them on its own timer).
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int gossip_do_advertise(gossip_state_t *gs, uint64_t now_ms);
+
+/**
+ * Handle an Advertise payload from @sender.  A delta's entries are
+ * applied up to the first one that is truncated; entries with a
+ * malformed SAD are skipped.  An entry's version is recorded only once
+ * its route is committed, so a failed delta is taken again when it is
+ * resent or repaired through a digest.
+ *
+ * @return 0 on success, -1 if the payload is malformed or the routing
+ *         table update failed.
+ */
+int gossip_handle_advertise(gossip_state_t *gs,
+                            const uint8_t sender[STRANDLINK_NODE_ID_LEN],
+                            const uint8_t *payload, uint16_t payload_len);
+
+/**
+ * Version of @origin's entry known here, or 0 if none.
+ */
+uint32_t gossip_origin_version(const gossip_state_t *gs,
+                               const uint8_t origin[STRANDLINK_NODE_ID_LEN]);
+
+/* --------------------------------------------------------------------------
+ * Driving
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Verify and dispatch one incoming message.
+ *
+ * @return 0 on success, -1 if it is malformed, fails verification or is
+ *         refused by its handler.
+ */
+int gossip_handle_message(gossip_state_t *gs, const void *msg, size_t msg_len);
+
+/**
+ * Queue an incoming message for batched verification; @msg is copied.
+ * The queue is flushed when full and on every gossip_tick().  A message
+ * too large to queue, or arriving while no verify callback is set, is
+ * handled at once, after whatever is queued.
+ *
+ * @return 0 if queued, -1 if malformed, otherwise what
+ *         gossip_handle_message() returned for a message handled at once.
+ */
+int gossip_enqueue_message(gossip_state_t *gs, const void *msg, size_t msg_len);
+
+/**
+ * Verify every queued message in one batch, then dispatch the good ones
+ * in arrival order.  Control headers that verified recently are not
+ * checked again.
+ *
+ * @return Number of messages rejected (bad signature, or refused by
+ *         their handler).
+ */
+int gossip_flush_messages(gossip_state_t *gs);
+
+/**
+ * Run the timers due by @now_ms and expire routing-table entries.
+ */
+void gossip_tick(gossip_state_t *gs, uint64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_GOSSIP_H */
@@ -0,0 +1,92 @@
+/*
+ * hop_load.h - Live per-next-hop latency and load
+ *
+ * Feedback from the data path about the nodes frames are handed to: an
+ * exponentially weighted moving average of observed latency and the
+ * number of requests still outstanding, per next-hop node_id.  The
+ * forwarding engine counts a request out when it sends a frame (see
+ * forwarding_engine_set_hop_load()); whoever sees the response or send
+ * completion counts it back in with the latency it observed.
+ *
+ * Unlike the metrics in the routing table, which change only when the
+ * control plane calls routing_table_update_metrics() and take effect
+ * through the snapshot, these change on every sample and are read
+ * directly by next-hop selection (FWD_SELECT_P2C), so a backend that
+ * slows down stops attracting traffic within a few requests.
+ *
+ * Open addressing over a fixed power-of-two array, one cache line per
+ * hop.  Every operation is lock-free: a hop's slot is claimed on its
+ * first use and never moves or goes away, and its counters are updated
+ * with atomic read-modify-writes.
+ */
+
+#ifndef STRANDROUTE_HOP_LOAD_H
+#define STRANDROUTE_HOP_LOAD_H
+
+#include "strandroute/types.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOP_LOAD_DEFAULT_HOPS  4096
+
+/* Weight of a new sample in the average: 1 / 2^HOP_LOAD_EWMA_SHIFT */
+#define HOP_LOAD_EWMA_SHIFT    3
+
+/* latency_us for a completion that carries no latency sample */
+#define HOP_LOAD_NO_SAMPLE     UINT32_MAX
+
+typedef struct {
+    uint32_t ewma_us;          /* average latency, 0 until sampled */
+    uint32_t inflight;         /* requests sent and not yet completed */
+    uint64_t samples;          /* latency samples taken */
+} hop_load_info_t;
+
+/* Opaque handle */
+typedef struct hop_load hop_load_t;
+
+/**
+ * Create a tracker for up to @max_hops next hops (0 = default).  Returns
+ * NULL on allocation failure.
+ */
+hop_load_t *hop_load_create(uint32_t max_hops);
+
+/**
+ * Destroy the tracker.  No other call may be in progress.
+ */
+void hop_load_destroy(hop_load_t *hl);
+
+/**
+ * Count one request to @node_id out.
+ *
+ * @return 0 on success, -1 if @node_id is new and the tracker is full.
+ */
+int hop_load_sent(hop_load_t *hl, const uint8_t node_id[STRANDLINK_NODE_ID_LEN]);
+
+/**
+ * Count one request to @node_id back in, folding @latency_us into the
+ * average unless it is HOP_LOAD_NO_SAMPLE (a cancelled send, say).  The
+ * outstanding count never goes below zero.
+ *
+ * @return 0 on success, -1 if @node_id is new and the tracker is full.
+ */
+int hop_load_done(hop_load_t *hl, const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                  uint32_t latency_us);
+
+/**
+ * Read @node_id's current state.
+ *
+ * @return 0 with @out filled, -1 if nothing was recorded for @node_id.
+ */
+int hop_load_get(const hop_load_t *hl,
+                 const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                 hop_load_info_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_HOP_LOAD_H */
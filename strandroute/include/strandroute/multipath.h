@@ -0,0 +1,154 @@
+/*
+ * multipath.h - Maglev consistent hashing for weighted multipath
+ *
+ * A populated table maps a flow key to one of a set of weighted backends.
+ * The same key always selects the same backend while the set is
+ * unchanged, and adding or removing a backend moves only a small share of
+ * keys.  Lookups are a hash and an array read: no locking, no allocation.
+ *
+ * The table is double-buffered.  maglev_populate builds the new table in
+ * the spare buffer and publishes it with one pointer swap, so
+ * maglev_lookup may run on other threads while it does and always sees
+ * either the old or the new table in full.  Everything else (adding and
+ * removing backends, populate itself, maglev_lookup_node_id) belongs to a
+ * single writer.
+ */
+
+#ifndef STRANDROUTE_MULTIPATH_H
+#define STRANDROUTE_MULTIPATH_H
+
+#include "strandroute/types.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Lookup table sizes -- must be prime, and well above the backend count
+ * (Maglev suggests M > 100 * N) for even shares and low disruption. */
+#define MAGLEV_DEFAULT_TABLE_SIZE  5003
+#define MAGLEV_LARGE_TABLE_SIZE    65537
+#define MAGLEV_MAX_TABLE_SIZE      (1u << 26)
+
+typedef enum {
+    MAGLEV_BACKEND_FREE = 0,    /* slot reusable by maglev_add_backend */
+    MAGLEV_BACKEND_ACTIVE,
+    MAGLEV_BACKEND_REMOVED,     /* removed, still in the published table */
+} maglev_backend_state_t;
+
+typedef struct {
+    uint8_t  node_id[STRANDLINK_NODE_ID_LEN];
+    uint32_t weight;        /* relative weight (higher = more traffic) */
+    uint32_t offset;        /* permutation start, hash1(node_id) % M */
+    uint32_t skip;          /* permutation stride, hash2(node_id) % (M-1) + 1 */
+    uint8_t  state;         /* maglev_backend_state_t */
+} maglev_backend_t;
+
+typedef struct {
+    uint32_t            size;           /* M, prime */
+    _Atomic int32_t    *buf[2];         /* backend index per slot */
+    _Atomic(_Atomic int32_t *) table;   /* published buffer, NULL until built */
+    _Atomic uint32_t    seq;            /* odd while the spare is being written */
+
+    maglev_backend_t   *backends;       /* indexed by backend index */
+    int                 num_slots;      /* backends[] entries used, any state */
+    int                 capacity;
+    int                 num_backends;   /* active */
+
+    uint32_t           *pos;            /* populate scratch, per backend */
+    uint64_t           *credit;
+    bool                dirty;          /* backends changed since populate */
+    uint32_t            last_moved;     /* slots reassigned by last populate */
+} maglev_t;
+
+/**
+ * Smallest prime >= @n, or 0 if it would exceed MAGLEV_MAX_TABLE_SIZE.
+ */
+uint32_t maglev_prime_at_least(uint32_t n);
+
+/**
+ * Initialize an empty table of @table_size slots (0 selects
+ * MAGLEV_DEFAULT_TABLE_SIZE).
+ *
+ * @return 0 on success, -1 if the size is not a prime in range or on
+ *         allocation failure.
+ */
+int maglev_init(maglev_t *m, uint32_t table_size);
+
+/**
+ * Release the table.  No lookup may be running.
+ */
+void maglev_destroy(maglev_t *m);
+
+/**
+ * Add a backend, or update its weight if it is already present; weight 0
+ * counts as 1.  A backend keeps its index until it is removed, and an
+ * index is only handed out again once no published table refers to it.
+ * Takes effect at the next maglev_populate.
+ *
+ * @return The backend's index, or -1 on allocation failure.
+ */
+int maglev_add_backend(maglev_t *m,
+                       const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                       uint32_t weight);
+
+/**
+ * Remove a backend.  Takes effect at the next maglev_populate.
+ *
+ * @return 0 on success, -1 if not found.
+ */
+int maglev_remove_backend(maglev_t *m,
+                          const uint8_t node_id[STRANDLINK_NODE_ID_LEN]);
+
+/**
+ * Index of the active backend @node_id, or -1.
+ */
+int maglev_find_backend(const maglev_t *m,
+                        const uint8_t node_id[STRANDLINK_NODE_ID_LEN]);
+
+/**
+ * Build the lookup table from the current backends and publish it.  Does
+ * not allocate, and returns at once if nothing changed since the last
+ * call.
+ *
+ * @return 0 on success, -1 if there are no backends.
+ */
+int maglev_populate(maglev_t *m);
+
+/**
+ * Select a backend for a flow key (e.g. stream ID, src+dst).  Safe to
+ * call concurrently with maglev_populate.
+ *
+ * @return Backend index, or -1 if no table has been published.
+ */
+int maglev_lookup(const maglev_t *m,
+                  const uint8_t *flow_key, size_t key_len);
+
+/**
+ * Like maglev_lookup(), returning the selected backend's node ID.
+ * Writer side only: backends may move in memory when one is added.
+ *
+ * @return 0 on success, -1 if no table has been published.
+ */
+int maglev_lookup_node_id(const maglev_t *m,
+                          const uint8_t *flow_key, size_t key_len,
+                          uint8_t out_node_id[STRANDLINK_NODE_ID_LEN]);
+
+/**
+ * Fraction of slots (0.0 - 1.0) that changed backend in the last
+ * maglev_populate; 0 after the first one.
+ */
+double maglev_last_disruption(const maglev_t *m);
+
+int      maglev_get_backend_count(const maglev_t *m);
+uint32_t maglev_get_table_size(const maglev_t *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_MULTIPATH_H */
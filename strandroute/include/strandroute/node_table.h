@@ -0,0 +1,92 @@
+/*
+ * node_table.h - Exact node_id forwarding table
+ *
+ * Software counterpart of the node_id_forward table in p4/forwarding.p4:
+ * exact match on a frame's 16-byte dst_node_id, giving the egress port
+ * and the node the frame is handed to.  The forwarding engine consults it
+ * before semantic resolution, so frames of established streams (whose
+ * dst_node_id is already resolved) cost one hash probe instead of a SAD
+ * match.
+ *
+ * Open addressing with linear probing over a fixed power-of-two slot
+ * array.  Each slot is a small seqlock: lookups take no lock and write
+ * nothing, and retry a slot only if a writer was editing it at that
+ * moment.  Writers are serialised by an internal mutex.  Deleted slots
+ * become tombstones that later inserts reuse; slots never move, so a
+ * concurrent lookup never misses an entry that was present throughout.
+ */
+
+#ifndef STRANDROUTE_NODE_TABLE_H
+#define STRANDROUTE_NODE_TABLE_H
+
+#include "strandroute/types.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default entry limit, as the size of node_id_forward in the P4 program */
+#define NODE_TABLE_DEFAULT_ENTRIES  65536
+
+typedef struct {
+    strandlink_port_t port;                          /* egress port */
+    uint8_t           next_hop[STRANDLINK_NODE_ID_LEN];  /* new dst_node_id */
+} node_table_hop_t;
+
+/* Opaque handle */
+typedef struct node_table node_table_t;
+
+/**
+ * Create a table holding up to @max_entries entries (0 = default).  Slots
+ * are allocated up front at no more than half load.  Returns NULL on
+ * allocation failure.
+ */
+node_table_t *node_table_create(uint32_t max_entries);
+
+/**
+ * Destroy the table.  No lookup may be in progress.
+ */
+void node_table_destroy(node_table_t *nt);
+
+/**
+ * Map @node_id to @port and @next_hop, replacing any existing mapping.
+ * NULL @next_hop keeps the frame's dst_node_id unchanged.  The all-zero
+ * node ID cannot be a key.
+ *
+ * @return 0 on success, -1 on invalid arguments or if the table is full.
+ */
+int node_table_insert(node_table_t *nt,
+                      const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                      strandlink_port_t port,
+                      const uint8_t next_hop[STRANDLINK_NODE_ID_LEN]);
+
+/**
+ * Remove the mapping for @node_id.
+ *
+ * @return 0 on success, -1 if not present.
+ */
+int node_table_delete(node_table_t *nt,
+                      const uint8_t node_id[STRANDLINK_NODE_ID_LEN]);
+
+/**
+ * Look @node_id up.  Lock-free; safe from any number of threads while
+ * writers insert and delete.
+ *
+ * @return 0 with @out filled if found, -1 otherwise.
+ */
+int node_table_lookup(const node_table_t *nt,
+                      const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                      node_table_hop_t *out);
+
+/**
+ * Number of live entries.
+ */
+uint32_t node_table_count(const node_table_t *nt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_NODE_TABLE_H */
@@ -0,0 +1,57 @@
+/*
+ * numa.h - NUMA topology helpers
+ *
+ * Just enough topology for node-local replicas: how many nodes the host
+ * has, which one the calling thread runs on, and memory placed on a
+ * node.  Linux only, straight from sysfs and the system calls, so there
+ * is no libnuma dependency; elsewhere the host looks like a single node.
+ */
+
+#ifndef STRANDROUTE_NUMA_H
+#define STRANDROUTE_NUMA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of NUMA nodes (highest online node id + 1).  At least 1.
+ */
+int strand_numa_nodes(void);
+
+/**
+ * Node the calling thread is running on, or its bound node if
+ * strand_numa_bind_thread() set one.  0 when unknown.  Cheap enough for
+ * every read path call (vDSO getcpu), but only stable for pinned threads.
+ */
+int strand_numa_this_node(void);
+
+/**
+ * Bind the calling thread to @node for strand_numa_this_node(), e.g. for
+ * workers placed by something other than CPU affinity.  -1 unbinds.
+ */
+void strand_numa_bind_thread(int node);
+
+/**
+ * Map @len bytes of zeroed, page-aligned memory whose pages are taken
+ * from @node as they are first touched (preferred, so a full node falls
+ * back to the others).  The pages hold nothing else.  Placement is best
+ * effort: with no such node or no kernel support the memory is still
+ * returned.
+ *
+ * @return The memory, or NULL if it cannot be mapped.
+ */
+void *strand_numa_alloc(size_t len, int node);
+
+/**
+ * Unmap memory from strand_numa_alloc(); @len as allocated.
+ */
+void strand_numa_free(void *p, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_NUMA_H */
@@ -0,0 +1,130 @@
+/*
+ * offload.h - Hot-SAD hardware offload
+ *
+ * Keeps the most frequently resolved descriptors installed in the
+ * switch's sad_ternary_match table (p4/sad_lookup.p4), so their frames
+ * are resolved in the TCAM instead of by the software matcher.
+ *
+ * The forwarding path feeds offload_record() with every resolved query.
+ * A fraction of them is counted in a count-min sketch keyed by the
+ * table's match key (model_arch, capability, context_window); keys whose
+ * estimate crosses a threshold become candidates.  offload_refresh(),
+ * called periodically from the control plane, resolves the top
+ * candidates against the routing table, diffs the result against what it
+ * installed last time and writes only the changes: new hot keys are
+ * added, keys whose best node changed are modified, and keys that cooled
+ * down or no longer resolve are evicted.  Counts are halved on every
+ * refresh, so the set follows the traffic.
+ *
+ * The switch sees only the three key fields.  A key is offloaded only
+ * while every sampled descriptor carrying it was byte-identical: two
+ * descriptors that differ elsewhere (latency bound, regions, ...) may
+ * resolve differently, and a key seen with both is left to software.
+ *
+ * The manager owns sad_ternary_match: do not combine it with
+ * p4rt_sync_routing_table(), which would delete the manager's entries.
+ *
+ * offload_record() may be called from any number of threads; refresh
+ * and destroy must not run concurrently with each other.
+ */
+
+#ifndef STRANDROUTE_OFFLOAD_H
+#define STRANDROUTE_OFFLOAD_H
+
+#include "strandroute/p4_runtime.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/sad.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Defaults for zero fields of offload_config_t */
+#define OFFLOAD_DEFAULT_BUDGET        1024   /* a quarter of sad_ternary_match */
+#define OFFLOAD_DEFAULT_SKETCH_WIDTH  4096
+#define OFFLOAD_DEFAULT_SKETCH_DEPTH  4
+#define OFFLOAD_MAX_SKETCH_DEPTH      8
+#define OFFLOAD_DEFAULT_SAMPLE_EVERY  16
+#define OFFLOAD_DEFAULT_MIN_COUNT     8
+
+/* Applies a batch of table operations; p4rt_batch_write() in production */
+typedef int (*offload_write_fn)(p4rt_op_t *ops, size_t count);
+
+typedef struct {
+    uint32_t tcam_budget;     /* entries kept installed */
+    uint32_t candidates;      /* keys tracked (0 = 4 * tcam_budget) */
+    uint32_t sketch_width;    /* counters per row, rounded up to a power of two */
+    uint32_t sketch_depth;    /* rows, at most OFFLOAD_MAX_SKETCH_DEPTH */
+    uint32_t sample_every;    /* count one query in N, per thread */
+    uint32_t min_count;       /* samples (after decay) to be installed */
+    /*
+     * Match the context_window field with a prefix mask covering every
+     * request the chosen node can hold, instead of exactly.  Fewer
+     * entries cover more traffic, but nearby keys get the hot key's node
+     * rather than their own best; exact entries take priority over
+     * widened ones.
+     */
+    bool             widen_context;
+    offload_write_fn write_fn;      /* required */
+} offload_config_t;
+
+typedef struct {
+    uint32_t candidates;      /* keys tracked */
+    uint32_t conflicted;      /* of which seen with differing descriptors */
+    uint32_t installed;       /* entries installed after the refresh */
+    uint32_t added;
+    uint32_t modified;        /* same entry, new node */
+    uint32_t evicted;
+    uint32_t failed;          /* writes that did not apply */
+} offload_stats_t;
+
+/* Opaque handle */
+typedef struct offload offload_t;
+
+/**
+ * Create a manager; zero fields of @cfg take the defaults.  Returns NULL
+ * if @cfg or its write_fn is missing, or on allocation failure.
+ */
+offload_t *offload_create(const offload_config_t *cfg);
+
+/**
+ * Destroy the manager.  Installed entries are left in place; call
+ * offload_clear() first to remove them.
+ */
+void offload_destroy(offload_t *o);
+
+/**
+ * Count one resolution of @query.  Cheap when the query is not sampled
+ * (a thread-local counter) and never blocks: if the candidate set is
+ * being updated by another thread, the sample is dropped.
+ */
+void offload_record(offload_t *o, const sad_view_t *query);
+
+/**
+ * Bring the installed set in line with the current candidates and
+ * @view, then decay all counts.  @stats may be NULL.
+ *
+ * @return 0 if every write applied, the number of failed writes
+ *         otherwise, or -1 on invalid arguments or allocation failure.
+ */
+int offload_refresh(offload_t *o, const routing_table_view_t *view,
+                    offload_stats_t *stats);
+
+/**
+ * Delete every installed entry.  Same returns as offload_refresh().
+ */
+int offload_clear(offload_t *o);
+
+/**
+ * Number of entries currently installed.
+ */
+uint32_t offload_installed(const offload_t *o);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_OFFLOAD_H */
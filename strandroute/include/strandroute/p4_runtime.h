@@ -20,13 +20,25 @@
  *   p4rt_sad_table_add(&sad, node_id);
  *
  *   // Install node_id -> egress port mapping
- *   p4rt_node_forward_add(node_id, 1 /* port */);
+ *   p4rt_node_forward_add(node_id, 1);   // egress port 1
  *
  *   // Tear down
  *   p4rt_close();
  *
+ * Bulk programming goes through p4rt_batch_write(), which pipelines the
+ * Thrift requests of up to P4RT_BATCH_WINDOW operations per round-trip,
+ * or through the background writer (p4rt_async_*), which queues
+ * operations and batches them on its own thread.  p4rt_sync_*() diff a
+ * desired table against what is installed and send only the changes.
+ *
+ * Every installed entry's handle is kept in a local cache keyed by match
+ * key (seeded from the switch at p4rt_init), so deletes and modifies need
+ * no table scan, and re-adding an entry that differs only in its action
+ * data becomes a modify.
+ *
  * Thread safety: all functions acquire an internal mutex; the API is safe
- * to call from multiple threads.
+ * to call from multiple threads.  Batches take the mutex once per window,
+ * so other callers interleave with a long batch.
  */
 
 #ifndef STRANDROUTE_P4_RUNTIME_H
@@ -37,10 +49,14 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stddef.h>
 
 /* Forward declaration: defined in strandroute/include/strandroute/sad.h */
 typedef struct strandroute_sad strandroute_sad_t;
 
+/* Forward declaration: defined in strandroute/include/strandroute/routing_table.h */
+typedef struct rt_snapshot routing_table_view_t;
+
 /* --------------------------------------------------------------------------
  * Return codes
  * -------------------------------------------------------------------------- */
@@ -76,6 +92,15 @@ typedef struct strandroute_sad strandroute_sad_t;
 /** Maximum length of the host string (including NUL terminator). */
 #define P4RT_MAX_HOST_LEN  256
 
+/** Requests kept in flight per batch round-trip. */
+#define P4RT_BATCH_WINDOW  64
+
+/** Default capacity of the background writer's queue. */
+#define P4RT_DEFAULT_QUEUE_DEPTH  4096
+
+/** sad_ternary_match priority of entries that do not set one. */
+#define P4RT_DEFAULT_PRIORITY  10
+
 /* --------------------------------------------------------------------------
  * Lifecycle
  * -------------------------------------------------------------------------- */
@@ -159,10 +184,171 @@ int p4rt_node_forward_add(const uint8_t node_id[16], int egress_port);
  */
 int p4rt_node_forward_delete(const uint8_t node_id[16]);
 
+/* --------------------------------------------------------------------------
+ * Batched writes
+ *
+ * An operation carries the extracted match key rather than a SAD pointer,
+ * so it can be queued and outlive the caller's descriptor.  ADD installs
+ * the entry, or modifies it in place if the key is already installed with
+ * different action data (no request at all if the data is the same).
+ * -------------------------------------------------------------------------- */
+
+typedef enum {
+    P4RT_OP_SAD_ADD = 0,        /* sad_ternary_match: key -> node_id */
+    P4RT_OP_SAD_DELETE,
+    P4RT_OP_NODE_ADD,           /* node_id_forward: node_id -> egress_port */
+    P4RT_OP_NODE_DELETE,
+} p4rt_op_type_t;
+
+typedef enum {
+    P4RT_TABLE_SAD = 0,         /* sad_ternary_match */
+    P4RT_TABLE_NODE_FORWARD,    /* node_id_forward */
+    P4RT_TABLES,
+} p4rt_table_t;
+
+/** TCAM key fields of sad_ternary_match. */
+typedef struct {
+    uint32_t model_arch;
+    uint32_t capability;
+    uint32_t context_window;
+} p4rt_sad_key_t;
+
+/*
+ * A SAD entry is identified by its key, mask and priority, as in the
+ * switch.  An all-zero sad_mask means exact (all-ones) masks and a zero
+ * priority means P4RT_DEFAULT_PRIORITY, so ops that set neither address
+ * the plain exact-value entries.  Key bits outside the mask are ignored.
+ * Higher priorities win where entries overlap.
+ */
+typedef struct {
+    p4rt_op_type_t type;
+    p4rt_sad_key_t sad_key;      /**< SAD ops. */
+    p4rt_sad_key_t sad_mask;     /**< SAD ops: per-field ternary masks. */
+    int            priority;     /**< SAD ops. */
+    uint8_t        node_id[16];  /**< SAD_ADD: resolved node; NODE ops: key. */
+    int            egress_port;  /**< NODE_ADD. */
+    int            result;       /**< Set on completion: P4RT_OK or P4RT_ERR_*. */
+} p4rt_op_t;
+
+/**
+ * p4rt_sad_key_from - Extract the sad_ternary_match key fields of @sad.
+ *
+ * Returns P4RT_OK, or P4RT_ERR_INVAL if either pointer is NULL.
+ */
+int p4rt_sad_key_from(const strandroute_sad_t *sad, p4rt_sad_key_t *key);
+
+/**
+ * p4rt_batch_write - Apply @count operations, in order.
+ *
+ * Requests are pipelined P4RT_BATCH_WINDOW at a time: all of a window's
+ * requests are written before the first reply is read.  Operations on a
+ * key already pending in the window start a new one, so the batch has
+ * the same effect as applying the operations one by one.  Each
+ * operation's result field is set.
+ *
+ * Returns the number of operations that failed (0 if all succeeded),
+ * P4RT_ERR_INVAL on invalid arguments, or P4RT_ERR_CONN if not connected.
+ */
+int p4rt_batch_write(p4rt_op_t *ops, size_t count);
+
+/* --------------------------------------------------------------------------
+ * Background writer
+ *
+ * One thread drains a bounded queue of operations through
+ * p4rt_batch_write() and reports each through its completion callback.
+ * Callbacks run on the writer thread; they may submit more operations
+ * but must not call p4rt_async_flush() or p4rt_async_stop().
+ * -------------------------------------------------------------------------- */
+
+/** Called once per operation with its result field set. */
+typedef void (*p4rt_done_fn)(const p4rt_op_t *op, void *ctx);
+
+/**
+ * p4rt_async_start - Start the writer with room for @queue_depth queued
+ * operations (0 = P4RT_DEFAULT_QUEUE_DEPTH).
+ *
+ * Returns P4RT_OK, P4RT_ERR_GENERIC if already running or the thread
+ * could not be started.
+ */
+int p4rt_async_start(size_t queue_depth);
+
+/**
+ * p4rt_async_submit - Queue a copy of @op.  Never blocks.  @done may be
+ * NULL.
+ *
+ * Returns P4RT_OK, P4RT_ERR_FULL if the queue is full, P4RT_ERR_INVAL if
+ * @op is NULL, or P4RT_ERR_GENERIC if the writer is not running.
+ */
+int p4rt_async_submit(const p4rt_op_t *op, p4rt_done_fn done, void *ctx);
+
+/**
+ * p4rt_async_flush - Wait until every operation submitted so far has
+ * completed.  Returns P4RT_OK, or P4RT_ERR_GENERIC if not running.
+ */
+int p4rt_async_flush(void);
+
+/**
+ * p4rt_async_stop - Complete the queued operations, then stop the writer.
+ * No-op if not running.
+ */
+void p4rt_async_stop(void);
+
+/* --------------------------------------------------------------------------
+ * Diff-based sync
+ *
+ * Reconcile a table with a desired state: entries already installed with
+ * the same action data cost nothing, changed ones are modified in place,
+ * missing ones added and stale ones deleted, all as one batch.  In Thrift
+ * mode the handle cache is first re-read from the switch, so state left
+ * by a previous run (or another controller) is taken into account.
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    uint32_t added;
+    uint32_t modified;
+    uint32_t deleted;
+    uint32_t unchanged;
+    uint32_t failed;
+} p4rt_sync_stats_t;
+
+/** One desired node_id_forward entry. */
+typedef struct {
+    uint8_t node_id[16];
+    int     egress_port;
+} p4rt_node_route_t;
+
+/**
+ * p4rt_sync_routing_table - Make sad_ternary_match hold exactly one entry
+ * per distinct key among the rows of @view, mapping to that row's node_id.
+ * When several rows share a key the first one wins: the TCAM key cannot
+ * tell them apart.
+ *
+ * @stats  May be NULL.
+ *
+ * Returns P4RT_OK if every change was applied, the number of failed
+ * changes otherwise, or P4RT_ERR_* (nothing sent).
+ */
+int p4rt_sync_routing_table(const routing_table_view_t *view,
+                            p4rt_sync_stats_t *stats);
+
+/**
+ * p4rt_sync_node_forward - Make node_id_forward hold exactly @routes
+ * (duplicate node IDs: the first one wins).  Same returns as
+ * p4rt_sync_routing_table().
+ */
+int p4rt_sync_node_forward(const p4rt_node_route_t *routes, size_t count,
+                           p4rt_sync_stats_t *stats);
+
 /* --------------------------------------------------------------------------
  * Diagnostics
  * -------------------------------------------------------------------------- */
 
+/**
+ * p4rt_cached_entries - Number of entries of @table in the handle cache,
+ * i.e. installed as far as this client knows.
+ */
+size_t p4rt_cached_entries(p4rt_table_t table);
+
 /**
  * p4rt_strerror - Return a human-readable string for a P4RT error code.
  *
@@ -0,0 +1,94 @@
+/*
+ * resolve_cache.h - Memoised SAD resolution
+ *
+ * Real traffic carries few distinct descriptors, so most lookups repeat
+ * one made moments earlier against the same snapshot.  The cache maps a
+ * compiled query plus scoring weights to the top-K hits found for it.
+ * Compiled queries are canonical: descriptors that differ only in field
+ * order, duplicate fields or unscored fields share an entry.
+ *
+ * Entries are tied to the snapshot generation they were computed on and
+ * die when the table publishes a new one.  In-place metric updates keep
+ * the generation but invalidate entries too, unless a staleness bound is
+ * configured, in which case a hit may lag the newest metrics by at most
+ * that long.
+ *
+ * A cache is owned by a single thread (no internal locking); give each
+ * worker its own.  Only the statistics may be read from other threads.
+ * Use one cache per routing table.
+ */
+
+#ifndef STRANDROUTE_RESOLVE_CACHE_H
+#define STRANDROUTE_RESOLVE_CACHE_H
+
+#include "strandroute/types.h"
+#include "strandroute/sad_match.h"
+#include "strandroute/routing_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Largest top-K a cache entry holds; larger lookups bypass the cache */
+#define RESOLVE_CACHE_MAX_HITS  8
+
+/* Default number of entries */
+#define RESOLVE_CACHE_DEFAULT_ENTRIES  512
+
+typedef struct {
+    uint32_t entries;         /* rounded up to a power of two, 0 = default */
+    uint64_t metrics_ttl_ns;  /* staleness allowed after a metrics-only
+                                 update, 0 = none (always exact) */
+} resolve_cache_config_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stale_hits;      /* subset of hits served within metrics_ttl_ns */
+} resolve_cache_stats_t;
+
+/* Opaque handle */
+typedef struct resolve_cache resolve_cache_t;
+
+/**
+ * Create a cache.  NULL config selects the defaults.
+ * Returns NULL on allocation failure.
+ */
+resolve_cache_t *resolve_cache_create(const resolve_cache_config_t *config);
+
+/**
+ * Destroy the cache.
+ */
+void resolve_cache_destroy(resolve_cache_t *cache);
+
+/**
+ * Look @query up in a pinned view, serving the hits from the cache when a
+ * valid entry exists and scoring the view (then caching the result)
+ * otherwise.  Same contract as routing_table_view_lookup(); NULL weights
+ * selects scoring_weights_default().
+ *
+ * @return Number of hits written, or -1 on error.
+ */
+int resolve_cache_lookup(resolve_cache_t *cache,
+                         const routing_table_view_t *view,
+                         const sad_query_t *query,
+                         const scoring_weights_t *weights,
+                         sad_hit_t *hits,
+                         int max_hits);
+
+/**
+ * Drop every entry.  Counters are kept.
+ */
+void resolve_cache_clear(resolve_cache_t *cache);
+
+/**
+ * Read the counters.  Safe from any thread.
+ */
+void resolve_cache_stats(const resolve_cache_t *cache,
+                         resolve_cache_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_RESOLVE_CACHE_H */
@@ -0,0 +1,156 @@
+/*
+ * resolver.h - Multi-constraint SAD resolver
+ *
+ * Top-K resolution over a routing table with scoring weights chosen per
+ * query.  Weights come from profiles: named scoring_weights_t sets
+ * registered once (one per tenant, say) and then named by a small id on
+ * every lookup.  Profile RESOLVER_PROFILE_DEFAULT always exists and is
+ * what the calls without a profile argument use.
+ *
+ * All resolution scores the pinned snapshot in place; nothing is copied
+ * out but the winners.  Profiles may be registered and updated while
+ * other threads resolve with them.
+ */
+
+#ifndef STRANDROUTE_RESOLVER_H
+#define STRANDROUTE_RESOLVER_H
+
+#include "strandroute/types.h"
+#include "strandroute/sad.h"
+#include "strandroute/sad_match.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/routing_shards.h"
+#include "strandroute/resolve_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RESOLVER_PROFILE_DEFAULT   0
+#define RESOLVER_MAX_PROFILES      64
+#define RESOLVER_PROFILE_NAME_MAX  32    /* including the terminator */
+
+/* --------------------------------------------------------------------------
+ * Weight profiles
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Register weight profile @name, or update its weights if it exists.
+ * Weights must be non-negative with a positive sum.  The default profile
+ * is named "default".
+ *
+ * @return The profile id, or -1 if the weights or name are invalid or
+ *         RESOLVER_MAX_PROFILES are already registered.
+ */
+int resolver_profile_register(const char *name, const scoring_weights_t *w);
+
+/**
+ * Id of profile @name, or -1 if none is registered.
+ */
+int resolver_profile_find(const char *name);
+
+/**
+ * Read the current weights of @profile.
+ *
+ * @return 0 on success, -1 if no such profile.
+ */
+int resolver_profile_weights(int profile, scoring_weights_t *out);
+
+/**
+ * Set the default profile's weights; invalid weights are ignored.
+ */
+void resolver_set_weights(const scoring_weights_t *w);
+
+/**
+ * Cap the number of results the resolver_resolve* calls return.
+ */
+void resolver_set_top_k(int k);
+
+/* --------------------------------------------------------------------------
+ * Resolution
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Top results for @query under the default profile, best first, at most
+ * the configured top-K.
+ *
+ * @return Number of results, or -1 on error.
+ */
+int resolver_resolve(const routing_table_t *rt, const sad_t *query,
+                     resolve_result_t *results, int max_results);
+
+/**
+ * resolver_resolve under weight profile @profile.
+ *
+ * @return Number of results, or -1 on error or if no such profile.
+ */
+int resolver_resolve_profile(const routing_table_t *rt, const sad_t *query,
+                             int profile, resolve_result_t *results,
+                             int max_results);
+
+/**
+ * Up to @max_results results under explicit @weights (NULL = default
+ * profile).  Not capped by the configured top-K.
+ *
+ * @return Number of results, or -1 on error.
+ */
+int resolver_resolve_with_weights(const routing_table_t *rt,
+                                  const sad_t *query,
+                                  const scoring_weights_t *weights,
+                                  resolve_result_t *results,
+                                  int max_results);
+
+/**
+ * resolver_resolve_profile over sharded tables: only the shard that
+ * partition @key (RT_SHARD_KEY_ANY if none) and the query's constraints
+ * select is scored, or every shard and the results merged.
+ * @return Number of results, or -1 on error or if no such profile.
+ */
+int resolver_resolve_shards(const routing_shards_t *rs, uint32_t key,
+                            const sad_t *query, int profile,
+                            resolve_result_t *results, int max_results);
+
+/**
+ * (row, score) hits in a view the caller pinned, default profile.
+ *
+ * @return Number of hits, or -1 on error.
+ */
+int resolver_resolve_view(const routing_table_view_t *view,
+                          const sad_query_t *query,
+                          sad_hit_t *hits, int max_hits);
+
+/**
+ * resolver_resolve_view for a query still in wire form.
+ */
+int resolver_resolve_sad_view(const routing_table_view_t *view,
+                              const sad_view_t *query,
+                              sad_hit_t *hits, int max_hits);
+
+/**
+ * resolver_resolve_sad_view through @cache (NULL resolves directly),
+ * default profile.
+ */
+int resolver_resolve_cached(resolve_cache_t *cache,
+                            const routing_table_view_t *view,
+                            const sad_view_t *query,
+                            sad_hit_t *hits, int max_hits);
+
+/**
+ * resolver_resolve_cached under weight profile @profile.  The profile's
+ * weights are part of the cache key, so profiles never share entries
+ * unless their weights are equal, and updating a profile retires its
+ * entries.
+ *
+ * @return Number of hits, or -1 on error or if no such profile.
+ */
+int resolver_resolve_cached_profile(resolve_cache_t *cache,
+                                    const routing_table_view_t *view,
+                                    const sad_view_t *query,
+                                    int profile,
+                                    sad_hit_t *hits, int max_hits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_RESOLVER_H */
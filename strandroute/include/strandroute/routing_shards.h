@@ -0,0 +1,233 @@
+/*
+ * routing_shards.h - Routing tables partitioned by tenant, arch or region
+ *
+ * A set of independent routing tables (shards), each with its own
+ * snapshots, write lock and TTL timers, so writers to different shards
+ * never contend and a lookup that names its partition scores only that
+ * shard's entries.  Entries are placed by a shard key:
+ *
+ *   RT_SHARD_BY_TENANT      the key the caller passes with every insert
+ *                           and query (tenants are not part of the SAD);
+ *                           tenant k is shard k, so keys must be below
+ *                           num_shards
+ *   RT_SHARD_BY_MODEL_ARCH  the entry's MODEL_ARCH field (0 if it has
+ *                           none); a query with a MODEL_ARCH constraint
+ *                           goes to that one shard, since no entry of
+ *                           another architecture can match it
+ *   RT_SHARD_BY_REGION      the entry's region_code; queries name their
+ *                           region with the key, since region preference
+ *                           in a SAD is only a scoring hint
+ *
+ * Tenants are never folded together: an insert or query with a tenant
+ * key of num_shards or more fails, so one tenant cannot see another's
+ * routes.  Model architectures and regions are folded, arch or region k
+ * living in shard k % num_shards, which only costs scoring some entries
+ * a constraint or preference then sets apart.
+ *
+ * A query that names no partition fans out to every shard and the
+ * per-shard top-K lists are merged; with fanout_threads the shards are
+ * scored in parallel.  A node lives in one shard at a time: inserting it
+ * where it does not live removes it from its old shard.  A concurrent
+ * lookup may see a moving node in both shards or in neither for the
+ * moment between the two publishes.
+ */
+
+#ifndef STRANDROUTE_ROUTING_SHARDS_H
+#define STRANDROUTE_ROUTING_SHARDS_H
+
+#include "strandroute/types.h"
+#include "strandroute/sad_match.h"
+#include "strandroute/routing_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RT_SHARDS_MAX      64
+
+/* Key of a query that names no partition */
+#define RT_SHARD_KEY_ANY   UINT32_MAX
+
+typedef enum {
+    RT_SHARD_BY_TENANT = 0,
+    RT_SHARD_BY_MODEL_ARCH,
+    RT_SHARD_BY_REGION,
+} rt_shard_by_t;
+
+typedef struct {
+    rt_shard_by_t by;
+    uint32_t      num_shards;         /* 1..RT_SHARDS_MAX */
+    uint32_t      initial_capacity;   /* per shard */
+    int           fanout_threads;     /* workers scoring shards in parallel
+                                         for fan-out queries; 0 = the
+                                         caller scores them all */
+} routing_shards_config_t;
+
+/* Opaque handles */
+typedef struct routing_shards     routing_shards_t;
+typedef struct routing_shards_txn routing_shards_txn_t;
+
+/**
+ * Create the shards and fan-out workers.  Returns NULL if the config is
+ * invalid or on allocation failure.
+ */
+routing_shards_t *routing_shards_create(const routing_shards_config_t *cfg);
+
+/**
+ * Stop the workers and destroy every shard.  The caller must ensure no
+ * readers or writers are active.
+ */
+void routing_shards_destroy(routing_shards_t *rs);
+
+/**
+ * Number of shards.
+ */
+uint32_t routing_shards_count(const routing_shards_t *rs);
+
+/**
+ * Shard @shard's table, for pinned views and per-shard maintenance
+ * (routing_table_gc/expire may run on different shards concurrently).
+ * Insert and remove through routing_shards_* only, so a node is never
+ * left in two shards.  NULL if out of range.
+ */
+routing_table_t *routing_shards_table(routing_shards_t *rs, uint32_t shard);
+
+/**
+ * Shard that @entry belongs in.  @key is the tenant for
+ * RT_SHARD_BY_TENANT and ignored otherwise.
+ *
+ * @return The shard index, or -1 if @key is needed and is not below
+ *         num_shards (RT_SHARD_KEY_ANY included).
+ */
+int routing_shards_shard_of(const routing_shards_t *rs, uint32_t key,
+                            const route_entry_t *entry);
+
+/**
+ * Shard a query with partition @key (RT_SHARD_KEY_ANY if none) and
+ * compiled constraints @query is answered from.  @key is the tenant or
+ * region; under RT_SHARD_BY_MODEL_ARCH it is ignored and the query's
+ * MODEL_ARCH constraint decides.
+ *
+ * @return The shard index, or -1 if the query fans out to all of them or
+ *         names a tenant that does not exist (routing_shards_resolve()
+ *         refuses those).
+ */
+int routing_shards_query_shard(const routing_shards_t *rs, uint32_t key,
+                               const sad_query_t *query);
+
+/**
+ * Insert or update @entry in its shard (see routing_shards_shard_of()),
+ * removing it from any other shard it was in.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int routing_shards_insert(routing_shards_t *rs, uint32_t key,
+                          const route_entry_t *entry);
+
+/**
+ * Remove @node_id from whichever shard holds it.
+ *
+ * @return 0 on success, -1 if not found.
+ */
+int routing_shards_remove(routing_shards_t *rs, const uint8_t node_id[16]);
+
+/**
+ * Update live metrics of @node_id in whichever shard holds it, as
+ * routing_table_update_metrics().
+ *
+ * @return 0 on success, -1 if not found.
+ */
+int routing_shards_update_metrics(routing_shards_t *rs,
+                                  const uint8_t node_id[16],
+                                  uint32_t latency_us,
+                                  float load_factor);
+
+/**
+ * Total number of entries over all shards.
+ */
+uint32_t routing_shards_size(const routing_shards_t *rs);
+
+/**
+ * routing_table_gc() on every shard in turn, holding one shard's write
+ * lock at a time.
+ *
+ * @return Number of entries removed, or -1 on error.
+ */
+int routing_shards_gc(routing_shards_t *rs, uint64_t now_ns);
+
+/**
+ * routing_table_expire() on every shard in turn.
+ *
+ * @return Number of entries removed, or -1 on error.
+ */
+int routing_shards_expire(routing_shards_t *rs, uint64_t now_ns);
+
+/**
+ * Top results for @query, best first, from the shard @key and the
+ * query's constraints select, or merged over all shards.  NULL weights
+ * selects scoring_weights_default().
+ *
+ * @return Number of results written, or -1 on error or if @key names a
+ *         tenant that does not exist.
+ */
+int routing_shards_resolve(const routing_shards_t *rs, uint32_t key,
+                           const sad_t *query,
+                           const scoring_weights_t *weights,
+                           resolve_result_t *results,
+                           int max_results);
+
+/* --------------------------------------------------------------------------
+ * Transactions
+ *
+ * Stage many inserts and removals, then publish them shard by shard on
+ * commit: each shard touched gets one routing table transaction, taken in
+ * shard order and released before the next, so shards other than the one
+ * being published stay open to writers.  Nothing is locked while staging.
+ * When a node is staged more than once, the last operation wins.
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Begin a transaction.  Returns NULL on allocation failure.
+ */
+routing_shards_txn_t *routing_shards_txn_begin(routing_shards_t *rs);
+
+/**
+ * Stage an insert or update, as routing_shards_insert().
+ *
+ * @return 0 on success, -1 on error.
+ */
+int routing_shards_txn_insert(routing_shards_txn_t *txn, uint32_t key,
+                              const route_entry_t *entry);
+
+/**
+ * Stage a removal, as routing_shards_remove().  A node that is not found
+ * at commit is skipped.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int routing_shards_txn_remove(routing_shards_txn_t *txn,
+                              const uint8_t node_id[16]);
+
+/**
+ * Number of operations staged so far.
+ */
+uint32_t routing_shards_txn_staged(const routing_shards_txn_t *txn);
+
+/**
+ * Publish everything staged and free @txn.
+ *
+ * @return 0 on success, -1 if txn is NULL or a shard failed to apply an
+ *         insert or to publish (the other shards are still published).
+ */
+int routing_shards_txn_commit(routing_shards_txn_t *txn);
+
+/**
+ * Discard everything staged and free @txn.
+ */
+void routing_shards_txn_abort(routing_shards_txn_t *txn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_ROUTING_SHARDS_H */
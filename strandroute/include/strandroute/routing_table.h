@@ -10,6 +10,7 @@
 #define STRANDROUTE_ROUTING_TABLE_H
 
 #include "strandroute/types.h"
+#include "strandroute/sad_match.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -34,7 +35,8 @@ void routing_table_destroy(routing_table_t *rt);
  * Insert or update a route entry.
  * If an entry with the same node_id already exists it is replaced.
  *
- * @return 0 on success, -1 on error (table full, allocation failure).
+ * @return 0 on success, -1 on error (allocation failure, or capabilities
+ *         that sad_encode() rejects).
  */
 int routing_table_insert(routing_table_t *rt, const route_entry_t *entry);
 
@@ -60,8 +62,107 @@ int routing_table_lookup(const routing_table_t *rt,
                          resolve_result_t *results,
                          int max_results);
 
+/* --------------------------------------------------------------------------
+ * Pinned views
+ *
+ * A view pins the currently published snapshot so lookups can return row
+ * indices (sad_hit_t) and callers expand only the rows they use.  The
+ * rows stay valid until routing_table_unpin().  A pin is an epoch read
+ * section of the calling thread: unpin from the same thread, and keep pins
+ * short, since snapshots replaced meanwhile are not freed until it ends.
+ * Pins nest, and writers never wait for them.
+ * -------------------------------------------------------------------------- */
+
+typedef struct rt_snapshot routing_table_view_t;
+
+/**
+ * Pin the current snapshot.  Returns NULL only if rt is NULL or the
+ * calling thread could not be registered (allocation failure).
+ */
+const routing_table_view_t *routing_table_pin(const routing_table_t *rt);
+
+/**
+ * Release a view obtained from routing_table_pin().
+ */
+void routing_table_unpin(const routing_table_view_t *view);
+
+/**
+ * Number of rows in a pinned view.
+ */
+uint32_t routing_table_view_count(const routing_table_view_t *view);
+
+/**
+ * Return the entry at row @index of a pinned view, or NULL if out of range.
+ * Rows are stored compactly, so the entry is expanded into a per-thread
+ * slot that the calling thread's next call overwrites; copy it out or use
+ * routing_table_view_read() to keep more than one.
+ */
+const route_entry_t *routing_table_view_entry(const routing_table_view_t *view,
+                                              uint32_t index);
+
+/**
+ * Expand row @index of a pinned view into @out, with its live metrics.
+ *
+ * @return 0 on success, -1 if out of range.
+ */
+int routing_table_view_read(const routing_table_view_t *view, uint32_t index,
+                            route_entry_t *out);
+
+/**
+ * Node ID of row @index of a pinned view, or NULL if out of range.  Valid
+ * while the view is pinned; no expansion.
+ */
+const uint8_t *routing_table_view_node_id(const routing_table_view_t *view,
+                                          uint32_t index);
+
+/**
+ * Row of @node_id in a pinned view, or -1 if it has none.
+ */
+int routing_table_view_find(const routing_table_view_t *view,
+                            const uint8_t node_id[16]);
+
+/**
+ * Generation of a pinned view: distinct for every snapshot a table
+ * publishes, and increasing, so rows and hits computed against one
+ * generation stay meaningful for as long as it is current.
+ */
+uint64_t routing_table_view_generation(const routing_table_view_t *view);
+
+/**
+ * Number of in-place metric updates applied to the view so far.  A lookup
+ * that read the version before scoring is still exact while the version
+ * is unchanged.
+ */
+uint64_t routing_table_view_metrics_version(const routing_table_view_t *view);
+
+/**
+ * Read the live metrics of row @index of a pinned view.  Either output
+ * pointer may be NULL.
+ *
+ * @return 0 on success, -1 if out of range.
+ */
+int routing_table_view_metrics(const routing_table_view_t *view,
+                               uint32_t index,
+                               uint32_t *latency_us,
+                               float *load_factor);
+
+/**
+ * Score a pinned view against a compiled query and write the top hits,
+ * best first.  NULL weights selects scoring_weights_default().
+ *
+ * @return Number of hits written, or -1 on error.
+ */
+int routing_table_view_lookup(const routing_table_view_t *view,
+                              const sad_query_t *query,
+                              const scoring_weights_t *weights,
+                              sad_hit_t *hits,
+                              int max_hits);
+
 /**
  * Update live metrics for an existing entry (latency, load).
+ * Metrics are stored in place in the published snapshot: O(1), no copy
+ * and no wait for readers.  Concurrent lookups see the old or the new
+ * value.
  *
  * @return 0 on success, -1 if not found.
  */
@@ -75,6 +176,13 @@ int routing_table_update_metrics(routing_table_t *rt,
  */
 uint32_t routing_table_size(const routing_table_t *rt);
 
+/**
+ * Number of distinct capability descriptors held for the table's current
+ * and not yet reclaimed snapshots.  Entries advertising identical
+ * capabilities share one.
+ */
+uint32_t routing_table_descriptor_count(const routing_table_t *rt);
+
 /**
  * Get a snapshot of all entries (copies them into out, up to max).
  * Returns the number of entries copied.
@@ -88,7 +196,8 @@ int routing_table_snapshot(const routing_table_t *rt,
  * (now_ns - last_updated) > ttl_ns.
  *
  * Entries with ttl_ns == 0 are considered permanent and are never removed.
- * Should be called periodically (e.g., from gossip_tick).
+ * Scans every entry; routing_table_expire() does the same work in time
+ * proportional to what expires.
  *
  * @param rt     Routing table.
  * @param now_ns Current monotonic time in nanoseconds.
@@ -96,6 +205,150 @@ int routing_table_snapshot(const routing_table_t *rt,
  */
 int routing_table_gc(routing_table_t *rt, uint64_t now_ns);
 
+/**
+ * TTL expiry driven by timers: every insert with a non-zero ttl_ns arms a
+ * timer at its deadline, and only the timers due by @now_ns are looked
+ * at, so the cost is O(expired) plus at most one wheel slot per elapsed
+ * millisecond rather than O(N).  Everything that expired is removed in one publish;
+ * nothing is published when nothing did.  Same result as
+ * routing_table_gc(); meant to be called on every tick (gossip_tick does).
+ *
+ * @return Number of expired entries removed, or -1 on error.
+ */
+int routing_table_expire(routing_table_t *rt, uint64_t now_ns);
+
+/* --------------------------------------------------------------------------
+ * NUMA replicas
+ *
+ * On multi-socket hosts every lookup that scans a snapshot allocated on
+ * the other socket pays remote-memory latency.  With replicas enabled,
+ * each publish also makes one read-only copy of the snapshot per NUMA
+ * node with its arrays moved onto that node, and lookups, views and
+ * snapshots read the copy of the node the calling thread runs on
+ * (strand_numa_this_node(), so pin readers).  Metrics updates are
+ * stored into every copy.  Each publish costs one extra copy per node.
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Publish @replicas copies of every snapshot from now on: -1 for one per
+ * NUMA node of the host, 0 or 1 to go back to a single copy.  Threads on
+ * node N read copy N modulo the count.  The current snapshot is
+ * republished at once.
+ *
+ * @return Number of copies now published (1 = replication off), or -1 on
+ *         allocation failure (the setting is unchanged).
+ */
+int routing_table_set_replicas(routing_table_t *rt, int replicas);
+
+/* --------------------------------------------------------------------------
+ * Checkpoints
+ *
+ * A checkpoint is the published snapshot as one flat, host-order file: a
+ * 64-byte header, one fixed-size record per entry carrying its metrics,
+ * TTL and pre-decoded matcher columns, then the entries' encoded SADs.
+ * A CRC-32C (strandlink_crc32c) covers everything after the checksum
+ * itself.  Loading maps the file and fills a snapshot straight from the
+ * records in one publish, so a restarted router forwards on its last
+ * known routes within milliseconds while gossip reconverges.
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Write the current snapshot to @path, atomically replacing any previous
+ * checkpoint (written to "<path>.tmp", fsync'd, then renamed).  @now_ns
+ * is the clock last_updated is measured on; it is recorded so the load
+ * can age entries across the restart.  Readers and writers are not
+ * blocked.
+ *
+ * @return Number of entries written, or -1 on error (errno set).
+ */
+int routing_table_checkpoint_save(const routing_table_t *rt,
+                                  const char *path, uint64_t now_ns);
+
+/**
+ * Load the checkpoint at @path into @rt.  Each entry is aged by the time
+ * that passed since it was saved (wall clock, so across reboots too) and
+ * rebased onto @now_ns; entries whose TTL has run out are skipped, and
+ * entries already in @rt are kept as they are, since anything learned
+ * since startup is fresher.  Nothing is changed unless the whole file
+ * verifies.
+ *
+ * @return Number of entries added, or -1 if the file is missing, of
+ *         another version or layout, truncated or fails its checksum.
+ */
+int routing_table_checkpoint_load(routing_table_t *rt,
+                                  const char *path, uint64_t now_ns);
+
+/* --------------------------------------------------------------------------
+ * Transactions
+ *
+ * Batch many writes into one publish: the write lock is taken once at
+ * begin, changes are staged into a single private copy of the table, and
+ * commit publishes it with one grace period.  Use this for gossip bursts,
+ * GC sweeps and streamed syncs instead of N single-operation calls.
+ *
+ * Lookups keep seeing the previously published table until commit.  Other
+ * writers block until the transaction ends, so do not hold one across
+ * blocking I/O.
+ * -------------------------------------------------------------------------- */
+
+typedef struct routing_table_txn routing_table_txn_t;
+
+/**
+ * Begin a transaction (takes the write lock).
+ * Returns NULL on allocation failure.
+ */
+routing_table_txn_t *routing_table_txn_begin(routing_table_t *rt);
+
+/**
+ * Stage an insert or update, as routing_table_insert().
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int routing_table_txn_insert(routing_table_txn_t *txn, const route_entry_t *entry);
+
+/**
+ * Stage a removal, as routing_table_remove().
+ *
+ * @return 0 on success, -1 if not found.
+ */
+int routing_table_txn_remove(routing_table_txn_t *txn, const uint8_t node_id[16]);
+
+/**
+ * Stage a metrics update, as routing_table_update_metrics().  Applied in
+ * place immediately if nothing structural has been staged yet.
+ *
+ * @return 0 on success, -1 if not found.
+ */
+int routing_table_txn_update_metrics(routing_table_txn_t *txn,
+                                     const uint8_t node_id[16],
+                                     uint32_t latency_us,
+                                     float load_factor);
+
+/**
+ * Stage a TTL sweep, as routing_table_gc().
+ *
+ * @return Number of entries expired, or -1 on error.
+ */
+int routing_table_txn_gc(routing_table_txn_t *txn, uint64_t now_ns);
+
+/**
+ * Number of operations staged so far.
+ */
+uint32_t routing_table_txn_staged(const routing_table_txn_t *txn);
+
+/**
+ * Publish everything staged, release the lock and free @txn.
+ *
+ * @return 0 on success, -1 if txn is NULL.
+ */
+int routing_table_txn_commit(routing_table_txn_t *txn);
+
+/**
+ * Discard everything staged (metric updates already stored in place
+ * stay), release the lock and free @txn.
+ */
+void routing_table_txn_abort(routing_table_txn_t *txn);
+
 #ifdef __cplusplus
 }
 #endif
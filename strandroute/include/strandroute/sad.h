@@ -4,6 +4,13 @@
  * Provides encoding, decoding, and validation of SAD binary format.
  * Binary TLV format: version(1B), flags(1B), num_fields(2B),
  * then TLV fields each with type(1B), length(2B), value(variable).
+ *
+ * Every SAD also has a canonical 64-bit hash that does not depend on the
+ * order of its fields (the order of bytes within a value still counts),
+ * so it can key caches, offload entries and flows however the sender
+ * arranged the descriptor.  sad_hash(), sad_view_hash() and the hash
+ * the encoders and sad_decode_validated() return give the same value
+ * for the same SAD.
  */
 
 #ifndef STRANDROUTE_SAD_H
@@ -87,10 +94,33 @@ uint8_t sad_get_uint8(const sad_t *sad, sad_field_type_t type);
  * @param sad     The SAD to encode.
  * @param buf     Output buffer (must be at least SAD_MAX_SIZE bytes).
  * @param buf_len Size of output buffer.
- * @return        Number of bytes written, or -1 on error.
+ * @return        Number of bytes written, or -1 on error (the buffer may
+ *                then hold part of the encoding).
  */
 int sad_encode(const sad_t *sad, uint8_t *buf, size_t buf_len);
 
+/* Largest SAD a frame option can carry: its length field is one byte */
+#define SAD_OPT_MAX_LEN  254
+
+/**
+ * Encode @sad as a STRANDLINK_OPT_SEMANTIC_ADDR option straight into a
+ * frame's options section at @opts, with the canonical hash in *@hash
+ * when non-NULL.
+ *
+ * @return Bytes written (option header included), or -1 if the option
+ *         does not fit in @opts_len or the SAD is over SAD_OPT_MAX_LEN.
+ */
+int sad_encode_option(const sad_t *sad, uint8_t *opts, size_t opts_len,
+                      uint64_t *hash);
+
+/**
+ * Find the STRANDLINK_OPT_SEMANTIC_ADDR option in a frame's options
+ * section.  Returns the encoded SAD in place (with *sad_len set when
+ * non-NULL), or NULL if absent or the options are truncated before it.
+ */
+const uint8_t *sad_option_find(const uint8_t *opts, size_t opts_len,
+                               uint16_t *sad_len);
+
 /**
  * Decode binary buffer into a sad_t.
  *
@@ -110,6 +140,95 @@ int sad_decode(const uint8_t *buf, size_t buf_len, sad_t *sad);
  */
 int sad_validate(const uint8_t *buf, size_t buf_len);
 
+/**
+ * sad_validate and sad_decode in one pass: accepts exactly the buffers
+ * sad_validate accepts, and fills *@hash with the canonical hash when
+ * non-NULL.
+ *
+ * @return Number of bytes consumed, or -1 on error.
+ */
+int sad_decode_validated(const uint8_t *buf, size_t buf_len, sad_t *sad,
+                         uint64_t *hash);
+
+/* One encoded SAD among many, e.g. in a gossip advertisement */
+typedef struct {
+    const uint8_t *buf;
+    uint16_t       len;
+} sad_span_t;
+
+/**
+ * sad_decode_validated over @count spans, each of which must hold exactly
+ * one SAD.  @out[i] receives span i; a span that fails leaves @out[i]
+ * empty with total_length 0 (and @hashes[i] 0).  @hashes may be NULL.
+ *
+ * @return Number of spans decoded, or -1 on invalid arguments.
+ */
+int sad_decode_batch(const sad_span_t *in, int count, sad_t *const *out,
+                     uint64_t *hashes);
+
+/**
+ * Canonical hash of @sad.
+ */
+uint64_t sad_hash(const sad_t *sad);
+
+/* --------------------------------------------------------------------------
+ * Zero-copy SAD View
+ *
+ * A read-only view over an encoded SAD, validated in place.  Field values
+ * are never copied: accessors return pointers into the caller's buffer,
+ * which must outlive the view.  Suited to per-frame parsing where
+ * building a full sad_t would dominate the cost.
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    const uint8_t *buf;                       /* start of the encoded SAD */
+    uint16_t       length;                    /* bytes covered (header + fields) */
+    uint8_t        version;
+    uint8_t        flags;
+    uint16_t       num_fields;
+    uint16_t       field_off[SAD_MAX_FIELDS]; /* offset of each field's TLV header */
+} sad_view_t;
+
+/**
+ * Validate an encoded SAD in place and index its fields.
+ * Accepts exactly the buffers sad_decode() accepts.
+ *
+ * @param view    Output view.
+ * @param buf     Input buffer containing encoded SAD.
+ * @param buf_len Length of input data.
+ * @return        Number of bytes covered, or -1 on error.
+ */
+int sad_view_init(sad_view_t *view, const uint8_t *buf, size_t buf_len);
+
+/**
+ * Return field @index of the view: its value in place, with *type and
+ * *length filled in.  Returns NULL if @index is out of range.
+ */
+const uint8_t *sad_view_field(const sad_view_t *view, uint16_t index,
+                              sad_field_type_t *type, uint16_t *length);
+
+/**
+ * Find the first field of @type. Returns its value in place (with *length
+ * set when non-NULL) or NULL if not found.
+ */
+const uint8_t *sad_view_find_field(const sad_view_t *view,
+                                   sad_field_type_t type, uint16_t *length);
+
+/**
+ * Extract a uint32 value from a field. Returns 0 if field is not found.
+ */
+uint32_t sad_view_get_uint32(const sad_view_t *view, sad_field_type_t type);
+
+/**
+ * Extract a uint8 value from a field. Returns 0 if field is not found.
+ */
+uint8_t sad_view_get_uint8(const sad_view_t *view, sad_field_type_t type);
+
+/**
+ * Canonical hash of the viewed SAD, equal to sad_hash() of its decode.
+ */
+uint64_t sad_view_hash(const sad_view_t *view);
+
 #ifdef __cplusplus
 }
 #endif
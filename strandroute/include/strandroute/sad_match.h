@@ -0,0 +1,279 @@
+/*
+ * sad_match.h - SAD matching engine API
+ *
+ * Scores candidate route entries against a SAD query using the weighted
+ * multi-constraint function from the StrandRoute spec (Section 4.3).
+ *
+ * Two ways to drive the matcher:
+ *   - sad_match_score / sad_find_best take a raw sad_t query and an
+ *     array of route_entry_t (convenient, used by tests and tooling).
+ *   - sad_query_compile decodes a query's constraints once; the compiled
+ *     query is then scored against a columnar (structure-of-arrays) view
+ *     of a routing table snapshot, touching only the scored fields.
+ *     sad_query_compile_view does the same straight from wire bytes.
+ */
+
+#ifndef STRANDROUTE_SAD_MATCH_H
+#define STRANDROUTE_SAD_MATCH_H
+
+#include "strandroute/types.h"
+#include "strandroute/sad.h"
+
+#ifdef __cplusplus
+#include <atomic>
+#else
+#include <stdatomic.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* --------------------------------------------------------------------------
+ * Compiled query
+ * -------------------------------------------------------------------------- */
+
+/* Maximum region codes held per REGION_PREFER / REGION_EXCLUDE list */
+#define SAD_QUERY_MAX_REGIONS  (SAD_MAX_FIELD_VALUE / 2)
+
+/* Bits in sad_query_t.present: which constraints the query carries */
+#define SAD_Q_MODEL_ARCH      (1u << 0)
+#define SAD_Q_CAPABILITY      (1u << 1)
+#define SAD_Q_CONTEXT_WINDOW  (1u << 2)
+#define SAD_Q_MAX_LATENCY     (1u << 3)
+#define SAD_Q_MAX_COST        (1u << 4)
+#define SAD_Q_TRUST_LEVEL     (1u << 5)
+#define SAD_Q_REGION_PREFER   (1u << 6)
+#define SAD_Q_REGION_EXCLUDE  (1u << 7)
+
+/*
+ * A SAD query with its constraints decoded into fixed slots.  Only the
+ * first field of each type is honoured, matching sad_find_field().
+ */
+typedef struct {
+    uint32_t present;          /* SAD_Q_* bits */
+    bool     wildcard;         /* zero-field query: everything scores 1.0 */
+    uint32_t model_arch;
+    uint32_t capability;       /* non-zero when SAD_Q_CAPABILITY is set */
+    uint32_t context_window;
+    uint32_t max_latency_ms;
+    uint32_t max_cost_milli;
+    uint8_t  trust_level;
+    uint8_t  num_prefer;
+    uint8_t  num_exclude;
+    float    cap_popcount_f;   /* popcount(capability), as float */
+    float    max_latency_f;    /* (float)max_latency_ms */
+    float    max_cost_f;       /* (float)max_cost_milli */
+    uint16_t region_prefer[SAD_QUERY_MAX_REGIONS];
+    uint16_t region_exclude[SAD_QUERY_MAX_REGIONS];
+} sad_query_t;
+
+/**
+ * Decode the scoring constraints of @query into @out.
+ */
+void sad_query_compile(const sad_t *query, sad_query_t *out);
+
+/**
+ * Decode the scoring constraints of an encoded query in place.  Produces
+ * exactly what sad_query_compile() gives for the sad_decode() of the same
+ * bytes, without materialising a sad_t.
+ */
+void sad_query_compile_view(const sad_view_t *view, sad_query_t *out);
+
+/* --------------------------------------------------------------------------
+ * Columnar candidate view
+ * -------------------------------------------------------------------------- */
+
+/* Bits in sad_columns_t.has: which candidate SAD fields were advertised */
+#define SAD_COL_HAS_MODEL_ARCH      (1u << 0)
+#define SAD_COL_HAS_CAPABILITY      (1u << 1)
+#define SAD_COL_HAS_CONTEXT_WINDOW  (1u << 2)
+
+/* A latency cell; std::atomic<uint32_t> has the same layout for C++
+ * embedders, which have no _Atomic */
+#ifdef __cplusplus
+typedef std::atomic<uint32_t> sad_atomic_u32_t;
+#else
+typedef _Atomic uint32_t      sad_atomic_u32_t;
+#endif
+
+/*
+ * Parallel arrays, one element per candidate row.  The routing table
+ * snapshot maintains these alongside its route_entry_t array.  Latency
+ * is updated in place while readers score, so it is read with relaxed
+ * atomic loads.
+ */
+typedef struct {
+    const uint32_t *model_arch;
+    const uint32_t *capability;      /* 0 when not advertised */
+    const uint32_t *context_window;
+    const sad_atomic_u32_t *latency_us;
+    const uint32_t *cost_milli;
+    const uint8_t  *trust_level;
+    const uint16_t *region_code;
+    const uint8_t  *has;             /* SAD_COL_HAS_* bits */
+    uint32_t        count;
+} sad_columns_t;
+
+/* --------------------------------------------------------------------------
+ * Scoring
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Score @candidate against @query.  Returns [0.0, 1.0], or a negative value
+ * if a hard constraint disqualifies the candidate.  NULL weights selects
+ * scoring_weights_default().
+ */
+float sad_match_score(const sad_t *query, const route_entry_t *candidate,
+                      const scoring_weights_t *weights);
+
+/**
+ * Score row @row of @cols against a compiled query.  Same result as
+ * sad_match_score() on the entry the row was built from.
+ */
+float sad_query_score(const sad_query_t *q, const sad_columns_t *cols,
+                      uint32_t row, const scoring_weights_t *weights);
+
+/**
+ * Find the top-K matches in a flat array of entries, sorted by score
+ * descending.  Returns the number of results written (up to top_k).
+ */
+int sad_find_best(const sad_t *query, const route_entry_t *table,
+                  int table_size, const scoring_weights_t *weights,
+                  int top_k, resolve_result_t *results);
+
+/* --------------------------------------------------------------------------
+ * Secondary indexes over a columnar view
+ *
+ * Built by the owner of the columns (the routing table, once per published
+ * snapshot).  Posting lists hold (key, row) pairs sorted by key then row.
+ * -------------------------------------------------------------------------- */
+
+/* Capability bits covered by sad_index_t.cap_bits (one bitset per bit) */
+#define SAD_INDEX_CAP_BITS  32
+
+typedef struct {
+    const uint64_t *cap_bits;    /* [SAD_INDEX_CAP_BITS][words] row bitsets */
+    uint32_t        words;       /* 64-bit words per bitset */
+    const uint32_t *arch_key;    /* rows advertising MODEL_ARCH */
+    const uint32_t *arch_row;
+    uint32_t        num_arch;
+    const uint32_t *ctx_key;     /* rows advertising CONTEXT_WINDOW */
+    const uint32_t *ctx_row;
+    uint32_t        num_ctx;
+    const uint8_t  *trust_key;   /* every row */
+    const uint32_t *trust_row;
+    uint32_t        num_trust;
+} sad_index_t;
+
+/**
+ * Columnar variant of sad_find_best: scores @cols with a compiled query
+ * and copies the winners out of @entries (row-aligned with @cols).
+ * @idx may be NULL; when given, the search goes through
+ * sad_find_best_indexed().
+ */
+int sad_find_best_columns(const sad_query_t *q, const sad_columns_t *cols,
+                          const sad_index_t *idx,
+                          const route_entry_t *entries,
+                          const scoring_weights_t *weights,
+                          int top_k, resolve_result_t *results);
+
+/* A top-K result by reference: row index into the scored columns */
+typedef struct {
+    uint32_t index;
+    float    score;
+} sad_hit_t;
+
+/**
+ * Like sad_find_best_columns but returns (row, score) pairs instead of
+ * copying route entries.  Same order: score descending, and the lower
+ * row wins among equal scores.  Returns the number of hits written.
+ */
+int sad_find_best_hits(const sad_query_t *q, const sad_columns_t *cols,
+                       const scoring_weights_t *weights,
+                       int top_k, sad_hit_t *hits);
+
+/**
+ * Same result as sad_find_best_hits, using @idx to avoid scoring rows
+ * that cannot qualify or cannot reach the top K:
+ *   - the smallest posting list among the query's hard constraints
+ *     (model arch, context window, trust) is scanned instead of the
+ *     whole table when it is selective enough;
+ *   - rows carrying every queried capability bit are scored first, and
+ *     the remaining rows are skipped once their best possible score is
+ *     strictly below the current K-th hit (only when all weights are
+ *     finite and non-negative).
+ */
+int sad_find_best_indexed(const sad_query_t *q, const sad_columns_t *cols,
+                          const sad_index_t *idx,
+                          const scoring_weights_t *weights,
+                          int top_k, sad_hit_t *hits);
+
+/**
+ * Running count of candidate rows the calling thread has scored in
+ * sad_find_best_hits / sad_find_best_indexed.  Sample it around a lookup
+ * to learn how many candidates that lookup examined.
+ */
+uint64_t sad_match_rows_scored(void);
+
+/* --------------------------------------------------------------------------
+ * Batch scoring kernels
+ *
+ * Score a run of column rows at once.  Disqualified rows are written as
+ * -1.0f; all other rows get exactly the value sad_query_score() returns
+ * (the vector kernels are bit-exact with the scalar path).  The active
+ * kernel is picked at first use from the CPU's feature set.
+ * -------------------------------------------------------------------------- */
+
+typedef enum {
+    SAD_KERNEL_AUTO   = 0,   /* best available on this CPU */
+    SAD_KERNEL_SCALAR = 1,
+    SAD_KERNEL_AVX2   = 2,   /* x86-64, 8 rows per step */
+    SAD_KERNEL_AVX512 = 3,   /* x86-64 AVX-512F, 16 rows per step */
+    SAD_KERNEL_NEON   = 4,   /* AArch64, 4 rows per step */
+} sad_kernel_t;
+
+/**
+ * Score rows [start, start + n) of @cols into scores[0 .. n-1] using the
+ * active kernel.
+ */
+void sad_score_batch(const sad_query_t *q, const sad_columns_t *cols,
+                     uint32_t start, uint32_t n,
+                     const scoring_weights_t *weights, float *scores);
+
+/**
+ * Same as sad_score_batch but with an explicit kernel.
+ * Returns 0 on success, -1 if the kernel is not available on this CPU.
+ */
+int sad_score_batch_kernel(sad_kernel_t kernel,
+                           const sad_query_t *q, const sad_columns_t *cols,
+                           uint32_t start, uint32_t n,
+                           const scoring_weights_t *weights, float *scores);
+
+/**
+ * Return true if @kernel can run on this CPU (SAD_KERNEL_AUTO and
+ * SAD_KERNEL_SCALAR always can).
+ */
+bool sad_kernel_available(sad_kernel_t kernel);
+
+/**
+ * Force the kernel used by sad_score_batch (SAD_KERNEL_AUTO re-detects).
+ * Returns 0 on success, -1 if the kernel is not available.
+ */
+int sad_kernel_set(sad_kernel_t kernel);
+
+/**
+ * Return the kernel sad_score_batch currently uses (never SAD_KERNEL_AUTO).
+ */
+sad_kernel_t sad_kernel_active(void);
+
+/**
+ * Return a short static name for @kernel ("scalar", "avx2", ...).
+ */
+const char *sad_kernel_name(sad_kernel_t kernel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_SAD_MATCH_H */
@@ -49,8 +49,13 @@ typedef struct __attribute__((packed)) {
     /* Total: 64 bytes */
 } strandlink_frame_header_t;
 
+#ifdef __cplusplus
+static_assert(sizeof(strandlink_frame_header_t) == 64,
+              "StrandLink frame header must be exactly 64 bytes");
+#else
 _Static_assert(sizeof(strandlink_frame_header_t) == 64,
                "StrandLink frame header must be exactly 64 bytes");
+#endif
 
 /* StrandLink frame with header + payload buffer */
 #define STRANDLINK_MAX_FRAME_SIZE 9216
@@ -60,6 +65,10 @@ typedef struct {
     uint8_t                payload[STRANDLINK_MAX_FRAME_SIZE - 64];
 } strandlink_frame_t;
 
+/* Option types of the wire frame's options section (TLV: type(1),
+ * length(1), value) */
+#define STRANDLINK_OPT_SEMANTIC_ADDR  0x07
+
 /* Port abstraction for forwarding */
 typedef uint16_t strandlink_port_t;
 
@@ -74,6 +83,38 @@ typedef int (*strandlink_recv_fn)(strandlink_port_t port,
                                strandlink_frame_t *frame,
                                void *ctx);
 
+/*
+ * Lock-free single-producer / single-consumer frame ring, same C API as
+ * strandlink/include/strandlink.h.  The producer reserve()s the head slot,
+ * fills it and commit()s; the consumer peek()s the tail slot and
+ * release()s it.  One slot may be reserved or peeked at a time.
+ *
+ * Built from src/strandlink_ring.c unless STRANDLINK_COMPAT_RING is off,
+ * in which case libstrandlink.a from the Zig build (STRANDLINK_LIB_DIR)
+ * is linked and provides it.
+ */
+typedef struct strandlink_ring_buffer strandlink_ring_buffer_t;
+
+/* num_slots must be a power of 2; NULL on failure */
+strandlink_ring_buffer_t *strandlink_ring_buffer_create(uint32_t num_slots,
+                                                     uint32_t slot_size);
+void           strandlink_ring_buffer_destroy(strandlink_ring_buffer_t *rb);
+
+/* Producer: slot to fill, or NULL if the ring is full */
+uint8_t       *strandlink_ring_buffer_reserve(strandlink_ring_buffer_t *rb);
+void           strandlink_ring_buffer_commit(strandlink_ring_buffer_t *rb);
+
+/* Consumer: next slot to read, or NULL if the ring is empty */
+const uint8_t *strandlink_ring_buffer_peek(strandlink_ring_buffer_t *rb);
+void           strandlink_ring_buffer_release(strandlink_ring_buffer_t *rb);
+
+/*
+ * CRC-32C (Castagnoli) over @len bytes, same C API and result as
+ * strandlink/include/strandlink.h; 0 if @data is NULL.  Built from
+ * src/strandlink_crc.c, or taken from libstrandlink, along with the ring.
+ */
+uint32_t       strandlink_crc32c(const uint8_t *data, uint32_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,91 @@
+/*
+ * timer_wheel.h - Hierarchical timing wheel
+ *
+ * Timers keyed by an absolute expiry in caller-chosen units (ms for the
+ * gossip clock, ns for route TTLs), bucketed at a fixed tick.  Four levels
+ * of 64 slots cover 2^24 ticks; a timer further out waits in the top
+ * level and is re-bucketed as the wheel turns.  Adding, re-arming and
+ * cancelling are O(1); timer_wheel_advance() costs the timers that fire
+ * plus one slot per elapsed tick, and skips stretches of empty levels.
+ *
+ * Timers are named by small integer ids, never by pointer, so owners can
+ * move (realloc, swap-remove) freely.  A fired timer is released after
+ * its callback returns unless the callback re-armed it with
+ * timer_wheel_mod(); its id may then be reused.
+ *
+ * Not thread-safe: callers serialise access (gossip state is single
+ * threaded, the routing table's wheel sits under its write lock).
+ */
+
+#ifndef STRANDROUTE_TIMER_WHEEL_H
+#define STRANDROUTE_TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMER_WHEEL_NONE 0u             /* never a valid timer id */
+
+/* Called for each due timer with the data it was added with */
+typedef void (*timer_wheel_fn)(void *ctx, uint32_t id, uint64_t data);
+
+/* Opaque handle */
+typedef struct timer_wheel timer_wheel_t;
+
+/**
+ * Create a wheel whose clock starts at @now, bucketing expiries to
+ * multiples of @tick (same units).  Returns NULL if @tick is 0 or on
+ * allocation failure.
+ */
+timer_wheel_t *timer_wheel_create(uint64_t tick, uint64_t now);
+
+/**
+ * Destroy the wheel and every timer on it; no callbacks run.
+ */
+void timer_wheel_destroy(timer_wheel_t *tw);
+
+/**
+ * Add a timer firing at @expires (already past = on the next advance).
+ * Returns its id, or TIMER_WHEEL_NONE on allocation failure.
+ */
+uint32_t timer_wheel_add(timer_wheel_t *tw, uint64_t expires, uint64_t data);
+
+/**
+ * Move timer @id to @expires, whether it is pending or firing right now.
+ *
+ * @return 0 on success, -1 if @id is not a live timer.
+ */
+int timer_wheel_mod(timer_wheel_t *tw, uint32_t id, uint64_t expires);
+
+/**
+ * Cancel and release timer @id.  No-op for TIMER_WHEEL_NONE.
+ */
+void timer_wheel_del(timer_wheel_t *tw, uint32_t id);
+
+/**
+ * Expiry of pending timer @id, or UINT64_MAX if it is not pending.
+ */
+uint64_t timer_wheel_expires(const timer_wheel_t *tw, uint32_t id);
+
+/**
+ * Number of pending timers.
+ */
+uint32_t timer_wheel_pending(const timer_wheel_t *tw);
+
+/**
+ * Move the clock to @now and call @fn for every timer due by then, in
+ * tick order.  Callbacks may add, re-arm and delete any timer.
+ *
+ * @return Number of callbacks run.
+ */
+uint32_t timer_wheel_advance(timer_wheel_t *tw, uint64_t now,
+                             timer_wheel_fn fn, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_TIMER_WHEEL_H */
@@ -98,7 +98,7 @@ typedef struct {
  * Semantic Address Descriptor (SAD)
  * -------------------------------------------------------------------------- */
 
-typedef struct {
+typedef struct strandroute_sad {
     uint8_t     version;
     uint8_t     flags;
     uint16_t    num_fields;
@@ -0,0 +1,216 @@
+/*
+ * xdp_steer.h - Kernel fast path for exact and hot-SAD forwarding
+ *
+ * Keeps the BPF maps of strandlink's XDP program
+ * (strandlink/src/backends/xdp_kern.c) in line with the exact node_id
+ * table and the hot-SAD set, so that frames either table would route are
+ * rewritten and sent back out by the kernel without reaching the AF_XDP
+ * socket:
+ *
+ *   node_fwd_map  dst_node_id -> next hop node_id + outer IPv4 underlay
+ *   hot_sad_map   (model_arch, capability, context_window) -> node_id,
+ *                 an LPM trie so widened context prefixes work as in
+ *                 sad_ternary_match (the longest prefix is the entry the
+ *                 TCAM would give the highest priority)
+ *
+ * A frame with a known dst_node_id is looked up in node_fwd_map; one
+ * without is classified by its SAD option in hot_sad_map, and the node
+ * found there goes through node_fwd_map in turn.  So a hot SAD is
+ * forwarded in the kernel only while its node also has an exact entry.
+ * Every miss is handed to userspace as before.
+ *
+ * Node entries are written through: xdp_steer_node_insert/delete() update
+ * the node table and then the map.  A node whose hop has no known
+ * underlay (the underlay callback fails) is removed from the map so its
+ * frames take the userspace path.  SAD entries mirror the operations the
+ * offload manager writes to the switch: call xdp_steer_apply() from the
+ * offload write_fn with the same batch.
+ *
+ * The kernel rewrites dst_node_id and patches the frame's CRC-32C for
+ * the change without reading the payload; xdp_steer_crc_patch() is the
+ * same computation, for tests and userspace senders.
+ *
+ * The struct layouts below are the map key and value formats of
+ * xdp_kern.c and must be kept identical to it.
+ *
+ * Writers are serialised by an internal mutex.
+ */
+
+#ifndef STRANDROUTE_XDP_STEER_H
+#define STRANDROUTE_XDP_STEER_H
+
+#include "strandroute/node_table.h"
+#include "strandroute/p4_runtime.h"
+#include "strandroute/types.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* --------------------------------------------------------------------------
+ * Map formats (xdp_kern.c)
+ * -------------------------------------------------------------------------- */
+
+/* node_fwd_map: key is the 16-byte dst_node_id */
+typedef struct {
+    uint8_t  next_hop[STRANDLINK_NODE_ID_LEN];   /* written to dst_node_id */
+    uint32_t ifindex;        /* egress; the ingress ifindex means XDP_TX */
+    uint32_t saddr;          /* outer IPv4 addresses, network byte order */
+    uint32_t daddr;
+    uint8_t  smac[6];
+    uint8_t  dmac[6];
+} xdp_steer_node_val_t;
+
+/* hot_sad_map: LPM key over model_arch, capability, context_window (BE) */
+typedef struct {
+    uint32_t prefixlen;      /* 96 for exact entries */
+    uint8_t  data[12];
+} xdp_steer_sad_key_t;
+
+typedef struct {
+    uint8_t node_id[STRANDLINK_NODE_ID_LEN];
+} xdp_steer_sad_val_t;
+
+/* xdp_stats_map indices (per-CPU __u64 counters) */
+enum {
+    XDP_STEER_STAT_XSK_DROP = 0,   /* AF_XDP redirect failed */
+    XDP_STEER_STAT_XSK,            /* handed to the AF_XDP socket */
+    XDP_STEER_STAT_EXACT,          /* forwarded by node_fwd_map */
+    XDP_STEER_STAT_SAD,            /* forwarded by hot_sad_map */
+    XDP_STEER_STAT_TTL,            /* outer TTL exhausted, passed to the stack */
+    XDP_STEER_STATS,
+};
+
+typedef enum {
+    XDP_STEER_MAP_NODE = 0,        /* node_fwd_map */
+    XDP_STEER_MAP_SAD,             /* hot_sad_map */
+} xdp_steer_map_t;
+
+/* --------------------------------------------------------------------------
+ * Configuration
+ * -------------------------------------------------------------------------- */
+
+/* Outer addressing used to reach a next hop */
+typedef struct {
+    uint32_t ifindex;
+    uint32_t saddr;          /* network byte order */
+    uint32_t daddr;
+    uint8_t  smac[6];
+    uint8_t  dmac[6];
+} xdp_steer_underlay_t;
+
+/* Underlay of @next_hop behind @port; -1 if unknown */
+typedef int (*xdp_steer_underlay_fn)(strandlink_port_t port,
+                                     const uint8_t next_hop[STRANDLINK_NODE_ID_LEN],
+                                     xdp_steer_underlay_t *out, void *ctx);
+
+/* bpf_map_update_elem(BPF_ANY) on @map; 0 on success */
+typedef int (*xdp_steer_update_fn)(xdp_steer_map_t map, const void *key,
+                                   const void *value, void *ctx);
+
+/* bpf_map_delete_elem on @map; 0 if deleted or not present */
+typedef int (*xdp_steer_delete_fn)(xdp_steer_map_t map, const void *key,
+                                   void *ctx);
+
+typedef struct {
+    node_table_t         *node_table;    /* required */
+    xdp_steer_underlay_fn underlay_fn;   /* required */
+    void                 *underlay_ctx;
+    xdp_steer_update_fn   update_fn;     /* required */
+    xdp_steer_delete_fn   delete_fn;     /* required */
+    void                 *map_ctx;
+} xdp_steer_config_t;
+
+typedef struct {
+    uint64_t node_installed;   /* node_fwd_map writes */
+    uint64_t node_removed;     /* deleted, or no underlay */
+    uint64_t sad_installed;
+    uint64_t sad_removed;
+    uint64_t sad_skipped;      /* masks an LPM trie cannot express */
+    uint64_t failed;           /* map writes that did not apply */
+} xdp_steer_stats_t;
+
+/* Opaque handle */
+typedef struct xdp_steer xdp_steer_t;
+
+/**
+ * Create a mirror.  Returns NULL if a required field of @cfg is missing
+ * or on allocation failure.
+ */
+xdp_steer_t *xdp_steer_create(const xdp_steer_config_t *cfg);
+
+/**
+ * Destroy the mirror.  Map entries are left in place.
+ */
+void xdp_steer_destroy(xdp_steer_t *s);
+
+/**
+ * node_table_insert(), then install the entry in node_fwd_map (or remove
+ * it from there if the hop has no underlay).
+ *
+ * @return 0 on success, -1 if the node table refused the entry or the
+ *         map could not be brought in line with it.  The node table is
+ *         updated either way.
+ */
+int xdp_steer_node_insert(xdp_steer_t *s,
+                          const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                          strandlink_port_t port,
+                          const uint8_t next_hop[STRANDLINK_NODE_ID_LEN]);
+
+/**
+ * node_table_delete(), then remove the entry from node_fwd_map.
+ *
+ * @return 0 on success, -1 if not present or the map delete failed.
+ */
+int xdp_steer_node_delete(xdp_steer_t *s,
+                          const uint8_t node_id[STRANDLINK_NODE_ID_LEN]);
+
+/**
+ * Re-resolve the underlay of @node_id's current node table entry, after
+ * a neighbour or address change.  Same returns as xdp_steer_node_insert().
+ */
+int xdp_steer_node_refresh(xdp_steer_t *s,
+                           const uint8_t node_id[STRANDLINK_NODE_ID_LEN]);
+
+/**
+ * Mirror the sad_ternary_match operations among @ops into hot_sad_map.
+ * Entries whose masks are not a prefix (exact model_arch and capability,
+ * high bits of context_window) are skipped; their frames stay in
+ * userspace.  Other operation types are ignored.  @ops is not modified.
+ *
+ * @return the number of map writes that failed, or -1 on invalid
+ *         arguments.
+ */
+int xdp_steer_apply(xdp_steer_t *s, const p4rt_op_t *ops, size_t count);
+
+/**
+ * Copy the mirror's counters.
+ */
+void xdp_steer_stats(const xdp_steer_t *s, xdp_steer_stats_t *out);
+
+/**
+ * hot_sad_map key of a sad_ternary_match key and mask.
+ *
+ * @return 0, or -1 if the mask is not a prefix.
+ */
+int xdp_steer_sad_key(const p4rt_sad_key_t *key, const p4rt_sad_key_t *mask,
+                      xdp_steer_sad_key_t *out);
+
+/**
+ * CRC-32C of a frame after its 16-byte dst_node_id changed from @old_id
+ * to @new_id, given the frame's CRC @crc before the change and @tail_len,
+ * the number of bytes between the end of dst_node_id and the CRC field.
+ */
+uint32_t xdp_steer_crc_patch(uint32_t crc,
+                             const uint8_t old_id[STRANDLINK_NODE_ID_LEN],
+                             const uint8_t new_id[STRANDLINK_NODE_ID_LEN],
+                             uint32_t tail_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRANDROUTE_XDP_STEER_H */
@@ -0,0 +1,393 @@
+/*
+ * dataplane.c - Multi-queue forwarding runtime
+ *
+ * Worker loop: copy up to `burst` frames off the RX ring into private
+ * frame buffers (ring slots must be released in order, so a burst cannot
+ * be held in place), hand frames for this node to local_fn, forward the
+ * rest with forwarding_engine_process_burst, whose burst send callback
+ * copies each forwarded frame into the worker's TX ring behind the egress
+ * port it was given.
+ */
+
+#define _GNU_SOURCE               /* pthread_setaffinity_np, CPU_SET */
+
+#include "strandroute/dataplane.h"
+#include "strandroute/forwarding.h"
+#include "strandroute/types.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DP_DEFAULT_RING_SLOTS  256
+#define DP_DEFAULT_SPINS       1024
+#define DP_DEFAULT_YIELDS      64
+#define DP_DEFAULT_MAX_SLEEP   1000    /* us */
+#define DP_HEADER_SIZE         ((uint32_t)sizeof(strandlink_frame_header_t))
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DP_CPU_RELAX()  __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define DP_CPU_RELAX()  __asm__ __volatile__("yield")
+#else
+#define DP_CPU_RELAX()  ((void)0)
+#endif
+
+/* --------------------------------------------------------------------------
+ * Internal types
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    /* Written by the worker only */
+    _Alignas(64)
+    _Atomic uint64_t rx_frames;
+    _Atomic uint64_t tx_frames;
+    _Atomic uint64_t tx_ring_full;
+    _Atomic uint64_t local_frames;
+    _Atomic uint64_t idle_sleeps;
+
+    _Alignas(64)
+    struct dataplane          *dp;
+    int                        index;
+    pthread_t                  thread;
+    strandlink_ring_buffer_t  *rx;
+    strandlink_ring_buffer_t  *tx;
+    strandlink_frame_t        *frames;     /* burst buffers */
+    strandlink_frame_t       **ptrs;
+} dp_worker_t;
+
+struct dataplane {
+    forwarding_engine_t *eng;
+    dataplane_config_t   cfg;
+    dp_worker_t         *workers;
+    atomic_bool          running;
+    bool                 started;
+
+    _Atomic uint64_t     rx_dropped;       /* written by the submitter */
+};
+
+/* Worker running on this thread, for the burst send callback */
+static _Thread_local dp_worker_t *dp_current;
+
+static inline void stat_add(_Atomic uint64_t *c, uint64_t n)
+{
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+static inline uint32_t frame_bytes(const strandlink_frame_t *f)
+{
+    return DP_HEADER_SIZE + f->header.payload_length;
+}
+
+/* --------------------------------------------------------------------------
+ * Egress: burst send callback
+ * -------------------------------------------------------------------------- */
+
+static int dp_tx_burst(strandlink_port_t port,
+                       strandlink_frame_t *const *frames, int count,
+                       void *ctx)
+{
+    (void)ctx;
+    dp_worker_t *w = dp_current;
+    if (!w) return -1;
+
+    dataplane_tx_meta_t meta = { .port = port };
+    int sent = 0;
+    for (; sent < count; sent++) {
+        uint8_t *slot = strandlink_ring_buffer_reserve(w->tx);
+        if (!slot) break;
+        memcpy(slot, &meta, sizeof(meta));
+        memcpy(slot + DATAPLANE_TX_META_SIZE, frames[sent],
+               frame_bytes(frames[sent]));
+        strandlink_ring_buffer_commit(w->tx);
+    }
+    stat_add(&w->tx_frames, (uint64_t)sent);
+    if (sent < count)
+        stat_add(&w->tx_ring_full, (uint64_t)(count - sent));
+    return sent;
+}
+
+/* --------------------------------------------------------------------------
+ * Worker loop
+ * -------------------------------------------------------------------------- */
+
+static void dp_idle(dp_worker_t *w, uint32_t *idle, uint32_t *sleep_us)
+{
+    const dataplane_config_t *c = &w->dp->cfg;
+    uint32_t n = (*idle)++;
+
+    if (n < c->idle_spins) {
+        DP_CPU_RELAX();
+    } else if (n < c->idle_spins + c->idle_yields) {
+        sched_yield();
+    } else {
+        struct timespec ts = { 0, (long)*sleep_us * 1000L };
+        nanosleep(&ts, NULL);
+        stat_add(&w->idle_sleeps, 1);
+        if (*sleep_us < c->max_sleep_us) {
+            *sleep_us *= 2;
+            if (*sleep_us > c->max_sleep_us) *sleep_us = c->max_sleep_us;
+        }
+    }
+}
+
+static void *dp_worker_main(void *arg)
+{
+    dp_worker_t *w = arg;
+    struct dataplane *dp = w->dp;
+    const dataplane_config_t *c = &dp->cfg;
+    dp_current = w;
+
+    uint32_t idle = 0, sleep_us = 1;
+
+    while (atomic_load_explicit(&dp->running, memory_order_relaxed)) {
+        int got = 0, n = 0;
+        const uint8_t *slot;
+
+        while (got < c->burst && (slot = strandlink_ring_buffer_peek(w->rx)) != NULL) {
+            got++;
+            strandlink_frame_t *f = &w->frames[n];
+            memcpy(&f->header, slot, DP_HEADER_SIZE);
+            uint32_t len = f->header.payload_length;
+            if (DP_HEADER_SIZE + len > c->slot_size)   /* cannot happen via submit */
+                len = c->slot_size - DP_HEADER_SIZE;
+            memcpy(f->payload, slot + DP_HEADER_SIZE, len);
+            strandlink_ring_buffer_release(w->rx);
+
+            if (node_id_equal(f->header.dst_node_id, dp->eng->self_id)) {
+                stat_add(&w->local_frames, 1);
+                if (c->local_fn)
+                    c->local_fn(0, f, c->local_ctx);
+                continue;
+            }
+            w->ptrs[n++] = f;
+        }
+
+        if (got == 0) {
+            dp_idle(w, &idle, &sleep_us);
+            continue;
+        }
+        idle = 0;
+        sleep_us = 1;
+
+        stat_add(&w->rx_frames, (uint64_t)got);
+        if (n > 0)
+            forwarding_engine_process_burst(dp->eng, w->ptrs, n);
+    }
+
+    dp_current = NULL;
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------
+ * dataplane_create / dataplane_destroy
+ * -------------------------------------------------------------------------- */
+
+static bool power_of_two(uint32_t n)
+{
+    return n && (n & (n - 1)) == 0;
+}
+
+dataplane_t *dataplane_create(forwarding_engine_t *eng,
+                              const dataplane_config_t *config)
+{
+    if (!eng) return NULL;
+
+    dataplane_config_t c;
+    if (config) c = *config;
+    else        memset(&c, 0, sizeof(c));
+
+    if (c.num_workers <= 0)  c.num_workers   = 1;
+    if (!c.rx_ring_slots)    c.rx_ring_slots = DP_DEFAULT_RING_SLOTS;
+    if (!c.tx_ring_slots)    c.tx_ring_slots = DP_DEFAULT_RING_SLOTS;
+    if (!c.slot_size)        c.slot_size     = sizeof(strandlink_frame_t);
+    if (c.burst <= 0 || c.burst > FWD_BURST_MAX) c.burst = FWD_BURST_MAX;
+    if (!c.idle_spins)       c.idle_spins    = DP_DEFAULT_SPINS;
+    if (!c.idle_yields)      c.idle_yields   = DP_DEFAULT_YIELDS;
+    if (!c.max_sleep_us)     c.max_sleep_us  = DP_DEFAULT_MAX_SLEEP;
+
+    if (c.num_workers > DATAPLANE_MAX_WORKERS ||
+        !power_of_two(c.rx_ring_slots) || !power_of_two(c.tx_ring_slots) ||
+        c.slot_size < DP_HEADER_SIZE || c.slot_size > sizeof(strandlink_frame_t))
+        return NULL;
+
+    struct dataplane *dp = calloc(1, sizeof(*dp));
+    if (!dp) return NULL;
+    dp->eng = eng;
+    dp->cfg = c;
+    atomic_init(&dp->running, false);
+    atomic_init(&dp->rx_dropped, 0);
+
+    dp->workers = aligned_alloc(64, (size_t)c.num_workers * sizeof(dp_worker_t));
+    if (!dp->workers) {
+        free(dp);
+        return NULL;
+    }
+    memset(dp->workers, 0, (size_t)c.num_workers * sizeof(dp_worker_t));
+
+    for (int i = 0; i < c.num_workers; i++) {
+        dp_worker_t *w = &dp->workers[i];
+        w->dp     = dp;
+        w->index  = i;
+        w->rx     = strandlink_ring_buffer_create(c.rx_ring_slots, c.slot_size);
+        w->tx     = strandlink_ring_buffer_create(c.tx_ring_slots,
+                                                  c.slot_size + DATAPLANE_TX_META_SIZE);
+        w->frames = malloc((size_t)c.burst * sizeof(strandlink_frame_t));
+        w->ptrs   = malloc((size_t)c.burst * sizeof(strandlink_frame_t *));
+        if (!w->rx || !w->tx || !w->frames || !w->ptrs) {
+            dataplane_destroy(dp);
+            return NULL;
+        }
+    }
+
+    forwarding_engine_set_burst_send(eng, dp_tx_burst, dp);
+    return dp;
+}
+
+void dataplane_destroy(dataplane_t *dp)
+{
+    if (!dp) return;
+    dataplane_stop(dp);
+
+    for (int i = 0; i < dp->cfg.num_workers; i++) {
+        dp_worker_t *w = &dp->workers[i];
+        strandlink_ring_buffer_destroy(w->rx);
+        strandlink_ring_buffer_destroy(w->tx);
+        free(w->frames);
+        free(w->ptrs);
+    }
+    free(dp->workers);
+
+    if (dp->eng->send_burst_fn == dp_tx_burst)
+        forwarding_engine_set_burst_send(dp->eng, NULL, NULL);
+    free(dp);
+}
+
+/* --------------------------------------------------------------------------
+ * dataplane_start / dataplane_stop
+ * -------------------------------------------------------------------------- */
+
+static void dp_pin(pthread_t t, int cpu)
+{
+#ifdef CPU_SET
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu <= 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((int)(cpu % ncpu), &set);
+    pthread_setaffinity_np(t, sizeof(set), &set);   /* best effort */
+#else
+    (void)t;
+    (void)cpu;
+#endif
+}
+
+int dataplane_start(dataplane_t *dp)
+{
+    if (!dp || dp->started) return -1;
+
+    atomic_store(&dp->running, true);
+    for (int i = 0; i < dp->cfg.num_workers; i++) {
+        dp_worker_t *w = &dp->workers[i];
+        if (pthread_create(&w->thread, NULL, dp_worker_main, w) != 0) {
+            atomic_store(&dp->running, false);
+            for (int j = 0; j < i; j++)
+                pthread_join(dp->workers[j].thread, NULL);
+            return -1;
+        }
+        if (dp->cfg.pin_cpus)
+            dp_pin(w->thread, dp->cfg.cpu_base + i);
+    }
+    dp->started = true;
+    return 0;
+}
+
+void dataplane_stop(dataplane_t *dp)
+{
+    if (!dp || !dp->started) return;
+    atomic_store(&dp->running, false);
+    for (int i = 0; i < dp->cfg.num_workers; i++)
+        pthread_join(dp->workers[i].thread, NULL);
+    dp->started = false;
+}
+
+/* --------------------------------------------------------------------------
+ * Ingress
+ * -------------------------------------------------------------------------- */
+
+int dataplane_num_workers(const dataplane_t *dp)
+{
+    return dp ? dp->cfg.num_workers : 0;
+}
+
+int dataplane_queue_for(const dataplane_t *dp, const strandlink_frame_t *frame)
+{
+    if (!dp || !frame) return -1;
+
+    uint32_t h = 2166136261u;   /* FNV-1a over src_node_id + stream_id */
+    for (int i = 0; i < STRANDLINK_NODE_ID_LEN; i++) {
+        h ^= frame->header.src_node_id[i];
+        h *= 16777619u;
+    }
+    for (int i = 0; i < 8; i++) {
+        h ^= frame->header.stream_id[i];
+        h *= 16777619u;
+    }
+    return (int)(((uint64_t)h * (uint32_t)dp->cfg.num_workers) >> 32);
+}
+
+int dataplane_submit(dataplane_t *dp, const strandlink_frame_t *frame)
+{
+    if (!dp || !frame) return -1;
+
+    strandlink_ring_buffer_t *rx = dp->workers[dataplane_queue_for(dp, frame)].rx;
+    uint32_t bytes = frame_bytes(frame);
+    uint8_t *slot = (bytes <= dp->cfg.slot_size)
+                        ? strandlink_ring_buffer_reserve(rx) : NULL;
+    if (!slot) {
+        stat_add(&dp->rx_dropped, 1);
+        return -1;
+    }
+    memcpy(slot, frame, bytes);
+    strandlink_ring_buffer_commit(rx);
+    return 0;
+}
+
+strandlink_ring_buffer_t *dataplane_rx_ring(dataplane_t *dp, int worker)
+{
+    if (!dp || worker < 0 || worker >= dp->cfg.num_workers) return NULL;
+    return dp->workers[worker].rx;
+}
+
+strandlink_ring_buffer_t *dataplane_tx_ring(dataplane_t *dp, int worker)
+{
+    if (!dp || worker < 0 || worker >= dp->cfg.num_workers) return NULL;
+    return dp->workers[worker].tx;
+}
+
+/* --------------------------------------------------------------------------
+ * dataplane_stats
+ * -------------------------------------------------------------------------- */
+
+void dataplane_stats(const dataplane_t *dp, dataplane_stats_t *out)
+{
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!dp) return;
+
+    struct dataplane *d = (struct dataplane *)dp;
+    out->rx_dropped = atomic_load_explicit(&d->rx_dropped, memory_order_relaxed);
+    for (int i = 0; i < d->cfg.num_workers; i++) {
+        dp_worker_t *w = &d->workers[i];
+        out->rx_frames    += atomic_load_explicit(&w->rx_frames, memory_order_relaxed);
+        out->tx_frames    += atomic_load_explicit(&w->tx_frames, memory_order_relaxed);
+        out->tx_ring_full += atomic_load_explicit(&w->tx_ring_full, memory_order_relaxed);
+        out->local_frames += atomic_load_explicit(&w->local_frames, memory_order_relaxed);
+        out->idle_sleeps  += atomic_load_explicit(&w->idle_sleeps, memory_order_relaxed);
+    }
+}
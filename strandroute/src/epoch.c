@@ -0,0 +1,279 @@
+/*
+ * epoch.c - Epoch-based memory reclamation
+ *
+ * Classic three-epoch scheme.  A global epoch counter advances only when
+ * every thread currently inside a read section has observed the current
+ * value; an object retired in epoch e is therefore unreachable by any
+ * reader once the global epoch reaches e + 2.
+ *
+ * Each reader thread owns a slot padded to its own cache line, found via
+ * a per-domain pthread key, so entering and leaving a read section is a
+ * plain store plus a fence on thread-private memory.  Slots live on a
+ * lock-free list and are recycled when their thread exits.
+ */
+
+#include "strandroute/epoch.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define EPOCH_CACHE_LINE  64
+
+/* --------------------------------------------------------------------------
+ * Internal types
+ * -------------------------------------------------------------------------- */
+
+typedef struct epoch_slot {
+    _Alignas(EPOCH_CACHE_LINE)
+    _Atomic uint64_t   epoch;     /* epoch observed on entry, 0 = quiescent */
+    _Atomic bool       in_use;    /* owned by a live thread */
+    uint32_t           depth;     /* nesting, owner thread only */
+    epoch_domain_t    *domain;
+    struct epoch_slot *next;      /* registry list, immutable once linked */
+} epoch_slot_t;
+
+typedef struct retired {
+    void            *ptr;
+    void           (*free_fn)(void *);
+    uint64_t         epoch;       /* global epoch when retired */
+    struct retired  *next;
+} retired_t;
+
+struct epoch_domain {
+    _Atomic uint64_t          global;
+    _Atomic(epoch_slot_t *)   slots;
+    pthread_key_t             key;
+    pthread_mutex_t           lock;      /* guards retired list */
+    retired_t                *retired;
+    uint32_t                  num_retired;
+};
+
+/* --------------------------------------------------------------------------
+ * Thread registration
+ * -------------------------------------------------------------------------- */
+
+/* pthread key destructor: hand the slot back when its thread exits */
+static void slot_release(void *arg)
+{
+    epoch_slot_t *slot = arg;
+    slot->depth = 0;
+    atomic_store_explicit(&slot->epoch, 0, memory_order_release);
+    atomic_store_explicit(&slot->in_use, false, memory_order_release);
+}
+
+static epoch_slot_t *slot_register(epoch_domain_t *d)
+{
+    /* Reuse a slot left behind by an exited thread */
+    for (epoch_slot_t *s = atomic_load_explicit(&d->slots, memory_order_acquire);
+         s; s = s->next) {
+        bool expected = false;
+        if (!atomic_load_explicit(&s->in_use, memory_order_relaxed) &&
+            atomic_compare_exchange_strong(&s->in_use, &expected, true)) {
+            s->depth = 0;
+            if (pthread_setspecific(d->key, s) != 0) {
+                atomic_store(&s->in_use, false);
+                return NULL;
+            }
+            return s;
+        }
+    }
+
+    epoch_slot_t *s = aligned_alloc(EPOCH_CACHE_LINE, sizeof(epoch_slot_t));
+    if (!s) return NULL;
+    memset(s, 0, sizeof(*s));
+    atomic_init(&s->epoch, 0);
+    atomic_init(&s->in_use, true);
+    s->domain = d;
+
+    if (pthread_setspecific(d->key, s) != 0) {
+        free(s);
+        return NULL;
+    }
+
+    epoch_slot_t *head = atomic_load_explicit(&d->slots, memory_order_relaxed);
+    do {
+        s->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(
+                 &d->slots, &head, s,
+                 memory_order_release, memory_order_relaxed));
+    return s;
+}
+
+static inline epoch_slot_t *slot_self(epoch_domain_t *d)
+{
+    epoch_slot_t *s = pthread_getspecific(d->key);
+    return s ? s : slot_register(d);
+}
+
+/* --------------------------------------------------------------------------
+ * Domain lifecycle
+ * -------------------------------------------------------------------------- */
+
+epoch_domain_t *epoch_domain_create(void)
+{
+    epoch_domain_t *d = calloc(1, sizeof(epoch_domain_t));
+    if (!d) return NULL;
+
+    if (pthread_key_create(&d->key, slot_release) != 0) {
+        free(d);
+        return NULL;
+    }
+    atomic_init(&d->global, 1);
+    atomic_init(&d->slots, NULL);
+    pthread_mutex_init(&d->lock, NULL);
+    return d;
+}
+
+void epoch_domain_destroy(epoch_domain_t *d)
+{
+    if (!d) return;
+
+    /* Deleting the key does not run destructors, so slots are freed here */
+    pthread_key_delete(d->key);
+
+    retired_t *r = d->retired;
+    while (r) {
+        retired_t *next = r->next;
+        r->free_fn(r->ptr);
+        free(r);
+        r = next;
+    }
+
+    epoch_slot_t *s = atomic_load(&d->slots);
+    while (s) {
+        epoch_slot_t *next = s->next;
+        free(s);
+        s = next;
+    }
+
+    pthread_mutex_destroy(&d->lock);
+    free(d);
+}
+
+/* --------------------------------------------------------------------------
+ * Read side
+ * -------------------------------------------------------------------------- */
+
+int epoch_enter(epoch_domain_t *d)
+{
+    epoch_slot_t *s = slot_self(d);
+    if (!s) return -1;
+
+    if (s->depth++ == 0) {
+        atomic_store_explicit(&s->epoch,
+            atomic_load_explicit(&d->global, memory_order_relaxed),
+            memory_order_relaxed);
+        /* Publish the announcement before any shared pointer is loaded */
+        atomic_thread_fence(memory_order_seq_cst);
+    }
+    return 0;
+}
+
+void epoch_exit(epoch_domain_t *d)
+{
+    epoch_slot_t *s = pthread_getspecific(d->key);
+    if (!s || s->depth == 0) return;
+
+    if (--s->depth == 0)
+        atomic_store_explicit(&s->epoch, 0, memory_order_release);
+}
+
+/* --------------------------------------------------------------------------
+ * Write side (reclamation runs under d->lock)
+ * -------------------------------------------------------------------------- */
+
+/* Advance the global epoch if every active reader has seen it */
+static bool try_advance(epoch_domain_t *d)
+{
+    uint64_t e = atomic_load_explicit(&d->global, memory_order_relaxed);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    for (epoch_slot_t *s = atomic_load_explicit(&d->slots, memory_order_acquire);
+         s; s = s->next) {
+        uint64_t v = atomic_load_explicit(&s->epoch, memory_order_acquire);
+        if (v != 0 && v != e)
+            return false;
+    }
+
+    atomic_store_explicit(&d->global, e + 1, memory_order_release);
+    return true;
+}
+
+static uint32_t reclaim_locked(epoch_domain_t *d)
+{
+    /* Two advances make anything retired in the current epoch safe */
+    if (d->retired && try_advance(d))
+        try_advance(d);
+
+    uint64_t g = atomic_load_explicit(&d->global, memory_order_relaxed);
+
+    retired_t **pp = &d->retired;
+    while (*pp) {
+        retired_t *r = *pp;
+        if (r->epoch + 2 <= g) {
+            *pp = r->next;
+            r->free_fn(r->ptr);
+            free(r);
+            d->num_retired--;
+        } else {
+            pp = &r->next;
+        }
+    }
+    return d->num_retired;
+}
+
+void epoch_retire(epoch_domain_t *d, void *ptr, void (*free_fn)(void *))
+{
+    if (!d || !ptr || !free_fn) return;
+
+    retired_t *r = malloc(sizeof(retired_t));
+
+    pthread_mutex_lock(&d->lock);
+
+    if (!r) {
+        /* Out of memory for the deferral record: fall back to waiting for
+         * a grace period.  Impossible from inside a read section, where
+         * leaking the object is the only safe choice. */
+        epoch_slot_t *self = pthread_getspecific(d->key);
+        if (self && self->depth > 0) {
+            pthread_mutex_unlock(&d->lock);
+            return;
+        }
+        uint64_t target = atomic_load(&d->global) + 2;
+        while (atomic_load(&d->global) < target) {
+            if (!try_advance(d)) {
+                pthread_mutex_unlock(&d->lock);
+                sched_yield();
+                pthread_mutex_lock(&d->lock);
+            }
+        }
+        pthread_mutex_unlock(&d->lock);
+        free_fn(ptr);
+        return;
+    }
+
+    /* Tag after the caller's unlink: any reader that can still see ptr
+     * entered in this epoch or earlier */
+    atomic_thread_fence(memory_order_seq_cst);
+    r->ptr     = ptr;
+    r->free_fn = free_fn;
+    r->epoch   = atomic_load_explicit(&d->global, memory_order_relaxed);
+    r->next    = d->retired;
+    d->retired = r;
+    d->num_retired++;
+
+    reclaim_locked(d);
+    pthread_mutex_unlock(&d->lock);
+}
+
+uint32_t epoch_reclaim(epoch_domain_t *d)
+{
+    if (!d) return 0;
+    pthread_mutex_lock(&d->lock);
+    uint32_t pending = reclaim_locked(d);
+    pthread_mutex_unlock(&d->lock);
+    return pending;
+}
@@ -2,46 +2,209 @@
  * forwarding.c - Software dataplane forwarding engine
  *
  * Receive a StrandLink frame -> extract SAD from options -> resolve via
- * routing table -> select next hop (weighted random from top matches)
- * -> rewrite dst_node_id -> forward via send callback.
+ * routing table -> select next hop (weighted random from top matches, per
+ * flow through a Maglev table, or the less loaded of two) -> rewrite
+ * dst_node_id -> forward via send callback.  An attached node table short-circuits frames whose
+ * dst_node_id it knows.
  */
 
+#define _POSIX_C_SOURCE 200809L  /* clock_gettime */
+
+#include "strandroute/forwarding.h"
 #include "strandroute/types.h"
 #include "strandroute/sad.h"
 #include "strandroute/routing_table.h"
+#include "strandroute/resolve_cache.h"
+#include "strandroute/resolver.h"
+#include "strandroute/sad_match.h"
+#include "strandroute/multipath.h"
+#include "strandroute/node_table.h"
+#include "strandroute/hop_load.h"
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <inttypes.h>
 #include <stdatomic.h>
+#include <time.h>
 
 /* --------------------------------------------------------------------------
- * Forward declarations from other modules
+ * Per-thread state
+ *
+ * Found through the engine's pthread key.  Contexts sit on a push-only
+ * list so statistics can be summed from any thread; a context left by an
+ * exited thread is handed to the next new one, cache and counts included.
+ *
+ * Statistics are written by the owning thread only, as relaxed
+ * load + store pairs (no locked read-modify-write), and live on cache
+ * lines of their own.
  * -------------------------------------------------------------------------- */
 
-extern int resolver_resolve(const routing_table_t *rt,
-                            const sad_t *query,
-                            resolve_result_t *results,
-                            int max_results);
+#define FWD_CACHE_LINE  64
+
+/* Counter slots after the drop reasons */
+enum {
+    FWD_CTR_FORWARDED = FWD_DROP_REASONS,
+    FWD_CTR_RESOLVED,
+    FWD_CTR_LOCAL,
+    FWD_CTR_EXACT,
+};
+
+typedef struct {
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+    _Atomic uint64_t buckets[FWD_HIST_BUCKETS];
+} fwd_hist_t;
+
+struct fwd_thread {
+    _Alignas(FWD_CACHE_LINE)
+    _Atomic uint64_t   counters[FWD_STAT_COUNTERS];
+    fwd_hist_t         resolve_ns;
+    fwd_hist_t         candidates;
+    fwd_hist_t         top_k;
+
+    _Alignas(FWD_CACHE_LINE)
+    resolve_cache_t   *cache;       /* NULL if caching is off or failed */
+    struct fwd_maglev *maglev;      /* FWD_MAGLEV_SLOTS, on first use */
+    _Atomic bool       in_use;      /* owned by a live thread */
+    struct fwd_thread *next;        /* registry list, immutable once linked */
+};
+
+static void fwd_maglev_free(struct fwd_maglev *slots);
+
+/* pthread key destructor: hand the context back when its thread exits */
+static void fwd_thread_release(void *arg)
+{
+    struct fwd_thread *t = arg;
+    atomic_store_explicit(&t->in_use, false, memory_order_release);
+}
+
+static struct fwd_thread *fwd_thread_register(forwarding_engine_t *eng)
+{
+    for (struct fwd_thread *t = atomic_load_explicit(&eng->threads,
+                                                     memory_order_acquire);
+         t; t = t->next) {
+        bool expected = false;
+        if (!atomic_load_explicit(&t->in_use, memory_order_relaxed) &&
+            atomic_compare_exchange_strong(&t->in_use, &expected, true)) {
+            if (pthread_setspecific(eng->thread_key, t) != 0) {
+                atomic_store(&t->in_use, false);
+                return NULL;
+            }
+            return t;
+        }
+    }
+
+    struct fwd_thread *t = aligned_alloc(FWD_CACHE_LINE, sizeof(struct fwd_thread));
+    if (!t) return NULL;
+    memset(t, 0, sizeof(*t));
+    atomic_init(&t->in_use, true);
+    if (eng->cache_enabled)
+        t->cache = resolve_cache_create(&eng->cache_config);
+
+    if (pthread_setspecific(eng->thread_key, t) != 0) {
+        resolve_cache_destroy(t->cache);
+        free(t);
+        return NULL;
+    }
+
+    struct fwd_thread *head = atomic_load_explicit(&eng->threads,
+                                                   memory_order_relaxed);
+    do {
+        t->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(
+                 &eng->threads, &head, t,
+                 memory_order_release, memory_order_relaxed));
+    return t;
+}
+
+/* The calling thread's context, or NULL if there is none (uncached path,
+ * counted in the engine's shared counters) */
+static inline struct fwd_thread *fwd_thread_self(forwarding_engine_t *eng)
+{
+    if (!eng->thread_key_valid) return NULL;
+    struct fwd_thread *t = pthread_getspecific(eng->thread_key);
+    return t ? t : fwd_thread_register(eng);
+}
 
 /* --------------------------------------------------------------------------
- * Forwarding engine state
+ * Statistics recording
  * -------------------------------------------------------------------------- */
 
-#define FWD_MAX_NEXT_HOPS 8
+/* Single-writer add */
+static inline void stat_add(_Atomic uint64_t *c, uint64_t n)
+{
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
 
-typedef struct {
-    uint8_t          self_id[STRANDLINK_NODE_ID_LEN];
-    routing_table_t *routing_table;   /* owned externally */
-    strandlink_send_fn  send_fn;
-    void            *send_ctx;
-    int              max_multipath;   /* top-K results to consider */
-
-    /* Statistics (atomic for lock-free reads) */
-    _Atomic uint64_t frames_forwarded;
-    _Atomic uint64_t frames_dropped;
-    _Atomic uint64_t frames_resolved;
-    _Atomic uint64_t resolve_failures;
-} forwarding_engine_t;
+static inline void fwd_count(forwarding_engine_t *eng, struct fwd_thread *self,
+                             int ctr, uint64_t n)
+{
+    if (n == 0) return;
+    if (self)
+        stat_add(&self->counters[ctr], n);
+    else
+        atomic_fetch_add_explicit(&eng->shared_counters[ctr], n,
+                                  memory_order_relaxed);
+}
+
+static inline uint32_t hist_bucket(uint64_t v)
+{
+    if (v < (1u << FWD_HIST_SUB_BITS))
+        return (uint32_t)v;
+    uint32_t e   = 63u - (uint32_t)__builtin_clzll(v);
+    uint32_t sub = (uint32_t)(v >> (e - FWD_HIST_SUB_BITS)) &
+                   ((1u << FWD_HIST_SUB_BITS) - 1);
+    return ((e - FWD_HIST_SUB_BITS + 1) << FWD_HIST_SUB_BITS) | sub;
+}
+
+/* Largest value that lands in bucket @b */
+static uint64_t hist_bucket_upper(uint32_t b)
+{
+    if (b < (1u << FWD_HIST_SUB_BITS))
+        return b;
+    uint32_t e   = (b >> FWD_HIST_SUB_BITS) + FWD_HIST_SUB_BITS - 1;
+    uint64_t sub = b & ((1u << FWD_HIST_SUB_BITS) - 1);
+    uint64_t lo  = (1ull << e) | (sub << (e - FWD_HIST_SUB_BITS));
+    return lo + (1ull << (e - FWD_HIST_SUB_BITS)) - 1;
+}
+
+static void hist_record(fwd_hist_t *h, uint64_t v)
+{
+    stat_add(&h->count, 1);
+    stat_add(&h->sum, v);
+    stat_add(&h->buckets[hist_bucket(v)], 1);
+    if (v > atomic_load_explicit(&h->max, memory_order_relaxed))
+        atomic_store_explicit(&h->max, v, memory_order_relaxed);
+}
+
+static inline uint64_t fwd_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Resolve through the thread's cache, recording latency, rows scored and
+ * result size when the thread has a statistics block */
+static int fwd_resolve(struct fwd_thread *self,
+                       const routing_table_view_t *view,
+                       const sad_view_t *query, sad_hit_t *hits, int k)
+{
+    if (!self)
+        return resolver_resolve_cached(NULL, view, query, hits, k);
+
+    uint64_t t0   = fwd_now_ns();
+    uint64_t rows = sad_match_rows_scored();
+    int n = resolver_resolve_cached(self->cache, view, query, hits, k);
+    hist_record(&self->resolve_ns, fwd_now_ns() - t0);
+    hist_record(&self->candidates, sad_match_rows_scored() - rows);
+    hist_record(&self->top_k, n > 0 ? (uint64_t)n : 0);
+    return n;
+}
 
 /* --------------------------------------------------------------------------
  * forwarding_engine_init
@@ -59,17 +222,93 @@ void forwarding_engine_init(forwarding_engine_t *eng,
     eng->send_fn       = send_fn;
     eng->send_ctx      = send_ctx;
     eng->max_multipath = 3;  /* default top-K */
-    atomic_init(&eng->frames_forwarded, 0);
-    atomic_init(&eng->frames_dropped, 0);
-    atomic_init(&eng->frames_resolved, 0);
-    atomic_init(&eng->resolve_failures, 0);
+    eng->cache_enabled = true;
+    eng->thread_key_valid =
+        (pthread_key_create(&eng->thread_key, fwd_thread_release) == 0);
+    atomic_init(&eng->threads, NULL);
+    for (int i = 0; i < FWD_STAT_COUNTERS; i++)
+        atomic_init(&eng->shared_counters[i], 0);
+}
+
+/* --------------------------------------------------------------------------
+ * forwarding_engine_destroy / forwarding_engine_set_burst_send /
+ * forwarding_engine_set_select / forwarding_engine_set_node_table /
+ * forwarding_engine_set_offload / forwarding_engine_set_hop_load /
+ * forwarding_engine_set_cache
+ * -------------------------------------------------------------------------- */
+
+void forwarding_engine_destroy(forwarding_engine_t *eng)
+{
+    if (!eng) return;
+
+    /* Deleting the key does not run destructors, so contexts are freed here */
+    if (eng->thread_key_valid)
+        pthread_key_delete(eng->thread_key);
+    eng->thread_key_valid = false;
+
+    struct fwd_thread *t = atomic_load(&eng->threads);
+    while (t) {
+        struct fwd_thread *next = t->next;
+        resolve_cache_destroy(t->cache);
+        fwd_maglev_free(t->maglev);
+        free(t);
+        t = next;
+    }
+    atomic_store(&eng->threads, NULL);
+}
+
+void forwarding_engine_set_burst_send(forwarding_engine_t *eng,
+                                      forwarding_send_burst_fn fn,
+                                      void *ctx)
+{
+    if (!eng) return;
+    eng->send_burst_fn  = fn;
+    eng->send_burst_ctx = ctx;
+}
+
+void forwarding_engine_set_select(forwarding_engine_t *eng,
+                                  forwarding_select_t mode)
+{
+    if (!eng) return;
+    eng->select_mode = mode;
+}
+
+void forwarding_engine_set_node_table(forwarding_engine_t *eng,
+                                      node_table_t *nt)
+{
+    if (!eng) return;
+    eng->node_table = nt;
+}
+
+void forwarding_engine_set_offload(forwarding_engine_t *eng, offload_t *o)
+{
+    if (!eng) return;
+    eng->offload = o;
+}
+
+void forwarding_engine_set_hop_load(forwarding_engine_t *eng, hop_load_t *hl)
+{
+    if (!eng) return;
+    eng->hop_load = hl;
+}
+
+void forwarding_engine_set_cache(forwarding_engine_t *eng,
+                                 const resolve_cache_config_t *config)
+{
+    if (!eng) return;
+    eng->cache_enabled = (config != NULL);
+    if (config)
+        eng->cache_config = *config;
+    else
+        memset(&eng->cache_config, 0, sizeof(eng->cache_config));
 }
 
 /* --------------------------------------------------------------------------
  * Simple PRNG for weighted random selection (xorshift32)
  * -------------------------------------------------------------------------- */
 
-static uint32_t fwd_rand_state = 0;
+/* Per thread: the engine is driven from several threads at once */
+static _Thread_local uint32_t fwd_rand_state = 0;
 
 static uint32_t fwd_rand(void)
 {
@@ -84,10 +323,12 @@ static uint32_t fwd_rand(void)
 /* --------------------------------------------------------------------------
  * Weighted random selection from top-K results
  *
- * Weight for each result is proportional to its match score.
+ * Weight for each result is proportional to its match score.  @rnd
+ * picks the point: fwd_rand() for per-frame spraying, a flow hash for a
+ * stateless per-flow choice.
  * -------------------------------------------------------------------------- */
 
-static int select_next_hop(const resolve_result_t *results, int count)
+static int select_next_hop(const sad_hit_t *results, int count, uint32_t rnd)
 {
     if (count <= 0)  return -1;
     if (count == 1)  return 0;
@@ -102,7 +343,7 @@ static int select_next_hop(const resolve_result_t *results, int count)
         return 0;
 
     /* Random value in [0, total) */
-    float r = ((float)(fwd_rand() % 10000) / 10000.0f) * total;
+    float r = ((float)(rnd % 10000) / 10000.0f) * total;
     float acc = 0.0f;
     for (int i = 0; i < count; i++) {
         acc += results[i].score;
@@ -113,6 +354,251 @@ static int select_next_hop(const resolve_result_t *results, int count)
     return count - 1;  /* fallback */
 }
 
+/* --------------------------------------------------------------------------
+ * Flow-affine selection (FWD_SELECT_MAGLEV)
+ *
+ * Each thread keeps a few Maglev tables, one per recently seen hit set
+ * (the equivalence class a resolve produced).  A table is keyed by the
+ * snapshot generation, the hit rows and their weights, so it is reused for
+ * as long as the resolve cache keeps returning the same answer and is
+ * rebuilt when the class or its weights change.  A rebuild edits the
+ * slot's previous backend set in place (remove the nodes that left, add
+ * or reweight the rest) so flows on nodes that stayed mostly keep their
+ * hop; hop_of[] maps Maglev backend indices back to hit positions.
+ *
+ * Weights are the match score discounted by the row's live load factor,
+ * quantised to FWD_MAGLEV_WEIGHT_STEPS so small metric jitter does not
+ * force a rebuild.  Every hit keeps a weight of at least 1.
+ * -------------------------------------------------------------------------- */
+
+#define FWD_MAGLEV_SLOTS         4     /* power of two */
+#define FWD_MAGLEV_WEIGHT_STEPS  16
+#define FWD_MAGLEV_TABLE_SIZE    1021  /* prime, > 100 * FWD_MAX_NEXT_HOPS */
+#define FWD_FLOW_KEY_LEN         (STRANDLINK_NODE_ID_LEN + 8)
+
+/* Backend indices stay below 2 * FWD_MAX_NEXT_HOPS: at most
+ * FWD_MAX_NEXT_HOPS are live plus as many removed since the last populate */
+#define FWD_MAGLEV_INDICES       (2 * FWD_MAX_NEXT_HOPS)
+
+typedef struct fwd_maglev {
+    uint64_t  key;              /* 0 = empty or being rebuilt */
+    uint64_t  generation;
+    int       num_hits;
+    bool      ready;            /* table initialized */
+    uint32_t  rows[FWD_MAX_NEXT_HOPS];
+    uint32_t  weights[FWD_MAX_NEXT_HOPS];
+    uint8_t   nodes[FWD_MAX_NEXT_HOPS][STRANDLINK_NODE_ID_LEN];
+    int8_t    hop_of[FWD_MAGLEV_INDICES];
+    maglev_t  table;
+} fwd_maglev_t;
+
+/* Forget a slot's table after a failed rebuild */
+static fwd_maglev_t *fwd_maglev_reset(fwd_maglev_t *mg)
+{
+    maglev_destroy(&mg->table);
+    mg->ready    = false;
+    mg->num_hits = 0;
+    return NULL;
+}
+
+static void fwd_maglev_free(fwd_maglev_t *slots)
+{
+    if (!slots) return;
+    for (int i = 0; i < FWD_MAGLEV_SLOTS; i++) {
+        if (slots[i].ready)
+            maglev_destroy(&slots[i].table);
+    }
+    free(slots);
+}
+
+static uint32_t fwd_hop_weight(const routing_table_view_t *view,
+                               const sad_hit_t *hit)
+{
+    float load = 0.0f;
+    routing_table_view_metrics(view, hit->index, NULL, &load);
+    if (!(load > 0.0f)) load = 0.0f;    /* also NaN */
+    if (load > 1.0f)    load = 1.0f;
+
+    float score = hit->score > 0.0f ? hit->score : 0.0f;
+    return 1 + (uint32_t)(score * (1.0f - load) * FWD_MAGLEV_WEIGHT_STEPS + 0.5f);
+}
+
+/* The Maglev table for @hits, (re)built on a miss.  NULL on allocation
+ * failure. */
+static fwd_maglev_t *fwd_maglev_get(struct fwd_thread *self,
+                                    const routing_table_view_t *view,
+                                    const sad_hit_t *hits, int n)
+{
+    uint32_t rows[FWD_MAX_NEXT_HOPS];
+    uint32_t weights[FWD_MAX_NEXT_HOPS];
+    uint64_t gen = routing_table_view_generation(view);
+    uint64_t key = gen * 0x9e3779b97f4a7c15ull;
+
+    for (int i = 0; i < n; i++) {
+        rows[i]    = hits[i].index;
+        weights[i] = fwd_hop_weight(view, &hits[i]);
+        key = (key ^ (((uint64_t)rows[i] << 32) | weights[i])) * 0x100000001b3ull;
+        key ^= key >> 29;
+    }
+    if (key == 0) key = 1;
+
+    if (!self->maglev) {
+        self->maglev = calloc(FWD_MAGLEV_SLOTS, sizeof(fwd_maglev_t));
+        if (!self->maglev) return NULL;
+    }
+
+    fwd_maglev_t *mg = &self->maglev[key & (FWD_MAGLEV_SLOTS - 1)];
+    if (mg->key == key && mg->generation == gen && mg->num_hits == n &&
+        memcmp(mg->rows, rows, (size_t)n * sizeof(rows[0])) == 0 &&
+        memcmp(mg->weights, weights, (size_t)n * sizeof(weights[0])) == 0)
+        return mg;
+
+    mg->key = 0;
+    if (!mg->ready) {
+        if (maglev_init(&mg->table, FWD_MAGLEV_TABLE_SIZE) != 0)
+            return NULL;
+        mg->ready = true;
+    }
+
+    const uint8_t *nodes[FWD_MAX_NEXT_HOPS];
+    for (int i = 0; i < n; i++)
+        nodes[i] = routing_table_view_node_id(view, rows[i]);
+
+    for (int j = 0; j < mg->num_hits; j++) {
+        bool kept = false;
+        for (int i = 0; i < n && !kept; i++)
+            kept = node_id_equal(mg->nodes[j], nodes[i]);
+        if (!kept)
+            maglev_remove_backend(&mg->table, mg->nodes[j]);
+    }
+
+    for (int i = 0; i < n; i++) {
+        int b = maglev_add_backend(&mg->table, nodes[i], weights[i]);
+        if (b < 0 || b >= FWD_MAGLEV_INDICES)
+            return fwd_maglev_reset(mg);
+        mg->hop_of[b] = (int8_t)i;
+        node_id_copy(mg->nodes[i], nodes[i]);
+    }
+    mg->num_hits = n;
+    if (maglev_populate(&mg->table) != 0)
+        return fwd_maglev_reset(mg);
+
+    mg->key        = key;
+    mg->generation = gen;
+    memcpy(mg->rows, rows, (size_t)n * sizeof(rows[0]));
+    memcpy(mg->weights, weights, (size_t)n * sizeof(weights[0]));
+    return mg;
+}
+
+/* --------------------------------------------------------------------------
+ * Load-aware selection (FWD_SELECT_P2C)
+ *
+ * Power of two choices: of two distinct hits drawn at random, the one
+ * with the lower expected cost.  Comparing two instead of taking the
+ * global minimum keeps every thread from piling onto the same
+ * momentarily idle hop between samples.
+ * -------------------------------------------------------------------------- */
+
+static float fwd_hop_cost(const forwarding_engine_t *eng,
+                          const routing_table_view_t *view,
+                          const sad_hit_t *hit)
+{
+    uint32_t lat  = 0;
+    float    load = 0.0f;
+    routing_table_view_metrics(view, hit->index, &lat, &load);
+    if (!(load > 0.0f)) load = 0.0f;    /* also NaN */
+    if (load > 1.0f)    load = 1.0f;
+
+    uint32_t inflight = 0;
+    hop_load_info_t info;
+    if (eng->hop_load &&
+        hop_load_get(eng->hop_load, routing_table_view_node_id(view, hit->index),
+                     &info) == 0) {
+        if (info.samples)
+            lat = info.ewma_us;
+        inflight = info.inflight;
+    }
+
+    float w = (hit->score > 0.0f ? hit->score : 0.0f) * (1.0f - load);
+    if (w < 1e-6f) w = 1e-6f;
+    return ((float)lat + 1.0f) * ((float)inflight + 1.0f) / w;
+}
+
+static int fwd_pick_p2c(const forwarding_engine_t *eng,
+                        const routing_table_view_t *view,
+                        const sad_hit_t *hits, int n)
+{
+    if (n <= 1)
+        return n - 1;
+
+    uint32_t r = fwd_rand();
+    int a = (int)(r % (uint32_t)n);
+    int b = (int)((r / (uint32_t)n) % (uint32_t)(n - 1));
+    if (b >= a) b++;
+
+    float ca = fwd_hop_cost(eng, view, &hits[a]);
+    float cb = fwd_hop_cost(eng, view, &hits[b]);
+    if (cb < ca || (cb == ca && b < a))
+        return b;
+    return a;
+}
+
+/* A flow is a stream of one source */
+static void fwd_flow_key(const strandlink_frame_t *frame,
+                         uint8_t key[FWD_FLOW_KEY_LEN])
+{
+    memcpy(key, frame->header.src_node_id, STRANDLINK_NODE_ID_LEN);
+    memcpy(key + STRANDLINK_NODE_ID_LEN, frame->header.stream_id, 8);
+}
+
+static uint32_t fwd_flow_hash(const uint8_t key[FWD_FLOW_KEY_LEN])
+{
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    for (int i = 0; i < FWD_FLOW_KEY_LEN; i++) {
+        h ^= key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Pick the hit @frame goes to.  @mg is the Maglev table for @hits in
+ * FWD_SELECT_MAGLEV mode; without one (no thread context, allocation
+ * failure) the flow hash drives a score-weighted pick instead, which is
+ * still stable per flow but not minimally disruptive.
+ */
+static int fwd_pick(const forwarding_engine_t *eng, const fwd_maglev_t *mg,
+                    const routing_table_view_t *view,
+                    const sad_hit_t *hits, int n,
+                    const strandlink_frame_t *frame)
+{
+    if (eng->select_mode == FWD_SELECT_P2C)
+        return fwd_pick_p2c(eng, view, hits, n);
+    if (eng->select_mode != FWD_SELECT_MAGLEV)
+        return select_next_hop(hits, n, fwd_rand());
+    if (n == 1)
+        return 0;
+
+    uint8_t key[FWD_FLOW_KEY_LEN];
+    fwd_flow_key(frame, key);
+    if (mg) {
+        int b = maglev_lookup(&mg->table, key, sizeof(key));
+        if (b >= 0 && b < FWD_MAGLEV_INDICES)
+            return mg->hop_of[b];
+    }
+    return select_next_hop(hits, n, fwd_flow_hash(key));
+}
+
+static inline fwd_maglev_t *fwd_maglev_for(const forwarding_engine_t *eng,
+                                           struct fwd_thread *self,
+                                           const routing_table_view_t *view,
+                                           const sad_hit_t *hits, int n)
+{
+    if (eng->select_mode != FWD_SELECT_MAGLEV || !self || n <= 1)
+        return NULL;
+    return fwd_maglev_get(self, view, hits, n);
+}
+
 /* --------------------------------------------------------------------------
  * Extract SAD from StrandLink frame options area
  *
@@ -120,7 +606,8 @@ static int select_next_hop(const resolve_result_t *results, int count)
  * options_offset and options_length in the header).
  * -------------------------------------------------------------------------- */
 
-static int extract_sad_from_frame(const strandlink_frame_t *frame, sad_t *sad)
+static int extract_sad_from_frame(const strandlink_frame_t *frame,
+                                  sad_view_t *sad)
 {
     const strandlink_frame_header_t *hdr = &frame->header;
 
@@ -135,16 +622,87 @@ static int extract_sad_from_frame(const strandlink_frame_t *frame, sad_t *sad)
         return -1;
 
     const uint8_t *sad_data = &frame->payload[opt_off];
-    return sad_decode(sad_data, opt_len, sad);
+    return sad_view_init(sad, sad_data, opt_len);
+}
+
+/* --------------------------------------------------------------------------
+ * Per-frame admission, shared by the single-frame and burst paths
+ *
+ * Returns FWD_ADMIT_ROUTE with @sad set if the frame should be resolved,
+ * FWD_ADMIT_EXACT with @port set if the node table already routed it,
+ * FWD_ADMIT_LOCAL if it is addressed to this node, or the
+ * forwarding_drop_reason_t it must be dropped for.
+ * -------------------------------------------------------------------------- */
+
+enum { FWD_ADMIT_ROUTE = -1, FWD_ADMIT_LOCAL = -2, FWD_ADMIT_EXACT = -3 };
+
+static int fwd_admit(const forwarding_engine_t *eng, strandlink_frame_t *frame,
+                     sad_view_t *sad, strandlink_port_t *port)
+{
+    /* If the frame is destined for us, do not forward */
+    if (node_id_equal(frame->header.dst_node_id, eng->self_id))
+        return FWD_ADMIT_LOCAL;
+
+    /* Check TTL */
+    if (frame->header.ttl == 0)
+        return FWD_DROP_TTL;
+    frame->header.ttl--;
+
+    /* Exact node_id match first: a stream whose destination is already
+     * resolved costs one probe, whether or not it still carries its SAD.
+     * An all-zero dst_node_id means "not resolved yet". */
+    node_table_hop_t hop;
+    if (eng->node_table && !node_id_is_zero(frame->header.dst_node_id) &&
+        node_table_lookup(eng->node_table, frame->header.dst_node_id, &hop) == 0) {
+        node_id_copy(frame->header.dst_node_id, hop.next_hop);
+        *port = hop.port;
+        return FWD_ADMIT_EXACT;
+    }
+
+    /* Extract SAD from options, validated in place: nothing is copied
+     * out of frame->payload.  No SAD and no exact entry -- cannot route. */
+    if (extract_sad_from_frame(frame, sad) < 0)
+        return FWD_DROP_NO_SAD;
+
+    return FWD_ADMIT_ROUTE;
+}
+
+static inline int fwd_top_k(const forwarding_engine_t *eng)
+{
+    int k = eng->max_multipath;
+    if (k > FWD_MAX_NEXT_HOPS) k = FWD_MAX_NEXT_HOPS;
+    return k;
+}
+
+/* A frame went out: one more request outstanding at its new destination */
+static inline void fwd_hop_sent(const forwarding_engine_t *eng,
+                                const strandlink_frame_t *frame)
+{
+    if (eng->hop_load)
+        hop_load_sent(eng->hop_load, frame->header.dst_node_id);
+}
+
+/* Transmit one frame and count the outcome */
+static int fwd_send_one(forwarding_engine_t *eng, struct fwd_thread *self,
+                        strandlink_port_t port, strandlink_frame_t *frame)
+{
+    if (eng->send_fn && eng->send_fn(port, frame, eng->send_ctx) < 0) {
+        fwd_count(eng, self, FWD_DROP_SEND, 1);
+        return -1;
+    }
+    fwd_count(eng, self, FWD_CTR_FORWARDED, 1);
+    fwd_hop_sent(eng, frame);
+    return 0;
 }
 
 /* --------------------------------------------------------------------------
  * forwarding_engine_process_frame
  *
  * Main forwarding hot path:
+ *   0. Exact dst_node_id hit in the node table: send to its port, done
  *   1. Extract SAD from frame options
  *   2. Resolve SAD against routing table
- *   3. Select next hop via weighted random
+ *   3. Select next hop (weighted random, or Maglev per flow)
  *   4. Rewrite dst_node_id in frame header
  *   5. Forward via send callback
  *
@@ -160,77 +718,467 @@ int forwarding_engine_process_frame(forwarding_engine_t *eng,
     if (!eng || !frame)
         return -1;
 
-    /* If the frame is destined for us, do not forward */
-    if (node_id_equal(frame->header.dst_node_id, eng->self_id))
-        return 0;
+    struct fwd_thread *self = fwd_thread_self(eng);
 
-    /* Check TTL */
-    if (frame->header.ttl == 0) {
-        atomic_fetch_add(&eng->frames_dropped, 1);
-        return -1;
+    sad_view_t query;
+    strandlink_port_t port = 0;   /* the send_fn can do its own mapping */
+    int rc = fwd_admit(eng, frame, &query, &port);
+    if (rc == FWD_ADMIT_LOCAL) {
+        fwd_count(eng, self, FWD_CTR_LOCAL, 1);
+        return 0;
     }
-    frame->header.ttl--;
-
-    /* Extract SAD from options */
-    sad_t query;
-    int rc = extract_sad_from_frame(frame, &query);
-    if (rc < 0) {
-        /* No SAD in frame -- cannot route semantically.
-         * In a real system we'd fall back to exact node_id forwarding.
-         * For now, drop. */
-        atomic_fetch_add(&eng->frames_dropped, 1);
+    if (rc == FWD_ADMIT_EXACT) {
+        fwd_count(eng, self, FWD_CTR_EXACT, 1);
+        return fwd_send_one(eng, self, port, frame);
+    }
+    if (rc != FWD_ADMIT_ROUTE) {
+        fwd_count(eng, self, rc, 1);
         return -1;
     }
 
-    /* Resolve: find top matches */
-    resolve_result_t results[FWD_MAX_NEXT_HOPS];
-    int k = eng->max_multipath;
-    if (k > FWD_MAX_NEXT_HOPS) k = FWD_MAX_NEXT_HOPS;
+    /* Resolve: find top matches as (row, score) hits against a pinned
+     * snapshot; only the chosen hop's node_id is read back out. */
+    sad_hit_t hits[FWD_MAX_NEXT_HOPS];
+    int k = fwd_top_k(eng);
 
-    int num_results = resolver_resolve(eng->routing_table, &query, results, k);
+    const routing_table_view_t *view = routing_table_pin(eng->routing_table);
+    int num_results = fwd_resolve(self, view, &query, hits, k);
     if (num_results <= 0) {
-        atomic_fetch_add(&eng->resolve_failures, 1);
-        atomic_fetch_add(&eng->frames_dropped, 1);
+        routing_table_unpin(view);
+        fwd_count(eng, self, FWD_DROP_NO_MATCH, 1);
         return -1;
     }
 
-    atomic_fetch_add(&eng->frames_resolved, 1);
+    fwd_count(eng, self, FWD_CTR_RESOLVED, 1);
+    if (eng->offload)
+        offload_record(eng->offload, &query);
 
-    /* Select next hop via weighted random */
-    int hop_idx = select_next_hop(results, num_results);
+    /* Select next hop */
+    const fwd_maglev_t *mg = fwd_maglev_for(eng, self, view, hits, num_results);
+    int hop_idx = fwd_pick(eng, mg, view, hits, num_results, frame);
     if (hop_idx < 0) {
-        atomic_fetch_add(&eng->frames_dropped, 1);
+        routing_table_unpin(view);
+        fwd_count(eng, self, FWD_DROP_NO_MATCH, 1);
         return -1;
     }
 
     /* Rewrite destination node ID */
     node_id_copy(frame->header.dst_node_id,
-                 results[hop_idx].entry.node_id);
-
-    /* Forward */
-    if (eng->send_fn) {
-        /* Use port 0 (the send_fn implementation can do its own mapping) */
-        rc = eng->send_fn(0, frame, eng->send_ctx);
-        if (rc < 0) {
-            atomic_fetch_add(&eng->frames_dropped, 1);
-            return -1;
+                 routing_table_view_node_id(view, hits[hop_idx].index));
+    routing_table_unpin(view);
+
+    return fwd_send_one(eng, self, port, frame);
+}
+
+/* --------------------------------------------------------------------------
+ * forwarding_engine_process_burst
+ *
+ * Vector variant of the hot path.  Per chunk of up to FWD_BURST_MAX
+ * frames: one snapshot pin, headers prefetched a few frames ahead, one
+ * resolve per distinct SAD byte string, one call to the burst send
+ * callback per egress port, and one update of each counter.
+ * -------------------------------------------------------------------------- */
+
+#define FWD_PREFETCH_AHEAD  4
+#define FWD_GROUP_SLOTS     (2 * FWD_BURST_MAX)   /* power of two */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define FWD_PREFETCH(p)  __builtin_prefetch((p), 1, 3)
+#else
+#define FWD_PREFETCH(p)  ((void)(p))
+#endif
+
+/* Frames of one burst whose SAD bytes are identical share a resolve */
+typedef struct {
+    const uint8_t *sad;         /* in place, in the first frame's payload */
+    uint16_t       len;
+    int            num_hits;
+    sad_hit_t      hits[FWD_MAX_NEXT_HOPS];
+    fwd_maglev_t  *maglev;      /* FWD_SELECT_MAGLEV, may be NULL */
+    uint64_t       maglev_key;  /* detects the slot being reused */
+} fwd_group_t;
+
+static uint32_t fwd_sad_hash(const uint8_t *p, uint16_t len)
+{
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    for (uint16_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int fwd_burst_chunk(forwarding_engine_t *eng,
+                           strandlink_frame_t **frames, int n)
+{
+    uint64_t ctr[FWD_STAT_COUNTERS] = { 0 };
+
+    for (int i = 0; i < n && i < FWD_PREFETCH_AHEAD; i++)
+        FWD_PREFETCH(&frames[i]->header);
+
+    struct fwd_thread *self = fwd_thread_self(eng);
+    int k = fwd_top_k(eng);
+
+    fwd_group_t groups[FWD_BURST_MAX];
+    uint8_t     slots[FWD_GROUP_SLOTS];            /* group + 1, 0 = empty */
+    int         num_groups = 0;
+    memset(slots, 0, sizeof(slots));
+
+    strandlink_frame_t *out[FWD_BURST_MAX];
+    strandlink_port_t   out_port[FWD_BURST_MAX];
+    int num_out = 0;
+
+    const routing_table_view_t *view = routing_table_pin(eng->routing_table);
+
+    for (int i = 0; i < n; i++) {
+        if (i + FWD_PREFETCH_AHEAD < n)
+            FWD_PREFETCH(&frames[i + FWD_PREFETCH_AHEAD]->header);
+
+        strandlink_frame_t *frame = frames[i];
+        sad_view_t query;
+        strandlink_port_t port = 0;
+        int rc = fwd_admit(eng, frame, &query, &port);
+        if (rc == FWD_ADMIT_LOCAL) {
+            ctr[FWD_CTR_LOCAL]++;
+            continue;
+        }
+        if (rc == FWD_ADMIT_EXACT) {
+            ctr[FWD_CTR_EXACT]++;
+            out_port[num_out] = port;
+            out[num_out++] = frame;
+            continue;
+        }
+        if (rc != FWD_ADMIT_ROUTE) {
+            ctr[rc]++;
+            continue;
+        }
+
+        /* Find or create this SAD's group */
+        uint32_t h = fwd_sad_hash(query.buf, query.length) & (FWD_GROUP_SLOTS - 1);
+        fwd_group_t *g = NULL;
+        for (; slots[h] != 0; h = (h + 1) & (FWD_GROUP_SLOTS - 1)) {
+            fwd_group_t *c = &groups[slots[h] - 1];
+            if (c->len == query.length &&
+                memcmp(c->sad, query.buf, query.length) == 0) {
+                g = c;
+                break;
+            }
+        }
+        if (!g) {
+            g = &groups[num_groups++];
+            slots[h] = (uint8_t)num_groups;
+            g->sad      = query.buf;
+            g->len      = query.length;
+            g->num_hits = fwd_resolve(self, view, &query, g->hits, k);
+            g->maglev   = NULL;
+            if (g->num_hits > 0) {
+                g->maglev = fwd_maglev_for(eng, self, view, g->hits, g->num_hits);
+                g->maglev_key = g->maglev ? g->maglev->key : 0;
+            }
         }
+
+        if (g->num_hits <= 0) {
+            ctr[FWD_DROP_NO_MATCH]++;
+            continue;
+        }
+        ctr[FWD_CTR_RESOLVED]++;
+        if (eng->offload)
+            offload_record(eng->offload, &query);
+
+        /* Another group of this chunk may have taken the table's slot */
+        if (g->maglev && g->maglev->key != g->maglev_key) {
+            g->maglev = fwd_maglev_for(eng, self, view, g->hits, g->num_hits);
+            g->maglev_key = g->maglev ? g->maglev->key : 0;
+        }
+        int hop_idx = fwd_pick(eng, g->maglev, view, g->hits, g->num_hits, frame);
+        node_id_copy(frame->header.dst_node_id,
+                     routing_table_view_node_id(view, g->hits[hop_idx].index));
+        out_port[num_out] = 0;
+        out[num_out++] = frame;
     }
 
-    atomic_fetch_add(&eng->frames_forwarded, 1);
-    return 0;
+    routing_table_unpin(view);
+
+    /* Forward: one burst per egress port, each in arrival order */
+    if (eng->send_burst_fn) {
+        strandlink_frame_t *run[FWD_BURST_MAX];
+        bool taken[FWD_BURST_MAX] = { false };
+        for (int i = 0; i < num_out; i++) {
+            if (taken[i]) continue;
+            int m = 0;
+            for (int j = i; j < num_out; j++) {
+                if (!taken[j] && out_port[j] == out_port[i]) {
+                    run[m++] = out[j];
+                    taken[j] = true;
+                }
+            }
+            int sent = eng->send_burst_fn(out_port[i], run, m,
+                                          eng->send_burst_ctx);
+            if (sent < 0) sent = 0;
+            if (sent > m) sent = m;
+            for (int j = 0; j < sent; j++)
+                fwd_hop_sent(eng, run[j]);
+            ctr[FWD_CTR_FORWARDED] += (uint64_t)sent;
+            ctr[FWD_DROP_SEND]     += (uint64_t)(m - sent);
+        }
+    } else if (eng->send_fn) {
+        for (int i = 0; i < num_out; i++) {
+            if (eng->send_fn(out_port[i], out[i], eng->send_ctx) < 0) {
+                ctr[FWD_DROP_SEND]++;
+            } else {
+                ctr[FWD_CTR_FORWARDED]++;
+                fwd_hop_sent(eng, out[i]);
+            }
+        }
+    } else {
+        ctr[FWD_CTR_FORWARDED] = (uint64_t)num_out;
+        for (int i = 0; i < num_out; i++)
+            fwd_hop_sent(eng, out[i]);
+    }
+
+    for (int c = 0; c < FWD_STAT_COUNTERS; c++)
+        fwd_count(eng, self, c, ctr[c]);
+    return (int)ctr[FWD_CTR_FORWARDED];
+}
+
+int forwarding_engine_process_burst(forwarding_engine_t *eng,
+                                    strandlink_frame_t **frames,
+                                    int count)
+{
+    if (!eng || !frames || count < 0)
+        return -1;
+
+    int forwarded = 0;
+    for (int off = 0; off < count; off += FWD_BURST_MAX) {
+        int n = count - off;
+        if (n > FWD_BURST_MAX) n = FWD_BURST_MAX;
+        forwarded += fwd_burst_chunk(eng, frames + off, n);
+    }
+    return forwarded;
 }
 
 /* --------------------------------------------------------------------------
  * Stats getters
  * -------------------------------------------------------------------------- */
 
+/* Sum of one counter over the shared slots and every thread */
+static uint64_t fwd_counter_sum(const forwarding_engine_t *eng, int ctr)
+{
+    forwarding_engine_t *e = (forwarding_engine_t *)eng;
+    uint64_t n = atomic_load_explicit(&e->shared_counters[ctr],
+                                      memory_order_relaxed);
+    for (struct fwd_thread *t = atomic_load_explicit(&e->threads,
+                                                     memory_order_acquire);
+         t; t = t->next)
+        n += atomic_load_explicit(&t->counters[ctr], memory_order_relaxed);
+    return n;
+}
+
 uint64_t forwarding_engine_frames_forwarded(const forwarding_engine_t *eng)
 {
-    return atomic_load(&eng->frames_forwarded);
+    return fwd_counter_sum(eng, FWD_CTR_FORWARDED);
 }
 
 uint64_t forwarding_engine_frames_dropped(const forwarding_engine_t *eng)
 {
-    return atomic_load(&eng->frames_dropped);
+    uint64_t n = 0;
+    for (int r = 0; r < FWD_DROP_REASONS; r++)
+        n += fwd_counter_sum(eng, r);
+    return n;
+}
+
+void forwarding_engine_cache_stats(const forwarding_engine_t *eng,
+                                   resolve_cache_stats_t *out)
+{
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!eng) return;
+
+    for (struct fwd_thread *t = atomic_load_explicit(
+             &((forwarding_engine_t *)eng)->threads, memory_order_acquire);
+         t; t = t->next) {
+        resolve_cache_stats_t s;
+        resolve_cache_stats(t->cache, &s);
+        out->hits       += s.hits;
+        out->misses     += s.misses;
+        out->stale_hits += s.stale_hits;
+    }
+}
+
+static void hist_merge(forwarding_histogram_t *dst, fwd_hist_t *src)
+{
+    dst->count += atomic_load_explicit(&src->count, memory_order_relaxed);
+    dst->sum   += atomic_load_explicit(&src->sum, memory_order_relaxed);
+    uint64_t m  = atomic_load_explicit(&src->max, memory_order_relaxed);
+    if (m > dst->max) dst->max = m;
+    for (uint32_t b = 0; b < FWD_HIST_BUCKETS; b++)
+        dst->buckets[b] += atomic_load_explicit(&src->buckets[b],
+                                                memory_order_relaxed);
+}
+
+void forwarding_engine_stats(const forwarding_engine_t *eng,
+                             forwarding_stats_t *out)
+{
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!eng) return;
+
+    forwarding_engine_t *e = (forwarding_engine_t *)eng;
+    uint64_t ctr[FWD_STAT_COUNTERS];
+    for (int c = 0; c < FWD_STAT_COUNTERS; c++)
+        ctr[c] = atomic_load_explicit(&e->shared_counters[c],
+                                      memory_order_relaxed);
+
+    for (struct fwd_thread *t = atomic_load_explicit(&e->threads,
+                                                     memory_order_acquire);
+         t; t = t->next) {
+        for (int c = 0; c < FWD_STAT_COUNTERS; c++)
+            ctr[c] += atomic_load_explicit(&t->counters[c],
+                                           memory_order_relaxed);
+        hist_merge(&out->resolve_ns, &t->resolve_ns);
+        hist_merge(&out->candidates, &t->candidates);
+        hist_merge(&out->top_k, &t->top_k);
+
+        resolve_cache_stats_t cs;
+        resolve_cache_stats(t->cache, &cs);
+        out->cache.hits       += cs.hits;
+        out->cache.misses     += cs.misses;
+        out->cache.stale_hits += cs.stale_hits;
+    }
+
+    for (int r = 0; r < FWD_DROP_REASONS; r++) {
+        out->drops[r]        = ctr[r];
+        out->frames_dropped += ctr[r];
+    }
+    out->frames_forwarded = ctr[FWD_CTR_FORWARDED];
+    out->frames_resolved  = ctr[FWD_CTR_RESOLVED];
+    out->frames_local     = ctr[FWD_CTR_LOCAL];
+    out->frames_exact     = ctr[FWD_CTR_EXACT];
+    out->resolve_failures = ctr[FWD_DROP_NO_MATCH];
+}
+
+uint64_t forwarding_histogram_quantile(const forwarding_histogram_t *h,
+                                       double q)
+{
+    if (!h || h->count == 0) return 0;
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+
+    uint64_t target = (uint64_t)(q * (double)h->count + 0.5);
+    if (target == 0) target = 1;
+    if (target > h->count) target = h->count;
+
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < FWD_HIST_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= target) {
+            uint64_t up = hist_bucket_upper(b);
+            return up < h->max ? up : h->max;
+        }
+    }
+    return h->max;
+}
+
+/* --------------------------------------------------------------------------
+ * forwarding_stats_export - Prometheus text format
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    char   *buf;
+    size_t  len;
+    size_t  off;
+    bool    overflow;
+} fwd_writer_t;
+
+static void wr(fwd_writer_t *w, const char *fmt, ...)
+{
+    if (w->overflow) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(w->buf + w->off, w->len - w->off, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= w->len - w->off) {
+        w->overflow = true;
+        return;
+    }
+    w->off += (size_t)n;
+}
+
+static void wr_counter(fwd_writer_t *w, const char *name, const char *help,
+                       uint64_t v)
+{
+    wr(w, "# HELP %s %s\n# TYPE %s counter\n%s %" PRIu64 "\n",
+       name, help, name, name, v);
+}
+
+/* Cumulative buckets, emitted only where the count changes */
+static void wr_histogram(fwd_writer_t *w, const char *name, const char *help,
+                         const forwarding_histogram_t *h)
+{
+    wr(w, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    uint64_t cum = 0;
+    for (uint32_t b = 0; b < FWD_HIST_BUCKETS; b++) {
+        if (h->buckets[b] == 0) continue;
+        cum += h->buckets[b];
+        wr(w, "%s_bucket{le=\"%" PRIu64 "\"} %" PRIu64 "\n",
+           name, hist_bucket_upper(b), cum);
+    }
+    wr(w, "%s_bucket{le=\"+Inf\"} %" PRIu64 "\n", name, h->count);
+    wr(w, "%s_sum %" PRIu64 "\n%s_count %" PRIu64 "\n",
+       name, h->sum, name, h->count);
+}
+
+int forwarding_stats_export(const forwarding_stats_t *stats,
+                            char *buf, size_t buf_len)
+{
+    if (!stats || !buf || buf_len == 0)
+        return -1;
+
+    static const char *const reason[FWD_DROP_REASONS] = {
+        [FWD_DROP_TTL]      = "ttl",
+        [FWD_DROP_NO_SAD]   = "no_sad",
+        [FWD_DROP_NO_MATCH] = "no_match",
+        [FWD_DROP_SEND]     = "send",
+    };
+
+    fwd_writer_t w = { buf, buf_len, 0, false };
+    buf[0] = '\0';
+
+    wr_counter(&w, "strandroute_frames_forwarded_total",
+               "Frames handed to the transmit callback.",
+               stats->frames_forwarded);
+    wr_counter(&w, "strandroute_frames_resolved_total",
+               "Frames whose SAD resolved to at least one next hop.",
+               stats->frames_resolved);
+    wr_counter(&w, "strandroute_frames_local_total",
+               "Frames addressed to this node.",
+               stats->frames_local);
+    wr_counter(&w, "strandroute_frames_exact_total",
+               "Frames forwarded by an exact node_id entry, unresolved.",
+               stats->frames_exact);
+
+    wr(&w, "# HELP strandroute_frames_dropped_total Frames dropped, by reason.\n"
+           "# TYPE strandroute_frames_dropped_total counter\n");
+    for (int r = 0; r < FWD_DROP_REASONS; r++)
+        wr(&w, "strandroute_frames_dropped_total{reason=\"%s\"} %" PRIu64 "\n",
+           reason[r], stats->drops[r]);
+
+    wr_counter(&w, "strandroute_resolve_cache_hits_total",
+               "Resolves served from the resolve cache.",
+               stats->cache.hits);
+    wr_counter(&w, "strandroute_resolve_cache_misses_total",
+               "Resolves that scored the routing table.",
+               stats->cache.misses);
+    wr_counter(&w, "strandroute_resolve_cache_stale_hits_total",
+               "Cache hits served within the metrics staleness bound.",
+               stats->cache.stale_hits);
+
+    wr_histogram(&w, "strandroute_resolve_latency_ns",
+                 "Resolve latency in nanoseconds.", &stats->resolve_ns);
+    wr_histogram(&w, "strandroute_resolve_candidates",
+                 "Candidate rows scored per resolve.", &stats->candidates);
+    wr_histogram(&w, "strandroute_resolve_top_k",
+                 "Next hops returned per resolve.", &stats->top_k);
+
+    return w.overflow ? -1 : (int)w.off;
 }
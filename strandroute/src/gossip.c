@@ -3,14 +3,46 @@
  *
  * Maintains an active view (small, fully connected) and a passive view
  * (larger, used for recovery).  Messages: Join, ForwardJoin, Disconnect,
- * Shuffle.  Periodic shuffle timer rotates passive view entries.
+ * Shuffle, Advertise.  Periodic shuffle timer rotates passive view entries.
+ *
+ * Capabilities spread as versioned per-origin route entries.  Every
+ * change to a known origin is stamped with a local sequence number, and
+ * each active peer has a watermark: an advertise round sends a peer only
+ * the entries changed since its watermark, many per message, one
+ * signature per message.  A newly active peer starts at zero and gets the
+ * full state once.  Receivers keep an entry only if its version is newer
+ * than the one they hold, apply a whole message in one routing table
+ * transaction and pass the change on in their next round, so a change
+ * crosses the overlay in about one interval per hop and then stops.
+ * Every few rounds a node also sends one peer its version vector
+ * (digest); the peer answers with whatever the digest lacks, which
+ * repairs lost messages.
+ *
+ * Shuffle, advertise and peer liveness run off one timing wheel turned by
+ * gossip_tick(), which also expires routing table entries whose TTL has
+ * run out (routing_table_expire(): only the due ones, one publish).
+ *
+ * Inbound messages may be queued with gossip_enqueue_message() instead
+ * of handled one by one: the queue is verified in one batch (a batch
+ * verify callback checks many Ed25519 signatures for much less than the
+ * sum of single checks; a failed batch is bisected to find the bad
+ * messages) and then dispatched in arrival order.  Control headers that
+ * verified recently are remembered per sender, so a peer repeating the
+ * same signed header (shuffles, forward joins) is not re-verified, and
+ * our own repeated headers reuse their signature.
  *
  * Reference: Leitao et al., "HyParView: A Membership Protocol for
  * Reliable Gossip-Based Broadcast", DSN 2007.
  */
 
+#define _POSIX_C_SOURCE 200809L  /* O_CLOEXEC */
+
+#include "strandroute/gossip.h"
 #include "strandroute/types.h"
 #include "strandroute/routing_table.h"
+#include "strandroute/routing_shards.h"
+#include "strandroute/sad.h"
+#include "strandroute/timer_wheel.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -19,6 +51,7 @@
 #include <time.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/uio.h>
 
 /* --------------------------------------------------------------------------
  * Constants
@@ -31,19 +64,27 @@
 #define GOSSIP_PRWL          3    /* Passive Random Walk Length for ForwardJoin */
 #define GOSSIP_DEFAULT_TTL   30   /* seconds */
 #define GOSSIP_DEFAULT_INTERVAL_MS 1000
+#define GOSSIP_WHEEL_TICK_MS 10
+#define GOSSIP_PEER_TIMEOUT_MS (3 * GOSSIP_DEFAULT_TTL * 1000)  /* silent active peer */
 
-/* --------------------------------------------------------------------------
- * Gossip message types
- * -------------------------------------------------------------------------- */
+#define GOSSIP_ADV_MAX_PAYLOAD  8192  /* bytes of entries per Advertise */
+#define GOSSIP_ADV_MAX_MSGS     8     /* Advertise messages per peer per round */
+#define GOSSIP_ADV_DIGEST_EVERY 10    /* rounds between version vector exchanges */
+
+/* Transmit pool: one buffer per Advertise of a round, plus a scratch */
+#define GOSSIP_TX_BUF_LEN  (sizeof(gossip_msg_header_t) + GOSSIP_ADV_MAX_PAYLOAD)
+#define GOSSIP_TX_BUFS     (GOSSIP_ADV_MAX_MSGS + 1)
+#define GOSSIP_TX_SCRATCH  GOSSIP_ADV_MAX_MSGS
 
-typedef enum {
-    GOSSIP_MSG_JOIN          = 0x01,
-    GOSSIP_MSG_FORWARD_JOIN  = 0x02,
-    GOSSIP_MSG_DISCONNECT    = 0x03,
-    GOSSIP_MSG_SHUFFLE       = 0x04,
-    GOSSIP_MSG_SHUFFLE_REPLY = 0x05,
-    GOSSIP_MSG_ADVERTISE     = 0x06,  /* capability advertisement */
-} gossip_msg_type_t;
+/* Inbound queue: messages verified per batch, and the arena holding
+ * their signed regions and payloads (about seven full Advertises) */
+#define GOSSIP_RX_BATCH    64
+#define GOSSIP_RX_ARENA    (64 * 1024)
+
+/* Remembered signatures over control headers */
+#define GOSSIP_VCACHE_SLOTS  64       /* verified, power of two */
+#define GOSSIP_VCACHE_TTL_MS 60000
+#define GOSSIP_SIGN_MEMO     8        /* our own signed headers */
 
 /* --------------------------------------------------------------------------
  * Peer descriptor
@@ -52,32 +93,56 @@ typedef enum {
 typedef struct {
     uint8_t  node_id[STRANDLINK_NODE_ID_LEN];
     uint16_t port;              /* overlay port for gossip */
-    uint64_t last_seen;         /* monotonic ns timestamp */
+    uint64_t last_seen;         /* gossip_tick clock (ms), 0 = not yet */
+    uint64_t adv_sent_seq;      /* origin changes up to here were advertised */
     bool     active;            /* true if slot is in use */
 } gossip_peer_t;
 
+/* Signed header prefix: msg_type..payload_len */
+#define GOSSIP_SIGNED_LEN  offsetof(gossip_msg_header_t, signature)
+#define GOSSIP_SIG_LEN     sizeof(((gossip_msg_header_t *)0)->signature)
+
+/* Advertise payload: see gossip.h */
+#define GOSSIP_ADV_DIGEST_HDR  (GOSSIP_ADV_HDR_LEN + 2 * STRANDLINK_NODE_ID_LEN)
+#define GOSSIP_ADV_DIGEST_ITEM (STRANDLINK_NODE_ID_LEN + 4)
+
+/* Latest known entry of one origin */
+typedef struct {
+    uint8_t  node_id[STRANDLINK_NODE_ID_LEN];
+    uint8_t  from[STRANDLINK_NODE_ID_LEN];  /* peer it came from, zero = self */
+    uint32_t version;
+    uint64_t seq;               /* local change sequence number */
+    uint64_t updated_ms;        /* gossip_tick clock at the change */
+    uint16_t len;
+    uint8_t *entry;             /* wire form */
+    const uint8_t *staged;      /* newer entry in the delta being applied */
+} gossip_origin_t;
+
 /* --------------------------------------------------------------------------
- * Gossip message (on-wire format, packed)
+ * Signature verification
  * -------------------------------------------------------------------------- */
 
-typedef struct __attribute__((packed)) {
-    uint8_t  msg_type;
-    uint8_t  ttl;
-    uint8_t  sender_id[STRANDLINK_NODE_ID_LEN];
-    uint8_t  origin_id[STRANDLINK_NODE_ID_LEN];  /* original initiator */
-    uint16_t payload_len;
-    /* Ed25519 signature over all preceding fields (msg_type..payload_len).
-     * Populated when gossip_set_auth_fn() has been called.
-     * Zero-filled when no signing callback is configured. */
-    uint8_t  signature[64];
-    /* payload follows */
-} gossip_msg_header_t;
+/* Queued inbound message.  The arena holds its signed region at off: the
+ * header prefix, then pl payload bytes (covered by the signature only
+ * for Advertise). */
+typedef struct {
+    uint32_t off;
+    uint16_t pl;
+    uint8_t  sig[GOSSIP_SIG_LEN];
+} gossip_rx_msg_t;
+
+/* A good signature over a control header prefix */
+typedef struct {
+    uint64_t expires_ms;        /* 0 = empty */
+    uint8_t  prefix[GOSSIP_SIGNED_LEN];
+    uint8_t  sig[GOSSIP_SIG_LEN];
+} gossip_sig_memo_t;
 
 /* --------------------------------------------------------------------------
  * Gossip state
  * -------------------------------------------------------------------------- */
 
-typedef struct {
+struct gossip_state {
     uint8_t         self_id[STRANDLINK_NODE_ID_LEN];
     gossip_peer_t   active_view[GOSSIP_MAX_ACTIVE];
     gossip_peer_t   passive_view[GOSSIP_MAX_PASSIVE];
@@ -85,15 +150,32 @@ typedef struct {
     int             passive_count;
     uint32_t        shuffle_timer_ms;
     uint32_t        advertise_interval_ms;
+    uint32_t        peer_timeout_ms;  /* 0 = never drop silent peers */
     uint64_t        last_shuffle_ts;
     uint64_t        last_advertise_ts;
+
+    /* Timers in the gossip_tick clock; intervals are read when a timer
+     * is re-armed */
+    timer_wheel_t  *wheel;            /* created by the first tick */
+    uint32_t        shuffle_timer;
+    uint32_t        advertise_timer;
+    uint32_t        liveness_timer;
     routing_table_t *routing_table;   /* owned externally */
+    routing_shards_t *routing_shards; /* owned externally; replaces it */
+    gossip_shard_key_fn shard_key_fn; /* partition of each entry we learn */
+    void           *shard_key_ctx;
 
     /* Callback for sending gossip messages */
     int (*send_fn)(const uint8_t dst_node_id[STRANDLINK_NODE_ID_LEN],
                    const void *msg, size_t msg_len, void *ctx);
     void *send_ctx;
 
+    /* Vectored variant, preferred when set: header and payload are passed
+     * as separate iovecs and never copied into one buffer */
+    int (*sendv_fn)(const uint8_t dst_node_id[STRANDLINK_NODE_ID_LEN],
+                    const struct iovec *iov, int iovcnt, void *ctx);
+    void *sendv_ctx;
+
     /* Authentication callbacks for StrandTrust integration (spec NR-G-005).
      * When set, outgoing messages are signed and incoming messages are
      * verified before processing.  A failed verification causes rejection. */
@@ -102,7 +184,38 @@ typedef struct {
     int (*verify_fn)(const void *msg, size_t msg_len,
                      const uint8_t sig[64], void *ctx);
     void *auth_ctx;
-} gossip_state_t;
+
+    /* Used instead of verify_fn when set */
+    gossip_verify_batch_fn verify_batch_fn;
+
+    /* Inbound queue, verified and dispatched by gossip_flush_messages() */
+    uint8_t          *rx_arena;         /* GOSSIP_RX_ARENA, on first use */
+    uint32_t          rx_used;
+    int               rx_count;
+    gossip_rx_msg_t   rx_queue[GOSSIP_RX_BATCH];
+
+    gossip_sig_memo_t verified[GOSSIP_VCACHE_SLOTS];
+    gossip_sig_memo_t signed_memo[GOSSIP_SIGN_MEMO];
+
+    /* Capability advertisement */
+    gossip_origin_t *origins;
+    uint32_t         num_origins;
+    uint32_t         max_origins;
+    int32_t         *origin_index;      /* open addressing into origins */
+    uint32_t         origin_index_mask;
+    uint64_t         adv_seq;           /* last change sequence number */
+    uint64_t         clock_ms;          /* caller's clock at the last tick */
+    uint32_t         adv_rounds;
+    uint32_t         self_version;      /* 0 = no local entry */
+    uint64_t         self_refresh_ms;
+
+    /* Reused across rounds: allocated on first use, grown only with the
+     * number of origins */
+    uint8_t         *tx_pool;           /* GOSSIP_TX_BUFS x GOSSIP_TX_BUF_LEN */
+    gossip_origin_t **tx_list;
+    gossip_origin_t **tx_prev;          /* list the pool's messages hold */
+    uint32_t         tx_list_cap;
+};
 
 /* --------------------------------------------------------------------------
  * Helpers: pseudo-random via xorshift
@@ -175,9 +288,10 @@ static int view_add(gossip_peer_t *view, int *count, int max_count,
 
     gossip_peer_t *p = &view[*count];
     node_id_copy(p->node_id, node_id);
-    p->port      = port;
-    p->last_seen = 0;
-    p->active    = true;
+    p->port         = port;
+    p->last_seen    = 0;
+    p->adv_sent_seq = 0;
+    p->active       = true;
     (*count)++;
     return 0;
 }
@@ -203,12 +317,58 @@ static int find_peer_idx(gossip_peer_t *view, int count,
     return -1;
 }
 
+/* --------------------------------------------------------------------------
+ * Remembered signatures
+ * -------------------------------------------------------------------------- */
+
+static uint32_t gossip_memo_hash(const uint8_t *p, size_t len, uint32_t h)
+{
+    for (size_t i = 0; i < len; i++) {   /* FNV-1a */
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Slot a control header and its signature are remembered in; the
+ * prefix includes the sender, so each peer's headers are kept apart */
+static gossip_sig_memo_t *gossip_vcache_slot(gossip_state_t *gs,
+                                             const uint8_t *prefix,
+                                             const uint8_t *sig)
+{
+    uint32_t h = gossip_memo_hash(prefix, GOSSIP_SIGNED_LEN, 2166136261u);
+    h = gossip_memo_hash(sig, GOSSIP_SIG_LEN, h);
+    return &gs->verified[h & (GOSSIP_VCACHE_SLOTS - 1)];
+}
+
+/* Whether exactly this header and signature verified recently.  Whole
+ * bytes are compared, so a hash collision can only cost a miss. */
+static bool gossip_vcache_hit(gossip_state_t *gs, const uint8_t *prefix,
+                              const uint8_t *sig)
+{
+    const gossip_sig_memo_t *m = gossip_vcache_slot(gs, prefix, sig);
+    return m->expires_ms > gs->clock_ms &&
+           memcmp(m->prefix, prefix, GOSSIP_SIGNED_LEN) == 0 &&
+           memcmp(m->sig, sig, GOSSIP_SIG_LEN) == 0;
+}
+
+static void gossip_vcache_add(gossip_state_t *gs, const uint8_t *prefix,
+                              const uint8_t *sig)
+{
+    gossip_sig_memo_t *m = gossip_vcache_slot(gs, prefix, sig);
+    memcpy(m->prefix, prefix, GOSSIP_SIGNED_LEN);
+    memcpy(m->sig, sig, GOSSIP_SIG_LEN);
+    m->expires_ms = gs->clock_ms + GOSSIP_VCACHE_TTL_MS;
+}
+
 /* --------------------------------------------------------------------------
  * gossip_sign_header
  *
  * Sign a gossip header in-place when a signing callback is configured.
  * The signature covers all header fields up to (but not including) the
  * signature field itself -- the same region verified in gossip_handle_message.
+ * A header identical to one signed before reuses its signature: a valid
+ * signature over the same bytes stays valid.
  * Returns 0 on success or when no sign_fn is set, -1 on signing failure.
  * -------------------------------------------------------------------------- */
 
@@ -216,23 +376,87 @@ static int gossip_sign_header(gossip_state_t *gs, gossip_msg_header_t *hdr)
 {
     if (!gs->sign_fn)
         return 0;
-    static const size_t signed_len = offsetof(gossip_msg_header_t, signature);
-    return gs->sign_fn(hdr, signed_len, hdr->signature, gs->auth_ctx);
+
+    const uint8_t *prefix = (const uint8_t *)hdr;
+    gossip_sig_memo_t *m = &gs->signed_memo[
+        gossip_memo_hash(prefix, GOSSIP_SIGNED_LEN, 2166136261u) % GOSSIP_SIGN_MEMO];
+    if (m->expires_ms && memcmp(m->prefix, prefix, GOSSIP_SIGNED_LEN) == 0) {
+        memcpy(hdr->signature, m->sig, GOSSIP_SIG_LEN);
+        return 0;
+    }
+
+    int rc = gs->sign_fn(hdr, GOSSIP_SIGNED_LEN, hdr->signature, gs->auth_ctx);
+    if (rc == 0) {
+        memcpy(m->prefix, prefix, GOSSIP_SIGNED_LEN);
+        memcpy(m->sig, hdr->signature, GOSSIP_SIG_LEN);
+        m->expires_ms = UINT64_MAX;     /* valid until the key changes */
+    }
+    return rc;
+}
+
+static bool gossip_auth_enabled(const gossip_state_t *gs)
+{
+    return gs->verify_fn || gs->verify_batch_fn;
+}
+
+/* Check one signature with whichever callback is installed */
+static int gossip_verify_region(gossip_state_t *gs, const void *region,
+                                size_t len, const uint8_t *sig)
+{
+    if (gs->verify_fn)
+        return gs->verify_fn(region, len, sig, gs->auth_ctx);
+    gossip_sig_item_t item = { region, len, sig };
+    return gs->verify_batch_fn(&item, 1, gs->auth_ctx);
+}
+
+/*
+ * Verify @n items, setting good[i].  A batch that fails is split in two
+ * and each half retried, so k bad signatures among n cost about
+ * 2k log2(n / k) extra batch calls rather than n single checks.
+ */
+static void gossip_verify_items(gossip_state_t *gs,
+                                const gossip_sig_item_t *items, int n,
+                                uint8_t *good)
+{
+    if (n <= 0)
+        return;
+    if (!gs->verify_batch_fn) {
+        for (int i = 0; i < n; i++)
+            good[i] = gs->verify_fn(items[i].msg, items[i].msg_len,
+                                    items[i].sig, gs->auth_ctx) == 0;
+        return;
+    }
+    if (gs->verify_batch_fn(items, n, gs->auth_ctx) == 0) {
+        memset(good, 1, (size_t)n);
+        return;
+    }
+    if (n == 1) {
+        good[0] = 0;
+        return;
+    }
+    int half = n / 2;
+    gossip_verify_items(gs, items, half, good);
+    gossip_verify_items(gs, items + half, n - half, good + half);
 }
 
 /* --------------------------------------------------------------------------
- * gossip_init
+ * gossip_create
  * -------------------------------------------------------------------------- */
 
-void gossip_init(gossip_state_t *gs,
-                 const uint8_t self_id[STRANDLINK_NODE_ID_LEN],
-                 routing_table_t *rt)
+gossip_state_t *gossip_create(const uint8_t self_id[STRANDLINK_NODE_ID_LEN],
+                              routing_table_t *rt)
 {
-    memset(gs, 0, sizeof(*gs));
+    if (!self_id)
+        return NULL;
+    gossip_state_t *gs = calloc(1, sizeof(*gs));
+    if (!gs)
+        return NULL;
     node_id_copy(gs->self_id, self_id);
     gs->routing_table        = rt;
     gs->shuffle_timer_ms     = GOSSIP_DEFAULT_INTERVAL_MS * 10;
     gs->advertise_interval_ms = GOSSIP_DEFAULT_INTERVAL_MS;
+    gs->peer_timeout_ms      = GOSSIP_PEER_TIMEOUT_MS;
+    return gs;
 }
 
 void gossip_set_send_fn(gossip_state_t *gs,
@@ -243,22 +467,103 @@ void gossip_set_send_fn(gossip_state_t *gs,
     gs->send_ctx = ctx;
 }
 
+void gossip_set_routing_shards(gossip_state_t *gs, routing_shards_t *rs,
+                               gossip_shard_key_fn key_fn, void *ctx)
+{
+    gs->routing_shards = rs;
+    gs->shard_key_fn   = key_fn;
+    gs->shard_key_ctx  = ctx;
+}
+
+void gossip_set_sendv_fn(gossip_state_t *gs,
+                         int (*fn)(const uint8_t *, const struct iovec *, int, void *),
+                         void *ctx)
+{
+    gs->sendv_fn  = fn;
+    gs->sendv_ctx = ctx;
+}
+
+static bool gossip_can_send(const gossip_state_t *gs)
+{
+    return gs->send_fn || gs->sendv_fn;
+}
+
+/* Pool buffer @i, or NULL if the pool cannot be allocated */
+static uint8_t *gossip_tx_buf(gossip_state_t *gs, int i)
+{
+    if (!gs->tx_pool) {
+        gs->tx_pool = malloc(GOSSIP_TX_BUFS * GOSSIP_TX_BUF_LEN);
+        if (!gs->tx_pool)
+            return NULL;
+    }
+    return gs->tx_pool + (size_t)i * GOSSIP_TX_BUF_LEN;
+}
+
+/*
+ * Send @hdr and @pl bytes of @payload.  Through sendv_fn they go out as
+ * two iovecs wherever they are; send_fn needs one buffer, so a payload
+ * that does not directly follow its header is first copied behind one
+ * in the pool's scratch buffer.
+ */
+static int gossip_emit(gossip_state_t *gs,
+                       const uint8_t dst[STRANDLINK_NODE_ID_LEN],
+                       const gossip_msg_header_t *hdr,
+                       const uint8_t *payload, size_t pl)
+{
+    if (gs->sendv_fn) {
+        struct iovec iov[2];
+        iov[0].iov_base = (void *)hdr;
+        iov[0].iov_len  = sizeof(*hdr);
+        iov[1].iov_base = (void *)payload;
+        iov[1].iov_len  = pl;
+        return gs->sendv_fn(dst, iov, pl ? 2 : 1, gs->sendv_ctx);
+    }
+    if (!gs->send_fn)
+        return -1;
+    if (pl == 0 || payload == (const uint8_t *)(hdr + 1))
+        return gs->send_fn(dst, hdr, sizeof(*hdr) + pl, gs->send_ctx);
+
+    uint8_t *buf = gossip_tx_buf(gs, GOSSIP_TX_SCRATCH);
+    if (!buf || pl > GOSSIP_ADV_MAX_PAYLOAD)
+        return -1;
+    memcpy(buf, hdr, sizeof(*hdr));
+    memcpy(buf + sizeof(*hdr), payload, pl);
+    return gs->send_fn(dst, buf, sizeof(*hdr) + pl, gs->send_ctx);
+}
+
+/* Forget remembered signatures: the keys they were made with may be gone */
+static void gossip_auth_reset(gossip_state_t *gs)
+{
+    memset(gs->verified, 0, sizeof(gs->verified));
+    memset(gs->signed_memo, 0, sizeof(gs->signed_memo));
+}
+
 /* Install StrandTrust authentication callbacks (spec NR-G-005).
  * sign_fn:   called to sign outgoing message headers.
  * verify_fn: called to verify incoming message headers; returns 0 on success.
  * ctx:       opaque context passed to both callbacks.
- * Pass NULL for all parameters to disable authentication.
+ * Pass NULL for all parameters to disable authentication.  Queued
+ * messages are handled first, under the callbacks they arrived with.
  */
 void gossip_set_auth_fn(gossip_state_t *gs,
                         int (*sign_fn)(const void *, size_t, uint8_t[64], void *),
                         int (*verify_fn)(const void *, size_t, const uint8_t[64], void *),
                         void *ctx)
 {
+    gossip_flush_messages(gs);
+    gossip_auth_reset(gs);
     gs->sign_fn   = sign_fn;
     gs->verify_fn = verify_fn;
     gs->auth_ctx  = ctx;
 }
 
+void gossip_set_verify_batch_fn(gossip_state_t *gs, gossip_verify_batch_fn fn)
+{
+    gossip_flush_messages(gs);
+    gossip_auth_reset(gs);
+    gs->verify_batch_fn = fn;
+}
+
 /* --------------------------------------------------------------------------
  * gossip_handle_join
  *
@@ -283,13 +588,13 @@ int gossip_handle_join(gossip_state_t *gs,
                  GOSSIP_MAX_PASSIVE, evicted.node_id, evicted.port);
 
         /* Send disconnect to evicted peer */
-        if (gs->send_fn) {
+        if (gossip_can_send(gs)) {
             gossip_msg_header_t hdr;
             memset(&hdr, 0, sizeof(hdr));
             hdr.msg_type = GOSSIP_MSG_DISCONNECT;
             node_id_copy(hdr.sender_id, gs->self_id);
             if (gossip_sign_header(gs, &hdr) == 0)
-                gs->send_fn(evicted.node_id, &hdr, sizeof(hdr), gs->send_ctx);
+                gossip_emit(gs, evicted.node_id, &hdr, NULL, 0);
         }
     }
 
@@ -297,8 +602,9 @@ int gossip_handle_join(gossip_state_t *gs,
     view_add(gs->active_view, &gs->active_count,
              GOSSIP_MAX_ACTIVE, new_node, port);
 
-    /* Forward join to all active peers (with TTL=ARWL) */
-    if (gs->send_fn) {
+    /* Forward join to all active peers (with TTL=ARWL): one signed
+     * header serves every peer */
+    if (gossip_can_send(gs)) {
         gossip_msg_header_t hdr;
         memset(&hdr, 0, sizeof(hdr));
         hdr.msg_type = GOSSIP_MSG_FORWARD_JOIN;
@@ -308,10 +614,8 @@ int gossip_handle_join(gossip_state_t *gs,
 
         if (gossip_sign_header(gs, &hdr) == 0) {
             for (int i = 0; i < gs->active_count; i++) {
-                if (!node_id_equal(gs->active_view[i].node_id, new_node)) {
-                    gs->send_fn(gs->active_view[i].node_id,
-                                &hdr, sizeof(hdr), gs->send_ctx);
-                }
+                if (!node_id_equal(gs->active_view[i].node_id, new_node))
+                    gossip_emit(gs, gs->active_view[i].node_id, &hdr, NULL, 0);
             }
         }
     }
@@ -351,7 +655,7 @@ int gossip_handle_forward_join(gossip_state_t *gs,
     }
 
     /* Forward to a random active peer (not the sender or origin) */
-    if (gs->active_count > 0 && gs->send_fn) {
+    if (gs->active_count > 0 && gossip_can_send(gs)) {
         int attempts = 0;
         int idx = gossip_rand_range(gs->active_count);
         while (attempts < gs->active_count &&
@@ -369,8 +673,7 @@ int gossip_handle_forward_join(gossip_state_t *gs,
             node_id_copy(hdr.sender_id, gs->self_id);
             node_id_copy(hdr.origin_id, origin);
             if (gossip_sign_header(gs, &hdr) == 0)
-                gs->send_fn(gs->active_view[idx].node_id,
-                            &hdr, sizeof(hdr), gs->send_ctx);
+                gossip_emit(gs, gs->active_view[idx].node_id, &hdr, NULL, 0);
         }
     }
 
@@ -436,28 +739,20 @@ int gossip_do_shuffle(gossip_state_t *gs)
         shuffle_count++;
     }
 
-    /* Send shuffle message */
-    if (gs->send_fn && shuffle_count > 0) {
-        /* Build message: header + array of node IDs */
+    /* Send shuffle message: header + array of node IDs */
+    if (gossip_can_send(gs) && shuffle_count > 0) {
         size_t payload_len = (size_t)shuffle_count * STRANDLINK_NODE_ID_LEN;
-        size_t msg_len = sizeof(gossip_msg_header_t) + payload_len;
-        uint8_t *msg = malloc(msg_len);
-        if (msg) {
-            gossip_msg_header_t *hdr = (gossip_msg_header_t *)msg;
-            memset(hdr, 0, sizeof(*hdr));
-            hdr->msg_type    = GOSSIP_MSG_SHUFFLE;
-            hdr->ttl         = GOSSIP_ARWL;
-            node_id_copy(hdr->sender_id, gs->self_id);
-            node_id_copy(hdr->origin_id, gs->self_id);
-            hdr->payload_len = (uint16_t)payload_len;
-
-            memcpy(msg + sizeof(gossip_msg_header_t),
-                   shuffle_set, payload_len);
-
-            if (gossip_sign_header(gs, hdr) == 0)
-                gs->send_fn(target->node_id, msg, msg_len, gs->send_ctx);
-            free(msg);
-        }
+        gossip_msg_header_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_type    = GOSSIP_MSG_SHUFFLE;
+        hdr.ttl         = GOSSIP_ARWL;
+        node_id_copy(hdr.sender_id, gs->self_id);
+        node_id_copy(hdr.origin_id, gs->self_id);
+        hdr.payload_len = (uint16_t)payload_len;
+
+        if (gossip_sign_header(gs, &hdr) == 0)
+            gossip_emit(gs, target->node_id, &hdr,
+                        &shuffle_set[0][0], payload_len);
     }
 
     return 0;
@@ -495,7 +790,7 @@ int gossip_handle_shuffle(gossip_state_t *gs,
     }
 
     /* Send shuffle reply with our own entries */
-    if (gs->send_fn) {
+    if (gossip_can_send(gs)) {
         int reply_count = 0;
         uint8_t reply_set[GOSSIP_SHUFFLE_LEN][STRANDLINK_NODE_ID_LEN];
 
@@ -508,48 +803,827 @@ int gossip_handle_shuffle(gossip_state_t *gs,
 
         if (reply_count > 0) {
             size_t rpl = (size_t)reply_count * STRANDLINK_NODE_ID_LEN;
-            size_t msg_len = sizeof(gossip_msg_header_t) + rpl;
-            uint8_t *msg = malloc(msg_len);
-            if (msg) {
-                gossip_msg_header_t *hdr = (gossip_msg_header_t *)msg;
-                memset(hdr, 0, sizeof(*hdr));
-                hdr->msg_type    = GOSSIP_MSG_SHUFFLE_REPLY;
-                node_id_copy(hdr->sender_id, gs->self_id);
-                node_id_copy(hdr->origin_id, gs->self_id);
-                hdr->payload_len = (uint16_t)rpl;
-                memcpy(msg + sizeof(gossip_msg_header_t), reply_set, rpl);
-                if (gossip_sign_header(gs, hdr) == 0)
-                    gs->send_fn(sender, msg, msg_len, gs->send_ctx);
-                free(msg);
+            gossip_msg_header_t hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_type    = GOSSIP_MSG_SHUFFLE_REPLY;
+            node_id_copy(hdr.sender_id, gs->self_id);
+            node_id_copy(hdr.origin_id, gs->self_id);
+            hdr.payload_len = (uint16_t)rpl;
+            if (gossip_sign_header(gs, &hdr) == 0)
+                gossip_emit(gs, sender, &hdr, &reply_set[0][0], rpl);
+        }
+    }
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * Advertise: wire helpers
+ * -------------------------------------------------------------------------- */
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >>  8); p[3] = (uint8_t)v;
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] <<  8) |  (uint32_t)p[3];
+}
+
+static uint64_t gossip_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Version of an entry in wire form */
+static uint32_t entry_version(const uint8_t *e)
+{
+    return get32(e + STRANDLINK_NODE_ID_LEN);
+}
+
+/* Length of the entry at @p, or 0 if it does not fit in @avail bytes */
+static size_t entry_len(const uint8_t *p, size_t avail)
+{
+    if (avail < GOSSIP_ADV_ENTRY_FIXED)
+        return 0;
+    size_t sad_len = get16(p + GOSSIP_ADV_ENTRY_FIXED - 2);
+    if (sad_len > SAD_MAX_SIZE || GOSSIP_ADV_ENTRY_FIXED + sad_len > avail)
+        return 0;
+    return GOSSIP_ADV_ENTRY_FIXED + sad_len;
+}
+
+/* The fixed fields of the route entry an advertised entry stands for;
+ * the SAD is decoded separately, in batches */
+static void entry_fields(const uint8_t *p, uint64_t now_ns, route_entry_t *out)
+{
+    const uint8_t *f = p + STRANDLINK_NODE_ID_LEN + 4;
+
+    node_id_copy(out->node_id, p);
+    out->latency_us   = get32(f);
+    out->cost_milli   = get32(f + 4);
+    out->ttl_ns       = (uint64_t)get32(f + 8) * 1000000ull;
+    out->region_code  = get16(f + 12);
+    out->trust_level  = f[14];
+    out->last_updated = now_ns;
+}
+
+/* --------------------------------------------------------------------------
+ * Advertise: origin table
+ * -------------------------------------------------------------------------- */
+
+static uint32_t origin_hash(const uint8_t id[STRANDLINK_NODE_ID_LEN])
+{
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    for (int i = 0; i < STRANDLINK_NODE_ID_LEN; i++) {
+        h ^= id[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static gossip_origin_t *origin_find(const gossip_state_t *gs,
+                                    const uint8_t id[STRANDLINK_NODE_ID_LEN])
+{
+    if (!gs->origin_index)
+        return NULL;
+    for (uint32_t i = origin_hash(id) & gs->origin_index_mask;
+         gs->origin_index[i] >= 0; i = (i + 1) & gs->origin_index_mask) {
+        gossip_origin_t *o = &gs->origins[gs->origin_index[i]];
+        if (node_id_equal(o->node_id, id))
+            return o;
+    }
+    return NULL;
+}
+
+static int origin_reindex(gossip_state_t *gs, uint32_t slots)
+{
+    int32_t *idx = malloc(slots * sizeof(*idx));
+    if (!idx)
+        return -1;
+    memset(idx, 0xFF, slots * sizeof(*idx));    /* all -1 */
+    for (uint32_t n = 0; n < gs->num_origins; n++) {
+        uint32_t i = origin_hash(gs->origins[n].node_id) & (slots - 1);
+        while (idx[i] >= 0)
+            i = (i + 1) & (slots - 1);
+        idx[i] = (int32_t)n;
+    }
+    free(gs->origin_index);
+    gs->origin_index      = idx;
+    gs->origin_index_mask = slots - 1;
+    return 0;
+}
+
+/* Record for @id, created empty (version 0) if unknown */
+static gossip_origin_t *origin_get(gossip_state_t *gs,
+                                   const uint8_t id[STRANDLINK_NODE_ID_LEN])
+{
+    gossip_origin_t *o = origin_find(gs, id);
+    if (o)
+        return o;
+
+    if (gs->num_origins == gs->max_origins) {
+        uint32_t cap = gs->max_origins ? 2 * gs->max_origins : 64;
+        gossip_origin_t *grown = realloc(gs->origins, cap * sizeof(*grown));
+        if (!grown)
+            return NULL;
+        gs->origins     = grown;
+        gs->max_origins = cap;
+    }
+    /* At most half load; max_origins is a power of two */
+    if (!gs->origin_index || 2 * (gs->num_origins + 1) > gs->origin_index_mask + 1) {
+        if (origin_reindex(gs, 2 * gs->max_origins) != 0)
+            return NULL;
+    }
+
+    o = &gs->origins[gs->num_origins];
+    memset(o, 0, sizeof(*o));
+    node_id_copy(o->node_id, id);
+    uint32_t i = origin_hash(id) & gs->origin_index_mask;
+    while (gs->origin_index[i] >= 0)
+        i = (i + 1) & gs->origin_index_mask;
+    gs->origin_index[i] = (int32_t)gs->num_origins++;
+    return o;
+}
+
+/* Version a new entry for @o must beat: the one we hold, or the one an
+ * earlier entry of the delta being applied staged */
+static uint32_t origin_floor(const gossip_origin_t *o)
+{
+    if (!o)
+        return 0;
+    return o->staged ? entry_version(o->staged) : o->version;
+}
+
+/* Store a newer entry for @o and stamp it as a change */
+static int origin_update(gossip_state_t *gs, gossip_origin_t *o,
+                         const uint8_t from[STRANDLINK_NODE_ID_LEN],
+                         const uint8_t *entry, size_t len, uint64_t now_ms)
+{
+    if (len > o->len || !o->entry) {
+        uint8_t *buf = realloc(o->entry, len);
+        if (!buf)
+            return -1;
+        o->entry = buf;
+    }
+    memcpy(o->entry, entry, len);
+    o->len        = (uint16_t)len;
+    o->version    = entry_version(entry);
+    o->seq        = ++gs->adv_seq;
+    o->updated_ms = now_ms;
+    if (from)
+        node_id_copy(o->from, from);
+    else
+        memset(o->from, 0, sizeof(o->from));
+    return 0;
+}
+
+/* Forget origins silent for three TTLs; they stopped refreshing */
+static void origin_prune(gossip_state_t *gs, uint64_t now_ms)
+{
+    uint64_t horizon = 3ull * GOSSIP_DEFAULT_TTL * 1000;
+    uint32_t kept = 0;
+    for (uint32_t n = 0; n < gs->num_origins; n++) {
+        gossip_origin_t *o = &gs->origins[n];
+        bool self = node_id_equal(o->node_id, gs->self_id);
+        if (!self && now_ms - o->updated_ms > horizon) {
+            free(o->entry);
+            continue;
+        }
+        gs->origins[kept++] = *o;
+    }
+    if (kept != gs->num_origins) {
+        gs->num_origins = kept;
+        origin_reindex(gs, gs->origin_index_mask + 1);
+    }
+}
+
+static int origin_seq_cmp(const void *a, const void *b)
+{
+    const gossip_origin_t *x = *(const gossip_origin_t *const *)a;
+    const gossip_origin_t *y = *(const gossip_origin_t *const *)b;
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+static int origin_id_cmp(const void *a, const void *b)
+{
+    const gossip_origin_t *x = *(const gossip_origin_t *const *)a;
+    const gossip_origin_t *y = *(const gossip_origin_t *const *)b;
+    return memcmp(x->node_id, y->node_id, STRANDLINK_NODE_ID_LEN);
+}
+
+/* --------------------------------------------------------------------------
+ * Advertise: sending
+ * -------------------------------------------------------------------------- */
+
+/*
+ * Fill in the header of the Advertise in @msg (a pool buffer, @pl payload
+ * bytes already in place) and sign it.  Unlike the control messages,
+ * whose payloads carry nothing a forger could exploit, the signature
+ * covers the payload too: it is the (single) signature of every entry in
+ * the batch.  The signed region (header prefix, then payload) is formed
+ * in place by copying the prefix into the tail of the signature field,
+ * which is rewritten afterwards.
+ */
+_Static_assert(sizeof(gossip_msg_header_t) -
+               offsetof(gossip_msg_header_t, signature) >=
+               offsetof(gossip_msg_header_t, signature),
+               "signed prefix must fit in the signature field");
+
+static int gossip_seal_advertise(gossip_state_t *gs, uint8_t *msg, size_t pl)
+{
+    gossip_msg_header_t *hdr = (gossip_msg_header_t *)msg;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->msg_type    = GOSSIP_MSG_ADVERTISE;
+    node_id_copy(hdr->sender_id, gs->self_id);
+    node_id_copy(hdr->origin_id, gs->self_id);
+    hdr->payload_len = (uint16_t)pl;
+
+    if (!gs->sign_fn)
+        return 0;
+    static const size_t signed_len = offsetof(gossip_msg_header_t, signature);
+    uint8_t *region = msg + sizeof(*hdr) - signed_len;
+    uint8_t sig[sizeof(hdr->signature)];
+    memcpy(region, msg, signed_len);
+    int rc = gs->sign_fn(region, signed_len + pl, sig, gs->auth_ctx);
+    memcpy(hdr->signature, sig, sizeof(sig));
+    return rc;
+}
+
+/* Received messages are const, so the region is assembled in the pool's
+ * scratch buffer; nothing we send is larger than it */
+static int gossip_verify_advertise(gossip_state_t *gs, const uint8_t *msg,
+                                   size_t msg_len)
+{
+    static const size_t signed_len = offsetof(gossip_msg_header_t, signature);
+    size_t pl = msg_len - sizeof(gossip_msg_header_t);
+    uint8_t *region = gossip_tx_buf(gs, GOSSIP_TX_SCRATCH);
+    if (!region || pl > GOSSIP_ADV_MAX_PAYLOAD)
+        return -1;
+    memcpy(region, msg, signed_len);
+    memcpy(region + signed_len, msg + sizeof(gossip_msg_header_t), pl);
+    return gossip_verify_region(gs, region, signed_len + pl,
+                                ((const gossip_msg_header_t *)msg)->signature);
+}
+
+/* Sealed deltas in the pool's first @msgs buffers: message m carries
+ * entries up to upto[m] of the list it was built from */
+typedef struct {
+    int      msgs;
+    uint32_t upto[GOSSIP_ADV_MAX_MSGS];
+    uint16_t pl[GOSSIP_ADV_MAX_MSGS];
+} gossip_sealed_t;
+
+/* Pack the entries of @list into at most GOSSIP_ADV_MAX_MSGS signed deltas */
+static int gossip_seal_entries(gossip_state_t *gs, gossip_origin_t **list,
+                               uint32_t n, gossip_sealed_t *sealed)
+{
+    uint32_t done = 0;
+
+    sealed->msgs = 0;
+    for (int m = 0; m < GOSSIP_ADV_MAX_MSGS && done < n; m++) {
+        uint8_t *msg = gossip_tx_buf(gs, m);
+        if (!msg)
+            return -1;
+        uint8_t *payload = msg + sizeof(gossip_msg_header_t);
+        size_t   pl      = GOSSIP_ADV_HDR_LEN;
+        uint16_t count   = 0;
+        while (done < n && pl + list[done]->len <= GOSSIP_ADV_MAX_PAYLOAD) {
+            memcpy(payload + pl, list[done]->entry, list[done]->len);
+            pl += list[done]->len;
+            count++;
+            done++;
+        }
+        payload[0] = GOSSIP_ADV_DELTA;
+        payload[1] = 0;
+        put16(payload + 2, count);
+        if (gossip_seal_advertise(gs, msg, pl) != 0)
+            return -1;
+        sealed->upto[m] = done;
+        sealed->pl[m]   = (uint16_t)pl;
+        sealed->msgs    = m + 1;
+    }
+    return 0;
+}
+
+/* Send sealed deltas to @dst; returns how many list entries went out */
+static uint32_t gossip_send_sealed(gossip_state_t *gs,
+                                   const uint8_t dst[STRANDLINK_NODE_ID_LEN],
+                                   const gossip_sealed_t *sealed)
+{
+    uint32_t sent = 0;
+    for (int m = 0; m < sealed->msgs; m++) {
+        uint8_t *msg = gossip_tx_buf(gs, m);
+        if (gossip_emit(gs, dst, (const gossip_msg_header_t *)msg,
+                        msg + sizeof(gossip_msg_header_t), sealed->pl[m]) < 0)
+            break;
+        sent = sealed->upto[m];
+    }
+    return sent;
+}
+
+/* Room for every origin in both list scratch arrays */
+static int gossip_tx_reserve(gossip_state_t *gs)
+{
+    if (gs->num_origins <= gs->tx_list_cap)
+        return 0;
+    uint32_t cap = gs->max_origins;
+    gossip_origin_t **list = realloc(gs->tx_list, cap * sizeof(*list));
+    if (!list)
+        return -1;
+    gs->tx_list = list;
+    gossip_origin_t **prev = realloc(gs->tx_prev, cap * sizeof(*prev));
+    if (!prev)
+        return -1;
+    gs->tx_prev     = prev;
+    gs->tx_list_cap = cap;
+    return 0;
+}
+
+/* Version vector, in node ID order, as one or more digests to @dst */
+static void gossip_send_digest(gossip_state_t *gs,
+                               const uint8_t dst[STRANDLINK_NODE_ID_LEN],
+                               gossip_origin_t **list)
+{
+    uint8_t *msg = gossip_tx_buf(gs, 0);
+    if (!msg)
+        return;
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < gs->num_origins; i++)
+        if (gs->origins[i].version)
+            list[n++] = &gs->origins[i];
+    qsort(list, n, sizeof(*list), origin_id_cmp);
+
+    const uint32_t per_msg = (GOSSIP_ADV_MAX_PAYLOAD - GOSSIP_ADV_DIGEST_HDR) /
+                             GOSSIP_ADV_DIGEST_ITEM;
+    uint8_t *payload = msg + sizeof(gossip_msg_header_t);
+    uint32_t done = 0;
+    do {
+        uint32_t count = n - done < per_msg ? n - done : per_msg;
+        bool last = (done + count == n);
+
+        payload[0] = GOSSIP_ADV_DIGEST;
+        payload[1] = 0;
+        put16(payload + 2, (uint16_t)count);
+        if (done == 0)
+            memset(payload + 4, 0, STRANDLINK_NODE_ID_LEN);
+        else
+            node_id_copy(payload + 4, list[done - 1]->node_id);
+        if (last)
+            memset(payload + 4 + STRANDLINK_NODE_ID_LEN, 0xFF, STRANDLINK_NODE_ID_LEN);
+        else
+            node_id_copy(payload + 4 + STRANDLINK_NODE_ID_LEN,
+                         list[done + count - 1]->node_id);
+
+        uint8_t *p = payload + GOSSIP_ADV_DIGEST_HDR;
+        for (uint32_t i = 0; i < count; i++, p += GOSSIP_ADV_DIGEST_ITEM) {
+            node_id_copy(p, list[done + i]->node_id);
+            put32(p + STRANDLINK_NODE_ID_LEN, list[done + i]->version);
+        }
+        size_t pl = GOSSIP_ADV_DIGEST_HDR + (size_t)count * GOSSIP_ADV_DIGEST_ITEM;
+        if (gossip_seal_advertise(gs, msg, pl) != 0 ||
+            gossip_emit(gs, dst, (const gossip_msg_header_t *)msg,
+                        payload, pl) < 0)
+            break;
+        done += count;
+    } while (done < n);
+}
+
+/* --------------------------------------------------------------------------
+ * gossip_set_local_entry
+ *
+ * Set what this node advertises about itself: @entry's capabilities and
+ * metrics under our own node ID.  Each call is a new version; versions
+ * start from the wall clock so a restarted node supersedes what it
+ * advertised before.  The entry is re-versioned every TTL/3 so peers
+ * never let it expire.  Returns 0, or -1 if the SAD does not encode.
+ * -------------------------------------------------------------------------- */
+
+static int gossip_encode_self(gossip_state_t *gs, uint64_t now_ms)
+{
+    gossip_origin_t *o = origin_find(gs, gs->self_id);
+    if (!o || !o->entry)
+        return -1;
+    gs->self_version++;
+    put32(o->entry + STRANDLINK_NODE_ID_LEN, gs->self_version);
+    o->version    = gs->self_version;
+    o->seq        = ++gs->adv_seq;
+    o->updated_ms = now_ms;
+    gs->self_refresh_ms = now_ms;
+    return 0;
+}
+
+int gossip_set_local_entry(gossip_state_t *gs, const route_entry_t *entry,
+                           uint64_t now_ms)
+{
+    if (!gs || !entry)
+        return -1;
+
+    uint8_t buf[GOSSIP_ADV_ENTRY_FIXED + SAD_MAX_SIZE];
+    int sad_len = sad_encode(&entry->capabilities, buf + GOSSIP_ADV_ENTRY_FIXED,
+                             SAD_MAX_SIZE);
+    if (sad_len < 0)
+        return -1;
+
+    if (gs->self_version == 0) {
+        uint32_t wall = (uint32_t)time(NULL);
+        gs->self_version = wall ? wall : 1;
+    } else {
+        gs->self_version++;
+    }
+
+    uint64_t ttl_ms = entry->ttl_ns ? entry->ttl_ns / 1000000ull
+                                    : GOSSIP_DEFAULT_TTL * 1000ull;
+    uint8_t *f = buf + STRANDLINK_NODE_ID_LEN + 4;
+    node_id_copy(buf, gs->self_id);
+    put32(buf + STRANDLINK_NODE_ID_LEN, gs->self_version);
+    put32(f,      entry->latency_us);
+    put32(f + 4,  entry->cost_milli);
+    put32(f + 8,  ttl_ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ttl_ms);
+    put16(f + 12, entry->region_code);
+    f[14] = entry->trust_level;
+    put16(f + 15, (uint16_t)sad_len);
+
+    gossip_origin_t *o = origin_get(gs, gs->self_id);
+    if (!o || origin_update(gs, o, NULL, buf,
+                            GOSSIP_ADV_ENTRY_FIXED + (size_t)sad_len, now_ms) != 0)
+        return -1;
+    gs->self_refresh_ms = now_ms;
+    gs->clock_ms    = now_ms;
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * gossip_do_advertise
+ *
+ * One advertise round: every active peer gets the changes past its
+ * watermark; every GOSSIP_ADV_DIGEST_EVERY rounds one random peer also
+ * gets our version vector.
+ * -------------------------------------------------------------------------- */
+
+int gossip_do_advertise(gossip_state_t *gs, uint64_t now_ms)
+{
+    if (!gs || !gossip_can_send(gs))
+        return 0;
+    gs->clock_ms = now_ms;
+
+    if (gs->self_version &&
+        now_ms - gs->self_refresh_ms >= GOSSIP_DEFAULT_TTL * 1000ull / 3)
+        gossip_encode_self(gs, now_ms);
+
+    if (gs->active_count == 0 || gs->num_origins == 0)
+        return 0;
+
+    if (gossip_tx_reserve(gs) != 0)
+        return -1;
+
+    /* Peers in sync see the same changes: their deltas are built and
+     * signed once, for the first of them, and sent to all */
+    gossip_sealed_t sealed;
+    uint32_t sealed_n = 0;
+    sealed.msgs = -1;
+
+    for (int p = 0; p < gs->active_count; p++) {
+        gossip_origin_t **list = gs->tx_list;
+        gossip_peer_t *peer = &gs->active_view[p];
+
+        /* Changes since the watermark, oldest first; nothing goes back
+         * to the peer it came from, or about the peer itself */
+        uint32_t n = 0;
+        uint64_t skipped_to = peer->adv_sent_seq;
+        for (uint32_t i = 0; i < gs->num_origins; i++) {
+            gossip_origin_t *o = &gs->origins[i];
+            if (o->seq <= peer->adv_sent_seq || !o->entry)
+                continue;
+            if (node_id_equal(o->from, peer->node_id) ||
+                node_id_equal(o->node_id, peer->node_id)) {
+                if (o->seq > skipped_to) skipped_to = o->seq;
+                continue;
+            }
+            list[n++] = o;
+        }
+        if (n == 0) {
+            peer->adv_sent_seq = skipped_to;
+            continue;
+        }
+        qsort(list, n, sizeof(*list), origin_seq_cmp);
+
+        if (sealed.msgs < 0 || n != sealed_n ||
+            memcmp(list, gs->tx_prev, n * sizeof(*list)) != 0) {
+            if (gossip_seal_entries(gs, list, n, &sealed) != 0) {
+                sealed.msgs = -1;
+                continue;
             }
+            sealed_n    = n;
+            gs->tx_list = gs->tx_prev;
+            gs->tx_prev = list;
         }
+        list = gs->tx_prev;
+
+        uint32_t sent = gossip_send_sealed(gs, peer->node_id, &sealed);
+        if (sent == n)
+            peer->adv_sent_seq = list[n - 1]->seq > skipped_to
+                                     ? list[n - 1]->seq : skipped_to;
+        else if (sent > 0)
+            peer->adv_sent_seq = list[sent - 1]->seq;   /* rest next round */
     }
 
+    if (++gs->adv_rounds % GOSSIP_ADV_DIGEST_EVERY == 0) {
+        int target = gossip_rand_range(gs->active_count);
+        gossip_send_digest(gs, gs->active_view[target].node_id, gs->tx_list);
+        origin_prune(gs, now_ms);
+    }
     return 0;
 }
 
 /* --------------------------------------------------------------------------
- * gossip_handle_message - dispatch incoming gossip messages
+ * gossip_handle_advertise
+ *
+ * DELTA: keep every entry newer than ours, all rows in one routing table
+ * (or sharded tables) transaction.  The SADs of the entries that pass the
+ * version check are validated and decoded GOSSIP_ADV_DECODE_BATCH at a
+ * time, straight into the route entries.  An entry is only staged at
+ * first; its version is recorded once the transaction has committed, so
+ * a route that never made it into the table is taken again next time.
+ * DIGEST: answer with what the sender lacks in its range.
  * -------------------------------------------------------------------------- */
 
-int gossip_handle_message(gossip_state_t *gs,
-                          const void *msg, size_t msg_len)
+#define GOSSIP_ADV_DECODE_BATCH 8
+
+/* The transaction a delta is applied in, opened on its first entry */
+typedef struct {
+    routing_table_txn_t  *rt;
+    routing_shards_txn_t *shards;
+} gossip_apply_txn_t;
+
+static int gossip_txn_insert(gossip_state_t *gs, gossip_apply_txn_t *txn,
+                             const route_entry_t *route)
 {
-    if (!gs || !msg || msg_len < sizeof(gossip_msg_header_t))
+    if (gs->routing_shards) {
+        uint32_t key = RT_SHARD_KEY_ANY;
+        if (gs->shard_key_fn) {
+            key = gs->shard_key_fn(route, gs->shard_key_ctx);
+            if (key == RT_SHARD_KEY_ANY)
+                return 0;       /* not for any partition here */
+        }
+        if (!txn->shards)
+            txn->shards = routing_shards_txn_begin(gs->routing_shards);
+        return txn->shards ? routing_shards_txn_insert(txn->shards, key, route)
+                           : -1;
+    }
+    if (!txn->rt)
+        txn->rt = routing_table_txn_begin(gs->routing_table);
+    return txn->rt ? routing_table_txn_insert(txn->rt, route) : -1;
+}
+
+/* Stage @n entries that were newer than ours when the delta was scanned */
+static int gossip_apply_entries(gossip_state_t *gs,
+                                const uint8_t *const *ent, const size_t *len,
+                                int n, uint64_t now_ns,
+                                gossip_apply_txn_t *txn)
+{
+    int rc = 0;
+
+    route_entry_t routes[GOSSIP_ADV_DECODE_BATCH];
+    sad_span_t    spans[GOSSIP_ADV_DECODE_BATCH] = { { 0 } };
+    sad_t        *sads[GOSSIP_ADV_DECODE_BATCH] = { 0 };
+
+    memset(routes, 0, (size_t)n * sizeof(routes[0]));
+    for (int i = 0; i < n; i++) {
+        spans[i].buf = ent[i] + GOSSIP_ADV_ENTRY_FIXED;
+        spans[i].len = (uint16_t)(len[i] - GOSSIP_ADV_ENTRY_FIXED);
+        sads[i]      = &routes[i].capabilities;
+    }
+    sad_decode_batch(spans, n, sads, NULL);
+
+    for (int i = 0; i < n; i++) {
+        if (routes[i].capabilities.total_length == 0)
+            continue;       /* malformed SAD */
+
+        /* Checked again: the delta may carry an origin twice */
+        gossip_origin_t *o = origin_find(gs, ent[i]);
+        if (origin_floor(o) >= entry_version(ent[i]))
+            continue;
+        if (!o && !(o = origin_get(gs, ent[i])))
+            return -1;
+
+        if (gs->routing_table || gs->routing_shards) {
+            entry_fields(ent[i], now_ns, &routes[i]);
+            if (gossip_txn_insert(gs, txn, &routes[i]) != 0) {
+                rc = -1;
+                continue;
+            }
+        }
+        o->staged = ent[i];
+    }
+    return rc;
+}
+
+/* Record the entries of the delta at @p that were staged, or with
+ * @committed false just forget them */
+static int gossip_record_staged(gossip_state_t *gs,
+                                const uint8_t sender[STRANDLINK_NODE_ID_LEN],
+                                const uint8_t *p, size_t avail, uint16_t count,
+                                bool committed)
+{
+    int rc = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        size_t n = entry_len(p, avail);
+        if (n == 0)
+            break;
+        gossip_origin_t *o = origin_find(gs, p);
+        if (o && o->staged == p) {
+            o->staged = NULL;
+            if (committed &&
+                origin_update(gs, o, sender, p, n, gs->clock_ms) != 0)
+                rc = -1;
+        }
+        p     += n;
+        avail -= n;
+    }
+    return rc;
+}
+
+static int gossip_apply_delta(gossip_state_t *gs,
+                              const uint8_t sender[STRANDLINK_NODE_ID_LEN],
+                              const uint8_t *p, size_t avail, uint16_t count)
+{
+    uint64_t now_ns = gossip_now_ns();
+    const uint8_t *start = p;
+    size_t         total = avail;
+    gossip_apply_txn_t txn = { NULL, NULL };
+    const uint8_t *ent[GOSSIP_ADV_DECODE_BATCH];
+    size_t         len[GOSSIP_ADV_DECODE_BATCH];
+    int            pending = 0;
+    int            rc = 0;
+
+    for (uint16_t i = 0; i < count && rc == 0; i++) {
+        size_t n = entry_len(p, avail);
+        if (n == 0) {
+            rc = -1;        /* truncated: keep what came before */
+            break;
+        }
+        const uint8_t *e = p;
+        p     += n;
+        avail -= n;
+
+        if (node_id_equal(e, gs->self_id) || node_id_is_zero(e))
+            continue;
+        if (origin_floor(origin_find(gs, e)) >= entry_version(e))
+            continue;       /* already have it (or newer) */
+
+        ent[pending] = e;
+        len[pending] = n;
+        if (++pending == GOSSIP_ADV_DECODE_BATCH) {
+            rc = gossip_apply_entries(gs, ent, len, pending, now_ns, &txn);
+            pending = 0;
+        }
+    }
+    if (pending > 0) {
+        int rc2 = gossip_apply_entries(gs, ent, len, pending, now_ns, &txn);
+        if (rc == 0)
+            rc = rc2;
+    }
+
+    bool committed = true;
+    if (txn.rt && routing_table_txn_commit(txn.rt) != 0)
+        committed = false;
+    if (txn.shards && routing_shards_txn_commit(txn.shards) != 0)
+        committed = false;
+    if (gossip_record_staged(gs, sender, start, total, count, committed) != 0 ||
+        !committed)
+        rc = -1;
+    return rc;
+}
+
+static int gossip_answer_digest(gossip_state_t *gs,
+                                const uint8_t sender[STRANDLINK_NODE_ID_LEN],
+                                const uint8_t *p, size_t avail, uint16_t count)
+{
+    if (avail < 2 * STRANDLINK_NODE_ID_LEN +
+                (size_t)count * GOSSIP_ADV_DIGEST_ITEM)
         return -1;
+    const uint8_t *lo    = p;
+    const uint8_t *hi    = p + STRANDLINK_NODE_ID_LEN;
+    const uint8_t *items = p + 2 * STRANDLINK_NODE_ID_LEN;
 
-    const gossip_msg_header_t *hdr = (const gossip_msg_header_t *)msg;
+    if (!gossip_can_send(gs) || gs->num_origins == 0)
+        return 0;
+    if (gossip_tx_reserve(gs) != 0)
+        return -1;
+    gossip_origin_t **list = gs->tx_list;
+
+    /* Ours in (lo, hi] that the digest lacks or has older; items are in
+     * node ID order, so each is found by binary search */
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < gs->num_origins; i++) {
+        gossip_origin_t *o = &gs->origins[i];
+        if (!o->entry || node_id_equal(o->node_id, sender) ||
+            memcmp(o->node_id, lo, STRANDLINK_NODE_ID_LEN) <= 0 ||
+            memcmp(o->node_id, hi, STRANDLINK_NODE_ID_LEN) > 0)
+            continue;
+        uint32_t theirs = 0;
+        size_t a = 0, b = count;
+        while (a < b) {
+            size_t mid = (a + b) / 2;
+            const uint8_t *it = items + mid * GOSSIP_ADV_DIGEST_ITEM;
+            int c = memcmp(it, o->node_id, STRANDLINK_NODE_ID_LEN);
+            if (c == 0) {
+                theirs = get32(it + STRANDLINK_NODE_ID_LEN);
+                break;
+            }
+            if (c < 0) a = mid + 1;
+            else       b = mid;
+        }
+        if (o->version > theirs)
+            list[n++] = o;
+    }
+    gossip_sealed_t sealed;
+    if (n > 0 && gossip_seal_entries(gs, list, n, &sealed) == 0)
+        gossip_send_sealed(gs, sender, &sealed);
+    return 0;
+}
 
-    /* If a verify callback is installed, authenticate the message before
-     * processing.  The signature covers all header fields up to (but not
-     * including) the signature field itself. */
-    if (gs->verify_fn) {
-        /* signed_len = offset of signature field within the header */
-        static const size_t signed_len =
-            offsetof(gossip_msg_header_t, signature);
-        if (gs->verify_fn(msg, signed_len, hdr->signature, gs->auth_ctx) != 0)
-            return -1;   /* reject: bad or missing signature */
+uint32_t gossip_origin_version(const gossip_state_t *gs,
+                               const uint8_t origin[STRANDLINK_NODE_ID_LEN])
+{
+    if (!gs || !origin)
+        return 0;
+    const gossip_origin_t *o = origin_find(gs, origin);
+    return o ? o->version : 0;
+}
+
+int gossip_handle_advertise(gossip_state_t *gs,
+                            const uint8_t sender[STRANDLINK_NODE_ID_LEN],
+                            const uint8_t *payload, uint16_t payload_len)
+{
+    if (payload_len < GOSSIP_ADV_HDR_LEN)
+        return -1;
+    uint16_t count = get16(payload + 2);
+    const uint8_t *body = payload + GOSSIP_ADV_HDR_LEN;
+    size_t avail = payload_len - GOSSIP_ADV_HDR_LEN;
+
+    switch (payload[0]) {
+    case GOSSIP_ADV_DELTA:
+        return gossip_apply_delta(gs, sender, body, avail, count);
+    case GOSSIP_ADV_DIGEST:
+        return gossip_answer_digest(gs, sender, body, avail, count);
+    default:
+        return -1;
     }
+}
+
+/* --------------------------------------------------------------------------
+ * gossip_destroy
+ * -------------------------------------------------------------------------- */
+
+void gossip_destroy(gossip_state_t *gs)
+{
+    if (!gs) return;
+    for (uint32_t i = 0; i < gs->num_origins; i++)
+        free(gs->origins[i].entry);
+    free(gs->origins);
+    free(gs->origin_index);
+    free(gs->tx_pool);
+    free(gs->tx_list);
+    free(gs->tx_prev);
+    free(gs->rx_arena);
+    timer_wheel_destroy(gs->wheel);
+    free(gs);
+}
+
+int gossip_active_count(const gossip_state_t *gs)
+{
+    return gs ? gs->active_count : 0;
+}
+
+/* --------------------------------------------------------------------------
+ * gossip_dispatch - act on an authenticated message, @avail payload bytes
+ * of which are present at @payload
+ * -------------------------------------------------------------------------- */
+
+static int gossip_dispatch(gossip_state_t *gs, const gossip_msg_header_t *hdr,
+                           const uint8_t *payload, size_t avail)
+{
+    gossip_peer_t *from = find_peer(gs->active_view, gs->active_count,
+                                    hdr->sender_id);
+    if (from)
+        from->last_seen = gs->clock_ms;
 
     switch (hdr->msg_type) {
     case GOSSIP_MSG_JOIN:
@@ -563,17 +1637,15 @@ int gossip_handle_message(gossip_state_t *gs,
         return gossip_handle_disconnect(gs, hdr->sender_id);
 
     case GOSSIP_MSG_SHUFFLE: {
-        const uint8_t *payload = (const uint8_t *)msg + sizeof(*hdr);
         uint16_t pl = hdr->payload_len;
-        if (sizeof(*hdr) + pl > msg_len) return -1;
+        if (pl > avail) return -1;
         return gossip_handle_shuffle(gs, hdr->sender_id, payload, pl);
     }
 
     case GOSSIP_MSG_SHUFFLE_REPLY: {
         /* Incorporate shuffle reply into passive view same as shuffle */
-        const uint8_t *payload = (const uint8_t *)msg + sizeof(*hdr);
         uint16_t pl = hdr->payload_len;
-        if (sizeof(*hdr) + pl > msg_len) return -1;
+        if (pl > avail) return -1;
         int num = pl / STRANDLINK_NODE_ID_LEN;
         for (int i = 0; i < num; i++) {
             const uint8_t *nid = &payload[i * STRANDLINK_NODE_ID_LEN];
@@ -587,11 +1659,255 @@ int gossip_handle_message(gossip_state_t *gs,
         return 0;
     }
 
+    case GOSSIP_MSG_ADVERTISE: {
+        uint16_t pl = hdr->payload_len;
+        if (pl > avail) return -1;
+        return gossip_handle_advertise(gs, hdr->sender_id, payload, pl);
+    }
+
     default:
         return -1;  /* unknown message type */
     }
 }
 
+/* --------------------------------------------------------------------------
+ * gossip_handle_message - verify and dispatch one incoming message
+ * -------------------------------------------------------------------------- */
+
+int gossip_handle_message(gossip_state_t *gs,
+                          const void *msg, size_t msg_len)
+{
+    if (!gs || !msg || msg_len < sizeof(gossip_msg_header_t))
+        return -1;
+
+    const gossip_msg_header_t *hdr = (const gossip_msg_header_t *)msg;
+
+    /* If a verify callback is installed, authenticate the message before
+     * processing.  The signature covers all header fields up to (but not
+     * including) the signature field itself. */
+    if (gossip_auth_enabled(gs)) {
+        if (hdr->msg_type == GOSSIP_MSG_ADVERTISE) {
+            /* Advertise signatures also cover the payload */
+            if (sizeof(*hdr) + hdr->payload_len > msg_len ||
+                gossip_verify_advertise(gs, msg, sizeof(*hdr) + hdr->payload_len) != 0)
+                return -1;
+        } else if (!gossip_vcache_hit(gs, msg, hdr->signature)) {
+            if (gossip_verify_region(gs, msg, GOSSIP_SIGNED_LEN,
+                                     hdr->signature) != 0)
+                return -1;   /* reject: bad or missing signature */
+            gossip_vcache_add(gs, msg, hdr->signature);
+        }
+    }
+
+    return gossip_dispatch(gs, hdr, (const uint8_t *)msg + sizeof(*hdr),
+                           msg_len - sizeof(*hdr));
+}
+
+/* --------------------------------------------------------------------------
+ * Batched inbound path
+ * -------------------------------------------------------------------------- */
+
+/*
+ * gossip_flush_messages - verify every queued message in one batch, then
+ * dispatch the good ones in arrival order.  Returns how many were
+ * rejected (bad signature, or refused by their handler).
+ */
+int gossip_flush_messages(gossip_state_t *gs)
+{
+    if (!gs || gs->rx_count == 0)
+        return 0;
+
+    int n = gs->rx_count;
+    gossip_sig_item_t items[GOSSIP_RX_BATCH] = { { 0 } };
+    int               item_of[GOSSIP_RX_BATCH];
+    uint8_t           good[GOSSIP_RX_BATCH];
+    uint8_t           ok[GOSSIP_RX_BATCH];
+    int               k = 0;
+
+    /* Only signatures not seen before go into the batch */
+    for (int i = 0; i < n; i++) {
+        const gossip_rx_msg_t *m = &gs->rx_queue[i];
+        const uint8_t *region = gs->rx_arena + m->off;
+        bool adv = region[0] == GOSSIP_MSG_ADVERTISE;
+
+        ok[i] = !gossip_auth_enabled(gs) ||
+                (!adv && gossip_vcache_hit(gs, region, m->sig));
+        if (ok[i])
+            continue;
+        items[k].msg     = region;
+        items[k].msg_len = GOSSIP_SIGNED_LEN + (adv ? m->pl : 0);
+        items[k].sig     = m->sig;
+        item_of[k++]     = i;
+    }
+
+    gossip_verify_items(gs, items, k, good);
+    for (int j = 0; j < k; j++) {
+        if (!good[j])
+            continue;
+        int i = item_of[j];
+        ok[i] = 1;
+        if (items[j].msg_len == GOSSIP_SIGNED_LEN)
+            gossip_vcache_add(gs, items[j].msg, items[j].sig);
+    }
+
+    /* Handlers may send, but never enqueue: the queue stays as it is
+     * until it is reset below */
+    int rejected = 0;
+    for (int i = 0; i < n; i++) {
+        const gossip_rx_msg_t *m = &gs->rx_queue[i];
+        if (!ok[i]) {
+            rejected++;
+            continue;
+        }
+        gossip_msg_header_t hdr;
+        memcpy(&hdr, gs->rx_arena + m->off, GOSSIP_SIGNED_LEN);
+        memcpy(hdr.signature, m->sig, GOSSIP_SIG_LEN);
+        if (gossip_dispatch(gs, &hdr, gs->rx_arena + m->off + GOSSIP_SIGNED_LEN,
+                            m->pl) != 0)
+            rejected++;
+    }
+
+    gs->rx_count = 0;
+    gs->rx_used  = 0;
+    return rejected;
+}
+
+/*
+ * gossip_enqueue_message - queue an incoming message for batched
+ * verification.  The message is copied, so @msg may be reused at once.
+ * The queue is flushed when full and on every gossip_tick(); a message
+ * too large to queue, or arriving while no verify callback is set, is
+ * handled at once (after the queue, to keep the order).
+ *
+ * Returns 0 if queued, -1 if the message is malformed, otherwise what
+ * gossip_handle_message() returned for a message handled at once.
+ */
+int gossip_enqueue_message(gossip_state_t *gs, const void *msg, size_t msg_len)
+{
+    if (!gs || !msg || msg_len < sizeof(gossip_msg_header_t))
+        return -1;
+
+    const gossip_msg_header_t *hdr = (const gossip_msg_header_t *)msg;
+    size_t avail = msg_len - sizeof(*hdr);
+    if (hdr->msg_type == GOSSIP_MSG_ADVERTISE) {
+        if (hdr->payload_len > avail)
+            return -1;
+        avail = hdr->payload_len;   /* the signed payload, nothing after it */
+    }
+
+    size_t need = GOSSIP_SIGNED_LEN + avail;
+    if (!gossip_auth_enabled(gs) || need > GOSSIP_RX_ARENA) {
+        gossip_flush_messages(gs);
+        return gossip_handle_message(gs, msg, msg_len);
+    }
+
+    if (gs->rx_count == GOSSIP_RX_BATCH || gs->rx_used + need > GOSSIP_RX_ARENA)
+        gossip_flush_messages(gs);
+    if (!gs->rx_arena) {
+        gs->rx_arena = malloc(GOSSIP_RX_ARENA);
+        if (!gs->rx_arena)
+            return gossip_handle_message(gs, msg, msg_len);
+    }
+
+    /* Signed prefix and payload side by side: for Advertise that is
+     * exactly the signed region */
+    gossip_rx_msg_t *m = &gs->rx_queue[gs->rx_count++];
+    m->off = gs->rx_used;
+    m->pl  = (uint16_t)avail;
+    memcpy(m->sig, hdr->signature, GOSSIP_SIG_LEN);
+    memcpy(gs->rx_arena + m->off, msg, GOSSIP_SIGNED_LEN);
+    memcpy(gs->rx_arena + m->off + GOSSIP_SIGNED_LEN, hdr + 1, avail);
+    gs->rx_used += (uint32_t)need;
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * Timers
+ * -------------------------------------------------------------------------- */
+
+enum {
+    GOSSIP_TIMER_SHUFFLE,
+    GOSSIP_TIMER_ADVERTISE,
+    GOSSIP_TIMER_LIVENESS,
+};
+
+/*
+ * Drop active peers not heard from for peer_timeout_ms, as if they had
+ * sent Disconnect (a passive peer is promoted in their place).  A peer
+ * that was never heard from is timed from its first check.  Returns when
+ * the next one could time out.
+ */
+static uint64_t gossip_check_liveness(gossip_state_t *gs)
+{
+    uint64_t now = gs->clock_ms;
+    uint64_t oldest = now;
+
+    for (int i = 0; i < gs->active_count; ) {
+        gossip_peer_t *p = &gs->active_view[i];
+        if (p->last_seen == 0)
+            p->last_seen = now;
+        if (now - p->last_seen >= gs->peer_timeout_ms) {
+            uint8_t id[STRANDLINK_NODE_ID_LEN];
+            node_id_copy(id, p->node_id);
+            gossip_handle_disconnect(gs, id);
+            continue;           /* slot i now holds another peer */
+        }
+        if (p->last_seen < oldest)
+            oldest = p->last_seen;
+        i++;
+    }
+    return oldest + gs->peer_timeout_ms;
+}
+
+static void gossip_on_timer(void *ctx, uint32_t id, uint64_t which)
+{
+    gossip_state_t *gs = ctx;
+    uint64_t now = gs->clock_ms;
+
+    switch (which) {
+    case GOSSIP_TIMER_SHUFFLE:
+        gossip_do_shuffle(gs);
+        gs->last_shuffle_ts = now;
+        timer_wheel_mod(gs->wheel, id, now + gs->shuffle_timer_ms);
+        break;
+    case GOSSIP_TIMER_ADVERTISE:
+        gossip_do_advertise(gs, now);
+        gs->last_advertise_ts = now;
+        timer_wheel_mod(gs->wheel, id, now + gs->advertise_interval_ms);
+        break;
+    case GOSSIP_TIMER_LIVENESS:
+        if (gs->peer_timeout_ms)
+            timer_wheel_mod(gs->wheel, id, gossip_check_liveness(gs));
+        else
+            gs->liveness_timer = TIMER_WHEEL_NONE;
+        break;
+    }
+}
+
+static int gossip_start_timers(gossip_state_t *gs, uint64_t now_ms)
+{
+    gs->wheel = timer_wheel_create(GOSSIP_WHEEL_TICK_MS, now_ms);
+    if (!gs->wheel)
+        return -1;
+    gs->shuffle_timer = timer_wheel_add(gs->wheel,
+                                        gs->last_shuffle_ts + gs->shuffle_timer_ms,
+                                        GOSSIP_TIMER_SHUFFLE);
+    gs->advertise_timer = timer_wheel_add(gs->wheel,
+                                          gs->last_advertise_ts + gs->advertise_interval_ms,
+                                          GOSSIP_TIMER_ADVERTISE);
+    gs->liveness_timer = gs->peer_timeout_ms
+        ? timer_wheel_add(gs->wheel, now_ms, GOSSIP_TIMER_LIVENESS)
+        : TIMER_WHEEL_NONE;
+    if (gs->shuffle_timer == TIMER_WHEEL_NONE ||
+        gs->advertise_timer == TIMER_WHEEL_NONE ||
+        (gs->peer_timeout_ms && gs->liveness_timer == TIMER_WHEEL_NONE)) {
+        timer_wheel_destroy(gs->wheel);
+        gs->wheel = NULL;
+        return -1;
+    }
+    return 0;
+}
+
 /* --------------------------------------------------------------------------
  * gossip_tick - called periodically (e.g., every 100ms) to drive timers
  * -------------------------------------------------------------------------- */
@@ -599,10 +1915,28 @@ int gossip_handle_message(gossip_state_t *gs,
 void gossip_tick(gossip_state_t *gs, uint64_t now_ms)
 {
     if (!gs) return;
-
-    /* Shuffle timer */
-    if (now_ms - gs->last_shuffle_ts >= gs->shuffle_timer_ms) {
-        gossip_do_shuffle(gs);
-        gs->last_shuffle_ts = now_ms;
+    gs->clock_ms = now_ms;
+
+    /* Messages queued since the last tick go before any timer fires */
+    gossip_flush_messages(gs);
+
+    if (gs->wheel || gossip_start_timers(gs, now_ms) == 0) {
+        timer_wheel_advance(gs->wheel, now_ms, gossip_on_timer, gs);
+    } else {
+        /* No memory for the wheel: poll the two periodic timers */
+        if (now_ms - gs->last_shuffle_ts >= gs->shuffle_timer_ms) {
+            gossip_do_shuffle(gs);
+            gs->last_shuffle_ts = now_ms;
+        }
+        if (now_ms - gs->last_advertise_ts >= gs->advertise_interval_ms) {
+            gossip_do_advertise(gs, now_ms);
+            gs->last_advertise_ts = now_ms;
+        }
     }
+
+    /* Entry TTLs: only the due ones are looked at, removed in one publish */
+    if (gs->routing_shards)
+        routing_shards_expire(gs->routing_shards, gossip_now_ns());
+    else if (gs->routing_table)
+        routing_table_expire(gs->routing_table, gossip_now_ns());
 }
@@ -0,0 +1,182 @@
+/*
+ * hop_load.c - Live per-next-hop latency and load
+ *
+ * A slot goes EMPTY -> CLAIMED -> READY exactly once.  The thread whose
+ * compare-exchange claims it writes the key and publishes it with a
+ * release store; a prober that finds a slot CLAIMED waits the few
+ * instructions until it is READY before comparing keys, so a hop never
+ * ends up in two slots.
+ */
+
+#include "strandroute/hop_load.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HL_CACHE_LINE  64
+
+enum {
+    HL_EMPTY = 0,
+    HL_CLAIMED,
+    HL_READY,
+};
+
+typedef struct {
+    _Alignas(HL_CACHE_LINE)
+    _Atomic uint32_t state;
+    _Atomic uint32_t ewma_us;
+    _Atomic uint32_t inflight;
+    _Atomic uint64_t samples;
+    uint8_t          node_id[STRANDLINK_NODE_ID_LEN];   /* set once */
+} hl_slot_t;
+
+struct hop_load {
+    hl_slot_t *slots;
+    uint32_t   mask;
+};
+
+/* Node IDs are often structured (prefix + counter): mix both halves */
+static inline uint32_t hl_hash(const uint8_t id[STRANDLINK_NODE_ID_LEN])
+{
+    uint64_t k[2];
+    memcpy(k, id, sizeof(k));
+    uint64_t h = k[0] ^ (k[1] * 0x9E3779B97F4A7C15ull);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+/* @node_id's slot, claimed if @create and it has none; NULL if absent or
+ * the table is full */
+static hl_slot_t *hl_find(const hop_load_t *hl,
+                          const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                          bool create)
+{
+    uint32_t i = hl_hash(node_id) & hl->mask;
+    for (uint32_t probe = 0; probe <= hl->mask; probe++, i = (i + 1) & hl->mask) {
+        hl_slot_t *s = &hl->slots[i];
+        uint32_t st = atomic_load_explicit(&s->state, memory_order_acquire);
+
+        if (st == HL_EMPTY) {
+            if (!create)
+                return NULL;
+            if (atomic_compare_exchange_strong_explicit(
+                    &s->state, &st, HL_CLAIMED,
+                    memory_order_acquire, memory_order_acquire)) {
+                memcpy(s->node_id, node_id, STRANDLINK_NODE_ID_LEN);
+                atomic_store_explicit(&s->state, HL_READY, memory_order_release);
+                return s;
+            }
+        }
+        while (st == HL_CLAIMED)
+            st = atomic_load_explicit(&s->state, memory_order_acquire);
+
+        if (memcmp(s->node_id, node_id, STRANDLINK_NODE_ID_LEN) == 0)
+            return s;
+    }
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------
+ * Lifecycle
+ * -------------------------------------------------------------------------- */
+
+hop_load_t *hop_load_create(uint32_t max_hops)
+{
+    if (max_hops == 0)
+        max_hops = HOP_LOAD_DEFAULT_HOPS;
+
+    /* At most half full, so probes stay short */
+    uint32_t n = 16;
+    while (n < max_hops * 2 && n < (1u << 30))
+        n <<= 1;
+
+    hop_load_t *hl = calloc(1, sizeof(*hl));
+    if (!hl) return NULL;
+    hl->slots = aligned_alloc(HL_CACHE_LINE, (size_t)n * sizeof(hl_slot_t));
+    if (!hl->slots) {
+        free(hl);
+        return NULL;
+    }
+    memset(hl->slots, 0, (size_t)n * sizeof(hl_slot_t));
+    hl->mask = n - 1;
+    return hl;
+}
+
+void hop_load_destroy(hop_load_t *hl)
+{
+    if (!hl) return;
+    free(hl->slots);
+    free(hl);
+}
+
+/* --------------------------------------------------------------------------
+ * Updates
+ * -------------------------------------------------------------------------- */
+
+int hop_load_sent(hop_load_t *hl, const uint8_t node_id[STRANDLINK_NODE_ID_LEN])
+{
+    if (!hl || !node_id)
+        return -1;
+    hl_slot_t *s = hl_find(hl, node_id, true);
+    if (!s)
+        return -1;
+    atomic_fetch_add_explicit(&s->inflight, 1, memory_order_relaxed);
+    return 0;
+}
+
+int hop_load_done(hop_load_t *hl, const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                  uint32_t latency_us)
+{
+    if (!hl || !node_id)
+        return -1;
+    hl_slot_t *s = hl_find(hl, node_id, true);
+    if (!s)
+        return -1;
+
+    uint32_t n = atomic_load_explicit(&s->inflight, memory_order_relaxed);
+    while (n > 0 &&
+           !atomic_compare_exchange_weak_explicit(&s->inflight, &n, n - 1,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+        ;
+
+    if (latency_us == HOP_LOAD_NO_SAMPLE)
+        return 0;
+
+    /* The first sample is taken as is; the average is 0 only before it */
+    if (latency_us == 0)
+        latency_us = 1;
+    uint32_t old = atomic_load_explicit(&s->ewma_us, memory_order_relaxed);
+    uint32_t avg;
+    do {
+        if (old == 0) {
+            avg = latency_us;
+        } else {
+            int64_t d = ((int64_t)latency_us - old) / (1 << HOP_LOAD_EWMA_SHIFT);
+            avg = (uint32_t)((int64_t)old + d);
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&s->ewma_us, &old, avg,
+                                                    memory_order_relaxed,
+                                                    memory_order_relaxed));
+    atomic_fetch_add_explicit(&s->samples, 1, memory_order_relaxed);
+    return 0;
+}
+
+int hop_load_get(const hop_load_t *hl,
+                 const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                 hop_load_info_t *out)
+{
+    if (!hl || !node_id || !out)
+        return -1;
+    hl_slot_t *s = hl_find(hl, node_id, false);
+    if (!s)
+        return -1;
+    out->ewma_us  = atomic_load_explicit(&s->ewma_us, memory_order_relaxed);
+    out->inflight = atomic_load_explicit(&s->inflight, memory_order_relaxed);
+    out->samples  = atomic_load_explicit(&s->samples, memory_order_relaxed);
+    return 0;
+}
@@ -4,49 +4,20 @@
  * Implements the Maglev hashing algorithm (Google, 2016) for consistent
  * selection of backends.  Builds a lookup table of size M (prime) using
  * per-backend offset/skip values.  Hash flow to index, select backend.
- * Supports weighted endpoints by giving higher-weight backends more
- * entries in the permutation generation.
+ * Supports weighted endpoints by letting higher-weight backends claim
+ * slots on more of the fill rounds.
  *
  * Reference: Eisenbud et al., "Maglev: A Fast and Reliable Software
  * Network Load Balancer", NSDI 2016.
  */
 
-#include "strandroute/types.h"
+#include "strandroute/multipath.h"
 
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-
-/* --------------------------------------------------------------------------
- * Constants
- * -------------------------------------------------------------------------- */
-
-/* Lookup table size -- must be prime.  65537 is a common choice for
- * Maglev; we use 5003 for smaller deployments (configurable). */
-#define MAGLEV_TABLE_SIZE  5003
-#define MAGLEV_MAX_BACKENDS 128
-
-/* --------------------------------------------------------------------------
- * Backend descriptor
- * -------------------------------------------------------------------------- */
-
-typedef struct {
-    uint8_t  node_id[STRANDLINK_NODE_ID_LEN];
-    uint32_t weight;        /* relative weight (higher = more traffic) */
-    bool     active;
-} maglev_backend_t;
-
-/* --------------------------------------------------------------------------
- * Maglev lookup table
- * -------------------------------------------------------------------------- */
-
-typedef struct {
-    int32_t           table[MAGLEV_TABLE_SIZE];  /* backend index per slot */
-    maglev_backend_t  backends[MAGLEV_MAX_BACKENDS];
-    int               num_backends;
-    bool              built;     /* true after populate() */
-} maglev_t;
+#include <stdatomic.h>
 
 /* --------------------------------------------------------------------------
  * Hash helpers
@@ -74,132 +45,276 @@ static uint32_t hash_fnv1a(const uint8_t *data, size_t len)
 }
 
 /* --------------------------------------------------------------------------
- * maglev_init
+ * Table sizes
+ * -------------------------------------------------------------------------- */
+
+static bool is_prime(uint32_t n)
+{
+    if (n < 2) return false;
+    if (n % 2 == 0) return n == 2;
+    for (uint32_t d = 3; (uint64_t)d * d <= n; d += 2) {
+        if (n % d == 0)
+            return false;
+    }
+    return true;
+}
+
+uint32_t maglev_prime_at_least(uint32_t n)
+{
+    if (n < 2) n = 2;
+    for (; n <= MAGLEV_MAX_TABLE_SIZE; n++) {
+        if (is_prime(n))
+            return n;
+    }
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * maglev_init / maglev_destroy
  * -------------------------------------------------------------------------- */
 
-void maglev_init(maglev_t *m)
+int maglev_init(maglev_t *m, uint32_t table_size)
 {
+    if (!m) return -1;
     memset(m, 0, sizeof(*m));
-    for (int i = 0; i < MAGLEV_TABLE_SIZE; i++) {
-        m->table[i] = -1;
+
+    if (table_size == 0)
+        table_size = MAGLEV_DEFAULT_TABLE_SIZE;
+    if (table_size < 3 || table_size > MAGLEV_MAX_TABLE_SIZE ||
+        !is_prime(table_size))
+        return -1;
+
+    m->size   = table_size;
+    m->buf[0] = malloc((size_t)table_size * sizeof(_Atomic int32_t));
+    m->buf[1] = malloc((size_t)table_size * sizeof(_Atomic int32_t));
+    if (!m->buf[0] || !m->buf[1]) {
+        free(m->buf[0]);
+        free(m->buf[1]);
+        memset(m, 0, sizeof(*m));
+        return -1;
     }
-    m->built = false;
+    atomic_init(&m->table, NULL);
+    atomic_init(&m->seq, 0);
+    return 0;
+}
+
+void maglev_destroy(maglev_t *m)
+{
+    if (!m) return;
+    free(m->buf[0]);
+    free(m->buf[1]);
+    free(m->backends);
+    free(m->pos);
+    free(m->credit);
+    memset(m, 0, sizeof(*m));
 }
 
 /* --------------------------------------------------------------------------
- * maglev_add_backend
+ * Backends
  * -------------------------------------------------------------------------- */
 
+/* Backend of @node_id in any state but FREE, or -1 */
+static int find_slot(const maglev_t *m,
+                     const uint8_t node_id[STRANDLINK_NODE_ID_LEN])
+{
+    for (int i = 0; i < m->num_slots; i++) {
+        if (m->backends[i].state != MAGLEV_BACKEND_FREE &&
+            node_id_equal(m->backends[i].node_id, node_id))
+            return i;
+    }
+    return -1;
+}
+
+/* Grow backends[] and the populate scratch together */
+static int grow(maglev_t *m)
+{
+    int cap = m->capacity ? 2 * m->capacity : 16;
+
+    maglev_backend_t *b = realloc(m->backends, (size_t)cap * sizeof(*b));
+    if (!b) return -1;
+    m->backends = b;
+
+    uint32_t *pos = realloc(m->pos, (size_t)cap * sizeof(*pos));
+    if (!pos) return -1;
+    m->pos = pos;
+
+    uint64_t *credit = realloc(m->credit, (size_t)cap * sizeof(*credit));
+    if (!credit) return -1;
+    m->credit = credit;
+
+    m->capacity = cap;
+    return 0;
+}
+
 int maglev_add_backend(maglev_t *m,
                        const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
                        uint32_t weight)
 {
-    if (!m || m->num_backends >= MAGLEV_MAX_BACKENDS)
+    if (!m || m->size == 0)
         return -1;
     if (weight == 0) weight = 1;
 
-    maglev_backend_t *b = &m->backends[m->num_backends];
+    int i = find_slot(m, node_id);
+    if (i >= 0) {
+        maglev_backend_t *b = &m->backends[i];
+        if (b->state == MAGLEV_BACKEND_REMOVED) {
+            b->state = MAGLEV_BACKEND_ACTIVE;
+            m->num_backends++;
+            m->dirty = true;
+        }
+        if (b->weight != weight) {
+            b->weight = weight;
+            m->dirty = true;
+        }
+        return i;
+    }
+
+    /* Reuse a free index, else append */
+    for (i = 0; i < m->num_slots; i++) {
+        if (m->backends[i].state == MAGLEV_BACKEND_FREE)
+            break;
+    }
+    if (i == m->num_slots) {
+        if (m->num_slots == m->capacity && grow(m) != 0)
+            return -1;
+        m->num_slots++;
+    }
+
+    /* The permutation depends only on node_id and M: computed once here */
+    maglev_backend_t *b = &m->backends[i];
     node_id_copy(b->node_id, node_id);
     b->weight = weight;
-    b->active = true;
+    b->offset = hash_djb2(node_id, STRANDLINK_NODE_ID_LEN) % m->size;
+    b->skip   = hash_fnv1a(node_id, STRANDLINK_NODE_ID_LEN) % (m->size - 1) + 1;
+    b->state  = MAGLEV_BACKEND_ACTIVE;
     m->num_backends++;
-    m->built = false;  /* need rebuild */
-    return 0;
+    m->dirty = true;
+    return i;
 }
 
-/* --------------------------------------------------------------------------
- * maglev_remove_backend
- * -------------------------------------------------------------------------- */
-
 int maglev_remove_backend(maglev_t *m,
                           const uint8_t node_id[STRANDLINK_NODE_ID_LEN])
 {
     if (!m) return -1;
 
-    for (int i = 0; i < m->num_backends; i++) {
-        if (node_id_equal(m->backends[i].node_id, node_id)) {
-            /* Swap with last */
-            if (i < m->num_backends - 1) {
-                m->backends[i] = m->backends[m->num_backends - 1];
-            }
-            m->num_backends--;
-            m->built = false;
-            return 0;
-        }
-    }
-    return -1;
+    int i = find_slot(m, node_id);
+    if (i < 0 || m->backends[i].state != MAGLEV_BACKEND_ACTIVE)
+        return -1;
+
+    /* Readers of the published table may still return this index, so it
+     * is only freed for reuse once a table without it is published */
+    m->backends[i].state = MAGLEV_BACKEND_REMOVED;
+    m->num_backends--;
+    m->dirty = true;
+    return 0;
+}
+
+int maglev_find_backend(const maglev_t *m,
+                        const uint8_t node_id[STRANDLINK_NODE_ID_LEN])
+{
+    if (!m) return -1;
+    int i = find_slot(m, node_id);
+    return (i >= 0 && m->backends[i].state == MAGLEV_BACKEND_ACTIVE) ? i : -1;
 }
 
 /* --------------------------------------------------------------------------
  * maglev_populate - build the lookup table
  *
- * For each backend i, compute:
+ * For each backend i, precomputed at add time:
  *   offset_i = hash1(backend_i.node_id) % M
  *   skip_i   = hash2(backend_i.node_id) % (M-1) + 1
  *
- * Weights are handled by giving each backend w_i "turns" per round:
- * a backend with weight 3 gets 3 consecutive tries before moving to
- * the next backend.
+ * Backend i's preference list is offset_i, offset_i + skip_i, ... (mod M),
+ * a permutation of all slots since M is prime.  Backends take turns
+ * claiming their next free preferred slot.  Weights are handled with
+ * credits: on round r backend i claims a slot only if r * w_i has reached
+ * its credit, which then grows by w_max, so it claims w_i / w_max of the
+ * rounds and the heaviest backend claims every round.
+ *
+ * The table is written into the spare buffer and published by swapping
+ * the table pointer; seq is odd while the spare is being written so a
+ * lookup still holding the spare from before the last swap retries.
  * -------------------------------------------------------------------------- */
 
 int maglev_populate(maglev_t *m)
 {
-    if (!m || m->num_backends == 0)
+    if (!m || m->size == 0 || m->num_backends == 0)
         return -1;
 
-    const int M = MAGLEV_TABLE_SIZE;
-    int N = m->num_backends;
+    _Atomic int32_t *front = atomic_load_explicit(&m->table, memory_order_relaxed);
+    if (front && !m->dirty)
+        return 0;
 
-    /* Reset table */
-    for (int i = 0; i < M; i++) {
-        m->table[i] = -1;
-    }
+    const uint32_t M = m->size;
+    _Atomic int32_t *back = (front == m->buf[0]) ? m->buf[1] : m->buf[0];
 
-    /* Compute offset/skip per backend */
-    uint32_t *offset = malloc((size_t)N * sizeof(uint32_t));
-    uint32_t *skip   = malloc((size_t)N * sizeof(uint32_t));
-    uint32_t *next   = calloc((size_t)N, sizeof(uint32_t));  /* next candidate */
+    uint32_t seq = atomic_load_explicit(&m->seq, memory_order_relaxed);
+    atomic_store_explicit(&m->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
 
-    if (!offset || !skip || !next) {
-        free(offset); free(skip); free(next);
-        return -1;
-    }
+    for (uint32_t s = 0; s < M; s++)
+        atomic_store_explicit(&back[s], -1, memory_order_relaxed);
 
-    for (int i = 0; i < N; i++) {
-        offset[i] = hash_djb2(m->backends[i].node_id, STRANDLINK_NODE_ID_LEN) % (uint32_t)M;
-        skip[i]   = (hash_fnv1a(m->backends[i].node_id, STRANDLINK_NODE_ID_LEN) % (uint32_t)(M - 1)) + 1;
+    uint64_t wmax = 0;
+    for (int i = 0; i < m->num_slots; i++) {
+        const maglev_backend_t *b = &m->backends[i];
+        if (b->state == MAGLEV_BACKEND_ACTIVE && b->weight > wmax)
+            wmax = b->weight;
+    }
+    for (int i = 0; i < m->num_slots; i++) {
+        m->pos[i]    = m->backends[i].offset;
+        m->credit[i] = wmax;
     }
 
     /* Fill the table */
-    int filled = 0;
-    int round  = 0;
-
-    while (filled < M) {
-        for (int i = 0; i < N && filled < M; i++) {
-            /* Each backend gets weight[i] tries per round */
-            uint32_t turns = m->backends[i].weight;
-            for (uint32_t t = 0; t < turns && filled < M; t++) {
-                /* Find next empty slot for backend i */
-                uint32_t c = (offset[i] + next[i] * skip[i]) % (uint32_t)M;
-                while (m->table[c] >= 0) {
-                    next[i]++;
-                    c = (offset[i] + next[i] * skip[i]) % (uint32_t)M;
-                }
-                m->table[c] = i;
-                next[i]++;
-                filled++;
+    uint32_t filled = 0;
+    for (uint64_t round = 1; filled < M; round++) {
+        for (int i = 0; i < m->num_slots && filled < M; i++) {
+            const maglev_backend_t *b = &m->backends[i];
+            if (b->state != MAGLEV_BACKEND_ACTIVE)
+                continue;
+            if (round * b->weight < m->credit[i])
+                continue;
+            m->credit[i] += wmax;
+
+            /* Next empty slot on backend i's preference list */
+            uint32_t c = m->pos[i];
+            while (atomic_load_explicit(&back[c], memory_order_relaxed) >= 0) {
+                c += b->skip;
+                if (c >= M) c -= M;
             }
+            atomic_store_explicit(&back[c], i, memory_order_relaxed);
+            c += b->skip;
+            if (c >= M) c -= M;
+            m->pos[i] = c;
+            filled++;
         }
-        round++;
-        /* Safety: avoid infinite loop if weights are all 0 somehow */
-        if (round > M) break;
     }
 
-    free(offset);
-    free(skip);
-    free(next);
+    uint32_t moved = 0;
+    if (front) {
+        for (uint32_t s = 0; s < M; s++) {
+            if (atomic_load_explicit(&front[s], memory_order_relaxed) !=
+                atomic_load_explicit(&back[s], memory_order_relaxed))
+                moved++;
+        }
+    }
+    m->last_moved = moved;
+
+    atomic_store_explicit(&m->table, back, memory_order_release);
+    atomic_store_explicit(&m->seq, seq + 2, memory_order_release);
+
+    /* Removed backends are now absent from every table a lookup can see
+     * without retrying */
+    for (int i = 0; i < m->num_slots; i++) {
+        if (m->backends[i].state == MAGLEV_BACKEND_REMOVED)
+            m->backends[i].state = MAGLEV_BACKEND_FREE;
+    }
+    while (m->num_slots > 0 &&
+           m->backends[m->num_slots - 1].state == MAGLEV_BACKEND_FREE)
+        m->num_slots--;
 
-    m->built = true;
+    m->dirty = false;
     return 0;
 }
 
@@ -214,12 +329,23 @@ int maglev_populate(maglev_t *m)
 int maglev_lookup(const maglev_t *m,
                   const uint8_t *flow_key, size_t key_len)
 {
-    if (!m || !m->built || m->num_backends == 0)
+    if (!m || m->size == 0)
         return -1;
 
-    uint32_t h = hash_fnv1a(flow_key, key_len);
-    int slot = (int)(h % MAGLEV_TABLE_SIZE);
-    return m->table[slot];
+    maglev_t *mm = (maglev_t *)m;
+    uint32_t slot = hash_fnv1a(flow_key, key_len) % m->size;
+
+    for (;;) {
+        uint32_t s1 = atomic_load_explicit(&mm->seq, memory_order_acquire);
+        _Atomic int32_t *t = atomic_load_explicit(&mm->table,
+                                                  memory_order_acquire);
+        if (!t)
+            return -1;
+        int32_t v = atomic_load_explicit(&t[slot], memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&mm->seq, memory_order_relaxed) == s1)
+            return v;
+    }
 }
 
 /* --------------------------------------------------------------------------
@@ -237,15 +363,21 @@ int maglev_lookup_node_id(const maglev_t *m,
 }
 
 /* --------------------------------------------------------------------------
- * maglev_get_backend_count / maglev_table_size
+ * maglev_last_disruption / maglev_get_backend_count / maglev_get_table_size
  * -------------------------------------------------------------------------- */
 
+double maglev_last_disruption(const maglev_t *m)
+{
+    if (!m || m->size == 0) return 0.0;
+    return (double)m->last_moved / (double)m->size;
+}
+
 int maglev_get_backend_count(const maglev_t *m)
 {
     return m ? m->num_backends : 0;
 }
 
-int maglev_get_table_size(void)
+uint32_t maglev_get_table_size(const maglev_t *m)
 {
-    return MAGLEV_TABLE_SIZE;
+    return m ? m->size : 0;
 }
@@ -0,0 +1,290 @@
+/*
+ * node_table.c - Exact node_id forwarding table
+ *
+ * Linear probing over a power-of-two array of seqlocked slots.  A slot's
+ * sequence is odd while the (single, mutex-holding) writer edits it;
+ * readers copy the slot with relaxed loads and keep the copy only if the
+ * sequence was even and unchanged around it.  Every field is an atomic
+ * word, so a torn copy is discarded rather than being a data race.
+ */
+
+#include "strandroute/node_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/* --------------------------------------------------------------------------
+ * Slots
+ * -------------------------------------------------------------------------- */
+
+enum {
+    NT_EMPTY = 0,       /* never used since the last cleanup: ends a probe */
+    NT_LIVE,
+    NT_TOMBSTONE,       /* deleted: probes continue past it */
+};
+
+typedef struct {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t meta;      /* state << 16 | port */
+    _Atomic uint64_t key[2];
+    _Atomic uint64_t hop[2];
+} nt_slot_t;
+
+struct node_table {
+    nt_slot_t       *slots;
+    uint32_t         mask;
+    uint32_t         max_entries;
+    _Atomic uint32_t live;
+    pthread_mutex_t  write_lock;
+};
+
+#define NT_META(state, port)  (((uint32_t)(state) << 16) | (uint32_t)(port))
+#define NT_STATE(meta)        ((meta) >> 16)
+#define NT_PORT(meta)         ((strandlink_port_t)((meta) & 0xFFFFu))
+
+static inline void nt_words(uint64_t w[2], const uint8_t id[STRANDLINK_NODE_ID_LEN])
+{
+    memcpy(w, id, STRANDLINK_NODE_ID_LEN);
+}
+
+/* Node IDs are often structured (prefix + counter): mix both halves */
+static inline uint32_t nt_hash(const uint64_t k[2])
+{
+    uint64_t h = k[0] ^ (k[1] * 0x9E3779B97F4A7C15ull);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+/* Consistent copy of @s; returns its meta word */
+static uint32_t nt_slot_read(const nt_slot_t *s, uint64_t key[2], uint64_t hop[2])
+{
+    nt_slot_t *m = (nt_slot_t *)s;
+    for (;;) {
+        uint32_t seq = atomic_load_explicit(&m->seq, memory_order_acquire);
+        if (seq & 1u)
+            continue;
+        uint32_t meta = atomic_load_explicit(&m->meta, memory_order_relaxed);
+        key[0] = atomic_load_explicit(&m->key[0], memory_order_relaxed);
+        key[1] = atomic_load_explicit(&m->key[1], memory_order_relaxed);
+        hop[0] = atomic_load_explicit(&m->hop[0], memory_order_relaxed);
+        hop[1] = atomic_load_explicit(&m->hop[1], memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&m->seq, memory_order_relaxed) == seq)
+            return meta;
+    }
+}
+
+/* Writer side, under write_lock */
+static void nt_slot_write(nt_slot_t *s, uint32_t meta,
+                          const uint64_t key[2], const uint64_t hop[2])
+{
+    uint32_t seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&s->meta, meta, memory_order_relaxed);
+    atomic_store_explicit(&s->key[0], key[0], memory_order_relaxed);
+    atomic_store_explicit(&s->key[1], key[1], memory_order_relaxed);
+    atomic_store_explicit(&s->hop[0], hop[0], memory_order_relaxed);
+    atomic_store_explicit(&s->hop[1], hop[1], memory_order_relaxed);
+    atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+}
+
+/* Writer side: only the writer changes slots, so its reads need no retry */
+static inline uint32_t nt_state(const nt_slot_t *s)
+{
+    return NT_STATE(atomic_load_explicit(&((nt_slot_t *)s)->meta,
+                                         memory_order_relaxed));
+}
+
+static inline bool nt_key_is(const nt_slot_t *s, const uint64_t k[2])
+{
+    nt_slot_t *m = (nt_slot_t *)s;
+    return atomic_load_explicit(&m->key[0], memory_order_relaxed) == k[0] &&
+           atomic_load_explicit(&m->key[1], memory_order_relaxed) == k[1];
+}
+
+/* Live slot holding @k, or -1 */
+static int64_t nt_find(const node_table_t *nt, const uint64_t k[2])
+{
+    uint32_t i = nt_hash(k) & nt->mask;
+    for (uint32_t n = 0; n <= nt->mask; n++, i = (i + 1) & nt->mask) {
+        const nt_slot_t *s = &nt->slots[i];
+        uint32_t st = nt_state(s);
+        if (st == NT_EMPTY)
+            return -1;
+        if (st == NT_LIVE && nt_key_is(s, k))
+            return i;
+    }
+    return -1;
+}
+
+/* --------------------------------------------------------------------------
+ * Lifecycle
+ * -------------------------------------------------------------------------- */
+
+node_table_t *node_table_create(uint32_t max_entries)
+{
+    if (max_entries == 0)
+        max_entries = NODE_TABLE_DEFAULT_ENTRIES;
+    if (max_entries > (1u << 30))
+        return NULL;
+
+    uint32_t nslots = 16;
+    while (nslots < 2 * max_entries)
+        nslots <<= 1;
+
+    node_table_t *nt = calloc(1, sizeof(*nt));
+    if (!nt) return NULL;
+
+    nt->slots = calloc(nslots, sizeof(nt_slot_t));
+    if (!nt->slots) {
+        free(nt);
+        return NULL;
+    }
+    nt->mask        = nslots - 1;
+    nt->max_entries = max_entries;
+    atomic_init(&nt->live, 0);
+    pthread_mutex_init(&nt->write_lock, NULL);
+    return nt;
+}
+
+void node_table_destroy(node_table_t *nt)
+{
+    if (!nt) return;
+    pthread_mutex_destroy(&nt->write_lock);
+    free(nt->slots);
+    free(nt);
+}
+
+/* --------------------------------------------------------------------------
+ * Writers
+ * -------------------------------------------------------------------------- */
+
+int node_table_insert(node_table_t *nt,
+                      const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                      strandlink_port_t port,
+                      const uint8_t next_hop[STRANDLINK_NODE_ID_LEN])
+{
+    if (!nt || !node_id || node_id_is_zero(node_id))
+        return -1;
+
+    uint64_t k[2], hop[2];
+    nt_words(k, node_id);
+    nt_words(hop, next_hop ? next_hop : node_id);
+
+    pthread_mutex_lock(&nt->write_lock);
+
+    /* Replace in place, or take the first free slot on the probe path */
+    int64_t target = -1;
+    uint32_t i = nt_hash(k) & nt->mask;
+    for (uint32_t n = 0; n <= nt->mask; n++, i = (i + 1) & nt->mask) {
+        nt_slot_t *s = &nt->slots[i];
+        uint32_t st = nt_state(s);
+        if (st == NT_LIVE) {
+            if (nt_key_is(s, k)) {
+                nt_slot_write(s, NT_META(NT_LIVE, port), k, hop);
+                pthread_mutex_unlock(&nt->write_lock);
+                return 0;
+            }
+            continue;
+        }
+        if (target < 0)
+            target = i;
+        if (st == NT_EMPTY)
+            break;
+    }
+
+    if (target < 0 ||
+        atomic_load_explicit(&nt->live, memory_order_relaxed) >= nt->max_entries) {
+        pthread_mutex_unlock(&nt->write_lock);
+        return -1;
+    }
+
+    nt_slot_write(&nt->slots[target], NT_META(NT_LIVE, port), k, hop);
+    atomic_fetch_add_explicit(&nt->live, 1, memory_order_relaxed);
+
+    pthread_mutex_unlock(&nt->write_lock);
+    return 0;
+}
+
+int node_table_delete(node_table_t *nt,
+                      const uint8_t node_id[STRANDLINK_NODE_ID_LEN])
+{
+    if (!nt || !node_id)
+        return -1;
+
+    uint64_t k[2];
+    nt_words(k, node_id);
+
+    pthread_mutex_lock(&nt->write_lock);
+
+    int64_t found = nt_find(nt, k);
+    if (found < 0) {
+        pthread_mutex_unlock(&nt->write_lock);
+        return -1;
+    }
+
+    static const uint64_t zero[2] = { 0, 0 };
+    uint32_t i = (uint32_t)found;
+    nt_slot_write(&nt->slots[i], NT_META(NT_TOMBSTONE, 0), zero, zero);
+    atomic_fetch_sub_explicit(&nt->live, 1, memory_order_relaxed);
+
+    /* A tombstone right before an empty slot ends no probe that could
+     * still find something: turn it, and the tombstones before it, back
+     * into empty slots so misses stay short under churn. */
+    if (nt_state(&nt->slots[(i + 1) & nt->mask]) == NT_EMPTY) {
+        for (uint32_t n = 0; n <= nt->mask &&
+                             nt_state(&nt->slots[i]) == NT_TOMBSTONE; n++) {
+            nt_slot_write(&nt->slots[i], NT_META(NT_EMPTY, 0), zero, zero);
+            i = (i - 1) & nt->mask;
+        }
+    }
+
+    pthread_mutex_unlock(&nt->write_lock);
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * Readers
+ * -------------------------------------------------------------------------- */
+
+int node_table_lookup(const node_table_t *nt,
+                      const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                      node_table_hop_t *out)
+{
+    if (!nt || !node_id)
+        return -1;
+
+    uint64_t k[2];
+    nt_words(k, node_id);
+
+    uint32_t i = nt_hash(k) & nt->mask;
+    for (uint32_t n = 0; n <= nt->mask; n++, i = (i + 1) & nt->mask) {
+        uint64_t sk[2], hop[2];
+        uint32_t meta = nt_slot_read(&nt->slots[i], sk, hop);
+        uint32_t st = NT_STATE(meta);
+        if (st == NT_EMPTY)
+            return -1;
+        if (st == NT_LIVE && sk[0] == k[0] && sk[1] == k[1]) {
+            if (out) {
+                out->port = NT_PORT(meta);
+                memcpy(out->next_hop, hop, STRANDLINK_NODE_ID_LEN);
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+uint32_t node_table_count(const node_table_t *nt)
+{
+    if (!nt) return 0;
+    return atomic_load_explicit(&((node_table_t *)nt)->live,
+                                memory_order_relaxed);
+}
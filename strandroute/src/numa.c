@@ -0,0 +1,106 @@
+/*
+ * numa.c - NUMA topology helpers
+ *
+ * The node count comes from /sys/devices/system/node/online, read once.
+ * The current node is getcpu()'s.  Node-local memory is a private
+ * mapping given a preferred-node policy with mbind(2) before anything
+ * touches it: one mmap and one mbind, and since the mapping is ours
+ * alone no unrelated heap data is affected.
+ */
+
+#define _GNU_SOURCE               /* getcpu, syscall */
+
+#include "strandroute/numa.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#define NUMA_MPOL_PREFERRED  1      /* MPOL_PREFERRED */
+#define NUMA_MAX_NODES       1024   /* bits in an mbind node mask */
+
+static int numa_count = 1;
+static pthread_once_t numa_once = PTHREAD_ONCE_INIT;
+static _Thread_local int numa_bound = -1;
+
+/* Parse the sysfs node list ("0", "0-1", "0,2-3") for its highest id */
+static void numa_init(void)
+{
+    FILE *f = fopen("/sys/devices/system/node/online", "r");
+    if (!f) return;
+    int max = -1, lo, hi;
+    char sep;
+    while (fscanf(f, "%d", &lo) == 1) {
+        hi = lo;
+        sep = (char)fgetc(f);
+        if (sep == '-') {
+            if (fscanf(f, "%d", &hi) != 1) break;
+            sep = (char)fgetc(f);
+        }
+        if (hi > max) max = hi;
+        if (sep != ',') break;
+    }
+    fclose(f);
+    if (max >= 0)
+        numa_count = max + 1;
+}
+
+int strand_numa_nodes(void)
+{
+    pthread_once(&numa_once, numa_init);
+    return numa_count;
+}
+
+int strand_numa_this_node(void)
+{
+    if (numa_bound >= 0)
+        return numa_bound;
+#if defined(__linux__)
+    unsigned cpu, node;
+    if (getcpu(&cpu, &node) == 0)
+        return (int)node;
+#endif
+    return 0;
+}
+
+void strand_numa_bind_thread(int node)
+{
+    numa_bound = node < 0 ? -1 : node;
+}
+
+void *strand_numa_alloc(size_t len, int node)
+{
+    if (len == 0)
+        return NULL;
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+#if defined(__linux__) && defined(SYS_mbind)
+    if (node >= 0 && node < strand_numa_nodes() && node < NUMA_MAX_NODES) {
+        unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = { 0 };
+        mask[node / (8 * sizeof(unsigned long))] =
+            1ul << (node % (8 * sizeof(unsigned long)));
+        /* Best effort: on failure the pages fault in wherever touched */
+        (void)syscall(SYS_mbind, p, len, NUMA_MPOL_PREFERRED, mask,
+                      (unsigned long)NUMA_MAX_NODES + 1, 0);
+    }
+#else
+    (void)node;
+#endif
+    return p;
+}
+
+void strand_numa_free(void *p, size_t len)
+{
+    if (p)
+        munmap(p, len);
+}
@@ -0,0 +1,607 @@
+/*
+ * offload.c - Hot-SAD hardware offload
+ *
+ * Sampling: a thread-local tick picks one query in sample_every; its
+ * match key is counted in a depth x width count-min sketch of relaxed
+ * atomic counters (rows indexed by double hashing), and the estimate is
+ * the row minimum.  Keys past the admission floor enter the candidate
+ * table, a linear-probing hash of at most `candidates` keys, under a
+ * trylock so the forwarding path never waits.  When the table is full a
+ * newcomer replaces the coldest candidate if its estimate is higher.
+ *
+ * Refresh re-estimates every candidate from the sketch, ranks them,
+ * resolves the top ones, and diffs the result against the installed
+ * list.  Decay halves each counter with a plain load/store: an increment
+ * racing with it may be lost, which only makes the estimate rougher.
+ */
+
+#include "strandroute/offload.h"
+#include "strandroute/sad_match.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Internal types
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    uint8_t        used;
+    uint8_t        conflict;      /* seen with another descriptor */
+    uint16_t       sad_len;
+    uint32_t       count;
+    p4rt_sad_key_t key;
+    uint8_t       *sad;           /* first descriptor seen with this key */
+} ol_cand_t;
+
+/* One sad_ternary_match entry */
+typedef struct {
+    p4rt_sad_key_t key;
+    p4rt_sad_key_t mask;
+    int            priority;
+    uint8_t        node_id[16];
+} ol_entry_t;
+
+struct offload {
+    offload_config_t cfg;
+
+    /* Count-min sketch */
+    _Atomic uint32_t *sketch;       /* depth rows of width counters */
+    uint32_t          width_mask;
+
+    /* Candidates, under cand_lock */
+    pthread_mutex_t   cand_lock;
+    ol_cand_t        *cands;
+    uint32_t          cand_mask;
+    uint32_t          num_cands;
+    _Atomic uint32_t  admit_floor;  /* estimate a newcomer must exceed */
+
+    /* Installed entries and refresh scratch, owned by the refreshing thread */
+    ol_entry_t       *installed;
+    uint32_t          num_installed;
+    uint32_t          max_installed;
+    ol_entry_t       *want;
+    int32_t          *want_op;      /* op index per wanted entry, -1 = none */
+    int32_t          *want_old;     /* installed index per wanted entry, -1 = new */
+    uint8_t          *keep;         /* per installed entry: still wanted */
+    ol_cand_t       **rank;
+    p4rt_op_t        *ops;
+    ol_entry_t       *next;
+};
+
+static _Thread_local uint32_t ol_tick;
+
+static uint32_t ol_pow2(uint32_t v)
+{
+    uint32_t p = 16;
+    while (p < v)
+        p <<= 1;
+    return p;
+}
+
+static uint64_t ol_hash(const p4rt_sad_key_t *k)
+{
+    uint64_t h = ((uint64_t)k->model_arch << 32) | k->capability;
+    h ^= (uint64_t)k->context_window * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static bool ol_key_eq(const p4rt_sad_key_t *a, const p4rt_sad_key_t *b)
+{
+    return a->model_arch == b->model_arch && a->capability == b->capability &&
+           a->context_window == b->context_window;
+}
+
+static bool ol_entry_same(const ol_entry_t *a, const ol_entry_t *b)
+{
+    return ol_key_eq(&a->key, &b->key) && ol_key_eq(&a->mask, &b->mask) &&
+           a->priority == b->priority;
+}
+
+/* --------------------------------------------------------------------------
+ * Sketch
+ * -------------------------------------------------------------------------- */
+
+static inline _Atomic uint32_t *ol_counter(offload_t *o, uint64_t h, uint32_t row)
+{
+    uint32_t h1 = (uint32_t)h, h2 = (uint32_t)(h >> 32) | 1u;
+    return &o->sketch[row * (o->width_mask + 1) +
+                      ((h1 + row * h2) & o->width_mask)];
+}
+
+static uint32_t ol_estimate(offload_t *o, uint64_t h)
+{
+    uint32_t est = UINT32_MAX;
+    for (uint32_t r = 0; r < o->cfg.sketch_depth; r++) {
+        uint32_t v = atomic_load_explicit(ol_counter(o, h, r), memory_order_relaxed);
+        if (v < est) est = v;
+    }
+    return est;
+}
+
+static void ol_sketch_decay(offload_t *o)
+{
+    size_t n = (size_t)o->cfg.sketch_depth * (o->width_mask + 1);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t v = atomic_load_explicit(&o->sketch[i], memory_order_relaxed);
+        if (v)
+            atomic_store_explicit(&o->sketch[i], v >> 1, memory_order_relaxed);
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Candidate table (under cand_lock)
+ * -------------------------------------------------------------------------- */
+
+static ol_cand_t *cand_find(offload_t *o, const p4rt_sad_key_t *key, uint64_t h)
+{
+    for (uint32_t i = (uint32_t)h & o->cand_mask; o->cands[i].used;
+         i = (i + 1) & o->cand_mask)
+        if (ol_key_eq(&o->cands[i].key, key))
+            return &o->cands[i];
+    return NULL;
+}
+
+/* Backward-shift deletion keeps probe chains intact without tombstones */
+static void cand_remove(offload_t *o, ol_cand_t *c)
+{
+    free(c->sad);
+    uint32_t i = (uint32_t)(c - o->cands);
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & o->cand_mask;
+        if (!o->cands[j].used)
+            break;
+        uint32_t home = (uint32_t)ol_hash(&o->cands[j].key) & o->cand_mask;
+        /* Move j back to i unless its home lies cyclically in (i, j] */
+        if (((j - home) & o->cand_mask) >= ((j - i) & o->cand_mask)) {
+            o->cands[i] = o->cands[j];
+            i = j;
+        }
+    }
+    memset(&o->cands[i], 0, sizeof(o->cands[i]));
+    o->num_cands--;
+}
+
+static ol_cand_t *cand_coldest(offload_t *o)
+{
+    ol_cand_t *min = NULL;
+    for (uint32_t i = 0; i <= o->cand_mask; i++) {
+        ol_cand_t *c = &o->cands[i];
+        if (c->used && (!min || c->count < min->count))
+            min = c;
+    }
+    return min;
+}
+
+static void cand_update_floor(offload_t *o)
+{
+    uint32_t floor = 0;
+    if (o->num_cands >= o->cfg.candidates) {
+        ol_cand_t *min = cand_coldest(o);
+        floor = min ? min->count + 1 : 0;
+    }
+    atomic_store_explicit(&o->admit_floor, floor, memory_order_relaxed);
+}
+
+static void cand_admit(offload_t *o, const p4rt_sad_key_t *key, uint64_t h,
+                       const sad_view_t *query, uint32_t est)
+{
+    ol_cand_t *c = cand_find(o, key, h);
+    if (c) {
+        if (est > c->count)
+            c->count = est;
+        if (!c->conflict && (c->sad_len != query->length ||
+                             memcmp(c->sad, query->buf, query->length) != 0))
+            c->conflict = 1;
+        return;
+    }
+
+    if (o->num_cands >= o->cfg.candidates) {
+        ol_cand_t *victim = cand_coldest(o);
+        if (!victim || victim->count >= est) {
+            cand_update_floor(o);
+            return;
+        }
+        cand_remove(o, victim);
+    }
+
+    uint8_t *copy = malloc(query->length ? query->length : 1);
+    if (!copy)
+        return;
+    memcpy(copy, query->buf, query->length);
+
+    uint32_t i = (uint32_t)h & o->cand_mask;
+    while (o->cands[i].used)
+        i = (i + 1) & o->cand_mask;
+    c = &o->cands[i];
+    c->used     = 1;
+    c->conflict = 0;
+    c->sad_len  = query->length;
+    c->count    = est;
+    c->key      = *key;
+    c->sad      = copy;
+    o->num_cands++;
+
+    if (o->num_cands >= o->cfg.candidates)
+        cand_update_floor(o);
+}
+
+/* --------------------------------------------------------------------------
+ * Lifecycle
+ * -------------------------------------------------------------------------- */
+
+offload_t *offload_create(const offload_config_t *cfg)
+{
+    if (!cfg || !cfg->write_fn)
+        return NULL;
+
+    offload_t *o = calloc(1, sizeof(*o));
+    if (!o) return NULL;
+
+    o->cfg = *cfg;
+    if (!o->cfg.tcam_budget)  o->cfg.tcam_budget  = OFFLOAD_DEFAULT_BUDGET;
+    if (!o->cfg.candidates)   o->cfg.candidates   = 4 * o->cfg.tcam_budget;
+    if (!o->cfg.sketch_width) o->cfg.sketch_width = OFFLOAD_DEFAULT_SKETCH_WIDTH;
+    if (!o->cfg.sketch_depth) o->cfg.sketch_depth = OFFLOAD_DEFAULT_SKETCH_DEPTH;
+    if (!o->cfg.sample_every) o->cfg.sample_every = OFFLOAD_DEFAULT_SAMPLE_EVERY;
+    if (!o->cfg.min_count)    o->cfg.min_count    = OFFLOAD_DEFAULT_MIN_COUNT;
+    if (o->cfg.sketch_depth > OFFLOAD_MAX_SKETCH_DEPTH)
+        o->cfg.sketch_depth = OFFLOAD_MAX_SKETCH_DEPTH;
+    if (o->cfg.candidates < o->cfg.tcam_budget)
+        o->cfg.candidates = o->cfg.tcam_budget;
+    if (o->cfg.sketch_width > (1u << 24) || o->cfg.candidates > (1u << 24)) {
+        free(o);
+        return NULL;
+    }
+
+    uint32_t width   = ol_pow2(o->cfg.sketch_width);
+    o->width_mask    = width - 1;
+    o->cand_mask     = ol_pow2(2 * o->cfg.candidates) - 1;
+    o->max_installed = 2 * o->cfg.tcam_budget;
+
+    size_t   budget  = o->cfg.tcam_budget;
+    o->sketch    = calloc((size_t)width * o->cfg.sketch_depth, sizeof(*o->sketch));
+    o->cands     = calloc((size_t)o->cand_mask + 1, sizeof(*o->cands));
+    o->rank      = calloc(o->cfg.candidates, sizeof(*o->rank));
+    o->installed = calloc(o->max_installed, sizeof(*o->installed));
+    o->next      = calloc(o->max_installed, sizeof(*o->next));
+    o->keep      = calloc(o->max_installed, 1);
+    o->want      = calloc(budget, sizeof(*o->want));
+    o->want_op   = calloc(budget, sizeof(*o->want_op));
+    o->want_old  = calloc(budget, sizeof(*o->want_old));
+    o->ops       = calloc(budget + o->max_installed, sizeof(*o->ops));
+    if (!o->sketch || !o->cands || !o->rank || !o->installed || !o->next ||
+        !o->keep || !o->want || !o->want_op || !o->want_old || !o->ops) {
+        offload_destroy(o);
+        return NULL;
+    }
+
+    pthread_mutex_init(&o->cand_lock, NULL);
+    atomic_init(&o->admit_floor, 0);
+    return o;
+}
+
+void offload_destroy(offload_t *o)
+{
+    if (!o) return;
+    if (o->cands) {
+        for (uint32_t i = 0; i <= o->cand_mask; i++)
+            free(o->cands[i].sad);
+        pthread_mutex_destroy(&o->cand_lock);
+    }
+    free(o->sketch);
+    free(o->cands);
+    free(o->rank);
+    free(o->installed);
+    free(o->next);
+    free(o->keep);
+    free(o->want);
+    free(o->want_op);
+    free(o->want_old);
+    free(o->ops);
+    free(o);
+}
+
+/* --------------------------------------------------------------------------
+ * Sampling
+ * -------------------------------------------------------------------------- */
+
+void offload_record(offload_t *o, const sad_view_t *query)
+{
+    if (!o || !query)
+        return;
+    if (++ol_tick < o->cfg.sample_every)
+        return;
+    ol_tick = 0;
+
+    /* The key the switch extracts (absent fields read as 0) */
+    p4rt_sad_key_t key;
+    key.model_arch     = sad_view_get_uint32(query, SAD_FIELD_MODEL_ARCH);
+    key.capability     = sad_view_get_uint32(query, SAD_FIELD_CAPABILITY);
+    key.context_window = sad_view_get_uint32(query, SAD_FIELD_CONTEXT_WINDOW);
+
+    uint64_t h = ol_hash(&key);
+    uint32_t est = UINT32_MAX;
+    for (uint32_t r = 0; r < o->cfg.sketch_depth; r++) {
+        uint32_t v = atomic_fetch_add_explicit(ol_counter(o, h, r), 1,
+                                               memory_order_relaxed) + 1;
+        if (v < est) est = v;
+    }
+
+    if (est < o->cfg.min_count ||
+        est < atomic_load_explicit(&o->admit_floor, memory_order_relaxed))
+        return;
+    if (pthread_mutex_trylock(&o->cand_lock) != 0)
+        return;
+    cand_admit(o, &key, h, query, est);
+    pthread_mutex_unlock(&o->cand_lock);
+}
+
+/* --------------------------------------------------------------------------
+ * Refresh
+ * -------------------------------------------------------------------------- */
+
+static int rank_cmp(const void *a, const void *b)
+{
+    const ol_cand_t *x = *(ol_cand_t *const *)a;
+    const ol_cand_t *y = *(ol_cand_t *const *)b;
+    if (x->count != y->count)
+        return x->count > y->count ? -1 : 1;
+    if (x->key.model_arch != y->key.model_arch)
+        return x->key.model_arch < y->key.model_arch ? -1 : 1;
+    if (x->key.capability != y->key.capability)
+        return x->key.capability < y->key.capability ? -1 : 1;
+    if (x->key.context_window != y->key.context_window)
+        return x->key.context_window < y->key.context_window ? -1 : 1;
+    return 0;
+}
+
+static int ol_popcount(uint32_t v)
+{
+    int n = 0;
+    for (; v; v &= v - 1)
+        n++;
+    return n;
+}
+
+/*
+ * Entry for candidate @c served by @node: exact on all three fields, or
+ * with widen_context a context prefix [0, 2^k) such that every request
+ * in it fits the node's advertised window.  More mask bits, higher
+ * priority.
+ */
+static void ol_make_entry(const offload_t *o, const ol_cand_t *c,
+                          const route_entry_t *node, ol_entry_t *e)
+{
+    e->key = c->key;
+    e->mask.model_arch     = 0xFFFFFFFFu;
+    e->mask.capability     = 0xFFFFFFFFu;
+    e->mask.context_window = 0xFFFFFFFFu;
+
+    if (o->cfg.widen_context &&
+        sad_find_field(&node->capabilities, SAD_FIELD_CONTEXT_WINDOW)) {
+        uint64_t room = (uint64_t)sad_get_uint32(&node->capabilities,
+                                                 SAD_FIELD_CONTEXT_WINDOW) + 1;
+        int k = 0;
+        while (k < 32 && (2ull << k) <= room)
+            k++;
+        if (k > 0 && c->key.context_window < (1ull << k)) {
+            e->mask.context_window = (uint32_t)(~0ull << k);
+            e->key.context_window  = 0;
+        }
+    }
+
+    e->priority = ol_popcount(e->mask.model_arch) +
+                  ol_popcount(e->mask.capability) +
+                  ol_popcount(e->mask.context_window);
+    memcpy(e->node_id, node->node_id, 16);
+}
+
+static void ol_op(p4rt_op_t *op, p4rt_op_type_t type, const ol_entry_t *e)
+{
+    memset(op, 0, sizeof(*op));
+    op->type     = type;
+    op->sad_key  = e->key;
+    op->sad_mask = e->mask;
+    op->priority = e->priority;
+    memcpy(op->node_id, e->node_id, 16);
+}
+
+/* Index of the installed entry with @e's match, or -1 */
+static int32_t ol_find_installed(const offload_t *o, const ol_entry_t *e)
+{
+    for (uint32_t i = 0; i < o->num_installed; i++)
+        if (ol_entry_same(&o->installed[i], e))
+            return (int32_t)i;
+    return -1;
+}
+
+/* Candidates ranked into o->want; under cand_lock */
+static uint32_t ol_select(offload_t *o, const routing_table_view_t *view,
+                          offload_stats_t *st)
+{
+    uint32_t n_rank = 0;
+    for (uint32_t i = 0; i <= o->cand_mask; i++) {
+        ol_cand_t *c = &o->cands[i];
+        if (!c->used)
+            continue;
+        c->count = ol_estimate(o, ol_hash(&c->key));
+        st->candidates++;
+        if (c->conflict)
+            st->conflicted++;
+        else if (c->count >= o->cfg.min_count)
+            o->rank[n_rank++] = c;
+    }
+    qsort(o->rank, n_rank, sizeof(*o->rank), rank_cmp);
+
+    uint32_t n_want = 0;
+    for (uint32_t r = 0; r < n_rank && n_want < o->cfg.tcam_budget; r++) {
+        const ol_cand_t *c = o->rank[r];
+        sad_view_t v;
+        sad_query_t q;
+        sad_hit_t hit;
+        if (!view || sad_view_init(&v, c->sad, c->sad_len) < 0)
+            continue;
+        sad_query_compile_view(&v, &q);
+        if (routing_table_view_lookup(view, &q, NULL, &hit, 1) <= 0)
+            continue;
+
+        route_entry_t route;
+        ol_entry_t *e = &o->want[n_want];
+        routing_table_view_read(view, hit.index, &route);
+        ol_make_entry(o, c, &route, e);
+
+        /* A widened entry may already cover this key: the hotter one wins */
+        bool dup = false;
+        for (uint32_t j = 0; o->cfg.widen_context && j < n_want && !dup; j++)
+            dup = ol_entry_same(&o->want[j], e);
+        if (!dup)
+            n_want++;
+    }
+    return n_want;
+}
+
+/* Halve every count and forget candidates that reach zero */
+static void ol_decay(offload_t *o)
+{
+    ol_sketch_decay(o);
+    for (uint32_t i = 0; i <= o->cand_mask; i++)
+        o->cands[i].count >>= 1;
+    for (uint32_t i = 0; i <= o->cand_mask; ) {
+        ol_cand_t *c = &o->cands[i];
+        if (c->used && c->count == 0) {
+            cand_remove(o, c);      /* slot i may now hold another candidate */
+            continue;
+        }
+        i++;
+    }
+    cand_update_floor(o);
+}
+
+/*
+ * Send @n_ops and rebuild the installed list from their results: wanted
+ * entries stay only if written (or unchanged), failed modifies keep the
+ * old node, failed evictions stay for the next refresh.
+ */
+static int ol_apply(offload_t *o, uint32_t n_want, uint32_t n_ops,
+                    offload_stats_t *st)
+{
+    if (n_ops > 0) {
+        int rc = o->cfg.write_fn(o->ops, n_ops);
+        if (rc < 0)
+            for (uint32_t i = 0; i < n_ops; i++)
+                o->ops[i].result = rc;
+    }
+
+    uint32_t n = 0;
+    for (uint32_t w = 0; w < n_want; w++) {
+        int32_t op = o->want_op[w], old = o->want_old[w];
+        if (op < 0 || o->ops[op].result == P4RT_OK) {
+            o->next[n++] = o->want[w];
+            if (op >= 0) {
+                if (old >= 0) st->modified++;
+                else          st->added++;
+            }
+        } else {
+            st->failed++;
+            if (old >= 0)
+                o->next[n++] = o->installed[old];
+        }
+    }
+    for (uint32_t i = 0; i < n_ops; i++) {
+        const p4rt_op_t *op = &o->ops[i];
+        if (op->type != P4RT_OP_SAD_DELETE)
+            continue;
+        if (op->result == P4RT_OK || op->result == P4RT_ERR_NOT_FOUND) {
+            st->evicted++;
+            continue;
+        }
+        st->failed++;
+        if (n < o->max_installed) {
+            ol_entry_t *e = &o->next[n++];
+            memset(e, 0, sizeof(*e));
+            e->key      = op->sad_key;
+            e->mask     = op->sad_mask;
+            e->priority = op->priority;
+        }
+    }
+
+    ol_entry_t *t = o->installed;
+    o->installed     = o->next;
+    o->next          = t;
+    o->num_installed = n;
+    st->installed    = n;
+    return (int)st->failed;
+}
+
+/* Diff o->want[0..n_want) against the installed list into o->ops */
+static uint32_t ol_diff(offload_t *o, uint32_t n_want)
+{
+    uint32_t n_ops = 0;
+    memset(o->keep, 0, o->num_installed);
+
+    for (uint32_t w = 0; w < n_want; w++) {
+        const ol_entry_t *e = &o->want[w];
+        int32_t old = ol_find_installed(o, e);
+        o->want_old[w] = old;
+        o->want_op[w]  = -1;
+        if (old >= 0) {
+            o->keep[old] = 1;
+            if (memcmp(o->installed[old].node_id, e->node_id, 16) == 0)
+                continue;
+        }
+        /* An ADD of an installed key is sent as a modify */
+        o->want_op[w] = (int32_t)n_ops;
+        ol_op(&o->ops[n_ops++], P4RT_OP_SAD_ADD, e);
+    }
+    for (uint32_t i = 0; i < o->num_installed; i++)
+        if (!o->keep[i])
+            ol_op(&o->ops[n_ops++], P4RT_OP_SAD_DELETE, &o->installed[i]);
+    return n_ops;
+}
+
+int offload_refresh(offload_t *o, const routing_table_view_t *view,
+                    offload_stats_t *stats)
+{
+    if (!o || !view)
+        return -1;
+
+    offload_stats_t st;
+    memset(&st, 0, sizeof(st));
+
+    pthread_mutex_lock(&o->cand_lock);
+    uint32_t n_want = ol_select(o, view, &st);
+    ol_decay(o);
+    pthread_mutex_unlock(&o->cand_lock);
+
+    /* The write may take a round-trip to the switch: samples keep flowing */
+    uint32_t n_ops = ol_diff(o, n_want);
+    int rc = ol_apply(o, n_want, n_ops, &st);
+    if (stats)
+        *stats = st;
+    return rc;
+}
+
+int offload_clear(offload_t *o)
+{
+    if (!o)
+        return -1;
+
+    offload_stats_t st;
+    memset(&st, 0, sizeof(st));
+    uint32_t n_ops = ol_diff(o, 0);
+    return ol_apply(o, 0, n_ops, &st);
+}
+
+uint32_t offload_installed(const offload_t *o)
+{
+    return o ? o->num_installed : 0;
+}
@@ -5,8 +5,9 @@
  * BMv2 simple_switch.  Two compilation modes:
  *
  *   Default (stub mode, no Thrift dependency):
- *     All operations log to stderr and return P4RT_OK.  This lets the
- *     codebase build and unit-test without a BMv2 installation.
+ *     All operations log to stderr and are applied to the local handle
+ *     cache only, which then stands in for the switch's tables.  This lets
+ *     the codebase build and unit-test without a BMv2 installation.
  *
  *   BMv2 Thrift mode (-DBMV2_THRIFT_ENABLED):
  *     Links against the Thrift-generated SimpleSwitch RPC library and
@@ -19,14 +20,21 @@
  *       -I <bmv2_src>/targets/simple_switch/thrift/gen-cpp
  *       -I <thrift_install>/include
  *
- * Table mapping (see strandroute/p4/*.p4):
+ * Table mapping (see the P4 sources under strandroute/p4/):
  *   sad_ternary_match  : (model_arch, capability_flags, context_window) -> node_id
  *   node_id_forward    : (dst_node_id)                                  -> egress_port
+ *
+ * Every write is planned against the handle cache (match key -> entry
+ * handle + action data) and then executed as add, modify, delete or
+ * nothing.  Batches write a window of requests with the generated
+ * send_* calls before reading any reply with recv_*, so a window costs one
+ * round-trip instead of one per entry.
  */
 
 #include "strandroute/p4_runtime.h"
 #include "strandroute/sad.h"
 #include "strandroute/types.h"
+#include "strandroute/routing_table.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -91,6 +99,21 @@ static struct {
 /* Thrift client objects (heap-allocated, owned here). */
 static std::shared_ptr<TTransport>          g_transport;
 static std::shared_ptr<SimpleSwitch::Client> g_client;
+#else
+/** Handles handed out by the stub "switch". */
+static int32_t g_stub_next_handle = 1;
+#endif
+
+#ifdef BMV2_THRIFT_ENABLED
+/** P4 names per p4rt_table_t. */
+static const char *const g_table_name[P4RT_TABLES] = {
+    "MyIngress.sad_ternary_match",
+    "MyIngress.node_id_forward",
+};
+static const char *const g_action_name[P4RT_TABLES] = {
+    "MyIngress.set_resolved_node",
+    "MyIngress.forward_to_port",
+};
 #endif
 
 /* --------------------------------------------------------------------------
@@ -130,6 +153,485 @@ static int extract_sad_keys(const strandroute_sad_t *sad,
     return 0;
 }
 
+/* Big-endian, as the Thrift byte strings carry P4 bit<32> fields */
+static void pack32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >>  8); p[3] = (uint8_t)(v      );
+}
+
+static uint32_t unpack32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] <<  8) |  (uint32_t)p[3];
+}
+
+/* --------------------------------------------------------------------------
+ * Handle cache
+ *
+ * Match key -> (entry handle, action data) for every installed entry, in
+ * one linear-probing hash over both tables.  Keys and action data are
+ * kept in their wire form: SAD keys as three packed bit<32> values, their
+ * three masks and the priority, node keys as the node ID; SAD data as the
+ * node ID, forwarding data as the 2-byte port.  Protected by g_p4rt_lock.
+ * -------------------------------------------------------------------------- */
+
+#define P4RT_KEY_LEN  28
+
+typedef struct {
+    uint8_t used;
+    uint8_t table;
+    uint8_t key[P4RT_KEY_LEN];
+    uint8_t data[P4RT_KEY_LEN];
+    int32_t handle;
+} p4rt_cache_entry_t;
+
+typedef struct {
+    p4rt_cache_entry_t *slots;
+    size_t              cap;        /* power of two, 0 = not allocated */
+    size_t              size;
+    size_t              count[P4RT_TABLES];
+} p4rt_map_t;
+
+static p4rt_map_t g_p4rt_cache;
+
+static size_t map_hash(int table, const uint8_t key[P4RT_KEY_LEN])
+{
+    uint64_t h = 14695981039346656037ull;   /* FNV-1a */
+    h ^= (uint8_t)table;
+    h *= 1099511628211ull;
+    for (int i = 0; i < P4RT_KEY_LEN; i++) {
+        h ^= key[i];
+        h *= 1099511628211ull;
+    }
+    return (size_t)(h ^ (h >> 29));
+}
+
+static p4rt_cache_entry_t *map_find(const p4rt_map_t *m, int table,
+                                    const uint8_t key[P4RT_KEY_LEN])
+{
+    if (m->cap == 0) return NULL;
+    size_t mask = m->cap - 1;
+    for (size_t i = map_hash(table, key) & mask; m->slots[i].used;
+         i = (i + 1) & mask) {
+        p4rt_cache_entry_t *e = &m->slots[i];
+        if (e->table == table && memcmp(e->key, key, P4RT_KEY_LEN) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+/* Slot for a key known to be absent; the map must have room */
+static p4rt_cache_entry_t *map_slot(p4rt_map_t *m, int table,
+                                    const uint8_t key[P4RT_KEY_LEN])
+{
+    size_t mask = m->cap - 1;
+    size_t i = map_hash(table, key) & mask;
+    while (m->slots[i].used)
+        i = (i + 1) & mask;
+    return &m->slots[i];
+}
+
+/* Rehash into @cap slots, leaving out entries of @drop_table (-1 = none) */
+static int map_rebuild(p4rt_map_t *m, size_t cap, int drop_table)
+{
+    p4rt_cache_entry_t *slots =
+        (p4rt_cache_entry_t *)calloc(cap, sizeof(p4rt_cache_entry_t));
+    if (!slots) return -1;
+
+    p4rt_map_t n;
+    memset(&n, 0, sizeof(n));
+    n.slots = slots;
+    n.cap   = cap;
+    for (size_t i = 0; i < m->cap; i++) {
+        const p4rt_cache_entry_t *e = &m->slots[i];
+        if (!e->used || e->table == drop_table) continue;
+        *map_slot(&n, e->table, e->key) = *e;
+        n.size++;
+        n.count[e->table]++;
+    }
+    free(m->slots);
+    *m = n;
+    return 0;
+}
+
+static int map_put(p4rt_map_t *m, int table, const uint8_t key[P4RT_KEY_LEN],
+                   const uint8_t data[P4RT_KEY_LEN], int32_t handle)
+{
+    p4rt_cache_entry_t *e = map_find(m, table, key);
+    if (!e) {
+        if ((m->size + 1) * 2 > m->cap &&
+            map_rebuild(m, m->cap ? m->cap * 2 : 64, -1) != 0)
+            return -1;
+        e = map_slot(m, table, key);
+        e->used  = 1;
+        e->table = (uint8_t)table;
+        memcpy(e->key, key, P4RT_KEY_LEN);
+        m->size++;
+        m->count[table]++;
+    }
+    memcpy(e->data, data, P4RT_KEY_LEN);
+    e->handle = handle;
+    return 0;
+}
+
+/* Backward-shift deletion: no tombstones */
+static void map_remove(p4rt_map_t *m, p4rt_cache_entry_t *e)
+{
+    size_t mask = m->cap - 1;
+    size_t i = (size_t)(e - m->slots);
+    m->count[e->table]--;
+    m->size--;
+
+    for (size_t j = (i + 1) & mask; m->slots[j].used; j = (j + 1) & mask) {
+        size_t h = map_hash(m->slots[j].table, m->slots[j].key) & mask;
+        /* Entry j may fill the hole unless its home lies in (i, j] */
+        bool stays = (i <= j) ? (i < h && h <= j) : (i < h || h <= j);
+        if (!stays) {
+            m->slots[i] = m->slots[j];
+            i = j;
+        }
+    }
+    m->slots[i].used = 0;
+}
+
+static void map_free(p4rt_map_t *m)
+{
+    free(m->slots);
+    memset(m, 0, sizeof(*m));
+}
+
+/* --------------------------------------------------------------------------
+ * Operation planning
+ * -------------------------------------------------------------------------- */
+
+typedef enum {
+    P4RT_RPC_NONE = 0,      /* nothing to send; op->result already final */
+    P4RT_RPC_ADD,
+    P4RT_RPC_MODIFY,
+    P4RT_RPC_DELETE,
+} p4rt_rpc_t;
+
+typedef struct {
+    p4rt_rpc_t rpc;
+    int        table;
+    int32_t    handle;                  /* MODIFY / DELETE */
+    uint8_t    key[P4RT_KEY_LEN];
+    uint8_t    data[P4RT_KEY_LEN];
+} p4rt_plan_t;
+
+static bool op_is_sad(const p4rt_op_t *op)
+{
+    return op->type == P4RT_OP_SAD_ADD || op->type == P4RT_OP_SAD_DELETE;
+}
+
+/* Wire-form key, data and table of @op */
+static void op_encode(const p4rt_op_t *op, p4rt_plan_t *plan)
+{
+    memset(plan, 0, sizeof(*plan));
+    if (op_is_sad(op)) {
+        p4rt_sad_key_t mask = op->sad_mask;
+        if (!mask.model_arch && !mask.capability && !mask.context_window)
+            mask.model_arch = mask.capability = mask.context_window = 0xFFFFFFFFu;
+        plan->table = P4RT_TABLE_SAD;
+        pack32(plan->key +  0, op->sad_key.model_arch & mask.model_arch);
+        pack32(plan->key +  4, op->sad_key.capability & mask.capability);
+        pack32(plan->key +  8, op->sad_key.context_window & mask.context_window);
+        pack32(plan->key + 12, mask.model_arch);
+        pack32(plan->key + 16, mask.capability);
+        pack32(plan->key + 20, mask.context_window);
+        pack32(plan->key + 24, (uint32_t)(op->priority ? op->priority
+                                                       : P4RT_DEFAULT_PRIORITY));
+        memcpy(plan->data, op->node_id, 16);
+    } else {
+        plan->table = P4RT_TABLE_NODE_FORWARD;
+        memcpy(plan->key, op->node_id, 16);
+        /* Port as 2-byte big-endian (P4 9-bit field packed into 2 bytes) */
+        plan->data[0] = (uint8_t)((op->egress_port >> 8) & 0x01);
+        plan->data[1] = (uint8_t)(op->egress_port & 0xFF);
+    }
+}
+
+/* Decide what @op needs against the cache; sets op->result if nothing */
+static void op_plan(p4rt_op_t *op, p4rt_plan_t *plan)
+{
+    op_encode(op, plan);
+    op->result = P4RT_OK;
+
+    bool add;
+    switch (op->type) {
+    case P4RT_OP_SAD_ADD:     add = true;  break;
+    case P4RT_OP_SAD_DELETE:  add = false; break;
+    case P4RT_OP_NODE_ADD:
+        add = true;
+        if (op->egress_port < 0 || op->egress_port > 511) {
+            op->result = P4RT_ERR_INVAL;
+            return;
+        }
+        break;
+    case P4RT_OP_NODE_DELETE: add = false; break;
+    default:
+        op->result = P4RT_ERR_INVAL;
+        return;
+    }
+
+    const p4rt_cache_entry_t *e = map_find(&g_p4rt_cache, plan->table, plan->key);
+    if (add) {
+        if (!e) {
+            plan->rpc = P4RT_RPC_ADD;
+        } else if (memcmp(e->data, plan->data, P4RT_KEY_LEN) != 0) {
+            plan->rpc    = P4RT_RPC_MODIFY;
+            plan->handle = e->handle;
+        }
+    } else if (e) {
+        plan->rpc    = P4RT_RPC_DELETE;
+        plan->handle = e->handle;
+    } else {
+        op->result = P4RT_ERR_NOT_FOUND;
+    }
+}
+
+/* Apply a completed request to the cache */
+static int plan_commit(const p4rt_plan_t *plan, int32_t handle)
+{
+    if (plan->rpc == P4RT_RPC_DELETE) {
+        p4rt_cache_entry_t *e = map_find(&g_p4rt_cache, plan->table, plan->key);
+        if (e) map_remove(&g_p4rt_cache, e);
+        return P4RT_OK;
+    }
+    if (plan->rpc == P4RT_RPC_MODIFY)
+        handle = plan->handle;
+    return map_put(&g_p4rt_cache, plan->table, plan->key, plan->data, handle) == 0
+               ? P4RT_OK : P4RT_ERR_GENERIC;
+}
+
+/* --------------------------------------------------------------------------
+ * Execution (caller holds g_p4rt_lock and has checked the connection)
+ * -------------------------------------------------------------------------- */
+
+#ifdef BMV2_THRIFT_ENABLED
+
+static const char *op_name(const p4rt_op_t *op)
+{
+    switch (op->type) {
+    case P4RT_OP_SAD_ADD:     return "sad_table_add";
+    case P4RT_OP_SAD_DELETE:  return "sad_table_delete";
+    case P4RT_OP_NODE_ADD:    return "node_forward_add";
+    case P4RT_OP_NODE_DELETE: return "node_forward_delete";
+    default:                  return "unknown_op";
+    }
+}
+
+static std::vector<SimpleSwitch::BmMatchParam> thrift_match(const p4rt_plan_t *plan)
+{
+    std::vector<SimpleSwitch::BmMatchParam> params;
+    if (plan->table == P4RT_TABLE_SAD) {
+        for (int f = 0; f < 3; f++) {
+            SimpleSwitch::BmMatchParam p;
+            SimpleSwitch::BmMatchParamTernary t;
+            t.key  = std::string(reinterpret_cast<const char *>(plan->key + 4 * f), 4);
+            t.mask = std::string(reinterpret_cast<const char *>(plan->key + 12 + 4 * f), 4);
+            p.__set_ternary(t);
+            params.push_back(p);
+        }
+    } else {
+        SimpleSwitch::BmMatchParam p;
+        SimpleSwitch::BmMatchParamExact e;
+        e.key = std::string(reinterpret_cast<const char *>(plan->key), 16);
+        p.__set_exact(e);
+        params.push_back(p);
+    }
+    return params;
+}
+
+static SimpleSwitch::BmActionData thrift_action(const p4rt_plan_t *plan)
+{
+    SimpleSwitch::BmActionData data;
+    size_t len = (plan->table == P4RT_TABLE_SAD) ? 16 : 2;
+    data.push_back(std::string(reinterpret_cast<const char *>(plan->data), len));
+    return data;
+}
+
+/*
+ * Re-read one table from the switch into the cache.  Throws TException
+ * on transport errors.
+ */
+static void cache_load(int table)
+{
+    std::vector<SimpleSwitch::BmMtEntry> entries;
+    g_client->bm_mt_get_entries(entries, 0, g_table_name[table]);
+
+    if (g_p4rt_cache.cap)
+        map_rebuild(&g_p4rt_cache, g_p4rt_cache.cap, table);
+
+    for (const auto &entry : entries) {
+        uint8_t key[P4RT_KEY_LEN] = {0}, data[P4RT_KEY_LEN] = {0};
+        bool ok = true;
+        if (table == P4RT_TABLE_SAD) {
+            ok = entry.match_key.size() == 3;
+            for (int f = 0; ok && f < 3; f++) {
+                const std::string &k = entry.match_key[f].ternary().key;
+                const std::string &m = entry.match_key[f].ternary().mask;
+                ok = k.size() == 4 && m.size() == 4;
+                if (ok) {
+                    memcpy(key + 4 * f, k.data(), 4);
+                    memcpy(key + 12 + 4 * f, m.data(), 4);
+                }
+            }
+            pack32(key + 24, (uint32_t)entry.options.priority);
+        } else {
+            ok = !entry.match_key.empty() &&
+                 entry.match_key[0].exact().key.size() == 16;
+            if (ok) memcpy(key, entry.match_key[0].exact().key.data(), 16);
+        }
+        if (!ok) continue;
+
+        const auto &ad = entry.action_entry.action_data;
+        if (!ad.empty())
+            memcpy(data, ad[0].data(), ad[0].size() < P4RT_KEY_LEN
+                                           ? ad[0].size() : P4RT_KEY_LEN);
+        map_put(&g_p4rt_cache, table, key, data, entry.entry_handle);
+    }
+}
+
+/*
+ * Write every request of the window, then read the replies in order.  A
+ * transport error fails everything not yet answered.
+ */
+static void exec_window(p4rt_op_t *ops, const p4rt_plan_t *plans, size_t n,
+                        int verbose)
+{
+    (void)verbose;
+    size_t i = 0;
+    try {
+        for (; i < n; i++) {
+            const p4rt_plan_t *pl = &plans[i];
+            const char *table = g_table_name[pl->table];
+            switch (pl->rpc) {
+            case P4RT_RPC_ADD: {
+                SimpleSwitch::BmAddEntryOptions options;
+                if (pl->table == P4RT_TABLE_SAD)
+                    options.__set_priority((int32_t)unpack32(pl->key + 24));
+                g_client->send_bm_mt_add_entry(0 /* cxt_id */, table,
+                                               thrift_match(pl),
+                                               g_action_name[pl->table],
+                                               thrift_action(pl), options);
+                break;
+            }
+            case P4RT_RPC_MODIFY:
+                g_client->send_bm_mt_modify_entry(0, table, pl->handle,
+                                                  g_action_name[pl->table],
+                                                  thrift_action(pl));
+                break;
+            case P4RT_RPC_DELETE:
+                g_client->send_bm_mt_delete_entry(0, table, pl->handle);
+                break;
+            case P4RT_RPC_NONE:
+                break;
+            }
+        }
+    } catch (const TException &ex) {
+        fprintf(stderr, "[p4rt] ERROR: %s transport error: %s\n",
+                op_name(&ops[i]), ex.what());
+        /* Replies to what was sent cannot be matched up any more */
+        for (size_t j = 0; j < n; j++)
+            if (plans[j].rpc != P4RT_RPC_NONE) ops[j].result = P4RT_ERR_CONN;
+        return;
+    }
+
+    for (i = 0; i < n; i++) {
+        const p4rt_plan_t *pl = &plans[i];
+        if (pl->rpc == P4RT_RPC_NONE) continue;
+        try {
+            int32_t handle = 0;
+            switch (pl->rpc) {
+            case P4RT_RPC_ADD:    handle = g_client->recv_bm_mt_add_entry(); break;
+            case P4RT_RPC_MODIFY: g_client->recv_bm_mt_modify_entry();       break;
+            case P4RT_RPC_DELETE: g_client->recv_bm_mt_delete_entry();       break;
+            case P4RT_RPC_NONE:   break;
+            }
+            ops[i].result = plan_commit(pl, handle);
+        } catch (const SimpleSwitch::InvalidTableOperation &ex) {
+            fprintf(stderr, "[p4rt] ERROR: %s failed: code=%d\n",
+                    op_name(&ops[i]), ex.code);
+            ops[i].result = P4RT_ERR_GENERIC;
+        } catch (const TException &ex) {
+            fprintf(stderr, "[p4rt] ERROR: %s transport error: %s\n",
+                    op_name(&ops[i]), ex.what());
+            for (size_t j = i; j < n; j++)
+                if (plans[j].rpc != P4RT_RPC_NONE) ops[j].result = P4RT_ERR_CONN;
+            return;
+        }
+    }
+}
+
+#else /* stub */
+
+static void stub_log(const p4rt_op_t *op)
+{
+    char node_hex[33];
+    format_node_id(op->node_id, node_hex);
+    switch (op->type) {
+    case P4RT_OP_SAD_ADD:
+        fprintf(stderr,
+                "[p4rt] STUB: sad_table_add(model_arch=0x%08x, cap=0x%08x, "
+                "ctx_win=0x%08x, node_id=%s)\n",
+                op->sad_key.model_arch, op->sad_key.capability,
+                op->sad_key.context_window, node_hex);
+        break;
+    case P4RT_OP_SAD_DELETE:
+        fprintf(stderr,
+                "[p4rt] STUB: sad_table_delete(model_arch=0x%08x, cap=0x%08x, "
+                "ctx_win=0x%08x)\n",
+                op->sad_key.model_arch, op->sad_key.capability,
+                op->sad_key.context_window);
+        break;
+    case P4RT_OP_NODE_ADD:
+        fprintf(stderr,
+                "[p4rt] STUB: node_forward_add(node_id=%s, egress_port=%d)\n",
+                node_hex, op->egress_port);
+        break;
+    case P4RT_OP_NODE_DELETE:
+        fprintf(stderr,
+                "[p4rt] STUB: node_forward_delete(node_id=%s)\n", node_hex);
+        break;
+    default:
+        break;
+    }
+}
+
+static void exec_window(p4rt_op_t *ops, const p4rt_plan_t *plans, size_t n,
+                        int verbose)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (verbose)
+            stub_log(&ops[i]);
+        if (plans[i].rpc != P4RT_RPC_NONE)
+            ops[i].result = plan_commit(&plans[i], g_stub_next_handle++);
+    }
+}
+
+#endif /* BMV2_THRIFT_ENABLED */
+
+/* One operation, logged as the single-entry calls always were */
+static int apply_one(p4rt_op_t *op)
+{
+    p4rt_plan_t plan;
+
+    pthread_mutex_lock(&g_p4rt_lock);
+
+    if (!g_p4rt_state.connected) {
+        pthread_mutex_unlock(&g_p4rt_lock);
+        return P4RT_ERR_CONN;
+    }
+
+    op_plan(op, &plan);
+    exec_window(op, &plan, 1, 1);
+
+    pthread_mutex_unlock(&g_p4rt_lock);
+    return op->result;
+}
+
 /* --------------------------------------------------------------------------
  * Lifecycle
  * -------------------------------------------------------------------------- */
@@ -178,6 +680,21 @@ int p4rt_init(const char *host, int port)
                 g_p4rt_state.host, g_p4rt_state.port, ex.what());
         rc = P4RT_ERR_CONN;
     }
+
+    /*
+     * Seed the handle cache with what the switch already holds (entries
+     * survive a controller restart), so deletes and re-adds after a
+     * restart need no scan.
+     */
+    if (rc == P4RT_OK) {
+        try {
+            for (int t = 0; t < P4RT_TABLES; t++)
+                cache_load(t);
+        } catch (const TException &ex) {
+            fprintf(stderr, "[p4rt] WARNING: could not read installed entries: %s\n",
+                    ex.what());
+        }
+    }
 #else
     /*
      * Stub mode: pretend we connected successfully.
@@ -194,6 +711,9 @@ int p4rt_init(const char *host, int port)
 
 void p4rt_close(void)
 {
+    /* Queued writes go out before the connection does */
+    p4rt_async_stop();
+
     pthread_mutex_lock(&g_p4rt_lock);
 
     if (!g_p4rt_state.connected) {
@@ -215,6 +735,9 @@ void p4rt_close(void)
     fprintf(stderr, "[p4rt] STUB: close called\n");
 #endif
 
+    /* Re-read at the next p4rt_init */
+    map_free(&g_p4rt_cache);
+
     g_p4rt_state.connected = 0;
     pthread_mutex_unlock(&g_p4rt_lock);
 }
@@ -223,261 +746,322 @@ void p4rt_close(void)
  * SAD table management
  * -------------------------------------------------------------------------- */
 
+int p4rt_sad_key_from(const strandroute_sad_t *sad, p4rt_sad_key_t *key)
+{
+    if (!key || extract_sad_keys(sad, &key->model_arch, &key->capability,
+                                 &key->context_window) != 0)
+        return P4RT_ERR_INVAL;
+    return P4RT_OK;
+}
+
 int p4rt_sad_table_add(const strandroute_sad_t *sad, const uint8_t node_id[16])
 {
-    uint32_t model_arch = 0, capability = 0, context_window = 0;
-    char node_hex[33];
-    int rc = P4RT_OK;
+    p4rt_op_t op;
 
     if (!sad || !node_id) return P4RT_ERR_INVAL;
 
-    if (extract_sad_keys(sad, &model_arch, &capability, &context_window) != 0)
+    memset(&op, 0, sizeof(op));
+    op.type = P4RT_OP_SAD_ADD;
+    if (p4rt_sad_key_from(sad, &op.sad_key) != P4RT_OK)
         return P4RT_ERR_INVAL;
+    memcpy(op.node_id, node_id, 16);
 
-    format_node_id(node_id, node_hex);
+    return apply_one(&op);
+}
 
-    pthread_mutex_lock(&g_p4rt_lock);
+int p4rt_sad_table_delete(const strandroute_sad_t *sad)
+{
+    p4rt_op_t op;
 
-    if (!g_p4rt_state.connected) {
-        pthread_mutex_unlock(&g_p4rt_lock);
-        return P4RT_ERR_CONN;
-    }
+    if (!sad) return P4RT_ERR_INVAL;
 
-#ifdef BMV2_THRIFT_ENABLED
-    /*
-     * Install a ternary entry in the sad_ternary_match table.
-     *
-     * Table:    MyIngress.sad_ternary_match
-     * Action:   MyIngress.set_resolved_node
-     *
-     * Key fields (ternary: value + mask):
-     *   meta.model_arch        : 0x%08x &&& 0xFFFFFFFF  (exact)
-     *   meta.capability_flags  : 0x%08x &&& 0xFFFFFFFF  (exact)
-     *   meta.context_window    : 0x%08x &&& 0xFFFFFFFF  (exact)
-     *
-     * Action parameters:
-     *   node_id : 16 bytes
-     *
-     * Priority: 10 (higher = higher priority in ternary table; use lower
-     *               priority for wildcard / prefix entries).
-     */
-    try {
-        SimpleSwitch::BmMatchParam p_arch, p_cap, p_ctx;
-        SimpleSwitch::BmMatchParamTernary t_arch, t_cap, t_ctx;
-
-        /* Pack uint32 as big-endian 4-byte strings (Thrift uses string for bytes) */
-        auto pack32 = [](uint32_t v) -> std::string {
-            char b[4];
-            b[0] = (v >> 24) & 0xFF; b[1] = (v >> 16) & 0xFF;
-            b[2] = (v >>  8) & 0xFF; b[3] = (v      ) & 0xFF;
-            return std::string(b, 4);
-        };
-        std::string mask32 = std::string("\xFF\xFF\xFF\xFF", 4);
-
-        t_arch.key   = pack32(model_arch);
-        t_arch.mask  = mask32;
-        p_arch.__set_ternary(t_arch);
-
-        t_cap.key  = pack32(capability);
-        t_cap.mask = mask32;
-        p_cap.__set_ternary(t_cap);
-
-        t_ctx.key  = pack32(context_window);
-        t_ctx.mask = mask32;
-        p_ctx.__set_ternary(t_ctx);
-
-        std::vector<SimpleSwitch::BmMatchParam> match_params = {p_arch, p_cap, p_ctx};
-
-        /* Action data: 16-byte node_id */
-        SimpleSwitch::BmActionData action_data;
-        action_data.push_back(std::string(reinterpret_cast<const char *>(node_id), 16));
-
-        int32_t entry_handle = g_client->bm_mt_add_entry(
-            0 /* cxt_id */,
-            "MyIngress.sad_ternary_match",
-            match_params,
-            "MyIngress.set_resolved_node",
-            action_data,
-            SimpleSwitch::BmAddEntryOptions()
-        );
-
-        (void)entry_handle;
-    } catch (const SimpleSwitch::InvalidTableOperation &ex) {
-        fprintf(stderr, "[p4rt] ERROR: sad_table_add failed: code=%d\n", ex.code);
-        rc = P4RT_ERR_GENERIC;
-    } catch (const TException &ex) {
-        fprintf(stderr, "[p4rt] ERROR: sad_table_add transport error: %s\n", ex.what());
-        rc = P4RT_ERR_CONN;
-    }
-#else
-    /* Stub: log the operation */
-    fprintf(stderr,
-            "[p4rt] STUB: sad_table_add(model_arch=0x%08x, cap=0x%08x, "
-            "ctx_win=0x%08x, node_id=%s)\n",
-            model_arch, capability, context_window, node_hex);
-#endif /* BMV2_THRIFT_ENABLED */
+    memset(&op, 0, sizeof(op));
+    op.type = P4RT_OP_SAD_DELETE;
+    if (p4rt_sad_key_from(sad, &op.sad_key) != P4RT_OK)
+        return P4RT_ERR_INVAL;
 
-    pthread_mutex_unlock(&g_p4rt_lock);
-    return rc;
+    return apply_one(&op);
 }
 
-int p4rt_sad_table_delete(const strandroute_sad_t *sad)
+/* --------------------------------------------------------------------------
+ * Node ID forwarding table management
+ * -------------------------------------------------------------------------- */
+
+int p4rt_node_forward_add(const uint8_t node_id[16], int egress_port)
 {
-    uint32_t model_arch = 0, capability = 0, context_window = 0;
-    int rc = P4RT_OK;
+    p4rt_op_t op;
 
-    if (!sad) return P4RT_ERR_INVAL;
+    if (!node_id || egress_port < 0) return P4RT_ERR_INVAL;
 
-    if (extract_sad_keys(sad, &model_arch, &capability, &context_window) != 0)
-        return P4RT_ERR_INVAL;
+    memset(&op, 0, sizeof(op));
+    op.type        = P4RT_OP_NODE_ADD;
+    op.egress_port = egress_port;
+    memcpy(op.node_id, node_id, 16);
 
-    pthread_mutex_lock(&g_p4rt_lock);
+    return apply_one(&op);
+}
 
-    if (!g_p4rt_state.connected) {
-        pthread_mutex_unlock(&g_p4rt_lock);
-        return P4RT_ERR_CONN;
-    }
+int p4rt_node_forward_delete(const uint8_t node_id[16])
+{
+    p4rt_op_t op;
 
-#ifdef BMV2_THRIFT_ENABLED
-    /*
-     * To delete an entry we need its handle.  A production implementation
-     * would maintain a local (model_arch, cap, ctx) -> handle map.
-     *
-     * Here we use bm_mt_get_entries to scan the table for a matching entry,
-     * then call bm_mt_delete_entry with the retrieved handle.  This is O(n)
-     * but acceptable for the control plane.
-     */
-    try {
-        auto pack32 = [](uint32_t v) -> std::string {
-            char b[4];
-            b[0] = (v >> 24) & 0xFF; b[1] = (v >> 16) & 0xFF;
-            b[2] = (v >>  8) & 0xFF; b[3] = (v      ) & 0xFF;
-            return std::string(b, 4);
-        };
-
-        std::string key_arch = pack32(model_arch);
-        std::string key_cap  = pack32(capability);
-        std::string key_ctx  = pack32(context_window);
-
-        std::vector<SimpleSwitch::BmMtEntry> entries;
-        g_client->bm_mt_get_entries(entries, 0, "MyIngress.sad_ternary_match");
-
-        int32_t handle_to_delete = -1;
-        for (const auto &entry : entries) {
-            if (entry.match_key.size() == 3 &&
-                entry.match_key[0].ternary().key == key_arch &&
-                entry.match_key[1].ternary().key == key_cap  &&
-                entry.match_key[2].ternary().key == key_ctx) {
-                handle_to_delete = entry.entry_handle;
-                break;
+    if (!node_id) return P4RT_ERR_INVAL;
+
+    memset(&op, 0, sizeof(op));
+    op.type = P4RT_OP_NODE_DELETE;
+    memcpy(op.node_id, node_id, 16);
+
+    return apply_one(&op);
+}
+
+/* --------------------------------------------------------------------------
+ * Batched writes
+ * -------------------------------------------------------------------------- */
+
+int p4rt_batch_write(p4rt_op_t *ops, size_t count)
+{
+    p4rt_plan_t plans[P4RT_BATCH_WINDOW];
+    unsigned kinds[4] = {0, 0, 0, 0};
+    int failed = 0;
+    size_t i = 0;
+
+    if (!ops && count) return P4RT_ERR_INVAL;
+
+    while (i < count) {
+        pthread_mutex_lock(&g_p4rt_lock);
+
+        if (!g_p4rt_state.connected) {
+            pthread_mutex_unlock(&g_p4rt_lock);
+            if (i == 0) {
+                for (size_t j = 0; j < count; j++) ops[j].result = P4RT_ERR_CONN;
+                return P4RT_ERR_CONN;
             }
+            for (; i < count; i++, failed++) ops[i].result = P4RT_ERR_CONN;
+            break;
         }
 
-        if (handle_to_delete < 0) {
-            rc = P4RT_ERR_NOT_FOUND;
-        } else {
-            g_client->bm_mt_delete_entry(0, "MyIngress.sad_ternary_match",
-                                         handle_to_delete);
+        /* A window ends early at a key it already touches: the plan for
+         * the second operation depends on the first one's reply */
+        size_t n = 0;
+        while (i + n < count && n < P4RT_BATCH_WINDOW) {
+            op_encode(&ops[i + n], &plans[n]);
+            bool repeat = false;
+            for (size_t j = 0; j < n && !repeat; j++)
+                repeat = plans[j].table == plans[n].table &&
+                         memcmp(plans[j].key, plans[n].key, P4RT_KEY_LEN) == 0;
+            if (repeat) break;
+            op_plan(&ops[i + n], &plans[n]);
+            kinds[plans[n].rpc]++;
+            n++;
         }
-    } catch (const SimpleSwitch::InvalidTableOperation &ex) {
-        fprintf(stderr, "[p4rt] ERROR: sad_table_delete failed: code=%d\n", ex.code);
-        rc = P4RT_ERR_GENERIC;
-    } catch (const TException &ex) {
-        fprintf(stderr, "[p4rt] ERROR: sad_table_delete transport error: %s\n", ex.what());
-        rc = P4RT_ERR_CONN;
+
+        exec_window(ops + i, plans, n, 0);
+        pthread_mutex_unlock(&g_p4rt_lock);
+
+        for (size_t j = 0; j < n; j++)
+            if (ops[i + j].result != P4RT_OK) failed++;
+        i += n;
     }
-#else
-    fprintf(stderr,
-            "[p4rt] STUB: sad_table_delete(model_arch=0x%08x, cap=0x%08x, "
-            "ctx_win=0x%08x)\n",
-            model_arch, capability, context_window);
-#endif /* BMV2_THRIFT_ENABLED */
 
-    pthread_mutex_unlock(&g_p4rt_lock);
-    return rc;
+#ifndef BMV2_THRIFT_ENABLED
+    fprintf(stderr, "[p4rt] STUB: batch_write(%zu ops: %u add, %u modify, "
+            "%u delete, %u unchanged/invalid)\n", count,
+            kinds[P4RT_RPC_ADD], kinds[P4RT_RPC_MODIFY],
+            kinds[P4RT_RPC_DELETE], kinds[P4RT_RPC_NONE]);
+#else
+    (void)kinds;
+#endif
+    return failed;
 }
 
 /* --------------------------------------------------------------------------
- * Node ID forwarding table management
+ * Background writer
  * -------------------------------------------------------------------------- */
 
-int p4rt_node_forward_add(const uint8_t node_id[16], int egress_port)
+typedef struct {
+    p4rt_op_t     op;
+    p4rt_done_fn  done;
+    void         *ctx;
+} p4rt_async_item_t;
+
+static pthread_mutex_t g_async_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_async_wake = PTHREAD_COND_INITIALIZER;   /* work or stop */
+static pthread_cond_t  g_async_idle = PTHREAD_COND_INITIALIZER;   /* progress */
+
+/** Writer state, protected by g_async_lock. */
+static struct {
+    int                running;
+    int                stopping;
+    pthread_t          thread;
+    p4rt_async_item_t *ring;
+    size_t             depth;
+    size_t             head;        /* next to take */
+    size_t             tail;        /* next free */
+    uint64_t           submitted;
+    uint64_t           completed;
+} g_async;
+
+static void *async_main(void *arg)
 {
-    char node_hex[33];
-    int rc = P4RT_OK;
+    p4rt_op_t    ops[P4RT_BATCH_WINDOW];
+    p4rt_done_fn done[P4RT_BATCH_WINDOW];
+    void        *ctx[P4RT_BATCH_WINDOW];
+
+    (void)arg;
+    pthread_mutex_lock(&g_async_lock);
+    for (;;) {
+        while (g_async.head == g_async.tail && !g_async.stopping)
+            pthread_cond_wait(&g_async_wake, &g_async_lock);
+        if (g_async.head == g_async.tail)
+            break;  /* stopping, and drained */
+
+        size_t n = 0;
+        while (n < P4RT_BATCH_WINDOW && g_async.head != g_async.tail) {
+            p4rt_async_item_t *it = &g_async.ring[g_async.head % g_async.depth];
+            ops[n]  = it->op;
+            done[n] = it->done;
+            ctx[n]  = it->ctx;
+            g_async.head++;
+            n++;
+        }
+        pthread_mutex_unlock(&g_async_lock);
 
-    if (!node_id || egress_port < 0) return P4RT_ERR_INVAL;
+        p4rt_batch_write(ops, n);
+        for (size_t i = 0; i < n; i++)
+            if (done[i]) done[i](&ops[i], ctx[i]);
 
-    format_node_id(node_id, node_hex);
+        pthread_mutex_lock(&g_async_lock);
+        g_async.completed += n;
+        pthread_cond_broadcast(&g_async_idle);
+    }
+    pthread_mutex_unlock(&g_async_lock);
+    return NULL;
+}
 
-    pthread_mutex_lock(&g_p4rt_lock);
+int p4rt_async_start(size_t queue_depth)
+{
+    if (queue_depth == 0) queue_depth = P4RT_DEFAULT_QUEUE_DEPTH;
 
-    if (!g_p4rt_state.connected) {
-        pthread_mutex_unlock(&g_p4rt_lock);
-        return P4RT_ERR_CONN;
+    pthread_mutex_lock(&g_async_lock);
+
+    if (g_async.running) {
+        pthread_mutex_unlock(&g_async_lock);
+        return P4RT_ERR_GENERIC;
     }
 
-#ifdef BMV2_THRIFT_ENABLED
-    /*
-     * Install an exact-match entry in the node_id_forward table.
-     *
-     * Table:    MyIngress.node_id_forward
-     * Action:   MyIngress.forward_to_port
-     *
-     * Key field (exact):
-     *   hdr.strandlink.dst_node_id : 16 bytes
-     *
-     * Action parameter:
-     *   port : 9 bits packed into 2 bytes (big-endian)
-     */
-    try {
-        SimpleSwitch::BmMatchParam p_node;
-        SimpleSwitch::BmMatchParamExact e_node;
-        e_node.key = std::string(reinterpret_cast<const char *>(node_id), 16);
-        p_node.__set_exact(e_node);
-
-        std::vector<SimpleSwitch::BmMatchParam> match_params = {p_node};
-
-        /* Pack port as 2-byte big-endian (P4 9-bit field packed into 2 bytes) */
-        SimpleSwitch::BmActionData action_data;
-        char port_bytes[2];
-        port_bytes[0] = (egress_port >> 8) & 0x01;  /* upper 1 bit */
-        port_bytes[1] = (egress_port     ) & 0xFF;  /* lower 8 bits */
-        action_data.push_back(std::string(port_bytes, 2));
-
-        g_client->bm_mt_add_entry(
-            0 /* cxt_id */,
-            "MyIngress.node_id_forward",
-            match_params,
-            "MyIngress.forward_to_port",
-            action_data,
-            SimpleSwitch::BmAddEntryOptions()
-        );
-    } catch (const SimpleSwitch::InvalidTableOperation &ex) {
-        fprintf(stderr, "[p4rt] ERROR: node_forward_add failed: code=%d\n", ex.code);
-        rc = P4RT_ERR_GENERIC;
-    } catch (const TException &ex) {
-        fprintf(stderr, "[p4rt] ERROR: node_forward_add transport error: %s\n", ex.what());
-        rc = P4RT_ERR_CONN;
+    g_async.ring = (p4rt_async_item_t *)calloc(queue_depth, sizeof(p4rt_async_item_t));
+    if (!g_async.ring) {
+        pthread_mutex_unlock(&g_async_lock);
+        return P4RT_ERR_GENERIC;
     }
-#else
-    fprintf(stderr,
-            "[p4rt] STUB: node_forward_add(node_id=%s, egress_port=%d)\n",
-            node_hex, egress_port);
-#endif /* BMV2_THRIFT_ENABLED */
+    g_async.depth     = queue_depth;
+    g_async.head      = 0;
+    g_async.tail      = 0;
+    g_async.submitted = 0;
+    g_async.completed = 0;
+    g_async.stopping  = 0;
+
+    if (pthread_create(&g_async.thread, NULL, async_main, NULL) != 0) {
+        free(g_async.ring);
+        g_async.ring = NULL;
+        pthread_mutex_unlock(&g_async_lock);
+        return P4RT_ERR_GENERIC;
+    }
+    g_async.running = 1;
 
-    pthread_mutex_unlock(&g_p4rt_lock);
-    return rc;
+    pthread_mutex_unlock(&g_async_lock);
+    return P4RT_OK;
 }
 
-int p4rt_node_forward_delete(const uint8_t node_id[16])
+int p4rt_async_submit(const p4rt_op_t *op, p4rt_done_fn done, void *ctx)
 {
-    char node_hex[33];
-    int rc = P4RT_OK;
+    if (!op) return P4RT_ERR_INVAL;
 
-    if (!node_id) return P4RT_ERR_INVAL;
+    pthread_mutex_lock(&g_async_lock);
 
-    format_node_id(node_id, node_hex);
+    if (!g_async.running || g_async.stopping) {
+        pthread_mutex_unlock(&g_async_lock);
+        return P4RT_ERR_GENERIC;
+    }
+    if (g_async.tail - g_async.head >= g_async.depth) {
+        pthread_mutex_unlock(&g_async_lock);
+        return P4RT_ERR_FULL;
+    }
+
+    p4rt_async_item_t *it = &g_async.ring[g_async.tail % g_async.depth];
+    it->op   = *op;
+    it->done = done;
+    it->ctx  = ctx;
+    g_async.tail++;
+    g_async.submitted++;
+    pthread_cond_signal(&g_async_wake);
+
+    pthread_mutex_unlock(&g_async_lock);
+    return P4RT_OK;
+}
+
+int p4rt_async_flush(void)
+{
+    pthread_mutex_lock(&g_async_lock);
+
+    if (!g_async.running) {
+        pthread_mutex_unlock(&g_async_lock);
+        return P4RT_ERR_GENERIC;
+    }
+
+    uint64_t target = g_async.submitted;
+    while (g_async.completed < target)
+        pthread_cond_wait(&g_async_idle, &g_async_lock);
+
+    pthread_mutex_unlock(&g_async_lock);
+    return P4RT_OK;
+}
+
+void p4rt_async_stop(void)
+{
+    pthread_mutex_lock(&g_async_lock);
+
+    if (!g_async.running || g_async.stopping) {
+        pthread_mutex_unlock(&g_async_lock);
+        return;
+    }
+    g_async.stopping = 1;
+    pthread_cond_signal(&g_async_wake);
+    pthread_t thread = g_async.thread;
+
+    pthread_mutex_unlock(&g_async_lock);
+    pthread_join(thread, NULL);
+    pthread_mutex_lock(&g_async_lock);
+
+    free(g_async.ring);
+    g_async.ring     = NULL;
+    g_async.running  = 0;
+    g_async.stopping = 0;
+    pthread_cond_broadcast(&g_async_idle);
+
+    pthread_mutex_unlock(&g_async_lock);
+}
+
+/* --------------------------------------------------------------------------
+ * Diff-based sync
+ * -------------------------------------------------------------------------- */
+
+/*
+ * Reconcile @table with @want (ADD operations of that table, consumed):
+ * send the ADDs that change something and a DELETE for every installed
+ * key not wanted.
+ */
+static int sync_table(int table, p4rt_op_t *want, size_t n_want,
+                      p4rt_sync_stats_t *stats)
+{
+    p4rt_sync_stats_t st;
+    p4rt_map_t wanted;
+    p4rt_plan_t plan;
+    size_t n_ops = 0;
+    int rc = P4RT_OK;
+
+    memset(&st, 0, sizeof(st));
+    memset(&wanted, 0, sizeof(wanted));
 
     pthread_mutex_lock(&g_p4rt_lock);
 
@@ -487,45 +1071,138 @@ int p4rt_node_forward_delete(const uint8_t node_id[16])
     }
 
 #ifdef BMV2_THRIFT_ENABLED
-    /*
-     * Scan node_id_forward table for the entry matching node_id, then delete.
-     * Same linear-scan strategy as sad_table_delete; production code should
-     * maintain a node_id -> handle map.
-     */
     try {
-        std::string key_node(reinterpret_cast<const char *>(node_id), 16);
+        cache_load(table);
+    } catch (const TException &ex) {
+        fprintf(stderr, "[p4rt] ERROR: sync could not read installed entries: %s\n",
+                ex.what());
+        pthread_mutex_unlock(&g_p4rt_lock);
+        return P4RT_ERR_CONN;
+    }
+#endif
 
-        std::vector<SimpleSwitch::BmMtEntry> entries;
-        g_client->bm_mt_get_entries(entries, 0, "MyIngress.node_id_forward");
+    size_t max_ops = n_want + g_p4rt_cache.count[table];
+    p4rt_op_t *ops = (p4rt_op_t *)malloc((max_ops ? max_ops : 1) * sizeof(p4rt_op_t));
+    uint8_t *modify = (uint8_t *)calloc(max_ops ? max_ops : 1, 1);
+    if (!ops || !modify) {
+        pthread_mutex_unlock(&g_p4rt_lock);
+        rc = P4RT_ERR_GENERIC;
+        goto out;
+    }
 
-        int32_t handle_to_delete = -1;
-        for (const auto &entry : entries) {
-            if (!entry.match_key.empty() &&
-                entry.match_key[0].exact().key == key_node) {
-                handle_to_delete = entry.entry_handle;
-                break;
-            }
+    /* Wanted entries that change nothing are dropped here */
+    for (size_t i = 0; i < n_want; i++) {
+        op_encode(&want[i], &plan);
+        if (map_find(&wanted, table, plan.key))
+            continue;   /* duplicate key: first wins */
+        if (map_put(&wanted, table, plan.key, plan.data, 0) != 0) {
+            pthread_mutex_unlock(&g_p4rt_lock);
+            rc = P4RT_ERR_GENERIC;
+            goto out;
+        }
+
+        const p4rt_cache_entry_t *e = map_find(&g_p4rt_cache, table, plan.key);
+        if (e && memcmp(e->data, plan.data, P4RT_KEY_LEN) == 0) {
+            st.unchanged++;
+            continue;
         }
+        modify[n_ops] = (e != NULL);
+        ops[n_ops++]  = want[i];
+    }
 
-        if (handle_to_delete < 0) {
-            rc = P4RT_ERR_NOT_FOUND;
+    /* Installed entries nobody wants */
+    for (size_t s = 0; s < g_p4rt_cache.cap; s++) {
+        const p4rt_cache_entry_t *e = &g_p4rt_cache.slots[s];
+        if (!e->used || e->table != table || map_find(&wanted, table, e->key))
+            continue;
+        p4rt_op_t *op = &ops[n_ops++];
+        memset(op, 0, sizeof(*op));
+        if (table == P4RT_TABLE_SAD) {
+            op->type = P4RT_OP_SAD_DELETE;
+            op->sad_key.model_arch      = unpack32(e->key +  0);
+            op->sad_key.capability      = unpack32(e->key +  4);
+            op->sad_key.context_window  = unpack32(e->key +  8);
+            op->sad_mask.model_arch     = unpack32(e->key + 12);
+            op->sad_mask.capability     = unpack32(e->key + 16);
+            op->sad_mask.context_window = unpack32(e->key + 20);
+            op->priority                = (int)unpack32(e->key + 24);
         } else {
-            g_client->bm_mt_delete_entry(0, "MyIngress.node_id_forward",
-                                         handle_to_delete);
+            op->type = P4RT_OP_NODE_DELETE;
+            memcpy(op->node_id, e->key, 16);
         }
-    } catch (const SimpleSwitch::InvalidTableOperation &ex) {
-        fprintf(stderr, "[p4rt] ERROR: node_forward_delete failed: code=%d\n", ex.code);
-        rc = P4RT_ERR_GENERIC;
-    } catch (const TException &ex) {
-        fprintf(stderr, "[p4rt] ERROR: node_forward_delete transport error: %s\n", ex.what());
-        rc = P4RT_ERR_CONN;
     }
-#else
-    fprintf(stderr,
-            "[p4rt] STUB: node_forward_delete(node_id=%s)\n", node_hex);
-#endif /* BMV2_THRIFT_ENABLED */
 
     pthread_mutex_unlock(&g_p4rt_lock);
+
+    if (n_ops > 0) {
+        int r = p4rt_batch_write(ops, n_ops);
+        if (r < 0) {
+            rc = r;
+            goto out;
+        }
+    }
+    for (size_t i = 0; i < n_ops; i++) {
+        if (ops[i].result != P4RT_OK)
+            st.failed++;
+        else if (ops[i].type == P4RT_OP_SAD_DELETE || ops[i].type == P4RT_OP_NODE_DELETE)
+            st.deleted++;
+        else if (modify[i])
+            st.modified++;
+        else
+            st.added++;
+    }
+    rc = (int)st.failed;
+
+out:
+    if (stats) *stats = st;
+    map_free(&wanted);
+    free(modify);
+    free(ops);
+    return rc;
+}
+
+int p4rt_sync_routing_table(const routing_table_view_t *view,
+                            p4rt_sync_stats_t *stats)
+{
+    if (!view) return P4RT_ERR_INVAL;
+
+    uint32_t n = routing_table_view_count(view);
+    p4rt_op_t *want = (p4rt_op_t *)calloc(n ? n : 1, sizeof(p4rt_op_t));
+    if (!want) return P4RT_ERR_GENERIC;
+
+    route_entry_t e;
+    for (uint32_t r = 0; r < n; r++) {
+        routing_table_view_read(view, r, &e);
+        want[r].type = P4RT_OP_SAD_ADD;
+        p4rt_sad_key_from(&e.capabilities, &want[r].sad_key);
+        memcpy(want[r].node_id, e.node_id, 16);
+    }
+
+    int rc = sync_table(P4RT_TABLE_SAD, want, n, stats);
+    free(want);
+    return rc;
+}
+
+int p4rt_sync_node_forward(const p4rt_node_route_t *routes, size_t count,
+                           p4rt_sync_stats_t *stats)
+{
+    if (!routes && count) return P4RT_ERR_INVAL;
+
+    p4rt_op_t *want = (p4rt_op_t *)calloc(count ? count : 1, sizeof(p4rt_op_t));
+    if (!want) return P4RT_ERR_GENERIC;
+
+    for (size_t i = 0; i < count; i++) {
+        if (routes[i].egress_port < 0 || routes[i].egress_port > 511) {
+            free(want);
+            return P4RT_ERR_INVAL;
+        }
+        want[i].type        = P4RT_OP_NODE_ADD;
+        want[i].egress_port = routes[i].egress_port;
+        memcpy(want[i].node_id, routes[i].node_id, 16);
+    }
+
+    int rc = sync_table(P4RT_TABLE_NODE_FORWARD, want, count, stats);
+    free(want);
     return rc;
 }
 
@@ -554,3 +1231,13 @@ int p4rt_is_connected(void)
     pthread_mutex_unlock(&g_p4rt_lock);
     return ret;
 }
+
+size_t p4rt_cached_entries(p4rt_table_t table)
+{
+    size_t n = 0;
+    if ((int)table < 0 || table >= P4RT_TABLES) return 0;
+    pthread_mutex_lock(&g_p4rt_lock);
+    n = g_p4rt_cache.count[table];
+    pthread_mutex_unlock(&g_p4rt_lock);
+    return n;
+}
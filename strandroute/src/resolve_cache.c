@@ -0,0 +1,253 @@
+/*
+ * resolve_cache.c - Memoised SAD resolution
+ *
+ * Set-associative table of RESOLVE_CACHE_WAYS entries per set, indexed by
+ * a hash of the compiled query and weights.  The full key is stored and
+ * compared, so a hash collision costs a miss, never a wrong answer.  The
+ * least recently used way of a set is replaced on insert.
+ *
+ * The cached value is the hit list itself: row indices are stable for
+ * the lifetime of a snapshot generation, which is exactly the lifetime
+ * of an entry.
+ */
+
+#define _POSIX_C_SOURCE 200809L  /* clock_gettime */
+
+#include "strandroute/resolve_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define RESOLVE_CACHE_WAYS  4
+
+/* --------------------------------------------------------------------------
+ * Internal types
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    uint64_t          hash;             /* 0 = empty */
+    uint64_t          generation;       /* snapshot the hits index into */
+    uint64_t          metrics_version;  /* read before the hits were scored */
+    uint64_t          stored_ns;        /* only kept when a TTL is set */
+    uint64_t          last_used;        /* cache tick, for replacement */
+    int32_t           max_hits;
+    int32_t           num_hits;
+    sad_query_t       query;
+    scoring_weights_t weights;
+    sad_hit_t         hits[RESOLVE_CACHE_MAX_HITS];
+} cache_entry_t;
+
+struct resolve_cache {
+    cache_entry_t   *entries;
+    uint32_t         set_mask;          /* number of sets - 1 */
+    uint64_t         ttl_ns;
+    uint64_t         tick;
+
+    /* Written by the owner only; relaxed atomics so others may read them */
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+    _Atomic uint64_t stale_hits;
+};
+
+/* --------------------------------------------------------------------------
+ * Helpers
+ * -------------------------------------------------------------------------- */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Single-writer counter bump: no locked read-modify-write needed */
+static inline void counter_inc(_Atomic uint64_t *c)
+{
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+static inline uint64_t mix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0x100000001b3ull;
+        h ^= h >> 29;
+        p += 8;
+        len -= 8;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p, len);
+    return (h ^ w ^ (uint64_t)len) * 0x100000001b3ull;
+}
+
+/* sad_query_compile zero-fills its output, so padding and unused region
+ * slots are deterministic and the struct can be hashed and compared as
+ * bytes. */
+static uint64_t key_hash(const sad_query_t *q, const scoring_weights_t *w,
+                         int max_hits)
+{
+    uint64_t h = hash_bytes(0xcbf29ce484222325ull, q, sizeof(*q));
+    h = hash_bytes(h, w, sizeof(*w));
+    h = mix64(h ^ (uint64_t)(uint32_t)max_hits);
+    return h ? h : 1;
+}
+
+static inline bool key_equal(const cache_entry_t *e, uint64_t h,
+                             const sad_query_t *q,
+                             const scoring_weights_t *w, int max_hits)
+{
+    return e->hash == h && e->max_hits == max_hits &&
+           memcmp(&e->query, q, sizeof(*q)) == 0 &&
+           memcmp(&e->weights, w, sizeof(*w)) == 0;
+}
+
+/* --------------------------------------------------------------------------
+ * Lifecycle
+ * -------------------------------------------------------------------------- */
+
+resolve_cache_t *resolve_cache_create(const resolve_cache_config_t *config)
+{
+    uint32_t want = (config && config->entries) ? config->entries
+                                                : RESOLVE_CACHE_DEFAULT_ENTRIES;
+    if (want > (1u << 24))
+        want = 1u << 24;
+
+    uint32_t n = RESOLVE_CACHE_WAYS;
+    while (n < want)
+        n <<= 1;
+
+    resolve_cache_t *c = calloc(1, sizeof(resolve_cache_t));
+    if (!c) return NULL;
+    c->entries = calloc(n, sizeof(cache_entry_t));
+    if (!c->entries) { free(c); return NULL; }
+
+    c->set_mask = n / RESOLVE_CACHE_WAYS - 1;
+    c->ttl_ns   = config ? config->metrics_ttl_ns : 0;
+    atomic_init(&c->hits, 0);
+    atomic_init(&c->misses, 0);
+    atomic_init(&c->stale_hits, 0);
+    return c;
+}
+
+void resolve_cache_destroy(resolve_cache_t *cache)
+{
+    if (!cache) return;
+    free(cache->entries);
+    free(cache);
+}
+
+void resolve_cache_clear(resolve_cache_t *cache)
+{
+    if (!cache) return;
+    memset(cache->entries, 0,
+           (size_t)(cache->set_mask + 1) * RESOLVE_CACHE_WAYS *
+           sizeof(cache_entry_t));
+}
+
+/* --------------------------------------------------------------------------
+ * resolve_cache_lookup
+ * -------------------------------------------------------------------------- */
+
+int resolve_cache_lookup(resolve_cache_t *cache,
+                         const routing_table_view_t *view,
+                         const sad_query_t *query,
+                         const scoring_weights_t *weights,
+                         sad_hit_t *hits,
+                         int max_hits)
+{
+    if (!view || !query || !hits || max_hits <= 0)
+        return -1;
+    if (!cache || max_hits > RESOLVE_CACHE_MAX_HITS)
+        return routing_table_view_lookup(view, query, weights, hits, max_hits);
+
+    scoring_weights_t w = weights ? *weights : scoring_weights_default();
+    uint64_t gen  = routing_table_view_generation(view);
+    uint64_t mver = routing_table_view_metrics_version(view);
+    uint64_t h    = key_hash(query, &w, max_hits);
+
+    cache_entry_t *set = &cache->entries[(size_t)((h >> 32) & cache->set_mask) *
+                                         RESOLVE_CACHE_WAYS];
+    cache_entry_t *victim = &set[0];
+    cache->tick++;
+
+    for (int i = 0; i < RESOLVE_CACHE_WAYS; i++) {
+        cache_entry_t *e = &set[i];
+        if (!key_equal(e, h, query, &w, max_hits)) {
+            if (e->last_used < victim->last_used)
+                victim = e;
+            continue;
+        }
+
+        bool stale = false;
+        if (e->generation != gen) {
+            victim = e;
+            break;
+        }
+        if (e->metrics_version != mver) {
+            if (cache->ttl_ns == 0 || now_ns() - e->stored_ns > cache->ttl_ns) {
+                victim = e;
+                break;
+            }
+            stale = true;
+        }
+
+        e->last_used = cache->tick;
+        memcpy(hits, e->hits, (size_t)e->num_hits * sizeof(sad_hit_t));
+        counter_inc(&cache->hits);
+        if (stale)
+            counter_inc(&cache->stale_hits);
+        return e->num_hits;
+    }
+
+    counter_inc(&cache->misses);
+
+    /* mver was read before scoring: if metrics move during the scan, the
+     * entry is already out of date and the next lookup refreshes it */
+    int n = routing_table_view_lookup(view, query, &w, hits, max_hits);
+    if (n < 0)
+        return n;
+
+    victim->hash            = h;
+    victim->generation      = gen;
+    victim->metrics_version = mver;
+    victim->stored_ns       = cache->ttl_ns ? now_ns() : 0;
+    victim->last_used       = cache->tick;
+    victim->max_hits        = max_hits;
+    victim->num_hits        = n;
+    memcpy(&victim->query, query, sizeof(*query));
+    memcpy(&victim->weights, &w, sizeof(w));
+    memcpy(victim->hits, hits, (size_t)n * sizeof(sad_hit_t));
+    return n;
+}
+
+/* --------------------------------------------------------------------------
+ * resolve_cache_stats
+ * -------------------------------------------------------------------------- */
+
+void resolve_cache_stats(const resolve_cache_t *cache,
+                         resolve_cache_stats_t *out)
+{
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!cache) return;
+
+    resolve_cache_t *c = (resolve_cache_t *)cache;
+    out->hits       = atomic_load_explicit(&c->hits, memory_order_relaxed);
+    out->misses     = atomic_load_explicit(&c->misses, memory_order_relaxed);
+    out->stale_hits = atomic_load_explicit(&c->stale_hits, memory_order_relaxed);
+}
@@ -4,34 +4,135 @@
  * Given a SAD query and a routing table, compute match scores for all
  * entries, apply scoring weights, and return the top-K sorted results.
  * This is the high-level resolution API that ties sad_match + routing_table.
+ * Weights come from named profiles (see resolver.h), so tenants with
+ * different priorities share one table without copying it.
  */
 
+#include "strandroute/resolver.h"
 #include "strandroute/routing_table.h"
+#include "strandroute/routing_shards.h"
+#include "strandroute/resolve_cache.h"
 #include "strandroute/sad.h"
+#include "strandroute/sad_match.h"
 #include "strandroute/types.h"
 
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
 /* --------------------------------------------------------------------------
- * Resolver context - holds weights and any per-query state
+ * Weight profiles
+ *
+ * A fixed table of slots, appended to under a lock and never removed, so
+ * an id stays valid and names never change once published.  Each slot's
+ * weights sit behind a sequence counter: writers bump it to odd, store,
+ * and bump it back to even, and readers retry a copy that straddled a
+ * write.  Lookups take no lock and never see half an update.
  * -------------------------------------------------------------------------- */
 
 typedef struct {
-    scoring_weights_t weights;
-    int               top_k;        /* max results to return */
-} resolver_config_t;
-
-static resolver_config_t g_resolver_config = {
-    .weights = {
-        .capability     = 0.30f,
-        .latency        = 0.25f,
-        .cost           = 0.20f,
-        .context_window = 0.15f,
-        .trust          = 0.10f,
+    char             name[RESOLVER_PROFILE_NAME_MAX];
+    _Atomic uint32_t seq;       /* odd while a write is in progress */
+    _Atomic float    w[5];      /* scoring_weights_t field order */
+} resolver_profile_t;
+
+static resolver_profile_t g_profiles[RESOLVER_MAX_PROFILES] = {
+    [RESOLVER_PROFILE_DEFAULT] = {
+        .name = "default",
+        .w    = { 0.30f, 0.25f, 0.20f, 0.15f, 0.10f },
     },
-    .top_k = 3,
 };
+static _Atomic uint32_t g_num_profiles = 1;
+static pthread_mutex_t  g_profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic int      g_top_k = 3;   /* max results to return */
+
+/* Reject degenerate weight vectors: any negative weight or a zero/negative
+ * sum would cause division-by-zero or inverted scoring in sad_find_best. */
+static bool weights_valid(const scoring_weights_t *w)
+{
+    float sum = w->capability + w->latency + w->cost + w->context_window + w->trust;
+    return sum > 0.0f &&
+           w->capability >= 0.0f && w->latency >= 0.0f && w->cost >= 0.0f &&
+           w->context_window >= 0.0f && w->trust >= 0.0f;
+}
+
+static void profile_store(resolver_profile_t *p, const scoring_weights_t *w)
+{
+    uint32_t seq = atomic_load_explicit(&p->seq, memory_order_relaxed);
+    atomic_store_explicit(&p->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&p->w[0], w->capability,     memory_order_relaxed);
+    atomic_store_explicit(&p->w[1], w->latency,        memory_order_relaxed);
+    atomic_store_explicit(&p->w[2], w->cost,           memory_order_relaxed);
+    atomic_store_explicit(&p->w[3], w->context_window, memory_order_relaxed);
+    atomic_store_explicit(&p->w[4], w->trust,          memory_order_relaxed);
+    atomic_store_explicit(&p->seq, seq + 2, memory_order_release);
+}
+
+static int profile_load(int profile, scoring_weights_t *out)
+{
+    if (profile < 0 ||
+        (uint32_t)profile >= atomic_load_explicit(&g_num_profiles, memory_order_acquire))
+        return -1;
+
+    resolver_profile_t *p = &g_profiles[profile];
+    uint32_t s0, s1;
+    do {
+        s0 = atomic_load_explicit(&p->seq, memory_order_acquire);
+        out->capability     = atomic_load_explicit(&p->w[0], memory_order_relaxed);
+        out->latency        = atomic_load_explicit(&p->w[1], memory_order_relaxed);
+        out->cost           = atomic_load_explicit(&p->w[2], memory_order_relaxed);
+        out->context_window = atomic_load_explicit(&p->w[3], memory_order_relaxed);
+        out->trust          = atomic_load_explicit(&p->w[4], memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        s1 = atomic_load_explicit(&p->seq, memory_order_relaxed);
+    } while ((s0 & 1) || s0 != s1);
+    return 0;
+}
+
+int resolver_profile_find(const char *name)
+{
+    if (!name) return -1;
+    uint32_t n = atomic_load_explicit(&g_num_profiles, memory_order_acquire);
+    for (uint32_t i = 0; i < n; i++) {
+        if (strcmp(g_profiles[i].name, name) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+int resolver_profile_register(const char *name, const scoring_weights_t *w)
+{
+    if (!name || !w || !weights_valid(w))
+        return -1;
+    size_t len = strlen(name);
+    if (len == 0 || len >= RESOLVER_PROFILE_NAME_MAX)
+        return -1;
+
+    pthread_mutex_lock(&g_profile_lock);
+    int id = resolver_profile_find(name);
+    if (id < 0) {
+        uint32_t n = atomic_load_explicit(&g_num_profiles, memory_order_relaxed);
+        if (n < RESOLVER_MAX_PROFILES) {
+            memcpy(g_profiles[n].name, name, len + 1);
+            profile_store(&g_profiles[n], w);
+            atomic_store_explicit(&g_num_profiles, n + 1, memory_order_release);
+            id = (int)n;
+        }
+    } else {
+        profile_store(&g_profiles[id], w);
+    }
+    pthread_mutex_unlock(&g_profile_lock);
+    return id;
+}
+
+int resolver_profile_weights(int profile, scoring_weights_t *out)
+{
+    if (!out) return -1;
+    return profile_load(profile, out);
+}
 
 /* --------------------------------------------------------------------------
  * resolver_set_weights / resolver_set_top_k
@@ -39,30 +140,67 @@ static resolver_config_t g_resolver_config = {
 
 void resolver_set_weights(const scoring_weights_t *w)
 {
-    if (!w) return;
-    /* Reject degenerate weight vectors: any negative weight or a zero/negative
-     * sum would cause division-by-zero or inverted scoring in sad_find_best. */
-    float sum = w->capability + w->latency + w->cost + w->context_window + w->trust;
-    if (sum <= 0.0f)   return;
-    if (w->capability     < 0.0f) return;
-    if (w->latency        < 0.0f) return;
-    if (w->cost           < 0.0f) return;
-    if (w->context_window < 0.0f) return;
-    if (w->trust          < 0.0f) return;
-    g_resolver_config.weights = *w;
+    if (!w || !weights_valid(w)) return;
+    pthread_mutex_lock(&g_profile_lock);
+    profile_store(&g_profiles[RESOLVER_PROFILE_DEFAULT], w);
+    pthread_mutex_unlock(&g_profile_lock);
 }
 
 void resolver_set_top_k(int k)
 {
-    if (k > 0) g_resolver_config.top_k = k;
+    if (k > 0) atomic_store_explicit(&g_top_k, k, memory_order_relaxed);
+}
+
+static int clamp_top_k(int k)
+{
+    int top_k = atomic_load_explicit(&g_top_k, memory_order_relaxed);
+    return k > top_k ? top_k : k;
+}
+
+/* --------------------------------------------------------------------------
+ * Pinned resolution
+ *
+ * Score the pinned snapshot in place and expand only the winners.
+ * -------------------------------------------------------------------------- */
+
+#define RESOLVER_HITS_STACK 64
+
+static int resolve_pinned(const routing_table_t *rt, const sad_t *query,
+                          const scoring_weights_t *weights,
+                          resolve_result_t *results, int k)
+{
+    /* Decode the query once, before touching the snapshot */
+    sad_query_t q;
+    sad_query_compile(query, &q);
+
+    sad_hit_t stack_hits[RESOLVER_HITS_STACK];
+    sad_hit_t *hits = stack_hits;
+    if (k > RESOLVER_HITS_STACK) {
+        hits = malloc((size_t)k * sizeof(*hits));
+        if (!hits) return -1;
+    }
+
+    int n = -1;
+    const routing_table_view_t *view = routing_table_pin(rt);
+    if (view) {
+        n = routing_table_view_lookup(view, &q, weights, hits, k);
+        for (int i = 0; i < n; i++) {
+            routing_table_view_read(view, hits[i].index, &results[i].entry);
+            results[i].score = hits[i].score;
+        }
+        routing_table_unpin(view);
+    }
+
+    if (hits != stack_hits) free(hits);
+    return n;
 }
 
 /* --------------------------------------------------------------------------
  * resolver_resolve
  *
  * Main resolve function:
- *   1. Take a snapshot of the routing table (lock-free read)
- *   2. Score each candidate entry against the query
+ *   1. Pin the current snapshot (lock-free read)
+ *   2. Score the candidates against the query under the default profile
  *   3. Return top-K results sorted by score descending
  *
  * Returns number of results, or -1 on error.
@@ -72,37 +210,158 @@ int resolver_resolve(const routing_table_t *rt,
                      const sad_t *query,
                      resolve_result_t *results,
                      int max_results)
+{
+    return resolver_resolve_profile(rt, query, RESOLVER_PROFILE_DEFAULT,
+                                    results, max_results);
+}
+
+/* --------------------------------------------------------------------------
+ * resolver_resolve_profile
+ *
+ * resolver_resolve with the weights of a registered profile.
+ *
+ * Returns number of results, or -1 on error.
+ * -------------------------------------------------------------------------- */
+
+int resolver_resolve_profile(const routing_table_t *rt,
+                             const sad_t *query,
+                             int profile,
+                             resolve_result_t *results,
+                             int max_results)
 {
     if (!rt || !query || !results)
         return -1;
 
-    int k = max_results;
-    if (k > g_resolver_config.top_k)
-        k = g_resolver_config.top_k;
+    scoring_weights_t w;
+    if (profile_load(profile, &w) != 0)
+        return -1;
+
+    int k = clamp_top_k(max_results);
     if (k <= 0)
         k = 1;
 
-    return routing_table_lookup(rt, query, results, k);
+    return resolve_pinned(rt, query, &w, results, k);
 }
 
 /* --------------------------------------------------------------------------
- * resolver_resolve_with_weights
+ * resolver_resolve_shards
+ *
+ * Front-end for sharded tables: the query goes to the one shard its
+ * partition selects, or fans out to all of them and the per-shard top-K
+ * lists are merged.
+ *
+ * Returns number of results, or -1 on error.
+ * -------------------------------------------------------------------------- */
+
+int resolver_resolve_shards(const routing_shards_t *rs, uint32_t key,
+                            const sad_t *query, int profile,
+                            resolve_result_t *results, int max_results)
+{
+    if (!rs || !query || !results)
+        return -1;
+
+    scoring_weights_t w;
+    if (profile_load(profile, &w) != 0)
+        return -1;
+
+    int k = clamp_top_k(max_results);
+    if (k <= 0)
+        k = 1;
+
+    return routing_shards_resolve(rs, key, query, &w, results, k);
+}
+
+/* --------------------------------------------------------------------------
+ * resolver_resolve_view
+ *
+ * Reference-returning variant of resolver_resolve for callers that pin
+ * the snapshot themselves: writes (row, score) hits into @view, so only
+ * the entry the caller finally picks is ever touched.
  *
- * Like resolver_resolve but with explicit weights for this query.
- * We snapshot, run sad_find_best directly with the given weights.
+ * Returns number of hits, or -1 on error.
  * -------------------------------------------------------------------------- */
 
-/* Forward declaration from sad_match.c */
-extern float sad_match_score(const sad_t *query,
-                             const route_entry_t *candidate,
-                             const scoring_weights_t *weights);
+int resolver_resolve_view(const routing_table_view_t *view,
+                          const sad_query_t *query,
+                          sad_hit_t *hits,
+                          int max_hits)
+{
+    if (!view || !query || !hits || max_hits <= 0)
+        return -1;
+
+    scoring_weights_t w;
+    profile_load(RESOLVER_PROFILE_DEFAULT, &w);
+    return routing_table_view_lookup(view, query, &w, hits, clamp_top_k(max_hits));
+}
 
-extern int sad_find_best(const sad_t *query,
-                         const route_entry_t *table,
-                         int table_size,
-                         const scoring_weights_t *weights,
-                         int top_k,
-                         resolve_result_t *results);
+/* --------------------------------------------------------------------------
+ * resolver_resolve_sad_view
+ *
+ * resolver_resolve_view for a query still in wire form: the constraints
+ * are compiled straight out of the validated bytes.
+ *
+ * Returns number of hits, or -1 on error.
+ * -------------------------------------------------------------------------- */
+
+int resolver_resolve_sad_view(const routing_table_view_t *view,
+                              const sad_view_t *query,
+                              sad_hit_t *hits,
+                              int max_hits)
+{
+    if (!query)
+        return -1;
+
+    sad_query_t q;
+    sad_query_compile_view(query, &q);
+    return resolver_resolve_view(view, &q, hits, max_hits);
+}
+
+/* --------------------------------------------------------------------------
+ * resolver_resolve_cached / resolver_resolve_cached_profile
+ *
+ * resolver_resolve_sad_view through a resolve cache owned by the calling
+ * thread.  A NULL cache resolves directly.  The profile's weights are
+ * part of the cache key.
+ *
+ * Returns number of hits, or -1 on error.
+ * -------------------------------------------------------------------------- */
+
+int resolver_resolve_cached_profile(resolve_cache_t *cache,
+                                    const routing_table_view_t *view,
+                                    const sad_view_t *query,
+                                    int profile,
+                                    sad_hit_t *hits,
+                                    int max_hits)
+{
+    if (!view || !query || !hits || max_hits <= 0)
+        return -1;
+
+    scoring_weights_t w;
+    if (profile_load(profile, &w) != 0)
+        return -1;
+
+    sad_query_t q;
+    sad_query_compile_view(query, &q);
+    return resolve_cache_lookup(cache, view, &q, &w, hits, clamp_top_k(max_hits));
+}
+
+int resolver_resolve_cached(resolve_cache_t *cache,
+                            const routing_table_view_t *view,
+                            const sad_view_t *query,
+                            sad_hit_t *hits,
+                            int max_hits)
+{
+    return resolver_resolve_cached_profile(cache, view, query,
+                                           RESOLVER_PROFILE_DEFAULT,
+                                           hits, max_hits);
+}
+
+/* --------------------------------------------------------------------------
+ * resolver_resolve_with_weights
+ *
+ * Like resolver_resolve but with explicit weights for this query and no
+ * top-K cap.  Scores the whole pinned snapshot, however large.
+ * -------------------------------------------------------------------------- */
 
 int resolver_resolve_with_weights(const routing_table_t *rt,
                                   const sad_t *query,
@@ -113,26 +372,10 @@ int resolver_resolve_with_weights(const routing_table_t *rt,
     if (!rt || !query || !results || max_results <= 0)
         return -1;
 
-    /* Get a snapshot of entries */
-    int snap_max = 4096;  /* reasonable upper bound for stack alloc */
-    uint32_t size = routing_table_size(rt);
-    if ((int)size < snap_max) snap_max = (int)size;
-    if (snap_max <= 0) return 0;
-
-    route_entry_t *entries = malloc((size_t)snap_max * sizeof(route_entry_t));
-    if (!entries) return -1;
-
-    int n = routing_table_snapshot(rt, entries, snap_max);
-    if (n <= 0) {
-        free(entries);
-        return 0;
+    scoring_weights_t w;
+    if (!weights) {
+        profile_load(RESOLVER_PROFILE_DEFAULT, &w);
+        weights = &w;
     }
-
-    int k = max_results;
-    int found = sad_find_best(query, entries, n,
-                              weights ? weights : &g_resolver_config.weights,
-                              k, results);
-
-    free(entries);
-    return found;
+    return resolve_pinned(rt, query, weights, results, max_results);
 }
@@ -0,0 +1,649 @@
+/*
+ * routing_shards.c - Routing tables partitioned by tenant, arch or region
+ *
+ * Each shard is a plain routing_table_t.  Placement of one node across
+ * shards is serialised by a striped mutex on its node_id, taken before
+ * any shard's write lock and never while one is held, so writers to
+ * different shards meet only when they touch the same node.  Where a
+ * node lives is found by pinning each shard and probing its row map, so
+ * no shard is locked just to learn that it does not hold the node.
+ *
+ * Fan-out queries pin every shard on the calling thread; the workers only
+ * score the pinned views, each taking the next unscored shard, and the
+ * caller merges the per-shard top-K lists once they are all done.
+ */
+
+#include "strandroute/routing_shards.h"
+#include "strandroute/sad.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RS_PLACE_STRIPES  64      /* bits of a uint64_t mask */
+#define RS_STACK_HITS     256
+
+typedef struct {
+    const routing_table_view_t *const *views;
+    const sad_query_t       *query;
+    const scoring_weights_t *weights;
+    sad_hit_t               *hits;      /* k per shard */
+    int                     *counts;
+    int                      k;
+    uint32_t                 n;
+    _Atomic uint32_t         next;      /* next shard to score */
+} rs_job_t;
+
+struct routing_shards {
+    rt_shard_by_t    by;
+    uint32_t         n;
+    routing_table_t *shard[RT_SHARDS_MAX];
+    pthread_mutex_t  place[RS_PLACE_STRIPES];
+
+    /* Fan-out workers */
+    pthread_t       *workers;
+    int              num_workers;
+    pthread_mutex_t  fan_busy;          /* held by the query using them */
+    pthread_mutex_t  job_lock;
+    pthread_cond_t   job_cv;            /* new job, or stopping */
+    pthread_cond_t   idle_cv;           /* a worker left its job */
+    uint64_t         job_gen;
+    rs_job_t        *job;
+    int              job_active;
+    bool             stopping;
+};
+
+/* Node IDs are often structured (prefix + counter): mix both halves */
+static inline uint32_t rs_stripe(const uint8_t node_id[16])
+{
+    uint64_t k[2];
+    memcpy(k, node_id, sizeof(k));
+    uint64_t h = k[0] ^ (k[1] * 0x9E3779B97F4A7C15ull);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return (uint32_t)h % RS_PLACE_STRIPES;
+}
+
+/* Whether shard @t's current snapshot holds @node_id */
+static bool rs_holds(const routing_shards_t *rs, uint32_t t,
+                     const uint8_t node_id[16])
+{
+    const routing_table_view_t *v = routing_table_pin(rs->shard[t]);
+    bool found = routing_table_view_find(v, node_id) >= 0;
+    routing_table_unpin(v);
+    return found;
+}
+
+/* First shard holding @node_id, or -1 */
+static int rs_locate(const routing_shards_t *rs, const uint8_t node_id[16])
+{
+    for (uint32_t t = 0; t < rs->n; t++)
+        if (rs_holds(rs, t, node_id))
+            return (int)t;
+    return -1;
+}
+
+/* --------------------------------------------------------------------------
+ * Fan-out workers
+ * -------------------------------------------------------------------------- */
+
+static void rs_job_run(rs_job_t *job)
+{
+    uint32_t s;
+    while ((s = atomic_fetch_add_explicit(&job->next, 1,
+                                          memory_order_relaxed)) < job->n) {
+        int c = 0;
+        if (routing_table_view_count(job->views[s]) > 0)
+            c = routing_table_view_lookup(job->views[s], job->query,
+                                          job->weights,
+                                          job->hits + (size_t)s * job->k,
+                                          job->k);
+        job->counts[s] = c;
+    }
+}
+
+static void *rs_worker(void *arg)
+{
+    routing_shards_t *rs = arg;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&rs->job_lock);
+    for (;;) {
+        while (!rs->stopping && rs->job_gen == seen)
+            pthread_cond_wait(&rs->job_cv, &rs->job_lock);
+        if (rs->stopping)
+            break;
+        seen = rs->job_gen;
+        rs_job_t *job = rs->job;
+        if (!job)
+            continue;       /* woke after the caller finished it */
+
+        rs->job_active++;
+        pthread_mutex_unlock(&rs->job_lock);
+        rs_job_run(job);
+        pthread_mutex_lock(&rs->job_lock);
+        if (--rs->job_active == 0)
+            pthread_cond_signal(&rs->idle_cv);
+    }
+    pthread_mutex_unlock(&rs->job_lock);
+    return NULL;
+}
+
+/* Score every shard of @job; in parallel unless another query has the
+ * workers, in which case this one does not wait for them */
+static void rs_fan_out(routing_shards_t *rs, rs_job_t *job)
+{
+    if (rs->num_workers == 0 || pthread_mutex_trylock(&rs->fan_busy) != 0) {
+        rs_job_run(job);
+        return;
+    }
+
+    pthread_mutex_lock(&rs->job_lock);
+    rs->job = job;
+    rs->job_gen++;
+    pthread_cond_broadcast(&rs->job_cv);
+    pthread_mutex_unlock(&rs->job_lock);
+
+    rs_job_run(job);
+
+    /* Every shard was taken; wait for those still being scored */
+    pthread_mutex_lock(&rs->job_lock);
+    rs->job = NULL;
+    while (rs->job_active > 0)
+        pthread_cond_wait(&rs->idle_cv, &rs->job_lock);
+    pthread_mutex_unlock(&rs->job_lock);
+    pthread_mutex_unlock(&rs->fan_busy);
+}
+
+/* --------------------------------------------------------------------------
+ * Lifecycle
+ * -------------------------------------------------------------------------- */
+
+static void rs_stop_workers(routing_shards_t *rs)
+{
+    pthread_mutex_lock(&rs->job_lock);
+    rs->stopping = true;
+    pthread_cond_broadcast(&rs->job_cv);
+    pthread_mutex_unlock(&rs->job_lock);
+    for (int i = 0; i < rs->num_workers; i++)
+        pthread_join(rs->workers[i], NULL);
+    rs->num_workers = 0;
+}
+
+routing_shards_t *routing_shards_create(const routing_shards_config_t *cfg)
+{
+    if (!cfg || cfg->num_shards == 0 || cfg->num_shards > RT_SHARDS_MAX ||
+        cfg->by < RT_SHARD_BY_TENANT || cfg->by > RT_SHARD_BY_REGION ||
+        cfg->fanout_threads < 0)
+        return NULL;
+
+    routing_shards_t *rs = calloc(1, sizeof(*rs));
+    if (!rs) return NULL;
+
+    rs->by = cfg->by;
+    rs->n  = cfg->num_shards;
+    for (int i = 0; i < RS_PLACE_STRIPES; i++)
+        pthread_mutex_init(&rs->place[i], NULL);
+    pthread_mutex_init(&rs->fan_busy, NULL);
+    pthread_mutex_init(&rs->job_lock, NULL);
+    pthread_cond_init(&rs->job_cv, NULL);
+    pthread_cond_init(&rs->idle_cv, NULL);
+
+    for (uint32_t i = 0; i < rs->n; i++) {
+        rs->shard[i] = routing_table_create(cfg->initial_capacity);
+        if (!rs->shard[i]) {
+            routing_shards_destroy(rs);
+            return NULL;
+        }
+    }
+
+    /* The caller scores too, so more workers than shards - 1 never help */
+    int workers = cfg->fanout_threads;
+    if ((uint32_t)workers > rs->n - 1)
+        workers = (int)rs->n - 1;
+    if (workers > 0) {
+        rs->workers = calloc((size_t)workers, sizeof(pthread_t));
+        if (!rs->workers) {
+            routing_shards_destroy(rs);
+            return NULL;
+        }
+        for (; rs->num_workers < workers; rs->num_workers++) {
+            if (pthread_create(&rs->workers[rs->num_workers], NULL,
+                               rs_worker, rs) != 0) {
+                routing_shards_destroy(rs);
+                return NULL;
+            }
+        }
+    }
+    return rs;
+}
+
+void routing_shards_destroy(routing_shards_t *rs)
+{
+    if (!rs) return;
+
+    rs_stop_workers(rs);
+    free(rs->workers);
+    for (uint32_t i = 0; i < rs->n; i++)
+        routing_table_destroy(rs->shard[i]);
+
+    for (int i = 0; i < RS_PLACE_STRIPES; i++)
+        pthread_mutex_destroy(&rs->place[i]);
+    pthread_mutex_destroy(&rs->fan_busy);
+    pthread_mutex_destroy(&rs->job_lock);
+    pthread_cond_destroy(&rs->job_cv);
+    pthread_cond_destroy(&rs->idle_cv);
+    free(rs);
+}
+
+uint32_t routing_shards_count(const routing_shards_t *rs)
+{
+    return rs ? rs->n : 0;
+}
+
+routing_table_t *routing_shards_table(routing_shards_t *rs, uint32_t shard)
+{
+    if (!rs || shard >= rs->n) return NULL;
+    return rs->shard[shard];
+}
+
+/* --------------------------------------------------------------------------
+ * Placement
+ * -------------------------------------------------------------------------- */
+
+int routing_shards_shard_of(const routing_shards_t *rs, uint32_t key,
+                            const route_entry_t *entry)
+{
+    if (!rs || !entry) return -1;
+
+    switch (rs->by) {
+    case RT_SHARD_BY_TENANT:
+        /* Never folded: tenants sharing a shard would see each other */
+        if (key >= rs->n)
+            return -1;
+        return (int)key;
+    case RT_SHARD_BY_MODEL_ARCH:
+        return (int)(sad_get_uint32(&entry->capabilities,
+                                    SAD_FIELD_MODEL_ARCH) % rs->n);
+    case RT_SHARD_BY_REGION:
+        return (int)(entry->region_code % rs->n);
+    }
+    return -1;
+}
+
+int routing_shards_query_shard(const routing_shards_t *rs, uint32_t key,
+                               const sad_query_t *query)
+{
+    if (!rs || !query) return -1;
+    if (rs->by == RT_SHARD_BY_TENANT && key != RT_SHARD_KEY_ANY && key >= rs->n)
+        return -1;
+    if (rs->n == 1)
+        return 0;
+
+    if (rs->by == RT_SHARD_BY_MODEL_ARCH)
+        return (query->present & SAD_Q_MODEL_ARCH)
+               ? (int)(query->model_arch % rs->n) : -1;
+    return key == RT_SHARD_KEY_ANY ? -1 : (int)(key % rs->n);
+}
+
+/* --------------------------------------------------------------------------
+ * Writes
+ * -------------------------------------------------------------------------- */
+
+int routing_shards_insert(routing_shards_t *rs, uint32_t key,
+                          const route_entry_t *entry)
+{
+    if (!rs || !entry) return -1;
+    int s = routing_shards_shard_of(rs, key, entry);
+    if (s < 0) return -1;
+
+    pthread_mutex_t *place = &rs->place[rs_stripe(entry->node_id)];
+    pthread_mutex_lock(place);
+
+    /* New home first, so lookups never miss a node that is moving */
+    int rc = routing_table_insert(rs->shard[s], entry);
+    if (rc == 0) {
+        for (uint32_t t = 0; t < rs->n; t++)
+            if (t != (uint32_t)s && rs_holds(rs, t, entry->node_id))
+                routing_table_remove(rs->shard[t], entry->node_id);
+    }
+
+    pthread_mutex_unlock(place);
+    return rc;
+}
+
+int routing_shards_remove(routing_shards_t *rs, const uint8_t node_id[16])
+{
+    if (!rs || !node_id) return -1;
+
+    pthread_mutex_t *place = &rs->place[rs_stripe(node_id)];
+    pthread_mutex_lock(place);
+    int rc = -1;
+    for (uint32_t t = 0; t < rs->n; t++)
+        if (rs_holds(rs, t, node_id) &&
+            routing_table_remove(rs->shard[t], node_id) == 0)
+            rc = 0;
+    pthread_mutex_unlock(place);
+    return rc;
+}
+
+int routing_shards_update_metrics(routing_shards_t *rs,
+                                  const uint8_t node_id[16],
+                                  uint32_t latency_us,
+                                  float load_factor)
+{
+    if (!rs || !node_id) return -1;
+    int t = rs_locate(rs, node_id);
+    if (t < 0) return -1;
+    return routing_table_update_metrics(rs->shard[t], node_id,
+                                        latency_us, load_factor);
+}
+
+uint32_t routing_shards_size(const routing_shards_t *rs)
+{
+    if (!rs) return 0;
+    uint32_t total = 0;
+    for (uint32_t t = 0; t < rs->n; t++)
+        total += routing_table_size(rs->shard[t]);
+    return total;
+}
+
+int routing_shards_gc(routing_shards_t *rs, uint64_t now_ns)
+{
+    if (!rs) return -1;
+    int removed = 0, rc = 0;
+    for (uint32_t t = 0; t < rs->n; t++) {
+        int r = routing_table_gc(rs->shard[t], now_ns);
+        if (r < 0)
+            rc = -1;
+        else
+            removed += r;
+    }
+    return rc < 0 ? -1 : removed;
+}
+
+int routing_shards_expire(routing_shards_t *rs, uint64_t now_ns)
+{
+    if (!rs) return -1;
+    int removed = 0, rc = 0;
+    for (uint32_t t = 0; t < rs->n; t++) {
+        int r = routing_table_expire(rs->shard[t], now_ns);
+        if (r < 0)
+            rc = -1;
+        else
+            removed += r;
+    }
+    return rc < 0 ? -1 : removed;
+}
+
+/* --------------------------------------------------------------------------
+ * routing_shards_resolve
+ * -------------------------------------------------------------------------- */
+
+static int rs_resolve_one(const routing_shards_t *rs, uint32_t s,
+                          const sad_query_t *q, const scoring_weights_t *w,
+                          sad_hit_t *hits, resolve_result_t *results, int k)
+{
+    const routing_table_view_t *v = routing_table_pin(rs->shard[s]);
+    if (!v) return -1;
+
+    int n = 0;
+    if (routing_table_view_count(v) > 0)
+        n = routing_table_view_lookup(v, q, w, hits, k);
+    for (int i = 0; i < n; i++) {
+        routing_table_view_read(v, hits[i].index, &results[i].entry);
+        results[i].score = hits[i].score;
+    }
+    routing_table_unpin(v);
+    return n;
+}
+
+static int rs_resolve_all(routing_shards_t *rs, const sad_query_t *q,
+                          const scoring_weights_t *w, sad_hit_t *hits,
+                          resolve_result_t *results, int k)
+{
+    const routing_table_view_t *views[RT_SHARDS_MAX];
+    int counts[RT_SHARDS_MAX];
+    int pos[RT_SHARDS_MAX] = { 0 };
+
+    for (uint32_t t = 0; t < rs->n; t++) {
+        views[t] = routing_table_pin(rs->shard[t]);
+        if (!views[t]) {
+            while (t-- > 0)
+                routing_table_unpin(views[t]);
+            return -1;
+        }
+    }
+
+    rs_job_t job = {
+        .views = views, .query = q, .weights = w,
+        .hits = hits, .counts = counts, .k = k, .n = rs->n,
+    };
+    atomic_init(&job.next, 0);
+    rs_fan_out(rs, &job);
+
+    /* k-way merge of the per-shard lists; ties go to the lower shard */
+    int out = 0;
+    for (; out < k; out++) {
+        int best = -1;
+        float best_score = 0.0f;
+        for (uint32_t t = 0; t < rs->n; t++) {
+            if (pos[t] >= counts[t])
+                continue;
+            float sc = hits[(size_t)t * k + pos[t]].score;
+            if (best < 0 || sc > best_score) {
+                best = (int)t;
+                best_score = sc;
+            }
+        }
+        if (best < 0)
+            break;
+        const sad_hit_t *h = &hits[(size_t)best * k + pos[best]++];
+        routing_table_view_read(views[best], h->index, &results[out].entry);
+        results[out].score = h->score;
+    }
+
+    for (uint32_t t = 0; t < rs->n; t++)
+        routing_table_unpin(views[t]);
+    return out;
+}
+
+int routing_shards_resolve(const routing_shards_t *rs, uint32_t key,
+                           const sad_t *query,
+                           const scoring_weights_t *weights,
+                           resolve_result_t *results,
+                           int max_results)
+{
+    if (!rs || !query || !results || max_results <= 0)
+        return -1;
+    if (rs->by == RT_SHARD_BY_TENANT && key != RT_SHARD_KEY_ANY && key >= rs->n)
+        return -1;
+
+    sad_query_t q;
+    sad_query_compile(query, &q);
+    int s = routing_shards_query_shard(rs, key, &q);
+
+    size_t need = (size_t)max_results * (s < 0 ? rs->n : 1);
+    sad_hit_t stack_hits[RS_STACK_HITS];
+    sad_hit_t *hits = stack_hits;
+    if (need > RS_STACK_HITS) {
+        hits = malloc(need * sizeof(*hits));
+        if (!hits) return -1;
+    }
+
+    int n = s >= 0
+        ? rs_resolve_one(rs, (uint32_t)s, &q, weights, hits, results, max_results)
+        : rs_resolve_all((routing_shards_t *)rs, &q, weights, hits,
+                         results, max_results);
+
+    if (hits != stack_hits) free(hits);
+    return n;
+}
+
+/* --------------------------------------------------------------------------
+ * Transactions
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    route_entry_t entry;        /* only node_id for a removal */
+    int           shard;        /* -1: removal */
+    uint32_t      seq;
+} rs_op_t;
+
+struct routing_shards_txn {
+    routing_shards_t *rs;
+    rs_op_t          *ops;
+    uint32_t          count;
+    uint32_t          cap;
+};
+
+routing_shards_txn_t *routing_shards_txn_begin(routing_shards_t *rs)
+{
+    if (!rs) return NULL;
+    routing_shards_txn_t *txn = calloc(1, sizeof(*txn));
+    if (txn)
+        txn->rs = rs;
+    return txn;
+}
+
+static rs_op_t *rs_txn_push(routing_shards_txn_t *txn)
+{
+    if (txn->count == txn->cap) {
+        uint32_t cap = txn->cap ? txn->cap * 2 : 16;
+        rs_op_t *ops = realloc(txn->ops, (size_t)cap * sizeof(*ops));
+        if (!ops) return NULL;
+        txn->ops = ops;
+        txn->cap = cap;
+    }
+    rs_op_t *op = &txn->ops[txn->count];
+    op->seq = txn->count++;
+    return op;
+}
+
+int routing_shards_txn_insert(routing_shards_txn_t *txn, uint32_t key,
+                              const route_entry_t *entry)
+{
+    if (!txn || !entry) return -1;
+    int s = routing_shards_shard_of(txn->rs, key, entry);
+    if (s < 0) return -1;
+
+    rs_op_t *op = rs_txn_push(txn);
+    if (!op) return -1;
+    op->entry = *entry;
+    op->shard = s;
+    return 0;
+}
+
+int routing_shards_txn_remove(routing_shards_txn_t *txn,
+                              const uint8_t node_id[16])
+{
+    if (!txn || !node_id) return -1;
+
+    rs_op_t *op = rs_txn_push(txn);
+    if (!op) return -1;
+    memcpy(op->entry.node_id, node_id, sizeof(op->entry.node_id));
+    op->shard = -1;
+    return 0;
+}
+
+uint32_t routing_shards_txn_staged(const routing_shards_txn_t *txn)
+{
+    return txn ? txn->count : 0;
+}
+
+static int rs_op_cmp(const void *a, const void *b)
+{
+    const rs_op_t *x = a, *y = b;
+    int c = memcmp(x->entry.node_id, y->entry.node_id,
+                   sizeof(x->entry.node_id));
+    if (c != 0) return c;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+/* Publish shard @t's part of @ops: inserts homed there, and removals of
+ * nodes it holds that were removed or now live elsewhere */
+static int rs_txn_apply_shard(routing_shards_t *rs, uint32_t t,
+                              const rs_op_t *ops, uint32_t count)
+{
+    routing_table_txn_t *rt_txn = NULL;
+    int rc = 0;
+
+    const routing_table_view_t *v = routing_table_pin(rs->shard[t]);
+    if (!v) return -1;
+    bool empty = routing_table_view_count(v) == 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const rs_op_t *op = &ops[i];
+        bool insert = op->shard == (int)t;
+        if (!insert && (empty || routing_table_view_find(v, op->entry.node_id) < 0))
+            continue;
+
+        if (!rt_txn && !(rt_txn = routing_table_txn_begin(rs->shard[t]))) {
+            rc = -1;
+            break;
+        }
+        if (insert) {
+            if (routing_table_txn_insert(rt_txn, &op->entry) != 0)
+                rc = -1;
+        } else {
+            routing_table_txn_remove(rt_txn, op->entry.node_id);
+        }
+    }
+    routing_table_unpin(v);
+
+    if (rt_txn && routing_table_txn_commit(rt_txn) != 0)
+        rc = -1;
+    return rc;
+}
+
+int routing_shards_txn_commit(routing_shards_txn_t *txn)
+{
+    if (!txn) return -1;
+    routing_shards_t *rs = txn->rs;
+    int rc = 0;
+
+    if (txn->count > 0) {
+        /* Last operation per node wins */
+        qsort(txn->ops, txn->count, sizeof(*txn->ops), rs_op_cmp);
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < txn->count; i++) {
+            if (i + 1 < txn->count &&
+                memcmp(txn->ops[i].entry.node_id, txn->ops[i + 1].entry.node_id,
+                       sizeof(txn->ops[i].entry.node_id)) == 0)
+                continue;
+            if (n != i)
+                txn->ops[n] = txn->ops[i];
+            n++;
+        }
+
+        /* Stripes in ascending order, so commits never deadlock */
+        uint64_t stripes = 0;
+        for (uint32_t i = 0; i < n; i++)
+            stripes |= 1ull << rs_stripe(txn->ops[i].entry.node_id);
+        for (int b = 0; b < RS_PLACE_STRIPES; b++)
+            if (stripes & (1ull << b))
+                pthread_mutex_lock(&rs->place[b]);
+
+        for (uint32_t t = 0; t < rs->n; t++)
+            if (rs_txn_apply_shard(rs, t, txn->ops, n) != 0)
+                rc = -1;
+
+        for (int b = RS_PLACE_STRIPES - 1; b >= 0; b--)
+            if (stripes & (1ull << b))
+                pthread_mutex_unlock(&rs->place[b]);
+    }
+
+    free(txn->ops);
+    free(txn);
+    return rc;
+}
+
+void routing_shards_txn_abort(routing_shards_txn_t *txn)
+{
+    if (!txn) return;
+    free(txn->ops);
+    free(txn);
+}
@@ -1,62 +1,528 @@
 /*
  * routing_table.c - RCU-based lock-free capability routing table
  *
- * Two arrays + atomic pointer swap.  Readers dereference the current
- * pointer (lock-free).  Writers acquire a mutex, copy the live array,
- * mutate the copy, atomically swap, then wait for readers to drain
- * using a simple epoch counter.
+ * Copy-on-write snapshots + atomic pointer swap.  Readers dereference the
+ * current pointer (lock-free) inside an epoch read section.  Writers
+ * acquire a mutex, copy the live array, mutate the copy, atomically swap,
+ * and retire the old snapshot to the table's epoch domain, which frees it
+ * once no reader can still hold it (see epoch.h).  Neither side waits on
+ * the other and the read path writes no shared cache line.
  *
- * This avoids a dependency on liburcu for portability; the technique
- * is equivalent to a double-buffered RCU for moderate write rates.
+ * This avoids a dependency on liburcu for portability.
+ *
+ * Each snapshot also carries parallel column arrays of the fields the
+ * matcher scores on, so a lookup scans a few bytes per candidate, plus
+ * secondary indexes (capability bitsets, model-arch postings, context and
+ * trust tiers) rebuilt as part of each publish.
+ *
+ * Rows are stored compactly: a 40-byte hot record per entry plus the
+ * cost / trust / region columns and metrics, with the capabilities kept
+ * as encoded SAD bytes interned once per distinct descriptor and shared
+ * by every row (and snapshot) that advertises them.  A 100k-entry
+ * snapshot is a few MB rather than a route_entry_t (1 KB+ each, mostly
+ * inline sad_t) per row, and cloning copies that.  route_entry_t is
+ * only materialised on the way out: lookup results, snapshots, views.
+ *
+ * Live metrics (latency, load) are the exception to copy-on-write: they
+ * sit in per-row atomics beside the immutable arrays and are updated in
+ * place, so the once-every-few-hundred-ms metric reports from every
+ * endpoint neither clone the table nor wait for readers.  A writer-side
+ * node_id -> row hash keeps finding the row O(1).
+ *
+ * TTLs are enforced by a writer-side timing wheel with one timer per
+ * node_id inserted with a TTL, so routing_table_expire() only looks at the
+ * entries that are due rather than scanning the table.
+ *
+ * A snapshot can be checkpointed to a flat file and mapped back in at
+ * startup (routing_table_checkpoint_save / _load) for warm restarts.
  */
 
+#define _POSIX_C_SOURCE 200809L   /* fsync, mmap, clock_gettime */
+
 #include "strandroute/routing_table.h"
+#include "strandroute/epoch.h"
+#include "strandroute/numa.h"
 #include "strandroute/sad.h"
+#include "strandroute/sad_match.h"
+#include "strandroute/timer_wheel.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdatomic.h>
 #include <pthread.h>
-#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 /* --------------------------------------------------------------------------
  * Internal snapshot - immutable array read by concurrent readers
  * -------------------------------------------------------------------------- */
 
+/* Scored fields in structure-of-arrays form, row-aligned with rows[]; the
+ * cost, trust and region columns are also the rows' only copy */
+typedef struct {
+    uint32_t *model_arch;
+    uint32_t *capability;
+    uint32_t *context_window;
+    uint32_t *cost_milli;
+    uint8_t  *trust_level;
+    uint16_t *region_code;
+    uint8_t  *has;              /* SAD_COL_HAS_* bits */
+} rt_columns_t;
+
+/*
+ * Mutable per-row metrics, row-aligned with rows[].  Stored in place by
+ * routing_table_update_metrics (under write_lock) while readers score
+ * against them; latency_us doubles as the matcher's latency column.
+ */
+typedef struct {
+    _Atomic uint32_t *latency_us;
+    _Atomic float    *load_factor;
+} rt_metrics_t;
+
+/* Secondary indexes, see sad_index_t.  Built once per publish. */
+typedef struct {
+    bool      valid;            /* false: build failed, lookups full-scan */
+    uint64_t *cap_bits;
+    uint32_t  words;
+    uint32_t *arch_key;
+    uint32_t *arch_row;
+    uint32_t  num_arch;
+    uint32_t *ctx_key;
+    uint32_t *ctx_row;
+    uint32_t  num_ctx;
+    uint8_t  *trust_key;
+    uint32_t *trust_row;
+    uint32_t  num_trust;
+} rt_index_t;
+
+/* node_id -> row, open addressing with linear probing.  Built at publish
+ * alongside the secondary indexes. */
+typedef struct {
+    uint32_t *slots;            /* row + 1, 0 = empty */
+    uint32_t  mask;             /* capacity - 1, capacity a power of two */
+} rt_rowmap_t;
+
+/*
+ * An interned capability descriptor: encoded SAD bytes shared by every
+ * row advertising exactly these bytes.  See "Interned descriptors".
+ */
+typedef struct rt_caps {
+    struct rt_caps *next;       /* hash chain; free list once unused */
+    uint32_t        refs;       /* rows holding it, over all snapshots */
+    uint32_t        hash;
+    uint16_t        len;
+    uint16_t        cls;        /* block size in RT_CAPS_GRAIN units */
+    uint8_t         bytes[];
+} rt_caps_t;
+
+#define RT_CAPS_GRAIN    16u
+#define RT_CAPS_CHUNK    (64u * 1024u)
+#define RT_CAPS_CLASSES  ((sizeof(rt_caps_t) + SAD_MAX_SIZE) / RT_CAPS_GRAIN + 2)
+
+typedef struct {
+    pthread_mutex_t lock;
+    rt_caps_t     **buckets;    /* chains, a power-of-two count */
+    uint32_t        mask;
+    uint32_t        live;       /* distinct descriptors */
+    rt_caps_t      *free_list[RT_CAPS_CLASSES];
+    uint8_t       **chunks;
+    uint32_t        num_chunks;
+    uint32_t        cap_chunks;
+    uint32_t        chunk_used; /* bytes carved from the last chunk */
+} rt_caps_pool_t;
+
+/* The hot per-row record; everything else lives in the columns */
+typedef struct {
+    uint8_t    node_id[16];
+    uint64_t   last_updated;
+    uint64_t   ttl_ns;
+    rt_caps_t *caps;            /* one reference per row */
+} rt_row_t;
+
 typedef struct rt_snapshot {
-    route_entry_t *entries;
+    rt_row_t      *rows;
+    rt_caps_pool_t *pool;       /* owning table's descriptors */
+    rt_columns_t   cols;
+    rt_metrics_t   metrics;
+    rt_index_t     index;
+    rt_rowmap_t    rowmap;
     uint32_t       count;
     uint32_t       capacity;
-    _Atomic uint32_t readers;   /* active reader count */
+    epoch_domain_t *epoch;      /* owning table's domain, set at publish */
+    uint64_t       generation;  /* set at publish, increasing per table */
+    _Atomic uint64_t metrics_version;  /* bumped by each in-place metric store */
+    struct rt_snapshot **replica;      /* per NUMA node, see "Replicas" */
+    uint32_t       num_replicas;
+    void          *arena;       /* a replica's arrays, one node-local mapping */
+    size_t         arena_len;
 } rt_snapshot_t;
 
+#define RT_LOOKUP_STACK 64              /* hits kept on the stack */
+#define RT_MAX_REPLICAS 64
+
+/*
+ * TTL timers, under write_lock.  A record per node_id holds its wheel
+ * timer (whose data is the record index).  Timers are not told about
+ * removals or refreshes: when one fires, the row decides whether it is
+ * removed, re-armed at its current deadline or, if gone, forgotten.
+ */
+#define RT_TTL_TICK_NS 1000000ull       /* wheel resolution: 1 ms */
+
+typedef struct {
+    uint8_t  node_id[16];
+    uint32_t timer;             /* TIMER_WHEEL_NONE = free */
+    uint32_t next_free;
+} rt_ttl_rec_t;
+
+typedef struct {
+    timer_wheel_t *wheel;       /* NULL until the first entry with a TTL */
+    rt_ttl_rec_t  *recs;
+    uint32_t       num_recs;
+    uint32_t       cap_recs;
+    uint32_t       free_rec;    /* record + 1, 0 = none */
+    uint32_t      *slots;       /* node_id -> record + 1, linear probing */
+    uint32_t       mask;
+    bool           lossy;       /* a timer could not be armed */
+} rt_expiry_t;
+
 struct routing_table {
     _Atomic(rt_snapshot_t *) current;   /* readers load this atomically */
-    rt_snapshot_t           *standby;   /* writers prepare updates here */
+    epoch_domain_t          *epoch;     /* reclaims replaced snapshots */
     pthread_mutex_t          write_lock;
     scoring_weights_t        weights;
+    uint64_t                 generation; /* of current, under write_lock */
+    rt_expiry_t              expiry;
+    rt_caps_pool_t           caps;
+    uint32_t                 replicas;  /* per publish, under write_lock */
 };
 
+/* --------------------------------------------------------------------------
+ * Interned descriptors
+ *
+ * Blocks are carved from fixed arena chunks and never move, so readers of
+ * any live snapshot decode through a row's pointer without locking.  Each
+ * row of each snapshot (published, retired or working) holds one
+ * reference; when the last is dropped the block goes back to its size
+ * class free list.  For a retired snapshot that happens once its grace
+ * period is over, so no reader can still reach the block.  The pool lock
+ * covers the hash chains, counts and free lists: retired snapshots are
+ * freed by epoch reclamation, which need not run under write_lock.
+ * -------------------------------------------------------------------------- */
+
+static uint32_t caps_hash(const uint8_t *p, uint16_t len)
+{
+    uint32_t h = 2166136261u;           /* FNV-1a */
+    for (uint16_t i = 0; i < len; i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+static int caps_pool_init(rt_caps_pool_t *p)
+{
+    memset(p, 0, sizeof(*p));
+    return pthread_mutex_init(&p->lock, NULL) == 0 ? 0 : -1;
+}
+
+static void caps_pool_destroy(rt_caps_pool_t *p)
+{
+    for (uint32_t i = 0; i < p->num_chunks; i++)
+        free(p->chunks[i]);
+    free(p->chunks);
+    free(p->buckets);
+    pthread_mutex_destroy(&p->lock);
+}
+
+/* A block of size class @cls, reused or carved from the arena */
+static rt_caps_t *caps_block(rt_caps_pool_t *p, uint16_t cls)
+{
+    rt_caps_t *c = p->free_list[cls];
+    if (c) {
+        p->free_list[cls] = c->next;
+        return c;
+    }
+
+    uint32_t size = (uint32_t)cls * RT_CAPS_GRAIN;
+    if (p->num_chunks == 0 || p->chunk_used + size > RT_CAPS_CHUNK) {
+        if (p->num_chunks == p->cap_chunks) {
+            uint32_t cap = p->cap_chunks ? p->cap_chunks * 2 : 8;
+            uint8_t **chunks = realloc(p->chunks, cap * sizeof(*chunks));
+            if (!chunks) return NULL;
+            p->chunks     = chunks;
+            p->cap_chunks = cap;
+        }
+        uint8_t *chunk = malloc(RT_CAPS_CHUNK);
+        if (!chunk) return NULL;
+        p->chunks[p->num_chunks++] = chunk;
+        p->chunk_used = 0;
+    }
+    c = (rt_caps_t *)(p->chunks[p->num_chunks - 1] + p->chunk_used);
+    p->chunk_used += size;
+    return c;
+}
+
+static int caps_rehash(rt_caps_pool_t *p)
+{
+    uint32_t cap = p->buckets ? (p->mask + 1) * 2 : 64;
+    rt_caps_t **b = calloc(cap, sizeof(*b));
+    if (!b) return -1;
+    for (uint32_t i = 0; p->buckets && i <= p->mask; i++) {
+        for (rt_caps_t *c = p->buckets[i], *next; c; c = next) {
+            next = c->next;
+            c->next = b[c->hash & (cap - 1)];
+            b[c->hash & (cap - 1)] = c;
+        }
+    }
+    free(p->buckets);
+    p->buckets = b;
+    p->mask    = cap - 1;
+    return 0;
+}
+
+/* Reference to the descriptor holding @bytes, interned on first use.
+ * NULL on allocation failure. */
+static rt_caps_t *caps_intern(rt_caps_pool_t *p, const uint8_t *bytes,
+                              uint16_t len)
+{
+    uint32_t h = caps_hash(bytes, len);
+    rt_caps_t *c = NULL;
+
+    pthread_mutex_lock(&p->lock);
+    if (p->buckets) {
+        for (c = p->buckets[h & p->mask]; c; c = c->next) {
+            if (c->hash == h && c->len == len && memcmp(c->bytes, bytes, len) == 0)
+                break;
+        }
+    }
+    if (!c && ((p->buckets && p->live <= p->mask) || caps_rehash(p) == 0)) {
+        uint16_t cls = (uint16_t)((sizeof(rt_caps_t) + len + RT_CAPS_GRAIN - 1) /
+                                  RT_CAPS_GRAIN);
+        c = caps_block(p, cls);
+        if (c) {
+            c->refs = 0;
+            c->hash = h;
+            c->len  = len;
+            c->cls  = cls;
+            memcpy(c->bytes, bytes, len);
+            c->next = p->buckets[h & p->mask];
+            p->buckets[h & p->mask] = c;
+            p->live++;
+        }
+    }
+    if (c)
+        c->refs++;
+    pthread_mutex_unlock(&p->lock);
+    return c;
+}
+
+/* Intern the encoding of @sad; NULL if it does not encode */
+static rt_caps_t *caps_intern_sad(rt_caps_pool_t *p, const sad_t *sad)
+{
+    uint8_t buf[SAD_MAX_SIZE];
+    int n = sad_encode(sad, buf, sizeof(buf));
+    if (n < 0) return NULL;
+    return caps_intern(p, buf, (uint16_t)n);
+}
+
+static void caps_unref_locked(rt_caps_pool_t *p, rt_caps_t *c)
+{
+    if (--c->refs != 0)
+        return;
+    rt_caps_t **pp = &p->buckets[c->hash & p->mask];
+    while (*pp != c)
+        pp = &(*pp)->next;
+    *pp = c->next;
+    c->next = p->free_list[c->cls];
+    p->free_list[c->cls] = c;
+    p->live--;
+}
+
+static void caps_ref(rt_caps_pool_t *p, rt_caps_t *c)
+{
+    pthread_mutex_lock(&p->lock);
+    c->refs++;
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void caps_unref(rt_caps_pool_t *p, rt_caps_t *c)
+{
+    pthread_mutex_lock(&p->lock);
+    caps_unref_locked(p, c);
+    pthread_mutex_unlock(&p->lock);
+}
+
+/* Take (or drop) one reference for each of @n rows */
+static void caps_ref_rows(rt_caps_pool_t *p, const rt_row_t *rows, uint32_t n)
+{
+    pthread_mutex_lock(&p->lock);
+    for (uint32_t i = 0; i < n; i++)
+        rows[i].caps->refs++;
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void caps_unref_rows(rt_caps_pool_t *p, const rt_row_t *rows, uint32_t n)
+{
+    pthread_mutex_lock(&p->lock);
+    for (uint32_t i = 0; i < n; i++)
+        caps_unref_locked(p, rows[i].caps);
+    pthread_mutex_unlock(&p->lock);
+}
+
 /* --------------------------------------------------------------------------
  * Snapshot allocation helpers
  * -------------------------------------------------------------------------- */
 
-static rt_snapshot_t *snapshot_alloc(uint32_t capacity)
+static void columns_free(rt_columns_t *c)
+{
+    free(c->model_arch);
+    free(c->capability);
+    free(c->context_window);
+    free(c->cost_milli);
+    free(c->trust_level);
+    free(c->region_code);
+    free(c->has);
+}
+
+static int columns_alloc(rt_columns_t *c, uint32_t capacity)
+{
+    c->model_arch     = calloc(capacity, sizeof(uint32_t));
+    c->capability     = calloc(capacity, sizeof(uint32_t));
+    c->context_window = calloc(capacity, sizeof(uint32_t));
+    c->cost_milli     = calloc(capacity, sizeof(uint32_t));
+    c->trust_level    = calloc(capacity, sizeof(uint8_t));
+    c->region_code    = calloc(capacity, sizeof(uint16_t));
+    c->has            = calloc(capacity, sizeof(uint8_t));
+
+    if (!c->model_arch || !c->capability || !c->context_window ||
+        !c->cost_milli || !c->trust_level ||
+        !c->region_code || !c->has) {
+        columns_free(c);
+        return -1;
+    }
+    return 0;
+}
+
+static void columns_copy(rt_columns_t *dst, const rt_columns_t *src,
+                         uint32_t count)
+{
+    memcpy(dst->model_arch,     src->model_arch,     count * sizeof(uint32_t));
+    memcpy(dst->capability,     src->capability,     count * sizeof(uint32_t));
+    memcpy(dst->context_window, src->context_window, count * sizeof(uint32_t));
+    memcpy(dst->cost_milli,     src->cost_milli,     count * sizeof(uint32_t));
+    memcpy(dst->trust_level,    src->trust_level,    count * sizeof(uint8_t));
+    memcpy(dst->region_code,    src->region_code,    count * sizeof(uint16_t));
+    memcpy(dst->has,            src->has,            count * sizeof(uint8_t));
+}
+
+static void metrics_free(rt_metrics_t *m)
+{
+    free(m->latency_us);
+    free(m->load_factor);
+}
+
+static int metrics_alloc(rt_metrics_t *m, uint32_t capacity)
+{
+    m->latency_us  = calloc(capacity, sizeof(*m->latency_us));
+    m->load_factor = calloc(capacity, sizeof(*m->load_factor));
+    if (!m->latency_us || !m->load_factor) {
+        metrics_free(m);
+        return -1;
+    }
+    return 0;
+}
+
+static void metrics_copy(rt_metrics_t *dst, const rt_metrics_t *src,
+                         uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t lat  = atomic_load_explicit(&src->latency_us[i], memory_order_relaxed);
+        float    load = atomic_load_explicit(&src->load_factor[i], memory_order_relaxed);
+        atomic_store_explicit(&dst->latency_us[i], lat, memory_order_relaxed);
+        atomic_store_explicit(&dst->load_factor[i], load, memory_order_relaxed);
+    }
+}
+
+/* Expand row idx of s into a full entry with its live metrics */
+static void snapshot_read_row(const rt_snapshot_t *s, uint32_t idx,
+                              route_entry_t *out)
+{
+    const rt_row_t *r = &s->rows[idx];
+    const rt_columns_t *c = &s->cols;
+
+    memset(out, 0, sizeof(*out));
+    memcpy(out->node_id, r->node_id, 16);
+    /* Interned bytes were encoded by sad_encode, so always decode */
+    (void)sad_decode(r->caps->bytes, r->caps->len, &out->capabilities);
+    out->last_updated = r->last_updated;
+    out->ttl_ns       = r->ttl_ns;
+    out->cost_milli   = c->cost_milli[idx];
+    out->trust_level  = c->trust_level[idx];
+    out->region_code  = c->region_code[idx];
+    out->latency_us  = atomic_load_explicit(&s->metrics.latency_us[idx],
+                                            memory_order_relaxed);
+    out->load_factor = atomic_load_explicit(&s->metrics.load_factor[idx],
+                                            memory_order_relaxed);
+}
+
+static rt_snapshot_t *snapshot_alloc(rt_caps_pool_t *pool, uint32_t capacity)
 {
     rt_snapshot_t *s = calloc(1, sizeof(rt_snapshot_t));
     if (!s) return NULL;
-    s->entries  = calloc(capacity, sizeof(route_entry_t));
-    if (!s->entries) { free(s); return NULL; }
+    s->rows  = calloc(capacity, sizeof(rt_row_t));
+    if (!s->rows) { free(s); return NULL; }
+    if (columns_alloc(&s->cols, capacity) != 0) {
+        free(s->rows);
+        free(s);
+        return NULL;
+    }
+    if (metrics_alloc(&s->metrics, capacity) != 0) {
+        columns_free(&s->cols);
+        free(s->rows);
+        free(s);
+        return NULL;
+    }
+    s->pool     = pool;
     s->count    = 0;
     s->capacity = capacity;
-    atomic_init(&s->readers, 0);
+    atomic_init(&s->metrics_version, 0);
     return s;
 }
 
+static void index_free(rt_index_t *x)
+{
+    free(x->cap_bits);
+    free(x->arch_key);
+    free(x->arch_row);
+    free(x->ctx_key);
+    free(x->ctx_row);
+    free(x->trust_key);
+    free(x->trust_row);
+    memset(x, 0, sizeof(*x));
+}
+
 static void snapshot_free(rt_snapshot_t *s)
 {
     if (!s) return;
-    free(s->entries);
+    for (uint32_t n = 0; n < s->num_replicas; n++) {
+        if (s->replica[n] != s)
+            snapshot_free(s->replica[n]);
+    }
+    free(s->replica);
+    caps_unref_rows(s->pool, s->rows, s->count);
+    if (s->arena) {
+        strand_numa_free(s->arena, s->arena_len);
+        free(s);
+        return;
+    }
+    index_free(&s->index);
+    free(s->rowmap.slots);
+    metrics_free(&s->metrics);
+    columns_free(&s->cols);
+    free(s->rows);
     free(s);
 }
 
@@ -64,27 +530,253 @@ static rt_snapshot_t *snapshot_clone(const rt_snapshot_t *src, uint32_t new_cap)
 {
     if (new_cap < src->count)
         new_cap = src->count;
-    rt_snapshot_t *dst = snapshot_alloc(new_cap);
+    rt_snapshot_t *dst = snapshot_alloc(src->pool, new_cap);
     if (!dst) return NULL;
-    memcpy(dst->entries, src->entries, src->count * sizeof(route_entry_t));
+    memcpy(dst->rows, src->rows, src->count * sizeof(rt_row_t));
+    caps_ref_rows(src->pool, dst->rows, src->count);
+    columns_copy(&dst->cols, &src->cols, src->count);
+    metrics_copy(&dst->metrics, &src->metrics, src->count);
     dst->count = src->count;
     return dst;
 }
 
+/* Store an entry at row idx, decoding its scored fields into the columns.
+ * @ref is the entry's interned descriptor; the row takes that reference
+ * and drops the one it held, if idx is an existing row. */
+static void snapshot_set_row(rt_snapshot_t *s, uint32_t idx,
+                             const route_entry_t *e, rt_caps_t *ref)
+{
+    const sad_t *caps = &e->capabilities;
+    rt_columns_t *c = &s->cols;
+    rt_row_t *r = &s->rows[idx];
+    uint8_t has = 0;
+
+    if (idx < s->count)
+        caps_unref(s->pool, r->caps);
+    memcpy(r->node_id, e->node_id, 16);
+    r->last_updated = e->last_updated;
+    r->ttl_ns       = e->ttl_ns;
+    r->caps         = ref;
+
+    if (sad_find_field(caps, SAD_FIELD_MODEL_ARCH))
+        has |= SAD_COL_HAS_MODEL_ARCH;
+    if (sad_find_field(caps, SAD_FIELD_CAPABILITY))
+        has |= SAD_COL_HAS_CAPABILITY;
+    if (sad_find_field(caps, SAD_FIELD_CONTEXT_WINDOW))
+        has |= SAD_COL_HAS_CONTEXT_WINDOW;
+
+    c->model_arch[idx]     = sad_get_uint32(caps, SAD_FIELD_MODEL_ARCH);
+    c->capability[idx]     = sad_get_uint32(caps, SAD_FIELD_CAPABILITY);
+    c->context_window[idx] = sad_get_uint32(caps, SAD_FIELD_CONTEXT_WINDOW);
+    c->cost_milli[idx]     = e->cost_milli;
+    c->trust_level[idx]    = e->trust_level;
+    c->region_code[idx]    = e->region_code;
+    c->has[idx]            = has;
+
+    atomic_store_explicit(&s->metrics.latency_us[idx], e->latency_us,
+                          memory_order_relaxed);
+    atomic_store_explicit(&s->metrics.load_factor[idx], e->load_factor,
+                          memory_order_relaxed);
+}
+
+/* Move row src to row dst (used when compacting after a removal); the
+ * caller has dropped dst's descriptor reference */
+static void snapshot_move_row(rt_snapshot_t *s, uint32_t dst, uint32_t src)
+{
+    rt_columns_t *c = &s->cols;
+
+    s->rows[dst]           = s->rows[src];
+    c->model_arch[dst]     = c->model_arch[src];
+    c->capability[dst]     = c->capability[src];
+    c->context_window[dst] = c->context_window[src];
+    c->cost_milli[dst]     = c->cost_milli[src];
+    c->trust_level[dst]    = c->trust_level[src];
+    c->region_code[dst]    = c->region_code[src];
+    c->has[dst]            = c->has[src];
+
+    rt_metrics_t *m = &s->metrics;
+    atomic_store_explicit(&m->latency_us[dst],
+        atomic_load_explicit(&m->latency_us[src], memory_order_relaxed),
+        memory_order_relaxed);
+    atomic_store_explicit(&m->load_factor[dst],
+        atomic_load_explicit(&m->load_factor[src], memory_order_relaxed),
+        memory_order_relaxed);
+}
+
+/* Read-only column view handed to the matcher.  The latency column is the
+ * live metrics column: the matcher reads it with relaxed loads, so a
+ * racing metrics store is seen either before or after, never torn. */
+static sad_columns_t snapshot_columns(const rt_snapshot_t *s)
+{
+    sad_columns_t v = {
+        .model_arch     = s->cols.model_arch,
+        .capability     = s->cols.capability,
+        .context_window = s->cols.context_window,
+        .latency_us     = s->metrics.latency_us,
+        .cost_milli     = s->cols.cost_milli,
+        .trust_level    = s->cols.trust_level,
+        .region_code    = s->cols.region_code,
+        .has            = s->cols.has,
+        .count          = s->count,
+    };
+    return v;
+}
+
 /* --------------------------------------------------------------------------
- * Wait for readers to drain from a retired snapshot
+ * Secondary index build
  * -------------------------------------------------------------------------- */
 
-static void wait_for_readers(rt_snapshot_t *old)
+typedef struct {
+    uint32_t key;
+    uint32_t row;
+} index_pair_t;
+
+static int index_pair_cmp(const void *a, const void *b)
 {
-    /* Spin-wait until all readers that held a reference have released it.
-     * sched_yield() prevents busy-spin from starving readers on single-core
-     * or heavily loaded systems, which would otherwise deadlock. */
-    while (atomic_load_explicit(&old->readers, memory_order_acquire) > 0) {
-        sched_yield();
+    const index_pair_t *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    if (x->row != y->row) return x->row < y->row ? -1 : 1;
+    return 0;
+}
+
+/* Sort pairs[0..n) and split them into freshly allocated key/row arrays */
+static int index_split(index_pair_t *pairs, uint32_t n,
+                       uint32_t **keys, uint32_t **rows)
+{
+    qsort(pairs, n, sizeof(index_pair_t), index_pair_cmp);
+    *keys = malloc(((size_t)n + 1) * sizeof(uint32_t));
+    *rows = malloc(((size_t)n + 1) * sizeof(uint32_t));
+    if (!*keys || !*rows) return -1;
+    for (uint32_t i = 0; i < n; i++) {
+        (*keys)[i] = pairs[i].key;
+        (*rows)[i] = pairs[i].row;
+    }
+    return 0;
+}
+
+/* (Re)build the secondary indexes of s from its columns */
+static void snapshot_build_index(rt_snapshot_t *s)
+{
+    rt_index_t *x = &s->index;
+    const rt_columns_t *c = &s->cols;
+    uint32_t n = s->count;
+
+    index_free(x);
+
+    index_pair_t *pairs = malloc(((size_t)n + 1) * sizeof(index_pair_t));
+    x->words    = (n + 63) / 64;
+    x->cap_bits = calloc((size_t)SAD_INDEX_CAP_BITS * x->words + 1,
+                         sizeof(uint64_t));
+    if (!pairs || !x->cap_bits)
+        goto fail;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t cap = c->capability[i];
+        while (cap) {
+            uint32_t b = (uint32_t)__builtin_ctz(cap);
+            cap &= cap - 1;
+            x->cap_bits[(size_t)b * x->words + i / 64] |= (uint64_t)1 << (i % 64);
+        }
+    }
+
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (c->has[i] & SAD_COL_HAS_MODEL_ARCH)
+            pairs[m++] = (index_pair_t){ c->model_arch[i], i };
+    }
+    if (index_split(pairs, m, &x->arch_key, &x->arch_row) != 0)
+        goto fail;
+    x->num_arch = m;
+
+    m = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (c->has[i] & SAD_COL_HAS_CONTEXT_WINDOW)
+            pairs[m++] = (index_pair_t){ c->context_window[i], i };
+    }
+    if (index_split(pairs, m, &x->ctx_key, &x->ctx_row) != 0)
+        goto fail;
+    x->num_ctx = m;
+
+    for (uint32_t i = 0; i < n; i++)
+        pairs[i] = (index_pair_t){ c->trust_level[i], i };
+    qsort(pairs, n, sizeof(index_pair_t), index_pair_cmp);
+    x->trust_key = malloc((size_t)n + 1);
+    x->trust_row = malloc(((size_t)n + 1) * sizeof(uint32_t));
+    if (!x->trust_key || !x->trust_row)
+        goto fail;
+    for (uint32_t i = 0; i < n; i++) {
+        x->trust_key[i] = (uint8_t)pairs[i].key;
+        x->trust_row[i] = pairs[i].row;
+    }
+    x->num_trust = n;
+
+    free(pairs);
+    x->valid = true;
+    return;
+
+fail:
+    free(pairs);
+    index_free(x);
+}
+
+/* --------------------------------------------------------------------------
+ * node_id -> row map
+ * -------------------------------------------------------------------------- */
+
+static inline uint32_t node_id_hash(const uint8_t node_id[16])
+{
+    uint64_t a, b;
+    memcpy(&a, node_id, 8);
+    memcpy(&b, node_id + 8, 8);
+    uint64_t h = (a ^ (b * 0x9E3779B97F4A7C15ull)) * 0xFF51AFD7ED558CCDull;
+    return (uint32_t)(h >> 32);
+}
+
+/* (Re)build s->rowmap; on allocation failure the map is left empty and
+ * find_entry falls back to a linear scan. */
+static void snapshot_build_rowmap(rt_snapshot_t *s)
+{
+    rt_rowmap_t *m = &s->rowmap;
+    free(m->slots);
+    m->slots = NULL;
+    m->mask  = 0;
+
+    uint32_t cap = 16;
+    while (cap < s->count * 2u)
+        cap <<= 1;
+
+    m->slots = calloc(cap, sizeof(uint32_t));
+    if (!m->slots) return;
+    m->mask = cap - 1;
+
+    for (uint32_t i = 0; i < s->count; i++) {
+        uint32_t h = node_id_hash(s->rows[i].node_id) & m->mask;
+        while (m->slots[h] != 0)
+            h = (h + 1) & m->mask;
+        m->slots[h] = i + 1;
     }
 }
 
+/* Read-only index view handed to the matcher, NULL when unavailable */
+static const sad_index_t *snapshot_index(const rt_snapshot_t *s, sad_index_t *v)
+{
+    const rt_index_t *x = &s->index;
+    if (!x->valid) return NULL;
+
+    v->cap_bits  = x->cap_bits;
+    v->words     = x->words;
+    v->arch_key  = x->arch_key;
+    v->arch_row  = x->arch_row;
+    v->num_arch  = x->num_arch;
+    v->ctx_key   = x->ctx_key;
+    v->ctx_row   = x->ctx_row;
+    v->num_ctx   = x->num_ctx;
+    v->trust_key = x->trust_key;
+    v->trust_row = x->trust_row;
+    v->num_trust = x->num_trust;
+    return v;
+}
+
 /* --------------------------------------------------------------------------
  * Public API
  * -------------------------------------------------------------------------- */
@@ -97,11 +789,25 @@ routing_table_t *routing_table_create(uint32_t initial_capacity)
     routing_table_t *rt = calloc(1, sizeof(routing_table_t));
     if (!rt) return NULL;
 
-    rt_snapshot_t *snap = snapshot_alloc(initial_capacity);
-    if (!snap) { free(rt); return NULL; }
+    rt->epoch = epoch_domain_create();
+    if (!rt->epoch) { free(rt); return NULL; }
+
+    if (caps_pool_init(&rt->caps) != 0) {
+        epoch_domain_destroy(rt->epoch);
+        free(rt);
+        return NULL;
+    }
+    rt_snapshot_t *snap = snapshot_alloc(&rt->caps, initial_capacity);
+    if (!snap) {
+        caps_pool_destroy(&rt->caps);
+        epoch_domain_destroy(rt->epoch);
+        free(rt);
+        return NULL;
+    }
+    snap->epoch = rt->epoch;
+    snap->generation = rt->generation = 1;
 
     atomic_init(&rt->current, snap);
-    rt->standby = NULL;
     pthread_mutex_init(&rt->write_lock, NULL);
     rt->weights = scoring_weights_default();
 
@@ -113,7 +819,11 @@ void routing_table_destroy(routing_table_t *rt)
     if (!rt) return;
     rt_snapshot_t *cur = atomic_load(&rt->current);
     snapshot_free(cur);
-    snapshot_free(rt->standby);
+    epoch_domain_destroy(rt->epoch);   /* frees retired snapshots */
+    caps_pool_destroy(&rt->caps);      /* after every snapshot let go */
+    timer_wheel_destroy(rt->expiry.wheel);
+    free(rt->expiry.recs);
+    free(rt->expiry.slots);
     pthread_mutex_destroy(&rt->write_lock);
     free(rt);
 }
@@ -122,126 +832,728 @@ void routing_table_destroy(routing_table_t *rt)
  * Read path - lock-free
  * -------------------------------------------------------------------------- */
 
+/* Enter the table's read section and load the current snapshot.  NULL only
+ * if this thread could not be registered with the epoch domain. */
 static rt_snapshot_t *reader_acquire(const routing_table_t *rt)
 {
-    rt_snapshot_t *snap = atomic_load_explicit(
+    if (epoch_enter(rt->epoch) != 0)
+        return NULL;
+    rt_snapshot_t *s = atomic_load_explicit(
         ((_Atomic(rt_snapshot_t *) *)&rt->current), memory_order_acquire);
-    atomic_fetch_add_explicit(&snap->readers, 1, memory_order_acq_rel);
-    return snap;
+    if (s->num_replicas)
+        s = s->replica[(uint32_t)strand_numa_this_node() % s->num_replicas];
+    return s;
 }
 
 static void reader_release(rt_snapshot_t *snap)
 {
-    atomic_fetch_sub_explicit(&snap->readers, 1, memory_order_acq_rel);
+    epoch_exit(snap->epoch);
 }
 
 /* --------------------------------------------------------------------------
  * Write helpers (caller must hold write_lock)
  * -------------------------------------------------------------------------- */
 
-/* Find entry index by node_id within a snapshot, returns -1 if not found */
+/* Find entry index by node_id within a published snapshot, returns -1 if
+ * not found.  Read-only, so also safe on a reader-held snapshot. */
 static int find_entry(const rt_snapshot_t *snap, const uint8_t node_id[16])
 {
+    const rt_rowmap_t *m = &snap->rowmap;
+    if (m->slots) {
+        uint32_t h = node_id_hash(node_id) & m->mask;
+        for (uint32_t row; (row = m->slots[h]) != 0; h = (h + 1) & m->mask) {
+            if (node_id_equal(snap->rows[row - 1].node_id, node_id))
+                return (int)(row - 1);
+        }
+        return -1;
+    }
+
     for (uint32_t i = 0; i < snap->count; i++) {
-        if (node_id_equal(snap->entries[i].node_id, node_id))
+        if (node_id_equal(snap->rows[i].node_id, node_id))
             return (int)i;
     }
     return -1;
 }
 
-/* Swap current with new snapshot, wait for readers on old, then recycle old */
+static void snapshot_retire_fn(void *p)
+{
+    snapshot_free(p);
+}
+
+/* --------------------------------------------------------------------------
+ * Replicas (caller must hold write_lock)
+ *
+ * With replicas enabled each published snapshot carries a read-only copy
+ * per NUMA node, its arrays in one mapping whose pages come from that
+ * node, and reader_acquire() hands out the calling thread's.  The
+ * primary serves the node the writer published from, since it was first
+ * touched there.  Replicas
+ * are row-for-row identical, so row indices and hits carry across them,
+ * and they are freed with the primary after the same grace period.
+ * Only metrics change in place; those stores go to every replica.
+ * Interned descriptors stay shared: only the winners are decoded.
+ * -------------------------------------------------------------------------- */
+
+#define RT_ARENA_ALIGN 64u
+
+static size_t arena_size(size_t len)
+{
+    return (len + RT_ARENA_ALIGN - 1) & ~(size_t)(RT_ARENA_ALIGN - 1);
+}
+
+/* Copy @len bytes of @src to the arena cursor, cache-line aligned */
+static void *arena_dup(uint8_t **cur, const void *src, size_t len)
+{
+    void *p = *cur;
+    if (len) memcpy(p, src, len);
+    *cur += arena_size(len);
+    return p;
+}
+
+/* Bytes of arena a replica of @s takes; layout as snapshot_replicate() */
+static size_t replica_arena_len(const rt_snapshot_t *s)
+{
+    size_t n = s->count;
+    const rt_index_t *x = &s->index;
+    size_t len = arena_size(n * sizeof(rt_row_t)) +
+                 5 * arena_size(n * sizeof(uint32_t)) +    /* + latency */
+                 arena_size(n * sizeof(float)) +
+                 2 * arena_size(n) +
+                 arena_size(n * sizeof(uint16_t));
+    if (s->rowmap.slots)
+        len += arena_size(((size_t)s->rowmap.mask + 1) * sizeof(uint32_t));
+    if (x->valid)
+        len += arena_size(((size_t)SAD_INDEX_CAP_BITS * x->words + 1) *
+                          sizeof(uint64_t)) +
+               2 * arena_size((size_t)x->num_arch * sizeof(uint32_t)) +
+               2 * arena_size((size_t)x->num_ctx * sizeof(uint32_t)) +
+               arena_size(n) + arena_size(n * sizeof(uint32_t));
+    return len ? len : RT_ARENA_ALIGN;
+}
+
+/*
+ * A node-local copy of the published-to-be @src, NULL on failure.  Every
+ * array goes into one mapping whose pages are taken from @node (the
+ * struct itself stays on the heap: it is read once per lookup), so a
+ * replica costs one mmap and one mbind however many arrays it has.
+ */
+static rt_snapshot_t *snapshot_replicate(const rt_snapshot_t *src, int node)
+{
+    rt_snapshot_t *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->arena_len = replica_arena_len(src);
+    r->arena     = strand_numa_alloc(r->arena_len, node);
+    if (!r->arena) {
+        free(r);
+        return NULL;
+    }
+
+    size_t n = src->count;
+    const rt_columns_t *sc = &src->cols;
+    rt_columns_t *c = &r->cols;
+    uint8_t *cur = r->arena;
+
+    r->rows = arena_dup(&cur, src->rows, n * sizeof(rt_row_t));
+    caps_ref_rows(src->pool, r->rows, src->count);
+    c->model_arch     = arena_dup(&cur, sc->model_arch, n * sizeof(uint32_t));
+    c->capability     = arena_dup(&cur, sc->capability, n * sizeof(uint32_t));
+    c->context_window = arena_dup(&cur, sc->context_window, n * sizeof(uint32_t));
+    c->cost_milli     = arena_dup(&cur, sc->cost_milli, n * sizeof(uint32_t));
+    c->trust_level    = arena_dup(&cur, sc->trust_level, n);
+    c->region_code    = arena_dup(&cur, sc->region_code, n * sizeof(uint16_t));
+    c->has            = arena_dup(&cur, sc->has, n);
+
+    r->metrics.latency_us = (_Atomic uint32_t *)cur;
+    cur += arena_size(n * sizeof(uint32_t));
+    r->metrics.load_factor = (_Atomic float *)cur;
+    cur += arena_size(n * sizeof(float));
+    metrics_copy(&r->metrics, &src->metrics, src->count);
+
+    if (src->rowmap.slots)
+        r->rowmap.slots = arena_dup(&cur, src->rowmap.slots,
+                                    ((size_t)src->rowmap.mask + 1) * sizeof(uint32_t));
+    r->rowmap.mask = src->rowmap.mask;
+
+    const rt_index_t *sx = &src->index;
+    if (sx->valid) {
+        rt_index_t *x = &r->index;
+        *x = *sx;
+        x->cap_bits  = arena_dup(&cur, sx->cap_bits,
+                                 ((size_t)SAD_INDEX_CAP_BITS * sx->words + 1) *
+                                 sizeof(uint64_t));
+        x->arch_key  = arena_dup(&cur, sx->arch_key, (size_t)sx->num_arch * sizeof(uint32_t));
+        x->arch_row  = arena_dup(&cur, sx->arch_row, (size_t)sx->num_arch * sizeof(uint32_t));
+        x->ctx_key   = arena_dup(&cur, sx->ctx_key, (size_t)sx->num_ctx * sizeof(uint32_t));
+        x->ctx_row   = arena_dup(&cur, sx->ctx_row, (size_t)sx->num_ctx * sizeof(uint32_t));
+        x->trust_key = arena_dup(&cur, sx->trust_key, n);
+        x->trust_row = arena_dup(&cur, sx->trust_row, n * sizeof(uint32_t));
+    }
+
+    r->pool       = src->pool;
+    r->count      = src->count;
+    r->capacity   = src->count;
+    r->epoch      = src->epoch;
+    r->generation = src->generation;
+    atomic_init(&r->metrics_version, 0);
+    return r;
+}
+
+/* Attach rt->replicas node-local copies to @s.  A replica that cannot be
+ * made is left out and its node reads the primary. */
+static void snapshot_attach_replicas(routing_table_t *rt, rt_snapshot_t *s)
+{
+    s->replica = calloc(rt->replicas, sizeof(*s->replica));
+    if (!s->replica) return;
+    s->num_replicas = rt->replicas;
+
+    uint32_t home = (uint32_t)strand_numa_this_node() % rt->replicas;
+    for (uint32_t n = 0; n < rt->replicas; n++) {
+        s->replica[n] = n == home ? s : snapshot_replicate(s, (int)n);
+        if (!s->replica[n])
+            s->replica[n] = s;
+    }
+}
+
+/* Swap current with new snapshot and retire the old one; it is freed by
+ * the epoch domain once the last reader that could see it has left */
 static void publish_and_reclaim(routing_table_t *rt, rt_snapshot_t *new_snap)
 {
+    snapshot_build_index(new_snap);
+    if (!new_snap->rowmap.slots)
+        snapshot_build_rowmap(new_snap);
+    new_snap->epoch = rt->epoch;
+    new_snap->generation = ++rt->generation;
+    if (rt->replicas > 1)
+        snapshot_attach_replicas(rt, new_snap);
+
     rt_snapshot_t *old = atomic_exchange_explicit(
         &rt->current, new_snap, memory_order_acq_rel);
 
-    wait_for_readers(old);
-
-    /* Recycle old as the standby buffer */
-    snapshot_free(rt->standby);
-    rt->standby = old;
+    epoch_retire(rt->epoch, old, snapshot_retire_fn);
 }
 
 /* --------------------------------------------------------------------------
- * routing_table_insert
+ * node_id -> row map maintenance inside a transaction
+ *
+ * The working copy's map is built once when the copy is made and then
+ * kept in sync row by row, so staging stays O(1) per operation.
  * -------------------------------------------------------------------------- */
 
-int routing_table_insert(routing_table_t *rt, const route_entry_t *entry)
+/* Slot holding node_id in s->rowmap, or -1 */
+static int rowmap_slot(const rt_snapshot_t *s, const uint8_t node_id[16])
 {
-    if (!rt || !entry) return -1;
+    const rt_rowmap_t *m = &s->rowmap;
+    uint32_t h = node_id_hash(node_id) & m->mask;
+    for (uint32_t row; (row = m->slots[h]) != 0; h = (h + 1) & m->mask) {
+        if (node_id_equal(s->rows[row - 1].node_id, node_id))
+            return (int)h;
+    }
+    return -1;
+}
 
-    pthread_mutex_lock(&rt->write_lock);
+/* Map the (new) entry at row idx */
+static void rowmap_add(rt_snapshot_t *s, uint32_t idx)
+{
+    rt_rowmap_t *m = &s->rowmap;
+    if (!m->slots) return;
+    if ((s->count) * 2u > m->mask + 1) {
+        snapshot_build_rowmap(s);  /* grow; includes row idx */
+        return;
+    }
+    uint32_t h = node_id_hash(s->rows[idx].node_id) & m->mask;
+    while (m->slots[h] != 0)
+        h = (h + 1) & m->mask;
+    m->slots[h] = idx + 1;
+}
 
-    rt_snapshot_t *cur = atomic_load_explicit(&rt->current, memory_order_acquire);
+/* Unmap node_id (backward-shift deletion keeps probe chains intact) */
+static void rowmap_del(rt_snapshot_t *s, const uint8_t node_id[16])
+{
+    rt_rowmap_t *m = &s->rowmap;
+    if (!m->slots) return;
+    int slot = rowmap_slot(s, node_id);
+    if (slot < 0) return;
+
+    uint32_t i = (uint32_t)slot, j = i;
+    for (;;) {
+        j = (j + 1) & m->mask;
+        if (m->slots[j] == 0) break;
+        uint32_t k = node_id_hash(s->rows[m->slots[j] - 1].node_id) & m->mask;
+        /* Move j back into the hole at i unless its home k lies in (i, j] */
+        bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays) {
+            m->slots[i] = m->slots[j];
+            i = j;
+        }
+    }
+    m->slots[i] = 0;
+}
 
-    /* Determine if we need more capacity */
-    uint32_t new_cap = cur->capacity;
-    if (cur->count >= cur->capacity)
-        new_cap = cur->capacity * 2;
+/* Point node_id's mapping at row idx */
+static void rowmap_retarget(rt_snapshot_t *s, const uint8_t node_id[16],
+                            uint32_t idx)
+{
+    if (!s->rowmap.slots) return;
+    int slot = rowmap_slot(s, node_id);
+    if (slot >= 0)
+        s->rowmap.slots[slot] = idx + 1;
+}
 
-    rt_snapshot_t *next = snapshot_clone(cur, new_cap);
-    if (!next) {
-        pthread_mutex_unlock(&rt->write_lock);
-        return -1;
+/* --------------------------------------------------------------------------
+ * Transactions
+ *
+ * A transaction holds write_lock from begin to commit.  The first change
+ * that alters the arrays clones the current snapshot into a private
+ * working copy; every later change is applied to that copy in place, and
+ * commit publishes it with one index build and one grace period.  Metric
+ * updates before any structural change are stored in place, exactly as
+ * routing_table_update_metrics does.
+ *
+ * The single-operation writers below are one-operation transactions.
+ * -------------------------------------------------------------------------- */
+
+struct routing_table_txn {
+    routing_table_t *rt;
+    rt_snapshot_t   *next;      /* working copy, NULL until first change */
+    uint32_t         staged;    /* operations applied so far */
+};
+
+static void txn_open(struct routing_table_txn *t, routing_table_t *rt)
+{
+    pthread_mutex_lock(&rt->write_lock);
+    t->rt     = rt;
+    t->next   = NULL;
+    t->staged = 0;
+}
+
+/* Publish (or drop) the working copy and release the lock */
+static void txn_close(struct routing_table_txn *t, bool publish)
+{
+    if (t->next) {
+        if (publish)
+            publish_and_reclaim(t->rt, t->next);
+        else
+            snapshot_free(t->next);
+        t->next = NULL;
     }
+    pthread_mutex_unlock(&t->rt->write_lock);
+}
+
+/* Snapshot reads inside the transaction go to */
+static rt_snapshot_t *txn_view(const struct routing_table_txn *t)
+{
+    if (t->next) return t->next;
+    return atomic_load_explicit(&t->rt->current, memory_order_acquire);
+}
+
+/* Working copy with room for @extra more rows, cloned on first use */
+static rt_snapshot_t *txn_working(struct routing_table_txn *t, uint32_t extra)
+{
+    rt_snapshot_t *src = txn_view(t);
+    uint32_t cap = src->capacity;
+    while (src->count + extra > cap)
+        cap *= 2;
+
+    if (t->next && cap == t->next->capacity)
+        return t->next;
+
+    rt_snapshot_t *w = snapshot_clone(src, cap);
+    if (!w) return NULL;
+    snapshot_build_rowmap(w);
+
+    if (t->next)
+        snapshot_free(t->next);
+    t->next = w;
+    return w;
+}
+
+static void ttl_note(routing_table_t *rt, const rt_row_t *r);
+
+static int txn_insert(struct routing_table_txn *t, const route_entry_t *entry)
+{
+    int idx = find_entry(txn_view(t), entry->node_id);
+
+    rt_snapshot_t *w = txn_working(t, idx >= 0 ? 0 : 1);
+    if (!w) return -1;
+
+    /* Fails only if the capabilities do not encode, or on allocation */
+    rt_caps_t *ref = caps_intern_sad(w->pool, &entry->capabilities);
+    if (!ref) return -1;
 
-    /* Check if entry already exists (update in-place in copy) */
-    int idx = find_entry(next, entry->node_id);
     if (idx >= 0) {
-        next->entries[idx] = *entry;
+        snapshot_set_row(w, (uint32_t)idx, entry, ref);
     } else {
-        next->entries[next->count] = *entry;
-        next->count++;
+        idx = (int)w->count;
+        snapshot_set_row(w, w->count, entry, ref);
+        w->count++;
+        rowmap_add(w, w->count - 1);
+    }
+    if (entry->ttl_ns)
+        ttl_note(t->rt, &w->rows[idx]);
+    t->staged++;
+    return 0;
+}
+
+static int txn_remove(struct routing_table_txn *t, const uint8_t node_id[16])
+{
+    if (find_entry(txn_view(t), node_id) < 0)
+        return -1;
+
+    rt_snapshot_t *w = txn_working(t, 0);
+    if (!w) return -1;
+    int idx = find_entry(w, node_id);
+
+    /* Remove by swapping with last element */
+    uint32_t last = w->count - 1;
+    rowmap_del(w, node_id);
+    caps_unref(w->pool, w->rows[idx].caps);
+    if ((uint32_t)idx < last) {
+        rowmap_retarget(w, w->rows[last].node_id, (uint32_t)idx);
+        snapshot_move_row(w, (uint32_t)idx, last);
     }
+    w->count--;
+    t->staged++;
+    return 0;
+}
 
-    publish_and_reclaim(rt, next);
-    pthread_mutex_unlock(&rt->write_lock);
+static int txn_update_metrics(struct routing_table_txn *t,
+                              const uint8_t node_id[16],
+                              uint32_t latency_us, float load_factor)
+{
+    rt_snapshot_t *v = txn_view(t);
+    int idx = find_entry(v, node_id);
+    if (idx < 0) return -1;
+
+    /* Metrics live outside the copy-on-write arrays: store in place, no
+     * clone and no grace period.  Readers pick the values up on their
+     * next scan; the next clone carries them forward.  Inside a staged
+     * transaction this lands in the working copy instead. */
+    for (uint32_t n = 0; n <= v->num_replicas; n++) {
+        rt_snapshot_t *r = n == 0 ? v : v->replica[n - 1];
+        if (n > 0 && r == v)
+            continue;       /* that node reads the primary */
+        atomic_store_explicit(&r->metrics.latency_us[idx], latency_us,
+                              memory_order_relaxed);
+        atomic_store_explicit(&r->metrics.load_factor[idx], load_factor,
+                              memory_order_relaxed);
+        /* Readers that observe the new version also observe the stores */
+        atomic_fetch_add_explicit(&r->metrics_version, 1, memory_order_release);
+    }
+    t->staged++;
     return 0;
 }
 
+static inline bool entry_live(const rt_row_t *r, uint64_t now_ns)
+{
+    return r->ttl_ns == 0 || (now_ns - r->last_updated) <= r->ttl_ns;
+}
+
+static int txn_gc(struct routing_table_txn *t, uint64_t now_ns)
+{
+    const rt_snapshot_t *v = txn_view(t);
+
+    /* Count how many entries will be expired */
+    uint32_t expired = 0;
+    for (uint32_t i = 0; i < v->count; i++) {
+        if (!entry_live(&v->rows[i], now_ns))
+            expired++;
+    }
+    if (expired == 0)
+        return 0;
+
+    rt_snapshot_t *w = txn_working(t, 0);
+    if (!w) return -1;
+
+    /* Compact the live entries down, preserving their order */
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < w->count; i++) {
+        if (!entry_live(&w->rows[i], now_ns)) {
+            caps_unref(w->pool, w->rows[i].caps);
+            continue;
+        }
+        if (n != i)
+            snapshot_move_row(w, n, i);
+        n++;
+    }
+    w->count = n;
+    snapshot_build_rowmap(w);
+
+    t->staged++;
+    return (int)expired;
+}
+
 /* --------------------------------------------------------------------------
- * routing_table_remove
+ * TTL timers (caller must hold write_lock)
  * -------------------------------------------------------------------------- */
 
-int routing_table_remove(routing_table_t *rt, const uint8_t node_id[16])
+/* Fires one tick past the deadline, when entry_live() turns false */
+static uint64_t ttl_deadline(const rt_row_t *r)
 {
-    if (!rt || !node_id) return -1;
+    return r->last_updated + r->ttl_ns + RT_TTL_TICK_NS;
+}
 
-    pthread_mutex_lock(&rt->write_lock);
+static int ttl_slot(const rt_expiry_t *x, const uint8_t node_id[16])
+{
+    if (!x->slots) return -1;
+    uint32_t h = node_id_hash(node_id) & x->mask;
+    for (uint32_t r; (r = x->slots[h]) != 0; h = (h + 1) & x->mask) {
+        if (node_id_equal(x->recs[r - 1].node_id, node_id))
+            return (int)h;
+    }
+    return -1;
+}
 
-    rt_snapshot_t *cur = atomic_load_explicit(&rt->current, memory_order_acquire);
+static int ttl_rehash(rt_expiry_t *x, uint32_t cap)
+{
+    uint32_t *slots = calloc(cap, sizeof(*slots));
+    if (!slots) return -1;
+    free(x->slots);
+    x->slots = slots;
+    x->mask  = cap - 1;
+    for (uint32_t i = 0; i < x->cap_recs; i++) {
+        if (x->recs[i].timer == TIMER_WHEEL_NONE)
+            continue;
+        uint32_t h = node_id_hash(x->recs[i].node_id) & x->mask;
+        while (slots[h] != 0)
+            h = (h + 1) & x->mask;
+        slots[h] = i + 1;
+    }
+    return 0;
+}
 
-    int idx = find_entry(cur, node_id);
-    if (idx < 0) {
-        pthread_mutex_unlock(&rt->write_lock);
+/* A free record, registered under @node_id; -1 on allocation failure */
+static int ttl_rec_new(rt_expiry_t *x, const uint8_t node_id[16])
+{
+    if ((x->num_recs + 1) * 2 > x->mask + 1 &&
+        ttl_rehash(x, x->slots ? (x->mask + 1) * 2 : 64) != 0)
         return -1;
+    if (x->free_rec == 0) {
+        uint32_t cap = x->cap_recs ? x->cap_recs * 2 : 32;
+        rt_ttl_rec_t *recs = realloc(x->recs, cap * sizeof(*recs));
+        if (!recs) return -1;
+        for (uint32_t i = cap; i-- > x->cap_recs; ) {
+            recs[i].timer     = TIMER_WHEEL_NONE;
+            recs[i].next_free = x->free_rec;
+            x->free_rec       = i + 1;
+        }
+        x->recs     = recs;
+        x->cap_recs = cap;
     }
 
-    rt_snapshot_t *next = snapshot_clone(cur, cur->capacity);
-    if (!next) {
-        pthread_mutex_unlock(&rt->write_lock);
-        return -1;
+    uint32_t r = x->free_rec - 1;
+    x->free_rec = x->recs[r].next_free;
+    memcpy(x->recs[r].node_id, node_id, 16);
+    x->num_recs++;
+
+    uint32_t h = node_id_hash(node_id) & x->mask;
+    while (x->slots[h] != 0)
+        h = (h + 1) & x->mask;
+    x->slots[h] = r + 1;
+    return (int)r;
+}
+
+/* Forget record @r (its timer is released by the caller or the wheel) */
+static void ttl_rec_free(rt_expiry_t *x, uint32_t r)
+{
+    int slot = ttl_slot(x, x->recs[r].node_id);
+    if (slot >= 0) {
+        /* Backward-shift deletion keeps probe chains intact */
+        uint32_t i = (uint32_t)slot;
+        for (uint32_t j = (i + 1) & x->mask; x->slots[j] != 0;
+             j = (j + 1) & x->mask) {
+            uint32_t home = node_id_hash(x->recs[x->slots[j] - 1].node_id) & x->mask;
+            if (((j - home) & x->mask) >= ((j - i) & x->mask)) {
+                x->slots[i] = x->slots[j];
+                i = j;
+            }
+        }
+        x->slots[i] = 0;
     }
+    x->recs[r].timer     = TIMER_WHEEL_NONE;
+    x->recs[r].next_free = x->free_rec;
+    x->free_rec          = r + 1;
+    x->num_recs--;
+}
 
-    /* Remove by swapping with last element */
-    if ((uint32_t)idx < next->count - 1) {
-        next->entries[idx] = next->entries[next->count - 1];
+/* Arm (or move) the TTL timer of @e.  On failure the table is marked
+ * lossy and the next routing_table_expire() falls back to a full sweep. */
+static void ttl_note(routing_table_t *rt, const rt_row_t *e)
+{
+    rt_expiry_t *x = &rt->expiry;
+    if (!x->wheel) {
+        x->wheel = timer_wheel_create(RT_TTL_TICK_NS, e->last_updated);
+        if (!x->wheel) {
+            x->lossy = true;
+            return;
+        }
+    }
+
+    int slot = ttl_slot(x, e->node_id);
+    if (slot >= 0) {
+        timer_wheel_mod(x->wheel, x->recs[x->slots[slot] - 1].timer,
+                        ttl_deadline(e));
+        return;
+    }
+    int r = ttl_rec_new(x, e->node_id);
+    if (r < 0) {
+        x->lossy = true;
+        return;
     }
-    next->count--;
+    uint32_t id = timer_wheel_add(x->wheel, ttl_deadline(e), (uint64_t)r);
+    if (id == TIMER_WHEEL_NONE) {
+        ttl_rec_free(x, (uint32_t)r);
+        x->lossy = true;
+        return;
+    }
+    x->recs[r].timer = id;
+}
+
+typedef struct {
+    struct routing_table_txn *t;
+    uint64_t now_ns;
+    int      expired;
+    bool     failed;
+} ttl_fire_ctx_t;
+
+static void ttl_fire(void *ctx, uint32_t id, uint64_t data)
+{
+    ttl_fire_ctx_t *c = ctx;
+    rt_expiry_t *x = &c->t->rt->expiry;
+    uint32_t r = (uint32_t)data;
+
+    rt_snapshot_t *v = txn_view(c->t);
+    int row = find_entry(v, x->recs[r].node_id);
+    if (row >= 0 && v->rows[row].ttl_ns != 0) {
+        const rt_row_t *e = &v->rows[row];
+        if (entry_live(e, c->now_ns)) {
+            timer_wheel_mod(x->wheel, id, ttl_deadline(e));    /* refreshed */
+            return;
+        }
+        if (txn_remove(c->t, x->recs[r].node_id) != 0) {
+            timer_wheel_mod(x->wheel, id, c->now_ns + RT_TTL_TICK_NS);
+            c->failed = true;
+            return;
+        }
+        c->expired++;
+    }
+    ttl_rec_free(x, r);
+}
+
+static int txn_expire(struct routing_table_txn *t, uint64_t now_ns)
+{
+    rt_expiry_t *x = &t->rt->expiry;
+    ttl_fire_ctx_t c = { t, now_ns, 0, false };
+
+    if (x->wheel)
+        timer_wheel_advance(x->wheel, now_ns, ttl_fire, &c);
+
+    /* Some entry may have no timer: sweep everything once and re-arm */
+    if (x->lossy && !c.failed) {
+        int n = txn_gc(t, now_ns);
+        if (n < 0)
+            return -1;
+        c.expired += n;
+        x->lossy = false;
+        const rt_snapshot_t *v = txn_view(t);
+        for (uint32_t i = 0; i < v->count; i++) {
+            if (v->rows[i].ttl_ns)
+                ttl_note(t->rt, &v->rows[i]);
+        }
+    }
+    return c.failed ? -1 : c.expired;
+}
+
+/* --------------------------------------------------------------------------
+ * Public transaction API
+ * -------------------------------------------------------------------------- */
 
-    publish_and_reclaim(rt, next);
-    pthread_mutex_unlock(&rt->write_lock);
+routing_table_txn_t *routing_table_txn_begin(routing_table_t *rt)
+{
+    if (!rt) return NULL;
+
+    routing_table_txn_t *txn = malloc(sizeof(*txn));
+    if (!txn) return NULL;
+
+    txn_open(txn, rt);
+    return txn;
+}
+
+int routing_table_txn_insert(routing_table_txn_t *txn, const route_entry_t *entry)
+{
+    if (!txn || !entry) return -1;
+    return txn_insert(txn, entry);
+}
+
+int routing_table_txn_remove(routing_table_txn_t *txn, const uint8_t node_id[16])
+{
+    if (!txn || !node_id) return -1;
+    return txn_remove(txn, node_id);
+}
+
+int routing_table_txn_update_metrics(routing_table_txn_t *txn,
+                                     const uint8_t node_id[16],
+                                     uint32_t latency_us,
+                                     float load_factor)
+{
+    if (!txn || !node_id) return -1;
+    return txn_update_metrics(txn, node_id, latency_us, load_factor);
+}
+
+int routing_table_txn_gc(routing_table_txn_t *txn, uint64_t now_ns)
+{
+    if (!txn) return -1;
+    return txn_gc(txn, now_ns);
+}
+
+uint32_t routing_table_txn_staged(const routing_table_txn_t *txn)
+{
+    return txn ? txn->staged : 0;
+}
+
+int routing_table_txn_commit(routing_table_txn_t *txn)
+{
+    if (!txn) return -1;
+    txn_close(txn, true);
+    free(txn);
     return 0;
 }
 
+void routing_table_txn_abort(routing_table_txn_t *txn)
+{
+    if (!txn) return;
+    txn_close(txn, false);
+    free(txn);
+}
+
 /* --------------------------------------------------------------------------
- * routing_table_lookup  (lock-free read path)
+ * routing_table_insert / routing_table_remove
  * -------------------------------------------------------------------------- */
 
-/* Forward declaration from sad_match.c */
-extern int sad_find_best(const sad_t *query, const route_entry_t *table,
-                         int table_size, const scoring_weights_t *weights,
-                         int top_k, resolve_result_t *results);
+int routing_table_insert(routing_table_t *rt, const route_entry_t *entry)
+{
+    if (!rt || !entry) return -1;
+
+    struct routing_table_txn t;
+    txn_open(&t, rt);
+    int rc = txn_insert(&t, entry);
+    txn_close(&t, true);
+    return rc;
+}
+
+int routing_table_remove(routing_table_t *rt, const uint8_t node_id[16])
+{
+    if (!rt || !node_id) return -1;
+
+    struct routing_table_txn t;
+    txn_open(&t, rt);
+    int rc = txn_remove(&t, node_id);
+    txn_close(&t, true);
+    return rc;
+}
+
+/* --------------------------------------------------------------------------
+ * routing_table_lookup  (lock-free read path)
+ * -------------------------------------------------------------------------- */
 
 int routing_table_lookup(const routing_table_t *rt,
                          const sad_t *query,
@@ -251,19 +1563,136 @@ int routing_table_lookup(const routing_table_t *rt,
     if (!rt || !query || !results || max_results <= 0)
         return -1;
 
+    /* Decode the query once, before touching the snapshot */
+    sad_query_t q;
+    sad_query_compile(query, &q);
+
+    sad_hit_t stack_hits[RT_LOOKUP_STACK];
+    sad_hit_t *hits = stack_hits;
+    if (max_results > RT_LOOKUP_STACK) {
+        hits = malloc((size_t)max_results * sizeof(*hits));
+        if (!hits) return -1;
+    }
+
     rt_snapshot_t *snap = reader_acquire(rt);
+    if (!snap) {
+        if (hits != stack_hits) free(hits);
+        return -1;
+    }
 
-    int n = sad_find_best(query,
-                          snap->entries,
-                          (int)snap->count,
-                          &rt->weights,
-                          max_results,
-                          results);
+    sad_columns_t cols = snapshot_columns(snap);
+    sad_index_t idx;
+    int n = 0;
+    if (snap->count > 0)
+        n = sad_find_best_indexed(&q, &cols, snapshot_index(snap, &idx),
+                                  &rt->weights, max_results, hits);
+
+    /* Only the winners are expanded */
+    for (int i = 0; i < n; i++) {
+        snapshot_read_row(snap, hits[i].index, &results[i].entry);
+        results[i].score = hits[i].score;
+    }
 
     reader_release(snap);
+    if (hits != stack_hits) free(hits);
     return n;
 }
 
+/* --------------------------------------------------------------------------
+ * Pinned views
+ * -------------------------------------------------------------------------- */
+
+const routing_table_view_t *routing_table_pin(const routing_table_t *rt)
+{
+    if (!rt) return NULL;
+    return reader_acquire(rt);
+}
+
+void routing_table_unpin(const routing_table_view_t *view)
+{
+    if (!view) return;
+    reader_release((rt_snapshot_t *)view);
+}
+
+uint32_t routing_table_view_count(const routing_table_view_t *view)
+{
+    return view ? view->count : 0;
+}
+
+const route_entry_t *routing_table_view_entry(const routing_table_view_t *view,
+                                              uint32_t index)
+{
+    static _Thread_local route_entry_t slot;
+    if (!view || index >= view->count) return NULL;
+    snapshot_read_row(view, index, &slot);
+    return &slot;
+}
+
+int routing_table_view_read(const routing_table_view_t *view, uint32_t index,
+                            route_entry_t *out)
+{
+    if (!view || !out || index >= view->count) return -1;
+    snapshot_read_row(view, index, out);
+    return 0;
+}
+
+const uint8_t *routing_table_view_node_id(const routing_table_view_t *view,
+                                          uint32_t index)
+{
+    if (!view || index >= view->count) return NULL;
+    return view->rows[index].node_id;
+}
+
+int routing_table_view_find(const routing_table_view_t *view,
+                            const uint8_t node_id[16])
+{
+    if (!view || !node_id) return -1;
+    return find_entry(view, node_id);
+}
+
+uint64_t routing_table_view_generation(const routing_table_view_t *view)
+{
+    return view ? view->generation : 0;
+}
+
+uint64_t routing_table_view_metrics_version(const routing_table_view_t *view)
+{
+    if (!view) return 0;
+    return atomic_load_explicit(
+        &((routing_table_view_t *)view)->metrics_version,
+        memory_order_acquire);
+}
+
+int routing_table_view_metrics(const routing_table_view_t *view,
+                               uint32_t index,
+                               uint32_t *latency_us,
+                               float *load_factor)
+{
+    if (!view || index >= view->count) return -1;
+    if (latency_us)
+        *latency_us = atomic_load_explicit(&view->metrics.latency_us[index],
+                                           memory_order_relaxed);
+    if (load_factor)
+        *load_factor = atomic_load_explicit(&view->metrics.load_factor[index],
+                                            memory_order_relaxed);
+    return 0;
+}
+
+int routing_table_view_lookup(const routing_table_view_t *view,
+                              const sad_query_t *query,
+                              const scoring_weights_t *weights,
+                              sad_hit_t *hits,
+                              int max_hits)
+{
+    if (!view || !query || !hits || max_hits <= 0)
+        return -1;
+
+    sad_columns_t cols = snapshot_columns(view);
+    sad_index_t idx;
+    return sad_find_best_indexed(query, &cols, snapshot_index(view, &idx),
+                                 weights, max_hits, hits);
+}
+
 /* --------------------------------------------------------------------------
  * routing_table_update_metrics
  * -------------------------------------------------------------------------- */
@@ -275,38 +1704,58 @@ int routing_table_update_metrics(routing_table_t *rt,
 {
     if (!rt || !node_id) return -1;
 
-    pthread_mutex_lock(&rt->write_lock);
-
-    rt_snapshot_t *cur = atomic_load_explicit(&rt->current, memory_order_acquire);
+    struct routing_table_txn t;
+    txn_open(&t, rt);
+    int rc = txn_update_metrics(&t, node_id, latency_us, load_factor);
+    txn_close(&t, true);
+    return rc;
+}
 
-    int idx = find_entry(cur, node_id);
-    if (idx < 0) {
-        pthread_mutex_unlock(&rt->write_lock);
-        return -1;
-    }
+/* --------------------------------------------------------------------------
+ * routing_table_set_replicas
+ * -------------------------------------------------------------------------- */
 
-    rt_snapshot_t *next = snapshot_clone(cur, cur->capacity);
-    if (!next) {
-        pthread_mutex_unlock(&rt->write_lock);
+int routing_table_set_replicas(routing_table_t *rt, int replicas)
+{
+    if (!rt) return -1;
+    if (replicas < 0)
+        replicas = strand_numa_nodes();
+    if (replicas > RT_MAX_REPLICAS)
+        replicas = RT_MAX_REPLICAS;
+
+    /* Republish so the current snapshot gets (or drops) its replicas */
+    struct routing_table_txn t;
+    txn_open(&t, rt);
+    uint32_t prev = rt->replicas;
+    rt->replicas = replicas > 1 ? (uint32_t)replicas : 0;
+    if (!txn_working(&t, 0)) {
+        rt->replicas = prev;
+        txn_close(&t, false);
         return -1;
     }
-
-    next->entries[idx].latency_us  = latency_us;
-    next->entries[idx].load_factor = load_factor;
-
-    publish_and_reclaim(rt, next);
-    pthread_mutex_unlock(&rt->write_lock);
-    return 0;
+    txn_close(&t, true);
+    return replicas > 1 ? replicas : 1;
 }
 
 /* --------------------------------------------------------------------------
  * routing_table_size
  * -------------------------------------------------------------------------- */
 
+uint32_t routing_table_descriptor_count(const routing_table_t *rt)
+{
+    if (!rt) return 0;
+    routing_table_t *w = (routing_table_t *)rt;
+    pthread_mutex_lock(&w->caps.lock);
+    uint32_t n = w->caps.live;
+    pthread_mutex_unlock(&w->caps.lock);
+    return n;
+}
+
 uint32_t routing_table_size(const routing_table_t *rt)
 {
     if (!rt) return 0;
     rt_snapshot_t *snap = reader_acquire(rt);
+    if (!snap) return 0;
     uint32_t n = snap->count;
     reader_release(snap);
     return n;
@@ -323,13 +1772,30 @@ int routing_table_snapshot(const routing_table_t *rt,
     if (!rt || !out || max <= 0) return 0;
 
     rt_snapshot_t *snap = reader_acquire(rt);
+    if (!snap) return 0;
     int n = (int)snap->count;
     if (n > max) n = max;
-    memcpy(out, snap->entries, (size_t)n * sizeof(route_entry_t));
+    for (int i = 0; i < n; i++)
+        snapshot_read_row(snap, (uint32_t)i, &out[i]);
     reader_release(snap);
     return n;
 }
 
+/* --------------------------------------------------------------------------
+ * routing_table_expire — TTL expiry by timer, O(expired)
+ * -------------------------------------------------------------------------- */
+
+int routing_table_expire(routing_table_t *rt, uint64_t now_ns)
+{
+    if (!rt) return -1;
+
+    struct routing_table_txn t;
+    txn_open(&t, rt);
+    int expired = txn_expire(&t, now_ns);
+    txn_close(&t, true);
+    return expired;
+}
+
 /* --------------------------------------------------------------------------
  * routing_table_gc — TTL-based garbage collection (spec NR-RT-003)
  *
@@ -342,38 +1808,375 @@ int routing_table_gc(routing_table_t *rt, uint64_t now_ns)
 {
     if (!rt) return -1;
 
-    pthread_mutex_lock(&rt->write_lock);
+    struct routing_table_txn t;
+    txn_open(&t, rt);
+    int expired = txn_gc(&t, now_ns);
+    txn_close(&t, true);
+    return expired;
+}
+
+/* --------------------------------------------------------------------------
+ * Checkpoints
+ *
+ * Layout, all in host byte order:
+ *
+ *   rt_ckpt_header_t                      64 bytes
+ *   rt_ckpt_record_t[count]               72 bytes each
+ *   SAD blob                              blob_size bytes
+ *
+ * Records carry the matcher columns already decoded, so loading copies
+ * them into the snapshot's arrays and only the SAD itself is unpacked
+ * (into the entry, as every insert does).  The checksum field sits right
+ * after the magic so the summed range is one contiguous run to EOF.
+ * -------------------------------------------------------------------------- */
+
+#define RT_CKPT_MAGIC       "SRTCKPT"           /* 8 bytes with the NUL */
+#define RT_CKPT_VERSION     1u
+#define RT_CKPT_BYTE_ORDER  0x01020304u         /* reads swapped elsewhere */
+#define RT_CKPT_SUMMED_FROM 12u                 /* crc covers [12, EOF) */
+
+typedef struct {
+    char     magic[8];
+    uint32_t crc;
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t count;
+    uint32_t blob_size;
+    uint32_t reserved;
+    uint64_t saved_ns;          /* caller's clock at save */
+    uint64_t saved_wall_ns;     /* CLOCK_REALTIME at save */
+    uint64_t generation;
+} rt_ckpt_header_t;
+
+typedef struct {
+    uint8_t  node_id[16];
+    uint64_t last_updated;
+    uint64_t ttl_ns;
+    uint32_t latency_us;
+    float    load_factor;
+    uint32_t cost_milli;
+    uint32_t model_arch;        /* matcher columns, see snapshot_set_row */
+    uint32_t capability;
+    uint32_t context_window;
+    uint32_t sad_offset;        /* into the SAD blob */
+    uint16_t sad_length;
+    uint16_t region_code;
+    uint8_t  trust_level;
+    uint8_t  has;
+    uint8_t  reserved[6];
+} rt_ckpt_record_t;
+
+_Static_assert(sizeof(rt_ckpt_header_t) == 64, "checkpoint header is 64 bytes");
+_Static_assert(sizeof(rt_ckpt_record_t) == 72, "checkpoint record is 72 bytes");
+_Static_assert(offsetof(rt_ckpt_header_t, version) == RT_CKPT_SUMMED_FROM,
+               "checksum must precede every summed byte");
+
+static uint64_t wall_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
 
-    rt_snapshot_t *cur = atomic_load_explicit(&rt->current, memory_order_acquire);
+/* Serialise @s into one malloc'd buffer; *len receives its size.  Rows
+ * sharing a descriptor share its blob bytes. */
+static uint8_t *ckpt_serialise(const rt_snapshot_t *s, uint64_t generation,
+                               uint64_t now_ns, size_t *len)
+{
+    size_t head = sizeof(rt_ckpt_header_t) +
+                  (size_t)s->count * sizeof(rt_ckpt_record_t);
+    size_t cap  = head + SAD_MAX_SIZE;
+    uint8_t *buf = malloc(cap);
+    if (!buf) return NULL;
+
+    /* Descriptor -> blob offset, open addressing on the pointer */
+    uint32_t mask = 15;
+    while (mask + 1 < s->count * 2)
+        mask = mask * 2 + 1;
+    struct { const rt_caps_t *caps; uint32_t off; } *seen =
+        calloc(mask + 1, sizeof(*seen));
+    if (!seen) { free(buf); return NULL; }
+
+    size_t blob = 0;
+    for (uint32_t i = 0; i < s->count; i++) {
+        const rt_row_t *e = &s->rows[i];
+        const rt_caps_t *caps = e->caps;
+
+        uint32_t h = (uint32_t)(((uintptr_t)caps >> 4) * 2654435761u) & mask;
+        while (seen[h].caps && seen[h].caps != caps)
+            h = (h + 1) & mask;
+        if (!seen[h].caps) {
+            if (head + blob + caps->len > cap) {
+                uint8_t *nb = realloc(buf, cap * 2);
+                if (!nb) { free(seen); free(buf); return NULL; }
+                buf = nb;
+                cap *= 2;
+            }
+            memcpy(buf + head + blob, caps->bytes, caps->len);
+            seen[h].caps = caps;
+            seen[h].off  = (uint32_t)blob;
+            blob += caps->len;
+        }
+
+        rt_ckpt_record_t r;
+        memset(&r, 0, sizeof(r));
+        memcpy(r.node_id, e->node_id, sizeof(r.node_id));
+        r.last_updated   = e->last_updated;
+        r.ttl_ns         = e->ttl_ns;
+        r.latency_us     = atomic_load_explicit(&s->metrics.latency_us[i],
+                                                memory_order_relaxed);
+        r.load_factor    = atomic_load_explicit(&s->metrics.load_factor[i],
+                                                memory_order_relaxed);
+        r.cost_milli     = s->cols.cost_milli[i];
+        r.model_arch     = s->cols.model_arch[i];
+        r.capability     = s->cols.capability[i];
+        r.context_window = s->cols.context_window[i];
+        r.sad_offset     = seen[h].off;
+        r.sad_length     = caps->len;
+        r.region_code    = s->cols.region_code[i];
+        r.trust_level    = s->cols.trust_level[i];
+        r.has            = s->cols.has[i];
+        memcpy(buf + sizeof(rt_ckpt_header_t) + (size_t)i * sizeof(r), &r, sizeof(r));
+    }
+    free(seen);
+
+    rt_ckpt_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, RT_CKPT_MAGIC, sizeof(h.magic));
+    h.version       = RT_CKPT_VERSION;
+    h.byte_order    = RT_CKPT_BYTE_ORDER;
+    h.header_size   = sizeof(rt_ckpt_header_t);
+    h.record_size   = sizeof(rt_ckpt_record_t);
+    h.count         = s->count;
+    h.blob_size     = (uint32_t)blob;
+    h.saved_ns      = now_ns;
+    h.saved_wall_ns = wall_ns();
+    h.generation    = generation;
+    memcpy(buf, &h, sizeof(h));
+
+    *len = head + blob;
+    h.crc = strandlink_crc32c(buf + RT_CKPT_SUMMED_FROM,
+                              (uint32_t)(*len - RT_CKPT_SUMMED_FROM));
+    memcpy(buf + offsetof(rt_ckpt_header_t, crc), &h.crc, sizeof(h.crc));
+    return buf;
+}
 
-    /* Count how many entries will survive GC */
-    uint32_t survivors = 0;
-    for (uint32_t i = 0; i < cur->count; i++) {
-        const route_entry_t *e = &cur->entries[i];
-        if (e->ttl_ns == 0 || (now_ns - e->last_updated) <= e->ttl_ns)
-            survivors++;
+static int write_all(int fd, const uint8_t *p, size_t len)
+{
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p   += n;
+        len -= (size_t)n;
     }
+    return 0;
+}
 
-    int expired = (int)(cur->count - survivors);
-    if (expired == 0) {
-        pthread_mutex_unlock(&rt->write_lock);
-        return 0;
+int routing_table_checkpoint_save(const routing_table_t *rt,
+                                  const char *path, uint64_t now_ns)
+{
+    if (!rt || !path) { errno = EINVAL; return -1; }
+
+    /* Serialise inside the read section, do the I/O outside it */
+    rt_snapshot_t *snap = reader_acquire(rt);
+    if (!snap) { errno = ENOMEM; return -1; }
+    size_t len = 0;
+    uint32_t count = snap->count;
+    uint8_t *buf = ckpt_serialise(snap, snap->generation, now_ns, &len);
+    reader_release(snap);
+    if (!buf) { errno = ENOMEM; return -1; }
+    if (len > UINT32_MAX) { free(buf); errno = EFBIG; return -1; }
+
+    size_t plen = strlen(path);
+    char *tmp = malloc(plen + 5);
+    if (!tmp) { free(buf); errno = ENOMEM; return -1; }
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", 5);
+
+    int rc = -1;
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        rc = (write_all(fd, buf, len) == 0 && fsync(fd) == 0) ? 0 : -1;
+        if (close(fd) != 0)
+            rc = -1;
+        if (rc == 0)
+            rc = rename(tmp, path);
+        if (rc != 0) {
+            int saved = errno;
+            unlink(tmp);
+            errno = saved;
+        }
     }
+    free(tmp);
+    free(buf);
+    return rc == 0 ? (int)count : -1;
+}
 
-    /* Build a new snapshot containing only live entries */
-    rt_snapshot_t *next = snapshot_alloc(cur->capacity);
-    if (!next) {
-        pthread_mutex_unlock(&rt->write_lock);
+/* Header, sizes and checksum of a mapped checkpoint; 0 if usable */
+static int ckpt_verify(const uint8_t *map, size_t len)
+{
+    rt_ckpt_header_t h;
+    if (len < sizeof(h) || len > UINT32_MAX)
+        return -1;
+    memcpy(&h, map, sizeof(h));
+    if (memcmp(h.magic, RT_CKPT_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != RT_CKPT_VERSION ||
+        h.byte_order != RT_CKPT_BYTE_ORDER ||
+        h.header_size != sizeof(rt_ckpt_header_t) ||
+        h.record_size != sizeof(rt_ckpt_record_t))
         return -1;
+    if ((uint64_t)h.header_size + (uint64_t)h.count * h.record_size +
+        h.blob_size != len)
+        return -1;
+    if (strandlink_crc32c(map + RT_CKPT_SUMMED_FROM,
+                          (uint32_t)(len - RT_CKPT_SUMMED_FROM)) != h.crc)
+        return -1;
+    return 0;
+}
+
+/* Descriptors already interned for a blob offset this load; saves write
+ * each distinct descriptor once, so most rows hit */
+#define RT_CKPT_CACHE 256
+
+typedef struct {
+    rt_caps_t *caps[RT_CKPT_CACHE];
+    uint32_t   off[RT_CKPT_CACHE];
+} rt_ckpt_cache_t;
+
+static rt_caps_t *ckpt_caps(rt_snapshot_t *w, rt_ckpt_cache_t *cache,
+                            const uint8_t *blob, uint32_t off, uint16_t len)
+{
+    uint32_t slot = (off * 2654435761u) >> 24;
+    rt_caps_t *c = cache->caps[slot];
+    if (c && cache->off[slot] == off && c->len == len) {
+        caps_ref(w->pool, c);
+        return c;
     }
 
-    for (uint32_t i = 0; i < cur->count; i++) {
-        const route_entry_t *e = &cur->entries[i];
-        if (e->ttl_ns == 0 || (now_ns - e->last_updated) <= e->ttl_ns)
-            next->entries[next->count++] = *e;
+    /* Interned bytes must be exactly one SAD, as sad_encode writes */
+    sad_t sad;
+    if (sad_decode(blob + off, len, &sad) != (int)len)
+        return NULL;
+    c = caps_intern(w->pool, blob + off, len);
+    if (c) {
+        cache->caps[slot] = c;
+        cache->off[slot]  = off;
     }
+    return c;
+}
 
-    publish_and_reclaim(rt, next);
-    pthread_mutex_unlock(&rt->write_lock);
-    return expired;
+/* Append record @r as row w->count (the caller rebuilds the row map); -1 if
+ * its SAD does not decode */
+static int ckpt_load_row(rt_snapshot_t *w, rt_ckpt_cache_t *cache,
+                         const rt_ckpt_record_t *r,
+                         const uint8_t *blob, uint32_t blob_size,
+                         uint64_t last_updated)
+{
+    if ((uint64_t)r->sad_offset + r->sad_length > blob_size)
+        return -1;
+
+    uint32_t idx = w->count;
+    rt_row_t *e = &w->rows[idx];
+    e->caps = ckpt_caps(w, cache, blob, r->sad_offset, r->sad_length);
+    if (!e->caps)
+        return -1;
+    memcpy(e->node_id, r->node_id, sizeof(e->node_id));
+    e->last_updated = last_updated;
+    e->ttl_ns       = r->ttl_ns;
+
+    rt_columns_t *c = &w->cols;
+    c->model_arch[idx]     = r->model_arch;
+    c->capability[idx]     = r->capability;
+    c->context_window[idx] = r->context_window;
+    c->cost_milli[idx]     = r->cost_milli;
+    c->trust_level[idx]    = r->trust_level;
+    c->region_code[idx]    = r->region_code;
+    c->has[idx]            = r->has;
+    atomic_store_explicit(&w->metrics.latency_us[idx], r->latency_us,
+                          memory_order_relaxed);
+    atomic_store_explicit(&w->metrics.load_factor[idx], r->load_factor,
+                          memory_order_relaxed);
+
+    w->count++;
+    return 0;
+}
+
+int routing_table_checkpoint_load(routing_table_t *rt,
+                                  const char *path, uint64_t now_ns)
+{
+    if (!rt || !path) return -1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(rt_ckpt_header_t)) {
+        close(fd);
+        return -1;
+    }
+    size_t len = (size_t)st.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    const uint8_t *base = map;
+    if (ckpt_verify(base, len) != 0) {
+        munmap(map, len);
+        return -1;
+    }
+
+    rt_ckpt_header_t h;
+    memcpy(&h, base, sizeof(h));
+    const rt_ckpt_record_t *recs =
+        (const rt_ckpt_record_t *)(base + sizeof(rt_ckpt_header_t));
+    const uint8_t *blob = (const uint8_t *)(recs + h.count);
+
+    /* Time the entries spent on disk, counted against their TTLs */
+    uint64_t wall = wall_ns();
+    uint64_t down = wall > h.saved_wall_ns ? wall - h.saved_wall_ns : 0;
+
+    struct routing_table_txn t;
+    txn_open(&t, rt);
+    rt_snapshot_t *w = h.count ? txn_working(&t, h.count) : NULL;
+    uint32_t had = w ? w->count : 0;
+    int added = 0;
+    bool ok = h.count == 0 || w != NULL;
+    rt_ckpt_cache_t *cache = h.count ? calloc(1, sizeof(*cache)) : NULL;
+    if (h.count && !cache)
+        ok = false;
+
+    /* Rows only need checking against what was there before: the
+     * checkpoint itself came from a table, so its node_ids are unique */
+    for (uint32_t i = 0; ok && i < h.count; i++) {
+        const rt_ckpt_record_t *r = &recs[i];
+        uint64_t age = (h.saved_ns > r->last_updated
+                        ? h.saved_ns - r->last_updated : 0) + down;
+        if (r->ttl_ns && age > r->ttl_ns)
+            continue;
+        if (had && find_entry(w, r->node_id) >= 0)
+            continue;
+        if (ckpt_load_row(w, cache, r, blob, h.blob_size,
+                          now_ns > age ? now_ns - age : 0) != 0) {
+            ok = false;
+            break;
+        }
+        added++;
+    }
+
+    if (ok && added) {
+        snapshot_build_rowmap(w);
+        for (uint32_t i = had; i < w->count; i++) {
+            if (w->rows[i].ttl_ns)
+                ttl_note(rt, &w->rows[i]);
+        }
+    }
+    free(cache);
+    t.staged += (uint32_t)added;
+    txn_close(&t, ok && added > 0);
+    munmap(map, len);
+    return ok ? added : -1;
 }
@@ -6,10 +6,16 @@
  *     [version:1][flags:1][num_fields:2]
  *   Per field:
  *     [type:1][length:2][value:length]
+ *
+ * Encoding, decoding and validation share one walk over the fields each,
+ * and can fold the canonical hash into the same walk: every field is
+ * hashed on its own and the field hashes are summed, so the order of the
+ * fields does not matter.
  */
 
 #include "strandroute/sad.h"
 
+#include <stdbool.h>
 #include <string.h>
 
 /* --------------------------------------------------------------------------
@@ -49,6 +55,83 @@ static inline uint32_t get_be32(const uint8_t *p)
 #define SAD_HEADER_SIZE  4
 #define SAD_FIELD_HDR    3
 
+/* Frame option header: type(1) + length(1) */
+#define SAD_OPT_HDR      2
+
+/* --------------------------------------------------------------------------
+ * Canonical hash
+ * -------------------------------------------------------------------------- */
+
+static inline uint64_t sad_mix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/* Little-endian load of up to 8 bytes, zero-padded: the same value on
+ * every host, so hashes can be compared across nodes */
+static inline uint64_t sad_load_le(const uint8_t *p, size_t n)
+{
+    uint64_t w = 0;
+    for (size_t i = 0; i < n; i++)
+        w |= (uint64_t)p[i] << (8 * i);
+    return w;
+}
+
+/* Eight bytes per step; well mixed before summing, so fields cannot
+ * cancel each other out.  The length is hashed first, so zero padding
+ * is unambiguous. */
+static uint64_t sad_field_hash(uint8_t type, const uint8_t *value, uint16_t len)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ ((uint64_t)type << 16 | len);
+    uint16_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        h ^= sad_load_le(value + i, 8) * 0x87C37B91114253D5ull;
+        h = ((h << 27) | (h >> 37)) * 5 + 0x52DCE729u;
+    }
+    if (i < len) {
+        h ^= sad_load_le(value + i, (size_t)(len - i)) * 0x87C37B91114253D5ull;
+        h = ((h << 27) | (h >> 37)) * 5 + 0x52DCE729u;
+    }
+    return sad_mix64(h);
+}
+
+static inline uint64_t sad_hash_finish(uint64_t sum, uint8_t version,
+                                       uint8_t flags, uint16_t num_fields)
+{
+    return sad_mix64(sum + (((uint64_t)version << 24) |
+                            ((uint64_t)flags << 16) | num_fields));
+}
+
+/* Lengths the known field types must have */
+static bool sad_field_len_ok(uint8_t type, uint16_t len)
+{
+    switch (type) {
+    case SAD_FIELD_MODEL_ARCH:
+    case SAD_FIELD_CAPABILITY:
+    case SAD_FIELD_CONTEXT_WINDOW:
+    case SAD_FIELD_MAX_LATENCY_MS:
+    case SAD_FIELD_MAX_COST_MILLI:
+    case SAD_FIELD_MIN_BENCHMARK:
+        return len == 4;
+    case SAD_FIELD_TRUST_LEVEL:
+        return len == 1;
+    case SAD_FIELD_PUBLISHER_ID:
+        return len == 16;
+    case SAD_FIELD_REGION_PREFER:
+    case SAD_FIELD_REGION_EXCLUDE:
+        return len != 0 && (len % 2) == 0;
+    default:
+        /* Custom: any length.  Unknown: skip but don't reject (forward
+         * compat) */
+        return true;
+    }
+}
+
 /* --------------------------------------------------------------------------
  * sad_init
  * -------------------------------------------------------------------------- */
@@ -149,154 +232,338 @@ uint8_t sad_get_uint8(const sad_t *sad, sad_field_type_t type)
 }
 
 /* --------------------------------------------------------------------------
- * sad_encode
+ * sad_encode / sad_encode_option
+ *
+ * One pass: the header goes first (its field count is known), then each
+ * field after a bounds check against @cap.
  * -------------------------------------------------------------------------- */
 
-int sad_encode(const sad_t *sad, uint8_t *buf, size_t buf_len)
+static int sad_emit(const sad_t *sad, uint8_t *buf, size_t cap, uint64_t *hash)
 {
-    if (!sad || !buf)
+    if (cap > SAD_MAX_SIZE)
+        cap = SAD_MAX_SIZE;
+    if (cap < SAD_HEADER_SIZE || sad->num_fields > SAD_MAX_FIELDS)
         return -1;
 
-    /* Calculate total size */
-    size_t total = SAD_HEADER_SIZE;
-    for (uint16_t i = 0; i < sad->num_fields; i++) {
-        total += SAD_FIELD_HDR + sad->fields[i].length;
-    }
-
-    if (total > buf_len || total > SAD_MAX_SIZE)
-        return -1;
-
-    /* Write header */
     size_t off = 0;
     buf[off++] = sad->version;
     buf[off++] = sad->flags;
     put_be16(&buf[off], sad->num_fields);
     off += 2;
 
-    /* Write each field */
+    uint64_t sum = 0;
     for (uint16_t i = 0; i < sad->num_fields; i++) {
         const sad_field_t *f = &sad->fields[i];
+        if (f->length > SAD_MAX_FIELD_VALUE ||
+            off + SAD_FIELD_HDR + f->length > cap)
+            return -1;
         buf[off++] = (uint8_t)f->type;
         put_be16(&buf[off], f->length);
         off += 2;
         memcpy(&buf[off], f->value, f->length);
         off += f->length;
+        if (hash)
+            sum += sad_field_hash((uint8_t)f->type, f->value, f->length);
     }
 
+    if (hash)
+        *hash = sad_hash_finish(sum, sad->version, sad->flags, sad->num_fields);
     return (int)off;
 }
 
-/* --------------------------------------------------------------------------
- * sad_decode
- * -------------------------------------------------------------------------- */
-
-int sad_decode(const uint8_t *buf, size_t buf_len, sad_t *sad)
+int sad_encode(const sad_t *sad, uint8_t *buf, size_t buf_len)
 {
-    if (!buf || !sad)
-        return -1;
-    if (buf_len < SAD_HEADER_SIZE)
+    if (!sad || !buf)
         return -1;
+    return sad_emit(sad, buf, buf_len, NULL);
+}
 
-    memset(sad, 0, sizeof(*sad));
-
-    size_t off = 0;
-    sad->version = buf[off++];
-    sad->flags   = buf[off++];
-    sad->num_fields = get_be16(&buf[off]);
-    off += 2;
-
-    if (sad->version != SAD_VERSION)
-        return -1;
-    if (sad->num_fields > SAD_MAX_FIELDS)
+int sad_encode_option(const sad_t *sad, uint8_t *opts, size_t opts_len,
+                      uint64_t *hash)
+{
+    if (!sad || !opts || opts_len < SAD_OPT_HDR)
         return -1;
 
-    for (uint16_t i = 0; i < sad->num_fields; i++) {
-        if (off + SAD_FIELD_HDR > buf_len)
-            return -1;
-
-        sad_field_t *f = &sad->fields[i];
-        f->type   = (sad_field_type_t)buf[off++];
-        f->length = get_be16(&buf[off]);
-        off += 2;
-
-        if (f->length > SAD_MAX_FIELD_VALUE)
-            return -1;
-        if (off + f->length > buf_len)
-            return -1;
+    size_t cap = opts_len - SAD_OPT_HDR;
+    if (cap > SAD_OPT_MAX_LEN)
+        cap = SAD_OPT_MAX_LEN;
+    int n = sad_emit(sad, opts + SAD_OPT_HDR, cap, hash);
+    if (n < 0)
+        return -1;
+    opts[0] = STRANDLINK_OPT_SEMANTIC_ADDR;
+    opts[1] = (uint8_t)n;
+    return SAD_OPT_HDR + n;
+}
 
-        memcpy(f->value, &buf[off], f->length);
-        off += f->length;
+const uint8_t *sad_option_find(const uint8_t *opts, size_t opts_len,
+                               uint16_t *sad_len)
+{
+    if (!opts)
+        return NULL;
+    size_t off = 0;
+    while (off + SAD_OPT_HDR <= opts_len) {
+        uint8_t len = opts[off + 1];
+        if (off + SAD_OPT_HDR + len > opts_len)
+            return NULL;            /* truncated */
+        if (opts[off] == STRANDLINK_OPT_SEMANTIC_ADDR) {
+            if (sad_len) *sad_len = len;
+            return opts + off + SAD_OPT_HDR;
+        }
+        off += SAD_OPT_HDR + len;
     }
-
-    sad->total_length = (uint16_t)off;
-    return (int)off;
+    return NULL;
 }
 
 /* --------------------------------------------------------------------------
- * sad_validate
+ * sad_parse
+ *
+ * The walk behind sad_decode, sad_validate and sad_decode_validated:
+ * structure checks always, known field lengths when @strict, a sad_t and
+ * the canonical hash when asked for.  Returns the bytes covered or one
+ * of sad_validate's negative codes.
  * -------------------------------------------------------------------------- */
 
-int sad_validate(const uint8_t *buf, size_t buf_len)
+static int sad_parse(const uint8_t *buf, size_t buf_len, bool strict,
+                     sad_t *out, uint64_t *hash)
 {
-    if (!buf || buf_len < SAD_HEADER_SIZE)
+    if (buf_len < SAD_HEADER_SIZE)
         return -1;
 
-    uint8_t version = buf[0];
+    uint8_t  version    = buf[0];
+    uint8_t  flags      = buf[1];
+    uint16_t num_fields = get_be16(&buf[2]);
+    if (out) {
+        memset(out, 0, sizeof(*out));
+        out->version    = version;
+        out->flags      = flags;
+        out->num_fields = num_fields;
+    }
+
     if (version != SAD_VERSION)
         return -2;
-
-    uint16_t num_fields = get_be16(&buf[2]);
     if (num_fields > SAD_MAX_FIELDS)
         return -3;
 
+    uint64_t sum = 0;
     size_t off = SAD_HEADER_SIZE;
     for (uint16_t i = 0; i < num_fields; i++) {
         if (off + SAD_FIELD_HDR > buf_len)
             return -4;
 
-        uint8_t ftype = buf[off];
-        uint16_t flen = get_be16(&buf[off + 1]);
+        uint8_t  ftype = buf[off];
+        uint16_t flen  = get_be16(&buf[off + 1]);
         off += SAD_FIELD_HDR;
 
         if (flen > SAD_MAX_FIELD_VALUE)
             return -5;
         if (off + flen > buf_len)
             return -6;
+        if (strict && !sad_field_len_ok(ftype, flen))
+            return -7;
+
+        if (out) {
+            sad_field_t *f = &out->fields[i];
+            f->type   = (sad_field_type_t)ftype;
+            f->length = flen;
+            memcpy(f->value, &buf[off], flen);
+        }
+        if (hash)
+            sum += sad_field_hash(ftype, &buf[off], flen);
+        off += flen;
+    }
+
+    if (out)
+        out->total_length = (uint16_t)off;
+    if (hash)
+        *hash = sad_hash_finish(sum, version, flags, num_fields);
+    return (int)off;
+}
 
-        /* Validate known field lengths */
-        switch (ftype) {
-        case SAD_FIELD_MODEL_ARCH:
-        case SAD_FIELD_CAPABILITY:
-        case SAD_FIELD_CONTEXT_WINDOW:
-        case SAD_FIELD_MAX_LATENCY_MS:
-        case SAD_FIELD_MAX_COST_MILLI:
-        case SAD_FIELD_MIN_BENCHMARK:
-            if (flen != 4)
-                return -7;
-            break;
-        case SAD_FIELD_TRUST_LEVEL:
-            if (flen != 1)
-                return -7;
-            break;
-        case SAD_FIELD_PUBLISHER_ID:
-            if (flen != 16)
-                return -7;
-            break;
-        case SAD_FIELD_REGION_PREFER:
-        case SAD_FIELD_REGION_EXCLUDE:
-            if (flen == 0 || (flen % 2) != 0)
-                return -7;
-            break;
-        case SAD_FIELD_CUSTOM:
-            /* Any length is valid for custom */
-            break;
-        default:
-            /* Unknown type - skip but don't reject (forward compat) */
-            break;
+/* --------------------------------------------------------------------------
+ * sad_decode / sad_validate / sad_decode_validated / sad_decode_batch
+ * -------------------------------------------------------------------------- */
+
+int sad_decode(const uint8_t *buf, size_t buf_len, sad_t *sad)
+{
+    if (!buf || !sad)
+        return -1;
+    int n = sad_parse(buf, buf_len, false, sad, NULL);
+    return n < 0 ? -1 : n;
+}
+
+int sad_validate(const uint8_t *buf, size_t buf_len)
+{
+    if (!buf)
+        return -1;
+    int n = sad_parse(buf, buf_len, true, NULL, NULL);
+    return n < 0 ? n : 0;
+}
+
+int sad_decode_validated(const uint8_t *buf, size_t buf_len, sad_t *sad,
+                         uint64_t *hash)
+{
+    if (!buf || !sad)
+        return -1;
+    int n = sad_parse(buf, buf_len, true, sad, hash);
+    return n < 0 ? -1 : n;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SAD_PREFETCH(p)  __builtin_prefetch((p), 0, 3)
+#else
+#define SAD_PREFETCH(p)  ((void)(p))
+#endif
+
+int sad_decode_batch(const sad_span_t *in, int count, sad_t *const *out,
+                     uint64_t *hashes)
+{
+    if (!in || !out || count < 0)
+        return -1;
+
+    int ok = 0;
+    for (int i = 0; i < count; i++) {
+        if (i + 1 < count)
+            SAD_PREFETCH(in[i + 1].buf);
+
+        uint64_t h = 0;
+        int n = in[i].buf ? sad_parse(in[i].buf, in[i].len, true, out[i],
+                                      hashes ? &h : NULL)
+                          : -1;
+        if (n >= 0 && (size_t)n == in[i].len) {
+            ok++;
+        } else {
+            sad_init(out[i]);       /* total_length 0 marks the failure */
+            h = 0;
         }
+        if (hashes)
+            hashes[i] = h;
+    }
+    return ok;
+}
 
-        off += flen;
+/* --------------------------------------------------------------------------
+ * sad_hash / sad_view_hash
+ * -------------------------------------------------------------------------- */
+
+uint64_t sad_hash(const sad_t *sad)
+{
+    if (!sad)
+        return 0;
+    uint64_t sum = 0;
+    for (uint16_t i = 0; i < sad->num_fields && i < SAD_MAX_FIELDS; i++) {
+        const sad_field_t *f = &sad->fields[i];
+        uint16_t len = f->length <= SAD_MAX_FIELD_VALUE ? f->length
+                                                        : SAD_MAX_FIELD_VALUE;
+        sum += sad_field_hash((uint8_t)f->type, f->value, len);
     }
+    return sad_hash_finish(sum, sad->version, sad->flags, sad->num_fields);
+}
 
-    return 0;
+uint64_t sad_view_hash(const sad_view_t *view)
+{
+    if (!view)
+        return 0;
+    uint64_t sum = 0;
+    for (uint16_t i = 0; i < view->num_fields; i++) {
+        const uint8_t *p = &view->buf[view->field_off[i]];
+        sum += sad_field_hash(p[0], p + SAD_FIELD_HDR, get_be16(&p[1]));
+    }
+    return sad_hash_finish(sum, view->version, view->flags, view->num_fields);
+}
+
+/* --------------------------------------------------------------------------
+ * sad_view_init
+ *
+ * Same structural checks as sad_decode, in the same order, but only the
+ * field offsets are recorded.
+ * -------------------------------------------------------------------------- */
+
+int sad_view_init(sad_view_t *view, const uint8_t *buf, size_t buf_len)
+{
+    if (!buf || !view)
+        return -1;
+    if (buf_len < SAD_HEADER_SIZE)
+        return -1;
+
+    view->buf        = buf;
+    view->length     = 0;
+    view->version    = buf[0];
+    view->flags      = buf[1];
+    view->num_fields = get_be16(&buf[2]);
+
+    if (view->version != SAD_VERSION)
+        return -1;
+    if (view->num_fields > SAD_MAX_FIELDS)
+        return -1;
+
+    size_t off = SAD_HEADER_SIZE;
+    for (uint16_t i = 0; i < view->num_fields; i++) {
+        if (off + SAD_FIELD_HDR > buf_len)
+            return -1;
+
+        uint16_t flen = get_be16(&buf[off + 1]);
+        if (flen > SAD_MAX_FIELD_VALUE)
+            return -1;
+        if (off + SAD_FIELD_HDR + flen > buf_len)
+            return -1;
+
+        view->field_off[i] = (uint16_t)off;
+        off += SAD_FIELD_HDR + flen;
+    }
+
+    view->length = (uint16_t)off;
+    return (int)off;
+}
+
+/* --------------------------------------------------------------------------
+ * sad_view_field / sad_view_find_field
+ * -------------------------------------------------------------------------- */
+
+const uint8_t *sad_view_field(const sad_view_t *view, uint16_t index,
+                              sad_field_type_t *type, uint16_t *length)
+{
+    if (!view || index >= view->num_fields)
+        return NULL;
+
+    const uint8_t *p = &view->buf[view->field_off[index]];
+    if (type)   *type   = (sad_field_type_t)p[0];
+    if (length) *length = get_be16(&p[1]);
+    return p + SAD_FIELD_HDR;
+}
+
+const uint8_t *sad_view_find_field(const sad_view_t *view,
+                                   sad_field_type_t type, uint16_t *length)
+{
+    if (!view)
+        return NULL;
+    for (uint16_t i = 0; i < view->num_fields; i++) {
+        const uint8_t *p = &view->buf[view->field_off[i]];
+        if (p[0] == (uint8_t)type) {
+            if (length) *length = get_be16(&p[1]);
+            return p + SAD_FIELD_HDR;
+        }
+    }
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------
+ * sad_view_get_uint32 / sad_view_get_uint8
+ * -------------------------------------------------------------------------- */
+
+uint32_t sad_view_get_uint32(const sad_view_t *view, sad_field_type_t type)
+{
+    uint16_t len;
+    const uint8_t *v = sad_view_find_field(view, type, &len);
+    if (!v || len < 4)
+        return 0;
+    return get_be32(v);
+}
+
+uint8_t sad_view_get_uint8(const sad_view_t *view, sad_field_type_t type)
+{
+    uint16_t len;
+    const uint8_t *v = sad_view_find_field(view, type, &len);
+    if (!v || len < 1)
+        return 0;
+    return v[0];
 }
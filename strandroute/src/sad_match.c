@@ -3,14 +3,24 @@
  *
  * Scores a candidate route_entry against a SAD query using weighted
  * multi-constraint scoring per the StrandRoute spec (Section 4.3).
+ *
+ * The query is compiled once (sad_query_compile) so the per-candidate
+ * work is a handful of integer compares on pre-extracted fields, whether
+ * those come from a route_entry_t or from a snapshot's column arrays.
  */
 
+#include "strandroute/sad_match.h"
 #include "strandroute/sad.h"
 #include "strandroute/types.h"
 
 #include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
 
+/* Rows scored per sad_score_batch call in the top-K scans */
+#define SAD_SCORE_BLOCK  256
+
 /* --------------------------------------------------------------------------
  * Byte-order helpers
  * -------------------------------------------------------------------------- */
@@ -46,30 +56,186 @@ static inline int popcount32(uint32_t x)
  * Field extraction helpers
  * -------------------------------------------------------------------------- */
 
-static uint32_t field_get_u32(const sad_field_t *f)
+static uint32_t value_get_u32(const uint8_t *v, uint16_t len)
 {
-    if (!f || f->length < 4) return 0;
-    return get_be32(f->value);
+    if (!v || len < 4) return 0;
+    return get_be32(v);
 }
 
-static uint8_t field_get_u8(const sad_field_t *f)
+static uint32_t field_get_u32(const sad_field_t *f)
 {
-    if (!f || f->length < 1) return 0;
-    return f->value[0];
+    return f ? value_get_u32(f->value, f->length) : 0;
 }
 
-/* Check if a region code appears in a region list field */
-static bool region_in_field(uint16_t region, const sad_field_t *f)
+/* Copy a region list value into a compiled region array */
+static uint8_t value_get_regions(const uint8_t *v, uint16_t len, uint16_t *out)
 {
-    if (!f || f->length < 2) return false;
-    uint16_t count = f->length / 2;
+    if (!v || len < 2) return 0;
+    uint16_t count = len / 2;
+    if (count > SAD_QUERY_MAX_REGIONS) count = SAD_QUERY_MAX_REGIONS;
     for (uint16_t i = 0; i < count; i++) {
-        if (get_be16(&f->value[i * 2]) == region)
+        out[i] = get_be16(&v[i * 2]);
+    }
+    return (uint8_t)count;
+}
+
+static bool region_in_list(uint16_t region, const uint16_t *list, uint8_t n)
+{
+    for (uint8_t i = 0; i < n; i++) {
+        if (list[i] == region)
             return true;
     }
     return false;
 }
 
+/* --------------------------------------------------------------------------
+ * sad_query_compile - decode the query's constraints once per lookup
+ * -------------------------------------------------------------------------- */
+
+/*
+ * Fold one query field into @out.  @seen tracks the field types already
+ * consumed so that only the first occurrence of each type counts, as with
+ * sad_find_field; both the sad_t and the wire-view compilers go through
+ * here so they cannot drift apart.
+ */
+static void compile_field(sad_query_t *out, uint32_t *seen, unsigned type,
+                          const uint8_t *v, uint16_t len)
+{
+    if (type < SAD_FIELD_MODEL_ARCH || type > SAD_FIELD_REGION_EXCLUDE)
+        return;
+    if (*seen & (1u << type))
+        return;
+    *seen |= 1u << type;
+
+    switch ((sad_field_type_t)type) {
+    case SAD_FIELD_MODEL_ARCH:
+        out->present   |= SAD_Q_MODEL_ARCH;
+        out->model_arch = value_get_u32(v, len);
+        break;
+    case SAD_FIELD_CAPABILITY:
+        /* A zero capability mask is no constraint at all */
+        out->capability = value_get_u32(v, len);
+        if (out->capability != 0) {
+            out->present       |= SAD_Q_CAPABILITY;
+            out->cap_popcount_f = (float)popcount32(out->capability);
+        }
+        break;
+    case SAD_FIELD_CONTEXT_WINDOW:
+        out->present       |= SAD_Q_CONTEXT_WINDOW;
+        out->context_window = value_get_u32(v, len);
+        break;
+    case SAD_FIELD_MAX_LATENCY_MS:
+        out->present       |= SAD_Q_MAX_LATENCY;
+        out->max_latency_ms = value_get_u32(v, len);
+        out->max_latency_f  = (float)out->max_latency_ms;
+        break;
+    case SAD_FIELD_MAX_COST_MILLI:
+        out->present       |= SAD_Q_MAX_COST;
+        out->max_cost_milli = value_get_u32(v, len);
+        out->max_cost_f     = (float)out->max_cost_milli;
+        break;
+    case SAD_FIELD_TRUST_LEVEL:
+        out->present    |= SAD_Q_TRUST_LEVEL;
+        out->trust_level = len >= 1 ? v[0] : 0;
+        break;
+    case SAD_FIELD_REGION_PREFER:
+        out->present   |= SAD_Q_REGION_PREFER;
+        out->num_prefer = value_get_regions(v, len, out->region_prefer);
+        break;
+    case SAD_FIELD_REGION_EXCLUDE:
+        out->present    |= SAD_Q_REGION_EXCLUDE;
+        out->num_exclude = value_get_regions(v, len, out->region_exclude);
+        break;
+    default:
+        break;
+    }
+}
+
+void sad_query_compile(const sad_t *query, sad_query_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!query) return;
+
+    out->wildcard = (query->num_fields == 0);
+
+    uint32_t seen = 0;
+    for (uint16_t i = 0; i < query->num_fields; i++) {
+        const sad_field_t *f = &query->fields[i];
+        compile_field(out, &seen, (unsigned)f->type, f->value, f->length);
+    }
+}
+
+void sad_query_compile_view(const sad_view_t *view, sad_query_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!view) return;
+
+    out->wildcard = (view->num_fields == 0);
+
+    /* Walk the TLV headers recorded by sad_view_init; values stay in place */
+    uint32_t seen = 0;
+    for (uint16_t i = 0; i < view->num_fields; i++) {
+        const uint8_t *p = &view->buf[view->field_off[i]];
+        compile_field(out, &seen, p[0], p + 3, get_be16(&p[1]));
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Candidate features - the scored subset of a route entry
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    uint8_t  has;            /* SAD_COL_HAS_* */
+    uint32_t model_arch;
+    uint32_t capability;
+    uint32_t context_window;
+    uint32_t latency_us;
+    uint32_t cost_milli;
+    uint8_t  trust_level;
+    uint16_t region_code;
+} candidate_t;
+
+static void candidate_from_entry(const route_entry_t *e, candidate_t *c)
+{
+    const sad_t *cs = &e->capabilities;
+    const sad_field_t *f;
+
+    c->has = 0;
+    c->model_arch = c->capability = c->context_window = 0;
+
+    if ((f = sad_find_field(cs, SAD_FIELD_MODEL_ARCH)) != NULL) {
+        c->has       |= SAD_COL_HAS_MODEL_ARCH;
+        c->model_arch = field_get_u32(f);
+    }
+    if ((f = sad_find_field(cs, SAD_FIELD_CAPABILITY)) != NULL) {
+        c->has       |= SAD_COL_HAS_CAPABILITY;
+        c->capability = field_get_u32(f);
+    }
+    if ((f = sad_find_field(cs, SAD_FIELD_CONTEXT_WINDOW)) != NULL) {
+        c->has           |= SAD_COL_HAS_CONTEXT_WINDOW;
+        c->context_window = field_get_u32(f);
+    }
+
+    c->latency_us  = e->latency_us;
+    c->cost_milli  = e->cost_milli;
+    c->trust_level = e->trust_level;
+    c->region_code = e->region_code;
+}
+
+static void candidate_from_row(const sad_columns_t *cols, uint32_t row,
+                               candidate_t *c)
+{
+    c->has            = cols->has[row];
+    c->model_arch     = cols->model_arch[row];
+    c->capability     = cols->capability[row];
+    c->context_window = cols->context_window[row];
+    c->latency_us     = atomic_load_explicit(&cols->latency_us[row],
+                                             memory_order_relaxed);
+    c->cost_milli     = cols->cost_milli[row];
+    c->trust_level    = cols->trust_level[row];
+    c->region_code    = cols->region_code[row];
+}
+
 /* --------------------------------------------------------------------------
  * Per-field match functions
  * -------------------------------------------------------------------------- */
@@ -78,57 +244,37 @@ static bool region_in_field(uint16_t region, const sad_field_t *f)
  * MODEL_ARCH: exact match -- 1.0 if equal, 0.0 otherwise.
  * If query does not specify, score is 1.0 (no constraint).
  */
-static float match_model_arch(const sad_t *query, const sad_t *candidate)
+static float match_model_arch(const sad_query_t *q, const candidate_t *c)
 {
-    const sad_field_t *qf = sad_find_field(query, SAD_FIELD_MODEL_ARCH);
-    if (!qf) return 1.0f;  /* no constraint */
-
-    const sad_field_t *cf = sad_find_field(candidate, SAD_FIELD_MODEL_ARCH);
-    if (!cf) return 0.0f;  /* query requires, candidate doesn't have */
+    if (!(q->present & SAD_Q_MODEL_ARCH)) return 1.0f;  /* no constraint */
+    if (!(c->has & SAD_COL_HAS_MODEL_ARCH)) return 0.0f;  /* required, absent */
 
-    return (field_get_u32(qf) == field_get_u32(cf)) ? 1.0f : 0.0f;
+    return (q->model_arch == c->model_arch) ? 1.0f : 0.0f;
 }
 
 /*
  * CAPABILITY: popcount(candidate & query) / popcount(query)
  * Measures what fraction of required capabilities are present.
+ * A candidate without a CAPABILITY field carries 0 and scores 0.0.
  */
-static float match_capability(const sad_t *query, const sad_t *candidate)
+static float match_capability(const sad_query_t *q, const candidate_t *c)
 {
-    const sad_field_t *qf = sad_find_field(query, SAD_FIELD_CAPABILITY);
-    if (!qf) return 1.0f;
-
-    uint32_t q_caps = field_get_u32(qf);
-    if (q_caps == 0) return 1.0f;
+    if (!(q->present & SAD_Q_CAPABILITY)) return 1.0f;
 
-    const sad_field_t *cf = sad_find_field(candidate, SAD_FIELD_CAPABILITY);
-    if (!cf) return 0.0f;
-
-    uint32_t c_caps = field_get_u32(cf);
-    uint32_t matched = c_caps & q_caps;
-
-    int q_pop = popcount32(q_caps);
-    int m_pop = popcount32(matched);
-
-    return (float)m_pop / (float)q_pop;
+    uint32_t matched = c->capability & q->capability;
+    return (float)popcount32(matched) / q->cap_popcount_f;
 }
 
 /*
  * CONTEXT_WINDOW: hard constraint.
  * 1.0 if candidate >= query, 0.0 otherwise.
  */
-static float match_context_window(const sad_t *query, const sad_t *candidate)
+static float match_context_window(const sad_query_t *q, const candidate_t *c)
 {
-    const sad_field_t *qf = sad_find_field(query, SAD_FIELD_CONTEXT_WINDOW);
-    if (!qf) return 1.0f;
+    if (!(q->present & SAD_Q_CONTEXT_WINDOW)) return 1.0f;
+    if (!(c->has & SAD_COL_HAS_CONTEXT_WINDOW)) return 0.0f;
 
-    const sad_field_t *cf = sad_find_field(candidate, SAD_FIELD_CONTEXT_WINDOW);
-    if (!cf) return 0.0f;
-
-    uint32_t q_ctx = field_get_u32(qf);
-    uint32_t c_ctx = field_get_u32(cf);
-
-    return (c_ctx >= q_ctx) ? 1.0f : 0.0f;
+    return (c->context_window >= q->context_window) ? 1.0f : 0.0f;
 }
 
 /*
@@ -136,31 +282,25 @@ static float match_context_window(const sad_t *query, const sad_t *candidate)
  * Uses the route entry's measured latency_us (converted to ms) against
  * the query's MAX_LATENCY_MS constraint.
  */
-static float match_latency(const sad_t *query, uint32_t candidate_latency_us)
+static float match_latency(const sad_query_t *q, uint32_t candidate_latency_us)
 {
-    const sad_field_t *qf = sad_find_field(query, SAD_FIELD_MAX_LATENCY_MS);
-    if (!qf) return 1.0f;
-
-    uint32_t max_ms = field_get_u32(qf);
-    if (max_ms == 0) return 0.0f;
+    if (!(q->present & SAD_Q_MAX_LATENCY)) return 1.0f;
+    if (q->max_latency_ms == 0) return 0.0f;
 
     float cand_ms = (float)candidate_latency_us / 1000.0f;
-    float score = 1.0f - (cand_ms / (float)max_ms);
+    float score = 1.0f - (cand_ms / q->max_latency_f);
     return (score > 0.0f) ? score : 0.0f;
 }
 
 /*
  * COST: max(0, 1.0 - (candidate_cost / query_max_cost))
  */
-static float match_cost(const sad_t *query, uint32_t candidate_cost_milli)
+static float match_cost(const sad_query_t *q, uint32_t candidate_cost_milli)
 {
-    const sad_field_t *qf = sad_find_field(query, SAD_FIELD_MAX_COST_MILLI);
-    if (!qf) return 1.0f;
+    if (!(q->present & SAD_Q_MAX_COST)) return 1.0f;
+    if (q->max_cost_milli == 0) return 0.0f;
 
-    uint32_t max_cost = field_get_u32(qf);
-    if (max_cost == 0) return 0.0f;
-
-    float score = 1.0f - ((float)candidate_cost_milli / (float)max_cost);
+    float score = 1.0f - ((float)candidate_cost_milli / q->max_cost_f);
     return (score > 0.0f) ? score : 0.0f;
 }
 
@@ -168,99 +308,83 @@ static float match_cost(const sad_t *query, uint32_t candidate_cost_milli)
  * TRUST_LEVEL: hard constraint.
  * 1.0 if candidate >= query, 0.0 otherwise.
  */
-static float match_trust(const sad_t *query, uint8_t candidate_trust)
+static float match_trust(const sad_query_t *q, uint8_t candidate_trust)
 {
-    const sad_field_t *qf = sad_find_field(query, SAD_FIELD_TRUST_LEVEL);
-    if (!qf) return 1.0f;
+    if (!(q->present & SAD_Q_TRUST_LEVEL)) return 1.0f;
 
-    uint8_t required = field_get_u8(qf);
-    return (candidate_trust >= required) ? 1.0f : 0.0f;
+    return (candidate_trust >= q->trust_level) ? 1.0f : 0.0f;
 }
 
 /*
  * REGION_PREFER: 1.0 if candidate's region is in preferred list, 0.5 otherwise.
  */
-static float match_region_prefer(const sad_t *query, uint16_t candidate_region)
+static float match_region_prefer(const sad_query_t *q, uint16_t candidate_region)
 {
-    const sad_field_t *qf = sad_find_field(query, SAD_FIELD_REGION_PREFER);
-    if (!qf) return 1.0f;
+    if (!(q->present & SAD_Q_REGION_PREFER)) return 1.0f;
 
-    return region_in_field(candidate_region, qf) ? 1.0f : 0.5f;
+    return region_in_list(candidate_region, q->region_prefer, q->num_prefer)
+               ? 1.0f : 0.5f;
 }
 
 /*
  * REGION_EXCLUDE: hard constraint.
  * Returns -INFINITY if candidate's region is in exclude list, 1.0 otherwise.
  */
-static float match_region_exclude(const sad_t *query, uint16_t candidate_region)
+static float match_region_exclude(const sad_query_t *q, uint16_t candidate_region)
 {
-    const sad_field_t *qf = sad_find_field(query, SAD_FIELD_REGION_EXCLUDE);
-    if (!qf) return 1.0f;
+    if (!(q->present & SAD_Q_REGION_EXCLUDE)) return 1.0f;
 
-    return region_in_field(candidate_region, qf) ? -INFINITY : 1.0f;
+    return region_in_list(candidate_region, q->region_exclude, q->num_exclude)
+               ? -INFINITY : 1.0f;
 }
 
 /* --------------------------------------------------------------------------
- * sad_match_score - Compute composite match score
+ * score_candidate - Compute composite match score
  *
  * Returns a float in [0.0, 1.0] (or negative if a hard constraint
  * is violated, which means the candidate is disqualified).
  * -------------------------------------------------------------------------- */
 
-float sad_match_score(const sad_t *query, const route_entry_t *candidate,
-                      const scoring_weights_t *weights)
+static float score_candidate(const sad_query_t *q, const candidate_t *c,
+                             const scoring_weights_t *w)
 {
-    if (!query || !candidate)
-        return -1.0f;
-
-    scoring_weights_t w;
-    if (weights) {
-        w = *weights;
-    } else {
-        w = scoring_weights_default();
-    }
-
-    const sad_t *cand_sad = &candidate->capabilities;
-
     /* Wildcard: zero-field query matches everything with score 1.0 */
-    if (query->num_fields == 0)
+    if (q->wildcard)
         return 1.0f;
 
     /* Hard constraints: check first, reject immediately */
-    float ctx_score = match_context_window(query, cand_sad);
+    float ctx_score = match_context_window(q, c);
     if (ctx_score <= 0.0f)
         return -1.0f;
 
-    float trust_score = match_trust(query, candidate->trust_level);
+    float trust_score = match_trust(q, c->trust_level);
     if (trust_score <= 0.0f)
         return -1.0f;
 
-    float region_excl = match_region_exclude(query, candidate->region_code);
+    float region_excl = match_region_exclude(q, c->region_code);
     if (region_excl < 0.0f)
         return -1.0f;
 
+    /* Model arch mismatch is a hard reject */
+    if (match_model_arch(q, c) <= 0.0f)
+        return -1.0f;
+
     /* Soft constraints: weighted sum */
-    float arch_score  = match_model_arch(query, cand_sad);
-    float cap_score   = match_capability(query, cand_sad);
-    float lat_score   = match_latency(query, candidate->latency_us);
-    float cost_score  = match_cost(query, candidate->cost_milli);
-    float region_pref = match_region_prefer(query, candidate->region_code);
+    float cap_score   = match_capability(q, c);
+    float lat_score   = match_latency(q, c->latency_us);
+    float cost_score  = match_cost(q, c->cost_milli);
+    float region_pref = match_region_prefer(q, c->region_code);
 
     /*
      * Composite score = weighted sum of all field scores.
-     * The architecture score is multiplied with capability weight
-     * since it's closely related. Region preference is a bonus.
+     * Region preference is applied as a multiplier afterwards.
      */
     float score = 0.0f;
-    score += w.capability     * cap_score;
-    score += w.latency        * lat_score;
-    score += w.cost           * cost_score;
-    score += w.context_window * ctx_score;
-    score += w.trust          * trust_score;
-
-    /* Modifiers (not part of weight sum, act as multipliers) */
-    if (arch_score <= 0.0f)
-        return -1.0f;  /* Model arch mismatch is a hard reject */
+    score += w->capability     * cap_score;
+    score += w->latency        * lat_score;
+    score += w->cost           * cost_score;
+    score += w->context_window * ctx_score;
+    score += w->trust          * trust_score;
 
     /* Region preference adjusts the final score */
     score *= region_pref;
@@ -272,6 +396,119 @@ float sad_match_score(const sad_t *query, const route_entry_t *candidate,
     return score;
 }
 
+/* --------------------------------------------------------------------------
+ * sad_match_score / sad_query_score
+ * -------------------------------------------------------------------------- */
+
+float sad_match_score(const sad_t *query, const route_entry_t *candidate,
+                      const scoring_weights_t *weights)
+{
+    if (!query || !candidate)
+        return -1.0f;
+
+    scoring_weights_t w = weights ? *weights : scoring_weights_default();
+
+    sad_query_t q;
+    sad_query_compile(query, &q);
+
+    candidate_t c;
+    candidate_from_entry(candidate, &c);
+    return score_candidate(&q, &c, &w);
+}
+
+float sad_query_score(const sad_query_t *q, const sad_columns_t *cols,
+                      uint32_t row, const scoring_weights_t *weights)
+{
+    if (!q || !cols || row >= cols->count)
+        return -1.0f;
+
+    scoring_weights_t w = weights ? *weights : scoring_weights_default();
+
+    candidate_t c;
+    candidate_from_row(cols, row, &c);
+    return score_candidate(q, &c, &w);
+}
+
+/* --------------------------------------------------------------------------
+ * Top-K selection
+ *
+ * A bounded min-heap of (index, score) hits whose root is the current
+ * worst: lowest score, and among equal scores the highest index.  A new
+ * candidate replaces the root only if it orders ahead of it, so the
+ * earlier of two equal-scoring candidates always wins regardless of the
+ * order rows are visited in -- the same ordering the old insertion-sorted
+ * list produced, at O(log K) per accepted candidate and without moving
+ * route entries around.
+ * -------------------------------------------------------------------------- */
+
+static inline bool hit_worse(const sad_hit_t *a, const sad_hit_t *b)
+{
+    return a->score < b->score ||
+           (a->score == b->score && a->index > b->index);
+}
+
+static void heap_sift_down(sad_hit_t *h, int n, int i)
+{
+    sad_hit_t v = h[i];
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= n) break;
+        if (c + 1 < n && hit_worse(&h[c + 1], &h[c])) c++;
+        if (!hit_worse(&h[c], &v)) break;
+        h[i] = h[c];
+        i = c;
+    }
+    h[i] = v;
+}
+
+/* Fold one qualifying candidate into the heap */
+static inline void topk_push(sad_hit_t *h, int *count, int top_k,
+                             uint32_t index, float score)
+{
+    sad_hit_t v = { .index = index, .score = score };
+
+    if (*count < top_k) {
+        int i = (*count)++;
+        while (i > 0) {
+            int p = (i - 1) / 2;
+            if (!hit_worse(&v, &h[p])) break;
+            h[i] = h[p];
+            i = p;
+        }
+        h[i] = v;
+    } else if (hit_worse(&h[0], &v)) {
+        h[0] = v;
+        heap_sift_down(h, *count, 0);
+    }
+}
+
+/* Heap-sort in place: best first (score descending, index ascending) */
+static void topk_sort(sad_hit_t *h, int n)
+{
+    for (int end = n - 1; end > 0; end--) {
+        sad_hit_t t = h[0];
+        h[0] = h[end];
+        h[end] = t;
+        heap_sift_down(h, end, 0);
+    }
+}
+
+/* Scratch hits for the route_entry_t-returning variants */
+#define SAD_TOPK_STACK  64
+
+static sad_hit_t *hits_scratch(sad_hit_t *stack_buf, int top_k)
+{
+    if (top_k <= SAD_TOPK_STACK)
+        return stack_buf;
+    return malloc((size_t)top_k * sizeof(sad_hit_t));
+}
+
+static void hits_scratch_free(sad_hit_t *hits, sad_hit_t *stack_buf)
+{
+    if (hits != stack_buf)
+        free(hits);
+}
+
 /* --------------------------------------------------------------------------
  * sad_find_best - Find top-K matches from a flat array of entries
  *
@@ -286,35 +523,300 @@ int sad_find_best(const sad_t *query, const route_entry_t *table,
     if (!query || !table || !results || top_k <= 0 || table_size <= 0)
         return 0;
 
+    scoring_weights_t w = weights ? *weights : scoring_weights_default();
+
+    sad_query_t q;
+    sad_query_compile(query, &q);
+
+    sad_hit_t stack_buf[SAD_TOPK_STACK];
+    sad_hit_t *hits = hits_scratch(stack_buf, top_k);
+    if (!hits)
+        return 0;
+
     int count = 0;
 
     for (int i = 0; i < table_size; i++) {
-        float score = sad_match_score(query, &table[i], weights);
+        candidate_t c;
+        candidate_from_entry(&table[i], &c);
+
+        float score = score_candidate(&q, &c, &w);
         if (score < 0.0f)
             continue;  /* Disqualified by hard constraint */
 
-        /* Insertion sort into results array */
-        if (count < top_k) {
-            /* Still room, just insert */
-            int pos = count;
-            while (pos > 0 && results[pos - 1].score < score) {
-                results[pos] = results[pos - 1];
-                pos--;
-            }
-            results[pos].entry = table[i];
-            results[pos].score = score;
-            count++;
-        } else if (score > results[count - 1].score) {
-            /* Better than the worst in the list, replace it */
-            int pos = count - 1;
-            while (pos > 0 && results[pos - 1].score < score) {
-                results[pos] = results[pos - 1];
-                pos--;
-            }
-            results[pos].entry = table[i];
-            results[pos].score = score;
+        topk_push(hits, &count, top_k, (uint32_t)i, score);
+    }
+
+    topk_sort(hits, count);
+    for (int i = 0; i < count; i++) {
+        results[i].entry = table[hits[i].index];
+        results[i].score = hits[i].score;
+    }
+
+    hits_scratch_free(hits, stack_buf);
+    return count;
+}
+
+/* --------------------------------------------------------------------------
+ * sad_find_best_indexed - Top-K using the secondary indexes
+ * -------------------------------------------------------------------------- */
+
+/* A posting list is used instead of a full scan only when it is at most
+ * this fraction of the table; past that the batch kernel is cheaper. */
+#define SAD_INDEX_DRIVER_DIV  4
+
+/* First position in keys[0..n) whose key is >= v */
+static uint32_t lower_bound_u32(const uint32_t *keys, uint32_t n, uint32_t v)
+{
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (keys[mid] < v) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static uint32_t lower_bound_u8(const uint8_t *keys, uint32_t n, uint8_t v)
+{
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (keys[mid] < v) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * Upper bound on score_candidate() for any row whose capability score is
+ * at most @cap_score.  Same operation order as score_candidate with every
+ * other factor at its maximum of 1.0; IEEE round-to-nearest add and
+ * multiply are monotonic, so with non-negative weights no row can
+ * exceed it.
+ */
+static float score_upper_bound(const scoring_weights_t *w, float cap_score)
+{
+    float score = 0.0f;
+    score += w->capability     * cap_score;
+    score += w->latency        * 1.0f;
+    score += w->cost           * 1.0f;
+    score += w->context_window * 1.0f;
+    score += w->trust          * 1.0f;
+
+    if (score > 1.0f) score = 1.0f;
+    if (score < 0.0f) score = 0.0f;
+    return score;
+}
+
+static bool weights_prunable(const scoring_weights_t *w)
+{
+    return isfinite(w->capability)     && w->capability     >= 0.0f &&
+           isfinite(w->latency)        && w->latency        >= 0.0f &&
+           isfinite(w->cost)           && w->cost           >= 0.0f &&
+           isfinite(w->context_window) && w->context_window >= 0.0f &&
+           isfinite(w->trust)          && w->trust          >= 0.0f;
+}
+
+/* Rows put through the scorer by this thread, see sad_match_rows_scored */
+static _Thread_local uint64_t tls_rows_scored;
+
+uint64_t sad_match_rows_scored(void)
+{
+    return tls_rows_scored;
+}
+
+/* Rows passed to score_rows_into: all of them, or one capability class */
+enum { ROWS_ALL, ROWS_FULL_CAP, ROWS_PARTIAL_CAP };
+
+static inline bool row_full_cap(const sad_query_t *q, const sad_columns_t *cols,
+                                uint32_t row)
+{
+    return (cols->capability[row] & q->capability) == q->capability;
+}
+
+static void score_rows_into(const sad_query_t *q, const sad_columns_t *cols,
+                            const scoring_weights_t *w,
+                            const uint32_t *rows, uint32_t n, int which,
+                            sad_hit_t *hits, int *count, int top_k)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t row = rows[i];
+        if (which != ROWS_ALL &&
+            row_full_cap(q, cols, row) != (which == ROWS_FULL_CAP))
+            continue;
+
+        candidate_t c;
+        candidate_from_row(cols, row, &c);
+        float score = score_candidate(q, &c, w);
+        tls_rows_scored++;
+        if (score < 0.0f)
+            continue;
+        topk_push(hits, count, top_k, row, score);
+    }
+}
+
+/* Score the rows carrying every queried capability bit, found by ANDing
+ * the per-bit bitsets */
+static void score_full_cap_bitmap(const sad_query_t *q, const sad_columns_t *cols,
+                                  const sad_index_t *idx,
+                                  const scoring_weights_t *w,
+                                  sad_hit_t *hits, int *count, int top_k)
+{
+    for (uint32_t wi = 0; wi < idx->words; wi++) {
+        uint64_t m = ~(uint64_t)0;
+        for (uint32_t b = 0; b < SAD_INDEX_CAP_BITS && m; b++) {
+            if (q->capability & (1u << b))
+                m &= idx->cap_bits[(size_t)b * idx->words + wi];
+        }
+        while (m) {
+            uint32_t row = wi * 64 + (uint32_t)__builtin_ctzll(m);
+            m &= m - 1;
+            if (row >= cols->count)
+                break;
+            score_rows_into(q, cols, w, &row, 1, ROWS_ALL, hits, count, top_k);
+        }
+    }
+}
+
+/* Blocked batch-kernel scan of every row, optionally of one capability
+ * class only.  SAD_SCORE_BLOCK rows go through the batch kernel at a
+ * time; once the heap is full anything below the current worst is
+ * skipped with a single compare. */
+static void scan_rows_into(const sad_query_t *q, const sad_columns_t *cols,
+                           const scoring_weights_t *w, int which,
+                           sad_hit_t *hits, int *count, int top_k)
+{
+    float scores[SAD_SCORE_BLOCK];
+
+    for (uint32_t base = 0; base < cols->count; base += SAD_SCORE_BLOCK) {
+        uint32_t n = cols->count - base;
+        if (n > SAD_SCORE_BLOCK) n = SAD_SCORE_BLOCK;
+
+        sad_score_batch(q, cols, base, n, w, scores);
+        tls_rows_scored += n;
+
+        for (uint32_t i = 0; i < n; i++) {
+            if (scores[i] < 0.0f)
+                continue;
+            if (*count == top_k && scores[i] < hits[0].score)
+                continue;
+            if (which != ROWS_ALL &&
+                row_full_cap(q, cols, base + i) != (which == ROWS_FULL_CAP))
+                continue;
+            topk_push(hits, count, top_k, base + i, scores[i]);
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * sad_find_best_hits - Top-K (row, score) pairs over a columnar view
+ * -------------------------------------------------------------------------- */
+
+int sad_find_best_hits(const sad_query_t *q, const sad_columns_t *cols,
+                       const scoring_weights_t *weights,
+                       int top_k, sad_hit_t *hits)
+{
+    if (!q || !cols || !hits || top_k <= 0 || cols->count == 0)
+        return 0;
+
+    scoring_weights_t w = weights ? *weights : scoring_weights_default();
+
+    int count = 0;
+    scan_rows_into(q, cols, &w, ROWS_ALL, hits, &count, top_k);
+
+    topk_sort(hits, count);
+    return count;
+}
+
+int sad_find_best_indexed(const sad_query_t *q, const sad_columns_t *cols,
+                          const sad_index_t *idx,
+                          const scoring_weights_t *weights,
+                          int top_k, sad_hit_t *hits)
+{
+    if (!idx || (q && q->wildcard))
+        return sad_find_best_hits(q, cols, weights, top_k, hits);
+    if (!q || !cols || !hits || top_k <= 0 || cols->count == 0)
+        return 0;
+
+    scoring_weights_t w = weights ? *weights : scoring_weights_default();
+
+    /* Pick the shortest posting list among the hard constraints */
+    const uint32_t *drv = NULL;
+    uint32_t drv_n = cols->count;
+
+    if (q->present & SAD_Q_MODEL_ARCH) {
+        uint32_t lo = lower_bound_u32(idx->arch_key, idx->num_arch, q->model_arch);
+        uint32_t hi = lo;
+        while (hi < idx->num_arch && idx->arch_key[hi] == q->model_arch)
+            hi++;
+        if (hi - lo <= drv_n) { drv = idx->arch_row + lo; drv_n = hi - lo; }
+    }
+    if (q->present & SAD_Q_CONTEXT_WINDOW) {
+        uint32_t lo = lower_bound_u32(idx->ctx_key, idx->num_ctx, q->context_window);
+        if (idx->num_ctx - lo <= drv_n) { drv = idx->ctx_row + lo; drv_n = idx->num_ctx - lo; }
+    }
+    if ((q->present & SAD_Q_TRUST_LEVEL) && q->trust_level > 0) {
+        uint32_t lo = lower_bound_u8(idx->trust_key, idx->num_trust, q->trust_level);
+        if (idx->num_trust - lo <= drv_n) { drv = idx->trust_row + lo; drv_n = idx->num_trust - lo; }
+    }
+    if (drv && drv_n > cols->count / SAD_INDEX_DRIVER_DIV)
+        drv = NULL;  /* not selective: full scan */
+
+    int count = 0;
+    bool prune = (q->present & SAD_Q_CAPABILITY) && weights_prunable(&w);
+
+    if (!prune) {
+        if (drv)
+            score_rows_into(q, cols, &w, drv, drv_n, ROWS_ALL, hits, &count, top_k);
+        else
+            scan_rows_into(q, cols, &w, ROWS_ALL, hits, &count, top_k);
+    } else {
+        /* Branch and bound on the capability score: rows missing a queried
+         * bit score at most (popcount - 1) / popcount on capability. */
+        if (drv)
+            score_rows_into(q, cols, &w, drv, drv_n, ROWS_FULL_CAP, hits, &count, top_k);
+        else
+            score_full_cap_bitmap(q, cols, idx, &w, hits, &count, top_k);
+
+        float bound = score_upper_bound(
+            &w, (q->cap_popcount_f - 1.0f) / q->cap_popcount_f);
+
+        if (!(count == top_k && hits[0].score > bound)) {
+            if (drv)
+                score_rows_into(q, cols, &w, drv, drv_n, ROWS_PARTIAL_CAP,
+                                hits, &count, top_k);
+            else
+                scan_rows_into(q, cols, &w, ROWS_PARTIAL_CAP, hits, &count, top_k);
         }
     }
 
+    topk_sort(hits, count);
+    return count;
+}
+
+/* --------------------------------------------------------------------------
+ * sad_find_best_columns - Top-K over a columnar snapshot view
+ * -------------------------------------------------------------------------- */
+
+int sad_find_best_columns(const sad_query_t *q, const sad_columns_t *cols,
+                          const sad_index_t *idx,
+                          const route_entry_t *entries,
+                          const scoring_weights_t *weights,
+                          int top_k, resolve_result_t *results)
+{
+    if (!q || !cols || !entries || !results || top_k <= 0 || cols->count == 0)
+        return 0;
+
+    sad_hit_t stack_buf[SAD_TOPK_STACK];
+    sad_hit_t *hits = hits_scratch(stack_buf, top_k);
+    if (!hits)
+        return 0;
+
+    /* Only the winners are copied out */
+    int count = sad_find_best_indexed(q, cols, idx, weights, top_k, hits);
+    for (int i = 0; i < count; i++) {
+        results[i].entry = entries[hits[i].index];
+        results[i].score = hits[i].score;
+    }
+
+    hits_scratch_free(hits, stack_buf);
     return count;
 }
@@ -0,0 +1,682 @@
+/*
+ * sad_match_simd.c - Vectorised batch scoring kernels for the SAD matcher
+ *
+ * Each kernel evaluates the hard constraints (context window, trust,
+ * region exclude, model arch) as a lane mask and the weighted soft score
+ * (capability popcount, latency, cost, region prefer) for several column
+ * rows per step.  Rows left over at the end of a batch go through the
+ * scalar scorer.
+ *
+ * The kernels perform the same IEEE single-precision operations in the
+ * same order as score_candidate() in sad_match.c, so results are
+ * bit-identical to the scalar path.  This relies on no FMA contraction
+ * (the build passes -ffp-contract=off for both files) and on exact
+ * unsigned 32-bit -> float conversion, which AVX2 lacks and is emulated
+ * below.
+ *
+ * x86 kernels are compiled with per-function target attributes and chosen
+ * at runtime via __builtin_cpu_supports(); the NEON kernel is compiled
+ * in unconditionally on AArch64, where Advanced SIMD is mandatory.
+ */
+
+#include "strandroute/sad_match.h"
+#include "strandroute/types.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  define SAD_HAVE_X86_KERNELS 1
+#  include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#  define SAD_HAVE_NEON_KERNEL 1
+#  include <arm_neon.h>
+#endif
+
+typedef void (*score_batch_fn)(const sad_query_t *q, const sad_columns_t *cols,
+                               uint32_t start, uint32_t n,
+                               const scoring_weights_t *w, float *scores);
+
+/* --------------------------------------------------------------------------
+ * Scalar kernel (reference, and tail handler for the vector kernels)
+ * -------------------------------------------------------------------------- */
+
+static void score_batch_scalar(const sad_query_t *q, const sad_columns_t *cols,
+                               uint32_t start, uint32_t n,
+                               const scoring_weights_t *w, float *scores)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        float s = sad_query_score(q, cols, start + i, w);
+        scores[i] = (s < 0.0f) ? -1.0f : s;
+    }
+}
+
+/* Latencies of rows @r..@r+@n-1 into @out.  Metric stores update the
+ * column in place, so each lane is a relaxed atomic load (a plain 32-bit
+ * load on x86 and AArch64) rather than one vector load racing them. */
+static inline void load_latency(const sad_columns_t *cols, uint32_t r,
+                                int n, uint32_t *out)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = atomic_load_explicit(&cols->latency_us[r + (uint32_t)i],
+                                      memory_order_relaxed);
+}
+
+/* Wildcard queries score every row 1.0 regardless of its fields */
+static bool batch_wildcard(const sad_query_t *q, uint32_t n, float *scores)
+{
+    if (!q->wildcard)
+        return false;
+    for (uint32_t i = 0; i < n; i++)
+        scores[i] = 1.0f;
+    return true;
+}
+
+#ifdef SAD_HAVE_X86_KERNELS
+
+/* --------------------------------------------------------------------------
+ * AVX2 kernel - 8 rows per step
+ * -------------------------------------------------------------------------- */
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_popcount32(__m256i x)
+{
+    const __m256i m1 = _mm256_set1_epi32(0x55555555);
+    const __m256i m2 = _mm256_set1_epi32(0x33333333);
+    const __m256i m4 = _mm256_set1_epi32(0x0F0F0F0F);
+    const __m256i h1 = _mm256_set1_epi32(0x01010101);
+
+    x = _mm256_sub_epi32(x, _mm256_and_si256(_mm256_srli_epi32(x, 1), m1));
+    x = _mm256_add_epi32(_mm256_and_si256(x, m2),
+                         _mm256_and_si256(_mm256_srli_epi32(x, 2), m2));
+    x = _mm256_and_si256(_mm256_add_epi32(x, _mm256_srli_epi32(x, 4)), m4);
+    return _mm256_srli_epi32(_mm256_mullo_epi32(x, h1), 24);
+}
+
+/* Exact uint32 -> float: both 16-bit halves convert exactly, and the final
+ * add rounds once, giving the same result as a scalar (float) cast. */
+__attribute__((target("avx2")))
+static inline __m256 avx2_cvtu32_ps(__m256i v)
+{
+    __m256 hi = _mm256_cvtepi32_ps(_mm256_srli_epi32(v, 16));
+    __m256 lo = _mm256_cvtepi32_ps(_mm256_and_si256(v, _mm256_set1_epi32(0xFFFF)));
+    return _mm256_add_ps(_mm256_mul_ps(hi, _mm256_set1_ps(65536.0f)), lo);
+}
+
+/* Unsigned a >= b per lane */
+__attribute__((target("avx2")))
+static inline __m256i avx2_cmpge_epu32(__m256i a, __m256i b)
+{
+    return _mm256_cmpeq_epi32(_mm256_max_epu32(a, b), a);
+}
+
+/* max(0, 1 - num / den), written exactly as the scalar code does it */
+__attribute__((target("avx2")))
+static inline __m256 avx2_ratio_score(__m256 num, __m256 den)
+{
+    __m256 s = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_div_ps(num, den));
+    return _mm256_and_ps(s, _mm256_cmp_ps(s, _mm256_setzero_ps(), _CMP_GT_OQ));
+}
+
+__attribute__((target("avx2")))
+static void score_batch_avx2(const sad_query_t *q, const sad_columns_t *cols,
+                             uint32_t start, uint32_t n,
+                             const scoring_weights_t *w, float *scores)
+{
+    if (batch_wildcard(q, n, scores))
+        return;
+
+    const uint32_t p = q->present;
+    const __m256i ones   = _mm256_set1_epi32(-1);
+    const __m256i zero_i = _mm256_setzero_si256();
+    const __m256  one    = _mm256_set1_ps(1.0f);
+    const __m256  zero   = _mm256_setzero_ps();
+    const __m256  minus1 = _mm256_set1_ps(-1.0f);
+
+    const __m256i q_arch  = _mm256_set1_epi32((int)q->model_arch);
+    const __m256i q_caps  = _mm256_set1_epi32((int)q->capability);
+    const __m256i q_ctx   = _mm256_set1_epi32((int)q->context_window);
+    const __m256i q_trust = _mm256_set1_epi32(q->trust_level);
+    const __m256i has_arch = _mm256_set1_epi32(SAD_COL_HAS_MODEL_ARCH);
+    const __m256i has_ctx  = _mm256_set1_epi32(SAD_COL_HAS_CONTEXT_WINDOW);
+
+    const __m256 q_pop   = _mm256_set1_ps(q->cap_popcount_f);
+    const __m256 q_lat   = _mm256_set1_ps(q->max_latency_f);
+    const __m256 q_cost  = _mm256_set1_ps(q->max_cost_f);
+    const __m256 k1000   = _mm256_set1_ps(1000.0f);
+    const __m256 w_cap   = _mm256_set1_ps(w->capability);
+    const __m256 w_lat   = _mm256_set1_ps(w->latency);
+    const __m256 w_cost  = _mm256_set1_ps(w->cost);
+    const __m256 w_ctx   = _mm256_set1_ps(w->context_window * 1.0f);
+    const __m256 w_trust = _mm256_set1_ps(w->trust * 1.0f);
+
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t r = start + i;
+
+        __m256i has = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64((const __m128i *)&cols->has[r]));
+        __m256i region = _mm256_cvtepu16_epi32(
+            _mm_loadu_si128((const __m128i *)&cols->region_code[r]));
+
+        /* Hard constraints -> lane mask */
+        __m256i ok = ones;
+
+        if (p & SAD_Q_CONTEXT_WINDOW) {
+            __m256i ctx = _mm256_loadu_si256((const __m256i *)&cols->context_window[r]);
+            __m256i present = _mm256_cmpeq_epi32(_mm256_and_si256(has, has_ctx), has_ctx);
+            ok = _mm256_and_si256(ok, _mm256_and_si256(present,
+                                  avx2_cmpge_epu32(ctx, q_ctx)));
+        }
+        if (p & SAD_Q_TRUST_LEVEL) {
+            __m256i trust = _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64((const __m128i *)&cols->trust_level[r]));
+            ok = _mm256_and_si256(ok, avx2_cmpge_epu32(trust, q_trust));
+        }
+        if (p & SAD_Q_REGION_EXCLUDE) {
+            for (uint8_t k = 0; k < q->num_exclude; k++) {
+                __m256i hit = _mm256_cmpeq_epi32(region,
+                                  _mm256_set1_epi32(q->region_exclude[k]));
+                ok = _mm256_andnot_si256(hit, ok);
+            }
+        }
+        if (p & SAD_Q_MODEL_ARCH) {
+            __m256i arch = _mm256_loadu_si256((const __m256i *)&cols->model_arch[r]);
+            __m256i present = _mm256_cmpeq_epi32(_mm256_and_si256(has, has_arch), has_arch);
+            ok = _mm256_and_si256(ok, _mm256_and_si256(present,
+                                  _mm256_cmpeq_epi32(arch, q_arch)));
+        }
+
+        if (_mm256_testz_si256(ok, ok)) {
+            _mm256_storeu_ps(&scores[i], minus1);
+            continue;
+        }
+
+        /* Soft constraints */
+        __m256 cap_score = one;
+        if (p & SAD_Q_CAPABILITY) {
+            __m256i caps = _mm256_loadu_si256((const __m256i *)&cols->capability[r]);
+            __m256i pop  = avx2_popcount32(_mm256_and_si256(caps, q_caps));
+            cap_score = _mm256_div_ps(_mm256_cvtepi32_ps(pop), q_pop);
+        }
+
+        __m256 lat_score = one;
+        if (p & SAD_Q_MAX_LATENCY) {
+            if (q->max_latency_ms == 0) {
+                lat_score = zero;
+            } else {
+                uint32_t lat_v[8];
+                load_latency(cols, r, 8, lat_v);
+                __m256i lat = _mm256_loadu_si256((const __m256i *)lat_v);
+                __m256 cand_ms = _mm256_div_ps(avx2_cvtu32_ps(lat), k1000);
+                lat_score = avx2_ratio_score(cand_ms, q_lat);
+            }
+        }
+
+        __m256 cost_score = one;
+        if (p & SAD_Q_MAX_COST) {
+            if (q->max_cost_milli == 0) {
+                cost_score = zero;
+            } else {
+                __m256i cost = _mm256_loadu_si256((const __m256i *)&cols->cost_milli[r]);
+                cost_score = avx2_ratio_score(avx2_cvtu32_ps(cost), q_cost);
+            }
+        }
+
+        __m256 region_pref = one;
+        if (p & SAD_Q_REGION_PREFER) {
+            __m256i in = zero_i;
+            for (uint8_t k = 0; k < q->num_prefer; k++) {
+                in = _mm256_or_si256(in, _mm256_cmpeq_epi32(region,
+                                     _mm256_set1_epi32(q->region_prefer[k])));
+            }
+            region_pref = _mm256_blendv_ps(_mm256_set1_ps(0.5f), one,
+                                           _mm256_castsi256_ps(in));
+        }
+
+        __m256 score = zero;
+        score = _mm256_add_ps(score, _mm256_mul_ps(w_cap, cap_score));
+        score = _mm256_add_ps(score, _mm256_mul_ps(w_lat, lat_score));
+        score = _mm256_add_ps(score, _mm256_mul_ps(w_cost, cost_score));
+        score = _mm256_add_ps(score, w_ctx);
+        score = _mm256_add_ps(score, w_trust);
+        score = _mm256_mul_ps(score, region_pref);
+
+        /* Clamp with compares (not min/max) so NaN propagates as in C */
+        score = _mm256_blendv_ps(score, one, _mm256_cmp_ps(score, one, _CMP_GT_OQ));
+        score = _mm256_blendv_ps(score, zero, _mm256_cmp_ps(score, zero, _CMP_LT_OQ));
+
+        score = _mm256_blendv_ps(minus1, score, _mm256_castsi256_ps(ok));
+        _mm256_storeu_ps(&scores[i], score);
+    }
+
+    if (i < n)
+        score_batch_scalar(q, cols, start + i, n - i, w, &scores[i]);
+}
+
+/* --------------------------------------------------------------------------
+ * AVX-512F kernel - 16 rows per step
+ * -------------------------------------------------------------------------- */
+
+__attribute__((target("avx512f")))
+static inline __m512i avx512_popcount32(__m512i x)
+{
+    const __m512i m1 = _mm512_set1_epi32(0x55555555);
+    const __m512i m2 = _mm512_set1_epi32(0x33333333);
+    const __m512i m4 = _mm512_set1_epi32(0x0F0F0F0F);
+    const __m512i h1 = _mm512_set1_epi32(0x01010101);
+
+    x = _mm512_sub_epi32(x, _mm512_and_si512(_mm512_srli_epi32(x, 1), m1));
+    x = _mm512_add_epi32(_mm512_and_si512(x, m2),
+                         _mm512_and_si512(_mm512_srli_epi32(x, 2), m2));
+    x = _mm512_and_si512(_mm512_add_epi32(x, _mm512_srli_epi32(x, 4)), m4);
+    return _mm512_srli_epi32(_mm512_mullo_epi32(x, h1), 24);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 avx512_ratio_score(__m512 num, __m512 den)
+{
+    __m512 s = _mm512_sub_ps(_mm512_set1_ps(1.0f), _mm512_div_ps(num, den));
+    __mmask16 pos = _mm512_cmp_ps_mask(s, _mm512_setzero_ps(), _CMP_GT_OQ);
+    return _mm512_maskz_mov_ps(pos, s);
+}
+
+__attribute__((target("avx512f")))
+static void score_batch_avx512(const sad_query_t *q, const sad_columns_t *cols,
+                               uint32_t start, uint32_t n,
+                               const scoring_weights_t *w, float *scores)
+{
+    if (batch_wildcard(q, n, scores))
+        return;
+
+    const uint32_t p = q->present;
+    const __m512  one    = _mm512_set1_ps(1.0f);
+    const __m512  zero   = _mm512_setzero_ps();
+    const __m512  minus1 = _mm512_set1_ps(-1.0f);
+
+    const __m512i q_arch  = _mm512_set1_epi32((int)q->model_arch);
+    const __m512i q_caps  = _mm512_set1_epi32((int)q->capability);
+    const __m512i q_ctx   = _mm512_set1_epi32((int)q->context_window);
+    const __m512i q_trust = _mm512_set1_epi32(q->trust_level);
+    const __m512i has_arch = _mm512_set1_epi32(SAD_COL_HAS_MODEL_ARCH);
+    const __m512i has_ctx  = _mm512_set1_epi32(SAD_COL_HAS_CONTEXT_WINDOW);
+
+    const __m512 q_pop   = _mm512_set1_ps(q->cap_popcount_f);
+    const __m512 q_lat   = _mm512_set1_ps(q->max_latency_f);
+    const __m512 q_cost  = _mm512_set1_ps(q->max_cost_f);
+    const __m512 k1000   = _mm512_set1_ps(1000.0f);
+    const __m512 w_cap   = _mm512_set1_ps(w->capability);
+    const __m512 w_lat   = _mm512_set1_ps(w->latency);
+    const __m512 w_cost  = _mm512_set1_ps(w->cost);
+    const __m512 w_ctx   = _mm512_set1_ps(w->context_window * 1.0f);
+    const __m512 w_trust = _mm512_set1_ps(w->trust * 1.0f);
+
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint32_t r = start + i;
+
+        __m512i has = _mm512_cvtepu8_epi32(
+            _mm_loadu_si128((const __m128i *)&cols->has[r]));
+        __m512i region = _mm512_cvtepu16_epi32(
+            _mm256_loadu_si256((const __m256i *)&cols->region_code[r]));
+
+        /* Hard constraints -> lane mask */
+        __mmask16 ok = 0xFFFF;
+
+        if (p & SAD_Q_CONTEXT_WINDOW) {
+            __m512i ctx = _mm512_loadu_si512(&cols->context_window[r]);
+            ok &= _mm512_test_epi32_mask(has, has_ctx);
+            ok &= _mm512_cmpge_epu32_mask(ctx, q_ctx);
+        }
+        if (p & SAD_Q_TRUST_LEVEL) {
+            __m512i trust = _mm512_cvtepu8_epi32(
+                _mm_loadu_si128((const __m128i *)&cols->trust_level[r]));
+            ok &= _mm512_cmpge_epu32_mask(trust, q_trust);
+        }
+        if (p & SAD_Q_REGION_EXCLUDE) {
+            for (uint8_t k = 0; k < q->num_exclude; k++) {
+                ok &= _mm512_cmpneq_epi32_mask(region,
+                          _mm512_set1_epi32(q->region_exclude[k]));
+            }
+        }
+        if (p & SAD_Q_MODEL_ARCH) {
+            __m512i arch = _mm512_loadu_si512(&cols->model_arch[r]);
+            ok &= _mm512_test_epi32_mask(has, has_arch);
+            ok &= _mm512_cmpeq_epi32_mask(arch, q_arch);
+        }
+
+        if (ok == 0) {
+            _mm512_storeu_ps(&scores[i], minus1);
+            continue;
+        }
+
+        /* Soft constraints */
+        __m512 cap_score = one;
+        if (p & SAD_Q_CAPABILITY) {
+            __m512i caps = _mm512_loadu_si512(&cols->capability[r]);
+            __m512i pop  = avx512_popcount32(_mm512_and_si512(caps, q_caps));
+            cap_score = _mm512_div_ps(_mm512_cvtepi32_ps(pop), q_pop);
+        }
+
+        __m512 lat_score = one;
+        if (p & SAD_Q_MAX_LATENCY) {
+            if (q->max_latency_ms == 0) {
+                lat_score = zero;
+            } else {
+                uint32_t lat_v[16];
+                load_latency(cols, r, 16, lat_v);
+                __m512i lat = _mm512_loadu_si512(lat_v);
+                __m512 cand_ms = _mm512_div_ps(_mm512_cvtepu32_ps(lat), k1000);
+                lat_score = avx512_ratio_score(cand_ms, q_lat);
+            }
+        }
+
+        __m512 cost_score = one;
+        if (p & SAD_Q_MAX_COST) {
+            if (q->max_cost_milli == 0) {
+                cost_score = zero;
+            } else {
+                __m512i cost = _mm512_loadu_si512(&cols->cost_milli[r]);
+                cost_score = avx512_ratio_score(_mm512_cvtepu32_ps(cost), q_cost);
+            }
+        }
+
+        __m512 region_pref = one;
+        if (p & SAD_Q_REGION_PREFER) {
+            __mmask16 in = 0;
+            for (uint8_t k = 0; k < q->num_prefer; k++) {
+                in |= _mm512_cmpeq_epi32_mask(region,
+                          _mm512_set1_epi32(q->region_prefer[k]));
+            }
+            region_pref = _mm512_mask_blend_ps(in, _mm512_set1_ps(0.5f), one);
+        }
+
+        __m512 score = zero;
+        score = _mm512_add_ps(score, _mm512_mul_ps(w_cap, cap_score));
+        score = _mm512_add_ps(score, _mm512_mul_ps(w_lat, lat_score));
+        score = _mm512_add_ps(score, _mm512_mul_ps(w_cost, cost_score));
+        score = _mm512_add_ps(score, w_ctx);
+        score = _mm512_add_ps(score, w_trust);
+        score = _mm512_mul_ps(score, region_pref);
+
+        /* Clamp with compares (not min/max) so NaN propagates as in C */
+        score = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(score, one, _CMP_GT_OQ),
+                                     score, one);
+        score = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(score, zero, _CMP_LT_OQ),
+                                     score, zero);
+
+        score = _mm512_mask_blend_ps(ok, minus1, score);
+        _mm512_storeu_ps(&scores[i], score);
+    }
+
+    if (i < n)
+        score_batch_scalar(q, cols, start + i, n - i, w, &scores[i]);
+}
+
+#endif /* SAD_HAVE_X86_KERNELS */
+
+#ifdef SAD_HAVE_NEON_KERNEL
+
+/* --------------------------------------------------------------------------
+ * NEON kernel - 4 rows per step
+ * -------------------------------------------------------------------------- */
+
+static inline uint32x4_t neon_load_u8x4(const uint8_t *p)
+{
+    uint32_t v[4] = { p[0], p[1], p[2], p[3] };
+    return vld1q_u32(v);
+}
+
+static inline uint32x4_t neon_popcount32(uint32x4_t x)
+{
+    uint8x16_t c = vcntq_u8(vreinterpretq_u8_u32(x));
+    return vpaddlq_u16(vpaddlq_u8(c));
+}
+
+static inline float32x4_t neon_ratio_score(float32x4_t num, float32x4_t den)
+{
+    float32x4_t s = vsubq_f32(vdupq_n_f32(1.0f), vdivq_f32(num, den));
+    uint32x4_t pos = vcgtq_f32(s, vdupq_n_f32(0.0f));
+    return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(s), pos));
+}
+
+static void score_batch_neon(const sad_query_t *q, const sad_columns_t *cols,
+                             uint32_t start, uint32_t n,
+                             const scoring_weights_t *w, float *scores)
+{
+    if (batch_wildcard(q, n, scores))
+        return;
+
+    const uint32_t p = q->present;
+    const float32x4_t one    = vdupq_n_f32(1.0f);
+    const float32x4_t zero   = vdupq_n_f32(0.0f);
+    const float32x4_t minus1 = vdupq_n_f32(-1.0f);
+
+    const uint32x4_t q_arch  = vdupq_n_u32(q->model_arch);
+    const uint32x4_t q_caps  = vdupq_n_u32(q->capability);
+    const uint32x4_t q_ctx   = vdupq_n_u32(q->context_window);
+    const uint32x4_t q_trust = vdupq_n_u32(q->trust_level);
+    const uint32x4_t has_arch = vdupq_n_u32(SAD_COL_HAS_MODEL_ARCH);
+    const uint32x4_t has_ctx  = vdupq_n_u32(SAD_COL_HAS_CONTEXT_WINDOW);
+
+    const float32x4_t q_pop   = vdupq_n_f32(q->cap_popcount_f);
+    const float32x4_t q_lat   = vdupq_n_f32(q->max_latency_f);
+    const float32x4_t q_cost  = vdupq_n_f32(q->max_cost_f);
+    const float32x4_t k1000   = vdupq_n_f32(1000.0f);
+    const float32x4_t w_cap   = vdupq_n_f32(w->capability);
+    const float32x4_t w_lat   = vdupq_n_f32(w->latency);
+    const float32x4_t w_cost  = vdupq_n_f32(w->cost);
+    const float32x4_t w_ctx   = vdupq_n_f32(w->context_window * 1.0f);
+    const float32x4_t w_trust = vdupq_n_f32(w->trust * 1.0f);
+
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t r = start + i;
+
+        uint32x4_t has    = neon_load_u8x4(&cols->has[r]);
+        uint32x4_t region = vmovl_u16(vld1_u16(&cols->region_code[r]));
+
+        /* Hard constraints -> lane mask */
+        uint32x4_t ok = vdupq_n_u32(0xFFFFFFFFu);
+
+        if (p & SAD_Q_CONTEXT_WINDOW) {
+            uint32x4_t ctx = vld1q_u32(&cols->context_window[r]);
+            ok = vandq_u32(ok, vtstq_u32(has, has_ctx));
+            ok = vandq_u32(ok, vcgeq_u32(ctx, q_ctx));
+        }
+        if (p & SAD_Q_TRUST_LEVEL) {
+            uint32x4_t trust = neon_load_u8x4(&cols->trust_level[r]);
+            ok = vandq_u32(ok, vcgeq_u32(trust, q_trust));
+        }
+        if (p & SAD_Q_REGION_EXCLUDE) {
+            for (uint8_t k = 0; k < q->num_exclude; k++) {
+                uint32x4_t hit = vceqq_u32(region, vdupq_n_u32(q->region_exclude[k]));
+                ok = vbicq_u32(ok, hit);
+            }
+        }
+        if (p & SAD_Q_MODEL_ARCH) {
+            uint32x4_t arch = vld1q_u32(&cols->model_arch[r]);
+            ok = vandq_u32(ok, vtstq_u32(has, has_arch));
+            ok = vandq_u32(ok, vceqq_u32(arch, q_arch));
+        }
+
+        if (vmaxvq_u32(ok) == 0) {
+            vst1q_f32(&scores[i], minus1);
+            continue;
+        }
+
+        /* Soft constraints */
+        float32x4_t cap_score = one;
+        if (p & SAD_Q_CAPABILITY) {
+            uint32x4_t caps = vld1q_u32(&cols->capability[r]);
+            uint32x4_t pop  = neon_popcount32(vandq_u32(caps, q_caps));
+            cap_score = vdivq_f32(vcvtq_f32_u32(pop), q_pop);
+        }
+
+        float32x4_t lat_score = one;
+        if (p & SAD_Q_MAX_LATENCY) {
+            if (q->max_latency_ms == 0) {
+                lat_score = zero;
+            } else {
+                uint32_t lat_v[4];
+                load_latency(cols, r, 4, lat_v);
+                uint32x4_t lat = vld1q_u32(lat_v);
+                float32x4_t cand_ms = vdivq_f32(vcvtq_f32_u32(lat), k1000);
+                lat_score = neon_ratio_score(cand_ms, q_lat);
+            }
+        }
+
+        float32x4_t cost_score = one;
+        if (p & SAD_Q_MAX_COST) {
+            if (q->max_cost_milli == 0) {
+                cost_score = zero;
+            } else {
+                uint32x4_t cost = vld1q_u32(&cols->cost_milli[r]);
+                cost_score = neon_ratio_score(vcvtq_f32_u32(cost), q_cost);
+            }
+        }
+
+        float32x4_t region_pref = one;
+        if (p & SAD_Q_REGION_PREFER) {
+            uint32x4_t in = vdupq_n_u32(0);
+            for (uint8_t k = 0; k < q->num_prefer; k++) {
+                in = vorrq_u32(in, vceqq_u32(region, vdupq_n_u32(q->region_prefer[k])));
+            }
+            region_pref = vbslq_f32(in, one, vdupq_n_f32(0.5f));
+        }
+
+        float32x4_t score = zero;
+        score = vaddq_f32(score, vmulq_f32(w_cap, cap_score));
+        score = vaddq_f32(score, vmulq_f32(w_lat, lat_score));
+        score = vaddq_f32(score, vmulq_f32(w_cost, cost_score));
+        score = vaddq_f32(score, w_ctx);
+        score = vaddq_f32(score, w_trust);
+        score = vmulq_f32(score, region_pref);
+
+        /* Clamp with compares (not min/max) so NaN propagates as in C */
+        score = vbslq_f32(vcgtq_f32(score, one), one, score);
+        score = vbslq_f32(vcltq_f32(score, zero), zero, score);
+
+        score = vbslq_f32(ok, score, minus1);
+        vst1q_f32(&scores[i], score);
+    }
+
+    if (i < n)
+        score_batch_scalar(q, cols, start + i, n - i, w, &scores[i]);
+}
+
+#endif /* SAD_HAVE_NEON_KERNEL */
+
+/* --------------------------------------------------------------------------
+ * Runtime dispatch
+ * -------------------------------------------------------------------------- */
+
+static _Atomic int g_active_kernel = SAD_KERNEL_AUTO;
+
+bool sad_kernel_available(sad_kernel_t kernel)
+{
+    switch (kernel) {
+    case SAD_KERNEL_AUTO:
+    case SAD_KERNEL_SCALAR:
+        return true;
+#ifdef SAD_HAVE_X86_KERNELS
+    case SAD_KERNEL_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    case SAD_KERNEL_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f");
+#endif
+#ifdef SAD_HAVE_NEON_KERNEL
+    case SAD_KERNEL_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+static sad_kernel_t detect_best_kernel(void)
+{
+    if (sad_kernel_available(SAD_KERNEL_AVX512)) return SAD_KERNEL_AVX512;
+    if (sad_kernel_available(SAD_KERNEL_AVX2))   return SAD_KERNEL_AVX2;
+    if (sad_kernel_available(SAD_KERNEL_NEON))   return SAD_KERNEL_NEON;
+    return SAD_KERNEL_SCALAR;
+}
+
+static score_batch_fn kernel_fn(sad_kernel_t kernel)
+{
+    switch (kernel) {
+#ifdef SAD_HAVE_X86_KERNELS
+    case SAD_KERNEL_AVX2:   return score_batch_avx2;
+    case SAD_KERNEL_AVX512: return score_batch_avx512;
+#endif
+#ifdef SAD_HAVE_NEON_KERNEL
+    case SAD_KERNEL_NEON:   return score_batch_neon;
+#endif
+    default:                return score_batch_scalar;
+    }
+}
+
+int sad_kernel_set(sad_kernel_t kernel)
+{
+    if (!sad_kernel_available(kernel))
+        return -1;
+    if (kernel == SAD_KERNEL_AUTO)
+        kernel = detect_best_kernel();
+    atomic_store_explicit(&g_active_kernel, (int)kernel, memory_order_relaxed);
+    return 0;
+}
+
+sad_kernel_t sad_kernel_active(void)
+{
+    int k = atomic_load_explicit(&g_active_kernel, memory_order_relaxed);
+    if (k == SAD_KERNEL_AUTO) {
+        /* Racing first callers all store the same detected value */
+        k = (int)detect_best_kernel();
+        atomic_store_explicit(&g_active_kernel, k, memory_order_relaxed);
+    }
+    return (sad_kernel_t)k;
+}
+
+const char *sad_kernel_name(sad_kernel_t kernel)
+{
+    switch (kernel) {
+    case SAD_KERNEL_AUTO:   return "auto";
+    case SAD_KERNEL_SCALAR: return "scalar";
+    case SAD_KERNEL_AVX2:   return "avx2";
+    case SAD_KERNEL_AVX512: return "avx512";
+    case SAD_KERNEL_NEON:   return "neon";
+    default:                return "unknown";
+    }
+}
+
+void sad_score_batch(const sad_query_t *q, const sad_columns_t *cols,
+                     uint32_t start, uint32_t n,
+                     const scoring_weights_t *weights, float *scores)
+{
+    if (!q || !cols || !scores || start > cols->count || n > cols->count - start)
+        return;
+
+    scoring_weights_t w = weights ? *weights : scoring_weights_default();
+    kernel_fn(sad_kernel_active())(q, cols, start, n, &w, scores);
+}
+
+int sad_score_batch_kernel(sad_kernel_t kernel,
+                           const sad_query_t *q, const sad_columns_t *cols,
+                           uint32_t start, uint32_t n,
+                           const scoring_weights_t *weights, float *scores)
+{
+    if (!q || !cols || !scores || start > cols->count || n > cols->count - start)
+        return -1;
+    if (kernel == SAD_KERNEL_AUTO)
+        kernel = sad_kernel_active();
+    if (!sad_kernel_available(kernel))
+        return -1;
+
+    scoring_weights_t w = weights ? *weights : scoring_weights_default();
+    kernel_fn(kernel)(q, cols, start, n, &w, scores);
+    return 0;
+}
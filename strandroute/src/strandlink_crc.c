@@ -0,0 +1,103 @@
+/*
+ * strandlink_crc.c - C build of the StrandLink CRC-32C
+ *
+ * Same checksum as strandlink/src/crc.zig (Castagnoli, reflected
+ * 0x82F63B78, pre- and post-inverted), so files and frames checked by one
+ * build verify under the other.  x86 uses the SSE4.2 crc32 instruction
+ * when the CPU has it, chosen once at runtime like the SAD kernels;
+ * everywhere else a slicing-by-8 table walk.
+ */
+
+#include "strandroute/strandlink_compat.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC_HAVE_SSE42
+#include <nmmintrin.h>
+#endif
+
+#define CRC32C_POLY 0x82F63B78u
+
+static uint32_t crc_table[8][256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+static uint32_t (*crc_update)(uint32_t crc, const uint8_t *p, size_t len);
+
+static uint32_t crc_update_sw(uint32_t crc, const uint8_t *p, size_t len)
+{
+    while (len && ((uintptr_t)p & 7)) {
+        crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        len--;
+    }
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        w = __builtin_bswap64(w);
+#endif
+        uint32_t lo = (uint32_t)w ^ crc;
+        uint32_t hi = (uint32_t)(w >> 32);
+        crc = crc_table[7][lo & 0xFF]         ^ crc_table[6][(lo >> 8) & 0xFF] ^
+              crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24]         ^
+              crc_table[3][hi & 0xFF]         ^ crc_table[2][(hi >> 8) & 0xFF] ^
+              crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+        p   += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef CRC_HAVE_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t crc_update_sse42(uint32_t crc, const uint8_t *p, size_t len)
+{
+    while (len && ((uintptr_t)p & 7)) {
+        crc = _mm_crc32_u8(crc, *p++);
+        len--;
+    }
+    uint64_t c = crc;
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        c = _mm_crc32_u64(c, w);
+        p   += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)c;
+    while (len--)
+        crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+#endif
+
+static void crc_init(void)
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        crc_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++)
+            crc_table[t][i] = crc_table[0][crc_table[t - 1][i] & 0xFF] ^
+                              (crc_table[t - 1][i] >> 8);
+    }
+
+    crc_update = crc_update_sw;
+#ifdef CRC_HAVE_SSE42
+    if (__builtin_cpu_supports("sse4.2"))
+        crc_update = crc_update_sse42;
+#endif
+}
+
+uint32_t strandlink_crc32c(const uint8_t *data, uint32_t len)
+{
+    if (!data)
+        return 0;
+    pthread_once(&crc_once, crc_init);
+    return crc_update(0xFFFFFFFFu, data, len) ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,90 @@
+/*
+ * strandlink_ring.c - C build of the StrandLink SPSC ring buffer
+ *
+ * Mirrors strandlink/src/ring_buffer.zig so StrandRoute can run without
+ * the Zig library: power-of-2 slot count, head and tail indices on their
+ * own cache lines, release/acquire publication, no locks.
+ */
+
+#include "strandroute/strandlink_compat.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+struct strandlink_ring_buffer {
+    uint8_t *backing;
+    uint32_t num_slots;
+    uint32_t slot_size;
+    uint32_t mask;
+
+    _Alignas(64) _Atomic uint32_t head;   /* written by the producer */
+    _Alignas(64) _Atomic uint32_t tail;   /* written by the consumer */
+};
+
+strandlink_ring_buffer_t *strandlink_ring_buffer_create(uint32_t num_slots,
+                                                     uint32_t slot_size)
+{
+    if (num_slots == 0 || (num_slots & (num_slots - 1)) != 0 || slot_size == 0)
+        return NULL;
+
+    strandlink_ring_buffer_t *rb = aligned_alloc(64, sizeof(*rb));
+    if (!rb) return NULL;
+
+    /* aligned_alloc wants a multiple of the alignment */
+    size_t bytes = ((size_t)num_slots * slot_size + 63) & ~(size_t)63;
+    rb->backing = aligned_alloc(64, bytes);
+    if (!rb->backing) {
+        free(rb);
+        return NULL;
+    }
+    memset(rb->backing, 0, bytes);
+
+    rb->num_slots = num_slots;
+    rb->slot_size = slot_size;
+    rb->mask      = num_slots - 1;
+    atomic_init(&rb->head, 0);
+    atomic_init(&rb->tail, 0);
+    return rb;
+}
+
+void strandlink_ring_buffer_destroy(strandlink_ring_buffer_t *rb)
+{
+    if (!rb) return;
+    free(rb->backing);
+    free(rb);
+}
+
+uint8_t *strandlink_ring_buffer_reserve(strandlink_ring_buffer_t *rb)
+{
+    if (!rb) return NULL;
+    uint32_t h = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    uint32_t t = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    if (h - t >= rb->num_slots)
+        return NULL;
+    return rb->backing + (size_t)(h & rb->mask) * rb->slot_size;
+}
+
+void strandlink_ring_buffer_commit(strandlink_ring_buffer_t *rb)
+{
+    if (!rb) return;
+    uint32_t h = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    atomic_store_explicit(&rb->head, h + 1, memory_order_release);
+}
+
+const uint8_t *strandlink_ring_buffer_peek(strandlink_ring_buffer_t *rb)
+{
+    if (!rb) return NULL;
+    uint32_t t = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    uint32_t h = atomic_load_explicit(&rb->head, memory_order_acquire);
+    if (h == t)
+        return NULL;
+    return rb->backing + (size_t)(t & rb->mask) * rb->slot_size;
+}
+
+void strandlink_ring_buffer_release(strandlink_ring_buffer_t *rb)
+{
+    if (!rb) return;
+    uint32_t t = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    atomic_store_explicit(&rb->tail, t + 1, memory_order_release);
+}
@@ -0,0 +1,259 @@
+/*
+ * timer_wheel.c - Hierarchical timing wheel
+ *
+ * The classic cascading layout: level 0 holds the next 64 ticks one slot
+ * per tick, level L one slot per 64^L ticks.  Whenever the clock crosses
+ * a level-L boundary, that level's current slot is re-bucketed into the
+ * levels below.  Timers and slot heads share one node array and link by
+ * index: ids 0..TW_SLOTS-1 are the circular list heads, so id 0 is never
+ * handed out and the array can be grown with realloc.
+ */
+
+#include "strandroute/timer_wheel.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TW_BITS     6
+#define TW_SIZE     (1u << TW_BITS)
+#define TW_MASK     (TW_SIZE - 1)
+#define TW_LEVELS   4
+#define TW_SLOTS    (TW_LEVELS * TW_SIZE)
+#define TW_SPAN     (1ull << (TW_BITS * TW_LEVELS))     /* ticks covered */
+
+enum {
+    TW_FREE = 0,
+    TW_PENDING,
+    TW_FIRING,      /* unlinked, callback running */
+};
+
+typedef struct {
+    uint64_t expires;
+    uint64_t data;
+    uint32_t next;
+    uint32_t prev;
+    uint8_t  state;
+    uint8_t  level;
+} tw_node_t;
+
+struct timer_wheel {
+    tw_node_t *n;
+    uint32_t   cap;
+    uint32_t   free_head;           /* TIMER_WHEEL_NONE = empty */
+    uint64_t   tick;
+    uint64_t   base;                /* next tick to process */
+    uint32_t   count[TW_LEVELS];
+    uint32_t   pending;
+};
+
+/* --------------------------------------------------------------------------
+ * Lists
+ * -------------------------------------------------------------------------- */
+
+static void tw_link(timer_wheel_t *tw, uint32_t head, uint32_t i)
+{
+    tw_node_t *n = tw->n;
+    n[i].next = head;
+    n[i].prev = n[head].prev;
+    n[n[head].prev].next = i;
+    n[head].prev = i;
+}
+
+static void tw_unlink(timer_wheel_t *tw, uint32_t i)
+{
+    tw_node_t *n = tw->n;
+    n[n[i].prev].next = n[i].next;
+    n[n[i].next].prev = n[i].prev;
+    tw->count[n[i].level]--;
+    tw->pending--;
+}
+
+/* Bucket pending-to-be timer @i relative to the current base */
+static void tw_place(timer_wheel_t *tw, uint32_t i)
+{
+    uint64_t t = tw->n[i].expires / tw->tick;
+    if (t < tw->base)
+        t = tw->base;
+    uint64_t delta = t - tw->base;
+    if (delta >= TW_SPAN)
+        t = tw->base + TW_SPAN - 1;     /* re-bucketed as the wheel turns */
+
+    uint32_t level = 0;
+    while (level < TW_LEVELS - 1 &&
+           (t - tw->base) >= (1ull << (TW_BITS * (level + 1))))
+        level++;
+    uint32_t slot = (uint32_t)(t >> (TW_BITS * level)) & TW_MASK;
+
+    tw->n[i].state = TW_PENDING;
+    tw->n[i].level = (uint8_t)level;
+    tw_link(tw, level * TW_SIZE + slot, i);
+    tw->count[level]++;
+    tw->pending++;
+}
+
+static bool tw_live(const timer_wheel_t *tw, uint32_t id)
+{
+    return id >= TW_SLOTS && id < tw->cap && tw->n[id].state != TW_FREE;
+}
+
+static void tw_release(timer_wheel_t *tw, uint32_t i)
+{
+    tw->n[i].state = TW_FREE;
+    tw->n[i].next  = tw->free_head;
+    tw->free_head  = i;
+}
+
+static int tw_grow(timer_wheel_t *tw)
+{
+    uint32_t cap = tw->cap * 2;
+    tw_node_t *n = realloc(tw->n, cap * sizeof(*n));
+    if (!n)
+        return -1;
+    memset(n + tw->cap, 0, (cap - tw->cap) * sizeof(*n));
+    tw->n = n;
+    for (uint32_t i = cap; i-- > tw->cap; ) {
+        n[i].next     = tw->free_head;
+        tw->free_head = i;
+    }
+    tw->cap = cap;
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * Public API
+ * -------------------------------------------------------------------------- */
+
+timer_wheel_t *timer_wheel_create(uint64_t tick, uint64_t now)
+{
+    if (tick == 0)
+        return NULL;
+    timer_wheel_t *tw = calloc(1, sizeof(*tw));
+    if (!tw)
+        return NULL;
+    tw->cap = TW_SLOTS;
+    tw->n   = calloc(tw->cap, sizeof(*tw->n));
+    if (!tw->n) {
+        free(tw);
+        return NULL;
+    }
+    for (uint32_t h = 0; h < TW_SLOTS; h++)
+        tw->n[h].next = tw->n[h].prev = h;
+    tw->free_head = TIMER_WHEEL_NONE;
+    tw->tick      = tick;
+    tw->base      = now / tick;
+    return tw;
+}
+
+void timer_wheel_destroy(timer_wheel_t *tw)
+{
+    if (!tw) return;
+    free(tw->n);
+    free(tw);
+}
+
+uint32_t timer_wheel_add(timer_wheel_t *tw, uint64_t expires, uint64_t data)
+{
+    if (!tw)
+        return TIMER_WHEEL_NONE;
+    if (tw->free_head == TIMER_WHEEL_NONE && tw_grow(tw) != 0)
+        return TIMER_WHEEL_NONE;
+
+    uint32_t i = tw->free_head;
+    tw->free_head    = tw->n[i].next;
+    tw->n[i].expires = expires;
+    tw->n[i].data    = data;
+    tw_place(tw, i);
+    return i;
+}
+
+int timer_wheel_mod(timer_wheel_t *tw, uint32_t id, uint64_t expires)
+{
+    if (!tw || !tw_live(tw, id))
+        return -1;
+    if (tw->n[id].state == TW_PENDING)
+        tw_unlink(tw, id);
+    tw->n[id].expires = expires;
+    tw_place(tw, id);
+    return 0;
+}
+
+void timer_wheel_del(timer_wheel_t *tw, uint32_t id)
+{
+    if (!tw || !tw_live(tw, id))
+        return;
+    if (tw->n[id].state == TW_PENDING)
+        tw_unlink(tw, id);
+    tw_release(tw, id);
+}
+
+uint64_t timer_wheel_expires(const timer_wheel_t *tw, uint32_t id)
+{
+    if (!tw || !tw_live(tw, id) || tw->n[id].state != TW_PENDING)
+        return UINT64_MAX;
+    return tw->n[id].expires;
+}
+
+uint32_t timer_wheel_pending(const timer_wheel_t *tw)
+{
+    return tw ? tw->pending : 0;
+}
+
+/* Re-bucket the current slot of @level into the levels below */
+static void tw_cascade(timer_wheel_t *tw, uint32_t level)
+{
+    uint32_t head = level * TW_SIZE +
+                    ((uint32_t)(tw->base >> (TW_BITS * level)) & TW_MASK);
+    while (tw->n[head].next != head) {
+        uint32_t i = tw->n[head].next;
+        tw_unlink(tw, i);
+        tw_place(tw, i);
+    }
+}
+
+uint32_t timer_wheel_advance(timer_wheel_t *tw, uint64_t now,
+                             timer_wheel_fn fn, void *ctx)
+{
+    if (!tw)
+        return 0;
+    uint64_t target = now / tw->tick;
+    uint32_t fired  = 0;
+
+    while (tw->base <= target) {
+        /* Nothing in levels below L: jump to L's next boundary */
+        uint32_t low = 0;
+        while (low < TW_LEVELS && tw->count[low] == 0)
+            low++;
+        if (low == TW_LEVELS) {
+            tw->base = target + 1;
+            break;
+        }
+        if (low > 0) {
+            uint64_t step = 1ull << (TW_BITS * low);
+            uint64_t next = (tw->base + step - 1) & ~(step - 1);
+            if (next > target) {
+                tw->base = target + 1;
+                break;
+            }
+            tw->base = next;
+        }
+
+        for (uint32_t l = 1; l < TW_LEVELS; l++) {
+            if ((tw->base & ((1ull << (TW_BITS * l)) - 1)) != 0)
+                break;
+            tw_cascade(tw, l);
+        }
+
+        uint32_t head = (uint32_t)tw->base & TW_MASK;
+        while (tw->n[head].next != head) {
+            uint32_t i = tw->n[head].next;
+            tw_unlink(tw, i);
+            tw->n[i].state = TW_FIRING;
+            fn(ctx, i, tw->n[i].data);
+            fired++;
+            if (tw->n[i].state == TW_FIRING)    /* not re-armed or deleted */
+                tw_release(tw, i);
+        }
+        tw->base++;
+    }
+    return fired;
+}
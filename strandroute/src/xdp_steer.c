@@ -0,0 +1,288 @@
+/*
+ * xdp_steer.c - Kernel fast path for exact and hot-SAD forwarding
+ *
+ * Write-through mirror of the node table and the offloaded SAD set into
+ * the XDP program's maps.  The CRC patch relies on CRC-32C being linear:
+ * flipping bits D at some offset changes the raw CRC by the raw CRC of D
+ * followed by the bytes after it as zeros, i.e. crc(D) * x^(8 * tail_len)
+ * modulo the polynomial.  The powers x^(8 * 2^j) are tabulated, so the
+ * shift costs one carry-less multiply per set bit of tail_len and the
+ * payload is never read.
+ */
+
+#include "strandroute/xdp_steer.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(xdp_steer_node_val_t) == 40,
+               "node_fwd_map value must match xdp_kern.c");
+_Static_assert(sizeof(xdp_steer_sad_key_t) == 16,
+               "hot_sad_map key must match xdp_kern.c");
+
+struct xdp_steer {
+    xdp_steer_config_t cfg;
+    pthread_mutex_t    lock;
+    xdp_steer_stats_t  stats;
+};
+
+/* --------------------------------------------------------------------------
+ * CRC-32C patching (same arithmetic as crc_patch() in xdp_kern.c)
+ * -------------------------------------------------------------------------- */
+
+#define XS_CRC32C_POLY  0x82F63B78u
+
+/* x^(8 * 2^j) mod P, reflected, for j = 0..15: shifts of up to 64 KiB */
+static const uint32_t xs_crc_x8n[16] = {
+    0x00800000u, 0x00008000u, 0x82f63b78u, 0x6ea2d55cu,
+    0x18b8ea18u, 0x510ac59au, 0xb82be955u, 0xb8fdb1e7u,
+    0x88e56f72u, 0x74c360a4u, 0xe4172b16u, 0x0d65762au,
+    0x35d73a62u, 0x28461564u, 0xbf455269u, 0xe2ea32dcu,
+};
+
+/* a * b mod P, reflected bit order */
+static uint32_t xs_crc_mulmod(uint32_t a, uint32_t b)
+{
+    uint32_t p = 0;
+    for (int i = 0; i < 32; i++) {
+        if (a & (0x80000000u >> i))
+            p ^= b;
+        b = (b & 1u) ? (b >> 1) ^ XS_CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+uint32_t xdp_steer_crc_patch(uint32_t crc,
+                             const uint8_t old_id[STRANDLINK_NODE_ID_LEN],
+                             const uint8_t new_id[STRANDLINK_NODE_ID_LEN],
+                             uint32_t tail_len)
+{
+    /* Raw CRC (zero init, no final inversion) of the changed bits */
+    uint32_t d = 0;
+    for (int i = 0; i < STRANDLINK_NODE_ID_LEN; i++) {
+        d ^= (uint8_t)(old_id[i] ^ new_id[i]);
+        for (int b = 0; b < 8; b++)
+            d = (d & 1u) ? (d >> 1) ^ XS_CRC32C_POLY : d >> 1;
+    }
+    if (d == 0)
+        return crc;
+
+    uint32_t x = 0x80000000u;                   /* x^0 */
+    for (int j = 0; j < 16; j++)
+        if (tail_len & (1u << j))
+            x = xs_crc_mulmod(xs_crc_x8n[j], x);
+    return crc ^ xs_crc_mulmod(x, d);
+}
+
+/* --------------------------------------------------------------------------
+ * Keys
+ * -------------------------------------------------------------------------- */
+
+static void xs_put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+int xdp_steer_sad_key(const p4rt_sad_key_t *key, const p4rt_sad_key_t *mask,
+                      xdp_steer_sad_key_t *out)
+{
+    if (!key || !out)
+        return -1;
+
+    /* An all-zero mask is an exact entry, as in p4rt_op_t */
+    uint32_t cw_mask = 0xFFFFFFFFu;
+    if (mask && (mask->model_arch | mask->capability | mask->context_window)) {
+        if (mask->model_arch != 0xFFFFFFFFu || mask->capability != 0xFFFFFFFFu)
+            return -1;
+        cw_mask = mask->context_window;
+        if (cw_mask & (~cw_mask >> 1))          /* not ones-then-zeros */
+            return -1;
+    }
+
+    uint32_t bits = 0;
+    for (uint32_t m = cw_mask; m; m <<= 1)
+        bits++;
+
+    memset(out, 0, sizeof(*out));
+    out->prefixlen = 64 + bits;
+    xs_put_be32(&out->data[0], key->model_arch);
+    xs_put_be32(&out->data[4], key->capability);
+    xs_put_be32(&out->data[8], key->context_window & cw_mask);
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * Lifecycle
+ * -------------------------------------------------------------------------- */
+
+xdp_steer_t *xdp_steer_create(const xdp_steer_config_t *cfg)
+{
+    if (!cfg || !cfg->node_table || !cfg->underlay_fn ||
+        !cfg->update_fn || !cfg->delete_fn)
+        return NULL;
+
+    xdp_steer_t *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+
+    s->cfg = *cfg;
+    pthread_mutex_init(&s->lock, NULL);
+    return s;
+}
+
+void xdp_steer_destroy(xdp_steer_t *s)
+{
+    if (!s) return;
+    pthread_mutex_destroy(&s->lock);
+    free(s);
+}
+
+/* --------------------------------------------------------------------------
+ * Node entries
+ * -------------------------------------------------------------------------- */
+
+/* Bring node_fwd_map in line with one hop, under lock */
+static int xs_node_mirror(xdp_steer_t *s,
+                          const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                          const node_table_hop_t *hop)
+{
+    xdp_steer_underlay_t u;
+    if (hop && s->cfg.underlay_fn(hop->port, hop->next_hop, &u,
+                                  s->cfg.underlay_ctx) == 0 && u.ifindex) {
+        xdp_steer_node_val_t v;
+        memset(&v, 0, sizeof(v));
+        memcpy(v.next_hop, hop->next_hop, STRANDLINK_NODE_ID_LEN);
+        v.ifindex = u.ifindex;
+        v.saddr   = u.saddr;
+        v.daddr   = u.daddr;
+        memcpy(v.smac, u.smac, sizeof(v.smac));
+        memcpy(v.dmac, u.dmac, sizeof(v.dmac));
+
+        if (s->cfg.update_fn(XDP_STEER_MAP_NODE, node_id, &v,
+                             s->cfg.map_ctx) != 0) {
+            /* Never leave the old hop in the kernel */
+            s->cfg.delete_fn(XDP_STEER_MAP_NODE, node_id, s->cfg.map_ctx);
+            s->stats.failed++;
+            return -1;
+        }
+        s->stats.node_installed++;
+        return 0;
+    }
+
+    if (s->cfg.delete_fn(XDP_STEER_MAP_NODE, node_id, s->cfg.map_ctx) != 0) {
+        s->stats.failed++;
+        return -1;
+    }
+    s->stats.node_removed++;
+    return 0;
+}
+
+int xdp_steer_node_insert(xdp_steer_t *s,
+                          const uint8_t node_id[STRANDLINK_NODE_ID_LEN],
+                          strandlink_port_t port,
+                          const uint8_t next_hop[STRANDLINK_NODE_ID_LEN])
+{
+    if (!s || !node_id)
+        return -1;
+
+    pthread_mutex_lock(&s->lock);
+    int rc = node_table_insert(s->cfg.node_table, node_id, port, next_hop);
+    if (rc == 0) {
+        node_table_hop_t hop;
+        hop.port = port;
+        memcpy(hop.next_hop, next_hop ? next_hop : node_id,
+               STRANDLINK_NODE_ID_LEN);
+        rc = xs_node_mirror(s, node_id, &hop);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return rc;
+}
+
+int xdp_steer_node_delete(xdp_steer_t *s,
+                          const uint8_t node_id[STRANDLINK_NODE_ID_LEN])
+{
+    if (!s || !node_id)
+        return -1;
+
+    pthread_mutex_lock(&s->lock);
+    int rc = node_table_delete(s->cfg.node_table, node_id);
+    if (rc == 0)
+        rc = xs_node_mirror(s, node_id, NULL);
+    pthread_mutex_unlock(&s->lock);
+    return rc;
+}
+
+int xdp_steer_node_refresh(xdp_steer_t *s,
+                           const uint8_t node_id[STRANDLINK_NODE_ID_LEN])
+{
+    if (!s || !node_id)
+        return -1;
+
+    pthread_mutex_lock(&s->lock);
+    node_table_hop_t hop;
+    int rc = xs_node_mirror(s, node_id,
+                            node_table_lookup(s->cfg.node_table, node_id,
+                                              &hop) == 0 ? &hop : NULL);
+    pthread_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/* --------------------------------------------------------------------------
+ * SAD entries
+ * -------------------------------------------------------------------------- */
+
+int xdp_steer_apply(xdp_steer_t *s, const p4rt_op_t *ops, size_t count)
+{
+    if (!s || (!ops && count))
+        return -1;
+
+    int failed = 0;
+    pthread_mutex_lock(&s->lock);
+    for (size_t i = 0; i < count; i++) {
+        const p4rt_op_t *op = &ops[i];
+        if (op->type != P4RT_OP_SAD_ADD && op->type != P4RT_OP_SAD_DELETE)
+            continue;
+
+        xdp_steer_sad_key_t key;
+        if (xdp_steer_sad_key(&op->sad_key, &op->sad_mask, &key) != 0) {
+            s->stats.sad_skipped++;
+            continue;
+        }
+
+        int rc;
+        if (op->type == P4RT_OP_SAD_ADD) {
+            xdp_steer_sad_val_t v;
+            memcpy(v.node_id, op->node_id, STRANDLINK_NODE_ID_LEN);
+            rc = s->cfg.update_fn(XDP_STEER_MAP_SAD, &key, &v, s->cfg.map_ctx);
+            if (rc == 0)
+                s->stats.sad_installed++;
+            else
+                s->cfg.delete_fn(XDP_STEER_MAP_SAD, &key, s->cfg.map_ctx);
+        } else {
+            rc = s->cfg.delete_fn(XDP_STEER_MAP_SAD, &key, s->cfg.map_ctx);
+            if (rc == 0)
+                s->stats.sad_removed++;
+        }
+        if (rc != 0) {
+            s->stats.failed++;
+            failed++;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    return failed;
+}
+
+void xdp_steer_stats(const xdp_steer_t *s, xdp_steer_stats_t *out)
+{
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!s) return;
+
+    xdp_steer_t *m = (xdp_steer_t *)s;
+    pthread_mutex_lock(&m->lock);
+    *out = m->stats;
+    pthread_mutex_unlock(&m->lock);
+}
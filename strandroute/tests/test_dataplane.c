@@ -0,0 +1,318 @@
+/*
+ * test_dataplane.c - Forwarding runtime tests
+ */
+
+#define _POSIX_C_SOURCE 200809L  /* clock_gettime */
+
+#include "strandroute/dataplane.h"
+#include "strandroute/forwarding.h"
+#include "strandroute/node_table.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/sad.h"
+#include "strandroute/types.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Helpers
+ * -------------------------------------------------------------------------- */
+
+#define DP_FLOWS   16
+#define DP_FRAMES  400
+
+static routing_table_t *dp_table(void)
+{
+    routing_table_t *rt = routing_table_create(16);
+    if (!rt) return NULL;
+    for (uint32_t i = 0; i < 8; i++) {
+        route_entry_t e;
+        memset(&e, 0, sizeof(e));
+        e.node_id[0]  = 0xF0;
+        e.node_id[1]  = (uint8_t)i;
+        e.latency_us  = 1000 + 500 * i;
+        e.cost_milli  = 100;
+        e.trust_level = 2;
+        e.region_code = 840;
+        sad_init(&e.capabilities);
+        sad_add_uint32(&e.capabilities, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN);
+        routing_table_insert(rt, &e);
+    }
+    return rt;
+}
+
+static void dp_frame(strandlink_frame_t *f, int flow, uint32_t seq)
+{
+    memset(&f->header, 0, sizeof(f->header));
+    f->header.ttl = 8;
+    f->header.sequence = seq;
+    f->header.src_node_id[0] = 0x10;
+    f->header.src_node_id[1] = (uint8_t)flow;
+    f->header.stream_id[0]   = (uint8_t)(flow * 7);
+
+    sad_t q;
+    sad_init(&q);
+    sad_add_uint32(&q, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN);
+    int n = sad_encode(&q, f->payload, SAD_MAX_SIZE);
+    f->header.options_offset = 0;
+    f->header.options_length = (uint16_t)n;
+    f->header.payload_length = (uint16_t)n;
+}
+
+static atomic_int g_local;
+
+static int dp_local(strandlink_port_t port, strandlink_frame_t *frame, void *ctx)
+{
+    (void)port;
+    (void)frame;
+    (void)ctx;
+    atomic_fetch_add(&g_local, 1);
+    return 0;
+}
+
+typedef struct {
+    int      received;
+    int      misordered;
+    int      wrong_queue;
+    int64_t  last_seq[DP_FLOWS];
+} dp_sink_t;
+
+static void dp_drain(dataplane_t *dp, dp_sink_t *sink)
+{
+    strandlink_frame_t probe;
+    for (int w = 0; w < dataplane_num_workers(dp); w++) {
+        strandlink_ring_buffer_t *tx = dataplane_tx_ring(dp, w);
+        const uint8_t *slot;
+        while ((slot = strandlink_ring_buffer_peek(tx)) != NULL) {
+            memcpy(&probe.header, slot + DATAPLANE_TX_META_SIZE,
+                   sizeof(probe.header));
+            strandlink_ring_buffer_release(tx);
+
+            int flow = probe.header.src_node_id[1];
+            if (flow >= DP_FLOWS) continue;
+            if ((int64_t)probe.header.sequence <= sink->last_seq[flow])
+                sink->misordered++;
+            sink->last_seq[flow] = probe.header.sequence;
+            if (dataplane_queue_for(dp, &probe) != w)
+                sink->wrong_queue++;
+            if (probe.header.dst_node_id[0] != 0xF0 || probe.header.ttl != 7)
+                sink->misordered++;
+            sink->received++;
+        }
+    }
+}
+
+static uint64_t dp_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: frames flow RX -> workers -> TX, per-flow order kept
+ * -------------------------------------------------------------------------- */
+
+static int test_dataplane_forwarding(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = dp_table();
+    TASSERT(rt != NULL);
+    uint8_t self[STRANDLINK_NODE_ID_LEN] = { 0x55 };
+    forwarding_engine_t eng;
+    forwarding_engine_init(&eng, self, rt, NULL, NULL);
+
+    dataplane_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.num_workers   = 3;
+    cfg.rx_ring_slots = 64;
+    cfg.tx_ring_slots = 128;          /* > RX: the drain never falls behind */
+    cfg.slot_size     = 512;
+    cfg.idle_spins    = 64;
+    cfg.max_sleep_us  = 200;
+    cfg.local_fn      = dp_local;
+    atomic_store(&g_local, 0);
+
+    TASSERT(dataplane_create(&eng, &(dataplane_config_t){ .rx_ring_slots = 3 }) == NULL);
+    dataplane_t *dp = dataplane_create(&eng, &cfg);
+    TASSERT(dp != NULL);
+    TASSERT(dataplane_num_workers(dp) == 3);
+    TASSERT(dataplane_start(dp) == 0);
+    TASSERT(dataplane_start(dp) == -1);
+
+    dp_sink_t sink;
+    memset(&sink, 0, sizeof(sink));
+    for (int f = 0; f < DP_FLOWS; f++)
+        sink.last_seq[f] = -1;
+
+    strandlink_frame_t *frame = malloc(sizeof(strandlink_frame_t));
+    TASSERT(frame != NULL);
+
+    /* Oversized frames are refused at submit */
+    dp_frame(frame, 0, 0);
+    frame->header.payload_length = 1000;
+    TASSERT(dataplane_submit(dp, frame) == -1);
+
+    int local = 0;
+    uint64_t deadline = dp_now_ms() + 10000;
+    for (int i = 0; i < DP_FRAMES && dp_now_ms() < deadline; ) {
+        dp_frame(frame, i % DP_FLOWS, (uint32_t)i);
+        if (i % 100 == 99) {
+            node_id_copy(frame->header.dst_node_id, self);
+            local++;
+        }
+        if (dataplane_submit(dp, frame) == 0)
+            i++;
+        dp_drain(dp, &sink);
+    }
+    /* Stopping leaves queued frames in the rings: wait until the workers
+     * have taken every frame, local ones included */
+    dataplane_stats_t st;
+    for (;;) {
+        dp_drain(dp, &sink);
+        dataplane_stats(dp, &st);
+        if ((sink.received == DP_FRAMES - local &&
+             st.rx_frames == DP_FRAMES &&
+             st.local_frames == (uint64_t)local &&
+             atomic_load(&g_local) == local) || dp_now_ms() >= deadline)
+            break;
+    }
+
+    dataplane_stop(dp);
+    dp_drain(dp, &sink);
+
+    TASSERT(sink.received == DP_FRAMES - local);
+    TASSERT(sink.misordered == 0);
+    TASSERT(sink.wrong_queue == 0);
+    TASSERT(atomic_load(&g_local) == local);
+
+    dataplane_stats(dp, &st);
+    TASSERT(st.rx_frames == DP_FRAMES);
+    TASSERT(st.tx_frames == (uint64_t)(DP_FRAMES - local));
+    TASSERT(st.tx_ring_full == 0);
+    TASSERT(st.local_frames == (uint64_t)local);
+    TASSERT(st.rx_dropped >= 1);
+    TASSERT(forwarding_engine_frames_forwarded(&eng) ==
+            (uint64_t)(DP_FRAMES - local));
+
+    free(frame);
+    dataplane_destroy(dp);
+    TASSERT(eng.send_burst_fn == NULL);
+    forwarding_engine_destroy(&eng);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: each frame leaves on the port the engine chose for it
+ * -------------------------------------------------------------------------- */
+
+#define DP_PORT_A  3
+#define DP_PORT_B  7
+
+static int test_dataplane_egress_port(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = dp_table();
+    node_table_t *nt = node_table_create(64);
+    TASSERT(rt != NULL && nt != NULL);
+    uint8_t self[STRANDLINK_NODE_ID_LEN] = { 0x55 };
+    uint8_t dst_a[STRANDLINK_NODE_ID_LEN] = { 0xA0, 0x01 };
+    uint8_t dst_b[STRANDLINK_NODE_ID_LEN] = { 0xB0, 0x02 };
+    TASSERT(node_table_insert(nt, dst_a, DP_PORT_A, NULL) == 0);
+    TASSERT(node_table_insert(nt, dst_b, DP_PORT_B, NULL) == 0);
+
+    forwarding_engine_t eng;
+    forwarding_engine_init(&eng, self, rt, NULL, NULL);
+    forwarding_engine_set_node_table(&eng, nt);
+
+    dataplane_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.num_workers   = 2;
+    cfg.rx_ring_slots = 64;
+    cfg.tx_ring_slots = 64;
+    cfg.slot_size     = 512;
+    cfg.idle_spins    = 64;
+    cfg.max_sleep_us  = 200;
+    dataplane_t *dp = dataplane_create(&eng, &cfg);
+    TASSERT(dp != NULL);
+
+    /* Queue everything first, so each worker's bursts interleave both
+     * destinations and the engine splits them per port */
+    strandlink_frame_t *frame = malloc(sizeof(strandlink_frame_t));
+    TASSERT(frame != NULL);
+    int want_a = 0, want_b = 0;
+    for (int i = 0; i < 48; i++) {
+        dp_frame(frame, i % DP_FLOWS, (uint32_t)i);
+        if (i % 3 == 0) {
+            node_id_copy(frame->header.dst_node_id, dst_b);
+            want_b++;
+        } else {
+            node_id_copy(frame->header.dst_node_id, dst_a);
+            want_a++;
+        }
+        TASSERT(dataplane_submit(dp, frame) == 0);
+    }
+    TASSERT(dataplane_start(dp) == 0);
+
+    int got_a = 0, got_b = 0, wrong = 0;
+    uint64_t deadline = dp_now_ms() + 10000;
+    while (got_a + got_b < want_a + want_b && dp_now_ms() < deadline) {
+        for (int w = 0; w < dataplane_num_workers(dp); w++) {
+            strandlink_ring_buffer_t *tx = dataplane_tx_ring(dp, w);
+            const uint8_t *slot;
+            while ((slot = strandlink_ring_buffer_peek(tx)) != NULL) {
+                dataplane_tx_meta_t meta;
+                strandlink_frame_header_t hdr;
+                memcpy(&meta, slot, sizeof(meta));
+                memcpy(&hdr, slot + DATAPLANE_TX_META_SIZE, sizeof(hdr));
+                strandlink_ring_buffer_release(tx);
+
+                if (node_id_equal(hdr.dst_node_id, dst_a) &&
+                    meta.port == DP_PORT_A)
+                    got_a++;
+                else if (node_id_equal(hdr.dst_node_id, dst_b) &&
+                         meta.port == DP_PORT_B)
+                    got_b++;
+                else
+                    wrong++;
+            }
+        }
+    }
+    dataplane_stop(dp);
+
+    TASSERT(got_a == want_a);
+    TASSERT(got_b == want_b);
+    TASSERT(wrong == 0);
+
+    free(frame);
+    dataplane_destroy(dp);
+    forwarding_engine_destroy(&eng);
+    node_table_destroy(nt);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_dataplane_tests(void)
+{
+    test_register("dataplane_forwarding",  test_dataplane_forwarding);
+    test_register("dataplane_egress_port", test_dataplane_egress_port);
+}
@@ -0,0 +1,183 @@
+/*
+ * test_epoch.c - Epoch-based reclamation tests
+ */
+
+#include "strandroute/epoch.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/sad.h"
+
+#include <pthread.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+static int g_freed;
+
+static void count_free(void *p)
+{
+    (void)p;
+    g_freed++;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: retired objects outlive every read section that could see them
+ * -------------------------------------------------------------------------- */
+
+static int test_epoch_deferred_free(void)
+{
+    int errors = 0;
+    static int a, b;
+
+    epoch_domain_t *d = epoch_domain_create();
+    TASSERT(d != NULL);
+    g_freed = 0;
+
+    /* No readers: reclaimed straight away */
+    epoch_retire(d, &a, count_free);
+    TASSERT(g_freed == 1);
+    TASSERT(epoch_reclaim(d) == 0);
+
+    /* Inside a (nested) read section nothing is freed */
+    TASSERT(epoch_enter(d) == 0);
+    TASSERT(epoch_enter(d) == 0);
+    epoch_retire(d, &b, count_free);
+    TASSERT(epoch_reclaim(d) == 1);
+    epoch_exit(d);
+    TASSERT(epoch_reclaim(d) == 1);
+    TASSERT(g_freed == 1);
+    epoch_exit(d);
+
+    TASSERT(epoch_reclaim(d) == 0);
+    TASSERT(g_freed == 2);
+
+    /* Destroy frees whatever is still pending */
+    TASSERT(epoch_enter(d) == 0);
+    epoch_retire(d, &a, count_free);
+    epoch_exit(d);
+    epoch_domain_destroy(d);
+    TASSERT(g_freed == 3);
+
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: a reader on another thread holds back reclamation until it exits;
+ *       exited threads do not
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    epoch_domain_t *d;
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;
+    int             stage;   /* 1 = entered, 2 = may exit */
+} epoch_peer_t;
+
+static void *epoch_peer(void *arg)
+{
+    epoch_peer_t *p = arg;
+    epoch_enter(p->d);
+
+    pthread_mutex_lock(&p->mu);
+    p->stage = 1;
+    pthread_cond_broadcast(&p->cv);
+    while (p->stage != 2)
+        pthread_cond_wait(&p->cv, &p->mu);
+    pthread_mutex_unlock(&p->mu);
+
+    epoch_exit(p->d);
+    return NULL;
+}
+
+static int test_epoch_cross_thread(void)
+{
+    int errors = 0;
+    static int obj;
+
+    epoch_peer_t p;
+    memset(&p, 0, sizeof(p));
+    p.d = epoch_domain_create();
+    pthread_mutex_init(&p.mu, NULL);
+    pthread_cond_init(&p.cv, NULL);
+    g_freed = 0;
+
+    pthread_t th;
+    pthread_create(&th, NULL, epoch_peer, &p);
+
+    pthread_mutex_lock(&p.mu);
+    while (p.stage != 1)
+        pthread_cond_wait(&p.cv, &p.mu);
+    pthread_mutex_unlock(&p.mu);
+
+    epoch_retire(p.d, &obj, count_free);
+    TASSERT(epoch_reclaim(p.d) == 1);
+    TASSERT(g_freed == 0);
+
+    pthread_mutex_lock(&p.mu);
+    p.stage = 2;
+    pthread_cond_broadcast(&p.cv);
+    pthread_mutex_unlock(&p.mu);
+    pthread_join(th, NULL);
+
+    TASSERT(epoch_reclaim(p.d) == 0);
+    TASSERT(g_freed == 1);
+
+    epoch_domain_destroy(p.d);
+    pthread_cond_destroy(&p.cv);
+    pthread_mutex_destroy(&p.mu);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: structural writes publish without waiting on a pinned reader, and
+ *       the pinned snapshot stays intact
+ * -------------------------------------------------------------------------- */
+
+static int test_epoch_write_while_pinned(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = routing_table_create(4);
+    route_entry_t e;
+    memset(&e, 0, sizeof(e));
+    sad_init(&e.capabilities);
+    e.node_id[0] = 1;
+    TASSERT(routing_table_insert(rt, &e) == 0);
+
+    const routing_table_view_t *view = routing_table_pin(rt);
+    TASSERT(view != NULL);
+
+    /* Each of these used to block forever draining the pinned snapshot */
+    for (uint8_t i = 2; i < 40; i++) {
+        e.node_id[0] = i;
+        TASSERT(routing_table_insert(rt, &e) == 0);
+    }
+    uint8_t first[16] = { 1 };
+    TASSERT(routing_table_remove(rt, first) == 0);
+
+    TASSERT(routing_table_view_count(view) == 1);
+    TASSERT(routing_table_view_entry(view, 0)->node_id[0] == 1);
+    routing_table_unpin(view);
+
+    TASSERT(routing_table_size(rt) == 38);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_epoch_tests(void)
+{
+    test_register("epoch_deferred_free",      test_epoch_deferred_free);
+    test_register("epoch_cross_thread",       test_epoch_cross_thread);
+    test_register("epoch_write_while_pinned", test_epoch_write_while_pinned);
+}
@@ -0,0 +1,998 @@
+/*
+ * test_forwarding.c - Resolve cache + forwarding engine tests
+ */
+
+#include "strandroute/forwarding.h"
+#include "strandroute/hop_load.h"
+#include "strandroute/node_table.h"
+#include "strandroute/resolve_cache.h"
+#include "strandroute/resolver.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/sad.h"
+#include "strandroute/sad_match.h"
+#include "strandroute/types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Helpers
+ * -------------------------------------------------------------------------- */
+
+#define FWD_TEST_ROWS 64
+
+static route_entry_t fwd_entry(uint32_t i)
+{
+    route_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.node_id[0]  = 0xF0;
+    e.node_id[1]  = (uint8_t)i;
+    e.latency_us  = 1000 + 997 * (i % 13);
+    e.cost_milli  = 100 + 37 * (i % 7);
+    e.trust_level = (uint8_t)(i % 4);
+    e.region_code = (i % 2) ? 840 : 276;
+
+    sad_init(&e.capabilities);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CAPABILITY,
+                   CAP_TEXT_GEN | ((i % 3) ? CAP_CODE_GEN : 0));
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CONTEXT_WINDOW, 8192u << (i % 4));
+    return e;
+}
+
+static routing_table_t *fwd_table(void)
+{
+    routing_table_t *rt = routing_table_create(16);
+    if (!rt) return NULL;
+    for (uint32_t i = 0; i < FWD_TEST_ROWS; i++) {
+        route_entry_t e = fwd_entry(i);
+        routing_table_insert(rt, &e);
+    }
+    return rt;
+}
+
+static void fwd_query(sad_t *q)
+{
+    sad_init(q);
+    sad_add_uint32(q, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN | CAP_CODE_GEN);
+    sad_add_uint32(q, SAD_FIELD_MAX_LATENCY_MS, 20);
+    sad_add_uint8(q, SAD_FIELD_TRUST_LEVEL, 1);
+}
+
+static int hits_equal(const sad_hit_t *a, int na, const sad_hit_t *b, int nb)
+{
+    if (na != nb) return 0;
+    for (int i = 0; i < na; i++) {
+        if (a[i].index != b[i].index || a[i].score != b[i].score)
+            return 0;
+    }
+    return 1;
+}
+
+/* Frame carrying @q as its options area */
+static void fwd_frame(strandlink_frame_t *f, const sad_t *q)
+{
+    memset(&f->header, 0, sizeof(f->header));
+    f->header.ttl = 8;
+    f->header.dst_node_id[0] = 0xAA;
+
+    int n = sad_encode(q, f->payload, SAD_MAX_SIZE);
+    f->header.options_offset = 0;
+    f->header.options_length = (uint16_t)(n > 0 ? n : 0);
+    f->header.payload_length = (uint16_t)(n > 0 ? n : 0);
+}
+
+static int fwd_send_ok(strandlink_port_t port, const strandlink_frame_t *frame,
+                       void *ctx)
+{
+    (void)port;
+    (void)frame;
+    (void)ctx;
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: cached hits equal direct lookups and follow table changes
+ * -------------------------------------------------------------------------- */
+
+static int test_resolve_cache_invalidation(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = fwd_table();
+    TASSERT(rt != NULL);
+    resolve_cache_t *cache = resolve_cache_create(NULL);
+    TASSERT(cache != NULL);
+
+    sad_t query;
+    fwd_query(&query);
+    sad_query_t q;
+    sad_query_compile(&query, &q);
+
+    sad_hit_t want[4], got[4];
+    resolve_cache_stats_t st;
+
+    /* Miss, then hit on the same snapshot */
+    const routing_table_view_t *v = routing_table_pin(rt);
+    int nw = routing_table_view_lookup(v, &q, NULL, want, 4);
+    TASSERT(nw > 0);
+    int ng = resolve_cache_lookup(cache, v, &q, NULL, got, 4);
+    TASSERT(hits_equal(want, nw, got, ng));
+    memset(got, 0, sizeof(got));
+    ng = resolve_cache_lookup(cache, v, &q, NULL, got, 4);
+    TASSERT(hits_equal(want, nw, got, ng));
+    resolve_cache_stats(cache, &st);
+    TASSERT(st.misses == 1 && st.hits == 1);
+
+    /* Same constraints in another field order: canonical, so a hit */
+    sad_t reordered;
+    sad_init(&reordered);
+    sad_add_uint8(&reordered, SAD_FIELD_TRUST_LEVEL, 1);
+    sad_add_uint32(&reordered, SAD_FIELD_MAX_LATENCY_MS, 20);
+    sad_add_uint32(&reordered, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN | CAP_CODE_GEN);
+    sad_query_t q2;
+    sad_query_compile(&reordered, &q2);
+    ng = resolve_cache_lookup(cache, v, &q2, NULL, got, 4);
+    TASSERT(hits_equal(want, nw, got, ng));
+
+    /* A different K is a different key */
+    ng = resolve_cache_lookup(cache, v, &q, NULL, got, 2);
+    TASSERT(ng == 2 && hits_equal(want, 2, got, 2));
+    resolve_cache_stats(cache, &st);
+    TASSERT(st.misses == 2 && st.hits == 2);
+    uint64_t gen = routing_table_view_generation(v);
+    route_entry_t best = *routing_table_view_entry(v, want[0].index);
+    routing_table_unpin(v);
+
+    /* Metrics-only change: same generation, still exact without a TTL */
+    TASSERT(routing_table_update_metrics(rt, best.node_id, 19000000, 0.9f) == 0);
+
+    v = routing_table_pin(rt);
+    TASSERT(routing_table_view_generation(v) == gen);
+    nw = routing_table_view_lookup(v, &q, NULL, want, 4);
+    ng = resolve_cache_lookup(cache, v, &q, NULL, got, 4);
+    TASSERT(hits_equal(want, nw, got, ng));
+    resolve_cache_stats(cache, &st);
+    TASSERT(st.misses == 3);
+    routing_table_unpin(v);
+
+    /* Structural change: new generation */
+    route_entry_t extra = fwd_entry(1);
+    extra.node_id[1] = 0xEE;
+    extra.latency_us = 1;
+    TASSERT(routing_table_insert(rt, &extra) == 0);
+
+    v = routing_table_pin(rt);
+    TASSERT(routing_table_view_generation(v) > gen);
+    nw = routing_table_view_lookup(v, &q, NULL, want, 4);
+    ng = resolve_cache_lookup(cache, v, &q, NULL, got, 4);
+    TASSERT(hits_equal(want, nw, got, ng));
+    resolve_cache_stats(cache, &st);
+    TASSERT(st.misses == 4);
+
+    /* Oversized K bypasses the cache */
+    sad_hit_t many[RESOLVE_CACHE_MAX_HITS + 1];
+    TASSERT(resolve_cache_lookup(cache, v, &q, NULL, many,
+                                 RESOLVE_CACHE_MAX_HITS + 1) > 0);
+    resolve_cache_stats(cache, &st);
+    TASSERT(st.misses == 4 && st.hits == 2);
+    routing_table_unpin(v);
+
+    resolve_cache_destroy(cache);
+
+    /* With a staleness bound, metric updates keep serving the old hits */
+    resolve_cache_config_t cfg = { .entries = 16, .metrics_ttl_ns = 3600ull * 1000000000ull };
+    cache = resolve_cache_create(&cfg);
+    TASSERT(cache != NULL);
+
+    v = routing_table_pin(rt);
+    nw = resolve_cache_lookup(cache, v, &q, NULL, want, 4);
+    routing_table_unpin(v);
+    TASSERT(routing_table_update_metrics(rt, best.node_id, 1, 0.0f) == 0);
+    v = routing_table_pin(rt);
+    ng = resolve_cache_lookup(cache, v, &q, NULL, got, 4);
+    TASSERT(hits_equal(want, nw, got, ng));
+    resolve_cache_stats(cache, &st);
+    TASSERT(st.hits == 1 && st.stale_hits == 1 && st.misses == 1);
+    routing_table_unpin(v);
+
+    resolve_cache_destroy(cache);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: engine counts cache hits per frame
+ * -------------------------------------------------------------------------- */
+
+static int test_forwarding_cache_stats(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = fwd_table();
+    TASSERT(rt != NULL);
+
+    uint8_t self[STRANDLINK_NODE_ID_LEN] = { 0x55 };
+    forwarding_engine_t eng;
+    forwarding_engine_init(&eng, self, rt, fwd_send_ok, NULL);
+
+    sad_t query;
+    fwd_query(&query);
+    strandlink_frame_t *frame = malloc(sizeof(strandlink_frame_t));
+    TASSERT(frame != NULL);
+
+    for (int i = 0; i < 5; i++) {
+        fwd_frame(frame, &query);
+        TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == 0);
+        TASSERT(frame->header.dst_node_id[0] == 0xF0);
+    }
+    TASSERT(forwarding_engine_frames_forwarded(&eng) == 5);
+
+    resolve_cache_stats_t st;
+    forwarding_engine_cache_stats(&eng, &st);
+    TASSERT(st.misses == 1 && st.hits == 4);
+
+    /* A malformed SAD is dropped before reaching the cache */
+    fwd_frame(frame, &query);
+    frame->payload[0] = SAD_VERSION + 1;
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == -1);
+    TASSERT(forwarding_engine_frames_dropped(&eng) == 1);
+    forwarding_engine_cache_stats(&eng, &st);
+    TASSERT(st.misses + st.hits == 5);
+
+    forwarding_engine_destroy(&eng);
+
+    /* Disabled cache: same forwarding, no counters */
+    forwarding_engine_init(&eng, self, rt, fwd_send_ok, NULL);
+    forwarding_engine_set_cache(&eng, NULL);
+    fwd_frame(frame, &query);
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == 0);
+    forwarding_engine_cache_stats(&eng, &st);
+    TASSERT(st.misses == 0 && st.hits == 0);
+    forwarding_engine_destroy(&eng);
+
+    free(frame);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: per-thread caches under concurrent forwarding
+ * -------------------------------------------------------------------------- */
+
+#define FWD_THREADS 4
+#define FWD_FRAMES  2000
+
+typedef struct {
+    forwarding_engine_t *eng;
+    int                  failures;
+} fwd_worker_arg_t;
+
+static void *fwd_worker(void *arg)
+{
+    fwd_worker_arg_t *a = arg;
+    strandlink_frame_t *frame = malloc(sizeof(strandlink_frame_t));
+    if (!frame) { a->failures = FWD_FRAMES; return NULL; }
+
+    sad_t query;
+    fwd_query(&query);
+    for (int i = 0; i < FWD_FRAMES; i++) {
+        fwd_frame(frame, &query);
+        if (forwarding_engine_process_frame(a->eng, frame, 0) != 0)
+            a->failures++;
+    }
+    free(frame);
+    return NULL;
+}
+
+static int test_forwarding_cache_threads(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = fwd_table();
+    TASSERT(rt != NULL);
+
+    uint8_t self[STRANDLINK_NODE_ID_LEN] = { 0x55 };
+    forwarding_engine_t eng;
+    forwarding_engine_init(&eng, self, rt, fwd_send_ok, NULL);
+
+    pthread_t th[FWD_THREADS];
+    fwd_worker_arg_t args[FWD_THREADS];
+    for (int i = 0; i < FWD_THREADS; i++) {
+        args[i].eng = &eng;
+        args[i].failures = 0;
+        pthread_create(&th[i], NULL, fwd_worker, &args[i]);
+    }
+
+    /* Writer: republish while forwarding, invalidating every cache */
+    for (uint32_t i = 0; i < 20; i++) {
+        route_entry_t e = fwd_entry(i);
+        e.cost_milli += 1;
+        routing_table_insert(rt, &e);
+    }
+
+    for (int i = 0; i < FWD_THREADS; i++) {
+        pthread_join(th[i], NULL);
+        TASSERT(args[i].failures == 0);
+    }
+
+    resolve_cache_stats_t st;
+    forwarding_engine_cache_stats(&eng, &st);
+    TASSERT(st.hits + st.misses == (uint64_t)FWD_THREADS * FWD_FRAMES);
+    TASSERT(st.hits > 0);
+    TASSERT(forwarding_engine_frames_forwarded(&eng) ==
+            (uint64_t)FWD_THREADS * FWD_FRAMES);
+
+    /* Per-thread blocks sum to the totals */
+    forwarding_stats_t *fs = malloc(sizeof(*fs));
+    TASSERT(fs != NULL);
+    forwarding_engine_stats(&eng, fs);
+    TASSERT(fs->frames_resolved == (uint64_t)FWD_THREADS * FWD_FRAMES);
+    TASSERT(fs->resolve_ns.count == (uint64_t)FWD_THREADS * FWD_FRAMES);
+    TASSERT(fs->cache.hits == st.hits);
+    free(fs);
+
+    forwarding_engine_destroy(&eng);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: burst path matches per-frame semantics with one send per chunk
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    int calls;
+    int frames;
+    int accept;        /* frames accepted per call, -1 = all */
+} burst_sink_t;
+
+static int fwd_send_burst(strandlink_port_t port,
+                          strandlink_frame_t *const *frames, int count,
+                          void *ctx)
+{
+    (void)port;
+    (void)frames;
+    burst_sink_t *sink = ctx;
+    sink->calls++;
+    sink->frames += count;
+    if (sink->accept >= 0 && sink->accept < count)
+        return sink->accept;
+    return count;
+}
+
+#define BURST_FRAMES 100
+
+static int test_forwarding_burst(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = fwd_table();
+    TASSERT(rt != NULL);
+
+    uint8_t self[STRANDLINK_NODE_ID_LEN] = { 0x55 };
+    forwarding_engine_t eng;
+    forwarding_engine_init(&eng, self, rt, fwd_send_ok, NULL);
+    burst_sink_t sink = { 0, 0, -1 };
+    forwarding_engine_set_burst_send(&eng, fwd_send_burst, &sink);
+
+    /* Three distinct descriptors, plus a local, an expired and a
+     * malformed frame in the first chunk */
+    sad_t queries[3];
+    for (int i = 0; i < 3; i++) {
+        fwd_query(&queries[i]);
+        sad_add_uint32(&queries[i], SAD_FIELD_MAX_COST_MILLI, 300 + 100 * (uint32_t)i);
+    }
+
+    strandlink_frame_t *frames[BURST_FRAMES];
+    for (int i = 0; i < BURST_FRAMES; i++) {
+        frames[i] = malloc(sizeof(strandlink_frame_t));
+        TASSERT(frames[i] != NULL);
+        fwd_frame(frames[i], &queries[i % 3]);
+    }
+    node_id_copy(frames[3]->header.dst_node_id, self);
+    frames[4]->header.ttl = 0;
+    frames[5]->payload[0] = SAD_VERSION + 1;
+
+    int fwd = forwarding_engine_process_burst(&eng, frames, BURST_FRAMES);
+    TASSERT(fwd == BURST_FRAMES - 3);
+    TASSERT(forwarding_engine_frames_forwarded(&eng) == BURST_FRAMES - 3);
+    TASSERT(forwarding_engine_frames_dropped(&eng) == 2);
+    TASSERT(sink.calls == 2);                /* 64 + 36 */
+    TASSERT(sink.frames == BURST_FRAMES - 3);
+
+    /* Local frame untouched; routed frames rewritten to table entries */
+    TASSERT(node_id_equal(frames[3]->header.dst_node_id, self));
+    TASSERT(frames[3]->header.ttl == 8);
+    for (int i = 6; i < BURST_FRAMES; i++) {
+        TASSERT(frames[i]->header.dst_node_id[0] == 0xF0);
+        TASSERT(frames[i]->header.ttl == 7);
+    }
+
+    /* One resolve per distinct SAD per chunk: the second chunk hits */
+    resolve_cache_stats_t st;
+    forwarding_engine_cache_stats(&eng, &st);
+    TASSERT(st.misses == 3);
+    TASSERT(st.hits == 3);
+
+    /* Partial acceptance by the transmit side counts the rest as drops */
+    sink.accept = 10;
+    for (int i = 0; i < BURST_FRAMES; i++)
+        fwd_frame(frames[i], &queries[i % 3]);
+    fwd = forwarding_engine_process_burst(&eng, frames, FWD_BURST_MAX);
+    TASSERT(fwd == 10);
+    TASSERT(forwarding_engine_frames_dropped(&eng) == 2 + FWD_BURST_MAX - 10);
+
+    /* Without a burst callback, send_fn is called per frame */
+    forwarding_engine_set_burst_send(&eng, NULL, NULL);
+    for (int i = 0; i < BURST_FRAMES; i++)
+        fwd_frame(frames[i], &queries[i % 3]);
+    TASSERT(forwarding_engine_process_burst(&eng, frames, 7) == 7);
+
+    TASSERT(forwarding_engine_process_burst(&eng, frames, 0) == 0);
+    TASSERT(forwarding_engine_process_burst(NULL, frames, 1) == -1);
+
+    for (int i = 0; i < BURST_FRAMES; i++)
+        free(frames[i]);
+    forwarding_engine_destroy(&eng);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: drop reasons, histograms and the Prometheus rendering
+ * -------------------------------------------------------------------------- */
+
+static int fwd_send_fail(strandlink_port_t port, const strandlink_frame_t *frame,
+                         void *ctx)
+{
+    (void)port;
+    (void)frame;
+    (void)ctx;
+    return -1;
+}
+
+static int test_forwarding_stats_export(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = fwd_table();
+    TASSERT(rt != NULL);
+
+    uint8_t self[STRANDLINK_NODE_ID_LEN] = { 0x55 };
+    forwarding_engine_t eng;
+    forwarding_engine_init(&eng, self, rt, fwd_send_ok, NULL);
+
+    strandlink_frame_t *frame = malloc(sizeof(strandlink_frame_t));
+    TASSERT(frame != NULL);
+    sad_t query, nomatch;
+    fwd_query(&query);
+    const uint16_t every_region[] = { 276, 840 };
+    fwd_query(&nomatch);
+    sad_add_regions(&nomatch, SAD_FIELD_REGION_EXCLUDE, every_region, 2);
+
+    /* 5 forwarded, one of each drop reason, 2 local */
+    for (int i = 0; i < 5; i++) {
+        fwd_frame(frame, &query);
+        TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == 0);
+    }
+    fwd_frame(frame, &query);
+    frame->header.ttl = 0;
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == -1);
+    fwd_frame(frame, &query);
+    frame->header.options_length = 0;
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == -1);
+    fwd_frame(frame, &nomatch);
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == -1);
+    for (int i = 0; i < 2; i++) {
+        fwd_frame(frame, &query);
+        node_id_copy(frame->header.dst_node_id, self);
+        TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == 0);
+    }
+    eng.send_fn = fwd_send_fail;
+    fwd_frame(frame, &query);
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == -1);
+
+    forwarding_stats_t *st = malloc(sizeof(*st));
+    TASSERT(st != NULL);
+    forwarding_engine_stats(&eng, st);
+    TASSERT(st->frames_forwarded == 5);
+    TASSERT(st->frames_local == 2);
+    TASSERT(st->drops[FWD_DROP_TTL] == 1);
+    TASSERT(st->drops[FWD_DROP_NO_SAD] == 1);
+    TASSERT(st->drops[FWD_DROP_NO_MATCH] == 1);
+    TASSERT(st->drops[FWD_DROP_SEND] == 1);
+    TASSERT(st->frames_dropped == 4);
+    TASSERT(st->frames_dropped == forwarding_engine_frames_dropped(&eng));
+    TASSERT(st->resolve_failures == 1);
+    TASSERT(st->frames_resolved == 6);
+
+    /* 7 resolves: 2 misses scored the table, 5 cache hits scored nothing */
+    TASSERT(st->cache.misses == 2 && st->cache.hits == 5);
+    TASSERT(st->resolve_ns.count == 7);
+    TASSERT(st->candidates.count == 7);
+    TASSERT(st->candidates.max > 0 && st->candidates.max <= 2 * FWD_TEST_ROWS);
+    TASSERT(forwarding_histogram_quantile(&st->candidates, 0.5) == 0);
+    TASSERT(forwarding_histogram_quantile(&st->candidates, 1.0) ==
+            st->candidates.max);
+    TASSERT(st->top_k.count == 7);
+    TASSERT(st->top_k.max == 3);           /* default max_multipath */
+    TASSERT(forwarding_histogram_quantile(&st->top_k, 0.99) == 3);
+
+    forwarding_histogram_t h;
+    memset(&h, 0, sizeof(h));
+    TASSERT(forwarding_histogram_quantile(&h, 0.5) == 0);
+
+    char *text = malloc(16384);
+    TASSERT(text != NULL);
+    int n = forwarding_stats_export(st, text, 16384);
+    TASSERT(n > 0 && (size_t)n == strlen(text));
+    TASSERT(strstr(text, "strandroute_frames_forwarded_total 5\n") != NULL);
+    TASSERT(strstr(text, "strandroute_frames_dropped_total{reason=\"ttl\"} 1\n") != NULL);
+    TASSERT(strstr(text, "strandroute_frames_dropped_total{reason=\"send\"} 1\n") != NULL);
+    TASSERT(strstr(text, "strandroute_resolve_cache_hits_total 5\n") != NULL);
+    TASSERT(strstr(text, "# TYPE strandroute_resolve_latency_ns histogram\n") != NULL);
+    TASSERT(strstr(text, "strandroute_resolve_candidates_bucket{le=\"0\"} 5\n") != NULL);
+    TASSERT(strstr(text, "strandroute_resolve_top_k_bucket{le=\"+Inf\"} 7\n") != NULL);
+    TASSERT(strstr(text, "strandroute_resolve_top_k_count 7\n") != NULL);
+    TASSERT(forwarding_stats_export(st, text, 64) == -1);
+
+    free(text);
+    free(st);
+    free(frame);
+    forwarding_engine_destroy(&eng);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: Maglev selection keeps each flow on one next hop
+ * -------------------------------------------------------------------------- */
+
+#define MAGLEV_FLOWS 64
+
+static void fwd_flow_frame(strandlink_frame_t *f, const sad_t *q, int flow)
+{
+    fwd_frame(f, q);
+    f->header.src_node_id[0] = 0x10;
+    f->header.src_node_id[1] = (uint8_t)(flow / 8);
+    f->header.stream_id[7]   = (uint8_t)(flow % 8);
+}
+
+static int test_forwarding_maglev_affinity(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = fwd_table();
+    TASSERT(rt != NULL);
+
+    uint8_t self[STRANDLINK_NODE_ID_LEN] = { 0x55 };
+    forwarding_engine_t eng;
+    forwarding_engine_init(&eng, self, rt, fwd_send_ok, NULL);
+    forwarding_engine_set_select(&eng, FWD_SELECT_MAGLEV);
+    eng.max_multipath = FWD_MAX_NEXT_HOPS;
+
+    sad_t query;
+    fwd_query(&query);
+
+    /* First pass fixes each flow's hop */
+    uint8_t hop[MAGLEV_FLOWS];
+    strandlink_frame_t *frames[MAGLEV_FLOWS];
+    for (int i = 0; i < MAGLEV_FLOWS; i++) {
+        frames[i] = malloc(sizeof(strandlink_frame_t));
+        TASSERT(frames[i] != NULL);
+        fwd_flow_frame(frames[i], &query, i);
+        TASSERT(forwarding_engine_process_frame(&eng, frames[i], 0) == 0);
+        hop[i] = frames[i]->header.dst_node_id[1];
+    }
+
+    /* Flows spread over several hops */
+    int distinct = 0;
+    uint8_t seen[256] = { 0 };
+    for (int i = 0; i < MAGLEV_FLOWS; i++) {
+        if (!seen[hop[i]]) distinct++;
+        seen[hop[i]] = 1;
+    }
+    TASSERT(distinct >= 3);
+
+    /* Repeats, one by one and as a burst, land on the same hop */
+    for (int rep = 0; rep < 3; rep++) {
+        for (int i = 0; i < MAGLEV_FLOWS; i++) {
+            fwd_flow_frame(frames[i], &query, i);
+            TASSERT(forwarding_engine_process_frame(&eng, frames[i], 0) == 0);
+            TASSERT(frames[i]->header.dst_node_id[1] == hop[i]);
+        }
+    }
+    for (int i = 0; i < MAGLEV_FLOWS; i++)
+        fwd_flow_frame(frames[i], &query, MAGLEV_FLOWS - 1 - i);
+    TASSERT(forwarding_engine_process_burst(&eng, frames, MAGLEV_FLOWS) ==
+            MAGLEV_FLOWS);
+    for (int i = 0; i < MAGLEV_FLOWS; i++)
+        TASSERT(frames[i]->header.dst_node_id[1] == hop[MAGLEV_FLOWS - 1 - i]);
+
+    /* A new snapshot with the same candidates keeps the mapping */
+    route_entry_t extra = fwd_entry(200);
+    extra.trust_level = 0;
+    routing_table_insert(rt, &extra);
+    for (int i = 0; i < MAGLEV_FLOWS; i++) {
+        fwd_flow_frame(frames[i], &query, i);
+        TASSERT(forwarding_engine_process_frame(&eng, frames[i], 0) == 0);
+        TASSERT(frames[i]->header.dst_node_id[1] == hop[i]);
+    }
+
+    for (int i = 0; i < MAGLEV_FLOWS; i++)
+        free(frames[i]);
+    forwarding_engine_destroy(&eng);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: FWD_SELECT_P2C follows outstanding requests and latency
+ * -------------------------------------------------------------------------- */
+
+#define P2C_FRAMES 200
+
+static int test_forwarding_p2c(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = fwd_table();
+    hop_load_t *hl = hop_load_create(0);
+    TASSERT(rt != NULL && hl != NULL);
+
+    uint8_t self[STRANDLINK_NODE_ID_LEN] = { 0x55 };
+    forwarding_engine_t eng;
+    forwarding_engine_init(&eng, self, rt, fwd_send_ok, NULL);
+    forwarding_engine_set_select(&eng, FWD_SELECT_P2C);
+    forwarding_engine_set_hop_load(&eng, hl);
+    eng.max_multipath = 2;      /* both hits are compared on every frame */
+
+    sad_t query;
+    fwd_query(&query);
+    strandlink_frame_t *f = malloc(sizeof(*f));
+    TASSERT(f != NULL);
+
+    /* Never completed, sends pile up: traffic alternates between the two */
+    int count[256] = { 0 };
+    uint8_t hop[2] = { 0 };
+    int distinct = 0;
+    for (int i = 0; i < P2C_FRAMES; i++) {
+        fwd_frame(f, &query);
+        TASSERT(forwarding_engine_process_frame(&eng, f, 0) == 0);
+        uint8_t h = f->header.dst_node_id[1];
+        if (count[h]++ == 0 && distinct < 2)
+            hop[distinct++] = h;
+    }
+    TASSERT(distinct == 2);
+    TASSERT(count[hop[0]] + count[hop[1]] == P2C_FRAMES);
+    TASSERT(count[hop[0]] >= 20 && count[hop[1]] >= 20);
+
+    uint8_t id0[STRANDLINK_NODE_ID_LEN] = { 0xF0, hop[0] };
+    uint8_t id1[STRANDLINK_NODE_ID_LEN] = { 0xF0, hop[1] };
+    hop_load_info_t info;
+    TASSERT(hop_load_get(hl, id0, &info) == 0 &&
+            info.inflight == (uint32_t)count[hop[0]]);
+
+    /* Drain both; hop 0 turns slow, so everything goes to hop 1 */
+    for (int i = 0; i < count[hop[0]]; i++)
+        hop_load_done(hl, id0, 1000000);
+    for (int i = 0; i < count[hop[1]]; i++)
+        hop_load_done(hl, id1, 100);
+    for (int i = 0; i < 20; i++) {
+        fwd_frame(f, &query);
+        TASSERT(forwarding_engine_process_frame(&eng, f, 0) == 0);
+        TASSERT(f->header.dst_node_id[1] == hop[1]);
+        hop_load_done(hl, id1, 100);
+    }
+
+    /* The burst path counts what it sends the same way */
+    strandlink_frame_t *frames[4];
+    for (int i = 0; i < 4; i++) {
+        frames[i] = malloc(sizeof(strandlink_frame_t));
+        TASSERT(frames[i] != NULL);
+        fwd_frame(frames[i], &query);
+    }
+    TASSERT(forwarding_engine_process_burst(&eng, frames, 4) == 4);
+    TASSERT(hop_load_get(hl, id1, &info) == 0 && info.inflight == 4);
+
+    for (int i = 0; i < 4; i++)
+        free(frames[i]);
+    free(f);
+    forwarding_engine_destroy(&eng);
+    hop_load_destroy(hl);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: exact node_id entries bypass resolution
+ * -------------------------------------------------------------------------- */
+
+#define EXACT_PORTS 4
+
+typedef struct {
+    int calls;
+    int frames[EXACT_PORTS];
+} port_sink_t;
+
+static int fwd_send_port(strandlink_port_t port, const strandlink_frame_t *frame,
+                         void *ctx)
+{
+    (void)frame;
+    port_sink_t *sink = ctx;
+    sink->calls++;
+    if (port < EXACT_PORTS) sink->frames[port]++;
+    return 0;
+}
+
+static int fwd_send_burst_port(strandlink_port_t port,
+                               strandlink_frame_t *const *frames, int count,
+                               void *ctx)
+{
+    (void)frames;
+    port_sink_t *sink = ctx;
+    sink->calls++;
+    if (port < EXACT_PORTS) sink->frames[port] += count;
+    return count;
+}
+
+static int test_forwarding_exact_fast_path(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = fwd_table();
+    TASSERT(rt != NULL);
+    node_table_t *nt = node_table_create(16);
+    TASSERT(nt != NULL);
+
+    uint8_t aa[STRANDLINK_NODE_ID_LEN] = { 0xAA };
+    uint8_t bb[STRANDLINK_NODE_ID_LEN] = { 0xBB };
+    uint8_t hop[STRANDLINK_NODE_ID_LEN] = { 0xF0, 0x05 };
+    TASSERT(node_table_insert(nt, aa, 2, hop) == 0);
+    TASSERT(node_table_insert(nt, bb, 3, NULL) == 0);
+
+    uint8_t self[STRANDLINK_NODE_ID_LEN] = { 0x55 };
+    port_sink_t sink;
+    memset(&sink, 0, sizeof(sink));
+    forwarding_engine_t eng;
+    forwarding_engine_init(&eng, self, rt, fwd_send_port, &sink);
+    forwarding_engine_set_node_table(&eng, nt);
+
+    sad_t q;
+    fwd_query(&q);
+    strandlink_frame_t *frame = malloc(sizeof(strandlink_frame_t));
+    TASSERT(frame != NULL);
+
+    /* Known destination: rewritten and sent to the entry's port, the SAD
+     * is not looked at */
+    fwd_frame(frame, &q);
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == 0);
+    TASSERT(node_id_equal(frame->header.dst_node_id, hop));
+    TASSERT(frame->header.ttl == 7);
+    TASSERT(sink.frames[2] == 1);
+
+    /* No SAD: forwarded by node_id instead of dropped, unless unknown */
+    fwd_frame(frame, &q);
+    frame->header.options_length = 0;
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == 0);
+    TASSERT(sink.frames[2] == 2);
+    fwd_frame(frame, &q);
+    frame->header.options_length = 0;
+    frame->header.dst_node_id[0] = 0xAB;
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == -1);
+
+    /* Unresolved destination: semantic path, port 0 */
+    fwd_frame(frame, &q);
+    memset(frame->header.dst_node_id, 0, STRANDLINK_NODE_ID_LEN);
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == 0);
+    TASSERT(frame->header.dst_node_id[0] == 0xF0);
+    TASSERT(sink.frames[0] == 1);
+
+    forwarding_stats_t *st = malloc(sizeof(*st));
+    TASSERT(st != NULL);
+    forwarding_engine_stats(&eng, st);
+    TASSERT(st->frames_exact == 2);
+    TASSERT(st->frames_resolved == 1);
+    TASSERT(st->resolve_ns.count == 1);
+    TASSERT(st->drops[FWD_DROP_NO_SAD] == 1);
+    TASSERT(st->frames_forwarded == 3);
+
+    /* Burst: one transmit call per egress port, per-port order kept */
+    memset(&sink, 0, sizeof(sink));
+    forwarding_engine_set_burst_send(&eng, fwd_send_burst_port, &sink);
+    strandlink_frame_t *frames[9];
+    for (int i = 0; i < 9; i++) {
+        frames[i] = malloc(sizeof(strandlink_frame_t));
+        TASSERT(frames[i] != NULL);
+        fwd_frame(frames[i], &q);
+        frames[i]->header.dst_node_id[0] =
+            (i % 3 == 0) ? 0xAA : (i % 3 == 1) ? 0xBB : 0x00;
+    }
+    TASSERT(forwarding_engine_process_burst(&eng, frames, 9) == 9);
+    TASSERT(sink.calls == 3);
+    TASSERT(sink.frames[0] == 3 && sink.frames[2] == 3 && sink.frames[3] == 3);
+    TASSERT(node_id_equal(frames[0]->header.dst_node_id, hop));
+    TASSERT(node_id_equal(frames[1]->header.dst_node_id, bb));
+    TASSERT(frames[2]->header.dst_node_id[0] == 0xF0);
+
+    /* Deleted entry: back to resolving */
+    TASSERT(node_table_delete(nt, aa) == 0);
+    fwd_frame(frame, &q);
+    TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == 0);
+    forwarding_engine_stats(&eng, st);
+    TASSERT(st->frames_exact == 8);
+    TASSERT(st->frames_resolved == 5);
+
+    char *text = malloc(16384);
+    TASSERT(text != NULL);
+    TASSERT(forwarding_stats_export(st, text, 16384) > 0);
+    TASSERT(strstr(text, "strandroute_frames_exact_total 8\n") != NULL);
+    free(text);
+
+    for (int i = 0; i < 9; i++)
+        free(frames[i]);
+    free(st);
+    free(frame);
+    forwarding_engine_destroy(&eng);
+    node_table_destroy(nt);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: weight profiles resolve the whole table in place, and profiles
+ * with different weights keep apart in the cache
+ * -------------------------------------------------------------------------- */
+
+#define RES_TEST_ROWS 5000              /* past the old 4096-entry copy */
+
+typedef struct {
+    _Atomic int stop;
+    int         torn;
+} res_profile_ctx_t;
+
+static const scoring_weights_t res_w_latency = { 0.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+static const scoring_weights_t res_w_cost    = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+
+static void *res_profile_reader(void *arg)
+{
+    res_profile_ctx_t *c = arg;
+    int id = resolver_profile_find("res-flip");
+    while (!atomic_load(&c->stop)) {
+        scoring_weights_t w;
+        resolver_profile_weights(id, &w);
+        if (memcmp(&w, &res_w_latency, sizeof(w)) != 0 &&
+            memcmp(&w, &res_w_cost, sizeof(w)) != 0)
+            c->torn++;
+    }
+    return NULL;
+}
+
+static int test_resolver_profiles(void)
+{
+    int errors = 0;
+
+    /* The fastest row is the last, the cheapest the first */
+    routing_table_t *rt = routing_table_create(16);
+    routing_table_txn_t *txn = routing_table_txn_begin(rt);
+    for (uint32_t i = 0; i < RES_TEST_ROWS; i++) {
+        route_entry_t e = fwd_entry(i);
+        e.node_id[2]  = (uint8_t)(i >> 8);
+        e.latency_us  = i == RES_TEST_ROWS - 1 ? 10 : 20000 + i;
+        e.cost_milli  = i == 0 ? 1 : 500 + i % 100;
+        TASSERT(routing_table_txn_insert(txn, &e) == 0);
+    }
+    TASSERT(routing_table_txn_commit(txn) == 0);
+
+    /* Registration */
+    int lat = resolver_profile_register("res-latency", &res_w_latency);
+    int cost = resolver_profile_register("res-cost", &res_w_cost);
+    TASSERT(lat > RESOLVER_PROFILE_DEFAULT && cost > lat);
+    TASSERT(resolver_profile_find("res-latency") == lat);
+    TASSERT(resolver_profile_find("default") == RESOLVER_PROFILE_DEFAULT);
+    TASSERT(resolver_profile_find("res-none") == -1);
+    TASSERT(resolver_profile_register("res-latency", &res_w_latency) == lat);
+    scoring_weights_t bad = { -1.0f, 1.0f, 1.0f, 0.0f, 0.0f };
+    TASSERT(resolver_profile_register("res-bad", &bad) == -1);
+    TASSERT(resolver_profile_register("res-a-name-much-too-long-to-fit-in", &res_w_cost) == -1);
+    scoring_weights_t w;
+    TASSERT(resolver_profile_weights(cost, &w) == 0);
+    TASSERT(memcmp(&w, &res_w_cost, sizeof(w)) == 0);
+    TASSERT(resolver_profile_weights(RESOLVER_MAX_PROFILES, &w) == -1);
+
+    /* Every row is scored, not just the first 4096 */
+    sad_t query;
+    sad_init(&query);
+    sad_add_uint32(&query, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN);
+    sad_add_uint32(&query, SAD_FIELD_MAX_LATENCY_MS, 100);
+    resolve_result_t res[2];
+    TASSERT(resolver_resolve_profile(rt, &query, lat, res, 1) == 1);
+    TASSERT(res[0].entry.latency_us == 10);
+    TASSERT(resolver_resolve_profile(rt, &query, cost, res, 1) == 1);
+    TASSERT(res[0].entry.cost_milli == 1);
+    TASSERT(resolver_resolve_profile(rt, &query, RESOLVER_MAX_PROFILES, res, 1) == -1);
+    TASSERT(resolver_resolve_with_weights(rt, &query, &res_w_latency, res, 2) == 2);
+    TASSERT(res[0].entry.latency_us == 10 && res[0].score >= res[1].score);
+
+    /* One cache, two profiles: each matches a direct lookup */
+    uint8_t wire[SAD_MAX_SIZE];
+    int len = sad_encode(&query, wire, sizeof(wire));
+    sad_view_t sv;
+    TASSERT(sad_view_init(&sv, wire, (size_t)len) == len);
+    sad_query_t q;
+    sad_query_compile(&query, &q);
+
+    resolve_cache_t *cache = resolve_cache_create(NULL);
+    const routing_table_view_t *v = routing_table_pin(rt);
+    sad_hit_t want[2][2], got[2][2];
+    int nw[2], ng[2];
+    const int ids[2] = { lat, cost };
+    const scoring_weights_t *ws[2] = { &res_w_latency, &res_w_cost };
+    for (int round = 0; round < 2; round++) {
+        for (int p = 0; p < 2; p++) {
+            nw[p] = routing_table_view_lookup(v, &q, ws[p], want[p], 2);
+            ng[p] = resolver_resolve_cached_profile(cache, v, &sv, ids[p], got[p], 2);
+            TASSERT(hits_equal(want[p], nw[p], got[p], ng[p]));
+        }
+    }
+    TASSERT(!hits_equal(got[0], ng[0], got[1], ng[1]));
+    resolve_cache_stats_t st;
+    resolve_cache_stats(cache, &st);
+    TASSERT(st.misses == 2 && st.hits == 2);
+    TASSERT(resolver_resolve_cached_profile(cache, v, &sv, -1, got[0], 2) == -1);
+    routing_table_unpin(v);
+    resolve_cache_destroy(cache);
+
+    /* Updates while another thread reads are never seen half done */
+    res_profile_ctx_t c = { 0, 0 };
+    TASSERT(resolver_profile_register("res-flip", &res_w_latency) > 0);
+    pthread_t reader;
+    pthread_create(&reader, NULL, res_profile_reader, &c);
+    for (int i = 0; i < 20000; i++)
+        resolver_profile_register("res-flip", (i & 1) ? &res_w_latency : &res_w_cost);
+    atomic_store(&c.stop, 1);
+    pthread_join(reader, NULL);
+    TASSERT(c.torn == 0);
+
+    /* The default profile follows resolver_set_weights */
+    resolver_set_weights(&bad);
+    TASSERT(resolver_profile_weights(RESOLVER_PROFILE_DEFAULT, &w) == 0);
+    scoring_weights_t def = scoring_weights_default();
+    TASSERT(memcmp(&w, &def, sizeof(w)) == 0);
+    resolver_set_weights(&res_w_latency);
+    TASSERT(resolver_resolve(rt, &query, res, 1) == 1);
+    TASSERT(res[0].entry.latency_us == 10);
+    resolver_set_weights(&def);
+
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_forwarding_tests(void)
+{
+    test_register("resolve_cache_invalidation",  test_resolve_cache_invalidation);
+    test_register("forwarding_cache_stats",      test_forwarding_cache_stats);
+    test_register("forwarding_cache_threads",    test_forwarding_cache_threads);
+    test_register("forwarding_burst",            test_forwarding_burst);
+    test_register("forwarding_stats_export",     test_forwarding_stats_export);
+    test_register("forwarding_maglev_affinity",  test_forwarding_maglev_affinity);
+    test_register("forwarding_exact_fast_path",  test_forwarding_exact_fast_path);
+    test_register("forwarding_p2c",              test_forwarding_p2c);
+    test_register("resolver_profiles",           test_resolver_profiles);
+}
@@ -0,0 +1,919 @@
+/*
+ * test_gossip.c - Capability advertisement tests
+ *
+ * Nodes talk through an in-memory network: sends are queued and
+ * delivered in order by gt_deliver(), never from inside a send.
+ */
+
+#include "strandroute/gossip.h"
+#include "strandroute/routing_shards.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/sad.h"
+#include "strandroute/types.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * In-memory network
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    int      dst;
+    size_t   len;
+    uint8_t *buf;
+} gt_msg_t;
+
+typedef struct {
+    int              n;
+    gossip_state_t **gs;
+    routing_table_t **rt;           /* NULL entries: no table */
+    gt_msg_t        *q;
+    size_t           qlen, qcap;
+    bool             drop;          /* lose everything sent while set */
+    uint64_t         delta_entries; /* entries carried by delivered deltas */
+} gt_net_t;
+
+typedef struct {
+    gt_net_t *net;
+} gt_ctx_t;
+
+static gt_ctx_t gt_ctx;
+
+static void gt_id(uint8_t id[STRANDLINK_NODE_ID_LEN], int i)
+{
+    memset(id, 0, STRANDLINK_NODE_ID_LEN);
+    id[0]  = 0xA0;
+    id[14] = (uint8_t)(i >> 8);
+    id[15] = (uint8_t)i;
+}
+
+static int gt_index(const uint8_t id[STRANDLINK_NODE_ID_LEN])
+{
+    return id[14] << 8 | id[15];
+}
+
+static int gt_send(const uint8_t *dst, const void *msg, size_t len, void *ctx)
+{
+    gt_net_t *net = ((gt_ctx_t *)ctx)->net;
+    if (net->drop)
+        return 0;
+    if (net->qlen == net->qcap) {
+        size_t cap = net->qcap ? 2 * net->qcap : 64;
+        gt_msg_t *q = realloc(net->q, cap * sizeof(*q));
+        if (!q) return -1;
+        net->q    = q;
+        net->qcap = cap;
+    }
+    gt_msg_t *m = &net->q[net->qlen];
+    m->buf = malloc(len);
+    if (!m->buf) return -1;
+    memcpy(m->buf, msg, len);
+    m->len = len;
+    m->dst = gt_index(dst);
+    net->qlen++;
+    return 0;
+}
+
+/* Deliver everything queued, including what handling it sends */
+static void gt_deliver(gt_net_t *net)
+{
+    for (size_t h = 0; h < net->qlen; h++) {
+        gt_msg_t m = net->q[h];
+        const gossip_msg_header_t *hdr = (const gossip_msg_header_t *)m.buf;
+        const uint8_t *pl = m.buf + sizeof(*hdr);
+        if (hdr->msg_type == GOSSIP_MSG_ADVERTISE && pl[0] == GOSSIP_ADV_DELTA)
+            net->delta_entries += (uint32_t)(pl[2] << 8 | pl[3]);
+        if (m.dst < net->n)
+            gossip_handle_message(net->gs[m.dst], m.buf, m.len);
+        free(m.buf);
+    }
+    net->qlen = 0;
+}
+
+static void gt_drain(gt_net_t *net)
+{
+    for (size_t h = 0; h < net->qlen; h++)
+        free(net->q[h].buf);
+    net->qlen = 0;
+}
+
+/* @n nodes, with routing tables if @tables */
+static int gt_net_init(gt_net_t *net, int n, bool tables)
+{
+    memset(net, 0, sizeof(*net));
+    net->n  = n;
+    net->gs = calloc((size_t)n, sizeof(*net->gs));
+    net->rt = calloc((size_t)n, sizeof(*net->rt));
+    if (!net->gs || !net->rt)
+        return -1;
+    gt_ctx.net = net;
+    for (int i = 0; i < n; i++) {
+        uint8_t id[STRANDLINK_NODE_ID_LEN];
+        gt_id(id, i);
+        if (tables && !(net->rt[i] = routing_table_create(16)))
+            return -1;
+        if (!(net->gs[i] = gossip_create(id, net->rt[i])))
+            return -1;
+    }
+    return 0;
+}
+
+static void gt_net_free(gt_net_t *net)
+{
+    gt_drain(net);
+    for (int i = 0; i < net->n; i++) {
+        gossip_destroy(net->gs[i]);
+        routing_table_destroy(net->rt[i]);
+    }
+    free(net->gs);
+    free(net->rt);
+    free(net->q);
+}
+
+/* Active peers both ways; before sends are enabled, so no ForwardJoin */
+static void gt_link(gt_net_t *net, int a, int b)
+{
+    uint8_t ia[STRANDLINK_NODE_ID_LEN], ib[STRANDLINK_NODE_ID_LEN];
+    gt_id(ia, a);
+    gt_id(ib, b);
+    gossip_handle_join(net->gs[a], ib, 0);
+    gossip_handle_join(net->gs[b], ia, 0);
+}
+
+static void gt_enable_sends(gt_net_t *net)
+{
+    for (int i = 0; i < net->n; i++)
+        gossip_set_send_fn(net->gs[i], gt_send, &gt_ctx);
+}
+
+static route_entry_t gt_route(uint32_t latency_us)
+{
+    route_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.latency_us  = latency_us;
+    e.cost_milli  = 100;
+    e.trust_level = 3;
+    e.region_code = 276;
+    sad_init(&e.capabilities);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_MODEL_ARCH, MODEL_ARCH_TRANSFORMER);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CAPABILITY, 0x05);
+    return e;
+}
+
+/* Latency @rt holds for node @i, or 0 if it has no entry */
+static uint32_t gt_latency(routing_table_t *rt, int i)
+{
+    uint8_t id[STRANDLINK_NODE_ID_LEN];
+    gt_id(id, i);
+    const routing_table_view_t *v = routing_table_pin(rt);
+    int row = routing_table_view_find(v, id);
+    route_entry_t e;
+    uint32_t lat = 0;
+    if (row >= 0 && routing_table_view_read(v, (uint32_t)row, &e) == 0)
+        lat = e.latency_us;
+    routing_table_unpin(v);
+    return lat;
+}
+
+/* --------------------------------------------------------------------------
+ * Hand-built Advertise payloads
+ * -------------------------------------------------------------------------- */
+
+static void gt_put16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; }
+static void gt_put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);  p[3] = (uint8_t)v;
+}
+
+/* Delta header for @count entries */
+static size_t gt_delta(uint8_t *p, uint16_t count)
+{
+    p[0] = GOSSIP_ADV_DELTA;
+    p[1] = 0;
+    gt_put16(p + 2, count);
+    return GOSSIP_ADV_HDR_LEN;
+}
+
+/* Entry for node @i; a NULL @sad_bytes encodes gt_route()'s SAD */
+static size_t gt_entry(uint8_t *p, int i, uint32_t version, uint32_t latency_us,
+                       const uint8_t *sad_bytes, uint16_t sad_len)
+{
+    uint8_t id[STRANDLINK_NODE_ID_LEN];
+    gt_id(id, i);
+    memcpy(p, id, STRANDLINK_NODE_ID_LEN);
+    uint8_t *f = p + STRANDLINK_NODE_ID_LEN;
+    gt_put32(f, version);
+    gt_put32(f + 4, latency_us);
+    gt_put32(f + 8, 100);
+    gt_put32(f + 12, 30000);
+    gt_put16(f + 16, 276);
+    f[18] = 3;
+
+    uint8_t *sad = p + GOSSIP_ADV_ENTRY_FIXED;
+    if (!sad_bytes) {
+        route_entry_t r = gt_route(0);
+        int n = sad_encode(&r.capabilities, sad, SAD_MAX_SIZE);
+        sad_len = (uint16_t)(n > 0 ? n : 0);
+    } else {
+        memcpy(sad, sad_bytes, sad_len);
+    }
+    gt_put16(f + 19, sad_len);
+    return GOSSIP_ADV_ENTRY_FIXED + sad_len;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: deltas reach the peer's table; newer versions replace older ones
+ * -------------------------------------------------------------------------- */
+
+static int test_gossip_delta_apply(void)
+{
+    int errors = 0;
+
+    gt_net_t net;
+    TASSERT(gt_net_init(&net, 2, true) == 0);
+    gt_link(&net, 0, 1);
+    gt_enable_sends(&net);
+    TASSERT(gossip_active_count(net.gs[0]) == 1);
+
+    uint8_t a[STRANDLINK_NODE_ID_LEN];
+    gt_id(a, 0);
+    route_entry_t r = gt_route(1111);
+    TASSERT(gossip_set_local_entry(net.gs[0], &r, 1000) == 0);
+    uint32_t v1 = gossip_origin_version(net.gs[0], a);
+    TASSERT(v1 != 0);
+
+    TASSERT(gossip_do_advertise(net.gs[0], 1000) == 0);
+    TASSERT(net.qlen == 1);
+    gt_msg_t old = net.q[0];
+    old.buf = malloc(old.len);
+    memcpy(old.buf, net.q[0].buf, old.len);
+    gt_deliver(&net);
+
+    TASSERT(gt_latency(net.rt[1], 0) == 1111);
+    TASSERT(gossip_origin_version(net.gs[1], a) == v1);
+    TASSERT(routing_table_size(net.rt[0]) == 0);    /* never learns itself */
+
+    /* Nothing new, nothing sent */
+    TASSERT(gossip_do_advertise(net.gs[0], 1100) == 0);
+    TASSERT(net.qlen == 0);
+
+    /* A newer version replaces the route */
+    r.latency_us = 2222;
+    TASSERT(gossip_set_local_entry(net.gs[0], &r, 1200) == 0);
+    TASSERT(gossip_do_advertise(net.gs[0], 1200) == 0);
+    gt_deliver(&net);
+    TASSERT(gt_latency(net.rt[1], 0) == 2222);
+    TASSERT(gossip_origin_version(net.gs[1], a) > v1);
+    TASSERT(routing_table_size(net.rt[1]) == 1);
+
+    /* The older one, replayed, changes nothing */
+    TASSERT(gossip_handle_message(net.gs[1], old.buf, old.len) == 0);
+    TASSERT(gt_latency(net.rt[1], 0) == 2222);
+    TASSERT(gossip_origin_version(net.gs[1], a) > v1);
+    free(old.buf);
+
+    gt_net_free(&net);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: a lost delta is repaired through the digest exchange
+ * -------------------------------------------------------------------------- */
+
+static int test_gossip_digest_repair(void)
+{
+    int errors = 0;
+
+    gt_net_t net;
+    TASSERT(gt_net_init(&net, 2, true) == 0);
+    gt_link(&net, 0, 1);
+    gt_enable_sends(&net);
+
+    route_entry_t r = gt_route(3333);
+    TASSERT(gossip_set_local_entry(net.gs[0], &r, 1000) == 0);
+    r.latency_us = 4444;
+    TASSERT(gossip_set_local_entry(net.gs[1], &r, 1000) == 0);
+
+    /* Both first rounds are lost */
+    net.drop = true;
+    gossip_do_advertise(net.gs[0], 1000);
+    gossip_do_advertise(net.gs[1], 1000);
+    net.drop = false;
+    TASSERT(gt_latency(net.rt[1], 0) == 0);
+
+    /* Watermarks moved on: deltas alone never resend */
+    gossip_do_advertise(net.gs[0], 1100);
+    TASSERT(net.qlen == 0);
+
+    /* Node 1's digest shows node 0 what it lacks */
+    int rounds = 1;
+    while (gt_latency(net.rt[1], 0) == 0 && rounds < 20) {
+        gossip_do_advertise(net.gs[1], 1000 + 100u * (uint64_t)rounds);
+        gt_deliver(&net);
+        rounds++;
+    }
+    TASSERT(gt_latency(net.rt[1], 0) == 3333);
+    TASSERT(rounds <= 10);
+
+    gt_net_free(&net);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: an origin repeated inside one delta keeps its newest entry
+ * -------------------------------------------------------------------------- */
+
+static int test_gossip_delta_repeat(void)
+{
+    int errors = 0;
+
+    gt_net_t net;
+    TASSERT(gt_net_init(&net, 2, true) == 0);
+    uint8_t sender[STRANDLINK_NODE_ID_LEN], x[STRANDLINK_NODE_ID_LEN];
+    gt_id(sender, 1);
+    gt_id(x, 7);
+
+    uint8_t pl[2048];
+    size_t n = gt_delta(pl, 3);
+    n += gt_entry(pl + n, 7, 5, 500, NULL, 0);
+    n += gt_entry(pl + n, 7, 7, 700, NULL, 0);
+    n += gt_entry(pl + n, 7, 6, 600, NULL, 0);
+    TASSERT(gossip_handle_advertise(net.gs[0], sender, pl, (uint16_t)n) == 0);
+    TASSERT(gt_latency(net.rt[0], 7) == 700);
+    TASSERT(gossip_origin_version(net.gs[0], x) == 7);
+    TASSERT(routing_table_size(net.rt[0]) == 1);
+
+    /* Same version twice: the first stands */
+    n = gt_delta(pl, 2);
+    n += gt_entry(pl + n, 7, 9, 900, NULL, 0);
+    n += gt_entry(pl + n, 7, 9, 999, NULL, 0);
+    TASSERT(gossip_handle_advertise(net.gs[0], sender, pl, (uint16_t)n) == 0);
+    TASSERT(gt_latency(net.rt[0], 7) == 900);
+    TASSERT(gossip_origin_version(net.gs[0], x) == 9);
+
+    gt_net_free(&net);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: malformed and truncated deltas
+ * -------------------------------------------------------------------------- */
+
+static int test_gossip_delta_malformed(void)
+{
+    int errors = 0;
+
+    gt_net_t net;
+    TASSERT(gt_net_init(&net, 1, true) == 0);
+    uint8_t sender[STRANDLINK_NODE_ID_LEN], id[STRANDLINK_NODE_ID_LEN];
+    gt_id(sender, 1);
+
+    /* A bad SAD skips its entry only */
+    static const uint8_t junk[3] = { 0xFF, 0xFF, 0xFF };
+    uint8_t pl[2048];
+    size_t n = gt_delta(pl, 3);
+    n += gt_entry(pl + n, 10, 1, 100, NULL, 0);
+    n += gt_entry(pl + n, 11, 1, 110, junk, sizeof(junk));
+    n += gt_entry(pl + n, 12, 1, 120, NULL, 0);
+    TASSERT(gossip_handle_advertise(net.gs[0], sender, pl, (uint16_t)n) == 0);
+    TASSERT(gt_latency(net.rt[0], 10) == 100);
+    TASSERT(gt_latency(net.rt[0], 11) == 0);
+    TASSERT(gt_latency(net.rt[0], 12) == 120);
+    gt_id(id, 11);
+    TASSERT(gossip_origin_version(net.gs[0], id) == 0);
+
+    /* Truncated: what came before it is kept */
+    n = gt_delta(pl, 2);
+    n += gt_entry(pl + n, 13, 1, 130, NULL, 0);
+    size_t cut = n + GOSSIP_ADV_ENTRY_FIXED / 2;
+    n += gt_entry(pl + n, 14, 1, 140, NULL, 0);
+    TASSERT(gossip_handle_advertise(net.gs[0], sender, pl, (uint16_t)cut) == -1);
+    TASSERT(gt_latency(net.rt[0], 13) == 130);
+    TASSERT(gt_latency(net.rt[0], 14) == 0);
+    gt_id(id, 14);
+    TASSERT(gossip_origin_version(net.gs[0], id) == 0);
+
+    /* A SAD length running past the payload is truncation too */
+    n = gt_delta(pl, 1);
+    n += gt_entry(pl + n, 15, 1, 150, NULL, 0);
+    TASSERT(gossip_handle_advertise(net.gs[0], sender, pl, (uint16_t)(n - 1)) == -1);
+    TASSERT(gt_latency(net.rt[0], 15) == 0);
+
+    /* Short payloads, unknown kinds */
+    TASSERT(gossip_handle_advertise(net.gs[0], sender, pl, 3) == -1);
+    pl[0] = 9;
+    TASSERT(gossip_handle_advertise(net.gs[0], sender, pl, (uint16_t)n) == -1);
+
+    /* payload_len past the end of the message */
+    uint8_t msg[sizeof(gossip_msg_header_t) + 64];
+    memset(msg, 0, sizeof(msg));
+    gossip_msg_header_t *hdr = (gossip_msg_header_t *)msg;
+    hdr->msg_type    = GOSSIP_MSG_ADVERTISE;
+    hdr->payload_len = 65;
+    memcpy(hdr->sender_id, sender, STRANDLINK_NODE_ID_LEN);
+    TASSERT(gossip_handle_message(net.gs[0], msg, sizeof(msg)) == -1);
+    TASSERT(gossip_handle_message(net.gs[0], msg, sizeof(*hdr) - 1) == -1);
+    TASSERT(routing_table_size(net.rt[0]) == 3);
+
+    gt_net_free(&net);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: a version is recorded only once its route is committed
+ * -------------------------------------------------------------------------- */
+
+/* Every entry goes to the tenant @ctx points at */
+static uint32_t gt_fixed_tenant(const route_entry_t *entry, void *ctx)
+{
+    (void)entry;
+    return *(const uint32_t *)ctx;
+}
+
+static int test_gossip_commit_failure(void)
+{
+    int errors = 0;
+
+    routing_shards_config_t cfg = { .by = RT_SHARD_BY_TENANT, .num_shards = 2 };
+    routing_shards_t *rs = routing_shards_create(&cfg);
+    gt_net_t net;
+    TASSERT(rs && gt_net_init(&net, 1, false) == 0);
+
+    uint8_t sender[STRANDLINK_NODE_ID_LEN], x[STRANDLINK_NODE_ID_LEN];
+    gt_id(sender, 1);
+    gt_id(x, 20);
+    uint8_t pl[512];
+    size_t n = gt_delta(pl, 1);
+    n += gt_entry(pl + n, 20, 4, 400, NULL, 0);
+
+    /* No such tenant: nothing is staged */
+    static uint32_t tenant = 5;
+    gossip_set_routing_shards(net.gs[0], rs, gt_fixed_tenant, &tenant);
+    TASSERT(gossip_handle_advertise(net.gs[0], sender, pl, (uint16_t)n) == -1);
+    TASSERT(gossip_origin_version(net.gs[0], x) == 0);
+    TASSERT(routing_shards_size(rs) == 0);
+
+    /* The same delta again is taken this time */
+    tenant = 1;
+    TASSERT(gossip_handle_advertise(net.gs[0], sender, pl, (uint16_t)n) == 0);
+    TASSERT(gossip_origin_version(net.gs[0], x) == 4);
+    TASSERT(routing_table_size(routing_shards_table(rs, 1)) == 1);
+
+    gt_net_free(&net);
+    routing_shards_destroy(rs);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: learned entries go to their origin's tenant, or nowhere
+ * -------------------------------------------------------------------------- */
+
+/* Nodes 30 and 31 belong to tenants 0 and 1; the rest to none here */
+static uint32_t gt_origin_tenant(const route_entry_t *entry, void *ctx)
+{
+    (void)ctx;
+    int i = gt_index(entry->node_id);
+    return i == 30 ? 0 : i == 31 ? 1 : RT_SHARD_KEY_ANY;
+}
+
+static int test_gossip_shard_tenants(void)
+{
+    int errors = 0;
+
+    routing_shards_config_t cfg = { .by = RT_SHARD_BY_TENANT, .num_shards = 2 };
+    routing_shards_t *rs = routing_shards_create(&cfg);
+    gt_net_t net;
+    TASSERT(rs && gt_net_init(&net, 1, false) == 0);
+    gossip_set_routing_shards(net.gs[0], rs, gt_origin_tenant, NULL);
+
+    uint8_t sender[STRANDLINK_NODE_ID_LEN], id[STRANDLINK_NODE_ID_LEN];
+    gt_id(sender, 1);
+    uint8_t pl[1024];
+    size_t n = gt_delta(pl, 3);
+    n += gt_entry(pl + n, 30, 1, 300, NULL, 0);
+    n += gt_entry(pl + n, 31, 1, 310, NULL, 0);
+    n += gt_entry(pl + n, 32, 1, 320, NULL, 0);
+    TASSERT(gossip_handle_advertise(net.gs[0], sender, pl, (uint16_t)n) == 0);
+
+    TASSERT(gt_latency(routing_shards_table(rs, 0), 30) == 300);
+    TASSERT(gt_latency(routing_shards_table(rs, 0), 31) == 0);
+    TASSERT(gt_latency(routing_shards_table(rs, 1), 31) == 310);
+    TASSERT(gt_latency(routing_shards_table(rs, 1), 30) == 0);
+    TASSERT(routing_shards_size(rs) == 2);
+
+    /* Not stored, but known, so it is still passed on */
+    gt_id(id, 32);
+    TASSERT(gossip_origin_version(net.gs[0], id) == 1);
+
+    /* Each tenant resolves only its own */
+    sad_t q;
+    sad_init(&q);
+    resolve_result_t res[4];
+    TASSERT(routing_shards_resolve(rs, 0, &q, NULL, res, 4) == 1);
+    TASSERT(gt_index(res[0].entry.node_id) == 30);
+    TASSERT(routing_shards_resolve(rs, 1, &q, NULL, res, 4) == 1);
+    TASSERT(gt_index(res[0].entry.node_id) == 31);
+
+    gt_net_free(&net);
+    routing_shards_destroy(rs);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: exact bytes on the wire, from reused transmit buffers
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    int         calls;
+    int         iovcnt;
+    const void *base;               /* first iovec / contiguous message */
+    size_t      len;
+    uint8_t     bytes[sizeof(gossip_msg_header_t) + 2048];
+} gt_capture_t;
+
+static int gt_capture_v(const uint8_t *dst, const struct iovec *iov,
+                        int iovcnt, void *ctx)
+{
+    (void)dst;
+    gt_capture_t *c = ctx;
+    c->calls++;
+    c->iovcnt = iovcnt;
+    c->base   = iov[0].iov_base;
+    c->len    = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (c->len + iov[i].iov_len > sizeof(c->bytes))
+            return -1;
+        memcpy(c->bytes + c->len, iov[i].iov_base, iov[i].iov_len);
+        c->len += iov[i].iov_len;
+    }
+    return 0;
+}
+
+static int gt_capture(const uint8_t *dst, const void *msg, size_t len,
+                      void *ctx)
+{
+    struct iovec iov = { .iov_base = (void *)msg, .iov_len = len };
+    return gt_capture_v(dst, &iov, 1, ctx);
+}
+
+/* The Advertise node @i sends for its local entry at @version */
+static size_t gt_expected(uint8_t *out, int i, uint32_t version,
+                          uint32_t latency_us)
+{
+    gossip_msg_header_t *hdr = (gossip_msg_header_t *)out;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->msg_type = GOSSIP_MSG_ADVERTISE;
+    gt_id(hdr->sender_id, i);
+    gt_id(hdr->origin_id, i);
+
+    uint8_t *pl = out + sizeof(*hdr);
+    size_t n = gt_delta(pl, 1);
+    n += gt_entry(pl + n, i, version, latency_us, NULL, 0);
+    hdr->payload_len = (uint16_t)n;
+    return sizeof(*hdr) + n;
+}
+
+static int test_gossip_sendv(void)
+{
+    int errors = 0;
+
+    gt_net_t net;
+    TASSERT(gt_net_init(&net, 2, true) == 0);
+    gt_link(&net, 0, 1);
+    static gt_capture_t cap;
+    memset(&cap, 0, sizeof(cap));
+    gossip_set_sendv_fn(net.gs[0], gt_capture_v, &cap);
+
+    uint8_t a[STRANDLINK_NODE_ID_LEN];
+    gt_id(a, 0);
+    uint8_t want[sizeof(cap.bytes)];
+
+    /* Header and payload as two iovecs, byte for byte */
+    route_entry_t r = gt_route(1500);
+    TASSERT(gossip_set_local_entry(net.gs[0], &r, 1000) == 0);
+    TASSERT(gossip_do_advertise(net.gs[0], 1000) == 0);
+    TASSERT(cap.calls == 1);
+    TASSERT(cap.iovcnt == 2);
+    size_t n = gt_expected(want, 0, gossip_origin_version(net.gs[0], a), 1500);
+    TASSERT(cap.len == n && memcmp(cap.bytes, want, n) == 0);
+    TASSERT(gossip_handle_message(net.gs[1], cap.bytes, cap.len) == 0);
+    TASSERT(gt_latency(net.rt[1], 0) == 1500);
+    const void *first = cap.base;
+
+    /* The next round builds in the same buffer */
+    r.latency_us = 1600;
+    TASSERT(gossip_set_local_entry(net.gs[0], &r, 1100) == 0);
+    TASSERT(gossip_do_advertise(net.gs[0], 1100) == 0);
+    TASSERT(cap.calls == 2);
+    TASSERT(cap.base == first);
+    n = gt_expected(want, 0, gossip_origin_version(net.gs[0], a), 1600);
+    TASSERT(cap.len == n && memcmp(cap.bytes, want, n) == 0);
+
+    /* Contiguous sends come from the same pool, with the same bytes */
+    gossip_set_sendv_fn(net.gs[0], NULL, NULL);
+    gossip_set_send_fn(net.gs[0], gt_capture, &cap);
+    r.latency_us = 1700;
+    TASSERT(gossip_set_local_entry(net.gs[0], &r, 1200) == 0);
+    TASSERT(gossip_do_advertise(net.gs[0], 1200) == 0);
+    TASSERT(cap.calls == 3);
+    TASSERT(cap.base == first);
+    n = gt_expected(want, 0, gossip_origin_version(net.gs[0], a), 1700);
+    TASSERT(cap.len == n && memcmp(cap.bytes, want, n) == 0);
+
+    gt_net_free(&net);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Batched verification
+ *
+ * A toy signature: FNV-1a of the signed bytes, repeated.  The batch
+ * callback counts its calls and items, and records how many entries the
+ * table held when it ran.
+ * -------------------------------------------------------------------------- */
+
+#define GT_SIGNED_LEN offsetof(gossip_msg_header_t, signature)
+
+typedef struct {
+    int              calls;
+    int              items;
+    routing_table_t *rt;
+    uint32_t         rt_size_seen;
+} gt_verifier_t;
+
+static void gt_sig(const void *msg, size_t len, uint8_t sig[64])
+{
+    const uint8_t *p = msg;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    for (int i = 0; i < 64; i++)
+        sig[i] = (uint8_t)(h >> (8 * (i & 3)));
+}
+
+static int gt_verify_batch(const gossip_sig_item_t *items, int count, void *ctx)
+{
+    gt_verifier_t *v = ctx;
+    v->calls++;
+    v->items += count;
+    if (v->rt)
+        v->rt_size_seen = routing_table_size(v->rt);
+    for (int i = 0; i < count; i++) {
+        uint8_t sig[64];
+        gt_sig(items[i].msg, items[i].msg_len, sig);
+        if (memcmp(sig, items[i].sig, sizeof(sig)) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Signed message from node @from of @type carrying @pl payload bytes;
+ * Advertise signatures cover the payload too */
+static size_t gt_seal(uint8_t *msg, int from, uint8_t type,
+                      const uint8_t *payload, size_t pl)
+{
+    gossip_msg_header_t *hdr = (gossip_msg_header_t *)msg;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->msg_type    = type;
+    hdr->payload_len = (uint16_t)pl;
+    gt_id(hdr->sender_id, from);
+    gt_id(hdr->origin_id, from);
+    if (pl)
+        memcpy(msg + sizeof(*hdr), payload, pl);
+
+    uint8_t region[GT_SIGNED_LEN + 2048];
+    memcpy(region, msg, GT_SIGNED_LEN);
+    size_t signed_pl = type == GOSSIP_MSG_ADVERTISE ? pl : 0;
+    if (signed_pl)
+        memcpy(region + GT_SIGNED_LEN, payload, signed_pl);
+    gt_sig(region, GT_SIGNED_LEN + signed_pl, hdr->signature);
+    return sizeof(*hdr) + pl;
+}
+
+/* Signed delta from node 1 carrying one entry for node @i */
+static size_t gt_seal_delta(uint8_t *msg, int i, uint32_t version,
+                            uint32_t latency_us)
+{
+    uint8_t pl[512];
+    size_t n = gt_delta(pl, 1);
+    n += gt_entry(pl + n, i, version, latency_us, NULL, 0);
+    return gt_seal(msg, 1, GOSSIP_MSG_ADVERTISE, pl, n);
+}
+
+static int test_gossip_verify_bisect(void)
+{
+    int errors = 0;
+
+    gt_net_t net;
+    TASSERT(gt_net_init(&net, 1, true) == 0);
+    static gt_verifier_t v;
+    memset(&v, 0, sizeof(v));
+    gossip_set_auth_fn(net.gs[0], NULL, NULL, &v);
+    gossip_set_verify_batch_fn(net.gs[0], gt_verify_batch);
+
+    /* Sixteen deltas, the sixth with a bad signature */
+    uint8_t msg[sizeof(gossip_msg_header_t) + 512];
+    for (int i = 0; i < 16; i++) {
+        size_t n = gt_seal_delta(msg, 100 + i, 1, 1000 + (uint32_t)i);
+        if (i == 5)
+            msg[offsetof(gossip_msg_header_t, signature)] ^= 1;
+        TASSERT(gossip_enqueue_message(net.gs[0], msg, n) == 0);
+    }
+    TASSERT(v.calls == 0);
+
+    TASSERT(gossip_flush_messages(net.gs[0]) == 1);
+    /* One failed batch, then two halves per level down to the bad one */
+    TASSERT(v.calls == 1 + 2 * 4);
+    TASSERT(v.items == 16 + 16 + 8 + 4 + 2);
+    TASSERT(routing_table_size(net.rt[0]) == 15);
+    TASSERT(gt_latency(net.rt[0], 105) == 0);
+    TASSERT(gt_latency(net.rt[0], 104) == 1004);
+    TASSERT(gt_latency(net.rt[0], 106) == 1006);
+
+    /* The queue is empty again */
+    TASSERT(gossip_flush_messages(net.gs[0]) == 0);
+    TASSERT(v.calls == 9);
+
+    gt_net_free(&net);
+    return errors;
+}
+
+static int test_gossip_verify_order(void)
+{
+    int errors = 0;
+
+    gt_net_t net;
+    TASSERT(gt_net_init(&net, 1, true) == 0);
+    static gt_verifier_t v;
+    memset(&v, 0, sizeof(v));
+    v.rt = net.rt[0];
+    v.rt_size_seen = UINT32_MAX;
+    gossip_set_auth_fn(net.gs[0], NULL, NULL, &v);
+    gossip_set_verify_batch_fn(net.gs[0], gt_verify_batch);
+
+    /* Two entries of the same version: whichever is handled first stands */
+    uint8_t msg[sizeof(gossip_msg_header_t) + 512];
+    size_t n = gt_seal_delta(msg, 30, 5, 500);
+    TASSERT(gossip_enqueue_message(net.gs[0], msg, n) == 0);
+    n = gt_seal_delta(msg, 30, 5, 555);
+    TASSERT(gossip_enqueue_message(net.gs[0], msg, n) == 0);
+    n = gt_seal_delta(msg, 31, 1, 310);
+    TASSERT(gossip_enqueue_message(net.gs[0], msg, n) == 0);
+    TASSERT(routing_table_size(net.rt[0]) == 0);
+
+    TASSERT(gossip_flush_messages(net.gs[0]) == 0);
+    TASSERT(v.calls == 1 && v.items == 3);
+    TASSERT(v.rt_size_seen == 0);           /* nothing applied before it */
+    TASSERT(gt_latency(net.rt[0], 30) == 500);
+    TASSERT(gt_latency(net.rt[0], 31) == 310);
+
+    gt_net_free(&net);
+    return errors;
+}
+
+static int test_gossip_verify_cache(void)
+{
+    int errors = 0;
+
+    gt_net_t net;
+    TASSERT(gt_net_init(&net, 1, false) == 0);
+    static gt_verifier_t v;
+    memset(&v, 0, sizeof(v));
+    gossip_set_auth_fn(net.gs[0], NULL, NULL, &v);
+    gossip_set_verify_batch_fn(net.gs[0], gt_verify_batch);
+
+    uint8_t join[sizeof(gossip_msg_header_t)];
+    size_t n = gt_seal(join, 9, GOSSIP_MSG_JOIN, NULL, 0);
+    TASSERT(gossip_enqueue_message(net.gs[0], join, n) == 0);
+    TASSERT(gossip_flush_messages(net.gs[0]) == 0);
+    TASSERT(v.calls == 1);
+    TASSERT(gossip_active_count(net.gs[0]) == 1);
+
+    /* The same signed header again, queued or not: no callback */
+    TASSERT(gossip_enqueue_message(net.gs[0], join, n) == 0);
+    TASSERT(gossip_enqueue_message(net.gs[0], join, n) == 0);
+    TASSERT(gossip_flush_messages(net.gs[0]) == 0);
+    TASSERT(gossip_handle_message(net.gs[0], join, n) == 0);
+    TASSERT(v.calls == 1 && v.items == 1);
+
+    /* Another signature over the same header is checked, and refused */
+    join[offsetof(gossip_msg_header_t, signature)] ^= 1;
+    TASSERT(gossip_enqueue_message(net.gs[0], join, n) == 0);
+    TASSERT(gossip_flush_messages(net.gs[0]) == 1);
+    TASSERT(v.calls == 2);
+
+    /* Advertise signatures cover payloads, so they are never cached */
+    uint8_t msg[sizeof(gossip_msg_header_t) + 512];
+    n = gt_seal_delta(msg, 40, 1, 400);
+    TASSERT(gossip_handle_message(net.gs[0], msg, n) == 0);
+    TASSERT(gossip_handle_message(net.gs[0], msg, n) == 0);
+    TASSERT(v.calls == 4);
+
+    gt_net_free(&net);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: 1000 nodes converge in a few rounds without flooding
+ * -------------------------------------------------------------------------- */
+
+#define GT_CONV_NODES   1000
+#define GT_CONV_ROUNDS  30
+
+static int test_gossip_convergence(void)
+{
+    int errors = 0;
+
+    gt_net_t net;
+    TASSERT(gt_net_init(&net, GT_CONV_NODES, false) == 0);
+
+    /* A ring plus one random chord per node */
+    static int perm[GT_CONV_NODES];
+    uint32_t seed = 7;
+    for (int i = 0; i < GT_CONV_NODES; i++)
+        perm[i] = i;
+    for (int i = GT_CONV_NODES - 1; i > 0; i--) {
+        seed = seed * 1103515245u + 12345u;
+        int j = (int)((seed >> 8) % (uint32_t)(i + 1));
+        int t = perm[i]; perm[i] = perm[j]; perm[j] = t;
+    }
+    for (int i = 0; i < GT_CONV_NODES; i++)
+        gt_link(&net, i, (i + 1) % GT_CONV_NODES);
+    for (int i = 0; i + 1 < GT_CONV_NODES; i += 2)
+        if (perm[i] != (perm[i + 1] + 1) % GT_CONV_NODES &&
+            perm[i + 1] != (perm[i] + 1) % GT_CONV_NODES)
+            gt_link(&net, perm[i], perm[i + 1]);
+    gt_enable_sends(&net);
+
+    route_entry_t r = gt_route(500);
+    for (int i = 0; i < GT_CONV_NODES; i++)
+        TASSERT(gossip_set_local_entry(net.gs[i], &r, 1000) == 0);
+
+    int rounds = 0;
+    bool converged = false;
+    while (!converged && rounds < GT_CONV_ROUNDS) {
+        uint64_t now = 1000 + 100u * (uint64_t)rounds;
+        for (int i = 0; i < GT_CONV_NODES; i++)
+            gossip_do_advertise(net.gs[i], now);
+        gt_deliver(&net);
+        rounds++;
+
+        converged = true;
+        for (int i = 0; i < GT_CONV_NODES && converged; i++) {
+            for (int o = 0; o < GT_CONV_NODES; o++) {
+                uint8_t id[STRANDLINK_NODE_ID_LEN];
+                gt_id(id, o);
+                if (gossip_origin_version(net.gs[i], id) == 0) {
+                    converged = false;
+                    break;
+                }
+            }
+        }
+    }
+    TASSERT(converged);
+    TASSERT(rounds <= 15);
+
+    /* Each entry crosses each link at most about once */
+    uint64_t links = 0;
+    for (int i = 0; i < GT_CONV_NODES; i++)
+        links += (uint64_t)gossip_active_count(net.gs[i]);
+    TASSERT(net.delta_entries <= links * GT_CONV_NODES);
+
+    gt_net_free(&net);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_gossip_tests(void)
+{
+    test_register("gossip_delta_apply",     test_gossip_delta_apply);
+    test_register("gossip_digest_repair",   test_gossip_digest_repair);
+    test_register("gossip_delta_repeat",    test_gossip_delta_repeat);
+    test_register("gossip_delta_malformed", test_gossip_delta_malformed);
+    test_register("gossip_commit_failure",  test_gossip_commit_failure);
+    test_register("gossip_shard_tenants",   test_gossip_shard_tenants);
+    test_register("gossip_sendv",           test_gossip_sendv);
+    test_register("gossip_verify_bisect",   test_gossip_verify_bisect);
+    test_register("gossip_verify_order",    test_gossip_verify_order);
+    test_register("gossip_verify_cache",    test_gossip_verify_cache);
+    test_register("gossip_convergence",     test_gossip_convergence);
+}
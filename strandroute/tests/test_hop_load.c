@@ -0,0 +1,158 @@
+/*
+ * test_hop_load.c - Per-next-hop latency and load tests
+ */
+
+#include "strandroute/hop_load.h"
+#include "strandroute/types.h"
+
+#include <pthread.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Helpers
+ * -------------------------------------------------------------------------- */
+
+static void hl_node(uint8_t id[STRANDLINK_NODE_ID_LEN], int i)
+{
+    memset(id, 0, STRANDLINK_NODE_ID_LEN);
+    id[0] = 0xD0;
+    id[14] = (uint8_t)(i >> 8);
+    id[15] = (uint8_t)i;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: outstanding count, average, capacity
+ * -------------------------------------------------------------------------- */
+
+static int test_hop_load_basic(void)
+{
+    int errors = 0;
+
+    hop_load_t *hl = hop_load_create(8);
+    TASSERT(hl != NULL);
+
+    uint8_t a[STRANDLINK_NODE_ID_LEN], b[STRANDLINK_NODE_ID_LEN];
+    hl_node(a, 1);
+    hl_node(b, 2);
+    hop_load_info_t info;
+    TASSERT(hop_load_get(hl, a, &info) == -1);
+
+    for (int i = 0; i < 5; i++)
+        TASSERT(hop_load_sent(hl, a) == 0);
+    TASSERT(hop_load_get(hl, a, &info) == 0);
+    TASSERT(info.inflight == 5 && info.samples == 0 && info.ewma_us == 0);
+    TASSERT(hop_load_get(hl, b, &info) == -1);
+
+    /* First sample is taken as is, later ones move it by 1/8 */
+    TASSERT(hop_load_done(hl, a, 800) == 0);
+    hop_load_get(hl, a, &info);
+    TASSERT(info.inflight == 4 && info.samples == 1 && info.ewma_us == 800);
+    TASSERT(hop_load_done(hl, a, 1600) == 0);
+    hop_load_get(hl, a, &info);
+    TASSERT(info.ewma_us == 900 && info.samples == 2);
+
+    /* Converges on a steady latency */
+    for (int i = 0; i < 200; i++) {
+        hop_load_sent(hl, a);
+        hop_load_done(hl, a, 5000);
+    }
+    hop_load_get(hl, a, &info);
+    TASSERT(info.ewma_us > 4990 && info.ewma_us <= 5000);
+    TASSERT(info.inflight == 3);
+
+    /* Completions without a sample leave the average; the count stops at 0 */
+    for (int i = 0; i < 10; i++)
+        TASSERT(hop_load_done(hl, a, HOP_LOAD_NO_SAMPLE) == 0);
+    hop_load_get(hl, a, &info);
+    TASSERT(info.inflight == 0 && info.samples == 202);
+    TASSERT(info.ewma_us > 4990);
+
+    /* 8 hops get at least 16 slots; the table refuses new hops once full */
+    int added = 0;
+    for (int i = 100; i < 200; i++) {
+        uint8_t id[STRANDLINK_NODE_ID_LEN];
+        hl_node(id, i);
+        if (hop_load_sent(hl, id) == 0) added++;
+    }
+    TASSERT(added >= 8 && added < 100);
+    TASSERT(hop_load_get(hl, a, &info) == 0);
+
+    TASSERT(hop_load_sent(NULL, a) == -1);
+    TASSERT(hop_load_done(hl, NULL, 1) == -1);
+
+    hop_load_destroy(hl);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: concurrent senders and completers
+ * -------------------------------------------------------------------------- */
+
+#define HL_THREADS 4
+#define HL_HOPS    32
+#define HL_ROUNDS  20000
+
+static void *hl_worker(void *arg)
+{
+    hop_load_t *hl = arg;
+    for (int r = 0; r < HL_ROUNDS; r++) {
+        uint8_t id[STRANDLINK_NODE_ID_LEN];
+        hl_node(id, r % HL_HOPS);
+        hop_load_sent(hl, id);
+        if (r % 4 != 3)
+            hop_load_done(hl, id, 1000 + (uint32_t)(r % HL_HOPS));
+    }
+    return NULL;
+}
+
+static int test_hop_load_threads(void)
+{
+    int errors = 0;
+
+    hop_load_t *hl = hop_load_create(HL_HOPS);
+    TASSERT(hl != NULL);
+
+    pthread_t th[HL_THREADS];
+    for (int i = 0; i < HL_THREADS; i++)
+        pthread_create(&th[i], NULL, hl_worker, hl);
+    for (int i = 0; i < HL_THREADS; i++)
+        pthread_join(th[i], NULL);
+
+    /* Each hop claimed once, every update counted */
+    uint64_t inflight = 0, samples = 0;
+    for (int h = 0; h < HL_HOPS; h++) {
+        uint8_t id[STRANDLINK_NODE_ID_LEN];
+        hop_load_info_t info;
+        hl_node(id, h);
+        TASSERT(hop_load_get(hl, id, &info) == 0);
+        /* Every fourth hop only ever gets sends */
+        TASSERT(info.ewma_us == (h % 4 == 3 ? 0u : 1000u + (uint32_t)h));
+        inflight += info.inflight;
+        samples  += info.samples;
+    }
+    TASSERT(inflight == (uint64_t)HL_THREADS * HL_ROUNDS / 4);
+    TASSERT(samples == (uint64_t)HL_THREADS * HL_ROUNDS * 3 / 4);
+
+    hop_load_destroy(hl);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_hop_load_tests(void)
+{
+    test_register("hop_load_basic",    test_hop_load_basic);
+    test_register("hop_load_threads",  test_hop_load_threads);
+}
@@ -5,6 +5,8 @@
  * We run them all and report pass/fail counts.
  */
 
+#include "strandroute/sad_match.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -53,6 +55,21 @@ int test_assert_impl(int cond, const char *expr, const char *file, int line)
 
 extern void register_sad_tests(void);
 extern void register_routing_tests(void);
+extern void register_routing_shards_tests(void);
+extern void register_sad_match_tests(void);
+extern void register_epoch_tests(void);
+extern void register_forwarding_tests(void);
+extern void register_multipath_tests(void);
+extern void register_node_table_tests(void);
+extern void register_hop_load_tests(void);
+extern void register_offload_tests(void);
+extern void register_timer_wheel_tests(void);
+extern void register_dataplane_tests(void);
+extern void register_xdp_steer_tests(void);
+extern void register_gossip_tests(void);
+#ifdef STRANDROUTE_TEST_P4RT
+extern void register_p4_runtime_tests(void);
+#endif
 
 /* --------------------------------------------------------------------------
  * Main
@@ -66,8 +83,24 @@ int main(int argc, char **argv)
     /* Register all test suites */
     register_sad_tests();
     register_routing_tests();
-
-    printf("StrandRoute Test Suite: %d tests\n", g_num_tests);
+    register_routing_shards_tests();
+    register_sad_match_tests();
+    register_epoch_tests();
+    register_forwarding_tests();
+    register_multipath_tests();
+    register_node_table_tests();
+    register_hop_load_tests();
+    register_offload_tests();
+    register_timer_wheel_tests();
+    register_dataplane_tests();
+    register_xdp_steer_tests();
+    register_gossip_tests();
+#ifdef STRANDROUTE_TEST_P4RT
+    register_p4_runtime_tests();
+#endif
+
+    printf("StrandRoute Test Suite: %d tests (SAD kernel: %s)\n",
+           g_num_tests, sad_kernel_name(sad_kernel_active()));
     printf("========================================\n");
 
     int passed = 0;
@@ -0,0 +1,241 @@
+/*
+ * test_multipath.c - Maglev table tests
+ */
+
+#include "strandroute/multipath.h"
+#include "strandroute/types.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Helpers
+ * -------------------------------------------------------------------------- */
+
+static void mg_node(uint8_t id[STRANDLINK_NODE_ID_LEN], int i)
+{
+    memset(id, 0, STRANDLINK_NODE_ID_LEN);
+    id[0] = 0xB0;
+    id[1] = (uint8_t)(i >> 8);
+    id[2] = (uint8_t)i;
+}
+
+static void mg_key(uint8_t key[8], uint32_t flow)
+{
+    memcpy(key, &flow, sizeof(flow));
+    memset(key + 4, 0x5A, 4);
+}
+
+#define MG_BACKENDS 300
+#define MG_FLOWS    20000
+
+/* --------------------------------------------------------------------------
+ * Test: sizes, more than 128 backends, weighted shares
+ * -------------------------------------------------------------------------- */
+
+static int test_maglev_weighted_large(void)
+{
+    int errors = 0;
+
+    TASSERT(maglev_prime_at_least(65536) == MAGLEV_LARGE_TABLE_SIZE);
+    TASSERT(maglev_prime_at_least(5003) == 5003);
+
+    maglev_t m;
+    TASSERT(maglev_init(&m, 65536) == -1);          /* not prime */
+    TASSERT(maglev_init(&m, MAGLEV_LARGE_TABLE_SIZE) == 0);
+    TASSERT(maglev_get_table_size(&m) == MAGLEV_LARGE_TABLE_SIZE);
+    TASSERT(maglev_lookup(&m, (const uint8_t *)"x", 1) == -1);
+    TASSERT(maglev_populate(&m) == -1);
+
+    /* Every other backend has weight 3 */
+    uint8_t id[STRANDLINK_NODE_ID_LEN];
+    for (int i = 0; i < MG_BACKENDS; i++) {
+        mg_node(id, i);
+        TASSERT(maglev_add_backend(&m, id, (i % 2) ? 3 : 1) == i);
+    }
+    TASSERT(maglev_get_backend_count(&m) == MG_BACKENDS);
+    mg_node(id, 7);
+    TASSERT(maglev_add_backend(&m, id, 3) == 7);    /* existing: reweight */
+    TASSERT(maglev_add_backend(&m, id, 3) == 7);
+    TASSERT(maglev_get_backend_count(&m) == MG_BACKENDS);
+    TASSERT(maglev_populate(&m) == 0);
+    TASSERT(maglev_last_disruption(&m) == 0.0);
+
+    uint32_t *slots = calloc(MG_BACKENDS, sizeof(uint32_t));
+    TASSERT(slots != NULL);
+    uint64_t light = 0, heavy = 0;
+    for (uint32_t s = 0; s < MAGLEV_LARGE_TABLE_SIZE; s++) {
+        int32_t b = atomic_load(&m.table[s]);
+        TASSERT(b >= 0 && b < MG_BACKENDS);
+        if (b >= 0 && b < MG_BACKENDS) slots[b]++;
+    }
+    for (int i = 0; i < MG_BACKENDS; i++) {
+        if (i % 2 || i == 7) heavy += slots[i];
+        else                 light += slots[i];
+    }
+    /* 151 heavy vs 149 light backends, 3:1 per backend */
+    double ratio = ((double)heavy / 151.0) / ((double)light / 149.0);
+    TASSERT(ratio > 2.7 && ratio < 3.3);
+
+    free(slots);
+    maglev_destroy(&m);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: churn moves few slots and keeps most flows in place
+ * -------------------------------------------------------------------------- */
+
+static int test_maglev_disruption(void)
+{
+    int errors = 0;
+
+    maglev_t m;
+    TASSERT(maglev_init(&m, MAGLEV_LARGE_TABLE_SIZE) == 0);
+
+    uint8_t id[STRANDLINK_NODE_ID_LEN];
+    for (int i = 0; i < MG_BACKENDS; i++) {
+        mg_node(id, i);
+        maglev_add_backend(&m, id, 1);
+    }
+    TASSERT(maglev_populate(&m) == 0);
+
+    int16_t *before = malloc(MG_FLOWS * sizeof(int16_t));
+    TASSERT(before != NULL);
+    uint8_t key[8];
+    for (uint32_t f = 0; f < MG_FLOWS; f++) {
+        mg_key(key, f);
+        before[f] = (int16_t)maglev_lookup(&m, key, sizeof(key));
+    }
+
+    /* Unchanged set: populate is a no-op */
+    TASSERT(maglev_populate(&m) == 0);
+    TASSERT(maglev_last_disruption(&m) == 0.0);
+
+    /* Remove one backend: its 1/N share moves, plus a few slots displaced
+     * by the refill */
+    mg_node(id, 42);
+    TASSERT(maglev_remove_backend(&m, id) == 0);
+    TASSERT(maglev_remove_backend(&m, id) == -1);
+    TASSERT(maglev_find_backend(&m, id) == -1);
+    TASSERT(maglev_populate(&m) == 0);
+    double d = maglev_last_disruption(&m);
+    TASSERT(d > 0.5 / MG_BACKENDS && d < 6.0 / MG_BACKENDS);
+
+    int moved_other = 0;
+    for (uint32_t f = 0; f < MG_FLOWS; f++) {
+        mg_key(key, f);
+        int b = maglev_lookup(&m, key, sizeof(key));
+        TASSERT(b != 42);
+        if (before[f] != 42 && b != before[f])
+            moved_other++;
+    }
+    TASSERT(moved_other < MG_FLOWS / 100);
+
+    /* The freed index is reused by the next new backend */
+    mg_node(id, 1000);
+    TASSERT(maglev_add_backend(&m, id, 1) == 42);
+    TASSERT(maglev_populate(&m) == 0);
+    d = maglev_last_disruption(&m);
+    TASSERT(d > 0.5 / MG_BACKENDS && d < 6.0 / MG_BACKENDS);
+
+    free(before);
+    maglev_destroy(&m);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: lookups racing populate only ever see a complete table
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    maglev_t    *m;
+    atomic_bool  started;
+    atomic_bool  stop;
+    int          bad;
+    long         lookups;
+} mg_reader_arg_t;
+
+static void *mg_reader(void *arg)
+{
+    mg_reader_arg_t *a = arg;
+    uint8_t key[8];
+    uint32_t f = 0;
+    atomic_store(&a->started, true);
+    while (!atomic_load(&a->stop)) {
+        mg_key(key, f++);
+        int b = maglev_lookup(a->m, key, sizeof(key));
+        if (b < 0 || b >= 64)
+            a->bad++;
+        a->lookups++;
+    }
+    return NULL;
+}
+
+static int test_maglev_concurrent_swap(void)
+{
+    int errors = 0;
+
+    maglev_t m;
+    TASSERT(maglev_init(&m, 0) == 0);
+
+    uint8_t id[STRANDLINK_NODE_ID_LEN];
+    for (int i = 0; i < 32; i++) {
+        mg_node(id, i);
+        maglev_add_backend(&m, id, 1 + (uint32_t)(i % 4));
+    }
+    TASSERT(maglev_populate(&m) == 0);
+
+    mg_reader_arg_t arg = { .m = &m, .bad = 0, .lookups = 0 };
+    atomic_init(&arg.started, false);
+    atomic_init(&arg.stop, false);
+    pthread_t th;
+    pthread_create(&th, NULL, mg_reader, &arg);
+    while (!atomic_load(&arg.started))
+        ;
+
+    /* Autoscaling churn: one out, one in, every round */
+    for (int r = 0; r < 200; r++) {
+        mg_node(id, r % 32);
+        maglev_remove_backend(&m, id);
+        mg_node(id, 100 + r);
+        maglev_add_backend(&m, id, 2);
+        TASSERT(maglev_populate(&m) == 0);
+        mg_node(id, 100 + r);
+        maglev_remove_backend(&m, id);
+        mg_node(id, r % 32);
+        maglev_add_backend(&m, id, 1 + (uint32_t)(r % 4));
+        TASSERT(maglev_populate(&m) == 0);
+    }
+
+    atomic_store(&arg.stop, true);
+    pthread_join(th, NULL);
+    TASSERT(arg.bad == 0);
+    TASSERT(arg.lookups > 0);
+
+    maglev_destroy(&m);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_multipath_tests(void)
+{
+    test_register("maglev_weighted_large",   test_maglev_weighted_large);
+    test_register("maglev_disruption",       test_maglev_disruption);
+    test_register("maglev_concurrent_swap",  test_maglev_concurrent_swap);
+}
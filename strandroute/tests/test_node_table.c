@@ -0,0 +1,188 @@
+/*
+ * test_node_table.c - Exact node_id table tests
+ */
+
+#include "strandroute/node_table.h"
+#include "strandroute/types.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Helpers
+ * -------------------------------------------------------------------------- */
+
+static void nt_node(uint8_t id[STRANDLINK_NODE_ID_LEN], int i)
+{
+    memset(id, 0, STRANDLINK_NODE_ID_LEN);
+    id[0] = 0xC0;
+    id[14] = (uint8_t)(i >> 8);
+    id[15] = (uint8_t)i;
+}
+
+#define NT_ENTRIES 1000
+
+/* --------------------------------------------------------------------------
+ * Test: insert / replace / delete / capacity
+ * -------------------------------------------------------------------------- */
+
+static int test_node_table_basic(void)
+{
+    int errors = 0;
+
+    node_table_t *nt = node_table_create(NT_ENTRIES);
+    TASSERT(nt != NULL);
+
+    uint8_t id[STRANDLINK_NODE_ID_LEN], hop[STRANDLINK_NODE_ID_LEN];
+    node_table_hop_t out;
+
+    memset(id, 0, sizeof(id));
+    TASSERT(node_table_insert(nt, id, 1, NULL) == -1);     /* zero ID */
+    TASSERT(node_table_lookup(nt, id, &out) == -1);
+
+    for (int i = 0; i < NT_ENTRIES; i++) {
+        nt_node(id, i);
+        nt_node(hop, i + 5000);
+        TASSERT(node_table_insert(nt, id, (strandlink_port_t)(i % 7), hop) == 0);
+    }
+    TASSERT(node_table_count(nt) == NT_ENTRIES);
+
+    /* Full: a new key is refused, an existing one can still be replaced */
+    nt_node(id, NT_ENTRIES);
+    TASSERT(node_table_insert(nt, id, 1, NULL) == -1);
+    nt_node(id, 10);
+    TASSERT(node_table_insert(nt, id, 9, NULL) == 0);
+    TASSERT(node_table_count(nt) == NT_ENTRIES);
+    TASSERT(node_table_lookup(nt, id, &out) == 0);
+    TASSERT(out.port == 9);
+    TASSERT(node_id_equal(out.next_hop, id));
+
+    for (int i = 0; i < NT_ENTRIES; i++) {
+        if (i == 10) continue;
+        nt_node(id, i);
+        nt_node(hop, i + 5000);
+        TASSERT(node_table_lookup(nt, id, &out) == 0);
+        TASSERT(out.port == (strandlink_port_t)(i % 7));
+        TASSERT(node_id_equal(out.next_hop, hop));
+    }
+
+    /* Delete every other entry; the rest stay reachable past the holes */
+    for (int i = 0; i < NT_ENTRIES; i += 2) {
+        nt_node(id, i);
+        TASSERT(node_table_delete(nt, id) == 0);
+        TASSERT(node_table_delete(nt, id) == -1);
+    }
+    TASSERT(node_table_count(nt) == NT_ENTRIES / 2);
+    for (int i = 0; i < NT_ENTRIES; i++) {
+        nt_node(id, i);
+        TASSERT((node_table_lookup(nt, id, NULL) == 0) == (i % 2 == 1));
+    }
+
+    /* Freed room is reused */
+    for (int i = 0; i < NT_ENTRIES; i += 2) {
+        nt_node(id, NT_ENTRIES + i);
+        TASSERT(node_table_insert(nt, id, 1, NULL) == 0);
+    }
+    TASSERT(node_table_count(nt) == NT_ENTRIES);
+
+    node_table_destroy(nt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: lookups racing inserts and deletes
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    node_table_t *nt;
+    atomic_bool   started;
+    atomic_bool   stop;
+    int           bad;
+    long          lookups;
+} nt_reader_arg_t;
+
+/* Keys 0..99 are never removed and must always be found intact */
+static void *nt_reader(void *arg)
+{
+    nt_reader_arg_t *a = arg;
+    uint8_t id[STRANDLINK_NODE_ID_LEN], hop[STRANDLINK_NODE_ID_LEN];
+    node_table_hop_t out;
+    int i = 0;
+    atomic_store(&a->started, true);
+    while (!atomic_load(&a->stop)) {
+        nt_node(id, i);
+        nt_node(hop, i + 5000);
+        if (node_table_lookup(a->nt, id, &out) != 0 ||
+            out.port != (strandlink_port_t)i ||
+            !node_id_equal(out.next_hop, hop))
+            a->bad++;
+        i = (i + 1) % 100;
+        a->lookups++;
+    }
+    return NULL;
+}
+
+static int test_node_table_concurrent(void)
+{
+    int errors = 0;
+
+    node_table_t *nt = node_table_create(256);
+    TASSERT(nt != NULL);
+
+    uint8_t id[STRANDLINK_NODE_ID_LEN], hop[STRANDLINK_NODE_ID_LEN];
+    for (int i = 0; i < 100; i++) {
+        nt_node(id, i);
+        nt_node(hop, i + 5000);
+        node_table_insert(nt, id, (strandlink_port_t)i, hop);
+    }
+
+    nt_reader_arg_t arg = { .nt = nt, .bad = 0, .lookups = 0 };
+    atomic_init(&arg.started, false);
+    atomic_init(&arg.stop, false);
+    pthread_t th;
+    pthread_create(&th, NULL, nt_reader, &arg);
+    while (!atomic_load(&arg.started))
+        ;
+
+    /* Churn other keys through the same slots, and rewrite stable ones
+     * with identical values */
+    for (int r = 0; r < 2000; r++) {
+        nt_node(id, 1000 + r % 150);
+        node_table_insert(nt, id, 1, NULL);
+        nt_node(id, 1000 + (r + 75) % 150);
+        node_table_delete(nt, id);
+        int s = r % 100;
+        nt_node(id, s);
+        nt_node(hop, s + 5000);
+        TASSERT(node_table_insert(nt, id, (strandlink_port_t)s, hop) == 0);
+    }
+
+    atomic_store(&arg.stop, true);
+    pthread_join(th, NULL);
+    TASSERT(arg.bad == 0);
+    TASSERT(arg.lookups > 0);
+
+    node_table_destroy(nt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_node_table_tests(void)
+{
+    test_register("node_table_basic",       test_node_table_basic);
+    test_register("node_table_concurrent",  test_node_table_concurrent);
+}
@@ -0,0 +1,397 @@
+/*
+ * test_offload.c - Hot-SAD hardware offload tests
+ *
+ * The manager writes through a stand-in for p4rt_batch_write() that keeps
+ * the table in memory, so promotion, eviction and failure handling can be
+ * checked without a switch.
+ */
+
+#include "strandroute/forwarding.h"
+#include "strandroute/offload.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/sad.h"
+#include "strandroute/types.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Fake switch: sad_ternary_match as a list
+ * -------------------------------------------------------------------------- */
+
+#define OL_SWITCH_MAX 64
+
+static struct {
+    p4rt_op_t entries[OL_SWITCH_MAX];
+    int       count;
+    int       ops;          /* operations received */
+    int       fail;         /* fail every operation while set */
+} g_sw;
+
+static bool ol_same_entry(const p4rt_op_t *a, const p4rt_op_t *b)
+{
+    return memcmp(&a->sad_key, &b->sad_key, sizeof(a->sad_key)) == 0 &&
+           memcmp(&a->sad_mask, &b->sad_mask, sizeof(a->sad_mask)) == 0 &&
+           a->priority == b->priority;
+}
+
+static int ol_switch_write(p4rt_op_t *ops, size_t count)
+{
+    int failed = 0;
+    for (size_t i = 0; i < count; i++) {
+        p4rt_op_t *op = &ops[i];
+        g_sw.ops++;
+        if (g_sw.fail) {
+            op->result = P4RT_ERR_CONN;
+            failed++;
+            continue;
+        }
+        int found = -1;
+        for (int j = 0; j < g_sw.count; j++)
+            if (ol_same_entry(&g_sw.entries[j], op))
+                found = j;
+        op->result = P4RT_OK;
+        if (op->type == P4RT_OP_SAD_ADD) {
+            if (found < 0) {
+                if (g_sw.count == OL_SWITCH_MAX) {
+                    op->result = P4RT_ERR_FULL;
+                    failed++;
+                    continue;
+                }
+                found = g_sw.count++;
+            }
+            g_sw.entries[found] = *op;
+        } else if (found < 0) {
+            op->result = P4RT_ERR_NOT_FOUND;
+            failed++;
+        } else {
+            g_sw.entries[found] = g_sw.entries[--g_sw.count];
+        }
+    }
+    return failed;
+}
+
+/* Installed entry for @model_arch, or NULL */
+static const p4rt_op_t *ol_switch_find(uint32_t model_arch)
+{
+    for (int i = 0; i < g_sw.count; i++)
+        if (g_sw.entries[i].sad_key.model_arch == model_arch)
+            return &g_sw.entries[i];
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------
+ * Helpers
+ * -------------------------------------------------------------------------- */
+
+/* Node @i serves model_arch 100 + i only */
+static route_entry_t ol_route(int i, uint8_t tag, uint32_t ctx)
+{
+    route_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.node_id[0] = 0xE0;
+    e.node_id[1] = tag;
+    e.node_id[2] = (uint8_t)i;
+    sad_init(&e.capabilities);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_MODEL_ARCH, 100u + (uint32_t)i);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CONTEXT_WINDOW, ctx);
+    return e;
+}
+
+typedef struct {
+    uint8_t    buf[SAD_MAX_SIZE];
+    sad_view_t view;
+} ol_query_t;
+
+static void ol_query(ol_query_t *q, int i, uint32_t ctx, uint32_t max_latency_ms)
+{
+    sad_t s;
+    sad_init(&s);
+    sad_add_uint32(&s, SAD_FIELD_MODEL_ARCH, 100u + (uint32_t)i);
+    sad_add_uint32(&s, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN);
+    sad_add_uint32(&s, SAD_FIELD_CONTEXT_WINDOW, ctx);
+    if (max_latency_ms)
+        sad_add_uint32(&s, SAD_FIELD_MAX_LATENCY_MS, max_latency_ms);
+    int n = sad_encode(&s, q->buf, sizeof(q->buf));
+    sad_view_init(&q->view, q->buf, n > 0 ? (size_t)n : 0);
+}
+
+static void ol_hits(offload_t *o, int i, int times)
+{
+    ol_query_t q;
+    ol_query(&q, i, 1000, 0);
+    for (int n = 0; n < times; n++)
+        offload_record(o, &q.view);
+}
+
+static int ol_refresh(offload_t *o, routing_table_t *rt, offload_stats_t *st)
+{
+    const routing_table_view_t *view = routing_table_pin(rt);
+    int rc = offload_refresh(o, view, st);
+    routing_table_unpin(view);
+    return rc;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: top keys promoted within budget, followed as traffic and routes
+ * change
+ * -------------------------------------------------------------------------- */
+
+static int test_offload_promote(void)
+{
+    int errors = 0;
+    memset(&g_sw, 0, sizeof(g_sw));
+
+    offload_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    TASSERT(offload_create(&cfg) == NULL);          /* no write_fn */
+
+    cfg.tcam_budget  = 4;
+    cfg.sample_every = 1;
+    cfg.min_count    = 4;
+    cfg.write_fn     = ol_switch_write;
+    offload_t *o = offload_create(&cfg);
+    TASSERT(o != NULL);
+
+    routing_table_t *rt = routing_table_create(16);
+    for (int i = 0; i < 8; i++) {
+        route_entry_t e = ol_route(i, 0, 4096);
+        routing_table_insert(rt, &e);
+    }
+
+    static const int counts[] = { 100, 80, 60, 40, 20, 10, 2 };
+    for (int i = 0; i < 7; i++)
+        ol_hits(o, i, counts[i]);
+
+    offload_stats_t st;
+    TASSERT(ol_refresh(o, rt, &st) == 0);
+    TASSERT(st.candidates == 6);                    /* 2 hits stay below min */
+    TASSERT(st.added == 4 && st.evicted == 0 && st.failed == 0);
+    TASSERT(st.installed == 4 && offload_installed(o) == 4);
+    TASSERT(g_sw.count == 4);
+    for (int i = 0; i < 4; i++) {
+        const p4rt_op_t *e = ol_switch_find(100u + (uint32_t)i);
+        TASSERT(e != NULL);
+        if (!e) continue;
+        TASSERT(e->node_id[0] == 0xE0 && e->node_id[2] == i);
+        TASSERT(e->sad_key.capability == CAP_TEXT_GEN);
+        TASSERT(e->sad_key.context_window == 1000);
+        TASSERT(e->sad_mask.model_arch == 0xFFFFFFFFu &&
+                e->sad_mask.capability == 0xFFFFFFFFu &&
+                e->sad_mask.context_window == 0xFFFFFFFFu);
+        TASSERT(e->priority == 96);
+    }
+
+    /* Nothing changed: nothing written */
+    int ops = g_sw.ops;
+    TASSERT(ol_refresh(o, rt, &st) == 0);
+    TASSERT(g_sw.ops == ops);
+    TASSERT(st.installed == 4 && st.added + st.modified + st.evicted == 0);
+
+    /* A new hot key displaces the coldest */
+    ol_hits(o, 7, 500);
+    TASSERT(ol_refresh(o, rt, &st) == 0);
+    TASSERT(st.added == 1 && st.evicted == 1);
+    TASSERT(ol_switch_find(107) != NULL);
+    TASSERT(ol_switch_find(103) == NULL);
+
+    /* Another node takes over arch 100: modified in place */
+    uint8_t id[16];
+    route_entry_t moved = ol_route(0, 0, 4096);
+    memcpy(id, moved.node_id, 16);
+    routing_table_remove(rt, id);
+    moved = ol_route(0, 9, 4096);
+    routing_table_insert(rt, &moved);
+    TASSERT(ol_refresh(o, rt, &st) == 0);
+    TASSERT(st.modified == 1 && st.added == 0 && st.evicted == 0);
+    TASSERT(ol_switch_find(100) != NULL && ol_switch_find(100)->node_id[1] == 9);
+
+    /* Nothing serves arch 101 any more: evicted */
+    route_entry_t gone = ol_route(1, 0, 4096);
+    routing_table_remove(rt, gone.node_id);
+    TASSERT(ol_refresh(o, rt, &st) == 0);
+    TASSERT(ol_switch_find(101) == NULL);
+    TASSERT(st.evicted >= 1);
+
+    /* Cooling down: counts halve every refresh until all are evicted */
+    for (int r = 0; r < 12; r++)
+        ol_refresh(o, rt, &st);
+    TASSERT(st.installed == 0 && st.candidates == 0);
+    TASSERT(g_sw.count == 0);
+
+    ol_hits(o, 2, 50);
+    TASSERT(ol_refresh(o, rt, &st) == 0 && g_sw.count == 1);
+    TASSERT(offload_clear(o) == 0);
+    TASSERT(g_sw.count == 0 && offload_installed(o) == 0);
+
+    offload_destroy(o);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: ambiguous keys stay in software; widened masks; failed writes
+ * -------------------------------------------------------------------------- */
+
+static int test_offload_keys(void)
+{
+    int errors = 0;
+    memset(&g_sw, 0, sizeof(g_sw));
+
+    offload_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.tcam_budget   = 8;
+    cfg.sample_every  = 1;
+    cfg.min_count     = 4;
+    cfg.widen_context = true;
+    cfg.write_fn      = ol_switch_write;
+    offload_t *o = offload_create(&cfg);
+    TASSERT(o != NULL);
+
+    routing_table_t *rt = routing_table_create(16);
+    route_entry_t e0 = ol_route(0, 0, 8191);
+    route_entry_t e1 = ol_route(1, 0, 16000);
+    route_entry_t e2 = ol_route(2, 0, 4096);
+    routing_table_insert(rt, &e0);
+    routing_table_insert(rt, &e1);
+    routing_table_insert(rt, &e2);
+
+    /* Arch 100: the same key with two latency bounds */
+    ol_query_t a, b, c, d;
+    ol_query(&a, 0, 1000, 0);
+    ol_query(&b, 0, 1000, 50);
+    /* Arch 101: 9000 tokens is past the largest prefix 16000 allows */
+    ol_query(&c, 1, 9000, 0);
+    /* Arch 102: 3000 tokens, node window 4096 -> prefix [0, 4096) */
+    ol_query(&d, 2, 3000, 0);
+    for (int n = 0; n < 40; n++) {
+        offload_record(o, &a.view);
+        offload_record(o, &b.view);
+        offload_record(o, &c.view);
+        offload_record(o, &d.view);
+    }
+
+    /* Writes fail: nothing is considered installed */
+    g_sw.fail = 1;
+    offload_stats_t st;
+    TASSERT(ol_refresh(o, rt, &st) == 2);
+    TASSERT(st.failed == 2 && st.installed == 0 && offload_installed(o) == 0);
+    TASSERT(st.conflicted == 1 && st.candidates == 3);
+
+    g_sw.fail = 0;
+    TASSERT(ol_refresh(o, rt, &st) == 0);
+    TASSERT(st.added == 2 && st.installed == 2);
+    TASSERT(ol_switch_find(100) == NULL);
+
+    const p4rt_op_t *exact = ol_switch_find(101);
+    TASSERT(exact != NULL);
+    if (exact) {
+        TASSERT(exact->sad_mask.context_window == 0xFFFFFFFFu);
+        TASSERT(exact->sad_key.context_window == 9000);
+        TASSERT(exact->priority == 96);
+    }
+    const p4rt_op_t *wide = ol_switch_find(102);
+    TASSERT(wide != NULL);
+    if (wide) {
+        TASSERT(wide->sad_mask.context_window == 0xFFFFF000u);
+        TASSERT(wide->sad_key.context_window == 0);
+        TASSERT(wide->priority == 96 - 12);
+    }
+
+    /* A failed eviction is retried on the next refresh */
+    routing_table_remove(rt, e2.node_id);
+    g_sw.fail = 1;
+    TASSERT(ol_refresh(o, rt, &st) == 1);
+    TASSERT(st.installed == 2);
+    g_sw.fail = 0;
+    TASSERT(ol_refresh(o, rt, &st) == 0);
+    TASSERT(st.evicted == 1 && st.installed == 1);
+    TASSERT(ol_switch_find(102) == NULL);
+
+    offload_destroy(o);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: the forwarding engine samples what it resolves
+ * -------------------------------------------------------------------------- */
+
+static int ol_send_ok(strandlink_port_t port, const strandlink_frame_t *frame,
+                      void *ctx)
+{
+    (void)port;
+    (void)frame;
+    (void)ctx;
+    return 0;
+}
+
+static int test_offload_forwarding(void)
+{
+    int errors = 0;
+    memset(&g_sw, 0, sizeof(g_sw));
+
+    offload_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.tcam_budget  = 4;
+    cfg.sample_every = 4;
+    cfg.write_fn     = ol_switch_write;
+    offload_t *o = offload_create(&cfg);
+    TASSERT(o != NULL);
+
+    routing_table_t *rt = routing_table_create(16);
+    route_entry_t e = ol_route(3, 0, 4096);
+    routing_table_insert(rt, &e);
+
+    uint8_t self_id[16] = { 0x01 };
+    forwarding_engine_t eng;
+    forwarding_engine_init(&eng, self_id, rt, ol_send_ok, NULL);
+    forwarding_engine_set_offload(&eng, o);
+
+    ol_query_t q;
+    ol_query(&q, 3, 1000, 0);
+    strandlink_frame_t *frame = malloc(sizeof(strandlink_frame_t));
+    TASSERT(frame != NULL);
+    for (int n = 0; frame && n < 200; n++) {
+        memset(&frame->header, 0, sizeof(frame->header));
+        frame->header.ttl = 8;
+        frame->header.dst_node_id[0] = 0xAA;
+        memcpy(frame->payload, q.buf, q.view.length);
+        frame->header.options_length = q.view.length;
+        frame->header.payload_length = q.view.length;
+        TASSERT(forwarding_engine_process_frame(&eng, frame, 0) == 0);
+    }
+
+    offload_stats_t st;
+    TASSERT(ol_refresh(o, rt, &st) == 0);
+    TASSERT(st.installed == 1);
+    TASSERT(ol_switch_find(103) != NULL);
+
+    free(frame);
+    forwarding_engine_destroy(&eng);
+    offload_destroy(o);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_offload_tests(void)
+{
+    test_register("offload_promote",      test_offload_promote);
+    test_register("offload_keys",         test_offload_keys);
+    test_register("offload_forwarding",   test_offload_forwarding);
+}
@@ -0,0 +1,273 @@
+/*
+ * test_p4_runtime.c - P4Runtime client tests (stub mode)
+ *
+ * In stub mode the handle cache stands in for the switch, so batching,
+ * the background writer and diff sync can be checked without BMv2.
+ */
+
+#include "strandroute/p4_runtime.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/sad.h"
+#include "strandroute/types.h"
+
+#include <pthread.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Helpers
+ * -------------------------------------------------------------------------- */
+
+#define P4_NODES 1000
+
+static void p4_node(uint8_t id[16], int i)
+{
+    memset(id, 0, 16);
+    id[0] = 0xD0;
+    id[1] = (uint8_t)(i >> 8);
+    id[2] = (uint8_t)i;
+}
+
+static void p4_node_op(p4rt_op_t *op, p4rt_op_type_t type, int i, int port)
+{
+    memset(op, 0, sizeof(*op));
+    op->type = type;
+    op->egress_port = port;
+    p4_node(op->node_id, i);
+}
+
+static route_entry_t p4_route(int i, uint32_t ctx)
+{
+    route_entry_t e;
+    memset(&e, 0, sizeof(e));
+    p4_node(e.node_id, i);
+    sad_init(&e.capabilities);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_MODEL_ARCH, MODEL_ARCH_TRANSFORMER);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CONTEXT_WINDOW, ctx);
+    return e;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: batches, the handle cache and in-batch ordering
+ * -------------------------------------------------------------------------- */
+
+static p4rt_op_t g_ops[P4_NODES];
+
+static int test_p4rt_batch(void)
+{
+    int errors = 0;
+
+    p4rt_op_t one;
+    p4_node_op(&one, P4RT_OP_NODE_ADD, 0, 1);
+    TASSERT(p4rt_batch_write(&one, 1) == P4RT_ERR_CONN);
+    TASSERT(one.result == P4RT_ERR_CONN);
+
+    TASSERT(p4rt_init(NULL, 0) == P4RT_OK);
+
+    for (int i = 0; i < P4_NODES; i++)
+        p4_node_op(&g_ops[i], P4RT_OP_NODE_ADD, i, i % 64);
+    TASSERT(p4rt_batch_write(g_ops, P4_NODES) == 0);
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_NODE_FORWARD) == P4_NODES);
+
+    /* Re-adding is idempotent; a new port is a modify, not a second entry */
+    TASSERT(p4rt_batch_write(g_ops, P4_NODES) == 0);
+    g_ops[7].egress_port = 3;
+    TASSERT(p4rt_batch_write(&g_ops[7], 1) == 0);
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_NODE_FORWARD) == P4_NODES);
+
+    /* Deletes go by cached handle; a second delete finds nothing */
+    for (int i = 0; i < P4_NODES / 2; i++)
+        p4_node_op(&g_ops[i], P4RT_OP_NODE_DELETE, i, 0);
+    TASSERT(p4rt_batch_write(g_ops, P4_NODES / 2) == 0);
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_NODE_FORWARD) == P4_NODES / 2);
+    TASSERT(p4rt_batch_write(g_ops, P4_NODES / 2) == P4_NODES / 2);
+    TASSERT(g_ops[0].result == P4RT_ERR_NOT_FOUND);
+    TASSERT(p4rt_node_forward_delete(g_ops[0].node_id) == P4RT_ERR_NOT_FOUND);
+
+    /* Operations on one key inside a window apply in order */
+    p4rt_op_t seq[4];
+    p4_node_op(&seq[0], P4RT_OP_NODE_ADD, 5000, 1);
+    p4_node_op(&seq[1], P4RT_OP_NODE_DELETE, 5000, 0);
+    p4_node_op(&seq[2], P4RT_OP_NODE_ADD, 5000, 2);
+    p4_node_op(&seq[3], P4RT_OP_NODE_ADD, 5001, 600);   /* bad port */
+    TASSERT(p4rt_batch_write(seq, 4) == 1);
+    TASSERT(seq[0].result == P4RT_OK && seq[1].result == P4RT_OK &&
+            seq[2].result == P4RT_OK);
+    TASSERT(seq[3].result == P4RT_ERR_INVAL);
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_NODE_FORWARD) == P4_NODES / 2 + 1);
+
+    /* The single-entry API shares the cache */
+    sad_t sad;
+    sad_init(&sad);
+    sad_add_uint32(&sad, SAD_FIELD_CAPABILITY, CAP_CODE_GEN);
+    uint8_t node[16];
+    p4_node(node, 1);
+    TASSERT(p4rt_sad_table_add(&sad, node) == P4RT_OK);
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_SAD) == 1);
+    TASSERT(p4rt_sad_table_delete(&sad) == P4RT_OK);
+    TASSERT(p4rt_sad_table_delete(&sad) == P4RT_ERR_NOT_FOUND);
+
+    p4rt_close();
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_NODE_FORWARD) == 0);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: background writer completes everything, in order, with callbacks
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    int done;
+    int failed;
+    int last_node;
+    int misordered;
+} p4_done_t;
+
+static void p4_on_done(const p4rt_op_t *op, void *ctx)
+{
+    p4_done_t *d = ctx;
+    int node = (op->node_id[1] << 8) | op->node_id[2];
+    if (node <= d->last_node) d->misordered++;
+    d->last_node = node;
+    if (op->result != P4RT_OK) d->failed++;
+    d->done++;
+}
+
+static int test_p4rt_async(void)
+{
+    int errors = 0;
+
+    TASSERT(p4rt_init(NULL, 0) == P4RT_OK);
+    TASSERT(p4rt_async_submit(&g_ops[0], NULL, NULL) == P4RT_ERR_GENERIC);
+    TASSERT(p4rt_async_flush() == P4RT_ERR_GENERIC);
+
+    TASSERT(p4rt_async_start(16) == P4RT_OK);
+    TASSERT(p4rt_async_start(16) == P4RT_ERR_GENERIC);
+
+    p4_done_t d = { 0, 0, -1, 0 };
+    int full = 0;
+    for (int i = 0; i < P4_NODES; ) {
+        p4rt_op_t op;
+        p4_node_op(&op, P4RT_OP_NODE_ADD, i, 1);
+        int rc = p4rt_async_submit(&op, p4_on_done, &d);
+        if (rc == P4RT_OK) {
+            i++;
+        } else {
+            TASSERT(rc == P4RT_ERR_FULL);
+            full++;
+            p4rt_async_flush();
+        }
+    }
+    TASSERT(p4rt_async_flush() == P4RT_OK);
+    TASSERT(d.done == P4_NODES);
+    TASSERT(d.failed == 0);
+    TASSERT(d.misordered == 0);
+    TASSERT(full > 0);                  /* depth 16 < P4_NODES */
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_NODE_FORWARD) == P4_NODES);
+
+    /* Stop drains what is queued */
+    p4rt_op_t del;
+    p4_node_op(&del, P4RT_OP_NODE_DELETE, 0, 0);
+    TASSERT(p4rt_async_submit(&del, NULL, NULL) == P4RT_OK);
+    p4rt_async_stop();
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_NODE_FORWARD) == P4_NODES - 1);
+    TASSERT(p4rt_async_submit(&del, NULL, NULL) == P4RT_ERR_GENERIC);
+
+    p4rt_close();
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: diff sync sends only what changed
+ * -------------------------------------------------------------------------- */
+
+static int test_p4rt_sync(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = routing_table_create(64);
+    TASSERT(rt != NULL);
+    for (int i = 0; i < 100; i++) {
+        route_entry_t e = p4_route(i, 1024u * (uint32_t)(i + 1));
+        routing_table_insert(rt, &e);
+    }
+    /* Same TCAM key as row 0: not its own entry */
+    route_entry_t dup = p4_route(100, 1024u);
+    routing_table_insert(rt, &dup);
+
+    TASSERT(p4rt_init(NULL, 0) == P4RT_OK);
+
+    p4rt_sync_stats_t st;
+    const routing_table_view_t *view = routing_table_pin(rt);
+    TASSERT(p4rt_sync_routing_table(view, &st) == P4RT_OK);
+    routing_table_unpin(view);
+    TASSERT(st.added == 100 && st.modified == 0 && st.deleted == 0);
+    TASSERT(st.unchanged == 0 && st.failed == 0);
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_SAD) == 100);
+
+    /* Steady state: nothing to send */
+    view = routing_table_pin(rt);
+    TASSERT(p4rt_sync_routing_table(view, &st) == P4RT_OK);
+    routing_table_unpin(view);
+    TASSERT(st.unchanged == 100);
+    TASSERT(st.added + st.modified + st.deleted == 0);
+
+    /* One row gone, one key now served by another node */
+    uint8_t id[16];
+    p4_node(id, 10);
+    routing_table_remove(rt, id);
+    p4_node(id, 20);
+    routing_table_remove(rt, id);
+    route_entry_t moved = p4_route(200, 1024u * 21);
+    routing_table_insert(rt, &moved);
+
+    view = routing_table_pin(rt);
+    TASSERT(p4rt_sync_routing_table(view, &st) == P4RT_OK);
+    routing_table_unpin(view);
+    TASSERT(st.deleted == 1);
+    TASSERT(st.modified == 1);
+    TASSERT(st.added == 0);
+    TASSERT(st.unchanged == 98);
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_SAD) == 99);
+
+    /* node_id_forward from a plain list */
+    p4rt_node_route_t routes[3];
+    for (int i = 0; i < 3; i++) {
+        p4_node(routes[i].node_id, i);
+        routes[i].egress_port = i + 1;
+    }
+    TASSERT(p4rt_sync_node_forward(routes, 3, &st) == P4RT_OK);
+    TASSERT(st.added == 3);
+    routes[1].egress_port = 9;
+    TASSERT(p4rt_sync_node_forward(routes, 2, &st) == P4RT_OK);
+    TASSERT(st.unchanged == 1 && st.modified == 1 && st.deleted == 1);
+    TASSERT(p4rt_cached_entries(P4RT_TABLE_NODE_FORWARD) == 2);
+    routes[0].egress_port = 512;
+    TASSERT(p4rt_sync_node_forward(routes, 1, &st) == P4RT_ERR_INVAL);
+
+    p4rt_close();
+    TASSERT(p4rt_sync_node_forward(routes, 0, &st) == P4RT_ERR_CONN);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_p4_runtime_tests(void)
+{
+    test_register("p4rt_batch",  test_p4rt_batch);
+    test_register("p4rt_async",  test_p4rt_async);
+    test_register("p4rt_sync",   test_p4rt_sync);
+}
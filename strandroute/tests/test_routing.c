@@ -2,13 +2,17 @@
  * test_routing.c - Routing table CRUD + concurrent read tests
  */
 
+#include "strandroute/numa.h"
 #include "strandroute/routing_table.h"
 #include "strandroute/sad.h"
+#include "strandroute/sad_match.h"
 #include "strandroute/types.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 
 /* --------------------------------------------------------------------------
  * Test framework hooks
@@ -430,6 +434,996 @@ static int test_routing_gc_null(void)
     return errors;
 }
 
+/* --------------------------------------------------------------------------
+ * Test: timer-driven expiry agrees with the full sweep
+ * -------------------------------------------------------------------------- */
+
+#define EXPIRE_N 2000
+
+static route_entry_t expire_entry(int i, uint64_t now, uint64_t ttl)
+{
+    route_entry_t e = make_entry(0xE0, CAP_TEXT_GEN, 0, 1000, 100,
+                                 TRUST_IDENTITY, 840);
+    e.node_id[1]    = (uint8_t)(i >> 8);
+    e.node_id[2]    = (uint8_t)i;
+    e.last_updated  = now;
+    e.ttl_ns        = ttl;
+    return e;
+}
+
+static int test_routing_expire_ttl(void)
+{
+    int errors = 0;
+
+    /* Same writes into both; one expires by timer, one by sweep */
+    routing_table_t *rt  = routing_table_create(64);
+    routing_table_t *ref = routing_table_create(64);
+    TASSERT(rt != NULL && ref != NULL);
+
+    uint64_t t0 = 100 * NS_PER_SEC;
+    for (int i = 0; i < EXPIRE_N; i++) {
+        /* TTLs 1..10 s; every 7th entry permanent */
+        uint64_t ttl = (i % 7 == 0) ? 0 : (uint64_t)(1 + i % 10) * NS_PER_SEC;
+        route_entry_t e = expire_entry(i, t0, ttl);
+        routing_table_insert(rt, &e);
+        routing_table_insert(ref, &e);
+    }
+
+    /* Nothing due yet: no publish */
+    const routing_table_view_t *v = routing_table_pin(rt);
+    uint64_t gen = routing_table_view_generation(v);
+    routing_table_unpin(v);
+    TASSERT(routing_table_expire(rt, t0 + NS_PER_SEC / 2) == 0);
+    v = routing_table_pin(rt);
+    TASSERT(routing_table_view_generation(v) == gen);
+    routing_table_unpin(v);
+
+    for (int step = 1; step <= 12; step++) {
+        uint64_t now = t0 + (uint64_t)step * NS_PER_SEC + NS_PER_SEC / 2;
+
+        /* Churn: refresh some, remove some, re-add some with new TTLs */
+        for (int i = step; i < EXPIRE_N; i += 13) {
+            route_entry_t e = expire_entry(i, now - NS_PER_SEC / 4,
+                                           (uint64_t)(1 + (i + step) % 4) * NS_PER_SEC);
+            routing_table_insert(rt, &e);
+            routing_table_insert(ref, &e);
+        }
+        for (int i = step * 3; i < EXPIRE_N; i += 97) {
+            routing_table_remove(rt, expire_entry(i, 0, 0).node_id);
+            routing_table_remove(ref, expire_entry(i, 0, 0).node_id);
+        }
+
+        int a = routing_table_expire(rt, now);
+        int b = routing_table_gc(ref, now);
+        TASSERT(a == b);
+        TASSERT(routing_table_size(rt) == routing_table_size(ref));
+    }
+
+    /* Only the permanent entries outlive every TTL */
+    TASSERT(routing_table_expire(rt, t0 + 60 * NS_PER_SEC) >= 0);
+    routing_table_gc(ref, t0 + 60 * NS_PER_SEC);
+    TASSERT(routing_table_size(rt) == routing_table_size(ref));
+    static route_entry_t snap[EXPIRE_N];
+    int n = routing_table_snapshot(rt, snap, EXPIRE_N);
+    int permanent = 0;
+    for (int i = 0; i < n; i++)
+        permanent += snap[i].ttl_ns == 0;
+    TASSERT(permanent == n && n > 0);
+
+    TASSERT(routing_table_expire(NULL, 0) == -1);
+    routing_table_destroy(rt);
+    routing_table_destroy(ref);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: columnar lookup matches the reference AoS matcher
+ *
+ * Builds a pseudo-random table, then checks that routing_table_lookup
+ * (compiled query over snapshot columns) returns exactly the same
+ * entries and scores as sad_find_best over the raw entry array.
+ * -------------------------------------------------------------------------- */
+
+#define COLUMNAR_ENTRIES  200
+#define COLUMNAR_QUERIES  64
+
+static uint32_t test_rand_state = 0x2545F491u;
+
+static uint32_t test_rand(void)
+{
+    test_rand_state ^= test_rand_state << 13;
+    test_rand_state ^= test_rand_state >> 17;
+    test_rand_state ^= test_rand_state << 5;
+    return test_rand_state;
+}
+
+static const uint16_t test_regions[] = { 840, 276, 250, 392, 156, 124 };
+#define NUM_TEST_REGIONS (sizeof(test_regions) / sizeof(test_regions[0]))
+
+static route_entry_t make_random_entry(uint16_t id)
+{
+    route_entry_t e = make_entry(0, test_rand() & 0xFF,
+                                 (test_rand() % 3) ? 4096u << (test_rand() % 7) : 0,
+                                 test_rand() % 400000, test_rand() % 8000,
+                                 (uint8_t)(test_rand() % 5),
+                                 test_regions[test_rand() % NUM_TEST_REGIONS]);
+    e.node_id[0] = (uint8_t)(id >> 8);
+    e.node_id[1] = (uint8_t)id;
+    e.node_id[2] = 0x5A;
+    if (test_rand() % 4)
+        sad_add_uint32(&e.capabilities, SAD_FIELD_MODEL_ARCH,
+                       1 + test_rand() % 3);
+    return e;
+}
+
+static void make_random_query(sad_t *q)
+{
+    sad_init(q);
+    if (test_rand() % 2)
+        sad_add_uint32(q, SAD_FIELD_MODEL_ARCH, 1 + test_rand() % 3);
+    if (test_rand() % 4)
+        sad_add_uint32(q, SAD_FIELD_CAPABILITY, test_rand() & 0xFF);
+    if (test_rand() % 3 == 0)
+        sad_add_uint32(q, SAD_FIELD_CONTEXT_WINDOW, 4096u << (test_rand() % 6));
+    if (test_rand() % 2)
+        sad_add_uint32(q, SAD_FIELD_MAX_LATENCY_MS, test_rand() % 500);
+    if (test_rand() % 2)
+        sad_add_uint32(q, SAD_FIELD_MAX_COST_MILLI, test_rand() % 9000);
+    if (test_rand() % 3 == 0)
+        sad_add_uint8(q, SAD_FIELD_TRUST_LEVEL, (uint8_t)(test_rand() % 5));
+    if (test_rand() % 3 == 0) {
+        uint16_t r[2] = { test_regions[test_rand() % NUM_TEST_REGIONS],
+                          test_regions[test_rand() % NUM_TEST_REGIONS] };
+        sad_add_regions(q, SAD_FIELD_REGION_PREFER, r, 2);
+    }
+    if (test_rand() % 4 == 0) {
+        uint16_t r = test_regions[test_rand() % NUM_TEST_REGIONS];
+        sad_add_regions(q, SAD_FIELD_REGION_EXCLUDE, &r, 1);
+    }
+}
+
+static int test_routing_columnar_matches_reference(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = routing_table_create(16);
+    TASSERT(rt != NULL);
+
+    for (uint16_t i = 0; i < COLUMNAR_ENTRIES; i++) {
+        route_entry_t e = make_random_entry(i);
+        TASSERT(routing_table_insert(rt, &e) == 0);
+    }
+    /* Exercise row moves and metric updates in the columns too */
+    for (uint16_t i = 0; i < COLUMNAR_ENTRIES; i += 7) {
+        route_entry_t e = make_random_entry(i);
+        routing_table_remove(rt, e.node_id);
+    }
+    for (uint16_t i = 1; i < COLUMNAR_ENTRIES; i += 5) {
+        route_entry_t e = make_random_entry(i);
+        routing_table_update_metrics(rt, e.node_id, test_rand() % 400000, 0.25f);
+    }
+
+    static route_entry_t snap[COLUMNAR_ENTRIES];
+    int n = routing_table_snapshot(rt, snap, COLUMNAR_ENTRIES);
+    TASSERT(n == (int)routing_table_size(rt));
+
+    for (int qi = 0; qi < COLUMNAR_QUERIES; qi++) {
+        sad_t query;
+        make_random_query(&query);
+
+        resolve_result_t got[8], want[8];
+        int n_got  = routing_table_lookup(rt, &query, got, 8);
+        int n_want = sad_find_best(&query, snap, n, NULL, 8, want);
+        TASSERT(n_got == n_want);
+
+        for (int k = 0; k < n_got && k < n_want; k++) {
+            TASSERT(node_id_equal(got[k].entry.node_id, want[k].entry.node_id));
+            TASSERT(got[k].score == want[k].score);
+        }
+    }
+
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: metric updates land in place (no republish), so they neither wait
+ *       for a pinned reader nor disturb it, and survive later rewrites
+ * -------------------------------------------------------------------------- */
+
+static int test_routing_metrics_in_place(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = routing_table_create(4);
+    TASSERT(rt != NULL);
+
+    for (uint8_t i = 1; i <= 20; i++) {
+        route_entry_t e = make_entry(i, 0x01, 0, 1000u * i, 100, 3, 840);
+        TASSERT(routing_table_insert(rt, &e) == 0);
+    }
+
+    uint8_t id[16] = { 7 };
+
+    /* A pinned reader would block a copy-on-write publish forever here */
+    const routing_table_view_t *view = routing_table_pin(rt);
+    TASSERT(routing_table_update_metrics(rt, id, 555000, 0.75f) == 0);
+
+    int row = -1;
+    for (uint32_t i = 0; i < routing_table_view_count(view); i++) {
+        if (node_id_equal(routing_table_view_entry(view, i)->node_id, id))
+            row = (int)i;
+    }
+    TASSERT(row >= 0);
+
+    uint32_t lat = 0;
+    float load = 0.0f;
+    TASSERT(routing_table_view_metrics(view, (uint32_t)row, &lat, &load) == 0);
+    TASSERT(lat == 555000);
+    TASSERT(load == 0.75f);
+    TASSERT(routing_table_view_metrics(view, 20, &lat, NULL) == -1);
+    routing_table_unpin(view);
+
+    /* Lookup results and snapshots report the live metrics */
+    sad_t query;
+    sad_init(&query);
+    sad_add_uint32(&query, SAD_FIELD_MAX_LATENCY_MS, 100);
+    resolve_result_t res[20];
+    int n = routing_table_lookup(rt, &query, res, 20);
+    TASSERT(n == 20);
+    TASSERT(node_id_equal(res[n - 1].entry.node_id, id));
+    TASSERT(res[n - 1].entry.latency_us == 555000);
+    TASSERT(res[n - 1].entry.load_factor == 0.75f);
+
+    /* Structural writes (including a row move on remove) carry them along */
+    uint8_t first[16] = { 1 };
+    TASSERT(routing_table_remove(rt, first) == 0);
+    route_entry_t extra = make_entry(99, 0x01, 0, 1000, 100, 3, 840);
+    TASSERT(routing_table_insert(rt, &extra) == 0);
+
+    route_entry_t snap[32];
+    n = routing_table_snapshot(rt, snap, 32);
+    TASSERT(n == 20);
+    int seen = 0;
+    for (int i = 0; i < n; i++) {
+        if (node_id_equal(snap[i].node_id, id)) {
+            seen++;
+            TASSERT(snap[i].latency_us == 555000);
+            TASSERT(snap[i].load_factor == 0.75f);
+        }
+    }
+    TASSERT(seen == 1);
+
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: lookups scoring latency while metrics are stored in place
+ *
+ * Readers score the live latency column; under -DENABLE_TSAN=ON this must
+ * run without a report.
+ * -------------------------------------------------------------------------- */
+
+#define METRIC_RACE_ROWS     64
+#define METRIC_RACE_UPDATES  20000
+
+typedef struct {
+    const routing_table_t *rt;
+    _Atomic bool          *stop;
+    int                    bad;
+} metric_reader_ctx_t;
+
+static void *metric_reader_thread(void *arg)
+{
+    metric_reader_ctx_t *ctx = arg;
+
+    sad_t query;
+    sad_init(&query);
+    sad_add_uint32(&query, SAD_FIELD_MAX_LATENCY_MS, 400);
+
+    resolve_result_t res[4];
+    while (!atomic_load(ctx->stop)) {
+        int n = routing_table_lookup(ctx->rt, &query, res, 4);
+        if (n != 4 || res[0].score < res[3].score)
+            ctx->bad++;
+    }
+    return NULL;
+}
+
+static int test_routing_metrics_concurrent(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = routing_table_create(METRIC_RACE_ROWS);
+    TASSERT(rt != NULL);
+    for (uint8_t i = 1; i <= METRIC_RACE_ROWS; i++) {
+        route_entry_t e = make_entry(i, 0x01, 0, 1000u * i, 100, 3, 840);
+        TASSERT(routing_table_insert(rt, &e) == 0);
+    }
+
+    _Atomic bool stop = false;
+    pthread_t threads[CONCURRENT_READERS];
+    metric_reader_ctx_t contexts[CONCURRENT_READERS];
+    for (int i = 0; i < CONCURRENT_READERS; i++) {
+        contexts[i] = (metric_reader_ctx_t){ .rt = rt, .stop = &stop };
+        pthread_create(&threads[i], NULL, metric_reader_thread, &contexts[i]);
+    }
+
+    for (int i = 0; i < METRIC_RACE_UPDATES; i++) {
+        uint8_t id[16] = { (uint8_t)(1 + i % METRIC_RACE_ROWS) };
+        TASSERT(routing_table_update_metrics(rt, id, test_rand() % 400000,
+                                             0.5f) == 0);
+    }
+
+    atomic_store(&stop, true);
+    for (int i = 0; i < CONCURRENT_READERS; i++) {
+        pthread_join(threads[i], NULL);
+        TASSERT(contexts[i].bad == 0);
+    }
+
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: a transaction stages many mixed writes, keeps readers on the old
+ *       table until commit, and publishes the same table the individual
+ *       calls would have built
+ * -------------------------------------------------------------------------- */
+
+#define TXN_IDS  300
+
+static int test_routing_txn_batch(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = routing_table_create(8);
+    TASSERT(rt != NULL);
+
+    /* Reference model: which ids are present, and with what latency */
+    static bool     present[TXN_IDS];
+    static uint32_t latency[TXN_IDS];
+    memset(present, 0, sizeof(present));
+
+    for (int round = 0; round < 4; round++) {
+        uint32_t size_before = routing_table_size(rt);
+
+        routing_table_txn_t *txn = routing_table_txn_begin(rt);
+        TASSERT(txn != NULL);
+
+        for (int op = 0; op < 400; op++) {
+            uint16_t id = (uint16_t)(test_rand() % TXN_IDS);
+            route_entry_t e = make_random_entry(id);
+            int kind = (int)(test_rand() % 4);
+
+            if (kind <= 1) {
+                TASSERT(routing_table_txn_insert(txn, &e) == 0);
+                present[id] = true;
+                latency[id] = e.latency_us;
+            } else if (kind == 2) {
+                int rc = routing_table_txn_remove(txn, e.node_id);
+                TASSERT(rc == (present[id] ? 0 : -1));
+                present[id] = false;
+            } else {
+                uint32_t lat = test_rand() % 400000;
+                int rc = routing_table_txn_update_metrics(txn, e.node_id, lat, 0.5f);
+                TASSERT(rc == (present[id] ? 0 : -1));
+                if (present[id]) latency[id] = lat;
+            }
+        }
+        TASSERT(routing_table_txn_staged(txn) > 0);
+
+        /* Nothing is visible until commit */
+        TASSERT(routing_table_size(rt) == size_before);
+        TASSERT(routing_table_txn_commit(txn) == 0);
+
+        uint32_t expect = 0;
+        for (int i = 0; i < TXN_IDS; i++)
+            expect += present[i];
+        TASSERT(routing_table_size(rt) == expect);
+
+        static route_entry_t snap[TXN_IDS];
+        int n = routing_table_snapshot(rt, snap, TXN_IDS);
+        TASSERT(n == (int)expect);
+        int bad = 0;
+        for (int i = 0; i < n; i++) {
+            uint16_t id = (uint16_t)((snap[i].node_id[0] << 8) | snap[i].node_id[1]);
+            if (id >= TXN_IDS || !present[id] || snap[i].latency_us != latency[id])
+                bad++;
+        }
+        TASSERT(bad == 0);
+
+        /* Every id resolves (or not) through the published row map */
+        bad = 0;
+        for (uint16_t id = 0; id < TXN_IDS; id++) {
+            route_entry_t e = make_random_entry(id);
+            int rc = routing_table_update_metrics(rt, e.node_id, latency[id], 0.5f);
+            if (rc != (present[id] ? 0 : -1))
+                bad++;
+        }
+        TASSERT(bad == 0);
+    }
+
+    /* Abort drops staged structural changes */
+    uint32_t size_before = routing_table_size(rt);
+    routing_table_txn_t *txn = routing_table_txn_begin(rt);
+    route_entry_t extra = make_entry(0xEE, 0x01, 0, 100, 100, 3, 840);
+    extra.node_id[1] = 0xEE;
+    TASSERT(routing_table_txn_insert(txn, &extra) == 0);
+    routing_table_txn_abort(txn);
+    TASSERT(routing_table_size(rt) == size_before);
+
+    /* GC inside a transaction */
+    txn = routing_table_txn_begin(rt);
+    extra.ttl_ns       = 10;
+    extra.last_updated = 0;
+    TASSERT(routing_table_txn_insert(txn, &extra) == 0);
+    TASSERT(routing_table_txn_gc(txn, 1000) == 1);
+    TASSERT(routing_table_txn_commit(txn) == 0);
+    TASSERT(routing_table_size(rt) == size_before);
+
+    TASSERT(routing_table_txn_begin(NULL) == NULL);
+    TASSERT(routing_table_txn_commit(NULL) == -1);
+    routing_table_txn_abort(NULL);
+
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: index-driven lookups (posting lists, capability branch and bound)
+ *       pick exactly the rows and order a full scan does
+ * -------------------------------------------------------------------------- */
+
+#define INDEXED_ENTRIES  800
+
+static int test_routing_indexed_matches_scan(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = routing_table_create(INDEXED_ENTRIES);
+    TASSERT(rt != NULL);
+
+    for (uint16_t i = 0; i < INDEXED_ENTRIES; i++) {
+        /* Few distinct latencies / costs so equal scores are common */
+        route_entry_t e = make_entry(0, test_rand() & 0x3F,
+                                     (test_rand() % 2) ? 4096u << (test_rand() % 6) : 0,
+                                     (test_rand() % 4) * 50000,
+                                     (test_rand() % 3) * 1000,
+                                     (uint8_t)(test_rand() % 5),
+                                     test_regions[test_rand() % NUM_TEST_REGIONS]);
+        e.node_id[0] = (uint8_t)(i >> 8);
+        e.node_id[1] = (uint8_t)i;
+        e.node_id[2] = 0xA5;
+        if (test_rand() % 8)
+            sad_add_uint32(&e.capabilities, SAD_FIELD_MODEL_ARCH,
+                           1 + test_rand() % 12);
+        TASSERT(routing_table_insert(rt, &e) == 0);
+    }
+
+    static route_entry_t snap[INDEXED_ENTRIES];
+    int n = routing_table_snapshot(rt, snap, INDEXED_ENTRIES);
+    TASSERT(n == INDEXED_ENTRIES);
+
+    static const scoring_weights_t weight_sets[] = {
+        { 0.30f, 0.25f, 0.20f, 0.15f, 0.10f },
+        { 0.90f, 0.00f, 0.05f, 0.00f, 0.05f },   /* capability-dominated */
+        { 0.50f, -0.20f, 0.40f, 0.20f, 0.10f },  /* negative: no pruning */
+    };
+    static const int ks[] = { 1, 3, 8, 70 };
+    static resolve_result_t want[70];
+    sad_hit_t hits[70];
+
+    for (int qi = 0; qi < 96; qi++) {
+        sad_t query;
+        sad_init(&query);
+        if (qi % 2)
+            sad_add_uint32(&query, SAD_FIELD_MODEL_ARCH, 1 + test_rand() % 12);
+        if (qi % 3)
+            sad_add_uint32(&query, SAD_FIELD_CAPABILITY, 1 + (test_rand() & 0x3F));
+        if (qi % 5 == 0)
+            sad_add_uint32(&query, SAD_FIELD_CONTEXT_WINDOW, 4096u << (test_rand() % 7));
+        if (qi % 7 == 0)
+            sad_add_uint8(&query, SAD_FIELD_TRUST_LEVEL, (uint8_t)(1 + test_rand() % 4));
+        if (qi % 4 == 0)
+            sad_add_uint32(&query, SAD_FIELD_MAX_LATENCY_MS, 100 + test_rand() % 200);
+
+        sad_query_t q;
+        sad_query_compile(&query, &q);
+
+        const scoring_weights_t *w = &weight_sets[qi % 3];
+        int k = ks[(qi / 3) % 4];
+
+        int n_want = sad_find_best(&query, snap, n, w, k, want);
+
+        const routing_table_view_t *view = routing_table_pin(rt);
+        int n_got = routing_table_view_lookup(view, &q, w, hits, k);
+        TASSERT(n_got == n_want);
+
+        int bad = 0;
+        for (int i = 0; i < n_got && i < n_want; i++) {
+            const route_entry_t *e = routing_table_view_entry(view, hits[i].index);
+            if (!node_id_equal(e->node_id, want[i].entry.node_id) ||
+                hits[i].score != want[i].score)
+                bad++;
+        }
+        TASSERT(bad == 0);
+        routing_table_unpin(view);
+    }
+
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: pinned views return the same winners as routing_table_lookup and
+ *       resolve row indices back to entries
+ * -------------------------------------------------------------------------- */
+
+static int test_routing_pinned_view(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = routing_table_create(16);
+    TASSERT(rt != NULL);
+
+    for (uint16_t i = 0; i < 50; i++) {
+        route_entry_t e = make_random_entry(i);
+        TASSERT(routing_table_insert(rt, &e) == 0);
+    }
+
+    for (int qi = 0; qi < 16; qi++) {
+        sad_t query;
+        make_random_query(&query);
+        sad_query_t q;
+        sad_query_compile(&query, &q);
+
+        resolve_result_t want[4];
+        int n_want = routing_table_lookup(rt, &query, want, 4);
+
+        const routing_table_view_t *view = routing_table_pin(rt);
+        TASSERT(view != NULL);
+        TASSERT(routing_table_view_count(view) == 50);
+
+        sad_hit_t hits[4];
+        int n_got = routing_table_view_lookup(view, &q, NULL, hits, 4);
+        TASSERT(n_got == n_want);
+        for (int k = 0; k < n_got && k < n_want; k++) {
+            const route_entry_t *e = routing_table_view_entry(view, hits[k].index);
+            TASSERT(e != NULL);
+            TASSERT(node_id_equal(e->node_id, want[k].entry.node_id));
+            TASSERT(hits[k].score == want[k].score);
+        }
+        routing_table_unpin(view);
+    }
+
+    const routing_table_view_t *view = routing_table_pin(rt);
+    TASSERT(routing_table_view_entry(view, 50) == NULL);
+    routing_table_unpin(view);
+
+    TASSERT(routing_table_pin(NULL) == NULL);
+    routing_table_unpin(NULL);
+
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: checkpoint round trip, TTL aging, merge and corruption
+ * -------------------------------------------------------------------------- */
+
+#define CKPT_ENTRIES  300
+#define CKPT_PATH     "strandroute_test_checkpoint.bin"
+#define CKPT_SEC      1000000000ull
+
+/* Bit-at-a-time CRC-32C to check the table and hardware paths against */
+static uint32_t crc32c_ref(const uint8_t *p, size_t len)
+{
+    uint32_t c = 0xFFFFFFFFu;
+    while (len--) {
+        c ^= *p++;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+static long ckpt_file_size(void)
+{
+    FILE *f = fopen(CKPT_PATH, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fclose(f);
+    return n;
+}
+
+static void ckpt_poke(long off, uint8_t xor_mask)
+{
+    FILE *f = fopen(CKPT_PATH, "r+b");
+    if (!f) return;
+    fseek(f, off, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, off, SEEK_SET);
+    fputc((c ^ xor_mask) & 0xFF, f);
+    fclose(f);
+}
+
+static int test_routing_checkpoint(void)
+{
+    int errors = 0;
+
+    /* CRC-32C: the Castagnoli check values, then odd offsets and lengths */
+    const uint8_t check[] = "123456789";
+    const uint8_t zero[1] = { 0 };
+    const uint8_t ones[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+    TASSERT(strandlink_crc32c(check, 9) == 0xE3069283u);
+    TASSERT(strandlink_crc32c(zero, 1) == 0x527D5351u);
+    TASSERT(strandlink_crc32c(ones, 4) == 0xFFFFFFFFu);
+    TASSERT(strandlink_crc32c(check, 0) == 0);
+    TASSERT(strandlink_crc32c(NULL, 4) == 0);
+    static uint8_t buf[1031];
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = (uint8_t)test_rand();
+    for (size_t off = 0; off < 8; off++) {
+        size_t len = sizeof(buf) - off - (off * 37) % 11;
+        TASSERT(strandlink_crc32c(buf + off, (uint32_t)len) ==
+                crc32c_ref(buf + off, len));
+    }
+
+    const uint64_t now = 1000 * CKPT_SEC;
+    routing_table_t *rt = routing_table_create(16);
+    TASSERT(rt != NULL);
+    for (uint16_t i = 0; i < CKPT_ENTRIES; i++) {
+        route_entry_t e = make_random_entry(i);
+        e.last_updated = now - (i % 10) * CKPT_SEC;
+        if (i % 3 == 0)
+            e.ttl_ns = 5 * CKPT_SEC + CKPT_SEC / 2;    /* i % 10 > 5 lapsed */
+        TASSERT(routing_table_insert(rt, &e) == 0);
+    }
+    for (uint16_t i = 0; i < CKPT_ENTRIES; i += 7) {
+        route_entry_t e = make_random_entry(i);
+        routing_table_update_metrics(rt, e.node_id, 1234 + i, 0.5f);
+    }
+
+    remove(CKPT_PATH);
+    TASSERT(routing_table_checkpoint_load(rt, CKPT_PATH, now) == -1);
+    TASSERT(routing_table_checkpoint_save(rt, CKPT_PATH, now) == CKPT_ENTRIES);
+    TASSERT(routing_table_checkpoint_save(NULL, CKPT_PATH, now) == -1);
+
+    uint32_t lapsed = 0;
+    for (uint16_t i = 0; i < CKPT_ENTRIES; i++)
+        lapsed += (i % 3 == 0 && i % 10 > 5);
+
+    /* Restart on a different clock; one node re-learned already */
+    const uint64_t later = 77 * CKPT_SEC;
+    routing_table_t *warm = routing_table_create(4);
+    route_entry_t fresh = make_random_entry(1);
+    fresh.cost_milli = 424242;
+    TASSERT(routing_table_insert(warm, &fresh) == 0);
+    int added = routing_table_checkpoint_load(warm, CKPT_PATH, later);
+    TASSERT(added == (int)(CKPT_ENTRIES - lapsed - 1));
+    TASSERT(routing_table_size(warm) == CKPT_ENTRIES - lapsed);
+
+    static route_entry_t got[CKPT_ENTRIES];
+    static route_entry_t want[CKPT_ENTRIES];
+    int n_got  = routing_table_snapshot(warm, got, CKPT_ENTRIES);
+    int n_want = routing_table_snapshot(rt, want, CKPT_ENTRIES);
+    TASSERT(n_want == CKPT_ENTRIES);
+    int matched = 0;
+    for (int i = 0; i < n_got; i++) {
+        int j = 0;
+        while (j < n_want && !node_id_equal(want[j].node_id, got[i].node_id))
+            j++;
+        if (j == n_want) continue;
+        const route_entry_t *g = &got[i], *w = &want[j];
+        if (node_id_equal(g->node_id, fresh.node_id)) {
+            TASSERT(g->cost_milli == 424242);
+            continue;
+        }
+        /* Ages carry over onto the new clock, give or take the wall
+         * time this test takes between save and load */
+        uint64_t age_was = now - w->last_updated;
+        uint64_t age_now = later - g->last_updated;
+        TASSERT(age_now >= age_was && age_now - age_was < CKPT_SEC);
+        TASSERT(g->latency_us == w->latency_us);
+        TASSERT(g->load_factor == w->load_factor);
+        TASSERT(g->cost_milli == w->cost_milli);
+        TASSERT(g->ttl_ns == w->ttl_ns);
+        TASSERT(g->capabilities.num_fields == w->capabilities.num_fields);
+        TASSERT(sad_get_uint32(&g->capabilities, SAD_FIELD_CAPABILITY) ==
+                sad_get_uint32(&w->capabilities, SAD_FIELD_CAPABILITY));
+        matched++;
+    }
+    TASSERT(matched == added);
+
+    /* Lookups over the loaded columns agree with a table built by insert */
+    routing_table_t *ref = routing_table_create(16);
+    for (int i = 0; i < n_got; i++)
+        routing_table_insert(ref, &got[i]);
+    for (int qi = 0; qi < 32; qi++) {
+        sad_t query;
+        make_random_query(&query);
+        resolve_result_t a[4], b[4];
+        int na = routing_table_lookup(warm, &query, a, 4);
+        int nb = routing_table_lookup(ref, &query, b, 4);
+        TASSERT(na == nb);
+        for (int k = 0; k < na && k < nb; k++) {
+            TASSERT(node_id_equal(a[k].entry.node_id, b[k].entry.node_id));
+            TASSERT(a[k].score == b[k].score);
+        }
+    }
+    routing_table_destroy(ref);
+
+    /* Loaded TTLs are armed */
+    TASSERT(routing_table_expire(warm, later + 6 * CKPT_SEC) ==
+            (int)((CKPT_ENTRIES + 2) / 3 - lapsed));
+
+    /* Any flipped bit, truncation or a trailing byte is refused whole */
+    long size = ckpt_file_size();
+    TASSERT(size > 64 + CKPT_ENTRIES * 72);
+    routing_table_t *cold = routing_table_create(4);
+    const long offs[] = { 0, 12, 40, 64 + 5, 64 + 72 * 17 + 3, size - 1 };
+    for (size_t k = 0; k < sizeof(offs) / sizeof(offs[0]); k++) {
+        ckpt_poke(offs[k], 0x10);
+        TASSERT(routing_table_checkpoint_load(cold, CKPT_PATH, later) == -1);
+        ckpt_poke(offs[k], 0x10);
+    }
+    FILE *f = fopen(CKPT_PATH, "ab");
+    if (f) { fputc(0, f); fclose(f); }
+    TASSERT(routing_table_checkpoint_load(cold, CKPT_PATH, later) == -1);
+    TASSERT(routing_table_size(cold) == 0);
+
+    /* An empty table round-trips */
+    routing_table_t *empty = routing_table_create(4);
+    TASSERT(routing_table_checkpoint_save(empty, CKPT_PATH, now) == 0);
+    TASSERT(ckpt_file_size() == 64);
+    TASSERT(routing_table_checkpoint_load(cold, CKPT_PATH, later) == 0);
+    remove(CKPT_PATH);
+
+    routing_table_destroy(empty);
+    routing_table_destroy(cold);
+    routing_table_destroy(warm);
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: identical capabilities share one interned descriptor, rows expand
+ * back to the entries inserted, and descriptors go once unreferenced
+ * -------------------------------------------------------------------------- */
+
+#define RT_DESC_N      1000
+#define RT_DESC_KINDS  8
+
+static int test_routing_descriptors(void)
+{
+    int errors = 0;
+
+    routing_table_t *rt = routing_table_create(16);
+    TASSERT(rt != NULL);
+
+    static route_entry_t in[RT_DESC_N];
+    for (int i = 0; i < RT_DESC_N; i++) {
+        uint32_t k = (uint32_t)(i % RT_DESC_KINDS);
+        in[i] = make_entry(0, CAP_TEXT_GEN << k, 4096u << k,
+                           1000 + (uint32_t)i, 10 * (uint32_t)i,
+                           (uint8_t)(k % 4), (uint16_t)(100 + k));
+        in[i].node_id[0] = (uint8_t)(i & 0xFF);
+        in[i].node_id[1] = (uint8_t)(i >> 8);
+        in[i].node_id[2] = 0xD5;
+        in[i].last_updated = 5000 + (uint64_t)i;
+        in[i].ttl_ns       = (i % 3) ? 0 : 1000000000ull;
+        in[i].load_factor  = (float)k / 8.0f;
+        TASSERT(routing_table_insert(rt, &in[i]) == 0);
+    }
+    TASSERT(routing_table_size(rt) == RT_DESC_N);
+    TASSERT(routing_table_descriptor_count(rt) == RT_DESC_KINDS);
+
+    /* Capabilities that do not encode cannot be stored */
+    route_entry_t big = in[0];
+    big.node_id[2] = 0xEE;
+    sad_init(&big.capabilities);
+    uint8_t fill[SAD_MAX_FIELD_VALUE];
+    memset(fill, 0x5A, sizeof(fill));
+    for (int f = 0; f < SAD_MAX_FIELDS; f++)
+        sad_add_field(&big.capabilities, SAD_FIELD_PUBLISHER_ID, fill, sizeof(fill));
+    TASSERT(routing_table_insert(rt, &big) == -1);
+    TASSERT(routing_table_size(rt) == RT_DESC_N);
+
+    /* Every row expands back to what was inserted */
+    const routing_table_view_t *view = routing_table_pin(rt);
+    TASSERT(view != NULL);
+    int bad = 0;
+    for (uint32_t r = 0; r < routing_table_view_count(view); r++) {
+        route_entry_t out;
+        TASSERT(routing_table_view_read(view, r, &out) == 0);
+        int i = out.node_id[0] | (out.node_id[1] << 8);
+        const route_entry_t *want = &in[i];
+        if (i >= RT_DESC_N ||
+            memcmp(out.node_id, want->node_id, 16) != 0 ||
+            memcmp(routing_table_view_node_id(view, r), want->node_id, 16) != 0 ||
+            out.capabilities.num_fields != want->capabilities.num_fields ||
+            sad_get_uint32(&out.capabilities, SAD_FIELD_CAPABILITY) !=
+                sad_get_uint32(&want->capabilities, SAD_FIELD_CAPABILITY) ||
+            sad_get_uint32(&out.capabilities, SAD_FIELD_CONTEXT_WINDOW) !=
+                sad_get_uint32(&want->capabilities, SAD_FIELD_CONTEXT_WINDOW) ||
+            out.latency_us != want->latency_us ||
+            out.load_factor != want->load_factor ||
+            out.cost_milli != want->cost_milli ||
+            out.trust_level != want->trust_level ||
+            out.region_code != want->region_code ||
+            out.last_updated != want->last_updated ||
+            out.ttl_ns != want->ttl_ns)
+            bad++;
+    }
+    TASSERT(bad == 0);
+    TASSERT(routing_table_view_read(view, RT_DESC_N, NULL) == -1);
+    TASSERT(routing_table_view_node_id(view, RT_DESC_N) == NULL);
+    routing_table_unpin(view);
+
+    /* Lookups expand the winners too */
+    sad_t query;
+    sad_init(&query);
+    sad_add_uint32(&query, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN << 3);
+    resolve_result_t res[4];
+    int n = routing_table_lookup(rt, &query, res, 4);
+    TASSERT(n == 4);
+    for (int i = 0; i < n; i++) {
+        TASSERT(sad_get_uint32(&res[i].entry.capabilities, SAD_FIELD_CAPABILITY) ==
+                (CAP_TEXT_GEN << 3));
+        TASSERT(res[i].entry.region_code == 103);
+    }
+
+    /* Moving every entry to new capabilities replaces the descriptors
+     * once the retired snapshots are reclaimed */
+    routing_table_txn_t *txn = routing_table_txn_begin(rt);
+    for (int i = 0; i < RT_DESC_N; i++) {
+        route_entry_t e = in[i];
+        sad_init(&e.capabilities);
+        sad_add_uint32(&e.capabilities, SAD_FIELD_CAPABILITY, (uint32_t)(i % 2) + 1);
+        TASSERT(routing_table_txn_insert(txn, &e) == 0);
+    }
+    TASSERT(routing_table_txn_commit(txn) == 0);
+    for (int i = 0; i < 4; i++)
+        routing_table_update_metrics(rt, in[0].node_id, 1, 0.0f);
+    routing_table_remove(rt, in[0].node_id);
+    routing_table_insert(rt, &in[0]);
+    routing_table_remove(rt, in[0].node_id);
+    routing_table_remove(rt, in[1].node_id);
+    TASSERT(routing_table_descriptor_count(rt) == 2);
+
+    /* Removing everything drops them all */
+    txn = routing_table_txn_begin(rt);
+    for (int i = 2; i < RT_DESC_N; i++)
+        TASSERT(routing_table_txn_remove(txn, in[i].node_id) == 0);
+    TASSERT(routing_table_txn_commit(txn) == 0);
+    for (int i = 0; i < 3; i++) {
+        TASSERT(routing_table_insert(rt, &in[0]) == 0);
+        TASSERT(routing_table_remove(rt, in[0].node_id) == 0);
+    }
+    TASSERT(routing_table_size(rt) == 0);
+    TASSERT(routing_table_descriptor_count(rt) == 0);
+
+    routing_table_destroy(rt);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: NUMA replicas serve identical rows, hits and metrics per node
+ * -------------------------------------------------------------------------- */
+
+#define RT_REPL_N      200
+#define RT_REPL_NODES  3
+
+static int test_routing_replicas(void)
+{
+    int errors = 0;
+
+    TASSERT(strand_numa_nodes() >= 1);
+
+    /* Node-local memory is page-aligned and zeroed, placed or not */
+    for (int node = 0; node <= strand_numa_nodes(); node++) {
+        uint8_t *m = strand_numa_alloc(10000, node);
+        TASSERT(m != NULL && ((uintptr_t)m & 4095) == 0);
+        if (!m) continue;
+        TASSERT(m[0] == 0 && m[9999] == 0);
+        m[9999] = 1;
+        strand_numa_free(m, 10000);
+    }
+    TASSERT(strand_numa_alloc(0, 0) == NULL);
+
+    routing_table_t *rt = routing_table_create(16);
+    for (int i = 0; i < RT_REPL_N; i++) {
+        route_entry_t e = make_entry((uint8_t)i, CAP_TEXT_GEN << (i % 5),
+                                     1024u << (i % 7), 1000 + (uint32_t)(i * 37 % 500),
+                                     (uint32_t)(i * 13 % 900), (uint8_t)(i % 4), 840);
+        e.node_id[1] = 0xA1;
+        TASSERT(routing_table_insert(rt, &e) == 0);
+    }
+    TASSERT(routing_table_set_replicas(rt, RT_REPL_NODES) == RT_REPL_NODES);
+
+    sad_t query;
+    sad_init(&query);
+    sad_add_uint32(&query, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN << 2);
+    sad_query_t q;
+    sad_query_compile(&query, &q);
+
+    /* Every node sees the same generation, rows and ranking */
+    const routing_table_view_t *views[RT_REPL_NODES];
+    sad_hit_t hits[RT_REPL_NODES][8];
+    int nhits[RT_REPL_NODES];
+    for (int n = 0; n < RT_REPL_NODES; n++) {
+        strand_numa_bind_thread(n);
+        views[n] = routing_table_pin(rt);
+        TASSERT(views[n] != NULL);
+        TASSERT(routing_table_view_count(views[n]) == RT_REPL_N);
+        nhits[n] = routing_table_view_lookup(views[n], &q, NULL, hits[n], 8);
+        strand_numa_bind_thread(-1);
+    }
+    TASSERT(views[1] != views[2]);
+    TASSERT(views[0] != views[1] || views[0] != views[2]);
+    int bad = 0;
+    for (int n = 1; n < RT_REPL_NODES; n++) {
+        if (routing_table_view_generation(views[n]) !=
+                routing_table_view_generation(views[0]) ||
+            nhits[n] != nhits[0] ||
+            memcmp(hits[n], hits[0], (size_t)nhits[0] * sizeof(sad_hit_t)) != 0)
+            bad++;
+        for (uint32_t r = 0; r < RT_REPL_N; r++) {
+            route_entry_t a, b;
+            routing_table_view_read(views[0], r, &a);
+            routing_table_view_read(views[n], r, &b);
+            if (memcmp(&a, &b, sizeof(a)) != 0)
+                bad++;
+        }
+    }
+    TASSERT(nhits[0] == 8);
+    TASSERT(bad == 0);
+    for (int n = 0; n < RT_REPL_NODES; n++)
+        routing_table_unpin(views[n]);
+
+    /* Metric stores reach every copy; structural changes republish all */
+    route_entry_t first;
+    routing_table_snapshot(rt, &first, 1);
+    TASSERT(routing_table_update_metrics(rt, first.node_id, 77, 0.5f) == 0);
+    route_entry_t extra = make_entry(0xFE, CAP_TEXT_GEN, 0, 10, 10, 1, 840);
+    TASSERT(routing_table_insert(rt, &extra) == 0);
+    TASSERT(routing_table_update_metrics(rt, extra.node_id, 88, 0.25f) == 0);
+    for (int n = 0; n < RT_REPL_NODES; n++) {
+        strand_numa_bind_thread(n);
+        const routing_table_view_t *v = routing_table_pin(rt);
+        TASSERT(routing_table_view_count(v) == RT_REPL_N + 1);
+        TASSERT(routing_table_view_metrics_version(v) == 1);
+        uint32_t lat = 0;
+        float load = 0.0f;
+        TASSERT(routing_table_view_metrics(v, 0, &lat, &load) == 0);
+        TASSERT(lat == 77 && load == 0.5f);
+        TASSERT(routing_table_view_metrics(v, RT_REPL_N, &lat, &load) == 0);
+        TASSERT(lat == 88 && load == 0.25f);
+        routing_table_unpin(v);
+        resolve_result_t res[1];
+        TASSERT(routing_table_lookup(rt, &query, res, 1) == 1);
+        strand_numa_bind_thread(-1);
+    }
+
+    /* Back to one copy: every node reads the same snapshot */
+    TASSERT(routing_table_set_replicas(rt, 0) == 1);
+    strand_numa_bind_thread(2);
+    const routing_table_view_t *v2 = routing_table_pin(rt);
+    strand_numa_bind_thread(-1);
+    const routing_table_view_t *v0 = routing_table_pin(rt);
+    TASSERT(v0 == v2);
+    routing_table_unpin(v0);
+    routing_table_unpin(v2);
+    TASSERT(routing_table_set_replicas(rt, -1) == strand_numa_nodes());
+    TASSERT(routing_table_size(rt) == RT_REPL_N + 1);
+
+    routing_table_destroy(rt);
+    return errors;
+}
+
 /* --------------------------------------------------------------------------
  * Registration
  * -------------------------------------------------------------------------- */
@@ -446,4 +1440,15 @@ void register_routing_tests(void)
     test_register("routing_concurrent_reads",  test_routing_concurrent);
     test_register("routing_gc_ttl_expiry",     test_routing_gc_ttl);
     test_register("routing_gc_null_safe",      test_routing_gc_null);
+    test_register("routing_expire_ttl",        test_routing_expire_ttl);
+    test_register("routing_columnar_matches_reference",
+                  test_routing_columnar_matches_reference);
+    test_register("routing_pinned_view",       test_routing_pinned_view);
+    test_register("routing_indexed_matches_scan", test_routing_indexed_matches_scan);
+    test_register("routing_metrics_in_place",  test_routing_metrics_in_place);
+    test_register("routing_metrics_concurrent", test_routing_metrics_concurrent);
+    test_register("routing_txn_batch",         test_routing_txn_batch);
+    test_register("routing_checkpoint",        test_routing_checkpoint);
+    test_register("routing_descriptors",       test_routing_descriptors);
+    test_register("routing_replicas",          test_routing_replicas);
 }
@@ -0,0 +1,473 @@
+/*
+ * test_routing_shards.c - Sharded routing table tests
+ */
+
+#include "strandroute/resolver.h"
+#include "strandroute/routing_shards.h"
+#include "strandroute/routing_table.h"
+#include "strandroute/sad.h"
+#include "strandroute/sad_match.h"
+#include "strandroute/types.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Helpers
+ * -------------------------------------------------------------------------- */
+
+static uint32_t rs_rand_state = 12345;
+
+static uint32_t rs_rand(void)
+{
+    rs_rand_state = rs_rand_state * 1103515245u + 12345u;
+    return rs_rand_state >> 8;
+}
+
+/* @arch 0 = no MODEL_ARCH field */
+static route_entry_t rs_entry(int id, uint32_t arch, uint16_t region,
+                              uint32_t latency_us)
+{
+    route_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.node_id[0]  = 0xC5;
+    e.node_id[14] = (uint8_t)(id >> 8);
+    e.node_id[15] = (uint8_t)id;
+    e.latency_us  = latency_us;
+    e.cost_milli  = 100;
+    e.trust_level = 2;
+    e.region_code = region;
+
+    sad_init(&e.capabilities);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CAPABILITY, 0x0F);
+    if (arch)
+        sad_add_uint32(&e.capabilities, SAD_FIELD_MODEL_ARCH, arch);
+    return e;
+}
+
+static route_entry_t rs_random_entry(int id)
+{
+    route_entry_t e = rs_entry(id, 0, (uint16_t)(rs_rand() % 1000),
+                               rs_rand() % 400000);
+    sad_init(&e.capabilities);
+    sad_add_uint32(&e.capabilities, SAD_FIELD_CAPABILITY, rs_rand() & 0xFF);
+    if (rs_rand() % 4)
+        sad_add_uint32(&e.capabilities, SAD_FIELD_MODEL_ARCH, 1 + rs_rand() % 3);
+    e.cost_milli  = rs_rand() % 8000;
+    e.load_factor = (float)(rs_rand() % 100) / 100.0f;
+    return e;
+}
+
+static void rs_random_query(sad_t *q)
+{
+    sad_init(q);
+    if (rs_rand() % 3 == 0)
+        sad_add_uint32(q, SAD_FIELD_MODEL_ARCH, 1 + rs_rand() % 3);
+    if (rs_rand() % 4)
+        sad_add_uint32(q, SAD_FIELD_CAPABILITY, rs_rand() & 0xFF);
+    if (rs_rand() % 2)
+        sad_add_uint32(q, SAD_FIELD_MAX_LATENCY_MS, rs_rand() % 500);
+    if (rs_rand() % 2)
+        sad_add_uint32(q, SAD_FIELD_MAX_COST_MILLI, rs_rand() % 9000);
+}
+
+/* Shard of @rs holding @node_id, or -1 */
+static int rs_home(routing_shards_t *rs, const uint8_t node_id[16])
+{
+    int home = -1;
+    for (uint32_t t = 0; t < routing_shards_count(rs); t++) {
+        const routing_table_view_t *v =
+            routing_table_pin(routing_shards_table(rs, t));
+        if (routing_table_view_find(v, node_id) >= 0)
+            home = home < 0 ? (int)t : -2;      /* -2: in two shards */
+        routing_table_unpin(v);
+    }
+    return home;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: MODEL_ARCH sharding sends constrained queries to one shard
+ * -------------------------------------------------------------------------- */
+
+static int test_routing_shards_model_arch(void)
+{
+    int errors = 0;
+
+    routing_shards_config_t cfg = {
+        .by = RT_SHARD_BY_MODEL_ARCH, .num_shards = 4,
+    };
+    routing_shards_t *rs = routing_shards_create(&cfg);
+    TASSERT(rs != NULL);
+    TASSERT(routing_shards_count(rs) == 4);
+    TASSERT(routing_shards_table(rs, 4) == NULL);
+
+    /* Archs 1..3 get shards 1..3; entries without one go to shard 0 */
+    for (int i = 0; i < 40; i++) {
+        route_entry_t e = rs_entry(i, (uint32_t)(i % 4), 840, 1000 + (uint32_t)i);
+        TASSERT(routing_shards_shard_of(rs, RT_SHARD_KEY_ANY, &e) == i % 4);
+        TASSERT(routing_shards_insert(rs, RT_SHARD_KEY_ANY, &e) == 0);
+    }
+    TASSERT(routing_shards_size(rs) == 40);
+    for (uint32_t t = 0; t < 4; t++)
+        TASSERT(routing_table_size(routing_shards_table(rs, t)) == 10);
+
+    sad_t q;
+    sad_query_t cq;
+    sad_init(&q);
+    sad_add_uint32(&q, SAD_FIELD_CAPABILITY, 0x03);
+    sad_query_compile(&q, &cq);
+    TASSERT(routing_shards_query_shard(rs, 2, &cq) == -1);
+
+    sad_add_uint32(&q, SAD_FIELD_MODEL_ARCH, MODEL_ARCH_MOE);
+    sad_query_compile(&q, &cq);
+    TASSERT(routing_shards_query_shard(rs, RT_SHARD_KEY_ANY, &cq) == 3);
+
+    resolve_result_t res[16];
+    int n = routing_shards_resolve(rs, RT_SHARD_KEY_ANY, &q, NULL, res, 16);
+    TASSERT(n == 10);
+    for (int i = 0; i < n; i++)
+        TASSERT(sad_get_uint32(&res[i].entry.capabilities,
+                               SAD_FIELD_MODEL_ARCH) == MODEL_ARCH_MOE);
+    for (int i = 1; i < n; i++)
+        TASSERT(res[i - 1].score >= res[i].score);
+
+    /* The resolver front-end applies a profile and the top-K cap */
+    resolve_result_t top[16];
+    TASSERT(resolver_resolve_shards(rs, RT_SHARD_KEY_ANY, &q,
+                                    RESOLVER_PROFILE_DEFAULT, top, 3) == 3);
+    for (int i = 0; i < 3; i++) {
+        TASSERT(node_id_equal(top[i].entry.node_id, res[i].entry.node_id));
+        TASSERT(top[i].score == res[i].score);
+    }
+    TASSERT(resolver_resolve_shards(rs, RT_SHARD_KEY_ANY, &q, 99, top, 3) == -1);
+
+    /* Bad configs */
+    routing_shards_config_t bad = { .by = RT_SHARD_BY_TENANT, .num_shards = 0 };
+    TASSERT(routing_shards_create(&bad) == NULL);
+    bad.num_shards = RT_SHARDS_MAX + 1;
+    TASSERT(routing_shards_create(&bad) == NULL);
+    TASSERT(routing_shards_create(NULL) == NULL);
+
+    routing_shards_destroy(rs);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: a fan-out query merges to the same top-K as one table holding
+ *       everything; a tenant query sees only its tenant
+ * -------------------------------------------------------------------------- */
+
+#define RS_FAN_ENTRIES  400
+#define RS_FAN_QUERIES  300
+#define RS_FAN_TENANTS  4
+
+static int test_routing_shards_fanout(void)
+{
+    int errors = 0;
+
+    routing_shards_config_t cfg = {
+        .by = RT_SHARD_BY_TENANT, .num_shards = RS_FAN_TENANTS,
+        .fanout_threads = RS_FAN_TENANTS - 1,
+    };
+    routing_shards_t *par = routing_shards_create(&cfg);
+    cfg.fanout_threads = 0;
+    routing_shards_t *seq = routing_shards_create(&cfg);
+    routing_table_t *all = routing_table_create(16);
+    TASSERT(par && seq && all);
+
+    static route_entry_t entries[RS_FAN_ENTRIES];
+    for (int i = 0; i < RS_FAN_ENTRIES; i++) {
+        entries[i] = rs_random_entry(i);
+        uint32_t tenant = (uint32_t)(i % RS_FAN_TENANTS);
+        TASSERT(routing_shards_insert(par, tenant, &entries[i]) == 0);
+        TASSERT(routing_shards_insert(seq, tenant, &entries[i]) == 0);
+        TASSERT(routing_table_insert(all, &entries[i]) == 0);
+    }
+    TASSERT(routing_shards_insert(par, RT_SHARD_KEY_ANY, &entries[0]) == -1);
+
+    /* Tenants past the last shard are refused, never folded onto one */
+    route_entry_t stray = rs_random_entry(RS_FAN_ENTRIES);
+    TASSERT(routing_shards_shard_of(par, RS_FAN_TENANTS, &stray) == -1);
+    TASSERT(routing_shards_insert(par, RS_FAN_TENANTS + 1, &stray) == -1);
+    routing_shards_txn_t *txn = routing_shards_txn_begin(par);
+    TASSERT(routing_shards_txn_insert(txn, RS_FAN_TENANTS, &stray) == -1);
+    routing_shards_txn_abort(txn);
+    TASSERT(routing_shards_size(par) == RS_FAN_ENTRIES);
+    {
+        sad_t any;
+        sad_init(&any);
+        resolve_result_t r[4];
+        TASSERT(routing_shards_resolve(par, RS_FAN_TENANTS + 1, &any, NULL,
+                                       r, 4) == -1);
+        TASSERT(resolver_resolve_shards(par, RS_FAN_TENANTS, &any,
+                                        RESOLVER_PROFILE_DEFAULT, r, 4) == -1);
+    }
+
+    const scoring_weights_t w = scoring_weights_default();
+    for (int qi = 0; qi < RS_FAN_QUERIES; qi++) {
+        sad_t q;
+        rs_random_query(&q);
+
+        resolve_result_t got[8], alt[8], want[8];
+        int k = 1 + qi % 8;
+        int n_got  = routing_shards_resolve(par, RT_SHARD_KEY_ANY, &q, &w, got, k);
+        int n_alt  = routing_shards_resolve(seq, RT_SHARD_KEY_ANY, &q, &w, alt, k);
+        int n_want = resolver_resolve_with_weights(all, &q, &w, want, k);
+        TASSERT(n_got == n_want && n_alt == n_got);
+
+        /* Same scores; ties may pick different nodes, but never nodes
+         * scoring differently */
+        for (int i = 0; i < n_got && i < n_want; i++) {
+            TASSERT(got[i].score == want[i].score);
+            TASSERT(node_id_equal(got[i].entry.node_id, alt[i].entry.node_id));
+            int id = got[i].entry.node_id[14] << 8 | got[i].entry.node_id[15];
+            TASSERT(id < RS_FAN_ENTRIES &&
+                    got[i].entry.latency_us == entries[id].latency_us);
+        }
+
+        /* Tenant queries see only their shard */
+        uint32_t tenant = (uint32_t)qi % RS_FAN_TENANTS;
+        int n = routing_shards_resolve(par, tenant, &q, &w, got, k);
+        TASSERT(n >= 0);
+        for (int i = 0; i < n; i++) {
+            int id = got[i].entry.node_id[14] << 8 | got[i].entry.node_id[15];
+            TASSERT(id % RS_FAN_TENANTS == (int)tenant);
+        }
+    }
+
+    /* More results than fit on the stack */
+    sad_t any;
+    sad_init(&any);
+    static resolve_result_t big[RS_FAN_ENTRIES];
+    TASSERT(routing_shards_resolve(par, RT_SHARD_KEY_ANY, &any, NULL, big,
+                                   RS_FAN_ENTRIES) == RS_FAN_ENTRIES);
+
+    routing_shards_destroy(par);
+    routing_shards_destroy(seq);
+    routing_table_destroy(all);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: a node lives in one shard; inserts, removals and transactions
+ *       move it
+ * -------------------------------------------------------------------------- */
+
+static int test_routing_shards_move(void)
+{
+    int errors = 0;
+
+    routing_shards_config_t cfg = {
+        .by = RT_SHARD_BY_REGION, .num_shards = 8,
+    };
+    routing_shards_t *rs = routing_shards_create(&cfg);
+    TASSERT(rs != NULL);
+
+    route_entry_t a = rs_entry(1, 1, 841, 500);
+    route_entry_t b = rs_entry(2, 1, 842, 600);
+    route_entry_t c = rs_entry(3, 1, 843, 700);
+    TASSERT(routing_shards_insert(rs, RT_SHARD_KEY_ANY, &a) == 0);
+    TASSERT(routing_shards_insert(rs, RT_SHARD_KEY_ANY, &b) == 0);
+    TASSERT(routing_shards_insert(rs, RT_SHARD_KEY_ANY, &c) == 0);
+    TASSERT(rs_home(rs, a.node_id) == 841 % 8);
+
+    /* Re-homed by its new region */
+    a.region_code = 845;
+    TASSERT(routing_shards_insert(rs, 7, &a) == 0);
+    TASSERT(rs_home(rs, a.node_id) == 845 % 8);
+    TASSERT(routing_shards_size(rs) == 3);
+
+    /* Region queries see only their shard */
+    sad_t q;
+    sad_init(&q);
+    resolve_result_t res[4];
+    TASSERT(routing_shards_resolve(rs, 845, &q, NULL, res, 4) == 1);
+    TASSERT(node_id_equal(res[0].entry.node_id, a.node_id));
+    TASSERT(routing_shards_resolve(rs, 841, &q, NULL, res, 4) == 0);
+
+    TASSERT(routing_shards_update_metrics(rs, a.node_id, 9000, 0.5f) == 0);
+    TASSERT(routing_shards_resolve(rs, 845, &q, NULL, res, 4) == 1);
+    TASSERT(res[0].entry.latency_us == 9000);
+
+    /* Transaction: last operation per node wins, moves leave one copy */
+    routing_shards_txn_t *txn = routing_shards_txn_begin(rs);
+    TASSERT(txn != NULL);
+    b.region_code = 846;
+    TASSERT(routing_shards_txn_insert(txn, 0, &b) == 0);
+    a.region_code = 840;
+    TASSERT(routing_shards_txn_insert(txn, 0, &a) == 0);
+    a.region_code = 844;
+    TASSERT(routing_shards_txn_insert(txn, 0, &a) == 0);
+    TASSERT(routing_shards_txn_remove(txn, c.node_id) == 0);
+    route_entry_t d = rs_entry(4, 2, 847, 800);
+    TASSERT(routing_shards_txn_insert(txn, 0, &d) == 0);
+    TASSERT(routing_shards_txn_remove(txn, d.node_id) == 0);
+    TASSERT(routing_shards_txn_staged(txn) == 6);
+
+    /* Nothing published before commit */
+    TASSERT(rs_home(rs, b.node_id) == 842 % 8);
+    TASSERT(routing_shards_txn_commit(txn) == 0);
+
+    TASSERT(rs_home(rs, a.node_id) == 844 % 8);
+    TASSERT(rs_home(rs, b.node_id) == 846 % 8);
+    TASSERT(rs_home(rs, c.node_id) == -1);
+    TASSERT(rs_home(rs, d.node_id) == -1);
+    TASSERT(routing_shards_size(rs) == 2);
+
+    txn = routing_shards_txn_begin(rs);
+    TASSERT(routing_shards_txn_insert(txn, 0, &c) == 0);
+    routing_shards_txn_abort(txn);
+    TASSERT(rs_home(rs, c.node_id) == -1);
+
+    TASSERT(routing_shards_remove(rs, a.node_id) == 0);
+    TASSERT(routing_shards_remove(rs, a.node_id) == -1);
+    TASSERT(routing_shards_update_metrics(rs, a.node_id, 1, 0.0f) == -1);
+    TASSERT(routing_shards_size(rs) == 1);
+
+    routing_shards_destroy(rs);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: GC and expiry sweep every shard
+ * -------------------------------------------------------------------------- */
+
+static int test_routing_shards_gc(void)
+{
+    int errors = 0;
+
+    routing_shards_config_t cfg = {
+        .by = RT_SHARD_BY_TENANT, .num_shards = 3,
+    };
+    routing_shards_t *rs = routing_shards_create(&cfg);
+    TASSERT(rs != NULL);
+
+    const uint64_t now = 1000000000ull;
+    for (int i = 0; i < 30; i++) {
+        route_entry_t e = rs_entry(i, 1, 840, 1000);
+        e.last_updated = now;
+        e.ttl_ns = (i % 3 == 0) ? 0 : (i % 3 == 1) ? 1000000ull : 5000000ull;
+        TASSERT(routing_shards_insert(rs, (uint32_t)(i % 2), &e) == 0);
+    }
+    TASSERT(routing_shards_size(rs) == 30);
+
+    TASSERT(routing_shards_expire(rs, now + 2000000ull) == 10);
+    TASSERT(routing_shards_size(rs) == 20);
+    TASSERT(routing_shards_gc(rs, now + 10000000ull) == 10);
+    TASSERT(routing_shards_size(rs) == 10);
+    TASSERT(routing_shards_gc(rs, now + 10000000ull) == 0);
+    TASSERT(routing_shards_gc(NULL, now) == -1);
+
+    routing_shards_destroy(rs);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: writers on different shards, sweeps and fan-out readers together
+ * -------------------------------------------------------------------------- */
+
+#define RS_CONC_WRITERS  4
+#define RS_CONC_ROUNDS   2000
+#define RS_CONC_NODES    64
+
+typedef struct {
+    routing_shards_t *rs;
+    uint32_t          tenant;
+    _Atomic int      *stop;
+    int               bad;
+} rs_conc_arg_t;
+
+static void *rs_conc_writer(void *p)
+{
+    rs_conc_arg_t *a = p;
+    for (int r = 0; r < RS_CONC_ROUNDS; r++) {
+        int id = (int)a->tenant * RS_CONC_NODES + r % RS_CONC_NODES;
+        route_entry_t e = rs_entry(id, 1, 840, 1000 + (uint32_t)r);
+        if (r % 16 == 15) {
+            routing_shards_txn_t *txn = routing_shards_txn_begin(a->rs);
+            routing_shards_txn_insert(txn, a->tenant, &e);
+            routing_shards_txn_commit(txn);
+        } else if (routing_shards_insert(a->rs, a->tenant, &e) != 0) {
+            a->bad++;
+        }
+    }
+    return NULL;
+}
+
+static void *rs_conc_reader(void *p)
+{
+    rs_conc_arg_t *a = p;
+    sad_t q;
+    sad_init(&q);
+    resolve_result_t res[8];
+    while (!atomic_load(a->stop)) {
+        int n = routing_shards_resolve(a->rs, RT_SHARD_KEY_ANY, &q, NULL, res, 8);
+        if (n < 0 || n > 8)
+            a->bad++;
+        routing_shards_gc(a->rs, 0);
+    }
+    return NULL;
+}
+
+static int test_routing_shards_concurrent(void)
+{
+    int errors = 0;
+
+    routing_shards_config_t cfg = {
+        .by = RT_SHARD_BY_TENANT, .num_shards = RS_CONC_WRITERS,
+        .fanout_threads = 2,
+    };
+    routing_shards_t *rs = routing_shards_create(&cfg);
+    TASSERT(rs != NULL);
+
+    _Atomic int stop = 0;
+    pthread_t w[RS_CONC_WRITERS], r[2];
+    rs_conc_arg_t wa[RS_CONC_WRITERS], ra[2];
+    for (int i = 0; i < 2; i++) {
+        ra[i] = (rs_conc_arg_t){ .rs = rs, .stop = &stop };
+        pthread_create(&r[i], NULL, rs_conc_reader, &ra[i]);
+    }
+    for (int i = 0; i < RS_CONC_WRITERS; i++) {
+        wa[i] = (rs_conc_arg_t){ .rs = rs, .tenant = (uint32_t)i, .stop = &stop };
+        pthread_create(&w[i], NULL, rs_conc_writer, &wa[i]);
+    }
+    for (int i = 0; i < RS_CONC_WRITERS; i++) {
+        pthread_join(w[i], NULL);
+        TASSERT(wa[i].bad == 0);
+    }
+    atomic_store(&stop, 1);
+    for (int i = 0; i < 2; i++) {
+        pthread_join(r[i], NULL);
+        TASSERT(ra[i].bad == 0);
+    }
+
+    for (uint32_t t = 0; t < RS_CONC_WRITERS; t++)
+        TASSERT(routing_table_size(routing_shards_table(rs, t)) == RS_CONC_NODES);
+
+    routing_shards_destroy(rs);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_routing_shards_tests(void)
+{
+    test_register("routing_shards_model_arch",  test_routing_shards_model_arch);
+    test_register("routing_shards_fanout",      test_routing_shards_fanout);
+    test_register("routing_shards_move",        test_routing_shards_move);
+    test_register("routing_shards_gc",          test_routing_shards_gc);
+    test_register("routing_shards_concurrent",  test_routing_shards_concurrent);
+}
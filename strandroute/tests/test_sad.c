@@ -232,6 +232,130 @@ static int test_sad_overflow(void)
     return errors;
 }
 
+/* --------------------------------------------------------------------------
+ * Test: one-pass decode, canonical hash, frame option, batch decode
+ * -------------------------------------------------------------------------- */
+
+static void sad_sample(sad_t *sad, int reversed)
+{
+    uint16_t regions[] = { 840, 276 };
+    sad_init(sad);
+    if (!reversed) {
+        sad_add_uint32(sad, SAD_FIELD_MODEL_ARCH, 0x4C4C4D41);
+        sad_add_uint32(sad, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN | CAP_CODE_GEN);
+        sad_add_regions(sad, SAD_FIELD_REGION_PREFER, regions, 2);
+        sad_add_uint8(sad, SAD_FIELD_TRUST_LEVEL, 2);
+    } else {
+        sad_add_uint8(sad, SAD_FIELD_TRUST_LEVEL, 2);
+        sad_add_regions(sad, SAD_FIELD_REGION_PREFER, regions, 2);
+        sad_add_uint32(sad, SAD_FIELD_CAPABILITY, CAP_TEXT_GEN | CAP_CODE_GEN);
+        sad_add_uint32(sad, SAD_FIELD_MODEL_ARCH, 0x4C4C4D41);
+    }
+}
+
+static int test_sad_stream(void)
+{
+    int errors = 0;
+
+    sad_t a, b, out;
+    sad_sample(&a, 0);
+    sad_sample(&b, 1);
+
+    /* Field order does not change the hash; any value byte does */
+    TASSERT(sad_hash(&a) == sad_hash(&b));
+    sad_t c = a;
+    c.fields[0].value[3] ^= 1;
+    TASSERT(sad_hash(&c) != sad_hash(&a));
+    c = a;
+    c.fields[2].value[0] ^= 1;      /* region order inside a value counts */
+    TASSERT(sad_hash(&c) != sad_hash(&a));
+    c = a;
+    sad_add_uint32(&c, SAD_FIELD_MODEL_ARCH, 0x4C4C4D41);   /* duplicate */
+    TASSERT(sad_hash(&c) != sad_hash(&a));
+
+    /* Encoder, decoder and view all agree on it */
+    uint8_t buf[SAD_MAX_SIZE];
+    int n = sad_encode(&a, buf, sizeof(buf));
+    TASSERT(n > 0);
+    uint64_t h = 0;
+    TASSERT(sad_decode_validated(buf, (size_t)n, &out, &h) == n);
+    TASSERT(h == sad_hash(&a));
+    TASSERT(out.num_fields == a.num_fields && out.total_length == n);
+    TASSERT(sad_get_uint32(&out, SAD_FIELD_CAPABILITY) == (CAP_TEXT_GEN | CAP_CODE_GEN));
+    sad_view_t view;
+    TASSERT(sad_view_init(&view, buf, (size_t)n) == n);
+    TASSERT(sad_view_hash(&view) == h);
+
+    /* Validating decode rejects what sad_validate rejects, sad_decode not */
+    uint8_t bad_flen[] = { 1, 0, 0, 1,   0x01, 0, 2,   0xAA, 0xBB };
+    TASSERT(sad_decode(bad_flen, sizeof(bad_flen), &out) == 9);
+    TASSERT(sad_decode_validated(bad_flen, sizeof(bad_flen), &out, NULL) == -1);
+    TASSERT(sad_validate(buf, (size_t)n) == 0);
+    TASSERT(sad_encode(&a, buf, (size_t)n - 1) == -1);
+
+    /* Written into a frame's options after another option */
+    uint8_t opts[64];
+    memset(opts, 0, sizeof(opts));
+    opts[0] = 0x05;                 /* trace id, 4 bytes */
+    opts[1] = 4;
+    uint64_t oh = 0;
+    int on = sad_encode_option(&b, opts + 6, sizeof(opts) - 6, &oh);
+    TASSERT(on == n + 2);
+    TASSERT(opts[6] == STRANDLINK_OPT_SEMANTIC_ADDR && opts[7] == n);
+    TASSERT(oh == h);
+    uint16_t sl = 0;
+    const uint8_t *sp = sad_option_find(opts, (size_t)(6 + on), &sl);
+    TASSERT(sp == opts + 8 && sl == n);
+    TASSERT(sad_option_find(opts, 7, &sl) == NULL);     /* truncated */
+    TASSERT(sad_encode_option(&b, opts, (size_t)n + 1, NULL) == -1);
+
+    /* Too big for a one-byte option length */
+    sad_t big;
+    uint8_t blob[SAD_MAX_FIELD_VALUE];
+    memset(blob, 0x5A, sizeof(blob));
+    sad_init(&big);
+    for (int i = 0; i < 5; i++)
+        sad_add_field(&big, SAD_FIELD_CUSTOM, blob, sizeof(blob));
+    uint8_t wide[SAD_MAX_SIZE];
+    TASSERT(sad_encode_option(&big, wide, sizeof(wide), NULL) == -1);
+
+    return errors;
+}
+
+static int test_sad_decode_batch(void)
+{
+    int errors = 0;
+
+    uint8_t bufs[3][SAD_MAX_SIZE];
+    sad_t in[3], out[3];
+    sad_sample(&in[0], 0);
+    sad_sample(&in[1], 1);
+    sad_init(&in[2]);
+    sad_add_uint32(&in[2], SAD_FIELD_CONTEXT_WINDOW, 32768);
+
+    sad_span_t spans[4];
+    for (int i = 0; i < 3; i++) {
+        spans[i].buf = bufs[i];
+        spans[i].len = (uint16_t)sad_encode(&in[i], bufs[i], SAD_MAX_SIZE);
+    }
+    spans[2].len++;                 /* trailing byte: not exactly one SAD */
+
+    sad_t *outs[3] = { &out[0], &out[1], &out[2] };
+    uint64_t hashes[3];
+    TASSERT(sad_decode_batch(spans, 3, outs, hashes) == 2);
+    TASSERT(hashes[0] == sad_hash(&in[0]) && hashes[0] == hashes[1]);
+    TASSERT(out[1].num_fields == 4 &&
+            sad_get_uint8(&out[1], SAD_FIELD_TRUST_LEVEL) == 2);
+    TASSERT(out[2].total_length == 0 && hashes[2] == 0);
+
+    spans[2].len--;
+    TASSERT(sad_decode_batch(spans, 3, outs, NULL) == 3);
+    TASSERT(sad_get_uint32(&out[2], SAD_FIELD_CONTEXT_WINDOW) == 32768);
+    TASSERT(sad_decode_batch(NULL, 1, outs, NULL) == -1);
+
+    return errors;
+}
+
 /* --------------------------------------------------------------------------
  * Test: SAD match score - perfect match
  * -------------------------------------------------------------------------- */
@@ -452,6 +576,8 @@ void register_sad_tests(void)
     test_register("sad_empty_roundtrip",           test_sad_empty_roundtrip);
     test_register("sad_validate_bad_data",         test_sad_validate_bad);
     test_register("sad_overflow_protection",       test_sad_overflow);
+    test_register("sad_stream",                    test_sad_stream);
+    test_register("sad_decode_batch",              test_sad_decode_batch);
     test_register("match_score_perfect",           test_match_score_perfect);
     test_register("match_score_hard_fail_ctx",     test_match_score_hard_fail);
     test_register("match_score_trust_fail",        test_match_score_trust_fail);
@@ -0,0 +1,487 @@
+/*
+ * test_sad_match.c - Compiled query + batch scoring kernel tests
+ */
+
+#include "strandroute/sad.h"
+#include "strandroute/sad_match.h"
+#include "strandroute/types.h"
+
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Helpers: deterministic PRNG and a column table built from route entries
+ * -------------------------------------------------------------------------- */
+
+static uint32_t match_rand_state = 0x9E3779B9u;
+
+static uint32_t match_rand(void)
+{
+    match_rand_state ^= match_rand_state << 13;
+    match_rand_state ^= match_rand_state >> 17;
+    match_rand_state ^= match_rand_state << 5;
+    return match_rand_state;
+}
+
+/* Mostly small values, occasionally the full uint32 range */
+static uint32_t rand_metric(uint32_t small_max)
+{
+    return (match_rand() % 8 == 0) ? match_rand() : match_rand() % small_max;
+}
+
+#define MATCH_ROWS 1000
+
+typedef struct {
+    route_entry_t entries[MATCH_ROWS];
+    uint32_t model_arch[MATCH_ROWS];
+    uint32_t capability[MATCH_ROWS];
+    uint32_t context_window[MATCH_ROWS];
+    _Atomic uint32_t latency_us[MATCH_ROWS];
+    uint32_t cost_milli[MATCH_ROWS];
+    uint8_t  trust_level[MATCH_ROWS];
+    uint16_t region_code[MATCH_ROWS];
+    uint8_t  has[MATCH_ROWS];
+    sad_columns_t cols;
+} match_table_t;
+
+static const uint16_t match_regions[] = { 840, 276, 250, 392, 156 };
+#define NUM_MATCH_REGIONS (sizeof(match_regions) / sizeof(match_regions[0]))
+
+static void build_table(match_table_t *t)
+{
+    for (uint32_t i = 0; i < MATCH_ROWS; i++) {
+        route_entry_t *e = &t->entries[i];
+        memset(e, 0, sizeof(*e));
+        e->node_id[0]  = (uint8_t)(i >> 8);
+        e->node_id[1]  = (uint8_t)i;
+        e->latency_us  = rand_metric(500000);
+        e->cost_milli  = rand_metric(10000);
+        e->trust_level = (uint8_t)(match_rand() % 6);
+        e->region_code = match_regions[match_rand() % NUM_MATCH_REGIONS];
+
+        sad_init(&e->capabilities);
+        if (match_rand() % 4)
+            sad_add_uint32(&e->capabilities, SAD_FIELD_MODEL_ARCH, 1 + match_rand() % 3);
+        if (match_rand() % 5)
+            sad_add_uint32(&e->capabilities, SAD_FIELD_CAPABILITY, match_rand());
+        if (match_rand() % 3)
+            sad_add_uint32(&e->capabilities, SAD_FIELD_CONTEXT_WINDOW,
+                           rand_metric(300000));
+
+        const sad_t *c = &e->capabilities;
+        t->has[i] = (uint8_t)(
+            (sad_find_field(c, SAD_FIELD_MODEL_ARCH)     ? SAD_COL_HAS_MODEL_ARCH : 0) |
+            (sad_find_field(c, SAD_FIELD_CAPABILITY)     ? SAD_COL_HAS_CAPABILITY : 0) |
+            (sad_find_field(c, SAD_FIELD_CONTEXT_WINDOW) ? SAD_COL_HAS_CONTEXT_WINDOW : 0));
+        t->model_arch[i]     = sad_get_uint32(c, SAD_FIELD_MODEL_ARCH);
+        t->capability[i]     = sad_get_uint32(c, SAD_FIELD_CAPABILITY);
+        t->context_window[i] = sad_get_uint32(c, SAD_FIELD_CONTEXT_WINDOW);
+        t->latency_us[i]     = e->latency_us;
+        t->cost_milli[i]     = e->cost_milli;
+        t->trust_level[i]    = e->trust_level;
+        t->region_code[i]    = e->region_code;
+    }
+
+    t->cols.model_arch     = t->model_arch;
+    t->cols.capability     = t->capability;
+    t->cols.context_window = t->context_window;
+    t->cols.latency_us     = t->latency_us;
+    t->cols.cost_milli     = t->cost_milli;
+    t->cols.trust_level    = t->trust_level;
+    t->cols.region_code    = t->region_code;
+    t->cols.has            = t->has;
+    t->cols.count          = MATCH_ROWS;
+}
+
+static void build_query(sad_t *q)
+{
+    sad_init(q);
+    if (match_rand() % 2)
+        sad_add_uint32(q, SAD_FIELD_MODEL_ARCH, 1 + match_rand() % 3);
+    if (match_rand() % 3)
+        sad_add_uint32(q, SAD_FIELD_CAPABILITY, match_rand() & 0xFFFF);
+    if (match_rand() % 3 == 0)
+        sad_add_uint32(q, SAD_FIELD_CONTEXT_WINDOW, rand_metric(200000));
+    if (match_rand() % 2)
+        sad_add_uint32(q, SAD_FIELD_MAX_LATENCY_MS, rand_metric(600));
+    if (match_rand() % 2)
+        sad_add_uint32(q, SAD_FIELD_MAX_COST_MILLI, rand_metric(12000));
+    if (match_rand() % 3 == 0)
+        sad_add_uint8(q, SAD_FIELD_TRUST_LEVEL, (uint8_t)(match_rand() % 6));
+    if (match_rand() % 3 == 0) {
+        uint16_t r[3];
+        uint16_t n = (uint16_t)(1 + match_rand() % 3);
+        for (uint16_t k = 0; k < n; k++)
+            r[k] = match_regions[match_rand() % NUM_MATCH_REGIONS];
+        sad_add_regions(q, SAD_FIELD_REGION_PREFER, r, n);
+    }
+    if (match_rand() % 4 == 0) {
+        uint16_t r = match_regions[match_rand() % NUM_MATCH_REGIONS];
+        sad_add_regions(q, SAD_FIELD_REGION_EXCLUDE, &r, 1);
+    }
+}
+
+static match_table_t g_match_table;
+
+/* --------------------------------------------------------------------------
+ * Test: compiled query scoring equals sad_match_score
+ * -------------------------------------------------------------------------- */
+
+static int test_query_compile_matches_score(void)
+{
+    int errors = 0;
+    match_table_t *t = &g_match_table;
+    build_table(t);
+
+    for (int qi = 0; qi < 50; qi++) {
+        sad_t query;
+        build_query(&query);
+
+        sad_query_t q;
+        sad_query_compile(&query, &q);
+
+        int mismatches = 0;
+        for (uint32_t i = 0; i < MATCH_ROWS; i++) {
+            float a = sad_match_score(&query, &t->entries[i], NULL);
+            float b = sad_query_score(&q, &t->cols, i, NULL);
+            if (memcmp(&a, &b, sizeof(float)) != 0)
+                mismatches++;
+        }
+        TASSERT(mismatches == 0);
+    }
+
+    /* Zero-field query is a wildcard */
+    sad_t empty;
+    sad_init(&empty);
+    sad_query_t q;
+    sad_query_compile(&empty, &q);
+    TASSERT(q.wildcard);
+    TASSERT(sad_query_score(&q, &t->cols, 0, NULL) == 1.0f);
+
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: every available vector kernel is bit-exact with the scalar kernel
+ * -------------------------------------------------------------------------- */
+
+static int test_kernels_bit_exact(void)
+{
+    int errors = 0;
+    match_table_t *t = &g_match_table;
+    build_table(t);
+
+    static const sad_kernel_t kernels[] = {
+        SAD_KERNEL_AVX2, SAD_KERNEL_AVX512, SAD_KERNEL_NEON,
+    };
+
+    const scoring_weights_t odd_weights = {
+        .capability = 0.7f, .latency = 0.11f, .cost = 1.3f,
+        .context_window = 0.01f, .trust = 0.33f,
+    };
+
+    static float want[MATCH_ROWS], got[MATCH_ROWS];
+
+    for (int qi = 0; qi < 200; qi++) {
+        sad_t query;
+        build_query(&query);
+
+        sad_query_t q;
+        sad_query_compile(&query, &q);
+
+        const scoring_weights_t *w = (qi % 3 == 0) ? &odd_weights : NULL;
+
+        /* Odd start offsets and lengths exercise the scalar tail */
+        uint32_t start = match_rand() % 40;
+        uint32_t n     = MATCH_ROWS - start - match_rand() % 40;
+
+        TASSERT(sad_score_batch_kernel(SAD_KERNEL_SCALAR, &q, &t->cols,
+                                       start, n, w, want) == 0);
+
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+            if (!sad_kernel_available(kernels[k])) {
+                TASSERT(sad_score_batch_kernel(kernels[k], &q, &t->cols,
+                                               start, n, w, got) == -1);
+                continue;
+            }
+            memset(got, 0, sizeof(got));
+            TASSERT(sad_score_batch_kernel(kernels[k], &q, &t->cols,
+                                           start, n, w, got) == 0);
+            TASSERT(memcmp(want, got, n * sizeof(float)) == 0);
+        }
+    }
+
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: kernel selection
+ * -------------------------------------------------------------------------- */
+
+static int test_kernel_select(void)
+{
+    int errors = 0;
+
+    sad_kernel_t best = sad_kernel_active();
+    TASSERT(best != SAD_KERNEL_AUTO);
+    TASSERT(sad_kernel_available(best));
+
+    TASSERT(sad_kernel_set(SAD_KERNEL_SCALAR) == 0);
+    TASSERT(sad_kernel_active() == SAD_KERNEL_SCALAR);
+
+    TASSERT(sad_kernel_set(SAD_KERNEL_AUTO) == 0);
+    TASSERT(sad_kernel_active() == best);
+
+    TASSERT(strcmp(sad_kernel_name(SAD_KERNEL_SCALAR), "scalar") == 0);
+
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: columnar top-K agrees with the AoS reference on every kernel
+ * -------------------------------------------------------------------------- */
+
+static int test_find_best_columns_kernels(void)
+{
+    int errors = 0;
+    match_table_t *t = &g_match_table;
+    build_table(t);
+
+    static const sad_kernel_t kernels[] = {
+        SAD_KERNEL_SCALAR, SAD_KERNEL_AVX2, SAD_KERNEL_AVX512, SAD_KERNEL_NEON,
+    };
+
+    for (int qi = 0; qi < 40; qi++) {
+        sad_t query;
+        build_query(&query);
+
+        sad_query_t q;
+        sad_query_compile(&query, &q);
+
+        resolve_result_t want[5];
+        int n_want = sad_find_best(&query, t->entries, MATCH_ROWS, NULL, 5, want);
+
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+            if (sad_kernel_set(kernels[k]) != 0)
+                continue;
+
+            resolve_result_t got[5];
+            int n_got = sad_find_best_columns(&q, &t->cols, NULL, t->entries,
+                                              NULL, 5, got);
+            TASSERT(n_got == n_want);
+            for (int i = 0; i < n_got && i < n_want; i++) {
+                TASSERT(node_id_equal(got[i].entry.node_id, want[i].entry.node_id));
+                TASSERT(got[i].score == want[i].score);
+            }
+        }
+    }
+
+    sad_kernel_set(SAD_KERNEL_AUTO);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: heap top-K matches a stable reference sort, including ties and
+ *       K larger than the on-stack scratch
+ * -------------------------------------------------------------------------- */
+
+static int test_find_best_hits_order(void)
+{
+    int errors = 0;
+    match_table_t *t = &g_match_table;
+    build_table(t);
+
+    /* Coarse latencies produce lots of exactly equal scores */
+    for (uint32_t i = 0; i < MATCH_ROWS; i++)
+        t->latency_us[i] = t->entries[i].latency_us = (match_rand() % 4) * 25000;
+
+    static const int ks[] = { 1, 3, 64, 65, 300, MATCH_ROWS + 5 };
+    static float scores[MATCH_ROWS];
+    static sad_hit_t want[MATCH_ROWS], got[MATCH_ROWS + 5];
+    static resolve_result_t full[MATCH_ROWS + 5];
+
+    for (int qi = 0; qi < 20; qi++) {
+        sad_t query;
+        build_query(&query);
+
+        sad_query_t q;
+        sad_query_compile(&query, &q);
+
+        /* Reference: stable insertion sort, score descending */
+        sad_score_batch(&q, &t->cols, 0, MATCH_ROWS, NULL, scores);
+        int n_ok = 0;
+        for (uint32_t i = 0; i < MATCH_ROWS; i++) {
+            if (scores[i] < 0.0f) continue;
+            int pos = n_ok++;
+            while (pos > 0 && want[pos - 1].score < scores[i]) {
+                want[pos] = want[pos - 1];
+                pos--;
+            }
+            want[pos].index = i;
+            want[pos].score = scores[i];
+        }
+
+        for (size_t ki = 0; ki < sizeof(ks) / sizeof(ks[0]); ki++) {
+            int k = ks[ki];
+            int n_want = n_ok < k ? n_ok : k;
+
+            int n_got = sad_find_best_hits(&q, &t->cols, NULL, k, got);
+            TASSERT(n_got == n_want);
+            int bad = 0;
+            for (int i = 0; i < n_got && i < n_want; i++) {
+                if (got[i].index != want[i].index || got[i].score != want[i].score)
+                    bad++;
+            }
+            TASSERT(bad == 0);
+
+            n_got = sad_find_best(&query, t->entries, MATCH_ROWS, NULL, k, full);
+            TASSERT(n_got == n_want);
+            bad = 0;
+            for (int i = 0; i < n_got && i < n_want; i++) {
+                if (!node_id_equal(full[i].entry.node_id,
+                                   t->entries[want[i].index].node_id) ||
+                    full[i].score != want[i].score)
+                    bad++;
+            }
+            TASSERT(bad == 0);
+        }
+    }
+
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: zero-copy view accepts exactly what sad_decode accepts and
+ *       compiles to the same query
+ * -------------------------------------------------------------------------- */
+
+/* Arbitrary fields: duplicate types, short lengths, unknown types */
+static void build_raw_query(sad_t *q)
+{
+    sad_init(q);
+    uint16_t n = (uint16_t)(match_rand() % (SAD_MAX_FIELDS + 1));
+    for (uint16_t i = 0; i < n; i++) {
+        uint8_t value[SAD_MAX_FIELD_VALUE];
+        uint16_t len = (match_rand() % 4 == 0)
+                     ? (uint16_t)(match_rand() % (SAD_MAX_FIELD_VALUE + 1))
+                     : (uint16_t)(match_rand() % 6);
+        for (uint16_t b = 0; b < len; b++)
+            value[b] = (uint8_t)match_rand();
+        sad_add_field(q, (sad_field_type_t)(match_rand() % 13), value, len);
+    }
+}
+
+static int check_view_against_decode(const uint8_t *buf, size_t len)
+{
+    int errors = 0;
+    sad_t decoded;
+    sad_view_t view;
+
+    int rc_d = sad_decode(buf, len, &decoded);
+    int rc_v = sad_view_init(&view, buf, len);
+    TASSERT(rc_d == rc_v);
+    if (rc_d < 0 || rc_v < 0)
+        return errors;
+
+    TASSERT(view.num_fields == decoded.num_fields);
+    for (uint16_t i = 0; i < decoded.num_fields; i++) {
+        sad_field_type_t type;
+        uint16_t flen;
+        const uint8_t *v = sad_view_field(&view, i, &type, &flen);
+        TASSERT(v != NULL);
+        TASSERT(type == decoded.fields[i].type);
+        TASSERT(flen == decoded.fields[i].length);
+        TASSERT(v >= buf && v + flen <= buf + len);
+        TASSERT(memcmp(v, decoded.fields[i].value, flen) == 0);
+    }
+    TASSERT(sad_view_field(&view, view.num_fields, NULL, NULL) == NULL);
+
+    for (int t = 0; t <= SAD_FIELD_CUSTOM; t++) {
+        TASSERT(sad_view_get_uint32(&view, (sad_field_type_t)t) ==
+                sad_get_uint32(&decoded, (sad_field_type_t)t));
+        TASSERT(sad_view_get_uint8(&view, (sad_field_type_t)t) ==
+                sad_get_uint8(&decoded, (sad_field_type_t)t));
+    }
+
+    sad_query_t from_sad, from_view;
+    sad_query_compile(&decoded, &from_sad);
+    sad_query_compile_view(&view, &from_view);
+    TASSERT(memcmp(&from_sad, &from_view, sizeof(sad_query_t)) == 0);
+    return errors;
+}
+
+static int test_view_matches_decode(void)
+{
+    int errors = 0;
+    match_rand_state = 0x5AD5EEDu;
+
+    for (int iter = 0; iter < 2000; iter++) {
+        sad_t q;
+        if (iter % 2)
+            build_query(&q);
+        else
+            build_raw_query(&q);
+
+        uint8_t buf[SAD_MAX_SIZE + 16];
+        int n = sad_encode(&q, buf, sizeof(buf));
+        if (n < 0)
+            continue;
+
+        errors += check_view_against_decode(buf, (size_t)n);
+
+        /* Trailing bytes past the SAD are left alone */
+        memset(buf + n, 0xA5, 16);
+        errors += check_view_against_decode(buf, (size_t)n + 16);
+
+        /* Truncation */
+        errors += check_view_against_decode(buf, match_rand() % (uint32_t)(n + 1));
+
+        /* Corruption: flip a few random bytes, header included */
+        for (int c = 0; c < 3; c++) {
+            uint8_t bad[SAD_MAX_SIZE + 16];
+            memcpy(bad, buf, (size_t)n);
+            int flips = 1 + (int)(match_rand() % 3);
+            for (int f = 0; f < flips; f++)
+                bad[match_rand() % (uint32_t)n] ^= (uint8_t)(1u << (match_rand() % 8));
+            errors += check_view_against_decode(bad, (size_t)n);
+        }
+    }
+
+    /* NULL and short inputs */
+    sad_view_t view;
+    uint8_t hdr[4] = { SAD_VERSION, 0, 0, 0 };
+    TASSERT(sad_view_init(NULL, hdr, sizeof(hdr)) == -1);
+    TASSERT(sad_view_init(&view, NULL, sizeof(hdr)) == -1);
+    TASSERT(sad_view_init(&view, hdr, 3) == -1);
+    TASSERT(sad_view_init(&view, hdr, sizeof(hdr)) == 4);
+
+    sad_query_t q;
+    sad_query_compile_view(&view, &q);
+    TASSERT(q.wildcard);
+    TASSERT(q.present == 0);
+
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_sad_match_tests(void)
+{
+    test_register("query_compile_matches_score",   test_query_compile_matches_score);
+    test_register("score_kernels_bit_exact",       test_kernels_bit_exact);
+    test_register("score_kernel_select",           test_kernel_select);
+    test_register("find_best_columns_all_kernels", test_find_best_columns_kernels);
+    test_register("find_best_hits_order",          test_find_best_hits_order);
+    test_register("sad_view_matches_decode",       test_view_matches_decode);
+}
@@ -0,0 +1,195 @@
+/*
+ * test_timer_wheel.c - Hierarchical timing wheel tests
+ */
+
+#include "strandroute/timer_wheel.h"
+
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Helpers
+ * -------------------------------------------------------------------------- */
+
+#define TW_TEST_N     3000
+#define TW_TEST_TICK  10
+
+static uint64_t tw_rng = 0x9E3779B97F4A7C15ull;
+
+static uint64_t tw_rand(void)
+{
+    tw_rng ^= tw_rng << 13;
+    tw_rng ^= tw_rng >> 7;
+    tw_rng ^= tw_rng << 17;
+    return tw_rng;
+}
+
+typedef struct {
+    timer_wheel_t *tw;
+    uint32_t id[TW_TEST_N];
+    uint64_t due[TW_TEST_N];        /* UINT64_MAX = not armed */
+    int      fired[TW_TEST_N];
+    uint64_t now;
+    uint64_t last_tick;
+    int      early;
+    int      late;
+    int      misordered;
+} tw_model_t;
+
+static tw_model_t g_model;
+
+static void tw_check(void *ctx, uint32_t id, uint64_t data)
+{
+    tw_model_t *m = ctx;
+    uint32_t i = (uint32_t)data;
+    (void)id;
+
+    uint64_t tick = m->due[i] / TW_TEST_TICK;
+    if (tick > m->now / TW_TEST_TICK) m->early++;
+    if (tick < m->last_tick)          m->misordered++;
+    m->last_tick = tick;
+    m->fired[i]++;
+    m->due[i] = UINT64_MAX;
+
+    /* Every fifth timer re-arms itself from its callback */
+    if (i % 5 == 0 && m->fired[i] < 3) {
+        m->due[i] = m->now + 1 + tw_rand() % 100000;
+        timer_wheel_mod(m->tw, m->id[i], m->due[i]);
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Test: timers fire once, on time, in order, across every level
+ * -------------------------------------------------------------------------- */
+
+static int test_timer_wheel_random(void)
+{
+    int errors = 0;
+    tw_model_t *m = &g_model;
+    memset(m, 0, sizeof(*m));
+
+    TASSERT(timer_wheel_create(0, 0) == NULL);
+    uint64_t start = 123456789;
+    m->tw  = timer_wheel_create(TW_TEST_TICK, start);
+    m->now = start;
+    TASSERT(m->tw != NULL);
+
+    for (int i = 0; i < TW_TEST_N; i++) {
+        /* Spread over level 0 up to past the wheel's span */
+        uint64_t range = 1ull << (4 + (i % 8) * 4);
+        m->due[i] = start + tw_rand() % range;
+        m->id[i]  = timer_wheel_add(m->tw, m->due[i], (uint64_t)i);
+        TASSERT(m->id[i] != TIMER_WHEEL_NONE);
+    }
+    TASSERT(timer_wheel_pending(m->tw) == TW_TEST_N);
+    TASSERT(timer_wheel_expires(m->tw, m->id[1]) == m->due[1]);
+
+    /* Move some, cancel some */
+    for (int i = 1; i < TW_TEST_N; i += 11) {
+        m->due[i] = start + tw_rand() % 50000;
+        TASSERT(timer_wheel_mod(m->tw, m->id[i], m->due[i]) == 0);
+    }
+    for (int i = 3; i < TW_TEST_N; i += 17) {
+        timer_wheel_del(m->tw, m->id[i]);
+        m->due[i] = UINT64_MAX;
+    }
+    TASSERT(timer_wheel_mod(m->tw, TIMER_WHEEL_NONE, 0) == -1);
+
+    /* Advance in uneven steps, ending far past the span */
+    uint64_t end = start + (1ull << 36);
+    while (m->now < end) {
+        uint64_t step = (tw_rand() % 4 == 0) ? tw_rand() % (1ull << 30)
+                                             : tw_rand() % 5000;
+        m->now += step;
+        m->last_tick = 0;
+        timer_wheel_advance(m->tw, m->now, tw_check, m);
+
+        for (int i = 0; i < TW_TEST_N; i++) {
+            if (m->due[i] != UINT64_MAX &&
+                m->due[i] / TW_TEST_TICK <= m->now / TW_TEST_TICK)
+                m->late++;
+        }
+        if (m->late) break;
+    }
+
+    TASSERT(m->early == 0);
+    TASSERT(m->late == 0);
+    TASSERT(m->misordered == 0);
+    TASSERT(timer_wheel_pending(m->tw) == 0);
+    for (int i = 0; i < TW_TEST_N; i++) {
+        int want = (i >= 3 && (i - 3) % 17 == 0) ? 0 : (i % 5 == 0 ? 3 : 1);
+        if (m->fired[i] != want) {
+            TASSERT(m->fired[i] == want);
+            break;
+        }
+    }
+
+    timer_wheel_destroy(m->tw);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: ids are released after firing and can be deleted from callbacks
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    timer_wheel_t *tw;
+    uint32_t victim;
+    int      calls;
+} tw_del_ctx_t;
+
+static void tw_delete_other(void *ctx, uint32_t id, uint64_t data)
+{
+    tw_del_ctx_t *c = ctx;
+    (void)id;
+    c->calls++;
+    if (data == 1)
+        timer_wheel_del(c->tw, c->victim);
+}
+
+static int test_timer_wheel_release(void)
+{
+    int errors = 0;
+
+    tw_del_ctx_t c;
+    memset(&c, 0, sizeof(c));
+    c.tw = timer_wheel_create(1, 1000);
+    TASSERT(c.tw != NULL);
+
+    /* Already due: fires on the next advance, even at the same time */
+    uint32_t a = timer_wheel_add(c.tw, 10, 1);
+    c.victim   = timer_wheel_add(c.tw, 1000, 2);
+    TASSERT(timer_wheel_advance(c.tw, 1000, tw_delete_other, &c) == 1);
+    TASSERT(c.calls == 1);
+    TASSERT(timer_wheel_pending(c.tw) == 0);
+    TASSERT(timer_wheel_expires(c.tw, a) == UINT64_MAX);
+    TASSERT(timer_wheel_mod(c.tw, a, 2000) == -1);      /* released */
+
+    /* Released ids are reused */
+    uint32_t b = timer_wheel_add(c.tw, 1500, 3);
+    TASSERT(b == a || b == c.victim);
+    TASSERT(timer_wheel_advance(c.tw, 1499, tw_delete_other, &c) == 0);
+    TASSERT(timer_wheel_advance(c.tw, 1500, tw_delete_other, &c) == 1);
+
+    timer_wheel_destroy(c.tw);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_timer_wheel_tests(void)
+{
+    test_register("timer_wheel_random",   test_timer_wheel_random);
+    test_register("timer_wheel_release",  test_timer_wheel_release);
+}
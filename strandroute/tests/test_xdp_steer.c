@@ -0,0 +1,322 @@
+/*
+ * test_xdp_steer.c - XDP map mirror tests
+ */
+
+#include "strandroute/xdp_steer.h"
+#include "strandroute/types.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * Test framework hooks (defined in test_main.c)
+ * -------------------------------------------------------------------------- */
+
+extern void test_register(const char *name, int (*fn)(void));
+extern int  test_assert_impl(int cond, const char *expr,
+                              const char *file, int line);
+
+#define TASSERT(cond) do { errors += test_assert_impl((cond), #cond, __FILE__, __LINE__); } while(0)
+
+/* --------------------------------------------------------------------------
+ * Fake BPF maps: a small array per map, keyed by the raw key bytes
+ * -------------------------------------------------------------------------- */
+
+#define XS_SLOTS 32
+
+typedef struct {
+    int     used;
+    uint8_t key[16];
+    uint8_t val[40];
+} xs_slot_t;
+
+typedef struct {
+    xs_slot_t maps[2][XS_SLOTS];
+    int       fail_updates;
+} xs_fake_t;
+
+static size_t xs_key_size(xdp_steer_map_t map)
+{
+    return map == XDP_STEER_MAP_NODE ? STRANDLINK_NODE_ID_LEN
+                                     : sizeof(xdp_steer_sad_key_t);
+}
+
+static size_t xs_val_size(xdp_steer_map_t map)
+{
+    return map == XDP_STEER_MAP_NODE ? sizeof(xdp_steer_node_val_t)
+                                     : sizeof(xdp_steer_sad_val_t);
+}
+
+static xs_slot_t *xs_find(xs_fake_t *f, xdp_steer_map_t map, const void *key)
+{
+    for (int i = 0; i < XS_SLOTS; i++) {
+        xs_slot_t *s = &f->maps[map][i];
+        if (s->used && memcmp(s->key, key, xs_key_size(map)) == 0)
+            return s;
+    }
+    return NULL;
+}
+
+static int xs_count(xs_fake_t *f, xdp_steer_map_t map)
+{
+    int n = 0;
+    for (int i = 0; i < XS_SLOTS; i++)
+        n += f->maps[map][i].used;
+    return n;
+}
+
+static int xs_update(xdp_steer_map_t map, const void *key, const void *value,
+                     void *ctx)
+{
+    xs_fake_t *f = ctx;
+    if (f->fail_updates)
+        return -1;
+    xs_slot_t *s = xs_find(f, map, key);
+    for (int i = 0; !s && i < XS_SLOTS; i++)
+        if (!f->maps[map][i].used)
+            s = &f->maps[map][i];
+    if (!s)
+        return -1;
+    s->used = 1;
+    memcpy(s->key, key, xs_key_size(map));
+    memcpy(s->val, value, xs_val_size(map));
+    return 0;
+}
+
+static int xs_delete(xdp_steer_map_t map, const void *key, void *ctx)
+{
+    xs_slot_t *s = xs_find(ctx, map, key);
+    if (s)
+        s->used = 0;
+    return 0;
+}
+
+/* Ports 1..7 reach next hops on ifindex 10 + port; port 0 has no underlay */
+static int xs_underlay(strandlink_port_t port, const uint8_t next_hop[16],
+                       xdp_steer_underlay_t *out, void *ctx)
+{
+    (void)ctx;
+    if (port == 0)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    out->ifindex = 10u + port;
+    out->saddr   = 0x0100000Au;
+    out->daddr   = 0x0200000Au | ((uint32_t)next_hop[15] << 24);
+    out->dmac[5] = next_hop[15];
+    return 0;
+}
+
+static void xs_node(uint8_t id[STRANDLINK_NODE_ID_LEN], int i)
+{
+    memset(id, 0, STRANDLINK_NODE_ID_LEN);
+    id[0] = 0xD0;
+    id[15] = (uint8_t)i;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: node entries follow the node table
+ * -------------------------------------------------------------------------- */
+
+static int test_xdp_steer_nodes(void)
+{
+    int errors = 0;
+
+    xs_fake_t *f = calloc(1, sizeof(*f));
+    node_table_t *nt = node_table_create(64);
+    xdp_steer_config_t cfg = {
+        .node_table = nt, .underlay_fn = xs_underlay,
+        .update_fn = xs_update, .delete_fn = xs_delete, .map_ctx = f,
+    };
+    TASSERT(xdp_steer_create(NULL) == NULL);
+    xdp_steer_config_t bad = cfg;
+    bad.update_fn = NULL;
+    TASSERT(xdp_steer_create(&bad) == NULL);
+
+    xdp_steer_t *s = xdp_steer_create(&cfg);
+    TASSERT(s != NULL);
+
+    uint8_t id[16], hop[16];
+    xs_node(id, 1);
+    xs_node(hop, 2);
+    TASSERT(xdp_steer_node_insert(s, id, 3, hop) == 0);
+    TASSERT(node_table_lookup(nt, id, NULL) == 0);
+
+    xs_slot_t *e = xs_find(f, XDP_STEER_MAP_NODE, id);
+    TASSERT(e != NULL);
+    if (e) {
+        xdp_steer_node_val_t v;
+        memcpy(&v, e->val, sizeof(v));
+        TASSERT(node_id_equal(v.next_hop, hop));
+        TASSERT(v.ifindex == 13);
+        TASSERT(v.dmac[5] == 2);
+    }
+
+    /* No next hop: the frame keeps its destination */
+    xs_node(id, 4);
+    TASSERT(xdp_steer_node_insert(s, id, 1, NULL) == 0);
+    e = xs_find(f, XDP_STEER_MAP_NODE, id);
+    TASSERT(e != NULL && memcmp(e->val, id, 16) == 0);
+
+    /* Moving a node to a port without underlay takes it out of the kernel */
+    TASSERT(xdp_steer_node_insert(s, id, 0, NULL) == 0);
+    TASSERT(node_table_lookup(nt, id, NULL) == 0);
+    TASSERT(xs_find(f, XDP_STEER_MAP_NODE, id) == NULL);
+
+    /* A failed update removes the old hop rather than keeping it */
+    xs_node(id, 1);
+    f->fail_updates = 1;
+    TASSERT(xdp_steer_node_insert(s, id, 5, hop) == -1);
+    TASSERT(xs_find(f, XDP_STEER_MAP_NODE, id) == NULL);
+    f->fail_updates = 0;
+    TASSERT(xdp_steer_node_refresh(s, id) == 0);
+    e = xs_find(f, XDP_STEER_MAP_NODE, id);
+    TASSERT(e != NULL);
+    if (e) {
+        xdp_steer_node_val_t v;
+        memcpy(&v, e->val, sizeof(v));
+        TASSERT(v.ifindex == 15);
+    }
+
+    TASSERT(xdp_steer_node_delete(s, id) == 0);
+    TASSERT(xdp_steer_node_delete(s, id) == -1);
+    TASSERT(node_table_lookup(nt, id, NULL) == -1);
+    TASSERT(xs_count(f, XDP_STEER_MAP_NODE) == 0);
+
+    xdp_steer_stats_t st;
+    xdp_steer_stats(s, &st);
+    TASSERT(st.node_installed == 3);
+    TASSERT(st.node_removed == 2);
+    TASSERT(st.failed == 1);
+
+    xdp_steer_destroy(s);
+    node_table_destroy(nt);
+    free(f);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: hot-SAD operations become LPM entries
+ * -------------------------------------------------------------------------- */
+
+static int test_xdp_steer_sad(void)
+{
+    int errors = 0;
+
+    xdp_steer_sad_key_t k;
+    p4rt_sad_key_t key = { 0x01, 0x03, 0x00001234 };
+    TASSERT(xdp_steer_sad_key(&key, NULL, &k) == 0);
+    TASSERT(k.prefixlen == 96);
+    TASSERT(k.data[3] == 0x01 && k.data[7] == 0x03);
+    TASSERT(k.data[10] == 0x12 && k.data[11] == 0x34);
+
+    /* Widened context: key bits below the prefix are dropped */
+    p4rt_sad_key_t mask = { 0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFF0000u };
+    TASSERT(xdp_steer_sad_key(&key, &mask, &k) == 0);
+    TASSERT(k.prefixlen == 80);
+    TASSERT(k.data[10] == 0 && k.data[11] == 0);
+
+    mask.context_window = 0xFF00FF00u;
+    TASSERT(xdp_steer_sad_key(&key, &mask, &k) == -1);
+    mask.context_window = 0xFFFFFFFFu;
+    mask.capability     = 0x0000FFFFu;
+    TASSERT(xdp_steer_sad_key(&key, &mask, &k) == -1);
+
+    xs_fake_t *f = calloc(1, sizeof(*f));
+    node_table_t *nt = node_table_create(16);
+    xdp_steer_config_t cfg = {
+        .node_table = nt, .underlay_fn = xs_underlay,
+        .update_fn = xs_update, .delete_fn = xs_delete, .map_ctx = f,
+    };
+    xdp_steer_t *s = xdp_steer_create(&cfg);
+    TASSERT(s != NULL);
+
+    p4rt_op_t ops[4];
+    memset(ops, 0, sizeof(ops));
+    ops[0].type = P4RT_OP_SAD_ADD;
+    ops[0].sad_key = key;
+    xs_node(ops[0].node_id, 7);
+    ops[1] = ops[0];
+    ops[1].sad_mask = (p4rt_sad_key_t){ 0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFF0000u };
+    ops[2] = ops[0];
+    ops[2].sad_mask = (p4rt_sad_key_t){ 0xFFFFFFFFu, 0x0000FFFFu, 0xFFFFFFFFu };
+    ops[3].type = P4RT_OP_NODE_ADD;
+
+    TASSERT(xdp_steer_apply(s, ops, 4) == 0);
+    TASSERT(xs_count(f, XDP_STEER_MAP_SAD) == 2);
+    TASSERT(xs_count(f, XDP_STEER_MAP_NODE) == 0);
+
+    xdp_steer_sad_key(&key, NULL, &k);
+    xs_slot_t *e = xs_find(f, XDP_STEER_MAP_SAD, &k);
+    TASSERT(e != NULL && memcmp(e->val, ops[0].node_id, 16) == 0);
+
+    ops[0].type = P4RT_OP_SAD_DELETE;
+    TASSERT(xdp_steer_apply(s, ops, 1) == 0);
+    TASSERT(xs_find(f, XDP_STEER_MAP_SAD, &k) == NULL);
+    TASSERT(xs_count(f, XDP_STEER_MAP_SAD) == 1);
+
+    f->fail_updates = 1;
+    TASSERT(xdp_steer_apply(s, &ops[1], 1) == 1);
+    TASSERT(xs_count(f, XDP_STEER_MAP_SAD) == 0);
+    TASSERT(xdp_steer_apply(s, NULL, 1) == -1);
+
+    xdp_steer_stats_t st;
+    xdp_steer_stats(s, &st);
+    TASSERT(st.sad_installed == 2);
+    TASSERT(st.sad_removed == 1);
+    TASSERT(st.sad_skipped == 1);
+    TASSERT(st.failed == 1);
+
+    xdp_steer_destroy(s);
+    node_table_destroy(nt);
+    free(f);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Test: the CRC patch equals recomputing the checksum
+ * -------------------------------------------------------------------------- */
+
+static int test_xdp_steer_crc_patch(void)
+{
+    int errors = 0;
+
+    static const uint32_t lens[] = { 68, 69, 100, 1500, 4096, 9000, 65535 };
+    uint8_t *frame = malloc(65535);
+    TASSERT(frame != NULL);
+    if (!frame)
+        return errors;
+
+    uint32_t seed = 12345;
+    for (size_t t = 0; t < sizeof(lens) / sizeof(lens[0]); t++) {
+        uint32_t len = lens[t];
+        for (uint32_t i = 0; i < len; i++) {
+            seed = seed * 1103515245u + 12345u;
+            frame[i] = (uint8_t)(seed >> 16);
+        }
+        uint32_t crc = strandlink_crc32c(frame, len - 4);
+
+        uint8_t old_id[16], new_id[16];
+        memcpy(old_id, frame + 32, 16);
+        xs_node(new_id, (int)t);
+        memcpy(frame + 32, new_id, 16);
+
+        uint32_t patched = xdp_steer_crc_patch(crc, old_id, new_id,
+                                               len - 4 - 48);
+        TASSERT(patched == strandlink_crc32c(frame, len - 4));
+        TASSERT(xdp_steer_crc_patch(crc, old_id, old_id, len - 52) == crc);
+    }
+
+    free(frame);
+    return errors;
+}
+
+/* --------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------- */
+
+void register_xdp_steer_tests(void)
+{
+    test_register("xdp_steer_nodes",      test_xdp_steer_nodes);
+    test_register("xdp_steer_sad",        test_xdp_steer_sad);
+    test_register("xdp_steer_crc_patch",  test_xdp_steer_crc_patch);
+}